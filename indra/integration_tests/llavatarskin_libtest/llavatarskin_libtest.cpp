@@ -0,0 +1,438 @@
+/**
+ * @file llavatarskin_libtest.cpp
+ * @brief Skinning a crowd of avatars on the main thread and spread over scheduler workers
+ *
+ * $LicenseInfo:firstyear=2011&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2011, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+#include "linden_common.h"
+
+// linden library includes
+#include "llapr.h"
+#include "llavatarskin.h"
+#include "llcommon.h"
+#include "llerrorcontrol.h"
+#include "lljoint.h"
+#include "llthreadscheduler.h"
+#include "lltimer.h"
+
+#include <iostream>
+#include <vector>
+
+// Usage:
+//   llavatarskin_libtest [--avatars N] [--threads N] [--frames N]
+//
+// Builds --avatars stand-in avatars, each a skeleton of the usual body joints
+// and the six meshes LLVOAvatar::renderSkinned() skins on the CPU, at about
+// the vertex counts of the top LOD of the default avatar. Every frame each
+// skeleton is posed and its world matrices updated, the way
+// LLVOAvatar::updateCharacter() does during idle, and then every mesh is
+// skinned: once on the main thread, the way renderSkinned() does it one
+// avatar at a time, and once with the meshes queued on --threads scheduler
+// workers by LLAvatarSkinThread, as LLVOAvatar::skinVisibleAvatars() does.
+// The skinned vertices must come out the same both ways.
+//
+// The meshes are set up the way LLViewerJointMesh::setupJoint() does and
+// skinned with get_skin_joint_matrices() and skin_joint_vertices(), like
+// LLViewerJointMesh::updateGeometryVectorized(), into plain arrays instead
+// of a vertex buffer.
+
+namespace
+{
+	const F32 FRAME_TIME = 1.f / 30.f;
+
+	// a cheap LCG so every run builds the same crowd
+	class Random
+	{
+	public:
+		Random(U32 seed) : mSeed(seed) {}
+
+		F32 frand(F32 max)
+		{
+			mSeed = mSeed * 1664525 + 1013904223;
+			return max * (F32)(mSeed >> 8) / (F32)(1 << 24);
+		}
+
+	private:
+		U32 mSeed;
+	};
+
+	// parent index and offset from the parent of the avatar_skeleton.xml
+	// joints the body meshes are weighted to
+	struct bone_def
+	{
+		const char* mName;
+		S32 mParent;
+		F32 mX, mY, mZ;
+	};
+
+	const bone_def BONES[] =
+	{
+		{ "mPelvis",		-1,	 0.f,	 0.f,	1.07f	},
+		{ "mTorso",			 0,	 0.f,	 0.f,	0.084f	},
+		{ "mChest",			 1,	-0.015f, 0.f,	0.205f	},
+		{ "mNeck",			 2,	-0.01f,	 0.f,	0.251f	},
+		{ "mHead",			 3,	 0.f,	 0.f,	0.076f	},
+		{ "mCollarLeft",	 2,	-0.021f, 0.085f, 0.165f	},
+		{ "mShoulderLeft",	 5,	 0.f,	 0.079f, 0.f	},
+		{ "mElbowLeft",		 6,	 0.f,	 0.248f, 0.f	},
+		{ "mWristLeft",		 7,	 0.f,	 0.205f, 0.f	},
+		{ "mCollarRight",	 2,	-0.021f,-0.085f, 0.165f	},
+		{ "mShoulderRight",	 9,	 0.f,	-0.079f, 0.f	},
+		{ "mElbowRight",	10,	 0.f,	-0.248f, 0.f	},
+		{ "mWristRight",	11,	 0.f,	-0.205f, 0.f	},
+		{ "mHipLeft",		 0,	 0.034f, 0.127f,-0.041f	},
+		{ "mKneeLeft",		13,	-0.001f,-0.046f,-0.491f	},
+		{ "mAnkleLeft",		14,	-0.029f, 0.001f,-0.468f	},
+		{ "mHipRight",		 0,	 0.034f,-0.129f,-0.041f	},
+		{ "mKneeRight",		16,	-0.001f, 0.049f,-0.491f	},
+		{ "mAnkleRight",	17,	-0.029f, 0.f,	-0.468f	},
+	};
+	const S32 NUM_BONES = sizeof(BONES) / sizeof(BONES[0]);
+
+	// the joints each mesh is weighted to and its vertex count, like
+	// LLPolyMesh::mJointRenderData and the avatar_lad.xml LOD 0 meshes
+	struct mesh_def
+	{
+		const char* mName;
+		S32 mNumVertices;
+		S32 mNumJoints;
+		S32 mJoints[8];
+	};
+
+	const mesh_def MESHES[] =
+	{
+		{ "headMesh",		 690, 3, { 2, 3, 4 } },
+		{ "upperBodyMesh",	1540, 8, { 1, 2, 3, 5, 6, 7, 10, 11 } },
+		{ "lowerBodyMesh",	1470, 7, { 0, 1, 13, 14, 15, 17, 18 } },
+		{ "hairMesh",		 720, 2, { 3, 4 } },
+		{ "eyelashMesh",	  25, 1, { 4 } },
+		{ "skirtMesh",		 740, 4, { 0, 13, 16, 14 } },
+	};
+	const S32 NUM_MESHES = sizeof(MESHES) / sizeof(MESHES[0]);
+
+	// An LLPolyMesh and the vertex buffer of its LLFace, with the joint
+	// render data it is skinned with
+	class SkinMesh : public LLSkinnedMesh
+	{
+	public:
+		SkinMesh(const mesh_def& def, std::vector<LLJoint*>& bones, Random& random)
+		:	mSkinJoints(def.mNumJoints)
+		{
+			// LLViewerJointMesh::setupSkinJoints() and setupJoint()
+			for (S32 j = 0; j < def.mNumJoints; ++j)
+			{
+				LLJoint* bone = bones[def.mJoints[j]];
+				LLSkinJoint& sj = mSkinJoints[j];
+				sj.setupSkinJoint(bone);
+				if (!mJointData.count()
+					|| mJointData[mJointData.count() - 1]->mWorldMatrix != &bone->getParent()->getWorldMatrix())
+				{
+					mJointData.put(new LLJointRenderData(&bone->getParent()->getWorldMatrix(), NULL));
+				}
+				mJointData.put(new LLJointRenderData(&bone->getWorldMatrix(), &sj));
+			}
+
+			S32 num_entries = mJointData.count();
+			mCoords.resize(def.mNumVertices);
+			mNormals.resize(def.mNumVertices);
+			mWeights.resize(def.mNumVertices);
+			mSkinnedVertices.resize(def.mNumVertices);
+			mSkinnedNormals.resize(def.mNumVertices);
+			for (S32 i = 0; i < def.mNumVertices; ++i)
+			{
+				// in runs around each matrix, weighted between it and the
+				// next in the integer + fraction form of
+				// LLPolyMesh::getWeights(). Neighbouring vertices mostly
+				// share a weight, which skin_joint_vertices() relies on to
+				// skip the lerp.
+				S32 entry = i * (num_entries - 1) / def.mNumVertices;
+				LLSkinJoint* sj = mJointData[entry]->mSkinJoint ? mJointData[entry]->mSkinJoint : mJointData[entry + 1]->mSkinJoint;
+				// in the bind pose, relative to the avatar root
+				mCoords[i] = -sj->mRootToJointSkinOffset
+					+ LLVector3(random.frand(0.2f) - 0.1f, random.frand(0.2f) - 0.1f, random.frand(0.2f) - 0.1f);
+				mNormals[i].setVec(random.frand(2.f) - 1.f, random.frand(2.f) - 1.f, random.frand(2.f) - 1.f);
+				mNormals[i].normVec();
+				mWeights[i] = entry + (F32)(i % 40 / 8) * 0.2f;
+			}
+		}
+
+		~SkinMesh()
+		{
+			for (S32 i = 0; i < mJointData.count(); ++i)
+			{
+				delete mJointData[i];
+			}
+		}
+
+		/*virtual*/ U32 getNumSkinnedVertices() const { return mCoords.size(); }
+
+		// LLViewerJointMesh::updateGeometryVectorized()
+		/*virtual*/ void skinJointGeometry()
+		{
+			LLMatrix4 joint_mat[32];
+			LLMatrix3 joint_rot[32];
+			get_skin_joint_matrices(mJointData, NULL, joint_mat, joint_rot);
+
+			LLStrider<LLVector3> o_vertices;
+			LLStrider<LLVector3> o_normals;
+			o_vertices = &mSkinnedVertices[0];
+			o_normals = &mSkinnedNormals[0];
+			skin_joint_vertices(joint_mat, mJointData.count(), mCoords.size(),
+								&mWeights[0], &mCoords[0], &mNormals[0], o_vertices, o_normals);
+		}
+
+		std::vector<LLVector3> mSkinnedVertices;
+		std::vector<LLVector3> mSkinnedNormals;
+
+	private:
+		std::vector<LLSkinJoint> mSkinJoints;
+		LLDynamicArray<LLJointRenderData*> mJointData;
+		std::vector<LLVector3> mCoords;
+		std::vector<LLVector3> mNormals;
+		std::vector<F32> mWeights;
+	};
+
+	typedef std::vector<SkinMesh*> mesh_list_t;
+
+	class Avatar
+	{
+	public:
+		Avatar(S32 index, Random& random)
+		:	mRoot("mRoot"), mPhase(random.frand(F_TWO_PI))
+		{
+			for (S32 i = 0; i < NUM_BONES; ++i)
+			{
+				LLJoint* parent = (BONES[i].mParent < 0) ? &mRoot : mBones[BONES[i].mParent];
+				LLJoint* bone = new LLJoint(BONES[i].mName, parent);
+				bone->setPosition(LLVector3(BONES[i].mX, BONES[i].mY, BONES[i].mZ));
+				bone->setSkinOffset(bone->getPosition());
+				mBones.push_back(bone);
+			}
+			// spread out over a region, in bind pose for the skin offsets
+			mRoot.setPosition(LLVector3((F32)(index % 64) * 2.f, (F32)(index / 64) * 2.f, 0.f));
+			mRoot.updateWorldMatrixChildren();
+
+			for (S32 i = 0; i < NUM_MESHES; ++i)
+			{
+				mMeshes.push_back(new SkinMesh(MESHES[i], mBones, random));
+			}
+		}
+
+		~Avatar()
+		{
+			for (mesh_list_t::iterator iter = mMeshes.begin(); iter != mMeshes.end(); ++iter)
+			{
+				delete *iter;
+			}
+			// children first, ~LLJoint() detaches from the parent
+			for (S32 i = (S32)mBones.size() - 1; i >= 0; --i)
+			{
+				delete mBones[i];
+			}
+		}
+
+		// a walk cycle of sorts, then LLVOAvatar::updateCharacter()'s
+		// updateWorldMatrixChildren()
+		void pose(F32 time)
+		{
+			for (S32 i = 0; i < NUM_BONES; ++i)
+			{
+				F32 angle = 0.4f * sinf(time * 4.f + mPhase + i * 0.7f);
+				mBones[i]->setRotation(LLQuaternion(angle, (i & 1) ? LLVector3::x_axis : LLVector3::y_axis));
+			}
+			mRoot.updateWorldMatrixChildren();
+		}
+
+		void skin()
+		{
+			for (mesh_list_t::iterator iter = mMeshes.begin(); iter != mMeshes.end(); ++iter)
+			{
+				(*iter)->skinJointGeometry();
+			}
+		}
+
+		LLJoint mRoot;
+		std::vector<LLJoint*> mBones;
+		mesh_list_t mMeshes;
+		F32 mPhase;
+	};
+
+	typedef std::vector<Avatar*> avatar_list_t;
+
+	struct frame_times
+	{
+		frame_times() : mPose(0.0), mSkin(0.0) {}
+
+		F64 mPose;
+		F64 mSkin;
+	};
+
+	void run_serial(const avatar_list_t& avatars, S32 num_frames, frame_times& times)
+	{
+		LLTimer timer;
+		for (S32 f = 0; f < num_frames; ++f)
+		{
+			timer.reset();
+			for (avatar_list_t::const_iterator iter = avatars.begin(); iter != avatars.end(); ++iter)
+			{
+				(*iter)->pose(f * FRAME_TIME);
+			}
+			times.mPose += timer.getElapsedTimeF64();
+
+			timer.reset();
+			for (avatar_list_t::const_iterator iter = avatars.begin(); iter != avatars.end(); ++iter)
+			{
+				(*iter)->skin();
+			}
+			times.mSkin += timer.getElapsedTimeF64();
+		}
+	}
+
+	void run_threaded(const avatar_list_t& avatars, S32 num_frames, frame_times& times)
+	{
+		LLAvatarSkinThread queue(true, llmax(1U, (U32)LLThreadScheduler::getInstance()->getNumWorkers()));
+		std::vector<LLSkinnedMesh*> meshes;
+
+		LLTimer timer;
+		for (S32 f = 0; f < num_frames; ++f)
+		{
+			timer.reset();
+			for (avatar_list_t::const_iterator iter = avatars.begin(); iter != avatars.end(); ++iter)
+			{
+				(*iter)->pose(f * FRAME_TIME);
+			}
+			times.mPose += timer.getElapsedTimeF64();
+
+			timer.reset();
+			for (avatar_list_t::const_iterator iter = avatars.begin(); iter != avatars.end(); ++iter)
+			{
+				meshes.assign((*iter)->mMeshes.begin(), (*iter)->mMeshes.end());
+				queue.queueSkin(meshes);
+			}
+			queue.finishBatch();
+			times.mSkin += timer.getElapsedTimeF64();
+		}
+		queue.shutdown();
+	}
+
+	void save_skin(const avatar_list_t& avatars, std::vector<LLVector3>& out)
+	{
+		out.clear();
+		for (avatar_list_t::const_iterator iter = avatars.begin(); iter != avatars.end(); ++iter)
+		{
+			for (mesh_list_t::const_iterator mesh = (*iter)->mMeshes.begin(); mesh != (*iter)->mMeshes.end(); ++mesh)
+			{
+				out.insert(out.end(), (*mesh)->mSkinnedVertices.begin(), (*mesh)->mSkinnedVertices.end());
+				out.insert(out.end(), (*mesh)->mSkinnedNormals.begin(), (*mesh)->mSkinnedNormals.end());
+			}
+		}
+	}
+
+	void print_stats(const char* name, const frame_times& times, S32 frames, S32 vertices, F64 baseline)
+	{
+		std::cout << llformat("%-12s %7.3fms pose, %7.3fms skin per frame, %.1fM vertices/s",
+							  name, times.mPose * 1000.0 / frames, times.mSkin * 1000.0 / frames,
+							  times.mSkin > 0.0 ? (F64)vertices * frames / times.mSkin / 1000000.0 : 0.0);
+		if (baseline > 0.0 && times.mSkin > 0.0)
+		{
+			std::cout << llformat(", %.2fx", baseline / times.mSkin);
+		}
+		std::cout << std::endl;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	S32 num_avatars = 60;
+	S32 num_threads = 0;
+	S32 num_frames = 300;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg(argv[i]);
+		if (arg == "--avatars" && i + 1 < argc)
+		{
+			num_avatars = llmax(1, atoi(argv[++i]));
+		}
+		else if (arg == "--threads" && i + 1 < argc)
+		{
+			num_threads = llmax(0, atoi(argv[++i]));
+		}
+		else if (arg == "--frames" && i + 1 < argc)
+		{
+			num_frames = llmax(1, atoi(argv[++i]));
+		}
+		else
+		{
+			std::cerr << "Usage: " << argv[0] << " [--avatars N] [--threads N] [--frames N]" << std::endl;
+			return 1;
+		}
+	}
+
+	LLError::initForApplication(".");
+	LLCommon::initClass();
+	ll_init_apr();
+	LLThreadScheduler::initClass(num_threads);
+
+	Random random(12345);
+	avatar_list_t avatars;
+	S32 num_vertices = 0;
+	for (S32 i = 0; i < num_avatars; ++i)
+	{
+		avatars.push_back(new Avatar(i, random));
+		for (mesh_list_t::iterator mesh = avatars.back()->mMeshes.begin(); mesh != avatars.back()->mMeshes.end(); ++mesh)
+		{
+			num_vertices += (*mesh)->getNumSkinnedVertices();
+		}
+	}
+
+	std::cout << llformat("%d avatars, %d vertices, %d frames, %d skin threads",
+						  num_avatars, num_vertices, num_frames,
+						  LLThreadScheduler::getInstance()->getNumWorkers()) << std::endl;
+
+	frame_times serial_times;
+	run_serial(avatars, num_frames, serial_times);
+	print_stats("main thread:", serial_times, num_frames, num_vertices, 0.0);
+	std::vector<LLVector3> serial_skin;
+	save_skin(avatars, serial_skin);
+
+	frame_times threaded_times;
+	run_threaded(avatars, num_frames, threaded_times);
+	print_stats("threaded:", threaded_times, num_frames, num_vertices, serial_times.mSkin);
+	std::vector<LLVector3> threaded_skin;
+	save_skin(avatars, threaded_skin);
+
+	S32 result = 0;
+	if (serial_skin != threaded_skin)
+	{
+		std::cout << "Threaded skinning gave different vertices" << std::endl;
+		result = 1;
+	}
+
+	for (avatar_list_t::iterator iter = avatars.begin(); iter != avatars.end(); ++iter)
+	{
+		delete *iter;
+	}
+	LLThreadScheduler::cleanupClass();
+	LLCommon::cleanupClass();
+	return result;
+}
@@ -0,0 +1,566 @@
+/**
+ * @file llcharacter_libtest.cpp
+ * @brief Headless keyframe playback benchmark for many animated characters
+ *
+ * $LicenseInfo:firstyear=2011&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2011, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+#include "linden_common.h"
+
+// linden library includes
+#include "llcharacter.h"
+#include "llcommon.h"
+#include "lldatapacker.h"
+#include "llerrorcontrol.h"
+#include "llfasttimer.h"
+#include "llfile.h"
+#include "llframetimer.h"
+#include "lljoint.h"
+#include "llkeyframemotion.h"
+#include "llquantize.h"
+#include "llrand.h"
+#include "lltimer.h"
+#include "lluuid.h"
+#include "llxmltree.h"
+
+#include <iostream>
+#include <vector>
+
+// Usage:
+//   llcharacter_libtest [--characters N] [--motions N] [--joints N] [--keys N] [--frames N]
+//                       [--skeleton avatar_skeleton.xml] [--anim FILE.anim]...
+//
+// Builds --motions synthetic looping animations with --keys rotation keys on
+// each of --joints joints (plus pelvis position keys), plays all of them on
+// every one of --characters characters and times LLKeyframeMotion::onUpdate()
+// over --frames frames at 30 fps. The same frames are then played back in
+// random order, which defeats the per motion key cursors and shows the cost
+// of the binary search fallback.
+//
+// With --skeleton the characters get the bones and collision volumes of
+// avatar_skeleton.xml instead of a chain of joints, and the synthetic
+// animations key the first --joints bones. Each --anim is a file in the
+// animation asset format, decoded with LLKeyframeMotion::deserialize() and
+// played instead of the synthetic animations.
+//
+// Finally every character plays all the animations through its
+// LLMotionController, the way LLVOAvatar::updateCharacter() does each
+// frame: LLCharacter::updateMotions() and then the joint world matrices.
+// The frame clock is stepped by exactly 1/30s a frame, so the frames run
+// as fast as they can be computed, and the LLFastTimer times of each stage
+// are reported.
+
+namespace
+{
+	const F32 FRAME_TIME = 1.f / 30.f;
+	const F32 ANIM_DURATION = 4.f;
+
+	// Just enough of an avatar to run keyframe motions on: a chain of joints
+	// starting at mPelvis, or the skeleton from avatar_skeleton.xml.
+	class BenchCharacter : public LLCharacter
+	{
+	public:
+		BenchCharacter(S32 num_joints)
+			: mRoot("mRoot")
+		{
+			mID.generate();
+			LLJoint* parent = &mRoot;
+			for (S32 i = 0; i < num_joints; ++i)
+			{
+				std::string name = (i == 0) ? std::string("mPelvis") : llformat("mJoint%d", i);
+				LLJoint* joint = new LLJoint(name, parent);
+				joint->setPosition(LLVector3(0.f, 0.f, 0.1f));
+				mJoints.push_back(joint);
+				parent = joint;
+			}
+		}
+
+		BenchCharacter(LLXmlTreeNode* skeleton)
+			: mRoot("mRoot")
+		{
+			mID.generate();
+			for (LLXmlTreeNode* child = skeleton->getFirstChild(); child; child = skeleton->getNextChild())
+			{
+				addBone(child, &mRoot);
+			}
+		}
+
+		~BenchCharacter()
+		{
+			// children first, ~LLJoint() detaches from the parent
+			for (S32 i = (S32)mVolumes.size() - 1; i >= 0; --i)
+			{
+				delete mVolumes[i];
+			}
+			for (S32 i = (S32)mJoints.size() - 1; i >= 0; --i)
+			{
+				delete mJoints[i];
+			}
+		}
+
+		void getJointNames(std::vector<std::string>& names) const
+		{
+			for (std::vector<LLJoint*>::const_iterator iter = mJoints.begin(); iter != mJoints.end(); ++iter)
+			{
+				names.push_back((*iter)->getName());
+			}
+		}
+
+		// Only animations already in LLKeyframeDataCache can be played,
+		// there is nothing to fetch an emote or any other asset from.
+		/*virtual*/ BOOL startMotion(const LLUUID& id, F32 start_offset = 0.f)
+		{
+			if (!LLKeyframeDataCache::getKeyframeData(id))
+			{
+				return FALSE;
+			}
+			return LLCharacter::startMotion(id, start_offset);
+		}
+
+		// LLVOAvatar's collision volumes, for animation constraints
+		/*virtual*/ LLVector3 getVolumePos(S32 joint_index, LLVector3& volume_offset)
+		{
+			if (joint_index < 0 || joint_index >= (S32)mVolumes.size())
+			{
+				return LLVector3::zero;
+			}
+			// LLViewerJointCollisionVolume::getVolumePos()
+			LLJoint* volume = mVolumes[joint_index];
+			LLVector3 result = volume_offset;
+			result.scaleVec(volume->getScale());
+			result.rotVec(volume->getWorldRotation());
+			result += volume->getWorldPosition();
+			return result;
+		}
+		/*virtual*/ LLJoint* findCollisionVolume(U32 volume_id)
+		{
+			return volume_id < mVolumes.size() ? mVolumes[volume_id] : NULL;
+		}
+		/*virtual*/ S32 getCollisionVolumeID(std::string& name)
+		{
+			for (S32 i = 0; i < (S32)mVolumes.size(); ++i)
+			{
+				if (mVolumes[i]->getName() == name)
+				{
+					return i;
+				}
+			}
+			return -1;
+		}
+
+		/*virtual*/ const char* getAnimationPrefix() { return "avatar"; }
+		/*virtual*/ LLJoint* getRootJoint() { return &mRoot; }
+		/*virtual*/ LLVector3 getCharacterPosition() { return LLVector3::zero; }
+		/*virtual*/ LLQuaternion getCharacterRotation() { return LLQuaternion::DEFAULT; }
+		/*virtual*/ LLVector3 getCharacterVelocity() { return LLVector3::zero; }
+		/*virtual*/ LLVector3 getCharacterAngularVelocity() { return LLVector3::zero; }
+		/*virtual*/ void getGround(const LLVector3& in_pos, LLVector3& out_pos, LLVector3& out_norm)
+		{
+			out_pos = in_pos;
+			out_pos.mV[VZ] = 0.f;
+			out_norm = LLVector3::z_axis;
+		}
+		/*virtual*/ BOOL allocateCharacterJoints(U32 num) { return FALSE; }
+		/*virtual*/ LLJoint* getCharacterJoint(U32 i) { return i < mJoints.size() ? mJoints[i] : NULL; }
+		/*virtual*/ F32 getTimeDilation() { return 1.f; }
+		/*virtual*/ F32 getPixelArea() const { return 1000.f; }
+		/*virtual*/ LLPolyMesh* getHeadMesh() { return NULL; }
+		/*virtual*/ LLPolyMesh* getUpperBodyMesh() { return NULL; }
+		/*virtual*/ LLVector3d getPosGlobalFromAgent(const LLVector3& position) { return LLVector3d(position); }
+		/*virtual*/ LLVector3 getPosAgentFromGlobal(const LLVector3d& position) { return LLVector3(position); }
+		/*virtual*/ void addDebugText(const std::string& text) {}
+		/*virtual*/ const LLUUID& getID() { return mID; }
+
+	private:
+		// LLVOAvatar::setupBone()
+		void addBone(LLXmlTreeNode* node, LLJoint* parent)
+		{
+			std::string name;
+			LLVector3 pos, rot, scale(1.f, 1.f, 1.f);
+			node->getAttributeString("name", name);
+			node->getAttributeVector3("pos", pos);
+			node->getAttributeVector3("rot", rot);
+			node->getAttributeVector3("scale", scale);
+
+			LLJoint* joint = new LLJoint(name, parent);
+			joint->setPosition(pos);
+			joint->setRotation(mayaQ(rot.mV[VX], rot.mV[VY], rot.mV[VZ], LLQuaternion::XYZ));
+			joint->setScale(scale);
+			if (node->hasName("collision_volume"))
+			{
+				mVolumes.push_back(joint);
+				return;
+			}
+
+			LLVector3 pivot;
+			if (node->getAttributeVector3("pivot", pivot))
+			{
+				joint->setSkinOffset(pivot);
+			}
+			mJoints.push_back(joint);
+			for (LLXmlTreeNode* child = node->getFirstChild(); child; child = node->getNextChild())
+			{
+				addBone(child, joint);
+			}
+		}
+
+		LLUUID mID;
+		LLJoint mRoot;
+		std::vector<LLJoint*> mJoints;
+		std::vector<LLJoint*> mVolumes;
+	};
+
+	// The first instance of an animation has to be decoded by hand, there is
+	// no asset storage or VFS to load it from. Later instances find it in
+	// LLKeyframeDataCache.
+	class BenchMotion : public LLKeyframeMotion
+	{
+	public:
+		BenchMotion(const LLUUID& id) : LLKeyframeMotion(id) {}
+
+		BOOL load(LLCharacter* character, LLDataPacker& dp)
+		{
+			mCharacter = character;
+			return deserialize(dp);
+		}
+	};
+
+	// Writes a looping animation in the KEYFRAME_MOTION_VERSION asset format.
+	S32 make_animation(const std::vector<std::string>& joint_names, S32 num_keys, std::vector<U8>& buffer)
+	{
+		S32 num_joints = joint_names.size();
+		buffer.resize(1024 + num_joints * (64 + num_keys * 8 * 2));
+		LLDataPackerBinaryBuffer dp(&buffer[0], buffer.size());
+
+		dp.packU16(KEYFRAME_MOTION_VERSION, "version");
+		dp.packU16(KEYFRAME_MOTION_SUBVERSION, "sub_version");
+		dp.packS32(LLJoint::MEDIUM_PRIORITY, "base_priority");
+		dp.packF32(ANIM_DURATION, "duration");
+		dp.packString(std::string(), "emote_name");
+		dp.packF32(0.f, "loop_in_point");
+		dp.packF32(ANIM_DURATION, "loop_out_point");
+		dp.packS32(1, "loop");
+		dp.packF32(0.3f, "ease_in_duration");
+		dp.packF32(0.3f, "ease_out_duration");
+		dp.packU32(0, "hand_pose");
+		dp.packU32(num_joints, "num_joints");
+
+		for (S32 j = 0; j < num_joints; ++j)
+		{
+			dp.packString(joint_names[j], "joint_name");
+			dp.packS32(LLJoint::USE_MOTION_PRIORITY, "joint_priority");
+
+			dp.packS32(num_keys, "num_rot_keys");
+			for (S32 k = 0; k < num_keys; ++k)
+			{
+				F32 time = ANIM_DURATION * k / llmax(1, num_keys - 1);
+				dp.packU16(F32_to_U16(time, 0.f, ANIM_DURATION), "time");
+
+				LLQuaternion rot(ll_frand(F_TWO_PI), LLVector3(ll_frand(), ll_frand(), ll_frand() + 0.1f));
+				LLVector3 rot_angles = rot.packToVector3();
+				dp.packU16(F32_to_U16(rot_angles.mV[VX], -1.f, 1.f), "rot_angle_x");
+				dp.packU16(F32_to_U16(rot_angles.mV[VY], -1.f, 1.f), "rot_angle_y");
+				dp.packU16(F32_to_U16(rot_angles.mV[VZ], -1.f, 1.f), "rot_angle_z");
+			}
+
+			S32 num_pos_keys = (joint_names[j] == "mPelvis") ? num_keys : 0;
+			dp.packS32(num_pos_keys, "num_pos_keys");
+			for (S32 k = 0; k < num_pos_keys; ++k)
+			{
+				F32 time = ANIM_DURATION * k / llmax(1, num_keys - 1);
+				dp.packU16(F32_to_U16(time, 0.f, ANIM_DURATION), "time");
+				dp.packU16(F32_to_U16(ll_frand(0.2f) - 0.1f, -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET), "pos_x");
+				dp.packU16(F32_to_U16(ll_frand(0.2f) - 0.1f, -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET), "pos_y");
+				dp.packU16(F32_to_U16(ll_frand(0.2f) - 0.1f, -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET), "pos_z");
+			}
+		}
+
+		dp.packS32(0, "num_constraints");
+		return dp.getCurrentSize();
+	}
+
+	typedef std::vector<LLKeyframeMotion*> motion_list_t;
+
+	// Returns the elapsed time in seconds to update every motion for every
+	// frame time in times.
+	F64 run_frames(motion_list_t& motions, const std::vector<F32>& times)
+	{
+		U8 joint_mask[LL_CHARACTER_MAX_JOINTS];
+		memset(joint_mask, 0, sizeof(joint_mask));
+
+		LLTimer timer;
+		for (std::vector<F32>::const_iterator time_iter = times.begin(); time_iter != times.end(); ++time_iter)
+		{
+			for (motion_list_t::iterator iter = motions.begin(); iter != motions.end(); ++iter)
+			{
+				(*iter)->onUpdate(*time_iter, joint_mask);
+			}
+		}
+		return timer.getElapsedTimeF64();
+	}
+
+	bool load_file(const std::string& filename, std::vector<U8>& buffer)
+	{
+		llifstream file(filename, std::ios::in | std::ios::binary);
+		if (!file.is_open())
+		{
+			return false;
+		}
+		file.seekg(0, std::ios::end);
+		buffer.resize(file.tellg());
+		file.seekg(0, std::ios::beg);
+		if (!buffer.empty())
+		{
+			file.read((char*)&buffer[0], buffer.size());
+		}
+		return !buffer.empty() && file.good();
+	}
+
+	// Total LLFastTimer time and calls of one timer over all the frames
+	struct stage_time
+	{
+		stage_time(const std::string& name) : mName(name), mSeconds(0.0), mCalls(0) {}
+
+		std::string mName;
+		F64 mSeconds;
+		U64 mCalls;
+	};
+
+	static LLFastTimer::DeclareTimer FTM_JOINT_WORLD_MATRICES("Joint World Matrices");
+
+	// The animation part of LLVOAvatar::updateCharacter() for every
+	// character, with the frame clock stepped by FRAME_TIME. Returns the
+	// elapsed time in seconds.
+	F64 run_controllers(std::vector<BenchCharacter*>& characters, S32 num_frames, std::vector<stage_time>& stages)
+	{
+		F64 clocks_per_second = (F64)LLFastTimer::countsPerSecond();
+		LLFastTimer::reset();
+
+		LLTimer timer;
+		for (S32 f = 0; f < num_frames; ++f)
+		{
+			LLFrameTimer::stepFrameTime(FRAME_TIME);
+			for (std::vector<BenchCharacter*>::iterator iter = characters.begin(); iter != characters.end(); ++iter)
+			{
+				(*iter)->updateMotions(LLCharacter::NORMAL_UPDATE);
+			}
+			{
+				LLFastTimer t(FTM_JOINT_WORLD_MATRICES);
+				for (std::vector<BenchCharacter*>::iterator iter = characters.begin(); iter != characters.end(); ++iter)
+				{
+					(*iter)->getRootJoint()->updateWorldMatrixChildren();
+				}
+			}
+			LLFastTimer::nextFrame();
+
+			for (std::vector<stage_time>::iterator stage = stages.begin(); stage != stages.end(); ++stage)
+			{
+				const LLFastTimer::NamedTimer* named_timer = LLFastTimer::getTimerByName(stage->mName);
+				if (named_timer)
+				{
+					stage->mSeconds += (F64)named_timer->getHistoricalCount(0) / clocks_per_second;
+					stage->mCalls += named_timer->getHistoricalCalls(0);
+				}
+			}
+		}
+		return timer.getElapsedTimeF64();
+	}
+}
+
+int main(int argc, char** argv)
+{
+	S32 num_characters = 200;
+	S32 num_motions = 3;
+	S32 num_joints = 20;
+	S32 num_keys = 120;
+	S32 num_frames = 300;
+	std::string skeleton_file;
+	std::vector<std::string> anim_files;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg(argv[i]);
+		if (arg == "--skeleton" && i + 1 < argc)
+		{
+			skeleton_file = argv[++i];
+			continue;
+		}
+		if (arg == "--anim" && i + 1 < argc)
+		{
+			anim_files.push_back(argv[++i]);
+			continue;
+		}
+
+		S32* value = NULL;
+		if (arg == "--characters") value = &num_characters;
+		else if (arg == "--motions") value = &num_motions;
+		else if (arg == "--joints") value = &num_joints;
+		else if (arg == "--keys") value = &num_keys;
+		else if (arg == "--frames") value = &num_frames;
+
+		if (!value || i + 1 >= argc)
+		{
+			std::cerr << "Usage: " << argv[0] << " [--characters N] [--motions N] [--joints N] [--keys N] [--frames N]"
+					  << " [--skeleton avatar_skeleton.xml] [--anim FILE.anim]..." << std::endl;
+			return 1;
+		}
+		*value = llmax(1, atoi(argv[++i]));
+	}
+	num_joints = llmin(num_joints, (S32)LL_CHARACTER_MAX_JOINTS);
+
+	LLError::initForApplication(".");
+	LLCommon::initClass();
+
+	LLXmlTree skeleton;
+	if (!skeleton_file.empty())
+	{
+		if (!skeleton.parseFile(skeleton_file, FALSE) || !skeleton.getRoot()->hasName("linden_skeleton"))
+		{
+			std::cerr << "Failed to load skeleton " << skeleton_file << std::endl;
+			return 1;
+		}
+	}
+
+	std::vector<BenchCharacter*> characters;
+	for (S32 c = 0; c < num_characters; ++c)
+	{
+		characters.push_back(skeleton_file.empty() ? new BenchCharacter(num_joints)
+												   : new BenchCharacter(skeleton.getRoot()));
+	}
+
+	std::vector<std::string> joint_names;
+	characters[0]->getJointNames(joint_names);
+	joint_names.resize(llmin(num_joints, (S32)joint_names.size()));
+
+	// Decode each animation once, then instance it on every character
+	std::vector<LLUUID> anim_ids;
+	motion_list_t motions;
+	S32 num_anims = anim_files.empty() ? num_motions : (S32)anim_files.size();
+	for (S32 m = 0; m < num_anims; ++m)
+	{
+		LLUUID anim_id;
+		anim_id.generate();
+		anim_ids.push_back(anim_id);
+
+		std::vector<U8> buffer;
+		if (anim_files.empty())
+		{
+			buffer.resize(make_animation(joint_names, num_keys, buffer));
+		}
+		else if (!load_file(anim_files[m], buffer))
+		{
+			std::cerr << "Failed to read " << anim_files[m] << std::endl;
+			return 1;
+		}
+		LLDataPackerBinaryBuffer dp(&buffer[0], buffer.size());
+		BenchMotion* loader = new BenchMotion(anim_id);
+		if (!loader->load(characters[0], dp))
+		{
+			std::cerr << "Failed to decode animation " << (anim_files.empty() ? llformat("%d", m) : anim_files[m]) << std::endl;
+			return 1;
+		}
+		motions.push_back(loader);
+
+		for (S32 c = 1; c < num_characters; ++c)
+		{
+			LLKeyframeMotion* motion = new LLKeyframeMotion(anim_id);
+			if (motion->onInitialize(characters[c]) != LLMotion::STATUS_SUCCESS)
+			{
+				std::cerr << "Failed to instance animation " << m << std::endl;
+				return 1;
+			}
+			motions.push_back(motion);
+		}
+	}
+	for (motion_list_t::iterator iter = motions.begin(); iter != motions.end(); ++iter)
+	{
+		(*iter)->activate(0.f);
+	}
+
+	std::vector<F32> times;
+	for (S32 f = 0; f < num_frames; ++f)
+	{
+		times.push_back(f * FRAME_TIME);
+	}
+	F64 sequential = run_frames(motions, times);
+
+	// Same frames, shuffled, after rewinding every motion
+	for (S32 f = num_frames - 1; f > 0; --f)
+	{
+		std::swap(times[f], times[ll_rand(f + 1)]);
+	}
+	for (motion_list_t::iterator iter = motions.begin(); iter != motions.end(); ++iter)
+	{
+		(*iter)->activate(0.f);
+	}
+	F64 random = run_frames(motions, times);
+
+	// Everything again through the motion controllers
+	for (std::vector<BenchCharacter*>::iterator iter = characters.begin(); iter != characters.end(); ++iter)
+	{
+		for (std::vector<LLUUID>::iterator id = anim_ids.begin(); id != anim_ids.end(); ++id)
+		{
+			(*iter)->startMotion(*id);
+		}
+	}
+	std::vector<stage_time> stages;
+	stages.push_back(stage_time("Update Animation"));
+	stages.push_back(stage_time("Keyframe Motion"));
+	stages.push_back(stage_time("Joint World Matrices"));
+	F64 controlled = run_controllers(characters, num_frames, stages);
+
+	S32 updates = num_frames * (S32)motions.size();
+	if (anim_files.empty())
+	{
+		std::cout << llformat("%d characters x %d motions, %d joints, %d keys per joint, %d frames",
+							  num_characters, num_motions, (S32)joint_names.size(), num_keys, num_frames) << std::endl;
+	}
+	else
+	{
+		std::cout << llformat("%d characters x %d animation files, %d frames",
+							  num_characters, num_anims, num_frames) << std::endl;
+	}
+	std::cout << llformat("sequential: %8.3fs, %8.2f ms/frame, %6.2f us/motion update",
+						  sequential, 1000.0 * sequential / num_frames, 1000000.0 * sequential / updates) << std::endl;
+	std::cout << llformat("random:     %8.3fs, %8.2f ms/frame, %6.2f us/motion update",
+						  random, 1000.0 * random / num_frames, 1000000.0 * random / updates) << std::endl;
+	std::cout << llformat("controller: %8.3fs, %8.2f ms/frame, %.1fx real time",
+						  controlled, 1000.0 * controlled / num_frames,
+						  controlled > 0.0 ? num_frames * FRAME_TIME / controlled : 0.0) << std::endl;
+	for (std::vector<stage_time>::iterator stage = stages.begin(); stage != stages.end(); ++stage)
+	{
+		std::cout << llformat("  %-22s %8.2f ms/frame, %8llu calls",
+							  (stage->mName + ":").c_str(), 1000.0 * stage->mSeconds / num_frames,
+							  (unsigned long long)stage->mCalls) << std::endl;
+	}
+
+	for (motion_list_t::iterator iter = motions.begin(); iter != motions.end(); ++iter)
+	{
+		delete *iter;
+	}
+	for (std::vector<BenchCharacter*>::iterator iter = characters.begin(); iter != characters.end(); ++iter)
+	{
+		delete *iter;
+	}
+	LLKeyframeDataCache::clear();
+	LLCommon::cleanupClass();
+	return 0;
+}
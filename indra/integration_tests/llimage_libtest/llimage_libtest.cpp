@@ -0,0 +1,292 @@
+/**
+ * @file llimage_libtest.cpp
+ * @brief Decode throughput benchmark for the LLImageDecodeThread pool and
+ * the LLImageRaw mip, scale and composite kernels
+ *
+ * $LicenseInfo:firstyear=2011&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2011, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+#include "linden_common.h"
+
+// linden library includes
+#include "llcommon.h"
+#include "llerrorcontrol.h"
+#include "llimage.h"
+#include "llimagej2c.h"
+#include "llimageworker.h"
+#include "llpointer.h"
+#include "lltimer.h"
+
+#include <iostream>
+#include <vector>
+
+// Usage:
+//   llimage_libtest [--threads 1,2,4,8] [--repeat N] file.j2c [file.j2c ...]
+//   llimage_libtest --kernels SIZE [--repeat N]
+//
+// Every file is decoded --repeat times for each pool size in --threads and
+// the wall clock time of the whole batch is reported, along with the
+// per-worker stats collected by LLImageDecodeThread.
+//
+// --kernels runs generateMip(), scale() and composite() --repeat times on
+// random SIZExSIZE images of 1 to 4 components, with the scalar and then
+// the SSE2 kernels, and reports megapixels per second for each.
+
+namespace
+{
+	LLAtomic32<S32> sDecodesPending(0);
+	LLAtomic32<S32> sDecodesFailed(0);
+
+	class BenchResponder : public LLImageDecodeThread::Responder
+	{
+	public:
+		/*virtual*/ void completed(bool success, LLImageRaw* raw, LLImageRaw* aux)
+		{
+			if (!success)
+			{
+				sDecodesFailed++;
+			}
+			sDecodesPending--;
+		}
+	};
+
+	void parse_thread_counts(const std::string& arg, std::vector<U32>& counts)
+	{
+		counts.clear();
+		std::string::size_type start = 0;
+		while (start < arg.size())
+		{
+			std::string::size_type end = arg.find(',', start);
+			if (end == std::string::npos)
+			{
+				end = arg.size();
+			}
+			S32 count = atoi(arg.substr(start, end - start).c_str());
+			if (count > 0)
+			{
+				counts.push_back((U32)count);
+			}
+			start = end + 1;
+		}
+	}
+
+	// Returns the elapsed time in seconds to decode every file repeat times.
+	F64 run_batch(const std::vector<std::string>& files, U32 pool_size, S32 repeat)
+	{
+		// Load outside of the timed section, each decode needs its own image.
+		std::vector< LLPointer<LLImageFormatted> > images;
+		for (S32 r = 0; r < repeat; ++r)
+		{
+			for (std::vector<std::string>::const_iterator iter = files.begin();
+				 iter != files.end(); ++iter)
+			{
+				LLPointer<LLImageJ2C> image = new LLImageJ2C;
+				if (image->loadAndValidate(*iter))
+				{
+					images.push_back(image.get());
+				}
+				else if (r == 0)
+				{
+					llwarns << "Unable to load " << *iter << ": " << LLImage::getLastError() << llendl;
+				}
+			}
+		}
+
+		LLImageDecodeThread* decoder = new LLImageDecodeThread(true, pool_size);
+		sDecodesPending = (S32)images.size();
+		sDecodesFailed = 0;
+
+		LLTimer timer;
+		for (std::vector< LLPointer<LLImageFormatted> >::iterator iter = images.begin();
+			 iter != images.end(); ++iter)
+		{
+			decoder->decodeImage(*iter, LLQueuedThread::PRIORITY_NORMAL, 0, FALSE, new BenchResponder);
+		}
+		while (sDecodesPending > 0)
+		{
+			decoder->update(1);
+			ms_sleep(1);
+		}
+		F64 elapsed = timer.getElapsedTimeF64();
+
+		decoder->dumpWorkerStats();
+		decoder->shutdown();
+		delete decoder;
+
+		if (sDecodesFailed > 0)
+		{
+			llwarns << (S32)sDecodesFailed << " decodes failed" << llendl;
+		}
+		return elapsed;
+	}
+
+	LLPointer<LLImageRaw> make_random_image(S32 width, S32 height, S32 components)
+	{
+		LLPointer<LLImageRaw> image = new LLImageRaw(width, height, components);
+		U8* data = image->getData();
+		U32 seed = 12345;
+		for (S32 i = 0; i < image->getDataSize(); i++)
+		{
+			seed = seed * 1664525 + 1013904223;
+			data[i] = (U8)(seed >> 24);
+		}
+		return image;
+	}
+
+	F64 mpixels_per_sec(S32 width, S32 height, S32 repeat, F64 elapsed)
+	{
+		return (F64)width * height * repeat / llmax(elapsed, 0.000001) / 1000000.0;
+	}
+
+	void run_kernels(S32 size, S32 repeat)
+	{
+		const bool use_sse2 = LLImage::getUseSSE2();
+		std::vector<bool> modes;
+		modes.push_back(false);
+		if (LLImage::hasSSE2Kernels())
+		{
+			modes.push_back(true);
+		}
+
+		for (S32 components = 1; components <= 4; ++components)
+		{
+			LLPointer<LLImageRaw> src = make_random_image(size, size, components);
+			LLPointer<LLImageRaw> overlay = make_random_image(size, size, 4);
+			std::vector<U8> mip((size / 2) * (size / 2) * components);
+
+			for (std::vector<bool>::iterator iter = modes.begin(); iter != modes.end(); ++iter)
+			{
+				LLImage::setUseSSE2(*iter);
+
+				LLTimer timer;
+				for (S32 r = 0; r < repeat; ++r)
+				{
+					LLImageBase::generateMip(src->getData(), &mip[0], size / 2, size / 2, components);
+				}
+				F64 mip_time = timer.getElapsedTimeF64();
+
+				// Copies are made outside of the timed section
+				std::vector< LLPointer<LLImageRaw> > copies;
+				for (S32 r = 0; r < repeat; ++r)
+				{
+					copies.push_back(new LLImageRaw(src->getData(), size, size, components));
+				}
+				timer.reset();
+				for (S32 r = 0; r < repeat; ++r)
+				{
+					copies[r]->scale(size * 3 / 4, size * 2 / 3);
+				}
+				F64 scale_time = timer.getElapsedTimeF64();
+
+				std::cout << llformat("%d components, %-6s mip %8.1f Mpix/s, scale %8.1f Mpix/s",
+									  components, *iter ? "SSE2" : "scalar",
+									  mpixels_per_sec(size, size, repeat, mip_time),
+									  mpixels_per_sec(size, size, repeat, scale_time));
+
+				if (components == 3)
+				{
+					LLPointer<LLImageRaw> dst = new LLImageRaw(src->getData(), size, size, components);
+					timer.reset();
+					for (S32 r = 0; r < repeat; ++r)
+					{
+						dst->compositeUnscaled4onto3(overlay);
+					}
+					F64 composite_time = timer.getElapsedTimeF64();
+					std::cout << llformat(", composite %8.1f Mpix/s", mpixels_per_sec(size, size, repeat, composite_time));
+				}
+				std::cout << std::endl;
+			}
+		}
+
+		LLImage::setUseSSE2(use_sse2);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<U32> thread_counts;
+	thread_counts.push_back(1);
+	thread_counts.push_back(2);
+	thread_counts.push_back(4);
+	thread_counts.push_back(8);
+	S32 repeat = 1;
+	S32 kernel_size = 0;
+	std::vector<std::string> files;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg(argv[i]);
+		if (arg == "--threads" && i + 1 < argc)
+		{
+			parse_thread_counts(argv[++i], thread_counts);
+		}
+		else if (arg == "--kernels" && i + 1 < argc)
+		{
+			kernel_size = llmax(2, atoi(argv[++i]));
+		}
+		else if (arg == "--repeat" && i + 1 < argc)
+		{
+			repeat = llmax(1, atoi(argv[++i]));
+		}
+		else
+		{
+			files.push_back(arg);
+		}
+	}
+	if ((files.empty() && !kernel_size) || thread_counts.empty())
+	{
+		std::cerr << "Usage: " << argv[0] << " [--threads 1,2,4,8] [--repeat N] file.j2c [file.j2c ...]" << std::endl;
+		std::cerr << "       " << argv[0] << " --kernels SIZE [--repeat N]" << std::endl;
+		return 1;
+	}
+
+	LLError::initForApplication(".");
+	LLCommon::initClass();
+	LLImage::initClass();
+
+	if (kernel_size)
+	{
+		run_kernels(kernel_size, repeat);
+		LLImage::cleanupClass();
+		LLCommon::cleanupClass();
+		return 0;
+	}
+
+	F64 baseline = 0.0;
+	for (std::vector<U32>::iterator iter = thread_counts.begin();
+		 iter != thread_counts.end(); ++iter)
+	{
+		F64 elapsed = run_batch(files, *iter, repeat);
+		if (baseline == 0.0)
+		{
+			baseline = elapsed;
+		}
+		S32 count = (S32)files.size() * repeat;
+		std::cout << llformat("threads %2d: %6d images in %8.3fs, %8.1f images/s, speedup %.2fx",
+							  *iter, count, elapsed, count / llmax(elapsed, 0.000001),
+							  baseline / llmax(elapsed, 0.000001))
+				  << std::endl;
+	}
+
+	LLImage::cleanupClass();
+	LLCommon::cleanupClass();
+	return 0;
+}
@@ -0,0 +1,274 @@
+/**
+ * @file llinventory_libtest.cpp
+ * @brief Inventory cache save and load benchmark over a synthetic inventory
+ *
+ * $LicenseInfo:firstyear=2011&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2011, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+#include "linden_common.h"
+
+// linden library includes
+#include "llapr.h"
+#include "llcommon.h"
+#include "llerrorcontrol.h"
+#include "llfile.h"
+#include "llinventory.h"
+#include "llinventorycache.h"
+#include "llsys.h"
+#include "lltimer.h"
+
+#include <iostream>
+#include <vector>
+
+// Usage:
+//   llinventory_libtest [--items N] [--folders N] [--dir path]
+//
+// Builds an inventory of --items items spread over --folders folders, then
+// saves and loads it both as the gzipped text cache the viewer used to
+// write and as an LLInventoryCacheFile, reporting the time and file size of
+// each. Loading the binary cache is timed twice: decoding every record, and
+// only looking at item parents, which is what loading costs for folders
+// whose version turns out to be stale.
+
+namespace
+{
+	const S32 CACHE_VERSION = 2;
+
+	typedef std::vector< LLPointer<LLInventoryCategory> > cat_list_t;
+	typedef std::vector< LLPointer<LLInventoryItem> > item_list_t;
+
+	void make_inventory(S32 num_folders, S32 num_items, cat_list_t& cats, item_list_t& items)
+	{
+		LLUUID root_id;
+		root_id.generate();
+		for (S32 i = 0; i < num_folders; ++i)
+		{
+			LLUUID folder_id;
+			folder_id.generate();
+			// a few levels deep, like a real inventory
+			const LLUUID& parent_id = (i < 16) ? root_id : cats[i / 16]->getUUID();
+			cats.push_back(new LLInventoryCategory(folder_id, parent_id, LLFolderType::FT_NONE,
+												   llformat("Folder %d", i)));
+		}
+
+		LLUUID creator_id, owner_id, group_id;
+		creator_id.generate();
+		owner_id.generate();
+		for (S32 i = 0; i < num_items; ++i)
+		{
+			LLUUID item_id, asset_id;
+			item_id.generate();
+			asset_id.generate();
+			LLPermissions perm;
+			perm.init(creator_id, owner_id, creator_id, group_id);
+			U32 base = (i % 3) ? PERM_ALL : (PERM_MOVE | PERM_TRANSFER | PERM_COPY);
+			perm.initMasks(base, base, PERM_NONE, PERM_NONE, base);
+			items.push_back(new LLInventoryItem(item_id, cats[i % num_folders]->getUUID(), perm, asset_id,
+												LLAssetType::AT_OBJECT, LLInventoryType::IT_OBJECT,
+												llformat("Object %d", i), std::string("A synthetic inventory item"),
+												LLSaleInfo::DEFAULT, 0, 1300000000 + i));
+		}
+	}
+
+	S32 file_size(const std::string& filename)
+	{
+		llstat stat_data;
+		return LLFile::stat(filename, &stat_data) ? 0 : (S32)stat_data.st_size;
+	}
+
+	// Same file LLInventoryModel::saveToFile() used to write, gzipped
+	F64 save_text(const std::string& filename, const cat_list_t& cats, const item_list_t& items)
+	{
+		LLTimer timer;
+		LLFILE* fp = LLFile::fopen(filename, "wb");
+		if (!fp)
+		{
+			return -1.0;
+		}
+		fprintf(fp, "\tinv_cache_version\t%d\n", CACHE_VERSION);
+		for (cat_list_t::const_iterator iter = cats.begin(); iter != cats.end(); ++iter)
+		{
+			(*iter)->exportFile(fp);
+		}
+		for (item_list_t::const_iterator iter = items.begin(); iter != items.end(); ++iter)
+		{
+			(*iter)->exportFile(fp);
+		}
+		fclose(fp);
+		gzip_file(filename, filename + ".gz");
+		LLFile::remove(filename);
+		return timer.getElapsedTimeF64();
+	}
+
+	// Same parsing as LLInventoryModel::loadFromFile()
+	F64 load_text(const std::string& filename, S32& num_cats, S32& num_items)
+	{
+		num_cats = num_items = 0;
+		LLTimer timer;
+		if (!gunzip_file(filename + ".gz", filename))
+		{
+			return -1.0;
+		}
+		LLFILE* fp = LLFile::fopen(filename, "rb");
+		if (!fp)
+		{
+			return -1.0;
+		}
+		char buffer[MAX_STRING];		/*Flawfinder: ignore*/
+		char keyword[MAX_STRING];		/*Flawfinder: ignore*/
+		while (!feof(fp) && fgets(buffer, MAX_STRING, fp))
+		{
+			keyword[0] = '\0';
+			sscanf(buffer, " %126s", keyword);	/* Flawfinder: ignore */
+			if (0 == strcmp("inv_category", keyword))
+			{
+				LLPointer<LLInventoryCategory> cat = new LLInventoryCategory;
+				num_cats += cat->importFile(fp) ? 1 : 0;
+			}
+			else if (0 == strcmp("inv_item", keyword))
+			{
+				LLPointer<LLInventoryItem> item = new LLInventoryItem;
+				num_items += item->importFile(fp) ? 1 : 0;
+			}
+		}
+		fclose(fp);
+		LLFile::remove(filename);
+		return timer.getElapsedTimeF64();
+	}
+
+	F64 save_binary(const std::string& filename, const cat_list_t& cats, const item_list_t& items)
+	{
+		LLTimer timer;
+		LLInventoryCacheFile cache_file;
+		LLUUID owner_id;
+		for (cat_list_t::const_iterator iter = cats.begin(); iter != cats.end(); ++iter)
+		{
+			cache_file.addCategory(*iter, owner_id, 1);
+		}
+		for (item_list_t::const_iterator iter = items.begin(); iter != items.end(); ++iter)
+		{
+			cache_file.addItem(*iter);
+		}
+		if (!cache_file.write(filename, CACHE_VERSION))
+		{
+			return -1.0;
+		}
+		return timer.getElapsedTimeF64();
+	}
+
+	F64 load_binary(const std::string& filename, bool decode_items, S32& num_cats, S32& num_items)
+	{
+		num_cats = num_items = 0;
+		LLTimer timer;
+		LLInventoryCacheFile cache_file;
+		bool obsolete = false;
+		if (!cache_file.open(filename, CACHE_VERSION, obsolete))
+		{
+			return -1.0;
+		}
+		for (S32 i = 0; i < cache_file.getCategoryCount(); ++i)
+		{
+			LLPointer<LLInventoryCategory> cat = new LLInventoryCategory;
+			cache_file.readCategory(i, cat);
+			++num_cats;
+		}
+		LLUUID parents;
+		for (S32 i = 0; i < cache_file.getItemCount(); ++i)
+		{
+			if (decode_items)
+			{
+				LLPointer<LLInventoryItem> item = new LLInventoryItem;
+				cache_file.readItem(i, item);
+			}
+			else
+			{
+				// keep the compiler from dropping the lookups
+				parents ^= cache_file.getItemParentID(i);
+			}
+			++num_items;
+		}
+		return timer.getElapsedTimeF64();
+	}
+}
+
+int main(int argc, char** argv)
+{
+	S32 num_items = 250000;
+	S32 num_folders = 2500;
+	std::string dir(".");
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg(argv[i]);
+		if (arg == "--items" && i + 1 < argc)
+		{
+			num_items = llmax(1, atoi(argv[++i]));
+		}
+		else if (arg == "--folders" && i + 1 < argc)
+		{
+			num_folders = llmax(1, atoi(argv[++i]));
+		}
+		else if (arg == "--dir" && i + 1 < argc)
+		{
+			dir = argv[++i];
+		}
+		else
+		{
+			std::cerr << "Usage: " << argv[0] << " [--items N] [--folders N] [--dir path]" << std::endl;
+			return 1;
+		}
+	}
+
+	LLError::initForApplication(".");
+	LLCommon::initClass();
+	ll_init_apr();
+
+	cat_list_t cats;
+	item_list_t items;
+	make_inventory(num_folders, num_items, cats, items);
+
+	std::string text_filename = dir + "/llinventory_libtest.inv";
+	std::string binary_filename = dir + "/llinventory_libtest.inv.bin";
+	S32 loaded_cats = 0;
+	S32 loaded_items = 0;
+
+	std::cout << llformat("%d folders, %d items", num_folders, num_items) << std::endl;
+
+	F64 elapsed = save_text(text_filename, cats, items);
+	std::cout << llformat("text save:           %8.3fs, %10d bytes gzipped", elapsed, file_size(text_filename + ".gz")) << std::endl;
+	elapsed = load_text(text_filename, loaded_cats, loaded_items);
+	std::cout << llformat("text load:           %8.3fs, %d folders, %d items", elapsed, loaded_cats, loaded_items) << std::endl;
+
+	elapsed = save_binary(binary_filename, cats, items);
+	std::cout << llformat("binary save:         %8.3fs, %10d bytes", elapsed, file_size(binary_filename)) << std::endl;
+	elapsed = load_binary(binary_filename, true, loaded_cats, loaded_items);
+	std::cout << llformat("binary load:         %8.3fs, %d folders, %d items", elapsed, loaded_cats, loaded_items) << std::endl;
+	elapsed = load_binary(binary_filename, false, loaded_cats, loaded_items);
+	std::cout << llformat("binary parents only: %8.3fs, %d folders, %d items", elapsed, loaded_cats, loaded_items) << std::endl;
+
+	LLFile::remove(text_filename + ".gz");
+	LLFile::remove(binary_filename);
+
+	cats.clear();
+	items.clear();
+	LLCommon::cleanupClass();
+	return 0;
+}
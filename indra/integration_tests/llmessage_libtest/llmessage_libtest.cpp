@@ -0,0 +1,853 @@
+/**
+ * @file llmessage_libtest.cpp
+ * @brief Replay benchmark for template message decoding through
+ *        LLMessageSystem::checkMessages(), from loopback or straight from
+ *        a packet capture, and a loopback packet blaster for the message
+ *        socket
+ *
+ * $LicenseInfo:firstyear=2011&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2011, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+#include "linden_common.h"
+
+// linden library includes
+#include "llcommon.h"
+#include "llerrorcontrol.h"
+#include "llhost.h"
+#include "llpacketcapture.h"
+#include "llpacketiothread.h"
+#include "llthread.h"
+#include "lltimer.h"
+#include "lluuid.h"
+#include "message.h"
+#include "message_prehash.h"
+#include "net.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+// Usage:
+//   llmessage_libtest [--template message_template.msg] [--port N]
+//                     [--repeat N] [capture ...]
+//
+// Every packet is sent to our own message system over loopback and pumped
+// through LLMessageSystem::checkMessages(), once with the flat template
+// decoder and once with the LLMsgData one, and the wall clock time of each
+// pass is reported.
+//
+// A capture file is either one recorded by the viewer's PacketCaptureFile
+// setting (see llpacketcapture.h), or a sequence of datagrams exactly as
+// they came off the wire, each preceded by its size as a little endian U16.
+// Without one, a
+// region entry like burst of ImprovedTerseObjectUpdate, ObjectUpdateCached
+// and CoarseLocationUpdate messages is synthesized instead. Handlers are
+// registered for those three messages and read every field, like the
+// viewer's own would; other messages in a capture are decoded but have no
+// handler.
+//
+//   llmessage_libtest --blast N [--rate N] [--frame-ms N] [--template ...]
+//
+// Blasts N of those packets at --rate packets a second (0 for as fast as
+// possible) from a second socket on its own thread, while the main thread
+// only pumps checkMessages() between --frame-ms long frames, like the
+// viewer does. It runs once reading the socket directly and once with the
+// socket drained by an LLPacketIOThread, and reports the packets lost to a
+// full socket buffer, the rate they were decoded at, and how many packets
+// each recvmmsg()/sendmmsg() call moved.
+//
+//   llmessage_libtest --replay capture [--repeat N] [--template ...]
+//
+// Plays a PacketCaptureFile capture back through LLPacketRing instead of a
+// socket, as fast as checkMessages() takes the packets, with the recorded
+// senders and packet ids. A circuit is opened for every sender, and
+// ObjectUpdate gets a handler like LLViewerObjectList::processObjectUpdate()
+// besides the three above. It reports the packets a second and the time
+// each checkMessages() call took to expand, decode and dispatch a packet,
+// for each decoder.
+
+namespace
+{
+	typedef std::vector<U8> packet_t;
+	typedef std::vector<packet_t> packet_list_t;
+
+	// Small enough to never overflow the socket receive buffer
+	const S32 SEND_BATCH = 64;
+
+	S32 sFieldsRead = 0;
+
+	void process_terse_update(LLMessageSystem* msg, void**)
+	{
+		U64 region_handle;
+		U16 time_dilation;
+		msg->getU64Fast(_PREHASH_RegionData, _PREHASH_RegionHandle, region_handle);
+		msg->getU16Fast(_PREHASH_RegionData, _PREHASH_TimeDilation, time_dilation);
+		U8 data[MTUBYTES];
+		S32 count = msg->getNumberOfBlocksFast(_PREHASH_ObjectData);
+		for (S32 i = 0; i < count; ++i)
+		{
+			S32 size = msg->getSizeFast(_PREHASH_ObjectData, i, _PREHASH_Data);
+			msg->getBinaryDataFast(_PREHASH_ObjectData, _PREHASH_Data, data, size, i, sizeof(data));
+			size = msg->getSizeFast(_PREHASH_ObjectData, i, _PREHASH_TextureEntry);
+			msg->getBinaryDataFast(_PREHASH_ObjectData, _PREHASH_TextureEntry, data, size, i, sizeof(data));
+		}
+		sFieldsRead += 2 + count * 4;
+	}
+
+	void process_cached_update(LLMessageSystem* msg, void**)
+	{
+		U64 region_handle;
+		U16 time_dilation;
+		msg->getU64Fast(_PREHASH_RegionData, _PREHASH_RegionHandle, region_handle);
+		msg->getU16Fast(_PREHASH_RegionData, _PREHASH_TimeDilation, time_dilation);
+		S32 count = msg->getNumberOfBlocksFast(_PREHASH_ObjectData);
+		for (S32 i = 0; i < count; ++i)
+		{
+			U32 id, crc, flags;
+			msg->getU32Fast(_PREHASH_ObjectData, _PREHASH_ID, id, i);
+			msg->getU32Fast(_PREHASH_ObjectData, _PREHASH_CRC, crc, i);
+			msg->getU32Fast(_PREHASH_ObjectData, _PREHASH_UpdateFlags, flags, i);
+		}
+		sFieldsRead += 2 + count * 3;
+	}
+
+	// Reads the fields LLViewerObjectList::processObjectUpdate() and
+	// LLViewerObject::processUpdateMessage() do for a full update
+	void process_object_update(LLMessageSystem* msg, void**)
+	{
+		U64 region_handle;
+		U16 time_dilation;
+		msg->getU64Fast(_PREHASH_RegionData, _PREHASH_RegionHandle, region_handle);
+		msg->getU16Fast(_PREHASH_RegionData, _PREHASH_TimeDilation, time_dilation);
+		U8 data[MTUBYTES];
+		char text[MTUBYTES];
+		S32 count = msg->getNumberOfBlocksFast(_PREHASH_ObjectData);
+		for (S32 i = 0; i < count; ++i)
+		{
+			U32 local_id, crc, parent_id, flags;
+			U8 state, pcode, material, click_action, sound_flags, joint_type;
+			LLUUID full_id, sound_id, owner_id;
+			LLVector3 scale, joint_pivot, joint_axis;
+			F32 gain, radius;
+			msg->getU32Fast(_PREHASH_ObjectData, _PREHASH_ID, local_id, i);
+			msg->getU8Fast(_PREHASH_ObjectData, _PREHASH_State, state, i);
+			msg->getUUIDFast(_PREHASH_ObjectData, _PREHASH_FullID, full_id, i);
+			msg->getU32Fast(_PREHASH_ObjectData, _PREHASH_CRC, crc, i);
+			msg->getU8Fast(_PREHASH_ObjectData, _PREHASH_PCode, pcode, i);
+			msg->getU8Fast(_PREHASH_ObjectData, _PREHASH_Material, material, i);
+			msg->getU8Fast(_PREHASH_ObjectData, _PREHASH_ClickAction, click_action, i);
+			msg->getVector3Fast(_PREHASH_ObjectData, _PREHASH_Scale, scale, i);
+			msg->getU32Fast(_PREHASH_ObjectData, _PREHASH_ParentID, parent_id, i);
+			msg->getU32Fast(_PREHASH_ObjectData, _PREHASH_UpdateFlags, flags, i);
+
+			// the volume parameters
+			U8 u8s[7];
+			S8 s8s[6];
+			U16 u16s[5];
+			msg->getU8Fast(_PREHASH_ObjectData, _PREHASH_PathCurve, u8s[0], i);
+			msg->getU8Fast(_PREHASH_ObjectData, _PREHASH_ProfileCurve, u8s[1], i);
+			msg->getU16Fast(_PREHASH_ObjectData, _PREHASH_PathBegin, u16s[0], i);
+			msg->getU16Fast(_PREHASH_ObjectData, _PREHASH_PathEnd, u16s[1], i);
+			msg->getU8Fast(_PREHASH_ObjectData, _PREHASH_PathScaleX, u8s[2], i);
+			msg->getU8Fast(_PREHASH_ObjectData, _PREHASH_PathScaleY, u8s[3], i);
+			msg->getU8Fast(_PREHASH_ObjectData, _PREHASH_PathShearX, u8s[4], i);
+			msg->getU8Fast(_PREHASH_ObjectData, _PREHASH_PathShearY, u8s[5], i);
+			msg->getS8Fast(_PREHASH_ObjectData, _PREHASH_PathTwist, s8s[0], i);
+			msg->getS8Fast(_PREHASH_ObjectData, _PREHASH_PathTwistBegin, s8s[1], i);
+			msg->getS8Fast(_PREHASH_ObjectData, _PREHASH_PathRadiusOffset, s8s[2], i);
+			msg->getS8Fast(_PREHASH_ObjectData, _PREHASH_PathTaperX, s8s[3], i);
+			msg->getS8Fast(_PREHASH_ObjectData, _PREHASH_PathTaperY, s8s[4], i);
+			msg->getU8Fast(_PREHASH_ObjectData, _PREHASH_PathRevolutions, u8s[6], i);
+			msg->getS8Fast(_PREHASH_ObjectData, _PREHASH_PathSkew, s8s[5], i);
+			msg->getU16Fast(_PREHASH_ObjectData, _PREHASH_ProfileBegin, u16s[2], i);
+			msg->getU16Fast(_PREHASH_ObjectData, _PREHASH_ProfileEnd, u16s[3], i);
+			msg->getU16Fast(_PREHASH_ObjectData, _PREHASH_ProfileHollow, u16s[4], i);
+
+			const char* binary_fields[] = { _PREHASH_ObjectData, _PREHASH_TextureEntry,
+											_PREHASH_TextureAnim, _PREHASH_Data,
+											_PREHASH_TextColor, _PREHASH_PSBlock,
+											_PREHASH_ExtraParams };
+			for (U32 f = 0; f < LL_ARRAY_SIZE(binary_fields); ++f)
+			{
+				S32 size = msg->getSizeFast(_PREHASH_ObjectData, i, binary_fields[f]);
+				if (size > 0)
+				{
+					msg->getBinaryDataFast(_PREHASH_ObjectData, binary_fields[f], data, size, i, sizeof(data));
+				}
+			}
+			msg->getStringFast(_PREHASH_ObjectData, _PREHASH_NameValue, sizeof(text), text, i);
+			msg->getStringFast(_PREHASH_ObjectData, _PREHASH_Text, sizeof(text), text, i);
+			msg->getStringFast(_PREHASH_ObjectData, _PREHASH_MediaURL, sizeof(text), text, i);
+
+			msg->getUUIDFast(_PREHASH_ObjectData, _PREHASH_Sound, sound_id, i);
+			msg->getUUIDFast(_PREHASH_ObjectData, _PREHASH_OwnerID, owner_id, i);
+			msg->getF32Fast(_PREHASH_ObjectData, _PREHASH_Gain, gain, i);
+			msg->getU8Fast(_PREHASH_ObjectData, _PREHASH_Flags, sound_flags, i);
+			msg->getF32Fast(_PREHASH_ObjectData, _PREHASH_Radius, radius, i);
+			msg->getU8Fast(_PREHASH_ObjectData, _PREHASH_JointType, joint_type, i);
+			msg->getVector3Fast(_PREHASH_ObjectData, _PREHASH_JointPivot, joint_pivot, i);
+			msg->getVector3Fast(_PREHASH_ObjectData, _PREHASH_JointAxisOrAnchor, joint_axis, i);
+		}
+		sFieldsRead += 2 + count * 46;
+	}
+
+	void process_coarse_location(LLMessageSystem* msg, void**)
+	{
+		S16 you, prey;
+		msg->getS16Fast(_PREHASH_Index, _PREHASH_You, you);
+		msg->getS16Fast(_PREHASH_Index, _PREHASH_Prey, prey);
+		S32 count = msg->getNumberOfBlocksFast(_PREHASH_Location);
+		for (S32 i = 0; i < count; ++i)
+		{
+			U8 x, y, z;
+			LLUUID agent_id;
+			msg->getU8Fast(_PREHASH_Location, _PREHASH_X, x, i);
+			msg->getU8Fast(_PREHASH_Location, _PREHASH_Y, y, i);
+			msg->getU8Fast(_PREHASH_Location, _PREHASH_Z, z, i);
+			if (i < msg->getNumberOfBlocksFast(_PREHASH_AgentData))
+			{
+				msg->getUUIDFast(_PREHASH_AgentData, _PREHASH_AgentID, agent_id, i);
+			}
+		}
+		sFieldsRead += 2 + count * 4;
+	}
+
+	// Sends the message currently being built in gMessageSystem to ourselves
+	// and picks the datagram straight off the socket, before checkMessages()
+	// can see it.
+	bool add_built_packet(packet_list_t& packets, const LLHost& self)
+	{
+		gMessageSystem->sendMessage(self);
+		packet_t packet(MAX_BUFFER_SIZE, 0);
+		for (S32 tries = 0; tries < 100; ++tries)
+		{
+			S32 size = receive_packet(gMessageSystem->mSocket, (char*)&packet[0]);
+			if (size > 0)
+			{
+				packet.resize(size);
+				packets.push_back(packet);
+				return true;
+			}
+			ms_sleep(1);
+		}
+		return false;
+	}
+
+	bool synthesize_packets(packet_list_t& packets, S32 count, const LLHost& self)
+	{
+		const U64 region_handle = 0x000F4240000F4240ULL;
+		U8 object_data[60];
+		U8 texture_entry[48];
+		for (U32 i = 0; i < sizeof(object_data); ++i)
+		{
+			object_data[i] = (U8)(i * 7);
+		}
+		for (U32 i = 0; i < sizeof(texture_entry); ++i)
+		{
+			texture_entry[i] = (U8)(i * 13);
+		}
+
+		for (S32 n = 0; n < count; ++n)
+		{
+			switch (n % 4)
+			{
+			case 0:
+			case 1:
+				gMessageSystem->newMessageFast(_PREHASH_ImprovedTerseObjectUpdate);
+				gMessageSystem->nextBlockFast(_PREHASH_RegionData);
+				gMessageSystem->addU64Fast(_PREHASH_RegionHandle, region_handle);
+				gMessageSystem->addU16Fast(_PREHASH_TimeDilation, 65535);
+				for (S32 i = 0; i < 8; ++i)
+				{
+					gMessageSystem->nextBlockFast(_PREHASH_ObjectData);
+					gMessageSystem->addBinaryDataFast(_PREHASH_Data, object_data, sizeof(object_data));
+					gMessageSystem->addBinaryDataFast(_PREHASH_TextureEntry, texture_entry, (i & 1) ? sizeof(texture_entry) : 0);
+				}
+				break;
+			case 2:
+				gMessageSystem->newMessageFast(_PREHASH_ObjectUpdateCached);
+				gMessageSystem->nextBlockFast(_PREHASH_RegionData);
+				gMessageSystem->addU64Fast(_PREHASH_RegionHandle, region_handle);
+				gMessageSystem->addU16Fast(_PREHASH_TimeDilation, 65535);
+				for (S32 i = 0; i < 40; ++i)
+				{
+					gMessageSystem->nextBlockFast(_PREHASH_ObjectData);
+					gMessageSystem->addU32Fast(_PREHASH_ID, n * 40 + i);
+					gMessageSystem->addU32Fast(_PREHASH_CRC, 0x12345678 ^ i);
+					gMessageSystem->addU32Fast(_PREHASH_UpdateFlags, i);
+				}
+				break;
+			default:
+				gMessageSystem->newMessageFast(_PREHASH_CoarseLocationUpdate);
+				for (S32 i = 0; i < 20; ++i)
+				{
+					gMessageSystem->nextBlockFast(_PREHASH_Location);
+					gMessageSystem->addU8Fast(_PREHASH_X, (U8)i);
+					gMessageSystem->addU8Fast(_PREHASH_Y, (U8)(i * 2));
+					gMessageSystem->addU8Fast(_PREHASH_Z, (U8)(i * 3));
+				}
+				gMessageSystem->nextBlockFast(_PREHASH_Index);
+				gMessageSystem->addS16Fast(_PREHASH_You, 0);
+				gMessageSystem->addS16Fast(_PREHASH_Prey, -1);
+				for (S32 i = 0; i < 20; ++i)
+				{
+					gMessageSystem->nextBlockFast(_PREHASH_AgentData);
+					gMessageSystem->addUUIDFast(_PREHASH_AgentID, LLUUID::generateNewID());
+				}
+				break;
+			}
+			if (!add_built_packet(packets, self))
+			{
+				llwarns << "Loopback packet was lost" << llendl;
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool load_capture(const std::string& filename, packet_list_t& packets)
+	{
+		std::ifstream file(filename.c_str(), std::ios::in | std::ios::binary);
+		if (!file.is_open())
+		{
+			return false;
+		}
+		char magic[sizeof(LLPacketCaptureReader::MAGIC)];	/* Flawfinder: ignore */
+		if (file.read(magic, sizeof(magic))
+			&& !memcmp(magic, LLPacketCaptureReader::MAGIC, sizeof(magic)))
+		{
+			// recorded by the viewer
+			file.close();
+			LLPacketCaptureReader reader;
+			if (!reader.open(filename))
+			{
+				return false;
+			}
+			packet_t packet(MAX_BUFFER_SIZE);
+			LLHost sender;
+			U64 time;
+			S32 size;
+			while ((size = reader.readPacket((char*)&packet[0], sender, time)) > 0)
+			{
+				packets.push_back(packet_t(packet.begin(), packet.begin() + size));
+			}
+			return true;
+		}
+		file.clear();
+		file.seekg(0);
+		while (1)
+		{
+			U8 size_bytes[2];
+			if (!file.read((char*)size_bytes, 2))
+			{
+				break;
+			}
+			S32 size = size_bytes[0] | (size_bytes[1] << 8);
+			if (size < (S32)LL_MINIMUM_VALID_PACKET_SIZE || size > MAX_BUFFER_SIZE)
+			{
+				llwarns << filename << ": bad packet size " << size << llendl;
+				return false;
+			}
+			packet_t packet(size);
+			if (!file.read((char*)&packet[0], size))
+			{
+				llwarns << filename << ": truncated packet" << llendl;
+				return false;
+			}
+			packets.push_back(packet);
+		}
+		return true;
+	}
+
+	// Copies packet into buffer with a fresh id, so the circuit sees a clean
+	// sequence
+	void copy_with_packet_id(U8* buffer, const packet_t& packet, TPACKETID packet_id)
+	{
+		memcpy(buffer, &packet[0], packet.size());	/* Flawfinder: ignore */
+		buffer[PHL_FLAGS] &= ~(LL_RELIABLE_FLAG | LL_RESENT_FLAG | LL_ACK_FLAG);
+		buffer[PHL_PACKET_ID] = (U8)(packet_id >> 24);
+		buffer[PHL_PACKET_ID + 1] = (U8)(packet_id >> 16);
+		buffer[PHL_PACKET_ID + 2] = (U8)(packet_id >> 8);
+		buffer[PHL_PACKET_ID + 3] = (U8)packet_id;
+	}
+
+	// Sends every packet to ourselves repeat times and pumps checkMessages()
+	// until they have all been received. Returns the elapsed seconds, or a
+	// negative value if packets went missing.
+	F64 run_pass(const packet_list_t& packets, S32 repeat, const LLHost& self, TPACKETID& packet_id)
+	{
+		const U32 total = packets.size() * repeat;
+		const U32 start_packets_in = gMessageSystem->mPacketsIn;
+		U32 sent = 0;
+		packet_t buffer(MAX_BUFFER_SIZE);
+
+		LLTimer timer;
+		for (S32 r = 0; r < repeat; ++r)
+		{
+			for (packet_list_t::const_iterator iter = packets.begin(); iter != packets.end(); ++iter)
+			{
+				const packet_t& packet = *iter;
+				copy_with_packet_id(&buffer[0], packet, packet_id++);
+				send_packet(gMessageSystem->mSocket, (char*)&buffer[0], packet.size(), self.getAddress(), self.getPort());
+
+				if (++sent % SEND_BATCH == 0)
+				{
+					while (gMessageSystem->checkMessages())
+					{
+					}
+				}
+			}
+		}
+
+		LLTimer drain_timer;
+		while (gMessageSystem->mPacketsIn - start_packets_in < total
+			   && drain_timer.getElapsedTimeF64() < 5.0)
+		{
+			while (gMessageSystem->checkMessages())
+			{
+			}
+		}
+		F64 elapsed = timer.getElapsedTimeF64();
+		gMessageSystem->processAcks();
+
+		U32 received = gMessageSystem->mPacketsIn - start_packets_in;
+		if (received < total)
+		{
+			llwarns << "Only " << received << " of " << total << " packets arrived" << llendl;
+			return -1.0;
+		}
+		return elapsed;
+	}
+
+	// Sends packets from its own socket as fast as --rate allows, through
+	// a network thread of its own where there is one.
+	class Blaster : public LLThread
+	{
+	public:
+		Blaster(const packet_list_t& packets, S32 count, S32 rate, S32 socket,
+				LLPacketIOThread* io_thread, const LLHost& target, TPACKETID first_id)
+		:	LLThread("Blaster"),
+			mPackets(packets),
+			mCount(count),
+			mRate(rate),
+			mSocket(socket),
+			mIOThread(io_thread),
+			mTarget(target),
+			mFirstID(first_id)
+		{
+		}
+
+	protected:
+		/*virtual*/ void run()
+		{
+			packet_t buffer(MAX_BUFFER_SIZE);
+			LLTimer timer;
+			for (S32 n = 0; n < mCount && !isQuitting(); ++n)
+			{
+				const packet_t& packet = mPackets[n % mPackets.size()];
+				copy_with_packet_id(&buffer[0], packet, mFirstID + n);
+				if (mIOThread)
+				{
+					while (!mIOThread->queuePacket((char*)&buffer[0], packet.size(), mTarget))
+					{
+						if (isQuitting())
+						{
+							return;
+						}
+						yield();
+					}
+				}
+				else
+				{
+					// nothing else sends while we run, so the destination
+					// address send_packet() keeps is ours
+					send_packet(mSocket, (char*)&buffer[0], packet.size(), mTarget.getAddress(), mTarget.getPort());
+				}
+
+				if (mRate > 0 && (n + 1) % SEND_BATCH == 0)
+				{
+					F64 ahead = (F64)(n + 1) / mRate - timer.getElapsedTimeF64();
+					if (ahead > 0.0)
+					{
+						ms_sleep((U32)(ahead * 1000.0));
+					}
+				}
+			}
+		}
+
+	private:
+		const packet_list_t& mPackets;
+		S32 mCount;
+		S32 mRate;
+		S32 mSocket;
+		LLPacketIOThread* mIOThread;
+		LLHost mTarget;
+		TPACKETID mFirstID;
+	};
+
+	// Blasts count packets at ourselves from blaster_socket while the main
+	// thread sleeps frame_ms between calls to checkMessages().
+	void run_blast(const packet_list_t& packets, S32 count, S32 rate, S32 frame_ms,
+				   S32 blaster_socket, const LLHost& self, TPACKETID& packet_id,
+				   bool use_io_thread)
+	{
+		const char* name = use_io_thread ? "io thread" : "direct";
+		if (use_io_thread)
+		{
+			gMessageSystem->mPacketRing.startIOThread(gMessageSystem->mSocket);
+			if (!gMessageSystem->mPacketRing.getIOThread())
+			{
+				std::cout << name << ": no batched socket calls on this platform" << std::endl;
+				return;
+			}
+		}
+
+		LLPacketIOThread* blaster_io = NULL;
+		if (LLPacketIOThread::isAvailable())
+		{
+			blaster_io = new LLPacketIOThread(blaster_socket);
+			blaster_io->start();
+		}
+		Blaster blaster(packets, count, rate, blaster_socket, blaster_io, self, packet_id);
+		packet_id += count;
+
+		const U32 start_packets_in = gMessageSystem->mPacketsIn;
+		S32 frames = 0;
+		LLTimer timer;
+		LLTimer drain_timer;
+		F64 elapsed = 0.0;
+		blaster.start();
+		while (1)
+		{
+			U32 last_packets_in = gMessageSystem->mPacketsIn;
+			while (gMessageSystem->checkMessages())
+			{
+			}
+			if (gMessageSystem->mPacketsIn != last_packets_in)
+			{
+				// up to the last packet, not the wait for stragglers
+				elapsed = timer.getElapsedTimeF64();
+			}
+
+			if (!blaster.isStopped())
+			{
+				drain_timer.reset();
+			}
+			else if (gMessageSystem->mPacketsIn - start_packets_in >= (U32)count
+					 || drain_timer.getElapsedTimeF64() > 0.5)
+			{
+				break;
+			}
+			// a long frame
+			ms_sleep(frame_ms);
+			++frames;
+		}
+
+		U32 received = gMessageSystem->mPacketsIn - start_packets_in;
+		std::string batching;
+		LLPacketIOThread* io_thread = gMessageSystem->mPacketRing.getIOThread();
+		if (io_thread && blaster_io)
+		{
+			batching = llformat(", %.1f packets/recvmmsg, %.1f packets/sendmmsg",
+								(F32)io_thread->getPacketsReceived() / llmax(1U, (U32)io_thread->getReceiveCalls()),
+								(F32)blaster_io->getPacketsSent() / llmax(1U, (U32)blaster_io->getSendCalls()));
+		}
+		std::cout << llformat("%-10s %7u of %7d packets received, %6d lost, %d frames, %10.0f packets/s",
+							  name, received, count, count - (S32)received, frames,
+							  received / llmax(elapsed, 0.000001))
+				  << batching << std::endl;
+
+		delete blaster_io;
+		gMessageSystem->mPacketRing.stopIOThread();
+		// leave nothing behind for the next pass
+		while (gMessageSystem->checkMessages())
+		{
+		}
+	}
+
+	// Plays the capture the packet ring is replaying through checkMessages()
+	// repeat times, on fresh circuits each time, so every pass sees the
+	// packet ids the same way. Returns the elapsed seconds.
+	F64 run_replay(S32 repeat, F64 clocks_per_usec, const char* name)
+	{
+		LLPacketCaptureReader* reader = gMessageSystem->mPacketRing.getReplay();
+		const std::vector<LLHost>& senders = reader->getSenders();
+		std::vector<F32> latencies;
+		latencies.reserve(reader->getPacketCount() * repeat);
+		const U32 start_packets_in = gMessageSystem->mPacketsIn;
+		sFieldsRead = 0;
+
+		LLTimer timer;
+		for (S32 r = 0; r < repeat; ++r)
+		{
+			for (std::vector<LLHost>::const_iterator iter = senders.begin(); iter != senders.end(); ++iter)
+			{
+				gMessageSystem->mCircuitInfo.removeCircuitData(*iter);
+				gMessageSystem->enableCircuit(*iter, TRUE);
+			}
+			reader->rewind();
+			while (!reader->atEnd())
+			{
+				U64 start = LLTimer::getCurrentClockCount();
+				gMessageSystem->checkMessages();
+				latencies.push_back((F32)((LLTimer::getCurrentClockCount() - start) / clocks_per_usec));
+			}
+		}
+		F64 elapsed = timer.getElapsedTimeF64();
+		gMessageSystem->processAcks();
+
+		U32 decoded = gMessageSystem->mPacketsIn - start_packets_in;
+		F64 total_usec = 0.0;
+		for (std::vector<F32>::iterator iter = latencies.begin(); iter != latencies.end(); ++iter)
+		{
+			total_usec += *iter;
+		}
+		std::sort(latencies.begin(), latencies.end());
+		F32 p50 = latencies.empty() ? 0.f : latencies[latencies.size() / 2];
+		F32 p99 = latencies.empty() ? 0.f : latencies[latencies.size() * 99 / 100];
+		F32 worst = latencies.empty() ? 0.f : latencies.back();
+		std::cout << llformat("%-10s %7u packets in %8.3fs, %10.0f packets/s, %d fields read, "
+							  "usec/packet mean %.2f p50 %.2f p99 %.2f max %.1f",
+							  name, decoded, elapsed, decoded / llmax(elapsed, 0.000001), sFieldsRead,
+							  total_usec / llmax(1U, (U32)latencies.size()), p50, p99, worst)
+				  << std::endl;
+		return elapsed;
+	}
+
+	int replay_capture(const std::string& filename, S32 repeat)
+	{
+		LLPacketCaptureReader* reader = new LLPacketCaptureReader;
+		if (!reader->open(filename) || !reader->getPacketCount())
+		{
+			std::cerr << "Unable to replay " << filename << std::endl;
+			delete reader;
+			return 1;
+		}
+
+		U32 zero_coded = 0;
+		U32 bytes = 0;
+		packet_t packet(MAX_BUFFER_SIZE);
+		LLHost sender;
+		U64 time = 0;
+		S32 size;
+		while ((size = reader->readPacket((char*)&packet[0], sender, time)) > 0)
+		{
+			bytes += size;
+			if (packet[PHL_FLAGS] & LL_ZERO_CODE_FLAG)
+			{
+				zero_coded++;
+			}
+		}
+		std::cout << llformat("%s: %u packets, %u bytes, %u zero coded, from %u hosts over %.1fs",
+							  filename.c_str(), reader->getPacketCount(), bytes, zero_coded,
+							  (U32)reader->getSenders().size(), time / 1000000.0)
+				  << std::endl;
+
+		gMessageSystem->mPacketRing.startReplay(reader);
+		F64 clocks_per_usec = calc_clock_frequency(50) / 1000000.0;
+
+		// Warm up the arena and the caches
+		run_replay(1, clocks_per_usec, "warm up");
+
+		const BOOL modes[] = { FALSE, TRUE };
+		const char* mode_names[] = { "LLMsgData", "flat" };
+		F64 baseline = 0.0;
+		for (U32 m = 0; m < LL_ARRAY_SIZE(modes); ++m)
+		{
+			gMessageSystem->setFlatTemplateDecode(modes[m]);
+			F64 elapsed = run_replay(repeat, clocks_per_usec, mode_names[m]);
+			if (baseline == 0.0)
+			{
+				baseline = elapsed;
+			}
+			std::cout << llformat("%-10s speedup %.2fx", "", baseline / llmax(elapsed, 0.000001)) << std::endl;
+		}
+		std::cout << gMessageSystem->mPacketRing.getReplayPacketsDropped()
+				  << " acks and replies were not sent" << std::endl;
+
+		gMessageSystem->mPacketRing.stopReplay();
+		return 0;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::string template_file("message_template.msg");
+	U32 port = 13060;
+	S32 repeat = 10;
+	S32 blast = 0;
+	S32 rate = 5000;
+	S32 frame_ms = 50;
+	std::string replay;
+	std::vector<std::string> captures;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg(argv[i]);
+		if (arg == "--template" && i + 1 < argc)
+		{
+			template_file = argv[++i];
+		}
+		else if (arg == "--port" && i + 1 < argc)
+		{
+			port = (U32)atoi(argv[++i]);
+		}
+		else if (arg == "--repeat" && i + 1 < argc)
+		{
+			repeat = llmax(1, atoi(argv[++i]));
+		}
+		else if (arg == "--blast" && i + 1 < argc)
+		{
+			blast = llmax(1, atoi(argv[++i]));
+		}
+		else if (arg == "--rate" && i + 1 < argc)
+		{
+			rate = llmax(0, atoi(argv[++i]));
+		}
+		else if (arg == "--frame-ms" && i + 1 < argc)
+		{
+			frame_ms = llmax(0, atoi(argv[++i]));
+		}
+		else if (arg == "--replay" && i + 1 < argc)
+		{
+			replay = argv[++i];
+		}
+		else if (arg[0] == '-')
+		{
+			std::cerr << "Usage: " << argv[0] << " [--template message_template.msg] [--port N] [--repeat N] [capture ...]\n"
+					  << "       " << argv[0] << " --blast N [--rate N] [--frame-ms N] [--template message_template.msg]\n"
+					  << "       " << argv[0] << " --replay capture [--repeat N] [--template message_template.msg]" << std::endl;
+			return 1;
+		}
+		else
+		{
+			captures.push_back(arg);
+		}
+	}
+
+	LLError::initForApplication(".");
+	// Unhandled messages in a capture would otherwise warn on every packet
+	LLError::setDefaultLevel(LLError::LEVEL_ERROR);
+	LLCommon::initClass();
+
+	if (!start_messaging_system(template_file, port, 1, 0, 0, FALSE, std::string(), NULL, false, 5.f, 100.f))
+	{
+		std::cerr << "Unable to start the message system with " << template_file
+				  << ", error " << gMessageSystem->getErrorCode() << std::endl;
+		LLCommon::cleanupClass();
+		return 1;
+	}
+	gMessageSystem->setMaxMessageCounts(-1);
+	gMessageSystem->setMaxMessageTime(-1.f);
+	gMessageSystem->setHandlerFuncFast(_PREHASH_ImprovedTerseObjectUpdate, process_terse_update);
+	gMessageSystem->setHandlerFuncFast(_PREHASH_ObjectUpdateCached, process_cached_update);
+	gMessageSystem->setHandlerFuncFast(_PREHASH_CoarseLocationUpdate, process_coarse_location);
+	gMessageSystem->setHandlerFuncFast(_PREHASH_ObjectUpdate, process_object_update);
+
+	if (!replay.empty())
+	{
+		int result = replay_capture(replay, repeat);
+		end_messaging_system(false);
+		LLCommon::cleanupClass();
+		return result;
+	}
+
+	LLHost self("127.0.0.1", gMessageSystem->getListenPort());
+	gMessageSystem->enableCircuit(self, TRUE);
+
+	packet_list_t packets;
+	if (captures.empty())
+	{
+		if (!synthesize_packets(packets, 1000, self))
+		{
+			packets.clear();
+		}
+	}
+	for (std::vector<std::string>::iterator iter = captures.begin(); iter != captures.end(); ++iter)
+	{
+		if (!load_capture(*iter, packets))
+		{
+			std::cerr << "Unable to read capture " << *iter << std::endl;
+		}
+	}
+	if (packets.empty())
+	{
+		end_messaging_system(false);
+		LLCommon::cleanupClass();
+		return 1;
+	}
+
+	TPACKETID packet_id = 1;
+	if (blast)
+	{
+		S32 blaster_socket = -1;
+		int blaster_port = NET_USE_OS_ASSIGNED_PORT;
+		if (start_net(blaster_socket, blaster_port))
+		{
+			std::cerr << "Unable to open the blaster socket" << std::endl;
+			end_messaging_system(false);
+			LLCommon::cleanupClass();
+			return 1;
+		}
+		gMessageSystem->enableCircuit(LLHost("127.0.0.1", blaster_port), TRUE);
+
+		std::cout << llformat("Blasting %d packets at %d packets/s, %d ms frames", blast, rate, frame_ms) << std::endl;
+		run_blast(packets, blast, rate, frame_ms, blaster_socket, self, packet_id, false);
+		run_blast(packets, blast, rate, frame_ms, blaster_socket, self, packet_id, true);
+
+		end_net(blaster_socket);
+		end_messaging_system(false);
+		LLCommon::cleanupClass();
+		return 0;
+	}
+
+	// Warm up the socket, the arena and the caches
+	run_pass(packets, 1, self, packet_id);
+
+	const BOOL modes[] = { FALSE, TRUE };
+	const char* mode_names[] = { "LLMsgData", "flat" };
+	F64 baseline = 0.0;
+	for (U32 m = 0; m < LL_ARRAY_SIZE(modes); ++m)
+	{
+		gMessageSystem->setFlatTemplateDecode(modes[m]);
+		sFieldsRead = 0;
+		F64 elapsed = run_pass(packets, repeat, self, packet_id);
+		if (elapsed < 0.0)
+		{
+			std::cout << mode_names[m] << ": packets were dropped, try a smaller --repeat" << std::endl;
+			continue;
+		}
+		if (baseline == 0.0)
+		{
+			baseline = elapsed;
+		}
+		S32 count = (S32)packets.size() * repeat;
+		std::cout << llformat("%-10s %7d packets in %8.3fs, %10.0f packets/s, %d fields read, speedup %.2fx",
+							  mode_names[m], count, elapsed, count / llmax(elapsed, 0.000001),
+							  sFieldsRead, baseline / llmax(elapsed, 0.000001))
+				  << std::endl;
+	}
+
+	end_messaging_system(false);
+	LLCommon::cleanupClass();
+	return 0;
+}
@@ -0,0 +1,701 @@
+/**
+ * @file lloctree_libtest.cpp
+ * @brief Frustum culling synthetic octrees one partition at a time and spread over scheduler workers,
+ * and moving drawables around in them
+ *
+ * $LicenseInfo:firstyear=2011&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2011, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+#include "linden_common.h"
+
+// linden library includes
+#include "llapr.h"
+#include "llcamera.h"
+#include "llcommon.h"
+#include "llerrorcontrol.h"
+#include "llpointer.h"
+#include "llrefcount.h"
+#include "v3dmath.h"
+#include "lloctree.h"
+#include "llqueuedthread.h"
+#include "llthreadscheduler.h"
+#include "lltimer.h"
+
+#include <iostream>
+#include <vector>
+
+// Usage:
+//   lloctree_libtest [--drawables N] [--regions N] [--partitions N] [--threads N] [--frames N]
+//                    [--moves N]
+//
+// Scatters --drawables boxes over --regions regions of --partitions octrees
+// each, the way LLViewerRegion keeps one LLSpatialPartition per kind of
+// drawable. Then --frames cameras turning in a circle above the middle of
+// the regions are culled against every octree: once a partition at a time
+// on the main thread, the way LLPipeline::updateCull() does without a cull
+// thread, and once with the frustum passes queued on --threads scheduler
+// workers and the results taken in partition order, as LLSpatialCullThread
+// does. The groups and drawables found must be the same both ways.
+//
+// The frustum pass follows LLOctreeCull::record() and the second pass only
+// counts what replay() would hand to the pipeline, since the rest of it
+// needs GL.
+//
+// Then for --frames frames --moves drawables drift a little, the way
+// vehicles and physical objects do, and are moved in their octree like
+// LLSpatialPartition::move() does, pruning what they left behind. One in ten
+// of them is instead removed and put back somewhere else in its region, like
+// an object being derezzed and another rezzed. Every octree is balanced at
+// the end of each frame, as LLPipeline::updateMove() does. Afterwards every
+// drawable must still be in the node that holds it, and no empty node may
+// be left behind.
+
+namespace
+{
+	const F32 REGION_WIDTH = 256.f;
+
+	// a cheap LCG so every run builds the same scene
+	class Random
+	{
+	public:
+		Random(U32 seed) : mSeed(seed) {}
+
+		F32 next(F32 min, F32 max)
+		{
+			mSeed = mSeed * 1664525 + 1013904223;
+			return min + (max - min) * (F32)(mSeed >> 8) / (F32)(1 << 24);
+		}
+
+	private:
+		U32 mSeed;
+	};
+
+	class Partition;
+
+	// What the octree needs of an LLDrawable
+	class Drawable : public LLRefCount
+	{
+	public:
+		Drawable(Partition* part, const LLVector3& center, F32 radius)
+		:	mPartition(part), mNode(NULL), mBinIndex(-1), mBinRadius(radius)
+		{
+			setPosition(center);
+		}
+
+		const LLVector3d& getPositionGroup() const	{ return mPositionGroup; }
+		F64 getBinRadius() const					{ return mBinRadius; }
+		S32 getBinIndex() const						{ return mBinIndex; }
+		void setBinIndex(S32 index)					{ mBinIndex = index; }
+
+		void setPosition(const LLVector3& center)
+		{
+			mPositionGroup.setVec(center);
+			LLVector3 size((F32)mBinRadius, (F32)mBinRadius, (F32)mBinRadius);
+			mExtents[0] = center - size;
+			mExtents[1] = center + size;
+		}
+
+		Partition* mPartition;
+		LLOctreeNode<Drawable>* mNode; // LLDrawable::mSpatialGroupp
+		S32 mBinIndex;
+		LLVector3d mPositionGroup;
+		F64 mBinRadius;
+		LLVector3 mExtents[2];
+	};
+	typedef std::vector<LLPointer<Drawable> > drawable_list_t;
+
+	typedef LLOctreeNode<Drawable> node_t;
+	typedef LLOctreeRoot<Drawable> root_t;
+
+	// What the cull needs of an LLSpatialGroup. Like it, one is attached to
+	// every node of the octree as it is created.
+	class Group : public LLOctreeListener<Drawable>
+	{
+	public:
+		Group(node_t* node) : mNode(node), mSkipFrustumCheck(false)
+		{
+			node->addListener(this);
+		}
+
+		virtual void handleInsertion(const LLTreeNode<Drawable>* node, Drawable* data) { data->mNode = mNode; }
+		virtual void handleRemoval(const LLTreeNode<Drawable>* node, Drawable* data) { data->mNode = NULL; }
+		virtual void handleDestruction(const LLTreeNode<Drawable>* node) { mNode = NULL; }
+		virtual void handleStateChange(const LLTreeNode<Drawable>* node) { }
+		virtual void handleChildAddition(const node_t* parent, node_t* child) { new Group(child); }
+		virtual void handleChildRemoval(const node_t* parent, const node_t* child) { }
+
+		// LLSpatialGroup::rebound() without the dirty flags
+		void rebound()
+		{
+			if (mNode->getChildCount() == 1 && mNode->getElementCount() == 0)
+			{
+				Group* group = (Group*) mNode->getChild(0)->getListener(0);
+				group->rebound();
+				mExtents[0] = group->mExtents[0];
+				mExtents[1] = group->mExtents[1];
+				group->mSkipFrustumCheck = true;
+			}
+			else if (mNode->isLeaf())
+			{
+				boundObjects();
+				mExtents[0] = mObjectExtents[0];
+				mExtents[1] = mObjectExtents[1];
+			}
+			else
+			{
+				for (U32 i = 0; i < mNode->getChildCount(); i++)
+				{
+					Group* group = (Group*) mNode->getChild(i)->getListener(0);
+					group->mSkipFrustumCheck = false;
+					group->rebound();
+					if (i == 0)
+					{
+						mExtents[0] = group->mExtents[0];
+						mExtents[1] = group->mExtents[1];
+					}
+					else
+					{
+						update_min_max(mExtents[0], mExtents[1], group->mExtents[0]);
+						update_min_max(mExtents[0], mExtents[1], group->mExtents[1]);
+					}
+				}
+				if (boundObjects())
+				{
+					update_min_max(mExtents[0], mExtents[1], mObjectExtents[0]);
+					update_min_max(mExtents[0], mExtents[1], mObjectExtents[1]);
+				}
+			}
+			mBounds[0] = (mExtents[0] + mExtents[1]) * 0.5f;
+			mBounds[1] = (mExtents[1] - mExtents[0]) * 0.5f;
+		}
+
+		bool boundObjects()
+		{
+			if (mNode->getData().empty())
+			{
+				return false;
+			}
+			node_t::const_element_iter iter = mNode->getData().begin();
+			mObjectExtents[0] = (*iter)->mExtents[0];
+			mObjectExtents[1] = (*iter)->mExtents[1];
+			for (++iter; iter != mNode->getData().end(); ++iter)
+			{
+				update_min_max(mObjectExtents[0], mObjectExtents[1], (*iter)->mExtents[0]);
+				update_min_max(mObjectExtents[0], mObjectExtents[1], (*iter)->mExtents[1]);
+			}
+			mObjectBounds[0] = (mObjectExtents[0] + mObjectExtents[1]) * 0.5f;
+			mObjectBounds[1] = (mObjectExtents[1] - mObjectExtents[0]) * 0.5f;
+			return true;
+		}
+
+		node_t* mNode;
+		LLVector3 mBounds[2];
+		LLVector3 mExtents[2];
+		LLVector3 mObjectBounds[2];
+		LLVector3 mObjectExtents[2];
+		bool mSkipFrustumCheck;
+	};
+
+	struct CullRecord
+	{
+		CullRecord(const node_t* node) : mNode(node), mSkipTo(0), mVisited(false), mCheckObjects(false) { }
+
+		const node_t* mNode;
+		U32 mSkipTo;
+		bool mVisited;
+		bool mCheckObjects;
+	};
+	typedef std::vector<CullRecord> record_list_t;
+
+	class Partition
+	{
+	public:
+		Partition()
+		{
+			mOctree = new root_t(LLVector3d(0, 0, 0), LLVector3d(1, 1, 1), NULL);
+			new Group(mOctree);
+		}
+
+		~Partition()
+		{
+			delete mOctree;
+		}
+
+		root_t* mOctree;
+		record_list_t mRecords;
+	};
+	typedef std::vector<Partition*> partition_list_t;
+
+	// LLOctreeCull::record()
+	class Recorder
+	{
+	public:
+		Recorder(LLCamera& camera, record_list_t& records)
+		:	mCamera(camera), mRecords(records), mRes(0)
+		{
+			mRecords.clear();
+		}
+
+		void record(const node_t* n)
+		{
+			const Group* group = (const Group*) n->getListener(0);
+			U32 index = mRecords.size();
+			mRecords.push_back(CullRecord(n));
+
+			if (mRes == 2 || (mRes && group->mSkipFrustumCheck))
+			{
+				recordBranch(n, group, index);
+			}
+			else
+			{
+				mRes = mCamera.AABBInFrustum(group->mBounds[0], group->mBounds[1]);
+				if (mRes)
+				{
+					recordBranch(n, group, index);
+				}
+				mRes = 0;
+			}
+
+			mRecords[index].mSkipTo = mRecords.size();
+		}
+
+	private:
+		void recordBranch(const node_t* n, const Group* group, U32 index)
+		{
+			mRecords[index].mVisited = true;
+			mRecords[index].mCheckObjects = n->getElementCount() > 0 &&
+				(n->getChildCount() == 0 || mRes != 1 ||
+				 mCamera.AABBInFrustum(group->mObjectBounds[0], group->mObjectBounds[1]));
+
+			for (U32 i = 0; i < n->getChildCount(); i++)
+			{
+				record(n->getChild(i));
+			}
+		}
+
+		LLCamera& mCamera;
+		record_list_t& mRecords;
+		S32 mRes;
+	};
+
+	// What LLOctreeCull::replay() hands to the pipeline
+	struct cull_counts
+	{
+		cull_counts() : mGroups(0), mDrawables(0) { }
+
+		bool operator==(const cull_counts& other) const
+		{
+			return mGroups == other.mGroups && mDrawables == other.mDrawables;
+		}
+
+		S64 mGroups;
+		S64 mDrawables;
+	};
+
+	void replay(const record_list_t& records, cull_counts& counts)
+	{
+		U32 i = 0;
+		while (i < records.size())
+		{
+			const CullRecord& rec = records[i];
+			if (!rec.mVisited)
+			{
+				i = rec.mSkipTo;
+				continue;
+			}
+			if (rec.mCheckObjects)
+			{
+				counts.mGroups++;
+				counts.mDrawables += rec.mNode->getElementCount();
+			}
+			++i;
+		}
+	}
+
+	// LLSpatialCullThread
+	class CullQueue : public LLQueuedThread
+	{
+	public:
+		class CullRequest : public LLQueuedThread::QueuedRequest
+		{
+		protected:
+			virtual ~CullRequest() { }
+
+		public:
+			CullRequest(handle_t handle, Partition* part, const LLCamera& camera)
+			:	LLQueuedThread::QueuedRequest(handle, LLQueuedThread::PRIORITY_NORMAL),
+				mPartition(part), mCamera(camera)
+			{
+			}
+
+			/*virtual*/ bool processRequest()
+			{
+				Recorder recorder(mCamera, mPartition->mRecords);
+				recorder.record(mPartition->mOctree);
+				return true;
+			}
+
+		private:
+			Partition* mPartition;
+			LLCamera mCamera;
+		};
+
+		CullQueue(U32 concurrency) : LLQueuedThread("culltest", true, concurrency) { }
+
+		handle_t cullPartition(Partition* part, const LLCamera& camera)
+		{
+			handle_t handle = generateHandle();
+			if (!addRequest(new CullRequest(handle, part, camera)))
+			{
+				llerrs << "CullQueue::cullPartition called after shutdown()" << llendl;
+			}
+			return handle;
+		}
+
+		// LLSpatialCullThread::finishCull()
+		void finishCull(handle_t handle, Partition* part, cull_counts& counts)
+		{
+			status_t status = waitForRequest(handle);
+			if (status == STATUS_COMPLETE)
+			{
+				replay(part->mRecords, counts);
+			}
+			completeRequest(handle);
+		}
+	};
+
+	void make_scene(S32 num_drawables, S32 num_regions, S32 num_partitions, partition_list_t& partitions,
+					drawable_list_t& drawables)
+	{
+		for (S32 i = 0; i < num_regions * num_partitions; ++i)
+		{
+			partitions.push_back(new Partition);
+		}
+
+		// regions in a square, like the ones around the agent's
+		S32 grid = 1;
+		while (grid * grid < num_regions)
+		{
+			grid++;
+		}
+
+		Random random(12345);
+		for (S32 i = 0; i < num_drawables; ++i)
+		{
+			S32 region = i % num_regions;
+			S32 partition = (i / num_regions) % num_partitions;
+			LLVector3 center(random.next(0.f, REGION_WIDTH) + (region % grid) * REGION_WIDTH,
+							 random.next(0.f, REGION_WIDTH) + (region / grid) * REGION_WIDTH,
+							 random.next(20.f, 60.f));
+			// mostly prims and avatars, with a few big buildings
+			F32 radius = random.next(0.f, 1.f) < 0.01f ? random.next(8.f, 32.f) : random.next(0.25f, 4.f);
+			Partition* part = partitions[region * num_partitions + partition];
+			drawables.push_back(new Drawable(part, center, radius));
+			part->mOctree->insert(drawables.back());
+		}
+
+		for (S32 i = 0; i < (S32)partitions.size(); ++i)
+		{
+			((Group*) partitions[i]->mOctree->getListener(0))->rebound();
+		}
+	}
+
+	// Turns a full circle over the frames, looking out from the middle of
+	// the regions.
+	void make_camera(S32 frame, S32 num_frames, S32 num_regions, LLCamera& camera)
+	{
+		S32 grid = 1;
+		while (grid * grid < num_regions)
+		{
+			grid++;
+		}
+
+		F32 yaw = F_TWO_PI * (F32)frame / (F32)num_frames;
+		LLVector3 origin(grid * REGION_WIDTH * 0.5f, grid * REGION_WIDTH * 0.5f, 40.f);
+		LLVector3 at(cosf(yaw), sinf(yaw), -0.1f);
+		camera.setOriginAndLookAt(origin, LLVector3::z_axis, origin + at);
+		camera.setView(1.f);
+		camera.setAspect(1.5f);
+		camera.setNear(0.1f);
+		camera.setFar(256.f);
+
+		// the corners LLViewerCamera gets from gluUnProject()
+		F32 tan_y = tanf(camera.getView() * 0.5f);
+		F32 tan_x = tan_y * camera.getAspect();
+		const F32 xs[] = { -1.f, 1.f, 1.f, -1.f };
+		const F32 ys[] = { -1.f, -1.f, 1.f, 1.f };
+		LLVector3 frust[8];
+		for (S32 i = 0; i < 8; i++)
+		{
+			F32 dist = i < 4 ? camera.getNear() : camera.getFar();
+			frust[i] = origin + camera.getAtAxis() * dist
+							  - camera.getLeftAxis() * (xs[i % 4] * tan_x * dist)
+							  + camera.getUpAxis() * (ys[i % 4] * tan_y * dist);
+		}
+		camera.calcAgentFrustumPlanes(frust);
+	}
+
+	F64 run_serial(const partition_list_t& partitions, const std::vector<LLCamera>& cameras, cull_counts& counts)
+	{
+		LLTimer timer;
+		for (S32 f = 0; f < (S32)cameras.size(); ++f)
+		{
+			for (S32 i = 0; i < (S32)partitions.size(); ++i)
+			{
+				LLCamera camera = cameras[f];
+				Recorder recorder(camera, partitions[i]->mRecords);
+				recorder.record(partitions[i]->mOctree);
+				replay(partitions[i]->mRecords, counts);
+			}
+		}
+		return timer.getElapsedTimeF64();
+	}
+
+	F64 run_threaded(const partition_list_t& partitions, const std::vector<LLCamera>& cameras, cull_counts& counts)
+	{
+		CullQueue queue(llmax(1U, (U32)LLThreadScheduler::getInstance()->getNumWorkers()));
+		std::vector<LLQueuedThread::handle_t> handles(partitions.size());
+
+		LLTimer timer;
+		for (S32 f = 0; f < (S32)cameras.size(); ++f)
+		{
+			for (S32 i = 0; i < (S32)partitions.size(); ++i)
+			{
+				handles[i] = queue.cullPartition(partitions[i], cameras[f]);
+			}
+			for (S32 i = 0; i < (S32)partitions.size(); ++i)
+			{
+				queue.finishCull(handles[i], partitions[i], counts);
+			}
+		}
+		F64 elapsed = timer.getElapsedTimeF64();
+		queue.shutdown();
+		return elapsed;
+	}
+
+	// LLSpatialGroup::updateInGroup() and LLSpatialPartition::move()
+	void move_drawable(Drawable* drawable)
+	{
+		node_t* node = drawable->mNode;
+		const node_t* parent = node->getOctParent();
+		if (node->isInside(drawable->getPositionGroup()) &&
+			(node->contains(drawable->getBinRadius()) ||
+			 (drawable->getBinRadius() > node->getSize().mdV[0] &&
+			  parent && parent->getElementCount() >= LL_OCTREE_MAX_CAPACITY)))
+		{
+			return;
+		}
+
+		LLPointer<Drawable> ptr = drawable;
+		node->remove(drawable);
+		drawable->mPartition->mOctree->insert(drawable);
+		drawable->mPartition->mOctree->prune();
+	}
+
+	F64 run_churn(const partition_list_t& partitions, const drawable_list_t& drawables,
+				  S32 num_frames, S32 num_moves, S32 num_regions)
+	{
+		S32 grid = 1;
+		while (grid * grid < num_regions)
+		{
+			grid++;
+		}
+		const F32 max_x = grid * REGION_WIDTH;
+
+		Random random(54321);
+		LLTimer timer;
+		for (S32 f = 0; f < num_frames; ++f)
+		{
+			for (S32 i = 0; i < num_moves; ++i)
+			{
+				Drawable* drawable = drawables[(U32)random.next(0.f, (F32)drawables.size()) % drawables.size()];
+				LLVector3 pos(drawable->getPositionGroup());
+				if (i % 10 == 0)
+				{
+					// derezzed, and something else rezzed in the region
+					LLPointer<Drawable> ptr = drawable;
+					drawable->mNode->remove(drawable);
+					pos.mV[0] = llclamp(pos.mV[0] + random.next(-64.f, 64.f), 0.f, max_x);
+					pos.mV[1] = llclamp(pos.mV[1] + random.next(-64.f, 64.f), 0.f, max_x);
+					drawable->setPosition(pos);
+					drawable->mPartition->mOctree->insert(drawable);
+				}
+				else
+				{
+					pos.mV[0] = llclamp(pos.mV[0] + random.next(-2.f, 2.f), 0.f, max_x);
+					pos.mV[1] = llclamp(pos.mV[1] + random.next(-2.f, 2.f), 0.f, max_x);
+					pos.mV[2] = llclamp(pos.mV[2] + random.next(-0.5f, 0.5f), 20.f, 60.f);
+					drawable->setPosition(pos);
+					move_drawable(drawable);
+				}
+			}
+
+			for (S32 i = 0; i < (S32)partitions.size(); ++i)
+			{
+				partitions[i]->mOctree->balance();
+			}
+		}
+		return timer.getElapsedTimeF64();
+	}
+
+	// Every drawable is where its node says, and balance() left no empty nodes
+	class ChurnChecker : public LLOctreeTraveler<Drawable>
+	{
+	public:
+		ChurnChecker() : mElements(0), mEmptyNodes(0) { }
+
+		virtual void visit(const node_t* node)
+		{
+			if (node->getOctParent() && node->getElementCount() == 0 && node->getChildCount() == 0)
+			{
+				mEmptyNodes++;
+			}
+			for (node_t::const_element_iter i = node->getData().begin(); i != node->getData().end(); ++i)
+			{
+				if ((*i)->mNode == node)
+				{
+					mElements++;
+				}
+			}
+		}
+
+		S32 mElements;
+		S32 mEmptyNodes;
+	};
+
+	void print_stats(const char* name, F64 elapsed, S32 frames, const cull_counts& counts, F64 baseline)
+	{
+		std::cout << llformat("%-12s %8.3fs, %7.3fms per frame, %lld groups, %lld drawables",
+							  name, elapsed, elapsed * 1000.0 / frames,
+							  (long long)counts.mGroups, (long long)counts.mDrawables);
+		if (baseline > 0.0 && elapsed > 0.0)
+		{
+			std::cout << llformat(", %.2fx", baseline / elapsed);
+		}
+		std::cout << std::endl;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	S32 num_drawables = 100000;
+	S32 num_regions = 4;
+	S32 num_partitions = 4;
+	S32 num_threads = 0;
+	S32 num_frames = 200;
+	S32 num_moves = 5000;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg(argv[i]);
+		if (arg == "--drawables" && i + 1 < argc)
+		{
+			num_drawables = llmax(1, atoi(argv[++i]));
+		}
+		else if (arg == "--regions" && i + 1 < argc)
+		{
+			num_regions = llmax(1, atoi(argv[++i]));
+		}
+		else if (arg == "--partitions" && i + 1 < argc)
+		{
+			num_partitions = llmax(1, atoi(argv[++i]));
+		}
+		else if (arg == "--threads" && i + 1 < argc)
+		{
+			num_threads = llmax(0, atoi(argv[++i]));
+		}
+		else if (arg == "--frames" && i + 1 < argc)
+		{
+			num_frames = llmax(1, atoi(argv[++i]));
+		}
+		else if (arg == "--moves" && i + 1 < argc)
+		{
+			num_moves = llmax(0, atoi(argv[++i]));
+		}
+		else
+		{
+			std::cerr << "Usage: " << argv[0] << " [--drawables N] [--regions N] [--partitions N] [--threads N] [--frames N] [--moves N]" << std::endl;
+			return 1;
+		}
+	}
+
+	LLError::initForApplication(".");
+	LLCommon::initClass();
+	ll_init_apr();
+	LLThreadScheduler::initClass(num_threads);
+
+	partition_list_t partitions;
+	drawable_list_t drawables;
+	make_scene(num_drawables, num_regions, num_partitions, partitions, drawables);
+
+	std::vector<LLCamera> cameras(num_frames);
+	for (S32 f = 0; f < num_frames; ++f)
+	{
+		make_camera(f, num_frames, num_regions, cameras[f]);
+	}
+
+	std::cout << llformat("%d drawables in %d regions of %d partitions, %d frames, %d cull threads",
+						  num_drawables, num_regions, num_partitions, num_frames,
+						  LLThreadScheduler::getInstance()->getNumWorkers()) << std::endl;
+
+	cull_counts serial_counts;
+	F64 serial = run_serial(partitions, cameras, serial_counts);
+	print_stats("main thread:", serial, num_frames, serial_counts, 0.0);
+
+	cull_counts threaded_counts;
+	F64 threaded = run_threaded(partitions, cameras, threaded_counts);
+	print_stats("threaded:", threaded, num_frames, threaded_counts, serial);
+
+	S32 result = 0;
+	if (!(serial_counts == threaded_counts))
+	{
+		std::cout << "Threaded cull found different groups" << std::endl;
+		result = 1;
+	}
+
+	F64 churn = run_churn(partitions, drawables, num_frames, num_moves, num_regions);
+	std::cout << llformat("%-12s %8.3fs, %7.3fms per frame, %d moves per frame",
+						  "moving:", churn, churn * 1000.0 / num_frames, num_moves) << std::endl;
+
+	ChurnChecker checker;
+	for (S32 i = 0; i < (S32)partitions.size(); ++i)
+	{
+		checker.traverse(partitions[i]->mOctree);
+	}
+	if (checker.mElements != (S32)drawables.size())
+	{
+		std::cout << "Found " << checker.mElements << " of " << drawables.size() << " drawables after moving" << std::endl;
+		result = 1;
+	}
+	if (checker.mEmptyNodes > 0)
+	{
+		std::cout << checker.mEmptyNodes << " empty nodes left after balancing" << std::endl;
+		result = 1;
+	}
+
+	for (S32 i = 0; i < (S32)partitions.size(); ++i)
+	{
+		delete partitions[i];
+	}
+	LLThreadScheduler::cleanupClass();
+	LLCommon::cleanupClass();
+	return result;
+}
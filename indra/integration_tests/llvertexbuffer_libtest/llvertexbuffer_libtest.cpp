@@ -0,0 +1,303 @@
+/**
+ * @file llvertexbuffer_libtest.cpp
+ * @brief Churning client side vertex buffers the way geometry rebuilds do, with and
+ * without the LLVertexBufferArena free lists
+ *
+ * $LicenseInfo:firstyear=2011&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2011, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+#include "linden_common.h"
+
+// linden library includes
+#include "llapr.h"
+#include "llcommon.h"
+#include "llerrorcontrol.h"
+#include "llpointer.h"
+#include "lltimer.h"
+#include "llvertexbuffer.h"
+
+#include <iostream>
+#include <vector>
+
+// Usage:
+//   llvertexbuffer_libtest [--groups N] [--frames N] [--rebuilds N]
+//
+// Never creates a GL context: VBOs are off, so every LLVertexBuffer keeps
+// its data in client memory from LLVertexBuffer::sClientArena.
+//
+// Lays out --groups spatial groups of one to four buffers each, with the
+// vertex formats LLVolumeGeometryManager uses and sizes from a handful of
+// vertices to tens of thousands. Then for --frames frames --rebuilds groups
+// are rebuilt the way genDrawInfo() does it: most buffers are resized to
+// what their faces need now and some are thrown away for new ones. Every
+// buffer is refilled through its striders. One rebuild in twenty replaces
+// the whole group instead, like a region streaming in while another goes.
+// LLVertexBufferArena::endFrame() runs after every frame.
+//
+// The run is done twice, the first time with the arena's free lists off, so
+// every freed block goes straight back to the heap the way the new[] and
+// delete[] the arena replaced did. Each buffer tags its first vertex, and a
+// resize must keep it.
+
+namespace
+{
+	// a cheap LCG so both runs churn the same way
+	class Random
+	{
+	public:
+		Random(U32 seed) : mSeed(seed) {}
+
+		F32 next()
+		{
+			mSeed = mSeed * 1664525 + 1013904223;
+			return (F32)(mSeed >> 8) / (F32)(1 << 24);
+		}
+
+		F32 range(F32 min, F32 max)
+		{
+			return min + (max - min) * next();
+		}
+
+		U32 index(U32 count)
+		{
+			return llmin((U32)(next() * count), count - 1);
+		}
+
+	private:
+		U32 mSeed;
+	};
+
+	// the masks LLVolumeGeometryManager::rebuildGeom() asks for
+	const U32 MASKS[] =
+	{
+		LLVertexBuffer::MAP_VERTEX | LLVertexBuffer::MAP_NORMAL | LLVertexBuffer::MAP_TEXCOORD0 | LLVertexBuffer::MAP_COLOR,
+		LLVertexBuffer::MAP_VERTEX | LLVertexBuffer::MAP_NORMAL | LLVertexBuffer::MAP_TEXCOORD0 | LLVertexBuffer::MAP_TEXCOORD1 |
+			LLVertexBuffer::MAP_COLOR | LLVertexBuffer::MAP_BINORMAL,
+		LLVertexBuffer::MAP_VERTEX | LLVertexBuffer::MAP_TEXCOORD0 | LLVertexBuffer::MAP_COLOR,
+	};
+	const U32 NUM_MASKS = sizeof(MASKS) / sizeof(MASKS[0]);
+
+	struct Buffer
+	{
+		LLPointer<LLVertexBuffer> mBuffer;
+		U32 mTag;
+	};
+
+	typedef std::vector<Buffer> group_t;
+	typedef std::vector<group_t> group_list_t;
+
+	// vertex counts spread evenly over orders of magnitude, like faces batched by texture
+	S32 random_vertices(Random& random)
+	{
+		return llclamp((S32) powf(10.f, random.range(0.6f, 4.3f)), 4, 65535);
+	}
+
+	LLVector3 tag_position(U32 tag)
+	{
+		return LLVector3((F32) (tag & 0xffff), (F32) (tag >> 16), 1.f);
+	}
+
+	void fill_buffer(Buffer& buffer, U32 tag)
+	{
+		LLVertexBuffer* vb = buffer.mBuffer;
+
+		LLStrider<LLVector3> vertices;
+		vb->getVertexStrider(vertices);
+		for (S32 i = 0; i < vb->getRequestedVerts(); ++i)
+		{
+			*vertices++ = LLVector3((F32) i, 0.f, 0.f);
+		}
+
+		LLStrider<U16> indices;
+		vb->getIndexStrider(indices);
+		for (S32 i = 0; i < vb->getRequestedIndices(); ++i)
+		{
+			*indices++ = (U16) (i % vb->getRequestedVerts());
+		}
+
+		buffer.mTag = tag;
+		vb->getVertexStrider(vertices);
+		*vertices = tag_position(tag);
+	}
+
+	void new_buffer(Buffer& buffer, Random& random, U32 tag)
+	{
+		S32 verts = random_vertices(random);
+		buffer.mBuffer = new LLVertexBuffer(MASKS[random.index(NUM_MASKS)], 0);
+		buffer.mBuffer->allocateBuffer(verts, verts * 3 / 2, TRUE);
+		fill_buffer(buffer, tag);
+	}
+
+	void new_group(group_t& group, Random& random, U32& tag)
+	{
+		group.resize(1 + random.index(4));
+		for (U32 i = 0; i < group.size(); ++i)
+		{
+			new_buffer(group[i], random, ++tag);
+		}
+	}
+
+	// returns false if a resize lost the buffer's first vertex
+	bool rebuild_group(group_t& group, Random& random, U32& tag)
+	{
+		bool ok = true;
+		for (U32 i = 0; i < group.size(); ++i)
+		{
+			Buffer& buffer = group[i];
+			if (random.next() < 0.2f)
+			{ //usage or batching changed, genDrawInfo() makes a new buffer
+				new_buffer(buffer, random, ++tag);
+				continue;
+			}
+
+			S32 verts = llclamp((S32) (buffer.mBuffer->getRequestedVerts() * powf(2.f, random.range(-0.6f, 0.6f))), 4, 65535);
+			buffer.mBuffer->resizeBuffer(verts, verts * 3 / 2);
+
+			LLStrider<LLVector3> vertices;
+			buffer.mBuffer->getVertexStrider(vertices);
+			if (*vertices != tag_position(buffer.mTag))
+			{
+				ok = false;
+			}
+			fill_buffer(buffer, ++tag);
+		}
+		return ok;
+	}
+
+	struct churn_result
+	{
+		F64 mSeconds;
+		U32 mPeakHeld;
+		LLVertexBufferArena::Stats mStats;
+		bool mOk;
+	};
+
+	void run_churn(S32 num_groups, S32 num_frames, S32 num_rebuilds, bool cache, churn_result& result)
+	{
+		LLVertexBufferArena& arena = LLVertexBuffer::sClientArena;
+		arena.setCaching(cache);
+
+		Random random(4242);
+		U32 tag = 0;
+		group_list_t groups(num_groups);
+		for (S32 i = 0; i < num_groups; ++i)
+		{
+			new_group(groups[i], random, tag);
+		}
+		arena.resetCounters();
+
+		result.mOk = true;
+		result.mPeakHeld = 0;
+		LLTimer timer;
+		for (S32 frame = 0; frame < num_frames; ++frame)
+		{
+			for (S32 i = 0; i < num_rebuilds; ++i)
+			{
+				group_t& group = groups[random.index(num_groups)];
+				if (random.next() < 0.05f)
+				{
+					group.clear();
+					new_group(group, random, tag);
+				}
+				else if (!rebuild_group(group, random, tag))
+				{
+					result.mOk = false;
+				}
+			}
+
+			const LLVertexBufferArena::Stats& stats = arena.getStats();
+			result.mPeakHeld = llmax(result.mPeakHeld, stats.mReservedBytes + stats.mCachedBytes);
+			arena.endFrame();
+		}
+		result.mSeconds = timer.getElapsedTimeF64();
+		result.mStats = arena.getStats();
+
+		groups.clear();
+		arena.flush();
+	}
+
+	void print_result(const char* label, const churn_result& result, S32 num_frames)
+	{
+		const LLVertexBufferArena::Stats& stats = result.mStats;
+		std::cout << llformat("%-12s %8.3fs, %7.3fms per frame, %u allocations, %.1f%% reused",
+							  label, result.mSeconds, result.mSeconds * 1000.0 / num_frames, stats.mAllocations,
+							  stats.mAllocations ? 100.f * stats.mReuses / stats.mAllocations : 0.f) << std::endl;
+		std::cout << llformat("%-12s %u KB in use, %u KB cached, %u KB peak held, %.1f%% fragmented",
+							  "", stats.mInUseBytes / 1024, stats.mCachedBytes / 1024, result.mPeakHeld / 1024,
+							  100.f * stats.getFragmentation()) << std::endl;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	S32 num_groups = 2000;
+	S32 num_frames = 300;
+	S32 num_rebuilds = 100;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg(argv[i]);
+		if (arg == "--groups" && i + 1 < argc)
+		{
+			num_groups = llmax(1, atoi(argv[++i]));
+		}
+		else if (arg == "--frames" && i + 1 < argc)
+		{
+			num_frames = llmax(1, atoi(argv[++i]));
+		}
+		else if (arg == "--rebuilds" && i + 1 < argc)
+		{
+			num_rebuilds = llmax(1, atoi(argv[++i]));
+		}
+		else
+		{
+			std::cerr << "Usage: " << argv[0] << " [--groups N] [--frames N] [--rebuilds N]" << std::endl;
+			return 1;
+		}
+	}
+
+	LLError::initForApplication(".");
+	LLCommon::initClass();
+	ll_init_apr();
+	LLVertexBuffer::initClass(false);
+
+	std::cout << llformat("%d groups, %d frames, %d groups rebuilt per frame",
+						  num_groups, num_frames, num_rebuilds) << std::endl;
+
+	churn_result uncached;
+	run_churn(num_groups, num_frames, num_rebuilds, false, uncached);
+	print_result("uncached:", uncached, num_frames);
+
+	churn_result cached;
+	run_churn(num_groups, num_frames, num_rebuilds, true, cached);
+	print_result("arena:", cached, num_frames);
+
+	S32 result = 0;
+	if (!uncached.mOk || !cached.mOk)
+	{
+		std::cout << "A resize lost the start of a buffer" << std::endl;
+		result = 1;
+	}
+
+	ll_cleanup_apr();
+	LLCommon::cleanupClass();
+	return result;
+}
@@ -0,0 +1,278 @@
+/**
+ * @file llvfs_libtest.cpp
+ * @brief Multi-threaded read and write throughput of single file and sharded VFS
+ *
+ * $LicenseInfo:firstyear=2011&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2011, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+#include "linden_common.h"
+
+// linden library includes
+#include "llapr.h"
+#include "llcommon.h"
+#include "llerrorcontrol.h"
+#include "llfile.h"
+#include "llthread.h"
+#include "lltimer.h"
+#include "lluuid.h"
+#include "llvfs.h"
+
+#include <iostream>
+#include <vector>
+
+// Usage:
+//   llvfs_libtest [--threads N] [--files N] [--ops N] [--shards N] [--dir path]
+//
+// Fills a VFS with --files texture sized files, then has --threads threads
+// do --ops operations each against it, most of them reads of random files
+// and the rest rewrites of the thread's own files, the way the texture
+// cache and the asset fetches share the VFS in the viewer. This is run once
+// against a single data file and once against a VFS of --shards shards.
+// Afterwards every other file is removed and compaction of the holes this
+// leaves behind is timed.
+
+namespace
+{
+	const S32 FILE_SIZE = 16 * 1024;
+	const S32 READ_SIZE = 4 * 1024;
+	const S32 WRITES_PER_HUNDRED = 20;
+	const S32 COMPACT_BYTES_PER_CALL = 256 * 1024;
+
+	typedef std::vector<LLUUID> id_list_t;
+
+	class LLVFSWorker : public LLThread
+	{
+	public:
+		LLVFSWorker(LLVFS* vfs, const id_list_t& ids, S32 first_owned, S32 num_owned, S32 num_ops, U32 seed)
+		:	LLThread("VFS worker"),
+			mVFS(vfs),
+			mIDs(ids),
+			mFirstOwned(first_owned),
+			mNumOwned(num_owned),
+			mNumOps(num_ops),
+			mSeed(seed),
+			mBytesRead(0),
+			mBytesWritten(0)
+		{
+		}
+
+		/*virtual*/ void run()
+		{
+			std::vector<U8> buffer(FILE_SIZE, (U8)mSeed);
+			for (S32 i = 0; i < mNumOps; ++i)
+			{
+				// a cheap LCG, rand() is not thread safe everywhere
+				mSeed = mSeed * 1664525 + 1013904223;
+				U32 r = mSeed >> 8;
+				if (mNumOwned > 0 && (S32)(r % 100) < WRITES_PER_HUNDRED)
+				{
+					const LLUUID& id = mIDs[mFirstOwned + (r / 100) % mNumOwned];
+					mBytesWritten += mVFS->storeData(id, LLAssetType::AT_TEXTURE, &buffer[0], 0, FILE_SIZE);
+				}
+				else
+				{
+					const LLUUID& id = mIDs[(r / 100) % mIDs.size()];
+					S32 location = ((r >> 4) % (FILE_SIZE / READ_SIZE)) * READ_SIZE;
+					mBytesRead += mVFS->getData(id, LLAssetType::AT_TEXTURE, &buffer[0], location, READ_SIZE);
+				}
+			}
+		}
+
+		S64 getBytesRead() const		{ return mBytesRead; }
+		S64 getBytesWritten() const		{ return mBytesWritten; }
+
+	private:
+		LLVFS* mVFS;
+		const id_list_t& mIDs;
+		S32 mFirstOwned;
+		S32 mNumOwned;
+		S32 mNumOps;
+		U32 mSeed;
+		S64 mBytesRead;
+		S64 mBytesWritten;
+	};
+
+	void remove_vfs_files(const std::string& index_filename, const std::string& data_filename, S32 shard_count)
+	{
+		for (S32 shard = 0; shard < shard_count; ++shard)
+		{
+			LLFile::remove(LLVFS::getShardFilename(index_filename, shard));
+			LLFile::remove(LLVFS::getShardFilename(data_filename, shard));
+		}
+	}
+
+	bool fill(LLVFS* vfs, const id_list_t& ids)
+	{
+		std::vector<U8> buffer(FILE_SIZE);
+		for (S32 i = 0; i < (S32)ids.size(); ++i)
+		{
+			memset(&buffer[0], i & 0xff, FILE_SIZE);
+			if (!vfs->setMaxSize(ids[i], LLAssetType::AT_TEXTURE, FILE_SIZE)
+				|| vfs->storeData(ids[i], LLAssetType::AT_TEXTURE, &buffer[0], 0, FILE_SIZE) != FILE_SIZE)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void run_workers(LLVFS* vfs, const id_list_t& ids, S32 num_threads, S32 num_ops, S64& bytes_read, S64& bytes_written)
+	{
+		std::vector<LLVFSWorker*> workers;
+		S32 owned_per_thread = (S32)ids.size() / num_threads;
+		for (S32 i = 0; i < num_threads; ++i)
+		{
+			workers.push_back(new LLVFSWorker(vfs, ids, i * owned_per_thread, owned_per_thread, num_ops, 12345 + i));
+		}
+		for (S32 i = 0; i < num_threads; ++i)
+		{
+			workers[i]->start();
+		}
+
+		bytes_read = bytes_written = 0;
+		for (S32 i = 0; i < num_threads; ++i)
+		{
+			while (!workers[i]->isStopped())
+			{
+				ms_sleep(1);
+			}
+			bytes_read += workers[i]->getBytesRead();
+			bytes_written += workers[i]->getBytesWritten();
+		}
+		std::for_each(workers.begin(), workers.end(), DeletePointer());
+	}
+
+	void benchmark(const std::string& dir, const id_list_t& ids, S32 num_threads, S32 num_ops, S32 shard_count)
+	{
+		std::string index_filename = dir + "/llvfs_libtest.db2.x";
+		std::string data_filename = dir + "/llvfs_libtest.db2";
+		remove_vfs_files(index_filename, data_filename, shard_count);
+
+		// room for every file plus the same again for the index to grow into
+		U32 presize = (U32)ids.size() * FILE_SIZE * 2;
+		LLVFS* vfs = LLVFS::createLLVFS(index_filename, data_filename, FALSE, presize, FALSE, shard_count);
+		if (!vfs || !vfs->isValid())
+		{
+			std::cerr << "Could not create the VFS in " << dir << std::endl;
+			delete vfs;
+			return;
+		}
+
+		LLTimer timer;
+		if (!fill(vfs, ids))
+		{
+			std::cerr << "Could not fill the VFS" << std::endl;
+			delete vfs;
+			remove_vfs_files(index_filename, data_filename, shard_count);
+			return;
+		}
+		F64 elapsed = timer.getElapsedTimeF64();
+		std::cout << llformat("%2d shards, fill:      %8.3fs, %d files", shard_count, elapsed, (S32)ids.size()) << std::endl;
+
+		S64 bytes_read = 0;
+		S64 bytes_written = 0;
+		timer.reset();
+		run_workers(vfs, ids, num_threads, num_ops, bytes_read, bytes_written);
+		elapsed = timer.getElapsedTimeF64();
+		F64 total_ops = (F64)num_threads * num_ops;
+		std::cout << llformat("%2d shards, %2d threads: %8.3fs, %10.0f ops/s, %8.1f MB read, %8.1f MB written",
+							  shard_count, num_threads, elapsed, elapsed > 0.0 ? total_ops / elapsed : 0.0,
+							  bytes_read / (1024.0 * 1024.0), bytes_written / (1024.0 * 1024.0)) << std::endl;
+
+		for (S32 i = 0; i < (S32)ids.size(); i += 2)
+		{
+			vfs->removeFile(ids[i], LLAssetType::AT_TEXTURE);
+		}
+		timer.reset();
+		S64 bytes_moved = 0;
+		S32 calls = 0;
+		S32 moved;
+		while ((moved = vfs->compact(COMPACT_BYTES_PER_CALL)) > 0)
+		{
+			bytes_moved += moved;
+			++calls;
+		}
+		elapsed = timer.getElapsedTimeF64();
+		std::cout << llformat("%2d shards, compact:   %8.3fs, %8.1f MB moved in %d calls",
+							  shard_count, elapsed, bytes_moved / (1024.0 * 1024.0), calls) << std::endl;
+
+		delete vfs;
+		remove_vfs_files(index_filename, data_filename, shard_count);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	S32 num_threads = 4;
+	S32 num_files = 4096;
+	S32 num_ops = 50000;
+	S32 shard_count = 8;
+	std::string dir(".");
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg(argv[i]);
+		if (arg == "--threads" && i + 1 < argc)
+		{
+			num_threads = llmax(1, atoi(argv[++i]));
+		}
+		else if (arg == "--files" && i + 1 < argc)
+		{
+			num_files = llmax(1, atoi(argv[++i]));
+		}
+		else if (arg == "--ops" && i + 1 < argc)
+		{
+			num_ops = llmax(1, atoi(argv[++i]));
+		}
+		else if (arg == "--shards" && i + 1 < argc)
+		{
+			shard_count = llclamp(atoi(argv[++i]), 1, 64);
+		}
+		else if (arg == "--dir" && i + 1 < argc)
+		{
+			dir = argv[++i];
+		}
+		else
+		{
+			std::cerr << "Usage: " << argv[0] << " [--threads N] [--files N] [--ops N] [--shards N] [--dir path]" << std::endl;
+			return 1;
+		}
+	}
+
+	LLError::initForApplication(".");
+	LLCommon::initClass();
+	ll_init_apr();
+
+	id_list_t ids(num_files);
+	for (S32 i = 0; i < num_files; ++i)
+	{
+		ids[i].generate();
+	}
+
+	benchmark(dir, ids, num_threads, num_ops, 1);
+	if (shard_count > 1)
+	{
+		benchmark(dir, ids, num_threads, num_ops, shard_count);
+	}
+
+	LLCommon::cleanupClass();
+	return 0;
+}
@@ -0,0 +1,508 @@
+/**
+ * @file llvolume_libtest.cpp
+ * @brief Main thread cost of building volumes, of volume level of detail changes and of filling vertex buffers from volume faces
+ *
+ * $LicenseInfo:firstyear=2011&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2011, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+#include "linden_common.h"
+
+// linden library includes
+#include "llapr.h"
+#include "llcommon.h"
+#include "llerrorcontrol.h"
+#include "llthreadscheduler.h"
+#include "lltimer.h"
+#include "llvolume.h"
+#include "llvolumemgr.h"
+#include "m3math.h"
+#include "m4math.h"
+
+#include <iostream>
+#include <vector>
+
+// Usage:
+//   llvolume_libtest [--volumes N] [--detail N] [--threads N] [--per-frame N] [--passes N]
+//
+// Makes --volumes random prim shapes, next to no two alike, and builds each
+// from scratch at the lowest level of detail, the way objects start out when
+// a region is entered, --per-frame objects arriving per simulated frame:
+// first with refVolume() building every volume on the main thread, then with
+// refVolumeOrPlaceholder() handing the builds to the build thread while the
+// objects wait behind placeholders.
+//
+// With the shapes referenced at the lowest level of detail, every shape
+// is then switched to level of detail --detail, --per-frame switches per
+// simulated frame: first the way the viewer used to, building each volume on
+// the main thread in refVolume(), then with prepareVolume() handing the
+// builds to LLVolumeMgr's build thread on --threads scheduler workers. For
+// both the total main thread time and the longest frame are reported.
+//
+// Then the positions, normals and binormals of the first --volumes / 10
+// shapes are transformed into vertex buffer sized arrays --passes times, the
+// work LLFace::getGeometryVolume() does for every prim in view: once a
+// vertex at a time over a copy of the faces in the old array of VertexData
+// layout, and once with LLVolumeFace's stream transforms.
+
+namespace
+{
+	typedef std::vector<LLVolumeParams> params_list_t;
+
+	// a cheap LCG so every run builds the same shapes
+	class Random
+	{
+	public:
+		Random(U32 seed) : mSeed(seed) {}
+
+		F32 next(F32 min, F32 max)
+		{
+			mSeed = mSeed * 1664525 + 1013904223;
+			return min + (max - min) * (F32)(mSeed >> 8) / (F32)(1 << 24);
+		}
+
+	private:
+		U32 mSeed;
+	};
+
+	void make_params(S32 count, params_list_t& params)
+	{
+		const U8 profiles[] = { LL_PCODE_PROFILE_CIRCLE, LL_PCODE_PROFILE_SQUARE, LL_PCODE_PROFILE_ISOTRI,
+								LL_PCODE_PROFILE_EQUALTRI, LL_PCODE_PROFILE_RIGHTTRI, LL_PCODE_PROFILE_CIRCLE_HALF };
+		const U8 holes[] = { LL_PCODE_HOLE_SAME, LL_PCODE_HOLE_CIRCLE, LL_PCODE_HOLE_SQUARE, LL_PCODE_HOLE_TRIANGLE };
+		const U8 paths[] = { LL_PCODE_PATH_LINE, LL_PCODE_PATH_CIRCLE, LL_PCODE_PATH_CIRCLE2 };
+
+		Random random(12345);
+		for (S32 i = 0; i < count; ++i)
+		{
+			LLVolumeParams volume_params;
+			U8 profile = profiles[(S32)random.next(0.f, 5.99f)] | holes[(S32)random.next(0.f, 3.99f)];
+			U8 path = paths[(S32)random.next(0.f, 2.99f)];
+			volume_params.setType(profile, path);
+
+			F32 begin = random.next(0.f, 0.4f);
+			volume_params.setBeginAndEndS(begin, random.next(begin + 0.1f, 1.f));
+			begin = random.next(0.f, 0.4f);
+			volume_params.setBeginAndEndT(begin, random.next(begin + 0.1f, 1.f));
+			volume_params.setHollow(random.next(0.f, 0.9f));
+			volume_params.setTwistBegin(random.next(-1.f, 1.f));
+			volume_params.setTwistEnd(random.next(-1.f, 1.f));
+			volume_params.setShear(random.next(-0.5f, 0.5f), random.next(-0.5f, 0.5f));
+			if (path == LL_PCODE_PATH_LINE)
+			{
+				volume_params.setRatio(random.next(0.f, 1.f), random.next(0.f, 1.f));
+			}
+			else
+			{
+				volume_params.setRatio(1.f, random.next(0.05f, 0.5f));
+				volume_params.setTaper(random.next(-1.f, 1.f), random.next(-1.f, 1.f));
+				volume_params.setRevolutions(random.next(1.f, 4.f));
+				volume_params.setSkew(random.next(-0.9f, 0.9f) * (1.f - volume_params.getRatioY()));
+			}
+			params.push_back(volume_params);
+		}
+	}
+
+	struct frame_stats
+	{
+		frame_stats() : mFrames(0), mMainTime(0.0), mWorstFrame(0.0), mWallTime(0.0) {}
+
+		void addFrame(F64 elapsed)
+		{
+			mFrames++;
+			mMainTime += elapsed;
+			mWorstFrame = llmax(mWorstFrame, elapsed);
+		}
+
+		S32 mFrames;
+		F64 mMainTime;
+		F64 mWorstFrame;
+		F64 mWallTime;
+	};
+
+	typedef std::vector< LLPointer<LLVolume> > volume_list_t;
+
+	void ref_lowest(LLVolumeMgr& mgr, const params_list_t& params, volume_list_t& volumes)
+	{
+		for (S32 i = 0; i < (S32)params.size(); ++i)
+		{
+			volumes.push_back(mgr.refVolume(params[i], 0));
+		}
+	}
+
+	// Drops the lowest level of detail and what replaced it, like objects
+	// leaving the view, so all the shapes at full detail never need to fit in
+	// memory at once.
+	void switch_volume(LLVolumeMgr& mgr, const LLVolumeParams& volume_params, S32 detail,
+					   LLPointer<LLVolume>& lowest, S32& faces)
+	{
+		LLPointer<LLVolume> volume = mgr.refVolume(volume_params, detail);
+		faces += volume->getNumVolumeFaces();
+		mgr.unrefVolume(lowest);
+		lowest = NULL;
+		mgr.unrefVolume(volume);
+	}
+
+	// The viewer before the build thread: every switch builds the volume in
+	// LLVOVolume::updateGeometry() on the main thread.
+	frame_stats run_synchronous(const params_list_t& params, S32 detail, S32 per_frame, S32& faces)
+	{
+		frame_stats stats;
+		LLVolumeMgr mgr;
+		volume_list_t volumes;
+		ref_lowest(mgr, params, volumes);
+
+		faces = 0;
+		LLTimer wall_timer;
+		for (S32 i = 0; i < (S32)params.size(); i += per_frame)
+		{
+			LLTimer frame_timer;
+			S32 end = llmin(i + per_frame, (S32)params.size());
+			for (S32 j = i; j < end; ++j)
+			{
+				switch_volume(mgr, params[j], detail, volumes[j], faces);
+			}
+			stats.addFrame(frame_timer.getElapsedTimeF64());
+		}
+		stats.mWallTime = wall_timer.getElapsedTimeF64();
+		mgr.cleanup();
+		return stats;
+	}
+
+	// Objects ask for the new level of detail each frame until it is there,
+	// drawing the one they have in the meantime.
+	frame_stats run_threaded(const params_list_t& params, S32 detail, S32 per_frame, S32& faces)
+	{
+		frame_stats stats;
+		LLVolumeMgr mgr;
+		mgr.startBuildThread(true, LLThreadScheduler::getInstance()->getNumWorkers());
+		volume_list_t volumes;
+		ref_lowest(mgr, params, volumes);
+
+		faces = 0;
+		S32 next = 0;
+		S32 remaining = (S32)params.size();
+		std::vector<S32> waiting;
+		LLTimer wall_timer;
+		while (remaining > 0)
+		{
+			LLTimer frame_timer;
+			mgr.update(0);
+
+			// the lods that changed this frame join the ones still waiting
+			S32 end = llmin(next + per_frame, (S32)params.size());
+			for ( ; next < end; ++next)
+			{
+				waiting.push_back(next);
+			}
+			for (std::vector<S32>::iterator iter = waiting.begin(); iter != waiting.end(); )
+			{
+				S32 index = *iter;
+				if (mgr.prepareVolume(params[index], detail))
+				{
+					switch_volume(mgr, params[index], detail, volumes[index], faces);
+					--remaining;
+					iter = waiting.erase(iter);
+				}
+				else
+				{
+					++iter;
+				}
+			}
+			stats.addFrame(frame_timer.getElapsedTimeF64());
+			if (remaining > 0)
+			{
+				// the rest of the frame, rendering and so on
+				ms_sleep(1);
+			}
+		}
+		stats.mWallTime = wall_timer.getElapsedTimeF64();
+		mgr.cleanup();
+		return stats;
+	}
+
+	void unref_all(LLVolumeMgr& mgr, volume_list_t& volumes)
+	{
+		for (S32 i = 0; i < (S32)volumes.size(); ++i)
+		{
+			if (volumes[i].notNull())
+			{
+				mgr.unrefVolume(volumes[i]);
+			}
+		}
+		volumes.clear();
+	}
+
+	// Objects arriving in a region before the build thread: LLPrimitive::setVolume()
+	// builds every new volume on the main thread.
+	frame_stats run_first_synchronous(const params_list_t& params, S32 per_frame, S32& faces)
+	{
+		frame_stats stats;
+		LLVolumeMgr mgr;
+		volume_list_t volumes;
+
+		faces = 0;
+		LLTimer wall_timer;
+		for (S32 i = 0; i < (S32)params.size(); i += per_frame)
+		{
+			LLTimer frame_timer;
+			S32 end = llmin(i + per_frame, (S32)params.size());
+			for (S32 j = i; j < end; ++j)
+			{
+				volumes.push_back(mgr.refVolume(params[j], 0));
+				faces += volumes.back()->getNumVolumeFaces();
+			}
+			stats.addFrame(frame_timer.getElapsedTimeF64());
+		}
+		stats.mWallTime = wall_timer.getElapsedTimeF64();
+		unref_all(mgr, volumes);
+		mgr.cleanup();
+		return stats;
+	}
+
+	// New objects get a placeholder and swap it for the real volume once the
+	// build thread is done with it, like LLVOVolume::updateGeometry() does.
+	frame_stats run_first_threaded(const params_list_t& params, S32 per_frame, S32& faces)
+	{
+		frame_stats stats;
+		LLVolumeMgr mgr;
+		mgr.startBuildThread(true, LLThreadScheduler::getInstance()->getNumWorkers());
+		volume_list_t volumes(params.size());
+
+		faces = 0;
+		S32 next = 0;
+		S32 remaining = (S32)params.size();
+		std::vector<S32> waiting;
+		LLTimer wall_timer;
+		while (remaining > 0)
+		{
+			LLTimer frame_timer;
+			mgr.update(0);
+
+			S32 end = llmin(next + per_frame, (S32)params.size());
+			for ( ; next < end; ++next)
+			{
+				volumes[next] = mgr.refVolumeOrPlaceholder(params[next], 0);
+				waiting.push_back(next);
+			}
+			for (std::vector<S32>::iterator iter = waiting.begin(); iter != waiting.end(); )
+			{
+				S32 index = *iter;
+				if (!volumes[index]->isPlaceholder() || mgr.prepareVolume(params[index], 0))
+				{
+					LLPointer<LLVolume> volume = mgr.refVolumeOrPlaceholder(params[index], 0);
+					mgr.unrefVolume(volumes[index]);
+					volumes[index] = volume;
+					faces += volume->getNumVolumeFaces();
+					--remaining;
+					iter = waiting.erase(iter);
+				}
+				else
+				{
+					++iter;
+				}
+			}
+			stats.addFrame(frame_timer.getElapsedTimeF64());
+			if (remaining > 0)
+			{
+				ms_sleep(1);
+			}
+		}
+		stats.mWallTime = wall_timer.getElapsedTimeF64();
+		unref_all(mgr, volumes);
+		mgr.cleanup();
+		return stats;
+	}
+
+	typedef std::vector<LLVolumeFace::VertexData> vertex_list_t;
+
+	// The vertex at a time loop getGeometryVolume() had, over the layout
+	// LLVolumeFace used to keep its vertices in.
+	void transform_vertices(const vertex_list_t& src, const LLMatrix4& mat_vert, const LLMatrix3& mat_normal,
+							LLVector3* vertices, LLVector3* normals, LLVector3* binormals)
+	{
+		for (S32 i = 0; i < (S32)src.size(); i++)
+		{
+			*vertices++ = src[i].mPosition * mat_vert;
+
+			LLVector3 normal = src[i].mNormal * mat_normal;
+			normal.normVec();
+			*normals++ = normal;
+
+			LLVector3 binormal = src[i].mBinormal * mat_normal;
+			binormal.normVec();
+			*binormals++ = binormal;
+		}
+	}
+
+	void run_geometry(const params_list_t& params, S32 detail, S32 passes)
+	{
+		LLVolumeMgr mgr;
+		volume_list_t volumes;
+		std::vector<vertex_list_t> aos_faces;
+		std::vector<const LLVolumeFace*> faces;
+		S32 max_vertices = 0;
+		S64 total_vertices = 0;
+		for (S32 i = 0; i < (S32)params.size(); ++i)
+		{
+			LLPointer<LLVolume> volume = mgr.refVolume(params[i], detail);
+			volumes.push_back(volume);
+			for (S32 f = 0; f < volume->getNumVolumeFaces(); ++f)
+			{
+				volume->genBinormals(f);
+				const LLVolumeFace& face = volume->getVolumeFace(f);
+				faces.push_back(&face);
+
+				vertex_list_t aos(face.getNumVertices());
+				for (S32 v = 0; v < face.getNumVertices(); ++v)
+				{
+					aos[v].mPosition = face.getPosition(v);
+					aos[v].mNormal = face.getNormal(v);
+					aos[v].mBinormal = face.getBinormal(v);
+					aos[v].mTexCoord = face.mTexCoords[v];
+				}
+				aos_faces.push_back(aos);
+				max_vertices = llmax(max_vertices, face.getNumVertices());
+				total_vertices += face.getNumVertices();
+			}
+		}
+
+		LLMatrix4 mat_vert;
+		mat_vert.initAll(LLVector3(2.f, 0.5f, 1.5f), LLQuaternion(0.7f, LLVector3(0.3f, 0.8f, -0.5f)),
+						 LLVector3(128.f, 128.f, 25.f));
+		LLMatrix3 mat_normal = mat_vert.getMat3();
+		std::vector<LLVector3> vertices(max_vertices), normals(max_vertices), binormals(max_vertices);
+
+		LLTimer timer;
+		for (S32 pass = 0; pass < passes; ++pass)
+		{
+			for (S32 f = 0; f < (S32)aos_faces.size(); ++f)
+			{
+				transform_vertices(aos_faces[f], mat_vert, mat_normal, &vertices[0], &normals[0], &binormals[0]);
+			}
+		}
+		F64 per_vertex = timer.getElapsedTimeF64();
+
+		timer.reset();
+		LLStrider<LLVector3> strider;
+		for (S32 pass = 0; pass < passes; ++pass)
+		{
+			for (S32 f = 0; f < (S32)faces.size(); ++f)
+			{
+				strider = &vertices[0];
+				faces[f]->transformPositions(mat_vert, strider);
+				strider = &normals[0];
+				faces[f]->transformNormals(mat_normal, strider);
+				strider = &binormals[0];
+				faces[f]->transformBinormals(mat_normal, strider);
+			}
+		}
+		F64 streams = timer.getElapsedTimeF64();
+
+		F64 vertices_done = (F64)total_vertices * passes;
+		std::cout << llformat("%d faces, %lld vertices, %d passes", (S32)faces.size(), (long long)total_vertices, passes) << std::endl;
+		std::cout << llformat("%-12s %8.3fs, %6.1f Mvertices/s", "per vertex:", per_vertex,
+							  per_vertex > 0.0 ? vertices_done / per_vertex / 1000000.0 : 0.0) << std::endl;
+		std::cout << llformat("%-12s %8.3fs, %6.1f Mvertices/s, %.2fx", "streams:", streams,
+							  streams > 0.0 ? vertices_done / streams / 1000000.0 : 0.0,
+							  streams > 0.0 ? per_vertex / streams : 0.0) << std::endl;
+
+		for (S32 i = 0; i < (S32)volumes.size(); ++i)
+		{
+			mgr.unrefVolume(volumes[i]);
+		}
+		volumes.clear();
+		mgr.cleanup();
+	}
+
+	void print_stats(const char* name, const frame_stats& stats, S32 faces)
+	{
+		std::cout << llformat("%-12s %8.3fs main thread, %8.3fs wall, %6d frames, worst frame %7.2fms, %d faces",
+							  name, stats.mMainTime, stats.mWallTime, stats.mFrames,
+							  stats.mWorstFrame * 1000.0, faces) << std::endl;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	S32 num_volumes = 10000;
+	S32 detail = 3;
+	S32 num_threads = 0;
+	S32 per_frame = 100;
+	S32 passes = 20;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg(argv[i]);
+		if (arg == "--volumes" && i + 1 < argc)
+		{
+			num_volumes = llmax(1, atoi(argv[++i]));
+		}
+		else if (arg == "--detail" && i + 1 < argc)
+		{
+			detail = llclamp(atoi(argv[++i]), 1, LLVolumeLODGroup::NUM_LODS - 1);
+		}
+		else if (arg == "--threads" && i + 1 < argc)
+		{
+			num_threads = llmax(0, atoi(argv[++i]));
+		}
+		else if (arg == "--per-frame" && i + 1 < argc)
+		{
+			per_frame = llmax(1, atoi(argv[++i]));
+		}
+		else if (arg == "--passes" && i + 1 < argc)
+		{
+			passes = llmax(1, atoi(argv[++i]));
+		}
+		else
+		{
+			std::cerr << "Usage: " << argv[0] << " [--volumes N] [--detail N] [--threads N] [--per-frame N] [--passes N]" << std::endl;
+			return 1;
+		}
+	}
+
+	LLError::initForApplication(".");
+	LLCommon::initClass();
+	ll_init_apr();
+	LLThreadScheduler::initClass(num_threads);
+
+	params_list_t params;
+	make_params(num_volumes, params);
+	std::cout << llformat("%d volumes, detail %d, %d switches per frame, %d build threads",
+						  num_volumes, detail, per_frame, LLThreadScheduler::getInstance()->getNumWorkers()) << std::endl;
+
+	S32 faces = 0;
+	frame_stats stats = run_first_synchronous(params, per_frame, faces);
+	print_stats("first build:", stats, faces);
+	stats = run_first_threaded(params, per_frame, faces);
+	print_stats("placeholder:", stats, faces);
+
+	stats = run_synchronous(params, detail, per_frame, faces);
+	print_stats("main thread:", stats, faces);
+	stats = run_threaded(params, detail, per_frame, faces);
+	print_stats("threaded:", stats, faces);
+
+	params.resize(llmax(1, num_volumes / 10));
+	run_geometry(params, detail, passes);
+
+	LLThreadScheduler::cleanupClass();
+	LLCommon::cleanupClass();
+	return 0;
+}
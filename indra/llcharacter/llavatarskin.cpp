@@ -0,0 +1,217 @@
+/** 
+ * @file llavatarskin.cpp
+ * @brief Skinning avatar joint meshes on the CPU, on one thread or several
+ *
+ * $LicenseInfo:firstyear=2011&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2011, Linden Research, Inc.
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+//-----------------------------------------------------------------------------
+// Header Files
+//-----------------------------------------------------------------------------
+#include "linden_common.h"
+
+#include "llavatarskin.h"
+
+#include "lljoint.h"
+#include "llmath.h"
+#include "llv4math.h"
+#include "llv4matrix3.h"
+#include "llv4matrix4.h"
+
+//-----------------------------------------------------------------------------
+// LLSkinJoint
+//-----------------------------------------------------------------------------
+LLSkinJoint::LLSkinJoint()
+{
+	mJoint       = NULL;
+}
+
+//-----------------------------------------------------------------------------
+// ~LLSkinJoint
+//-----------------------------------------------------------------------------
+LLSkinJoint::~LLSkinJoint()
+{
+	mJoint = NULL;
+}
+
+
+//-----------------------------------------------------------------------------
+// LLSkinJoint::setupSkinJoint()
+//-----------------------------------------------------------------------------
+BOOL LLSkinJoint::setupSkinJoint( LLJoint *joint)
+{
+	// find the named joint
+	mJoint = joint;
+	if ( !mJoint )
+	{
+		llinfos << "Can't find joint" << llendl;
+	}
+
+	// compute the inverse root skin matrix
+	mRootToJointSkinOffset.clearVec();
+
+	LLVector3 rootSkinOffset;
+	while (joint)
+	{
+		rootSkinOffset += joint->getSkinOffset();
+		joint = joint->getParent();
+	}
+
+	mRootToJointSkinOffset = -rootSkinOffset;
+	mRootToParentJointSkinOffset = mRootToJointSkinOffset;
+	mRootToParentJointSkinOffset += mJoint->getSkinOffset();
+
+	return TRUE;
+}
+
+//-----------------------------------------------------------------------------
+// get_skin_joint_matrices()
+//-----------------------------------------------------------------------------
+void get_skin_joint_matrices(const LLDynamicArray<LLJointRenderData*>& joint_data, const LLMatrix4* model_view,
+							 LLMatrix4* joint_mat, LLMatrix3* joint_rot)
+{
+	S32 joint_num;
+
+	//calculate joint matrices
+	for (joint_num = 0; joint_num < joint_data.count(); joint_num++)
+	{
+		joint_mat[joint_num] = *joint_data[joint_num]->mWorldMatrix;
+		if (model_view)
+		{
+			joint_mat[joint_num] *= *model_view;
+		}
+		joint_rot[joint_num] = joint_mat[joint_num].getMat3();
+	}
+
+	BOOL last_pivot_uploaded = FALSE;
+	S32 j = 0;
+	LLVector3 joint_pivot[32];
+
+	//joint pivots
+	for (joint_num = 0; joint_num < joint_data.count(); joint_num++)
+	{
+		LLSkinJoint *sj = joint_data[joint_num]->mSkinJoint;
+		if (sj)
+		{
+			if (!last_pivot_uploaded)
+			{
+				joint_pivot[j++] = sj->mRootToParentJointSkinOffset;
+			}
+
+			joint_pivot[j++] = sj->mRootToJointSkinOffset;
+
+			last_pivot_uploaded = TRUE;
+		}
+		else
+		{
+			last_pivot_uploaded = FALSE;
+		}
+	}
+
+	//add pivot point into transform
+	for (S32 i = 0; i < j; i++)
+	{
+		joint_mat[i].translate(joint_pivot[i] * joint_rot[i]);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// skin_joint_vertices()
+//-----------------------------------------------------------------------------
+void skin_joint_vertices(const LLMatrix4* joint_mat, S32 num_joints, U32 num_vertices,
+						 const F32* weights, const LLVector3* coords, const LLVector3* normals,
+						 LLStrider<LLVector3>& o_vertices, LLStrider<LLVector3>& o_normals)
+{
+	LLV4Matrix4			v4_joint_mat[32];	// per call, meshes are skinned on several threads at once
+	for (S32 j = 0; j < num_joints; ++j)
+	{
+		v4_joint_mat[j] = joint_mat[j];
+	}
+
+	F32					weight		= F32_MAX;
+	LLV4Matrix4			blend_mat;
+
+	for (U32 index = 0; index < num_vertices; ++index)
+	{
+		if( weight != weights[index])
+		{
+			S32 joint = llfloor(weight = weights[index]);
+			blend_mat.lerp(v4_joint_mat[joint], v4_joint_mat[joint+1], weight - joint);
+		}
+		blend_mat.multiply(coords[index], o_vertices[index]);
+		((LLV4Matrix3)blend_mat).multiply(normals[index], o_normals[index]);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// LLAvatarSkinThread
+//-----------------------------------------------------------------------------
+
+// Meshes are handed out in runs of about this many vertices, so the body
+// meshes of one avatar spread over several workers and the small ones of
+// many avatars share a request.
+const U32 SKIN_REQUEST_VERTICES = 4096;
+
+struct skinned_vertices
+{
+	U32 operator()(const LLSkinnedMesh* mesh) const { return mesh->getNumSkinnedVertices(); }
+};
+
+LLAvatarSkinThread::SkinRequest::SkinRequest(handle_t handle, std::vector<LLSkinnedMesh*>::const_iterator begin,
+											 std::vector<LLSkinnedMesh*>::const_iterator end)
+:	LLQueuedThread::QueuedRequest(handle, LLQueuedThread::PRIORITY_NORMAL),
+	mMeshes(begin, end)
+{
+}
+
+LLAvatarSkinThread::SkinRequest::~SkinRequest()
+{
+}
+
+// Called from LLAvatarSkinThread workers or from finishBatch()
+bool LLAvatarSkinThread::SkinRequest::processRequest()
+{
+	for (std::vector<LLSkinnedMesh*>::iterator iter = mMeshes.begin(); iter != mMeshes.end(); ++iter)
+	{
+		(*iter)->skinJointGeometry();
+	}
+	return true;
+}
+
+LLAvatarSkinThread::LLAvatarSkinThread(bool threaded, U32 concurrency)
+:	LLQueuedThread("avatarskin", threaded, concurrency)
+{
+}
+
+void LLAvatarSkinThread::queueSkin(std::vector<LLSkinnedMesh*>& meshes)
+{
+	addRequests<SkinRequest>(meshes, SKIN_REQUEST_VERTICES, skinned_vertices(), mPending);
+	meshes.clear();
+}
+
+void LLAvatarSkinThread::finishBatch()
+{
+	// skins queued meshes here rather than wait for the workers to get to them
+	waitForRequests(mPending);
+}
+
+// End
@@ -0,0 +1,141 @@
+/** 
+ * @file llavatarskin.h
+ * @brief Skinning avatar joint meshes on the CPU, on one thread or several
+ *
+ * $LicenseInfo:firstyear=2011&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2011, Linden Research, Inc.
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLAVATARSKIN_H
+#define LL_LLAVATARSKIN_H
+
+#include <vector>
+
+#include "lldarray.h"
+#include "llqueuedthread.h"
+#include "llstrider.h"
+#include "m3math.h"
+#include "m4math.h"
+#include "v3math.h"
+
+class LLJoint;
+
+//-----------------------------------------------------------------------------
+// LLSkinJoint
+// A joint a mesh is weighted to, with its offsets from the avatar root in
+// the bind pose.
+//-----------------------------------------------------------------------------
+class LLSkinJoint
+{
+public:
+	LLSkinJoint();
+	~LLSkinJoint();
+	BOOL setupSkinJoint( LLJoint *joint);
+
+	LLJoint			*mJoint;
+	LLVector3		mRootToJointSkinOffset;
+	LLVector3		mRootToParentJointSkinOffset;
+};
+
+//-----------------------------------------------------------------------------
+// LLJointRenderData
+// One matrix a mesh is skinned with. A joint whose parent is not the
+// previous entry is preceded by an entry for the parent, which has no
+// skin joint.
+//-----------------------------------------------------------------------------
+class LLJointRenderData
+{
+public:
+	LLJointRenderData(const LLMatrix4* world_matrix, LLSkinJoint* skin_joint) : mWorldMatrix(world_matrix), mSkinJoint(skin_joint) {}
+	~LLJointRenderData(){}
+
+	const LLMatrix4*		mWorldMatrix;
+	LLSkinJoint*			mSkinJoint;
+};
+
+// Joint matrices with the skin pivots added in, into the caller's arrays of
+// at least joint_data.count() entries, so meshes can be skinned on several
+// threads at once. If model_view is not NULL the joints are moved into eye
+// space first, for hardware skinning.
+void get_skin_joint_matrices(const LLDynamicArray<LLJointRenderData*>& joint_data, const LLMatrix4* model_view,
+							 LLMatrix4* joint_mat, LLMatrix3* joint_rot);
+
+// Blends num_joints matrices from get_skin_joint_matrices() by the weights of
+// LLPolyMesh::getWeights(), the index of the first matrix plus how far
+// towards the next one, into vertices and normals. Uses the vectorized
+// LLV4Matrix4 code.
+void skin_joint_vertices(const LLMatrix4* joint_mat, S32 num_joints, U32 num_vertices,
+						 const F32* weights, const LLVector3* coords, const LLVector3* normals,
+						 LLStrider<LLVector3>& vertices, LLStrider<LLVector3>& normals_out);
+
+//-----------------------------------------------------------------------------
+// LLSkinnedMesh
+// A mesh LLAvatarSkinThread can skin.
+//-----------------------------------------------------------------------------
+class LLSkinnedMesh
+{
+public:
+	virtual ~LLSkinnedMesh() {}
+
+	virtual U32 getNumSkinnedVertices() const = 0;
+	// Must only read the joints' world matrices, and write only to this
+	// mesh's own vertices, so meshes can be skinned on several threads at once.
+	virtual void skinJointGeometry() = 0;
+};
+
+//-----------------------------------------------------------------------------
+// LLAvatarSkinThread
+// Skins batches of meshes on LLThreadScheduler workers when there is a
+// scheduler.
+//-----------------------------------------------------------------------------
+class LLAvatarSkinThread : public LLQueuedThread
+{
+public:
+	class SkinRequest : public LLQueuedThread::QueuedRequest
+	{
+	protected:
+		virtual ~SkinRequest(); // use deleteRequest()
+
+	public:
+		SkinRequest(handle_t handle, std::vector<LLSkinnedMesh*>::const_iterator begin,
+					std::vector<LLSkinnedMesh*>::const_iterator end);
+
+		/*virtual*/ bool processRequest();
+
+	private:
+		std::vector<LLSkinnedMesh*> mMeshes;
+	};
+
+	LLAvatarSkinThread(bool threaded = true, U32 concurrency = 1);
+
+	// Queues skinning meshes.  Nothing may touch the meshes or where they
+	// skin to until finishBatch() returns.  Leaves meshes empty.
+	void queueSkin(std::vector<LLSkinnedMesh*>& meshes);
+
+	// Waits for every mesh queued since the last call, skinning queued
+	// ones meanwhile.
+	void finishBatch();
+
+private:
+	std::vector<handle_t> mPending;
+};
+
+#endif // LL_LLAVATARSKIN_H
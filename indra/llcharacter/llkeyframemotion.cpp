@@ -37,6 +37,7 @@
 #include "llcriticaldamp.h"
 #include "lldir.h"
 #include "llendianswizzle.h"
+#include "llfasttimer.h"
 #include "llkeyframemotion.h"
 #include "llquantize.h"
 #include "llvfile.h"
@@ -127,6 +128,53 @@ U32 LLKeyframeMotion::JointMotionList::dumpDiagInfo()
 //-----------------------------------------------------------------------------
 
 
+//-----------------------------------------------------------------------------
+// findKey()
+// Returns the index of the first key at or after time, or times.size() if
+// time is past the last key. Animations are played forward so the answer is
+// almost always the previous one or the one after it; only fall back to a
+// binary search when the cursor is off.
+//-----------------------------------------------------------------------------
+static S32 findKey(const std::vector<F32>& times, F32 time, S32& cursor)
+{
+	const S32 count = (S32)times.size();
+	for (S32 right = cursor; right <= cursor + 1 && right <= count; ++right)
+	{
+		if ((right == count || times[right] >= time)
+			&& (right == 0 || times[right - 1] < time))
+		{
+			cursor = right;
+			return right;
+		}
+	}
+	cursor = std::lower_bound(times.begin(), times.end(), time) - times.begin();
+	return cursor;
+}
+
+//-----------------------------------------------------------------------------
+// insertKeyTime()
+// Returns where a key at time belongs in times, inserting the time unless a
+// key already exists there.
+//-----------------------------------------------------------------------------
+static S32 insertKeyTime(std::vector<F32>& times, F32 time, bool& replace)
+{
+	// keys are stored in time order, so appending is the common case
+	if (times.empty() || times.back() < time)
+	{
+		replace = false;
+		times.push_back(time);
+		return times.size() - 1;
+	}
+	std::vector<F32>::iterator iter = std::lower_bound(times.begin(), times.end(), time);
+	S32 index = iter - times.begin();
+	replace = (*iter == time);
+	if (!replace)
+	{
+		times.insert(iter, time);
+	}
+	return index;
+}
+
 //-----------------------------------------------------------------------------
 // ScaleCurve::ScaleCurve()
 //-----------------------------------------------------------------------------
@@ -141,51 +189,65 @@ LLKeyframeMotion::ScaleCurve::ScaleCurve()
 //-----------------------------------------------------------------------------
 LLKeyframeMotion::ScaleCurve::~ScaleCurve() 
 {
-	mKeys.clear();
+	mKeyTimes.clear();
+	mKeyScales.clear();
 	mNumKeys = 0;
 }
 
+//-----------------------------------------------------------------------------
+// addKey()
+//-----------------------------------------------------------------------------
+void LLKeyframeMotion::ScaleCurve::addKey(const ScaleKey& key)
+{
+	bool replace;
+	S32 index = insertKeyTime(mKeyTimes, key.mTime, replace);
+	if (replace)
+	{
+		mKeyScales[index] = key.mScale;
+	}
+	else
+	{
+		mKeyScales.insert(mKeyScales.begin() + index, key.mScale);
+	}
+}
+
 //-----------------------------------------------------------------------------
 // getValue()
 //-----------------------------------------------------------------------------
 LLVector3 LLKeyframeMotion::ScaleCurve::getValue(F32 time, F32 duration)
+{
+	S32 cursor = 0;
+	return getValue(time, duration, cursor);
+}
+
+LLVector3 LLKeyframeMotion::ScaleCurve::getValue(F32 time, F32 duration, S32& cursor)
 {
 	LLVector3 value;
 
-	if (mKeys.empty())
+	if (mKeyTimes.empty())
 	{
 		value.clearVec();
 		return value;
 	}
 	
-	key_map_t::iterator right = mKeys.lower_bound(time);
-	if (right == mKeys.end())
+	S32 right = findKey(mKeyTimes, time, cursor);
+	if (right == (S32)mKeyTimes.size())
 	{
 		// Past last key
-		--right;
-		value = right->second.mScale;
+		value = mKeyScales[right - 1];
 	}
-	else if (right == mKeys.begin() || right->first == time)
+	else if (right == 0 || mKeyTimes[right] == time)
 	{
 		// Before first key or exactly on a key
-		value = right->second.mScale;
+		value = mKeyScales[right];
 	}
 	else
 	{
 		// Between two keys
-		key_map_t::iterator left = right; --left;
-		F32 index_before = left->first;
-		F32 index_after = right->first;
-		ScaleKey& scale_before = left->second;
-		ScaleKey& scale_after = right->second;
-		if (right == mKeys.end())
-		{
-			scale_after = mLoopInKey;
-			index_after = duration;
-		}
-
+		F32 index_before = mKeyTimes[right - 1];
+		F32 index_after = mKeyTimes[right];
 		F32 u = (time - index_before) / (index_after - index_before);
-		value = interp(u, scale_before, scale_after);
+		value = interp(u, mKeyScales[right - 1], mKeyScales[right]);
 	}
 	return value;
 }
@@ -193,17 +255,17 @@ LLVector3 LLKeyframeMotion::ScaleCurve::getValue(F32 time, F32 duration)
 //-----------------------------------------------------------------------------
 // interp()
 //-----------------------------------------------------------------------------
-LLVector3 LLKeyframeMotion::ScaleCurve::interp(F32 u, ScaleKey& before, ScaleKey& after)
+LLVector3 LLKeyframeMotion::ScaleCurve::interp(F32 u, const LLVector3& before, const LLVector3& after)
 {
 	switch (mInterpolationType)
 	{
 	case IT_STEP:
-		return before.mScale;
+		return before;
 
 	default:
 	case IT_LINEAR:
 	case IT_SPLINE:
-		return lerp(before.mScale, after.mScale, u);
+		return lerp(before, after, u);
 	}
 }
 
@@ -221,69 +283,100 @@ LLKeyframeMotion::RotationCurve::RotationCurve()
 //-----------------------------------------------------------------------------
 LLKeyframeMotion::RotationCurve::~RotationCurve()
 {
-	mKeys.clear();
+	mKeyTimes.clear();
+	mKeyRotations.clear();
 	mNumKeys = 0;
 }
 
 //-----------------------------------------------------------------------------
-// RotationCurve::getValue()
+// addKey()
 //-----------------------------------------------------------------------------
-LLQuaternion LLKeyframeMotion::RotationCurve::getValue(F32 time, F32 duration)
+void LLKeyframeMotion::RotationCurve::addKey(const RotationKey& key)
 {
-	LLQuaternion value;
-
-	if (mKeys.empty())
+	bool replace;
+	S32 index = insertKeyTime(mKeyTimes, key.mTime, replace);
+	if (replace)
 	{
-		value = LLQuaternion::DEFAULT;
-		return value;
+		mKeyRotations[index] = key.mRotation;
 	}
-	
-	key_map_t::iterator right = mKeys.lower_bound(time);
-	if (right == mKeys.end())
+	else
+	{
+		mKeyRotations.insert(mKeyRotations.begin() + index, key.mRotation);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// RotationCurve::getSegment()
+//-----------------------------------------------------------------------------
+bool LLKeyframeMotion::RotationCurve::getSegment(F32 time, S32& cursor, S32& before, F32& u) const
+{
+	llassert(!mKeyTimes.empty());
+
+	S32 right = findKey(mKeyTimes, time, cursor);
+	if (right == (S32)mKeyTimes.size())
 	{
 		// Past last key
-		--right;
-		value = right->second.mRotation;
+		before = right - 1;
+		return false;
 	}
-	else if (right == mKeys.begin() || right->first == time)
+	if (right == 0 || mKeyTimes[right] == time)
 	{
 		// Before first key or exactly on a key
-		value = right->second.mRotation;
+		before = right;
+		return false;
 	}
-	else
+
+	// Between two keys
+	before = right - 1;
+	if (mInterpolationType == IT_STEP)
 	{
-		// Between two keys
-		key_map_t::iterator left = right; --left;
-		F32 index_before = left->first;
-		F32 index_after = right->first;
-		RotationKey& rot_before = left->second;
-		RotationKey& rot_after = right->second;
-		if (right == mKeys.end())
-		{
-			rot_after = mLoopInKey;
-			index_after = duration;
-		}
+		return false;
+	}
+	F32 index_before = mKeyTimes[right - 1];
+	F32 index_after = mKeyTimes[right];
+	u = (time - index_before) / (index_after - index_before);
+	return true;
+}
 
-		F32 u = (time - index_before) / (index_after - index_before);
-		value = interp(u, rot_before, rot_after);
+//-----------------------------------------------------------------------------
+// RotationCurve::getValue()
+//-----------------------------------------------------------------------------
+LLQuaternion LLKeyframeMotion::RotationCurve::getValue(F32 time, F32 duration)
+{
+	S32 cursor = 0;
+	return getValue(time, duration, cursor);
+}
+
+LLQuaternion LLKeyframeMotion::RotationCurve::getValue(F32 time, F32 duration, S32& cursor)
+{
+	if (mKeyTimes.empty())
+	{
+		return LLQuaternion::DEFAULT;
 	}
-	return value;
+
+	S32 before;
+	F32 u;
+	if (!getSegment(time, cursor, before, u))
+	{
+		return mKeyRotations[before];
+	}
+	return interp(u, mKeyRotations[before], mKeyRotations[before + 1]);
 }
 
 //-----------------------------------------------------------------------------
 // interp()
 //-----------------------------------------------------------------------------
-LLQuaternion LLKeyframeMotion::RotationCurve::interp(F32 u, RotationKey& before, RotationKey& after)
+LLQuaternion LLKeyframeMotion::RotationCurve::interp(F32 u, const LLQuaternion& before, const LLQuaternion& after)
 {
 	switch (mInterpolationType)
 	{
 	case IT_STEP:
-		return before.mRotation;
+		return before;
 
 	default:
 	case IT_LINEAR:
 	case IT_SPLINE:
-		return nlerp(u, before.mRotation, after.mRotation);
+		return nlerp(u, before, after);
 	}
 }
 
@@ -302,51 +395,65 @@ LLKeyframeMotion::PositionCurve::PositionCurve()
 //-----------------------------------------------------------------------------
 LLKeyframeMotion::PositionCurve::~PositionCurve()
 {
-	mKeys.clear();
+	mKeyTimes.clear();
+	mKeyPositions.clear();
 	mNumKeys = 0;
 }
 
+//-----------------------------------------------------------------------------
+// addKey()
+//-----------------------------------------------------------------------------
+void LLKeyframeMotion::PositionCurve::addKey(const PositionKey& key)
+{
+	bool replace;
+	S32 index = insertKeyTime(mKeyTimes, key.mTime, replace);
+	if (replace)
+	{
+		mKeyPositions[index] = key.mPosition;
+	}
+	else
+	{
+		mKeyPositions.insert(mKeyPositions.begin() + index, key.mPosition);
+	}
+}
+
 //-----------------------------------------------------------------------------
 // PositionCurve::getValue()
 //-----------------------------------------------------------------------------
 LLVector3 LLKeyframeMotion::PositionCurve::getValue(F32 time, F32 duration)
+{
+	S32 cursor = 0;
+	return getValue(time, duration, cursor);
+}
+
+LLVector3 LLKeyframeMotion::PositionCurve::getValue(F32 time, F32 duration, S32& cursor)
 {
 	LLVector3 value;
 
-	if (mKeys.empty())
+	if (mKeyTimes.empty())
 	{
 		value.clearVec();
 		return value;
 	}
 	
-	key_map_t::iterator right = mKeys.lower_bound(time);
-	if (right == mKeys.end())
+	S32 right = findKey(mKeyTimes, time, cursor);
+	if (right == (S32)mKeyTimes.size())
 	{
 		// Past last key
-		--right;
-		value = right->second.mPosition;
+		value = mKeyPositions[right - 1];
 	}
-	else if (right == mKeys.begin() || right->first == time)
+	else if (right == 0 || mKeyTimes[right] == time)
 	{
 		// Before first key or exactly on a key
-		value = right->second.mPosition;
+		value = mKeyPositions[right];
 	}
 	else
 	{
 		// Between two keys
-		key_map_t::iterator left = right; --left;
-		F32 index_before = left->first;
-		F32 index_after = right->first;
-		PositionKey& pos_before = left->second;
-		PositionKey& pos_after = right->second;
-		if (right == mKeys.end())
-		{
-			pos_after = mLoopInKey;
-			index_after = duration;
-		}
-
+		F32 index_before = mKeyTimes[right - 1];
+		F32 index_after = mKeyTimes[right];
 		F32 u = (time - index_before) / (index_after - index_before);
-		value = interp(u, pos_before, pos_after);
+		value = interp(u, mKeyPositions[right - 1], mKeyPositions[right]);
 	}
 
 	llassert(value.isFinite());
@@ -357,17 +464,65 @@ LLVector3 LLKeyframeMotion::PositionCurve::getValue(F32 time, F32 duration)
 //-----------------------------------------------------------------------------
 // interp()
 //-----------------------------------------------------------------------------
-LLVector3 LLKeyframeMotion::PositionCurve::interp(F32 u, PositionKey& before, PositionKey& after)
+LLVector3 LLKeyframeMotion::PositionCurve::interp(F32 u, const LLVector3& before, const LLVector3& after)
 {
 	switch (mInterpolationType)
 	{
 	case IT_STEP:
-		return before.mPosition;
+		return before;
 	default:
 	case IT_LINEAR:
 	case IT_SPLINE:
-		return lerp(before.mPosition, after.mPosition, u);
+		return lerp(before, after, u);
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// RotationBatch class
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// RotationBatch::clear()
+//-----------------------------------------------------------------------------
+void LLKeyframeMotion::RotationBatch::clear()
+{
+	// keeps the capacity, the same motion fills the batch every frame
+	mJointStates.clear();
+	mBefore.clear();
+	mAfter.clear();
+	mU.clear();
+}
+
+//-----------------------------------------------------------------------------
+// RotationBatch::add()
+//-----------------------------------------------------------------------------
+void LLKeyframeMotion::RotationBatch::add(LLJointState* joint_state, const LLQuaternion& before, const LLQuaternion& after, F32 u)
+{
+	mJointStates.push_back(joint_state);
+	mBefore.push_back(before);
+	mAfter.push_back(after);
+	mU.push_back(u);
+}
+
+//-----------------------------------------------------------------------------
+// RotationBatch::apply()
+//-----------------------------------------------------------------------------
+void LLKeyframeMotion::RotationBatch::apply()
+{
+	if (mJointStates.empty())
+	{
+		return;
+	}
+	// results go over the "before" rotations
+	nlerp_batch(mU.size(), &mU[0], &mBefore[0], &mAfter[0], &mBefore[0]);
+	for (U32 i = 0; i < mJointStates.size(); i++)
+	{
+		mJointStates[i]->setRotation(mBefore[i]);
 	}
+	clear();
 }
 
 
@@ -381,6 +536,14 @@ LLVector3 LLKeyframeMotion::PositionCurve::interp(F32 u, PositionKey& before, Po
 // JointMotion::update()
 //-----------------------------------------------------------------------------
 void LLKeyframeMotion::JointMotion::update(LLJointState* joint_state, F32 time, F32 duration)
+{
+	KeyCursor cursor;
+	RotationBatch batch;
+	update(joint_state, time, duration, cursor, batch);
+	batch.apply();
+}
+
+void LLKeyframeMotion::JointMotion::update(LLJointState* joint_state, F32 time, F32 duration, KeyCursor& cursor, RotationBatch& batch)
 {
 	// this value being 0 is the cause of https://jira.lindenlab.com/browse/SL-22678 but I haven't 
 	// managed to get a stack to see how it got here. Testing for 0 here will stop the crash.
@@ -396,7 +559,7 @@ void LLKeyframeMotion::JointMotion::update(LLJointState* joint_state, F32 time,
 	//-------------------------------------------------------------------------
 	if ((usage & LLJointState::SCALE) && mScaleCurve.mNumKeys)
 	{
-		joint_state->setScale( mScaleCurve.getValue( time, duration ) );
+		joint_state->setScale( mScaleCurve.getValue( time, duration, cursor.mScale ) );
 	}
 
 	//-------------------------------------------------------------------------
@@ -404,7 +567,16 @@ void LLKeyframeMotion::JointMotion::update(LLJointState* joint_state, F32 time,
 	//-------------------------------------------------------------------------
 	if ((usage & LLJointState::ROT) && mRotationCurve.mNumKeys)
 	{
-		joint_state->setRotation( mRotationCurve.getValue( time, duration ) );
+		S32 before;
+		F32 u;
+		if (mRotationCurve.getSegment(time, cursor.mRotation, before, u))
+		{
+			batch.add(joint_state, mRotationCurve.mKeyRotations[before], mRotationCurve.mKeyRotations[before + 1], u);
+		}
+		else
+		{
+			joint_state->setRotation( mRotationCurve.mKeyRotations[before] );
+		}
 	}
 
 	//-------------------------------------------------------------------------
@@ -412,7 +584,7 @@ void LLKeyframeMotion::JointMotion::update(LLJointState* joint_state, F32 time,
 	//-------------------------------------------------------------------------
 	if ((usage & LLJointState::POS) && mPositionCurve.mNumKeys)
 	{
-		joint_state->setPosition( mPositionCurve.getValue( time, duration ) );
+		joint_state->setPosition( mPositionCurve.getValue( time, duration, cursor.mPosition ) );
 	}
 }
 
@@ -668,8 +840,11 @@ BOOL LLKeyframeMotion::onActivate()
 //-----------------------------------------------------------------------------
 // LLKeyframeMotion::onUpdate()
 //-----------------------------------------------------------------------------
+static LLFastTimer::DeclareTimer FTM_KEYFRAME_MOTION("Keyframe Motion");
+
 BOOL LLKeyframeMotion::onUpdate(F32 time, U8* joint_mask)
 {
+	LLFastTimer t(FTM_KEYFRAME_MOTION);
 	llassert(time >= 0.f);
 
 	if (mJointMotionList->mLoop)
@@ -721,12 +896,20 @@ BOOL LLKeyframeMotion::onUpdate(F32 time, U8* joint_mask)
 void LLKeyframeMotion::applyKeyframes(F32 time)
 {
 	llassert_always (mJointMotionList->getNumJointMotions() <= mJointStates.size());
+	if (mKeyCursors.size() != mJointMotionList->getNumJointMotions())
+	{
+		mKeyCursors.clear();
+		mKeyCursors.resize(mJointMotionList->getNumJointMotions());
+	}
 	for (U32 i=0; i<mJointMotionList->getNumJointMotions(); i++)
 	{
 		mJointMotionList->getJointMotion(i)->update(mJointStates[i],
 													  time, 
-													  mJointMotionList->mDuration );
+													  mJointMotionList->mDuration,
+													  mKeyCursors[i],
+													  mRotationBatch );
 	}
+	mRotationBatch.apply();
 
 	LLJoint::JointPriority* pose_priority = (LLJoint::JointPriority* )mCharacter->getAnimationData("Hand Pose Priority");
 	if (pose_priority)
@@ -1497,7 +1680,7 @@ BOOL LLKeyframeMotion::deserialize(LLDataPacker& dp)
 				return FALSE;
 			}
 
-			rCurve->mKeys[time] = rot_key;
+			rCurve->addKey(rot_key);
 		}
 
 		//---------------------------------------------------------------------
@@ -1576,7 +1759,7 @@ BOOL LLKeyframeMotion::deserialize(LLDataPacker& dp)
 				return FALSE;
 			}
 			
-			pCurve->mKeys[pos_key.mTime] = pos_key;
+			pCurve->addKey(pos_key);
 
 			if (is_pelvis)
 			{
@@ -1827,10 +2010,9 @@ BOOL LLKeyframeMotion::serialize(LLDataPacker& dp) const
 		success &= dp.packS32(joint_motionp->mPriority, "joint_priority");
 		success &= dp.packS32(joint_motionp->mRotationCurve.mNumKeys, "num_rot_keys");
 
-		for (RotationCurve::key_map_t::iterator iter = joint_motionp->mRotationCurve.mKeys.begin();
-			 iter != joint_motionp->mRotationCurve.mKeys.end(); ++iter)
+		for (S32 k = 0; k < joint_motionp->mRotationCurve.getKeyCount(); k++)
 		{
-			RotationKey& rot_key = iter->second;
+			RotationKey rot_key = joint_motionp->mRotationCurve.getKey(k);
 			U16 time_short = F32_to_U16(rot_key.mTime, 0.f, mJointMotionList->mDuration);
 			success &= dp.packU16(time_short, "time");
 
@@ -1847,10 +2029,9 @@ BOOL LLKeyframeMotion::serialize(LLDataPacker& dp) const
 		}
 
 		success &= dp.packS32(joint_motionp->mPositionCurve.mNumKeys, "num_pos_keys");
-		for (PositionCurve::key_map_t::iterator iter = joint_motionp->mPositionCurve.mKeys.begin();
-			 iter != joint_motionp->mPositionCurve.mKeys.end(); ++iter)
+		for (S32 k = 0; k < joint_motionp->mPositionCurve.getKeyCount(); k++)
 		{
-			PositionKey& pos_key = iter->second;
+			PositionKey pos_key = joint_motionp->mPositionCurve.getKey(k);
 			U16 time_short = F32_to_U16(pos_key.mTime, 0.f, mJointMotionList->mDuration);
 			success &= dp.packU16(time_short, "time");
 
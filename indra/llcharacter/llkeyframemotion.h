@@ -320,12 +320,20 @@ public:
 		ScaleCurve();
 		~ScaleCurve();
 		LLVector3 getValue(F32 time, F32 duration);
-		LLVector3 interp(F32 u, ScaleKey& before, ScaleKey& after);
+		// cursor is the key the last lookup on this curve ended on, it makes
+		// playing forward (or standing still) a constant time lookup
+		LLVector3 getValue(F32 time, F32 duration, S32& cursor);
+		LLVector3 interp(F32 u, const LLVector3& before, const LLVector3& after);
+		// inserts in time order, replacing any key at the same time
+		void addKey(const ScaleKey& key);
+		ScaleKey getKey(S32 index) const { return ScaleKey(mKeyTimes[index], mKeyScales[index]); }
+		S32 getKeyCount() const { return mKeyTimes.size(); }
 
 		InterpolationType	mInterpolationType;
 		S32					mNumKeys;
-		typedef std::map<F32, ScaleKey> key_map_t;
-		key_map_t 			mKeys;
+		// keys sorted by time, as parallel arrays so the search only touches times
+		std::vector<F32>		mKeyTimes;
+		std::vector<LLVector3>	mKeyScales;
 		ScaleKey			mLoopInKey;
 		ScaleKey			mLoopOutKey;
 	};
@@ -339,12 +347,20 @@ public:
 		RotationCurve();
 		~RotationCurve();
 		LLQuaternion getValue(F32 time, F32 duration);
-		LLQuaternion interp(F32 u, RotationKey& before, RotationKey& after);
+		LLQuaternion getValue(F32 time, F32 duration, S32& cursor);
+		// Finds the keys around time. Returns true with u set if the value
+		// is an interpolation from key before to key before + 1, false if it
+		// is key before itself.
+		bool getSegment(F32 time, S32& cursor, S32& before, F32& u) const;
+		LLQuaternion interp(F32 u, const LLQuaternion& before, const LLQuaternion& after);
+		void addKey(const RotationKey& key);
+		RotationKey getKey(S32 index) const { return RotationKey(mKeyTimes[index], mKeyRotations[index]); }
+		S32 getKeyCount() const { return mKeyTimes.size(); }
 
 		InterpolationType	mInterpolationType;
 		S32					mNumKeys;
-		typedef std::map<F32, RotationKey> key_map_t;
-		key_map_t		mKeys;
+		std::vector<F32>			mKeyTimes;
+		std::vector<LLQuaternion>	mKeyRotations;
 		RotationKey		mLoopInKey;
 		RotationKey		mLoopOutKey;
 	};
@@ -358,16 +374,54 @@ public:
 		PositionCurve();
 		~PositionCurve();
 		LLVector3 getValue(F32 time, F32 duration);
-		LLVector3 interp(F32 u, PositionKey& before, PositionKey& after);
+		LLVector3 getValue(F32 time, F32 duration, S32& cursor);
+		LLVector3 interp(F32 u, const LLVector3& before, const LLVector3& after);
+		void addKey(const PositionKey& key);
+		PositionKey getKey(S32 index) const { return PositionKey(mKeyTimes[index], mKeyPositions[index]); }
+		S32 getKeyCount() const { return mKeyTimes.size(); }
 
 		InterpolationType	mInterpolationType;
 		S32					mNumKeys;
-		typedef std::map<F32, PositionKey> key_map_t;
-		key_map_t		mKeys;
+		std::vector<F32>		mKeyTimes;
+		std::vector<LLVector3>	mKeyPositions;
 		PositionKey		mLoopInKey;
 		PositionKey		mLoopOutKey;
 	};
 
+	//-------------------------------------------------------------------------
+	// KeyCursor
+	// Per motion instance lookup hints into one joint's (shared) curves
+	//-------------------------------------------------------------------------
+	class KeyCursor
+	{
+	public:
+		KeyCursor() : mPosition(0), mRotation(0), mScale(0) {}
+
+		S32 mPosition;
+		S32 mRotation;
+		S32 mScale;
+	};
+
+	//-------------------------------------------------------------------------
+	// RotationBatch
+	// Rotation interpolations gathered over all joints of a motion, so they
+	// can go through nlerp_batch() in one pass
+	//-------------------------------------------------------------------------
+	class RotationBatch
+	{
+	public:
+		void clear();
+		void add(LLJointState* joint_state, const LLQuaternion& before, const LLQuaternion& after, F32 u);
+		// interpolates everything and sets the joint states
+		void apply();
+
+	private:
+		std::vector<LLJointState*>	mJointStates;
+		std::vector<LLQuaternion>	mBefore;
+		std::vector<LLQuaternion>	mAfter;
+		std::vector<F32>			mU;
+	};
+
 	//-------------------------------------------------------------------------
 	// JointMotion
 	//-------------------------------------------------------------------------
@@ -382,6 +436,8 @@ public:
 		LLJoint::JointPriority	mPriority;
 
 		void update(LLJointState* joint_state, F32 time, F32 duration);
+		// rotations that need interpolating are queued on batch instead of set
+		void update(LLJointState* joint_state, F32 time, F32 duration, KeyCursor& cursor, RotationBatch& batch);
 	};
 	
 	//-------------------------------------------------------------------------
@@ -432,6 +488,8 @@ protected:
 	F32								mLastUpdateTime;
 	F32								mLastLoopedTime;
 	AssetStatus						mAssetStatus;
+	std::vector<KeyCursor>			mKeyCursors;	// one per joint motion
+	RotationBatch					mRotationBatch;
 };
 
 class LLKeyframeDataCache
@@ -0,0 +1,126 @@
+/**
+ * @file llalignedarray.h
+ * @brief A growable array of plain old data kept on a 16 byte boundary.
+ *
+ * $LicenseInfo:firstyear=2011&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2011, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLALIGNEDARRAY_H
+#define LL_LLALIGNEDARRAY_H
+
+#include "llmemory.h"
+
+#include <string.h>
+
+// std::vector makes no promise about alignment past what new gives, which
+// is 8 bytes on most of our platforms. This keeps its elements on a 16 byte
+// boundary so SSE code can use aligned loads and stores on them. T must be
+// plain old data: elements are moved with memcpy() and new ones are zeroed
+// rather than constructed.
+template <class T> class LLAlignedArray
+{
+public:
+	LLAlignedArray() : mArray(NULL), mElementCount(0), mCapacity(0) { }
+
+	LLAlignedArray(const LLAlignedArray<T>& other)
+	:	mArray(NULL), mElementCount(0), mCapacity(0)
+	{
+		*this = other;
+	}
+
+	~LLAlignedArray()
+	{
+		ll_aligned_free_16(mArray);
+	}
+
+	LLAlignedArray<T>& operator=(const LLAlignedArray<T>& other)
+	{
+		if (this != &other)
+		{
+			mElementCount = 0;
+			reserve(other.mElementCount);
+			if (other.mElementCount)
+			{
+				memcpy(mArray, other.mArray, sizeof(T) * other.mElementCount);
+			}
+			mElementCount = other.mElementCount;
+		}
+		return *this;
+	}
+
+	U32 size() const								{ return mElementCount; }
+	bool empty() const								{ return mElementCount == 0; }
+	void clear()									{ mElementCount = 0; }
+
+	T* getData()									{ return mArray; }
+	const T* getData() const						{ return mArray; }
+
+	T& operator[](U32 idx)							{ return mArray[idx]; }
+	const T& operator[](U32 idx) const				{ return mArray[idx]; }
+
+	void push_back(const T& elem)
+	{
+		if (mElementCount == mCapacity)
+		{
+			reserve(mCapacity ? mCapacity * 2 : 16);
+		}
+		mArray[mElementCount++] = elem;
+	}
+
+	// Grows with zeroed elements, shrinking keeps the storage.
+	void resize(U32 size)
+	{
+		reserve(size);
+		if (size > mElementCount)
+		{
+			memset(mArray + mElementCount, 0, sizeof(T) * (size - mElementCount));
+		}
+		mElementCount = size;
+	}
+
+	void reserve(U32 capacity)
+	{
+		if (capacity <= mCapacity)
+		{
+			return;
+		}
+		T* new_array = (T*)ll_aligned_malloc_16(sizeof(T) * capacity);
+		if (!new_array)
+		{
+			llerrs << "Out of memory growing an aligned array to " << capacity << " elements" << llendl;
+		}
+		if (mElementCount)
+		{
+			memcpy(new_array, mArray, sizeof(T) * mElementCount);
+		}
+		ll_aligned_free_16(mArray);
+		mArray = new_array;
+		mCapacity = capacity;
+	}
+
+private:
+	T* mArray;
+	U32 mElementCount;
+	U32 mCapacity;
+};
+
+#endif // LL_LLALIGNEDARRAY_H
@@ -50,6 +50,20 @@ void LLFrameTimer::updateFrameTime()
 	sFrameTime = U64_to_F64(sTotalTime - sStartTotalTime) * USEC_TO_SEC_F64;
 } 
 
+// static
+void LLFrameTimer::stepFrameTime(F64 seconds)
+{
+	if (sTotalTime < sStartTotalTime)
+	{
+		// never updated, start from the start of the application
+		sTotalTime = sStartTotalTime;
+	}
+	sFrameDeltaTime = (U64)(seconds * USEC_PER_SECOND);
+	sTotalTime += sFrameDeltaTime;
+	sTotalSeconds = U64_to_F64(sTotalTime) * USEC_TO_SEC_F64;
+	sFrameTime = U64_to_F64(sTotalTime - sStartTotalTime) * USEC_TO_SEC_F64;
+}
+
 void LLFrameTimer::start()
 {
 	reset();
@@ -66,6 +66,10 @@ public:
 	// at some other times as well
 	static void updateFrameTime();
 
+	// Moves the frame time on by a fixed step instead of reading the clock,
+	// for playing back simulations faster than real time
+	static void stepFrameTime(F64 seconds);
+
 	// Call this method once, and only once, per frame to update the current frame count.
 	static void updateFrameCount()					{ sFrameCount++; }
 
@@ -26,7 +26,10 @@
 #ifndef LLMEMORY_H
 #define LLMEMORY_H
 
-
+#include <stdlib.h>
+#if LL_WINDOWS
+#include <malloc.h>
+#endif
 
 extern S32 gTotalDAlloc;
 extern S32 gTotalDAUse;
@@ -48,6 +51,33 @@ private:
 	static char* reserveMem;
 };
 
+// Allocates size bytes on a 16 byte boundary, as SSE loads and stores want.
+// The block MUST be released with ll_aligned_free_16().
+inline void* ll_aligned_malloc_16(size_t size)
+{
+#if LL_WINDOWS
+	return _aligned_malloc(size, 16);
+#elif LL_DARWIN
+	return malloc(size); // malloc on OS X is already 16 byte aligned
+#else
+	void* rtn;
+	if (LL_LIKELY(0 == posix_memalign(&rtn, 16, size)))
+	{
+		return rtn;
+	}
+	return NULL;
+#endif
+}
+
+inline void ll_aligned_free_16(void* p)
+{
+#if LL_WINDOWS
+	_aligned_free(p);
+#else
+	free(p);
+#endif
+}
+
 // LLRefCount moved to llrefcount.h
 
 // LLPointer moved to llpointer.h
@@ -103,7 +103,8 @@ namespace
 		eL2Associativity,
 		eCacheSizeK,
 		eFeatureBits,
-		eExtFeatureBits
+		eExtFeatureBits,
+		eLogicalCPUs
 	};
 
 	const char* cpu_config_names[] =
@@ -116,7 +117,8 @@ namespace
 		"L2 Associativity",
 		"Cache Size",
 		"Feature Bits",
-		"Ext. Feature Bits"
+		"Ext. Feature Bits",
+		"Logical CPUs"
 	};
 
 
@@ -275,6 +277,12 @@ public:
 		return hasExtension("Altivec"); 
 	}
 
+	S32 getNumLogicalCPUs() const
+	{
+		S32 count = getConfig(eLogicalCPUs, 1).asInteger();
+		return count > 0 ? count : 1;
+	}
+
 	std::string getCPUFamilyName() const { return getInfo(eFamilyName, "Unknown").asString(); }
 	std::string getCPUBrandName() const { return getInfo(eBrandName, "Unknown").asString(); }
 
@@ -470,6 +478,10 @@ public:
 	{
 		getCPUIDInfo();
 		setInfo(eFrequency, calculate_cpu_frequency(50));
+
+		SYSTEM_INFO sys_info;
+		GetSystemInfo(&sys_info);
+		setConfig(eLogicalCPUs, (S32)sys_info.dwNumberOfProcessors);
 	}
 
 private:
@@ -595,6 +607,7 @@ public:
 		getCPUIDInfo();
 		uint64_t frequency = getSysctlInt64("hw.cpufrequency");
 		setInfo(eFrequency, (F64)frequency  / (F64)1000000);
+		setConfig(eLogicalCPUs, getSysctlInt("hw.logicalcpu"));
 	}
 
 	virtual ~LLProcessorInfoDarwinImpl() {}
@@ -714,6 +727,8 @@ private:
 };
 
 #elif LL_LINUX
+#include <unistd.h>
+
 const char CPUINFO_FILE[] = "/proc/cpuinfo";
 
 class LLProcessorInfoLinuxImpl : public LLProcessorInfoImpl
@@ -722,6 +737,7 @@ public:
 	LLProcessorInfoLinuxImpl() 
 	{
 		get_proc_cpuinfo();
+		setConfig(eLogicalCPUs, (S32)sysconf(_SC_NPROCESSORS_ONLN));
 	}
 
 	virtual ~LLProcessorInfoLinuxImpl() {}
@@ -881,6 +897,7 @@ F64 LLProcessorInfo::getCPUFrequency() const { return mImpl->getCPUFrequency();
 bool LLProcessorInfo::hasSSE() const { return mImpl->hasSSE(); }
 bool LLProcessorInfo::hasSSE2() const { return mImpl->hasSSE2(); }
 bool LLProcessorInfo::hasAltivec() const { return mImpl->hasAltivec(); }
+S32 LLProcessorInfo::getNumLogicalCPUs() const { return mImpl->getNumLogicalCPUs(); }
 std::string LLProcessorInfo::getCPUFamilyName() const { return mImpl->getCPUFamilyName(); }
 std::string LLProcessorInfo::getCPUBrandName() const { return mImpl->getCPUBrandName(); }
 std::string LLProcessorInfo::getCPUFeatureDescription() const { return mImpl->getCPUFeatureDescription(); }
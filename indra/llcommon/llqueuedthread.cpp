@@ -27,21 +27,38 @@
 #include "llqueuedthread.h"
 
 #include "llstl.h"
+#include "llthreadscheduler.h"
 #include "lltimer.h"	// ms_sleep()
 
+// How long a scheduler worker sticks with one queue before giving others a turn
+const F64 SCHEDULED_TIME_SLICE = 0.005;
+
 //============================================================================
 
 // MAIN THREAD
-LLQueuedThread::LLQueuedThread(const std::string& name, bool threaded) :
+LLQueuedThread::LLQueuedThread(const std::string& name, bool threaded, U32 scheduled_concurrency) :
 	LLThread(name),
 	mThreaded(threaded),
 	mIdleThread(TRUE),
 	mNextHandle(0),
-	mStarted(FALSE)
+	mStarted(FALSE),
+	mScheduler(NULL),
+	mMaxConcurrency(0),
+	mScheduledTasks(0)
 {
 	if (mThreaded)
 	{
-		start();
+		if (scheduled_concurrency > 0 && LLThreadScheduler::getInstance())
+		{
+			// No thread of our own, requests run on the scheduler's workers.
+			mScheduler = LLThreadScheduler::getInstance();
+			mMaxConcurrency = (S32)llmin(scheduled_concurrency, mScheduler->getNumWorkers());
+			mStatus = RUNNING;
+		}
+		else
+		{
+			start();
+		}
 	}
 }
 
@@ -61,7 +78,35 @@ void LLQueuedThread::shutdown()
 	setQuitting();
 
 	unpause(); // MAIN THREAD
-	if (mThreaded)
+	if (mScheduler)
+	{
+		// Let the workers abort whatever is queued, then wait for them to let go
+		scheduleWork();
+		S32 timeout = 100;
+		for ( ; timeout>0; timeout--)
+		{
+			lockData();
+			bool busy = mScheduledTasks > 0;
+			unlockData();
+			if (!busy)
+			{
+				break;
+			}
+			ms_sleep(100);
+			LLThread::yield();
+		}
+		if (timeout == 0)
+		{
+			llwarns << "~LLQueuedThread (" << mName << ") timed out waiting for the scheduler!" << llendl;
+		}
+		if (mStarted)
+		{
+			endThread();
+			mStarted = FALSE;
+		}
+		mStatus = STOPPED;
+	}
+	else if (mThreaded)
 	{
 		S32 timeout = 100;
 		for ( ; timeout>0; timeout--)
@@ -129,8 +174,12 @@ S32 LLQueuedThread::updateQueue(U32 max_time_ms)
 		pending = getPending();
 		if(pending > 0)
 		{
-		unpause();
-	}
+			unpause();
+			if (mScheduler)
+			{
+				scheduleWork();
+			}
+		}
 	}
 	else
 	{
@@ -149,13 +198,83 @@ void LLQueuedThread::incQueue()
 	// Something has been added to the queue
 	if (!isPaused())
 	{
-		if (mThreaded)
+		if (mScheduler)
+		{
+			scheduleWork();
+		}
+		else if (mThreaded)
 		{
 			wake(); // Wake the thread up if necessary.
 		}
 	}
 }
 
+// May be called from any thread
+// Hands this queue to the scheduler, once per pending request up to mMaxConcurrency
+void LLQueuedThread::scheduleWork()
+{
+	if (isPaused())
+	{
+		return;
+	}
+	S32 new_tasks = 0;
+	lockData();
+	S32 wanted = llmin((S32)mRequestQueue.size(), mMaxConcurrency);
+	if (wanted > mScheduledTasks)
+	{
+		new_tasks = wanted - mScheduledTasks;
+		mScheduledTasks = wanted;
+		mIdleThread = FALSE;
+	}
+	unlockData();
+	for (S32 i = 0; i < new_tasks; ++i)
+	{
+		mScheduler->schedule(this);
+	}
+}
+
+// Runs on a SCHEDULER WORKER thread
+// Returns true if the worker should keep this queue on its deque.
+bool LLQueuedThread::processScheduled()
+{
+	if (!mStarted)
+	{
+		lockData();
+		if (!mStarted)
+		{
+			startThread();
+			mStarted = TRUE;
+		}
+		unlockData();
+	}
+
+	LLTimer timer;
+	threadedUpdate();
+	S32 pending = 1;
+	while (pending > 0 && !isPaused() && timer.getElapsedTimeF64() < SCHEDULED_TIME_SLICE)
+	{
+		pending = processNextRequest();
+	}
+
+	bool more_work = false;
+	lockData();
+	if (!isPaused() && (S32)mRequestQueue.size() >= mScheduledTasks)
+	{
+		more_work = true;
+	}
+	else
+	{
+		// Release our slot, scheduleWork() will hand out a new one when needed
+		mScheduledTasks--;
+		if (mScheduledTasks == 0)
+		{
+			mIdleThread = TRUE;
+		}
+	}
+	unlockData();
+	return more_work;
+}
+
 //virtual
 // May be called from any thread
 S32 LLQueuedThread::getPending()
@@ -278,6 +397,31 @@ bool LLQueuedThread::waitForResult(LLQueuedThread::handle_t handle, bool auto_co
 	return res;
 }
 
+// MAIN thread
+LLQueuedThread::status_t LLQueuedThread::waitForRequest(handle_t handle, bool help)
+{
+	status_t status = getRequestStatus(handle);
+	while (status == STATUS_QUEUED || status == STATUS_INPROGRESS)
+	{
+		if (!help || processNextRequest() == 0)
+		{
+			yield();
+		}
+		status = getRequestStatus(handle);
+	}
+	return status;
+}
+
+void LLQueuedThread::waitForRequests(std::vector<handle_t>& handles, bool help)
+{
+	for (std::vector<handle_t>::iterator iter = handles.begin(); iter != handles.end(); ++iter)
+	{
+		waitForRequest(*iter, help);
+		completeRequest(*iter);
+	}
+	handles.clear();
+}
+
 // MAIN thread
 LLQueuedThread::QueuedRequest* LLQueuedThread::getRequest(handle_t handle)
 {
@@ -457,7 +601,7 @@ S32 LLQueuedThread::processNextRequest()
 			req->setStatus(STATUS_QUEUED);
 			mRequestQueue.insert(req);
 			unlockData();
-			if (mThreaded && start_priority < PRIORITY_NORMAL)
+			if (mThreaded && !mScheduler && start_priority < PRIORITY_NORMAL)
 			{
 				ms_sleep(1); // sleep the thread a little
 			}
@@ -31,12 +31,15 @@
 #include <string>
 #include <map>
 #include <set>
+#include <vector>
 
 #include "llapr.h"
 
 #include "llthread.h"
 #include "llsimplehash.h"
 
+class LLThreadScheduler;
+
 //============================================================================
 // Note: ~LLQueuedThread is O(N) N=# of queued threads, assumed to be small
 //   It is assumed that LLQueuedThreads are rarely created/destroyed.
@@ -149,7 +152,11 @@ public:
 	static handle_t nullHandle() { return handle_t(0); }
 	
 public:
-	LLQueuedThread(const std::string& name, bool threaded = true);
+	// scheduled_concurrency > 0 runs this queue on the shared LLThreadScheduler
+	// (when one exists) instead of a thread of its own, on at most that many
+	// scheduler workers at once. Subclasses passing more than 1 must have
+	// thread safe processRequest() and threadedUpdate() implementations.
+	LLQueuedThread(const std::string& name, bool threaded = true, U32 scheduled_concurrency = 0);
 	virtual ~LLQueuedThread();	
 	virtual void shutdown();
 	
@@ -164,14 +171,33 @@ private:
 	virtual void endThread(void);
 	virtual void threadedUpdate(void);
 
+	// Called by LLThreadScheduler workers, returns true while there is more to do
+	friend class LLThreadScheduler;
+	bool processScheduled();
+	void scheduleWork();
+
 protected:
 	handle_t generateHandle();
 	bool addRequest(QueuedRequest* req);
 	S32  processNextRequest(void);
 	void incQueue();
 
+	// Splits items into runs weighing about run_weight, as told by
+	// weight(item), and queues a REQUEST(handle, begin, end) for each run.
+	// The handles are appended to handles.
+	template <class REQUEST, class ITEM, class WEIGHT>
+	void addRequests(const std::vector<ITEM>& items, U32 run_weight, WEIGHT weight,
+					 std::vector<handle_t>& handles);
+
 public:
 	bool waitForResult(handle_t handle, bool auto_complete = true);
+	// Returns once the request is no longer queued or in progress, with its
+	// status. With help the calling thread runs queued requests meanwhile
+	// rather than wait for the workers to get to them. The request is left
+	// for completeRequest().
+	status_t waitForRequest(handle_t handle, bool help = true);
+	// waitForRequest() and completeRequest() for each of handles, then clears it
+	void waitForRequests(std::vector<handle_t>& handles, bool help = true);
 
 	virtual S32 update(U32 max_time_ms);
 	S32 updateQueue(U32 max_time_ms);
@@ -181,6 +207,7 @@ public:
 
 	S32 getPending();
 	bool getThreaded() { return mThreaded ? true : false; }
+	bool isScheduled() const { return mScheduler != NULL; }
 
 	// Request accessors
 	status_t getRequestStatus(handle_t handle);
@@ -208,6 +235,35 @@ protected:
 	request_hash_t mRequestHash;
 
 	handle_t mNextHandle;
+
+	// Only used when running on the shared scheduler
+	LLThreadScheduler* mScheduler;
+	S32 mMaxConcurrency;
+	S32 mScheduledTasks; // workers currently holding this queue, protected by lockData()
 };
 
+template <class REQUEST, class ITEM, class WEIGHT>
+void LLQueuedThread::addRequests(const std::vector<ITEM>& items, U32 run_weight, WEIGHT weight,
+								 std::vector<handle_t>& handles)
+{
+	typename std::vector<ITEM>::const_iterator begin = items.begin();
+	U32 total = 0;
+	for (typename std::vector<ITEM>::const_iterator iter = items.begin(); iter != items.end(); )
+	{
+		total += weight(*iter);
+		++iter;
+		if (total >= run_weight || iter == items.end())
+		{
+			handle_t handle = generateHandle();
+			if (!addRequest(new REQUEST(handle, begin, iter)))
+			{
+				llerrs << "LLQueuedThread::addRequests called after shutdown() on " << mName << llendl;
+			}
+			handles.push_back(handle);
+			begin = iter;
+			total = 0;
+		}
+	}
+}
+
 #endif // LL_LLQUEUEDTHREAD_H
@@ -44,6 +44,10 @@ namespace
 {
 	class ImplMap;
 	class ImplArray;
+
+	// mUseCount of Impls which are never deleted.  reset() leaves their
+	// count alone, so they can be shared between threads without races.
+	const U32 STATIC_USE_COUNT = 0xFFFFFFFF;
 }
 
 #ifdef NAME_UNNAMED_NAMESPACE
@@ -68,7 +72,8 @@ protected:
 	Impl(StaticAllocationMarker);
 		///< This constructor is used for static objects and causes the
 		//   suppresses adjusting the debugging counters when they are
-		//	 finally initialized.
+		//	 finally initialized.  Static objects are never reference
+		//   counted nor deleted, and always report being shared.
 		
 	virtual ~Impl();
 	
@@ -153,6 +158,7 @@ namespace
 
 	public:
 		ImplBase(DataRef value) : mValue(value) { }
+		ImplBase(DataRef value, StaticAllocationMarker m) : Impl(m), mValue(value) { }
 		
 		virtual LLSD::Type type() const { return T; }
 
@@ -180,8 +186,28 @@ namespace
 		virtual LLSD::Integer	asInteger() const	{ return mValue ? 1 : 0; }
 		virtual LLSD::Real		asReal() const		{ return mValue ? 1 : 0; }
 		virtual LLSD::String	asString() const;
+
+		static LLSD::Impl* constant(LLSD::Boolean v);
+			///< the shared Impl for v, or NULL before static init
+
+	private:
+		ImplBoolean(LLSD::Boolean v, StaticAllocationMarker m) : Base(v, m) { }
+
+		// The shared Impls are made during static initialization, before
+		// any thread can race to make them.  An LLSD built by an earlier
+		// static initializer gets an Impl of its own.
+		static ImplBoolean* sTrue;
+		static ImplBoolean* sFalse;
 	};
 
+	ImplBoolean* ImplBoolean::sTrue = new ImplBoolean(true, STATIC);
+	ImplBoolean* ImplBoolean::sFalse = new ImplBoolean(false, STATIC);
+
+	LLSD::Impl* ImplBoolean::constant(LLSD::Boolean v)
+	{
+		return v ? sTrue : sFalse;
+	}
+
 	LLSD::String ImplBoolean::asString() const
 		// *NOTE: The reason that false is not converted to "false" is
 		// because that would break roundtripping,
@@ -201,8 +227,42 @@ namespace
 		virtual LLSD::Integer	asInteger() const	{ return mValue; }
 		virtual LLSD::Real		asReal() const		{ return mValue; }
 		virtual LLSD::String	asString() const;
+
+		static LLSD::Impl* constant(LLSD::Integer v);
+			///< the shared Impl for v, or NULL if v is not a small integer
+			//   or before static init
+
+	private:
+		ImplInteger(LLSD::Integer v, StaticAllocationMarker m) : Base(v, m) { }
+		static ImplInteger** makeConstants();
+
+		// Flags, counts and enums make up most integers in parsed
+		// documents, so these get a shared Impl.
+		enum { SMALL_MIN = -1, SMALL_MAX = 31 };
+		static ImplInteger** sConstants;	// made at static init, as for ImplBoolean
 	};
 
+	ImplInteger** ImplInteger::sConstants = ImplInteger::makeConstants();
+
+	LLSD::Impl* ImplInteger::constant(LLSD::Integer v)
+	{
+		if (!sConstants || v < SMALL_MIN || v > SMALL_MAX)
+		{
+			return NULL;
+		}
+		return sConstants[v - SMALL_MIN];
+	}
+
+	ImplInteger** ImplInteger::makeConstants()
+	{
+		ImplInteger** constants = new ImplInteger*[SMALL_MAX - SMALL_MIN + 1];
+		for (LLSD::Integer v = SMALL_MIN; v <= SMALL_MAX; ++v)
+		{
+			constants[v - SMALL_MIN] = new ImplInteger(v, STATIC);
+		}
+		return constants;
+	}
+
 	LLSD::String ImplInteger::asString() const
 		{ return llformat("%d", mValue); }
 
@@ -217,8 +277,40 @@ namespace
 		virtual LLSD::Integer	asInteger() const;
 		virtual LLSD::Real		asReal() const		{ return mValue; }
 		virtual LLSD::String	asString() const;
+
+		static LLSD::Impl* constant(LLSD::Real v);
+			///< the shared Impl for v, or NULL if v is not 0.0 or 1.0
+			//   or before static init
+
+	private:
+		ImplReal(LLSD::Real v, StaticAllocationMarker m) : Base(v, m) { }
+
+		// made at static init, as for ImplBoolean
+		static ImplReal* sZero;
+		static ImplReal* sOne;
 	};
 
+	ImplReal* ImplReal::sZero = new ImplReal(0.0, STATIC);
+	ImplReal* ImplReal::sOne = new ImplReal(1.0, STATIC);
+
+	LLSD::Impl* ImplReal::constant(LLSD::Real v)
+	{
+		if (!sZero || !sOne)
+		{
+			return NULL;
+		}
+		// Compare bits so -0.0 keeps its sign
+		if (!memcmp(&v, &sZero->mValue, sizeof(v)))
+		{
+			return sZero;
+		}
+		if (!memcmp(&v, &sOne->mValue, sizeof(v)))
+		{
+			return sOne;
+		}
+		return NULL;
+	}
+
 	LLSD::Boolean ImplReal::asBoolean() const
 		{ return !llisnan(mValue)  &&  mValue != 0.0; }
 		
@@ -279,8 +371,24 @@ namespace
 				
 		virtual LLSD::String	asString() const{ return mValue.asString(); }
 		virtual LLSD::UUID		asUUID() const	{ return mValue; }
+
+		static LLSD::Impl* constant(const LLSD::UUID& v);
+			///< the shared Impl for v, or NULL if v is not null or
+			//   before static init
+
+	private:
+		ImplUUID(const LLSD::UUID& v, StaticAllocationMarker m) : Base(v, m) { }
+
+		static ImplUUID* sNull;	// made at static init, as for ImplBoolean
 	};
 
+	ImplUUID* ImplUUID::sNull = new ImplUUID(LLUUID(), STATIC);
+
+	LLSD::Impl* ImplUUID::constant(const LLSD::UUID& v)
+	{
+		return v.isNull() ? sNull : NULL;
+	}
+
 
 	class ImplDate
 		: public ImplBase<LLSD::TypeDate, LLSD::Date, const LLSD::Date&>
@@ -553,7 +661,7 @@ LLSD::Impl::Impl()
 }
 
 LLSD::Impl::Impl(StaticAllocationMarker)
-	: mUseCount(0)
+	: mUseCount(STATIC_USE_COUNT)
 {
 }
 
@@ -564,8 +672,8 @@ LLSD::Impl::~Impl()
 
 void LLSD::Impl::reset(Impl*& var, Impl* impl)
 {
-	if (impl) ++impl->mUseCount;
-	if (var  &&  --var->mUseCount == 0)
+	if (impl  &&  impl->mUseCount != STATIC_USE_COUNT) ++impl->mUseCount;
+	if (var  &&  var->mUseCount != STATIC_USE_COUNT  &&  --var->mUseCount == 0)
 	{
 		delete var;
 	}
@@ -611,17 +719,20 @@ void LLSD::Impl::assignUndefined(Impl*& var)
 
 void LLSD::Impl::assign(Impl*& var, LLSD::Boolean v)
 {
-	reset(var, new ImplBoolean(v));
+	Impl* constant = ImplBoolean::constant(v);
+	reset(var, constant ? constant : new ImplBoolean(v));
 }
 
 void LLSD::Impl::assign(Impl*& var, LLSD::Integer v)
 {
-	reset(var, new ImplInteger(v));
+	Impl* constant = ImplInteger::constant(v);
+	reset(var, constant ? constant : new ImplInteger(v));
 }
 
 void LLSD::Impl::assign(Impl*& var, LLSD::Real v)
 {
-	reset(var, new ImplReal(v));
+	Impl* constant = ImplReal::constant(v);
+	reset(var, constant ? constant : new ImplReal(v));
 }
 
 void LLSD::Impl::assign(Impl*& var, const LLSD::String& v)
@@ -631,7 +742,8 @@ void LLSD::Impl::assign(Impl*& var, const LLSD::String& v)
 
 void LLSD::Impl::assign(Impl*& var, const LLSD::UUID& v)
 {
-	reset(var, new ImplUUID(v));
+	Impl* constant = ImplUUID::constant(v);
+	reset(var, constant ? constant : new ImplUUID(v));
 }
 
 void LLSD::Impl::assign(Impl*& var, const LLSD::Date& v)
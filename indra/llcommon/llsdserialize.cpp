@@ -31,6 +31,9 @@
 #include "llpointer.h"
 #include "llstreamtools.h" // for fullread
 
+#include <cerrno>
+#include <clocale>
+#include <cmath>
 #include <iostream>
 #include "apr_base64.h"
 
@@ -39,6 +42,7 @@
 #endif
 
 #include "lldate.h"
+#include "llmemorystream.h"
 #include "llsd.h"
 #include "llstring.h"
 #include "lluri.h"
@@ -380,6 +384,952 @@ void LLSDParser::account(S32 bytes) const
 	if(mCheckLimits) mMaxBytesLeft -= bytes;
 }
 
+S32 LLSDParser::parse(const U8* buffer, S32 length, LLSD& data)
+{
+	if(length < 0) length = 0;
+	mCheckLimits = true;
+	mMaxBytesLeft = length;
+	return doParseBuffer(buffer, length, data);
+}
+
+// virtual
+S32 LLSDParser::doParseBuffer(const U8* buffer, S32 length, LLSD& data) const
+{
+	LLMemoryStream istr(buffer, length);
+	return doParse(istr, data);
+}
+
+
+/**
+ * Buffer parsers
+ *
+ * These walk a block of memory with a pointer instead of pulling it
+ * through the istream helpers above. They follow the stream parsers
+ * case for case, except that running off the end of the buffer is
+ * always a parse failure, and strings and binaries are copied straight
+ * out of the buffer into the value.
+ */
+namespace
+{
+	class LLSDBufferReader
+	{
+	public:
+		LLSDBufferReader(const U8* buffer, S32 length) :
+			mPos((const char*)buffer),
+			mEnd((const char*)buffer + length)
+		{
+		}
+
+	protected:
+		bool atEnd() const { return mPos >= mEnd; }
+		S32 remaining() const { return (S32)(mEnd - mPos); }
+
+		bool read(void* dest, S32 bytes)
+		{
+			if(remaining() < bytes) return false;
+			memcpy(dest, mPos, bytes);		/* Flawfinder: ignore */
+			mPos += bytes;
+			return true;
+		}
+
+		bool parseDelimitedString(char delim, std::string& value);
+
+		const char* mPos;
+		const char* mEnd;
+	};
+
+	// Same escapes as deserialize_string_delim(), with the opening
+	// delimiter already consumed.
+	bool LLSDBufferReader::parseDelimitedString(char delim, std::string& value)
+	{
+		// Most strings have no escapes and are sliced out in one go.
+		const char* start = mPos;
+		while((mPos < mEnd) && (*mPos != delim) && (*mPos != '\\'))
+		{
+			++mPos;
+		}
+		if(atEnd()) return false;
+		value.assign(start, mPos - start);
+		while(!atEnd())
+		{
+			char c = *mPos++;
+			if(c == delim)
+			{
+				return true;
+			}
+			if(c != '\\')
+			{
+				value += c;
+				continue;
+			}
+			if(atEnd()) return false;
+			c = *mPos++;
+			switch(c)
+			{
+			case 'x':
+			{
+				if(remaining() < 2) return false;
+				U8 byte = hex_as_nybble(mPos[0]) << 4;
+				byte |= hex_as_nybble(mPos[1]);
+				mPos += 2;
+				value += (char)byte;
+				break;
+			}
+			case 'a':
+				value += '\a';
+				break;
+			case 'b':
+				value += '\b';
+				break;
+			case 'f':
+				value += '\f';
+				break;
+			case 'n':
+				value += '\n';
+				break;
+			case 'r':
+				value += '\r';
+				break;
+			case 't':
+				value += '\t';
+				break;
+			case 'v':
+				value += '\v';
+				break;
+			default:
+				value += c;
+				break;
+			}
+		}
+		return false;
+	}
+
+	class LLSDNotationBufferParser : public LLSDBufferReader
+	{
+	public:
+		LLSDNotationBufferParser(const U8* buffer, S32 length) :
+			LLSDBufferReader(buffer, length)
+		{
+		}
+
+		S32 parse(LLSD& data);
+
+	private:
+		S32 parseMap(LLSD& map);
+		S32 parseArray(LLSD& array);
+		bool parseString(std::string& value);
+		bool parseBoolean(const std::string& compare);
+		bool parseInteger(S32& value);
+		bool parseReal(F64& value);
+		bool parseUUID(LLUUID& value);
+		bool parseBinary(LLSD& data);
+
+		void skipWhitespace()
+		{
+			while(!atEnd() && isspace((U8)*mPos))
+			{
+				++mPos;
+			}
+		}
+	};
+
+	S32 LLSDNotationBufferParser::parse(LLSD& data)
+	{
+		skipWhitespace();
+		if(atEnd())
+		{
+			return 0;
+		}
+		S32 parse_count = 1;
+		char c = *mPos;
+		switch(c)
+		{
+		case '{':
+		{
+			S32 child_count = parseMap(data);
+			if((child_count == LLSDParser::PARSE_FAILURE) || data.isUndefined())
+			{
+				parse_count = LLSDParser::PARSE_FAILURE;
+			}
+			else
+			{
+				parse_count += child_count;
+			}
+			break;
+		}
+
+		case '[':
+		{
+			S32 child_count = parseArray(data);
+			if((child_count == LLSDParser::PARSE_FAILURE) || data.isUndefined())
+			{
+				parse_count = LLSDParser::PARSE_FAILURE;
+			}
+			else
+			{
+				parse_count += child_count;
+			}
+			break;
+		}
+
+		case '!':
+			++mPos;
+			data.clear();
+			break;
+
+		case '0':
+			++mPos;
+			data = false;
+			break;
+
+		case 'F':
+		case 'f':
+			++mPos;
+			if(!atEnd() && isalpha((U8)*mPos)
+			   && !parseBoolean(NOTATION_FALSE_SERIAL))
+			{
+				parse_count = LLSDParser::PARSE_FAILURE;
+			}
+			else
+			{
+				data = false;
+			}
+			break;
+
+		case '1':
+			++mPos;
+			data = true;
+			break;
+
+		case 'T':
+		case 't':
+			++mPos;
+			if(!atEnd() && isalpha((U8)*mPos)
+			   && !parseBoolean(NOTATION_TRUE_SERIAL))
+			{
+				parse_count = LLSDParser::PARSE_FAILURE;
+			}
+			else
+			{
+				data = true;
+			}
+			break;
+
+		case 'i':
+		{
+			++mPos;
+			S32 integer = 0;
+			if(parseInteger(integer))
+			{
+				data = integer;
+			}
+			else
+			{
+				llinfos << "BUFFER FAILURE reading integer." << llendl;
+				parse_count = LLSDParser::PARSE_FAILURE;
+			}
+			break;
+		}
+
+		case 'r':
+		{
+			++mPos;
+			F64 real = 0.0;
+			if(parseReal(real))
+			{
+				data = real;
+			}
+			else
+			{
+				llinfos << "BUFFER FAILURE reading real." << llendl;
+				parse_count = LLSDParser::PARSE_FAILURE;
+			}
+			break;
+		}
+
+		case 'u':
+		{
+			++mPos;
+			LLUUID id;
+			if(parseUUID(id))
+			{
+				data = id;
+			}
+			else
+			{
+				llinfos << "BUFFER FAILURE reading uuid." << llendl;
+				parse_count = LLSDParser::PARSE_FAILURE;
+			}
+			break;
+		}
+
+		case '\"':
+		case '\'':
+		case 's':
+		{
+			std::string value;
+			if(parseString(value))
+			{
+				data = value;
+			}
+			else
+			{
+				llinfos << "BUFFER FAILURE reading string." << llendl;
+				parse_count = LLSDParser::PARSE_FAILURE;
+			}
+			break;
+		}
+
+		case 'l':
+		case 'd':
+		{
+			// the delimiter is whatever follows the 'l' or 'd'
+			std::string value;
+			bool parsed = false;
+			if(remaining() >= 2)
+			{
+				char delim = mPos[1];
+				mPos += 2;
+				parsed = parseDelimitedString(delim, value);
+			}
+			if(parsed)
+			{
+				if(c == 'l')
+				{
+					data = LLURI(value);
+				}
+				else
+				{
+					data = LLDate(value);
+				}
+			}
+			else
+			{
+				llinfos << "BUFFER FAILURE reading "
+					<< ((c == 'l') ? "link." : "date.") << llendl;
+				parse_count = LLSDParser::PARSE_FAILURE;
+			}
+			break;
+		}
+
+		case 'b':
+			if(!parseBinary(data))
+			{
+				llinfos << "BUFFER FAILURE reading data." << llendl;
+				parse_count = LLSDParser::PARSE_FAILURE;
+			}
+			break;
+
+		default:
+			parse_count = LLSDParser::PARSE_FAILURE;
+			llinfos << "Unrecognized character while parsing: int(" << (int)c
+				<< ")" << llendl;
+			break;
+		}
+		if(LLSDParser::PARSE_FAILURE == parse_count)
+		{
+			data.clear();
+		}
+		return parse_count;
+	}
+
+	S32 LLSDNotationBufferParser::parseMap(LLSD& map)
+	{
+		// map: { string:object, string:object }
+		map = LLSD::emptyMap();
+		S32 parse_count = 0;
+		bool found_name = false;
+		std::string name;
+		++mPos; // pop the '{'
+		while(!atEnd() && (*mPos != '}'))
+		{
+			char c = *mPos;
+			if(!found_name)
+			{
+				if((c == '\"') || (c == '\'') || (c == 's'))
+				{
+					if(!parseString(name)) return LLSDParser::PARSE_FAILURE;
+					found_name = true;
+				}
+				else
+				{
+					++mPos;
+				}
+			}
+			else if(isspace((U8)c) || (c == ':'))
+			{
+				++mPos;
+			}
+			else
+			{
+				LLSD child;
+				S32 count = parse(child);
+				if(count <= 0)
+				{
+					// There must be a value for every key.
+					return LLSDParser::PARSE_FAILURE;
+				}
+				parse_count += count;
+				map.insert(name, child);
+				found_name = false;
+			}
+		}
+		if(atEnd())
+		{
+			map.clear();
+			return LLSDParser::PARSE_FAILURE;
+		}
+		++mPos; // pop the '}'
+		return parse_count;
+	}
+
+	S32 LLSDNotationBufferParser::parseArray(LLSD& array)
+	{
+		// array: [ object, object, object ]
+		array = LLSD::emptyArray();
+		S32 parse_count = 0;
+		++mPos; // pop the '['
+		while(!atEnd() && (*mPos != ']'))
+		{
+			char c = *mPos;
+			if(isspace((U8)c) || (c == ','))
+			{
+				++mPos;
+				continue;
+			}
+			LLSD child;
+			S32 count = parse(child);
+			if(LLSDParser::PARSE_FAILURE == count)
+			{
+				return LLSDParser::PARSE_FAILURE;
+			}
+			parse_count += count;
+			array.append(child);
+		}
+		if(atEnd())
+		{
+			return LLSDParser::PARSE_FAILURE;
+		}
+		++mPos; // pop the ']'
+		return parse_count;
+	}
+
+	// "delimited", 'delimited' or s(size)"raw data", like
+	// deserialize_string().
+	bool LLSDNotationBufferParser::parseString(std::string& value)
+	{
+		char c = *mPos++;
+		if((c == '\"') || (c == '\''))
+		{
+			return parseDelimitedString(c, value);
+		}
+		if(c != 's')
+		{
+			return false;
+		}
+
+		const S32 MAX_SIZE_CHARS = 19;
+		const char* close = (const char*)memchr(mPos, ')', llmin(remaining(), MAX_SIZE_CHARS));
+		if(!close || (*mPos != '(') || (mEnd - close < 2)
+		   || ((close[1] != '\"') && (close[1] != '\'')))
+		{
+			return false;
+		}
+		S32 len = strtol(mPos + 1, NULL, 0);
+		mPos = close + 2;
+		// the data plus the closing quote
+		if((len < 0) || (len >= remaining()))
+		{
+			return false;
+		}
+		value.assign(mPos, len);
+		mPos += len;
+		c = *mPos++;
+		return (c == '\"') || (c == '\'');
+	}
+
+	// Same as deserialize_boolean(), with the 't' or 'f' already
+	// consumed.
+	bool LLSDNotationBufferParser::parseBoolean(const std::string& compare)
+	{
+		for(std::string::size_type ii = 1; ii < compare.size(); ++ii, ++mPos)
+		{
+			if(atEnd() || (tolower((U8)*mPos) != (int)compare[ii]))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Accepts what istream >> S32 does.
+	bool LLSDNotationBufferParser::parseInteger(S32& value)
+	{
+		skipWhitespace();
+		bool negative = false;
+		if(!atEnd() && ((*mPos == '-') || (*mPos == '+')))
+		{
+			negative = (*mPos == '-');
+			++mPos;
+		}
+		const char* digits = mPos;
+		S64 result = 0;
+		while(!atEnd() && isdigit((U8)*mPos))
+		{
+			// keep consuming digits once out of range, like the stream
+			if(result <= (S64)S32_MAX + 1)
+			{
+				result = result * 10 + (*mPos - '0');
+			}
+			++mPos;
+		}
+		if(negative)
+		{
+			result = -result;
+		}
+		if((mPos == digits) || (result < (S64)S32_MIN) || (result > (S64)S32_MAX))
+		{
+			return false;
+		}
+		value = (S32)result;
+		return true;
+	}
+
+	// Accepts what istream >> F64 does: an optional sign, digits with at
+	// most one decimal point and an optional exponent.
+	bool LLSDNotationBufferParser::parseReal(F64& value)
+	{
+		skipWhitespace();
+		const char* start = mPos;
+		if(!atEnd() && ((*mPos == '-') || (*mPos == '+')))
+		{
+			++mPos;
+		}
+		bool found_digit = false;
+		bool found_point = false;
+		while(!atEnd())
+		{
+			if(isdigit((U8)*mPos))
+			{
+				found_digit = true;
+			}
+			else if((*mPos == '.') && !found_point)
+			{
+				found_point = true;
+			}
+			else
+			{
+				break;
+			}
+			++mPos;
+		}
+		if(!found_digit)
+		{
+			return false;
+		}
+		if(!atEnd() && ((*mPos == 'e') || (*mPos == 'E')))
+		{
+			++mPos;
+			if(!atEnd() && ((*mPos == '-') || (*mPos == '+')))
+			{
+				++mPos;
+			}
+			while(!atEnd() && isdigit((U8)*mPos))
+			{
+				++mPos;
+			}
+		}
+
+		// strtod() needs a terminated string in the C locale's format.
+		std::string::size_type len = mPos - start;
+		char buf[64];		/* Flawfinder: ignore */
+		std::string long_token;
+		char* token = buf;
+		if(len >= sizeof(buf))
+		{
+			long_token.assign(start, len);
+			token = &long_token[0];
+		}
+		else
+		{
+			memcpy(buf, start, len);		/* Flawfinder: ignore */
+			buf[len] = '\0';
+		}
+		char point = *localeconv()->decimal_point;
+		if(point != '.')
+		{
+			char* dot = strchr(token, '.');
+			if(dot) *dot = point;
+		}
+		char* end = NULL;
+		errno = 0;
+		value = strtod(token, &end);
+		if((end != token + len) || ((errno == ERANGE) && (fabs(value) == HUGE_VAL)))
+		{
+			return false;
+		}
+		return true;
+	}
+
+	// Accepts what istream >> LLUUID does.
+	bool LLSDNotationBufferParser::parseUUID(LLUUID& value)
+	{
+		char uuid_str[UUID_STR_LENGTH];		/* Flawfinder: ignore */
+		S32 i;
+		for(i = 0; i < UUID_STR_LENGTH - 1; ++i)
+		{
+			skipWhitespace();
+			if(atEnd()) return false;
+			uuid_str[i] = *mPos++;
+		}
+		uuid_str[i] = '\0';
+		value.set(uuid_str);
+		return true;
+	}
+
+	bool LLSDNotationBufferParser::parseBinary(LLSD& data)
+	{
+		// binary: b##"ff3120ab1"
+		// or: b(len)"..."
+		const S32 MAX_PREFIX_CHARS = 255;
+		const char* start = mPos;
+		const char* quote = (const char*)memchr(mPos, '\"', llmin(remaining(), MAX_PREFIX_CHARS));
+		if(!quote) return false;
+		mPos = quote + 1;
+		if(0 == strncmp("b(", start, 2))
+		{
+			S32 len = strtol(start + 2, NULL, 0);
+			// the data plus the closing quote
+			if((len < 0) || (len >= remaining())) return false;
+			data = LLSD::Binary((const U8*)mPos, (const U8*)mPos + len);
+			mPos += len + 1;
+		}
+		else if(0 == strncmp("b64", start, 3))
+		{
+			const char* close = (const char*)memchr(mPos, '\"', remaining());
+			if(!close) return false;
+			std::string encoded(mPos, close - mPos);
+			mPos = close + 1;
+			LLSD::Binary value;
+			S32 len = apr_base64_decode_len(encoded.c_str());
+			if(len)
+			{
+				value.resize(len);
+				len = apr_base64_decode_binary(&value[0], encoded.c_str());
+				value.resize(len);
+			}
+			data = value;
+		}
+		else if(0 == strncmp("b16", start, 3))
+		{
+			const char* close = (const char*)memchr(mPos, '\"', remaining());
+			if(!close) return false;
+			LLSD::Binary value;
+			value.reserve((close - mPos + 1) / 2);
+			while(mPos < close)
+			{
+				U8 byte = hex_as_nybble(*mPos++) << 4;
+				if(mPos < close)
+				{
+					byte |= hex_as_nybble(*mPos++);
+				}
+				value.push_back(byte);
+			}
+			mPos = close + 1;
+			data = value;
+		}
+		else
+		{
+			return false;
+		}
+		return true;
+	}
+
+	class LLSDBinaryBufferParser : public LLSDBufferReader
+	{
+	public:
+		LLSDBinaryBufferParser(const U8* buffer, S32 length) :
+			LLSDBufferReader(buffer, length)
+		{
+		}
+
+		S32 parse(LLSD& data);
+
+	private:
+		S32 parseMap(LLSD& map);
+		S32 parseArray(LLSD& array);
+		bool parseString(std::string& value);
+
+		bool readSize(S32& size)
+		{
+			U32 size_nbo = 0;
+			if(!read(&size_nbo, sizeof(U32))) return false;
+			size = (S32)ntohl(size_nbo);
+			return true;
+		}
+	};
+
+	S32 LLSDBinaryBufferParser::parse(LLSD& data)
+	{
+		if(atEnd())
+		{
+			return 0;
+		}
+		S32 parse_count = 1;
+		char c = *mPos++;
+		switch(c)
+		{
+		case '{':
+		{
+			S32 child_count = parseMap(data);
+			if((child_count == LLSDParser::PARSE_FAILURE) || data.isUndefined())
+			{
+				parse_count = LLSDParser::PARSE_FAILURE;
+			}
+			else
+			{
+				parse_count += child_count;
+			}
+			break;
+		}
+
+		case '[':
+		{
+			S32 child_count = parseArray(data);
+			if((child_count == LLSDParser::PARSE_FAILURE) || data.isUndefined())
+			{
+				parse_count = LLSDParser::PARSE_FAILURE;
+			}
+			else
+			{
+				parse_count += child_count;
+			}
+			break;
+		}
+
+		case '!':
+			data.clear();
+			break;
+
+		case '0':
+			data = false;
+			break;
+
+		case '1':
+			data = true;
+			break;
+
+		case 'i':
+		{
+			U32 value_nbo = 0;
+			if(read(&value_nbo, sizeof(U32)))
+			{
+				data = (S32)ntohl(value_nbo);
+			}
+			else
+			{
+				llinfos << "BUFFER FAILURE reading binary integer." << llendl;
+				parse_count = LLSDParser::PARSE_FAILURE;
+			}
+			break;
+		}
+
+		case 'r':
+		{
+			F64 real_nbo = 0.0;
+			if(read(&real_nbo, sizeof(F64)))
+			{
+				data = ll_ntohd(real_nbo);
+			}
+			else
+			{
+				llinfos << "BUFFER FAILURE reading binary real." << llendl;
+				parse_count = LLSDParser::PARSE_FAILURE;
+			}
+			break;
+		}
+
+		case 'u':
+		{
+			LLUUID id;
+			if(read(id.mData, UUID_BYTES))
+			{
+				data = id;
+			}
+			else
+			{
+				llinfos << "BUFFER FAILURE reading binary uuid." << llendl;
+				parse_count = LLSDParser::PARSE_FAILURE;
+			}
+			break;
+		}
+
+		case '\'':
+		case '"':
+		case 's':
+		case 'l':
+		{
+			std::string value;
+			bool parsed = ((c == 's') || (c == 'l')) ?
+				parseString(value) : parseDelimitedString(c, value);
+			if(!parsed)
+			{
+				llinfos << "BUFFER FAILURE reading binary string." << llendl;
+				parse_count = LLSDParser::PARSE_FAILURE;
+			}
+			else if(c == 'l')
+			{
+				data = LLURI(value);
+			}
+			else
+			{
+				data = value;
+			}
+			break;
+		}
+
+		case 'd':
+		{
+			// written in host order, see LLSDBinaryParser::doParse()
+			F64 real = 0.0;
+			if(read(&real, sizeof(F64)))
+			{
+				data = LLDate(real);
+			}
+			else
+			{
+				llinfos << "BUFFER FAILURE reading binary date." << llendl;
+				parse_count = LLSDParser::PARSE_FAILURE;
+			}
+			break;
+		}
+
+		case 'b':
+		{
+			S32 size = 0;
+			if(readSize(size) && (size >= 0) && (size <= remaining()))
+			{
+				data = LLSD::Binary((const U8*)mPos, (const U8*)mPos + size);
+				mPos += size;
+			}
+			else
+			{
+				llinfos << "BUFFER FAILURE reading binary." << llendl;
+				parse_count = LLSDParser::PARSE_FAILURE;
+			}
+			break;
+		}
+
+		default:
+			parse_count = LLSDParser::PARSE_FAILURE;
+			llinfos << "Unrecognized character while parsing: int(" << (int)c
+				<< ")" << llendl;
+			break;
+		}
+		if(LLSDParser::PARSE_FAILURE == parse_count)
+		{
+			data.clear();
+		}
+		return parse_count;
+	}
+
+	S32 LLSDBinaryBufferParser::parseMap(LLSD& map)
+	{
+		map = LLSD::emptyMap();
+		S32 size = 0;
+		// Every entry takes at least two bytes, so a bigger size than
+		// what is left can only be a damaged document.
+		if(!readSize(size) || (size > remaining()) || atEnd())
+		{
+			return LLSDParser::PARSE_FAILURE;
+		}
+		S32 parse_count = 0;
+		S32 count = 0;
+		char c = *mPos++;
+		while((c != '}') && (count < size))
+		{
+			std::string name;
+			switch(c)
+			{
+			case 'k':
+				if(!parseString(name)) return LLSDParser::PARSE_FAILURE;
+				break;
+			case '\'':
+			case '"':
+				if(!parseDelimitedString(c, name)) return LLSDParser::PARSE_FAILURE;
+				break;
+			}
+			LLSD child;
+			S32 child_count = parse(child);
+			if(child_count <= 0)
+			{
+				// There must be a value for every key.
+				return LLSDParser::PARSE_FAILURE;
+			}
+			parse_count += child_count;
+			map.insert(name, child);
+			++count;
+			if(atEnd()) return LLSDParser::PARSE_FAILURE;
+			c = *mPos++;
+		}
+		if((c != '}') || (count < size))
+		{
+			// Make sure it is correctly terminated and we parsed as many
+			// as were said to be there.
+			return LLSDParser::PARSE_FAILURE;
+		}
+		return parse_count;
+	}
+
+	S32 LLSDBinaryBufferParser::parseArray(LLSD& array)
+	{
+		array = LLSD::emptyArray();
+		S32 size = 0;
+		// Every element takes at least a byte, which also makes it safe
+		// to size the array once up front.
+		if(!readSize(size) || (size > remaining()))
+		{
+			return LLSDParser::PARSE_FAILURE;
+		}
+		if(size > 0)
+		{
+			array.set(size - 1, LLSD());
+		}
+		S32 parse_count = 0;
+		S32 count = 0;
+		while((count < size) && !atEnd() && (*mPos != ']'))
+		{
+			S32 child_count = parse(array[count]);
+			if(child_count <= 0)
+			{
+				return LLSDParser::PARSE_FAILURE;
+			}
+			parse_count += child_count;
+			++count;
+		}
+		if(atEnd() || (*mPos != ']') || (count < size))
+		{
+			// Make sure it is correctly terminated and we parsed as many
+			// as were said to be there.
+			return LLSDParser::PARSE_FAILURE;
+		}
+		++mPos; // pop the ']'
+		return parse_count;
+	}
+
+	bool LLSDBinaryBufferParser::parseString(std::string& value)
+	{
+		S32 size = 0;
+		if(!readSize(size) || (size < 0) || (size > remaining()))
+		{
+			return false;
+		}
+		value.assign(mPos, size);
+		mPos += size;
+		return true;
+	}
+}
+
 
 /**
  * LLSDNotationParser
@@ -392,6 +1342,13 @@ LLSDNotationParser::LLSDNotationParser()
 LLSDNotationParser::~LLSDNotationParser()
 { }
 
+// virtual
+S32 LLSDNotationParser::doParseBuffer(const U8* buffer, S32 length, LLSD& data) const
+{
+	LLSDNotationBufferParser parser(buffer, length);
+	return parser.parse(data);
+}
+
 // virtual
 S32 LLSDNotationParser::doParse(std::istream& istr, LLSD& data) const
 {
@@ -858,6 +1815,13 @@ LLSDBinaryParser::~LLSDBinaryParser()
 {
 }
 
+// virtual
+S32 LLSDBinaryParser::doParseBuffer(const U8* buffer, S32 length, LLSD& data) const
+{
+	LLSDBinaryBufferParser parser(buffer, length);
+	return parser.parse(data);
+}
+
 // virtual
 S32 LLSDBinaryParser::doParse(std::istream& istr, LLSD& data) const
 {
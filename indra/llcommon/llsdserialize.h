@@ -85,6 +85,22 @@ public:
 	 */
 	S32 parseLines(std::istream& istr, LLSD& data);
 
+	/** 
+	 * @brief Call this method to parse a block of memory for LLSD.
+	 *
+	 * Like parse(), but reads straight out of a contiguous buffer
+	 * instead of through an istream. The notation and binary parsers
+	 * walk the buffer in place, which is a lot faster than pulling it
+	 * through istream::get() a byte at a time. Other parsers read it
+	 * through an LLMemoryStream. The buffer is never copied.
+	 * @param buffer The serialized data.
+	 * @param length The number of bytes at buffer.
+	 * @param data[out] The newly parse structured data.
+	 * @return Returns the number of LLSD objects parsed into
+	 * data. Returns PARSE_FAILURE (-1) on parse failure.
+	 */
+	S32 parse(const U8* buffer, S32 length, LLSD& data);
+
 	/** 
 	 * @brief Resets the parser so parse() or parseLines() can be called again for another <llsd> chunk.
 	 */
@@ -108,6 +124,18 @@ protected:
 	 */
 	virtual S32 doParse(std::istream& istr, LLSD& data) const = 0;
 
+	/** 
+	 * @brief Virtual default function for parsing a block of memory.
+	 *
+	 * Wraps the buffer in an LLMemoryStream and hands it to doParse().
+	 * @param buffer The serialized data.
+	 * @param length The number of bytes at buffer.
+	 * @param data[out] The newly parse structured data.
+	 * @return Returns the number of LLSD objects parsed into
+	 * data. Returns PARSE_FAILURE (-1) on parse failure.
+	 */
+	virtual S32 doParseBuffer(const U8* buffer, S32 length, LLSD& data) const;
+
 	/** 
 	 * @brief Virtual default function for resetting the parser
 	 */
@@ -246,6 +274,17 @@ protected:
 	 */
 	virtual S32 doParse(std::istream& istr, LLSD& data) const;
 
+	/** 
+	 * @brief Parse a block of memory in place.
+	 *
+	 * @param buffer The serialized data.
+	 * @param length The number of bytes at buffer.
+	 * @param data[out] The newly parse structured data.
+	 * @return Returns the number of LLSD objects parsed into
+	 * data. Returns PARSE_FAILURE (-1) on parse failure.
+	 */
+	virtual S32 doParseBuffer(const U8* buffer, S32 length, LLSD& data) const;
+
 private:
 	/** 
 	 * @brief Parse a map from the istream
@@ -367,6 +406,17 @@ protected:
 	 */
 	virtual S32 doParse(std::istream& istr, LLSD& data) const;
 
+	/** 
+	 * @brief Parse a block of memory in place.
+	 *
+	 * @param buffer The serialized data.
+	 * @param length The number of bytes at buffer.
+	 * @param data[out] The newly parse structured data.
+	 * @return Returns the number of LLSD objects parsed into
+	 * data. Returns PARSE_FAILURE (-1) on parse failure.
+	 */
+	virtual S32 doParseBuffer(const U8* buffer, S32 length, LLSD& data) const;
+
 private:
 	/** 
 	 * @brief Parse a map from the istream
@@ -732,6 +782,11 @@ public:
 		(void)p->parse(str, sd, max_bytes);
 		return sd;
 	}
+	static S32 fromNotation(LLSD& sd, const U8* buffer, S32 length)
+	{
+		LLPointer<LLSDNotationParser> p = new LLSDNotationParser;
+		return p->parse(buffer, length, sd);
+	}
 	
 	/*
 	 * XML Methods
@@ -781,6 +836,11 @@ public:
 		LLPointer<LLSDBinaryParser> p = new LLSDBinaryParser;
 		return p->parse(str, sd, max_bytes);
 	}
+	static S32 fromBinary(LLSD& sd, const U8* buffer, S32 length)
+	{
+		LLPointer<LLSDBinaryParser> p = new LLSDBinaryParser;
+		return p->parse(buffer, length, sd);
+	}
 	static LLSD fromBinary(std::istream& str, S32 max_bytes)
 	{
 		LLPointer<LLSDBinaryParser> p = new LLSDBinaryParser;
@@ -29,6 +29,7 @@
 
 #include <iostream>
 #include <deque>
+#include <vector>
 
 #include "apr_base64.h"
 #include <boost/regex.hpp>
@@ -247,6 +248,218 @@ std::string LLSDXMLFormatter::escapeString(const std::string& in)
 
 
 
+// Performance testing code
+//#define	XML_PARSER_PERFORMANCE_TESTS
+
+#ifdef XML_PARSER_PERFORMANCE_TESTS
+
+extern U64 totalTime();
+U64	readElementTime = 0;
+U64 startElementTime = 0;
+U64 endElementTime = 0;
+U64 charDataTime = 0;
+U64 parseTime = 0;
+
+class XML_Timer
+{
+public:
+	XML_Timer( U64 * sum ) : mSum( sum )
+	{
+		mStart = totalTime();
+	}
+	~XML_Timer()
+	{
+		*mSum += (totalTime() - mStart);
+	}
+
+	U64 * mSum;
+	U64 mStart;
+};
+#endif // XML_PARSER_PERFORMANCE_TESTS
+
+enum Element {
+	ELEMENT_LLSD,
+	ELEMENT_UNDEF,
+	ELEMENT_BOOL,
+	ELEMENT_INTEGER,
+	ELEMENT_REAL,
+	ELEMENT_STRING,
+	ELEMENT_UUID,
+	ELEMENT_DATE,
+	ELEMENT_URI,
+	ELEMENT_BINARY,
+	ELEMENT_MAP,
+	ELEMENT_ARRAY,
+	ELEMENT_KEY,
+	ELEMENT_UNKNOWN
+};
+
+/*
+	This code is time critical
+
+	This is a sample of tag occurances of text in simstate file with ~8000 objects.
+	A tag pair (<key>something</key>) counts is counted as two:
+
+		key     - 2680178
+		real    - 1818362
+		integer -  906078
+		array   -  295682
+		map     -  191818
+		uuid    -  177903
+		binary  -  175748
+		string  -   53482
+		undef   -   40353
+		boolean -   33874
+		llsd    -   16332
+		uri     -      38
+		date    -       1
+*/
+static Element readElement(const XML_Char* name)
+{
+	#ifdef XML_PARSER_PERFORMANCE_TESTS
+	XML_Timer timer( &readElementTime );
+	#endif // XML_PARSER_PERFORMANCE_TESTS
+
+	XML_Char c = *name;
+	switch (c)
+	{
+		case 'k':
+			if (strcmp(name, "key") == 0) { return ELEMENT_KEY; }
+			break;
+		case 'r':
+			if (strcmp(name, "real") == 0) { return ELEMENT_REAL; }
+			break;
+		case 'i':
+			if (strcmp(name, "integer") == 0) { return ELEMENT_INTEGER; }
+			break;
+		case 'a':
+			if (strcmp(name, "array") == 0) { return ELEMENT_ARRAY; }
+			break;
+		case 'm':
+			if (strcmp(name, "map") == 0) { return ELEMENT_MAP; }
+			break;
+		case 'u':
+			if (strcmp(name, "uuid") == 0) { return ELEMENT_UUID; }
+			if (strcmp(name, "undef") == 0) { return ELEMENT_UNDEF; }
+			if (strcmp(name, "uri") == 0) { return ELEMENT_URI; }
+			break;
+		case 'b':
+			if (strcmp(name, "binary") == 0) { return ELEMENT_BINARY; }
+			if (strcmp(name, "boolean") == 0) { return ELEMENT_BOOL; }
+			break;
+		case 's':
+			if (strcmp(name, "string") == 0) { return ELEMENT_STRING; }
+			break;
+		case 'l':
+			if (strcmp(name, "llsd") == 0) { return ELEMENT_LLSD; }
+			break;
+		case 'd':
+			if (strcmp(name, "date") == 0) { return ELEMENT_DATE; }
+			break;
+	}
+	return ELEMENT_UNKNOWN;
+}
+
+static const XML_Char* findAttribute(const XML_Char* name, const XML_Char** pairs)
+{
+	while (NULL != pairs && NULL != *pairs)
+	{
+		if(0 == strcmp(name, *pairs))
+		{
+			return *(pairs + 1);
+		}
+		pairs += 2;
+	}
+	return NULL;
+}
+
+// Sets value from the text of a scalar element. Maps and arrays are
+// set up when they start, so they are left alone.
+static void set_value(Element element, const std::string& content, LLSD& value)
+{
+	switch (element)
+	{
+		case ELEMENT_UNDEF:
+			value.clear();
+			break;
+		
+		case ELEMENT_BOOL:
+			value = (content == "true" || content == "1");
+			break;
+		
+		case ELEMENT_INTEGER:
+			{
+				S32 i;
+				if ( sscanf(content.c_str(), "%d", &i ) == 1 )
+				{	// See if sscanf works - it's faster
+					value = i;
+				}
+				else
+				{
+					value = LLSD(content).asInteger();
+				}
+			}
+			break;
+		
+		case ELEMENT_REAL:
+			{
+				F64 r;
+				if ( sscanf(content.c_str(), "%lf", &r ) == 1 )
+				{	// See if sscanf works - it's faster
+					value = r;
+				}
+				else
+				{
+					value = LLSD(content).asReal();
+				}
+			}
+			break;
+		
+		case ELEMENT_STRING:
+			value = content;
+			break;
+		
+		case ELEMENT_UUID:
+			value = LLUUID(content);
+			break;
+		
+		case ELEMENT_DATE:
+			value = LLDate(content);
+			break;
+		
+		case ELEMENT_URI:
+			value = LLURI(content);
+			break;
+		
+		case ELEMENT_BINARY:
+		{
+			// Regex is expensive, but only fix for whitespace in base64,
+			// created by python and other non-linden systems - DEV-39358
+			// Fortunately we have very little binary passing now,
+			// so performance impact shold be negligible. + poppy 2009-09-04
+			boost::regex r;
+			r.assign("\\s");
+			std::string stripped = boost::regex_replace(content, r, "");
+			S32 len = apr_base64_decode_len(stripped.c_str());
+			std::vector<U8> data;
+			data.resize(len);
+			len = apr_base64_decode_binary(&data[0], stripped.c_str());
+			data.resize(len);
+			value = data;
+			break;
+		}
+		
+		case ELEMENT_UNKNOWN:
+			value.clear();
+			break;
+			
+		default:
+			// other values, map and array, have already been set
+			break;
+	}
+}
+
+
 class LLSDXMLParser::Impl
 {
 public:
@@ -274,26 +487,6 @@ private:
 
 	void startSkipping();
 	
-	enum Element {
-		ELEMENT_LLSD,
-		ELEMENT_UNDEF,
-		ELEMENT_BOOL,
-		ELEMENT_INTEGER,
-		ELEMENT_REAL,
-		ELEMENT_STRING,
-		ELEMENT_UUID,
-		ELEMENT_DATE,
-		ELEMENT_URI,
-		ELEMENT_BINARY,
-		ELEMENT_MAP,
-		ELEMENT_ARRAY,
-		ELEMENT_KEY,
-		ELEMENT_UNKNOWN
-	};
-	static Element readElement(const XML_Char* name);
-	
-	static const XML_Char* findAttribute(const XML_Char* name, const XML_Char** pairs);
-	
 
 	XML_Parser	mParser;
 
@@ -516,19 +709,6 @@ void LLSDXMLParser::Impl::startSkipping()
 	mSkipThrough = mDepth;
 }
 
-const XML_Char*
-LLSDXMLParser::Impl::findAttribute(const XML_Char* name, const XML_Char** pairs)
-{
-	while (NULL != pairs && NULL != *pairs)
-	{
-		if(0 == strcmp(name, *pairs))
-		{
-			return *(pairs + 1);
-		}
-		pairs += 2;
-	}
-	return NULL;
-}
 
 void LLSDXMLParser::Impl::parsePart(const char* buf, int len)
 {
@@ -543,34 +723,6 @@ void LLSDXMLParser::Impl::parsePart(const char* buf, int len)
 	}
 }
 
-// Performance testing code
-//#define	XML_PARSER_PERFORMANCE_TESTS
-
-#ifdef XML_PARSER_PERFORMANCE_TESTS
-
-extern U64 totalTime();
-U64	readElementTime = 0;
-U64 startElementTime = 0;
-U64 endElementTime = 0;
-U64 charDataTime = 0;
-U64 parseTime = 0;
-
-class XML_Timer
-{
-public:
-	XML_Timer( U64 * sum ) : mSum( sum )
-	{
-		mStart = totalTime();
-	}
-	~XML_Timer()
-	{
-		*mSum += (totalTime() - mStart);
-	}
-
-	U64 * mSum;
-	U64 mStart;
-};
-#endif // XML_PARSER_PERFORMANCE_TESTS
 
 void LLSDXMLParser::Impl::startElementHandler(const XML_Char* name, const XML_Char** attributes)
 {
@@ -703,86 +855,7 @@ void LLSDXMLParser::Impl::endElementHandler(const XML_Char* name)
 	LLSD& value = *mStack.back();
 	mStack.pop_back();
 	
-	switch (element)
-	{
-		case ELEMENT_UNDEF:
-			value.clear();
-			break;
-		
-		case ELEMENT_BOOL:
-			value = (mCurrentContent == "true" || mCurrentContent == "1");
-			break;
-		
-		case ELEMENT_INTEGER:
-			{
-				S32 i;
-				if ( sscanf(mCurrentContent.c_str(), "%d", &i ) == 1 )
-				{	// See if sscanf works - it's faster
-					value = i;
-				}
-				else
-				{
-					value = LLSD(mCurrentContent).asInteger();
-				}
-			}
-			break;
-		
-		case ELEMENT_REAL:
-			{
-				F64 r;
-				if ( sscanf(mCurrentContent.c_str(), "%lf", &r ) == 1 )
-				{	// See if sscanf works - it's faster
-					value = r;
-				}
-				else
-				{
-					value = LLSD(mCurrentContent).asReal();
-				}
-			}
-			break;
-		
-		case ELEMENT_STRING:
-			value = mCurrentContent;
-			break;
-		
-		case ELEMENT_UUID:
-			value = LLSD(mCurrentContent).asUUID();
-			break;
-		
-		case ELEMENT_DATE:
-			value = LLSD(mCurrentContent).asDate();
-			break;
-		
-		case ELEMENT_URI:
-			value = LLSD(mCurrentContent).asURI();
-			break;
-		
-		case ELEMENT_BINARY:
-		{
-			// Regex is expensive, but only fix for whitespace in base64,
-			// created by python and other non-linden systems - DEV-39358
-			// Fortunately we have very little binary passing now,
-			// so performance impact shold be negligible. + poppy 2009-09-04
-			boost::regex r;
-			r.assign("\\s");
-			std::string stripped = boost::regex_replace(mCurrentContent, r, "");
-			S32 len = apr_base64_decode_len(stripped.c_str());
-			std::vector<U8> data;
-			data.resize(len);
-			len = apr_base64_decode_binary(&data[0], stripped.c_str());
-			data.resize(len);
-			value = data;
-			break;
-		}
-		
-		case ELEMENT_UNKNOWN:
-			value.clear();
-			break;
-			
-		default:
-			// other values, map and array, have already been set
-			break;
-	}
+	set_value(element, mCurrentContent, value);
 
 	mCurrentContent.clear();
 }
@@ -816,71 +889,6 @@ void LLSDXMLParser::Impl::sCharacterDataHandler(
 }
 
 
-/*
-	This code is time critical
-
-	This is a sample of tag occurances of text in simstate file with ~8000 objects.
-	A tag pair (<key>something</key>) counts is counted as two:
-
-		key     - 2680178
-		real    - 1818362
-		integer -  906078
-		array   -  295682
-		map     -  191818
-		uuid    -  177903
-		binary  -  175748
-		string  -   53482
-		undef   -   40353
-		boolean -   33874
-		llsd    -   16332
-		uri     -      38
-		date    -       1
-*/
-LLSDXMLParser::Impl::Element LLSDXMLParser::Impl::readElement(const XML_Char* name)
-{
-	#ifdef XML_PARSER_PERFORMANCE_TESTS
-	XML_Timer timer( &readElementTime );
-	#endif // XML_PARSER_PERFORMANCE_TESTS
-
-	XML_Char c = *name;
-	switch (c)
-	{
-		case 'k':
-			if (strcmp(name, "key") == 0) { return ELEMENT_KEY; }
-			break;
-		case 'r':
-			if (strcmp(name, "real") == 0) { return ELEMENT_REAL; }
-			break;
-		case 'i':
-			if (strcmp(name, "integer") == 0) { return ELEMENT_INTEGER; }
-			break;
-		case 'a':
-			if (strcmp(name, "array") == 0) { return ELEMENT_ARRAY; }
-			break;
-		case 'm':
-			if (strcmp(name, "map") == 0) { return ELEMENT_MAP; }
-			break;
-		case 'u':
-			if (strcmp(name, "uuid") == 0) { return ELEMENT_UUID; }
-			if (strcmp(name, "undef") == 0) { return ELEMENT_UNDEF; }
-			if (strcmp(name, "uri") == 0) { return ELEMENT_URI; }
-			break;
-		case 'b':
-			if (strcmp(name, "binary") == 0) { return ELEMENT_BINARY; }
-			if (strcmp(name, "boolean") == 0) { return ELEMENT_BOOL; }
-			break;
-		case 's':
-			if (strcmp(name, "string") == 0) { return ELEMENT_STRING; }
-			break;
-		case 'l':
-			if (strcmp(name, "llsd") == 0) { return ELEMENT_LLSD; }
-			break;
-		case 'd':
-			if (strcmp(name, "date") == 0) { return ELEMENT_DATE; }
-			break;
-	}
-	return ELEMENT_UNKNOWN;
-}
 
 
 
@@ -924,3 +932,355 @@ void LLSDXMLParser::doReset()
 {
 	impl.reset();
 }
+
+
+/**
+ * LLSDXMLStreamParser
+ */
+class LLSDXMLStreamParser::Impl
+{
+public:
+	Impl(Listener& listener);
+	~Impl();
+
+	bool feed(const char* data, S32 length);
+	S32 finish();
+	void reset();
+
+private:
+	void startElementHandler(const XML_Char* name, const XML_Char** attributes);
+	void endElementHandler(const XML_Char* name);
+	void characterDataHandler(const XML_Char* data, int length);
+
+	static void sStartElementHandler(
+		void* userData, const XML_Char* name, const XML_Char** attributes);
+	static void sEndElementHandler(
+		void* userData, const XML_Char* name);
+	static void sCharacterDataHandler(
+		void* userData, const XML_Char* data, int length);
+
+	void startSkipping();
+
+	// A value which has started but not ended. mValue points at where
+	// it is being built, or is NULL if it is reported to the listener
+	// instead.
+	struct Frame
+	{
+		Frame(Element element, LLSD* value) : mElement(element), mValue(value) {}
+		Element mElement;
+		LLSD* mValue;
+	};
+	typedef std::vector<Frame> frame_stack_t;
+
+	XML_Parser mParser;
+	Listener& mListener;
+
+	S32 mParseCount;
+	bool mFailed;
+
+	bool mInLLSDElement;			// true if we're on LLSD
+	bool mGracefullStop;			// true if we found the </llsd
+
+	frame_stack_t mStack;
+	LLSD mCollected;				// the map or array being collected
+
+	int mDepth;
+	bool mSkipping;
+	int mSkipThrough;
+
+	std::string mCurrentKey;		// Current XML <tag>
+	std::string mCurrentContent;	// String data between <tag> and </tag>
+};
+
+LLSDXMLStreamParser::Impl::Impl(Listener& listener)
+	: mListener(listener)
+{
+	mParser = XML_ParserCreate(NULL);
+	reset();
+}
+
+LLSDXMLStreamParser::Impl::~Impl()
+{
+	XML_ParserFree(mParser);
+}
+
+bool LLSDXMLStreamParser::Impl::feed(const char* data, S32 length)
+{
+	if (mGracefullStop || mFailed || length <= 0)
+	{
+		return !mFailed;
+	}
+	XML_Status status = XML_Parse(mParser, data, length, false);
+	if (status == XML_STATUS_ERROR && !mGracefullStop)
+	{
+		llinfos << "LLSDXMLStreamParser::Impl::feed: XML_STATUS_ERROR: "
+				<< XML_ErrorString(XML_GetErrorCode(mParser)) << llendl;
+		mFailed = true;
+	}
+	return !mFailed;
+}
+
+S32 LLSDXMLStreamParser::Impl::finish()
+{
+	if (!mGracefullStop && !mFailed)
+	{
+		XML_Status status = XML_Parse(mParser, NULL, 0, true);
+		if (status == XML_STATUS_ERROR && !mGracefullStop)
+		{
+			llinfos << "LLSDXMLStreamParser::Impl::finish: XML_STATUS_ERROR: "
+					<< XML_ErrorString(XML_GetErrorCode(mParser)) << llendl;
+			mFailed = true;
+		}
+	}
+	return mFailed ? LLSDParser::PARSE_FAILURE : mParseCount;
+}
+
+void LLSDXMLStreamParser::Impl::reset()
+{
+	mParseCount = 0;
+	mFailed = false;
+
+	mInLLSDElement = false;
+	mDepth = 0;
+
+	mGracefullStop = false;
+
+	mStack.clear();
+	mCollected.clear();
+
+	mSkipping = false;
+
+	mCurrentKey.clear();
+	mCurrentContent.clear();
+
+	XML_ParserReset(mParser, "utf-8");
+	XML_SetUserData(mParser, this);
+	XML_SetElementHandler(mParser, sStartElementHandler, sEndElementHandler);
+	XML_SetCharacterDataHandler(mParser, sCharacterDataHandler);
+}
+
+void LLSDXMLStreamParser::Impl::startSkipping()
+{
+	mSkipping = true;
+	mSkipThrough = mDepth;
+}
+
+// Same rules as LLSDXMLParser::Impl::startElementHandler(), except that
+// values inside maps and arrays which are not being collected go to
+// the listener instead of into a tree.
+void LLSDXMLStreamParser::Impl::startElementHandler(const XML_Char* name, const XML_Char** attributes)
+{
+	++mDepth;
+	if (mSkipping)
+	{
+		return;
+	}
+
+	Element element = readElement(name);
+
+	mCurrentContent.clear();
+
+	switch (element)
+	{
+		case ELEMENT_LLSD:
+			if (mInLLSDElement) { return startSkipping(); }
+			mInLLSDElement = true;
+			return;
+
+		case ELEMENT_KEY:
+			if (mStack.empty()  ||  (mStack.back().mElement != ELEMENT_MAP))
+			{
+				return startSkipping();
+			}
+			return;
+
+		case ELEMENT_BINARY:
+		{
+			const XML_Char* encoding = findAttribute("encoding", attributes);
+			if(encoding && strcmp("base64", encoding) != 0) { return startSkipping(); }
+			break;
+		}
+
+		default:
+			// all rest are values, fall through
+			;
+	}
+
+	if (!mInLLSDElement) { return startSkipping(); }
+
+	LLSD* value = NULL;
+	if (!mStack.empty())
+	{
+		Frame& parent = mStack.back();
+		if (parent.mElement == ELEMENT_MAP)
+		{
+			if (mCurrentKey.empty()) { return startSkipping(); }
+
+			if (parent.mValue)
+			{
+				value = &(*parent.mValue)[mCurrentKey];
+			}
+			else
+			{
+				mListener.key(mCurrentKey);
+			}
+			mCurrentKey.clear();
+		}
+		else if (parent.mElement == ELEMENT_ARRAY)
+		{
+			if (parent.mValue)
+			{
+				LLSD& array = *parent.mValue;
+				array.append(LLSD());
+				value = &array[array.size()-1];
+			}
+		}
+		else
+		{
+			// improperly nested value in a non-structure
+			return startSkipping();
+		}
+	}
+
+	++mParseCount;
+	if (element == ELEMENT_MAP || element == ELEMENT_ARRAY)
+	{
+		if (!value && mListener.collect((S32)mStack.size()))
+		{
+			value = &mCollected;
+		}
+
+		if (value)
+		{
+			*value = (element == ELEMENT_MAP) ? LLSD::emptyMap() : LLSD::emptyArray();
+		}
+		else if (element == ELEMENT_MAP)
+		{
+			mListener.startMap();
+		}
+		else
+		{
+			mListener.startArray();
+		}
+	}
+	mStack.push_back(Frame(element, value));
+}
+
+void LLSDXMLStreamParser::Impl::endElementHandler(const XML_Char* name)
+{
+	--mDepth;
+	if (mSkipping)
+	{
+		if (mDepth < mSkipThrough)
+		{
+			mSkipping = false;
+		}
+		return;
+	}
+
+	Element element = readElement(name);
+
+	switch (element)
+	{
+		case ELEMENT_LLSD:
+			if (mInLLSDElement)
+			{
+				mInLLSDElement = false;
+				mGracefullStop = true;
+				XML_StopParser(mParser, false);
+			}
+			return;
+
+		case ELEMENT_KEY:
+			mCurrentKey = mCurrentContent;
+			return;
+
+		default:
+			// all rest are values, fall through
+			;
+	}
+
+	if (!mInLLSDElement) { return; }
+
+	Frame frame = mStack.back();
+	mStack.pop_back();
+
+	if (frame.mValue)
+	{
+		set_value(element, mCurrentContent, *frame.mValue);
+		if (frame.mValue == &mCollected)
+		{
+			mListener.value(mCollected);
+			mCollected.clear();
+		}
+	}
+	else if (element == ELEMENT_MAP)
+	{
+		mListener.endMap();
+	}
+	else if (element == ELEMENT_ARRAY)
+	{
+		mListener.endArray();
+	}
+	else
+	{
+		LLSD value;
+		set_value(element, mCurrentContent, value);
+		mListener.value(value);
+	}
+
+	mCurrentContent.clear();
+}
+
+void LLSDXMLStreamParser::Impl::characterDataHandler(const XML_Char* data, int length)
+{
+	mCurrentContent.append(data, length);
+}
+
+void LLSDXMLStreamParser::Impl::sStartElementHandler(
+	void* userData, const XML_Char* name, const XML_Char** attributes)
+{
+	((LLSDXMLStreamParser::Impl*)userData)->startElementHandler(name, attributes);
+}
+
+void LLSDXMLStreamParser::Impl::sEndElementHandler(
+	void* userData, const XML_Char* name)
+{
+	((LLSDXMLStreamParser::Impl*)userData)->endElementHandler(name);
+}
+
+void LLSDXMLStreamParser::Impl::sCharacterDataHandler(
+	void* userData, const XML_Char* data, int length)
+{
+	((LLSDXMLStreamParser::Impl*)userData)->characterDataHandler(data, length);
+}
+
+
+LLSDXMLStreamParser::Listener::~Listener()
+{
+}
+
+LLSDXMLStreamParser::LLSDXMLStreamParser(Listener& listener)
+	: impl(* new Impl(listener))
+{
+}
+
+LLSDXMLStreamParser::~LLSDXMLStreamParser()
+{
+	delete &impl;
+}
+
+bool LLSDXMLStreamParser::feed(const char* data, S32 length)
+{
+	return impl.feed(data, length);
+}
+
+S32 LLSDXMLStreamParser::finish()
+{
+	return impl.finish();
+}
+
+void LLSDXMLStreamParser::reset()
+{
+	impl.reset();
+}
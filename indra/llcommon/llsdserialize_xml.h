@@ -31,5 +31,88 @@
 
 // all the XML class definitions are in llsdserialze.h for now
 
+/** 
+ * @class LLSDXMLStreamParser
+ * @brief Parser which reports XML format LLSD as it is read.
+ *
+ * LLSDXMLParser builds the whole document before anyone gets to see
+ * it. This parser is fed the document a piece at a time, as it comes
+ * off the network, and hands each value to a listener as soon as it
+ * has been read. Only the maps and arrays the listener asks to have
+ * collected are ever built, so memory use depends on the largest of
+ * those rather than on the size of the document.
+ */
+class LL_COMMON_API LLSDXMLStreamParser
+{
+public:
+	/** 
+	 * @class Listener
+	 * @brief Receives the document from an LLSDXMLStreamParser.
+	 *
+	 * A map is reported as startMap(), then key() and the value for
+	 * each member, then endMap(). An array is reported the same way
+	 * without the keys. Everything else, along with any map or array
+	 * collect() asked for, is passed to value() whole.
+	 */
+	class LL_COMMON_API Listener
+	{
+	public:
+		virtual ~Listener();
+
+		/** 
+		 * @brief Called as each map or array starts.
+		 *
+		 * @param depth The number of maps and arrays it is inside. The
+		 * top level value has a depth of 0.
+		 * @return Return true to have it built and passed to value()
+		 * once it ends instead of being reported piece by piece.
+		 */
+		virtual bool collect(S32 depth) { return false; }
+
+		virtual void startMap() {}
+		virtual void endMap() {}
+		virtual void startArray() {}
+		virtual void endArray() {}
+		virtual void key(const std::string& key) {}
+		virtual void value(const LLSD& value) {}
+	};
+
+	LLSDXMLStreamParser(Listener& listener);
+	~LLSDXMLStreamParser();
+
+	/** 
+	 * @brief Parse the next piece of the document.
+	 *
+	 * Pieces may be split anywhere, even inside a tag. Anything fed
+	 * in after the closing llsd tag is ignored.
+	 * @param data The next bytes of the document.
+	 * @param length The number of bytes at data.
+	 * @return Returns false once the document has turned out to be
+	 * malformed.
+	 */
+	bool feed(const char* data, S32 length);
+
+	/** 
+	 * @brief Call once the whole document has been fed in.
+	 *
+	 * @return Returns the number of LLSD objects parsed. Returns
+	 * LLSDParser::PARSE_FAILURE (-1) on parse failure.
+	 */
+	S32 finish();
+
+	/** 
+	 * @brief Resets the parser so it can be fed another document.
+	 */
+	void reset();
+
+private:
+	class Impl;
+	Impl& impl;
+
+	// not copyable
+	LLSDXMLStreamParser(const LLSDXMLStreamParser&);
+	LLSDXMLStreamParser& operator=(const LLSDXMLStreamParser&);
+};
+
 #endif // LL_LLSDSERIALIZE_XML_H
 
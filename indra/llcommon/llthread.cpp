@@ -386,6 +386,63 @@ void LLCondition::broadcast()
 
 //============================================================================
 
+LLReadWriteLock::LLReadWriteLock(apr_pool_t *poolp) :
+	mAPRLockp(NULL)
+{
+	if (poolp)
+	{
+		mIsLocalPool = FALSE;
+		mAPRPoolp = poolp;
+	}
+	else
+	{
+		mIsLocalPool = TRUE;
+		apr_pool_create(&mAPRPoolp, NULL);
+	}
+	apr_thread_rwlock_create(&mAPRLockp, mAPRPoolp);
+}
+
+LLReadWriteLock::~LLReadWriteLock()
+{
+	apr_thread_rwlock_destroy(mAPRLockp);
+	mAPRLockp = NULL;
+	if (mIsLocalPool)
+	{
+		apr_pool_destroy(mAPRPoolp);
+	}
+}
+
+void LLReadWriteLock::readLock()
+{
+	apr_thread_rwlock_rdlock(mAPRLockp);
+}
+
+void LLReadWriteLock::writeLock()
+{
+	apr_thread_rwlock_wrlock(mAPRLockp);
+}
+
+void LLReadWriteLock::unlock()
+{
+	apr_thread_rwlock_unlock(mAPRLockp);
+}
+
+bool LLReadWriteLock::isLocked()
+{
+	apr_status_t status = apr_thread_rwlock_trywrlock(mAPRLockp);
+	if (APR_STATUS_IS_EBUSY(status))
+	{
+		return true;
+	}
+	else
+	{
+		apr_thread_rwlock_unlock(mAPRLockp);
+		return false;
+	}
+}
+
+//============================================================================
+
 //----------------------------------------------------------------------------
 
 //static
@@ -30,10 +30,12 @@
 #include "llapp.h"
 #include "llapr.h"
 #include "apr_thread_cond.h"
+#include "apr_thread_rwlock.h"
 
 class LLThread;
 class LLMutex;
 class LLCondition;
+class LLReadWriteLock;
 
 class LL_COMMON_API LLThread
 {
@@ -159,6 +161,24 @@ protected:
 	apr_thread_cond_t *mAPRCondp;
 };
 
+// Any number of readers, or one writer, at a time.
+class LL_COMMON_API LLReadWriteLock
+{
+public:
+	LLReadWriteLock(apr_pool_t *apr_poolp); // NULL pool constructs a new pool for the lock
+	~LLReadWriteLock();
+
+	void readLock();	// blocks while there is a writer
+	void writeLock();	// blocks while there are readers or a writer
+	void unlock();		// releases either kind of lock
+	bool isLocked();	// non-blocking, but does do a lock/unlock so not free
+
+protected:
+	apr_thread_rwlock_t *mAPRLockp;
+	apr_pool_t			*mAPRPoolp;
+	BOOL				mIsLocalPool;
+};
+
 class LLMutexLock
 {
 public:
@@ -0,0 +1,261 @@
+/**
+ * @file llthreadscheduler.cpp
+ *
+ * $LicenseInfo:firstyear=2011&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2011, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "llthreadscheduler.h"
+
+#include "llprocessor.h"
+#include "llqueuedthread.h"
+#include "lltimer.h"
+
+//============================================================================
+
+//static
+LLThreadScheduler* LLThreadScheduler::sInstance = NULL;
+
+// MAIN THREAD
+//static
+void LLThreadScheduler::initClass(U32 num_workers)
+{
+	llassert(sInstance == NULL);
+	if (num_workers == 0)
+	{
+		S32 cpus = LLProcessorInfo().getNumLogicalCPUs();
+		num_workers = cpus > 1 ? (U32)(cpus - 1) : 1;
+	}
+	sInstance = new LLThreadScheduler(num_workers);
+}
+
+// MAIN THREAD
+// All queues using the scheduler must have been shut down first.
+//static
+void LLThreadScheduler::cleanupClass()
+{
+	delete sInstance;
+	sInstance = NULL;
+}
+
+LLThreadScheduler::LLThreadScheduler(U32 num_workers)
+	: mQueuedTasks(0),
+	  mNextWorker(0)
+{
+	llassert_always(num_workers > 0);
+	// Create every worker before starting any, popTask() walks mWorkers.
+	for (U32 i = 0; i < num_workers; ++i)
+	{
+		mWorkers.push_back(new Worker(this, i));
+	}
+	for (worker_list_t::iterator iter = mWorkers.begin(); iter != mWorkers.end(); ++iter)
+	{
+		(*iter)->start();
+	}
+	llinfos << "Thread scheduler started with " << num_workers << " worker(s)" << llendl;
+}
+
+LLThreadScheduler::~LLThreadScheduler()
+{
+	if (mQueuedTasks > 0)
+	{
+		llwarns << "LLThreadScheduler destroyed with " << (S32)mQueuedTasks << " queued tasks" << llendl;
+	}
+	dumpWorkerStats();
+	for (worker_list_t::iterator iter = mWorkers.begin(); iter != mWorkers.end(); ++iter)
+	{
+		(*iter)->quit();
+	}
+	for (worker_list_t::iterator iter = mWorkers.begin(); iter != mWorkers.end(); ++iter)
+	{
+		delete *iter; // ~LLThread() waits for the thread to stop
+	}
+	mWorkers.clear();
+}
+
+//----------------------------------------------------------------------------
+
+void LLThreadScheduler::schedule(LLQueuedThread* queue)
+{
+	// Work scheduled from a worker stays on that worker's deque (the queue's
+	// data is likely still in its cache), anything else is spread round robin.
+	S32 index = getCurrentWorkerIndex();
+	if (index < 0)
+	{
+		index = (S32)(mNextWorker++ % mWorkers.size());
+	}
+	pushTask((U32)index, queue);
+}
+
+S32 LLThreadScheduler::getCurrentWorkerIndex() const
+{
+	U32 thread_id = LLThread::currentID();
+	for (U32 i = 0; i < mWorkers.size(); ++i)
+	{
+		if (mWorkers[i]->mThreadID == thread_id)
+		{
+			return (S32)i;
+		}
+	}
+	return -1;
+}
+
+void LLThreadScheduler::pushTask(U32 index, LLQueuedThread* queue)
+{
+	Worker* worker = mWorkers[index];
+	worker->mTasksMutex->lock();
+	worker->mTasks.push_back(queue);
+	worker->mTasksMutex->unlock();
+	mQueuedTasks++;
+
+	worker->wake();
+	// The owner may be busy with a long slice, give a neighbour the chance to steal
+	wakeIdleWorker(index);
+}
+
+// Takes the oldest task from our own deque, or the newest from someone else's.
+LLQueuedThread* LLThreadScheduler::popTask(U32 index, bool& stolen)
+{
+	LLQueuedThread* queue = NULL;
+	const U32 count = mWorkers.size();
+	for (U32 i = 0; i < count && !queue; ++i)
+	{
+		Worker* worker = mWorkers[(index + i) % count];
+		worker->mTasksMutex->lock();
+		if (!worker->mTasks.empty())
+		{
+			if (i == 0)
+			{
+				queue = worker->mTasks.front();
+				worker->mTasks.pop_front();
+			}
+			else
+			{
+				queue = worker->mTasks.back();
+				worker->mTasks.pop_back();
+				stolen = true;
+			}
+		}
+		worker->mTasksMutex->unlock();
+	}
+	if (queue)
+	{
+		mQueuedTasks--;
+	}
+	return queue;
+}
+
+void LLThreadScheduler::wakeIdleWorker(U32 from_index)
+{
+	if (mWorkers.size() > 1)
+	{
+		// wake() does nothing if the worker is not waiting
+		mWorkers[(from_index + 1) % mWorkers.size()]->wake();
+	}
+}
+
+// MAIN THREAD
+void LLThreadScheduler::getWorkerStats(worker_stats_list_t& stats)
+{
+	stats.clear();
+	for (worker_list_t::iterator iter = mWorkers.begin(); iter != mWorkers.end(); ++iter)
+	{
+		stats.push_back((*iter)->mStats);
+	}
+}
+
+// MAIN THREAD
+void LLThreadScheduler::dumpWorkerStats()
+{
+	for (U32 i = 0; i < mWorkers.size(); ++i)
+	{
+		const WorkerStats& stats = mWorkers[i]->mStats;
+		llinfos << llformat("Scheduler worker %d: %d slices (%d stolen), busy %.3fs",
+							i, stats.mTasksRun, stats.mTasksStolen, stats.mBusyTime) << llendl;
+	}
+}
+
+//============================================================================
+
+LLThreadScheduler::Worker::Worker(LLThreadScheduler* scheduler, U32 index)
+	: LLThread(llformat("scheduler%d", index)),
+	  mScheduler(scheduler),
+	  mIndex(index),
+	  mThreadID(0)
+{
+	mTasksMutex = new LLMutex(NULL);
+}
+
+LLThreadScheduler::Worker::~Worker()
+{
+	shutdown(); // stop the thread before its deque goes away
+	delete mTasksMutex;
+}
+
+// virtual
+bool LLThreadScheduler::Worker::runCondition()
+{
+	// mRunCondition must be locked here
+	return mScheduler->mQueuedTasks > 0;
+}
+
+// virtual
+void LLThreadScheduler::Worker::run()
+{
+	mThreadID = LLThread::currentID();
+
+	while (1)
+	{
+		// Blocks until a task is queued anywhere in the pool
+		checkPause();
+
+		if (isQuitting())
+		{
+			break;
+		}
+
+		bool stolen = false;
+		LLQueuedThread* queue = mScheduler->popTask(mIndex, stolen);
+		if (!queue)
+		{
+			// Someone else got there first
+			yield();
+			continue;
+		}
+		if (mScheduler->mQueuedTasks > 0)
+		{
+			mScheduler->wakeIdleWorker(mIndex);
+		}
+
+		LLTimer timer;
+		bool more_work = queue->processScheduled();
+		mStats.mTasksRun++;
+		mStats.mTasksStolen += stolen ? 1 : 0;
+		mStats.mBusyTime += timer.getElapsedTimeF64();
+
+		if (more_work)
+		{
+			mScheduler->pushTask(mIndex, queue);
+		}
+	}
+	llinfos << "LLThreadScheduler " << mName << " EXITING." << llendl;
+}
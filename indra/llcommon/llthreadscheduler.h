@@ -0,0 +1,121 @@
+/**
+ * @file llthreadscheduler.h
+ * @brief Shared work-stealing pool of threads servicing LLQueuedThread queues.
+ *
+ * $LicenseInfo:firstyear=2011&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2011, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLTHREADSCHEDULER_H
+#define LL_LLTHREADSCHEDULER_H
+
+#include <deque>
+#include <vector>
+
+#include "llthread.h"
+
+class LLQueuedThread;
+
+//============================================================================
+// A fixed set of worker threads that run LLQueuedThread request queues in
+// place of each queue owning its own OS thread.
+//
+// A queue with pending requests is handed to the scheduler as a task (see
+// LLQueuedThread::scheduleWork()). Each worker owns a deque of such tasks;
+// it runs its own tasks front to back and, when it runs dry, steals from the
+// back of the other workers' deques. Running a task processes that queue's
+// requests for a short time slice, then the task is pushed back onto the
+// worker's deque if the queue still has work, so long running queues do not
+// starve the others.
+//
+// Request priority within a queue is still decided by the queue itself.
+// A queue may be handed out to at most its scheduled concurrency worth of
+// workers at once, so subsystems that are not safe to run concurrently with
+// themselves (e.g. anything using LLThread::getLocalAPRFilePool()) use 1.
+
+class LL_COMMON_API LLThreadScheduler
+{
+public:
+	struct WorkerStats
+	{
+		WorkerStats() : mTasksRun(0), mTasksStolen(0), mBusyTime(0.0) {}
+		U32 mTasksRun;		// task time slices run by this worker
+		U32 mTasksStolen;	// of which were taken from another worker's deque
+		F64 mBusyTime;		// seconds spent running tasks
+	};
+	typedef std::vector<WorkerStats> worker_stats_list_t;
+
+	// num_workers == 0 uses one worker per logical CPU, minus one for the main thread
+	static void initClass(U32 num_workers = 0);
+	static void cleanupClass();
+	static LLThreadScheduler* getInstance() { return sInstance; }
+
+	// May be called from any thread
+	void schedule(LLQueuedThread* queue);
+
+	U32 getNumWorkers() const { return mWorkers.size(); }
+	// Returns the index of the calling worker, or -1 when not called from one
+	S32 getCurrentWorkerIndex() const;
+
+	void getWorkerStats(worker_stats_list_t& stats);
+	void dumpWorkerStats();
+
+protected:
+	LLThreadScheduler(U32 num_workers);
+	~LLThreadScheduler();
+
+private:
+	class Worker : public LLThread
+	{
+	public:
+		Worker(LLThreadScheduler* scheduler, U32 index);
+		~Worker();
+
+		void quit() { setQuitting(); }
+
+		/*virtual*/ bool runCondition();
+		/*virtual*/ void run();
+
+	private:
+		friend class LLThreadScheduler;
+
+		LLThreadScheduler* mScheduler;
+		U32 mIndex;
+		U32 mThreadID;
+		std::deque<LLQueuedThread*> mTasks;
+		LLMutex* mTasksMutex;
+		WorkerStats mStats; // only written by this worker
+	};
+	friend class Worker;
+	typedef std::vector<Worker*> worker_list_t;
+
+	void pushTask(U32 index, LLQueuedThread* queue);
+	LLQueuedThread* popTask(U32 index, bool& stolen);
+	void wakeIdleWorker(U32 from_index);
+
+	worker_list_t mWorkers;
+	LLAtomicS32 mQueuedTasks; // total across all worker deques
+	LLAtomicU32 mNextWorker;  // round robin target for tasks scheduled by other threads
+
+	static LLThreadScheduler* sInstance;
+};
+
+#endif // LL_LLTHREADSCHEDULER_H
@@ -34,8 +34,8 @@
 //============================================================================
 // Run on MAIN thread
 
-LLWorkerThread::LLWorkerThread(const std::string& name, bool threaded) :
-	LLQueuedThread(name, threaded)
+LLWorkerThread::LLWorkerThread(const std::string& name, bool threaded, U32 scheduled_concurrency) :
+	LLQueuedThread(name, threaded, scheduled_concurrency)
 {
 	mDeleteMutex = new LLMutex(NULL);
 
@@ -281,7 +281,11 @@ void LLWorkerClass::setWorking(bool working)
 bool LLWorkerClass::yield()
 {
 	LLThread::yield();
-	mWorkerThread->checkPause();
+	if (!mWorkerThread->isScheduled())
+	{
+		// Never block a shared scheduler worker on our pause state
+		mWorkerThread->checkPause();
+	}
 	bool res;
 	mMutex.lock();
 	res = (getFlags() & WCF_ABORT_REQUESTED) ? true : false;
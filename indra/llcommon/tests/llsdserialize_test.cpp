@@ -32,7 +32,9 @@
 #include "linden_common.h"
 #include "../llsd.h"
 #include "../llsdserialize.h"
+#include "../llsdserialize_xml.h"
 #include "../llformat.h"
+#include "../lltimer.h"
 
 #include "../test/lltut.h"
 
@@ -259,10 +261,16 @@ namespace tut
 		LLSD w;
 		mParser->reset();	// reset() call is needed since test code re-uses mParser
 		mParser->parse(stream, w, stream.str().size());
+
+		std::string serialized(stream.str());
+		LLSD b;
+		mParser->reset();
+		mParser->parse((const U8*)serialized.data(), (S32)serialized.size(), b);
 		
 		try
 		{
 			ensure_equals(msg.c_str(), w, v);
+			ensure_equals((msg + " (buffer)").c_str(), b, v);
 		}
 		catch (...)
 		{
@@ -518,6 +526,16 @@ namespace tut
 			std::string count_msg(msg);
 			count_msg += " (count)";
 			ensure_equals(count_msg, parsed_count, expected_count);
+
+			// parsing straight out of memory must agree with the stream
+			std::string buffer_msg(msg);
+			buffer_msg += " (buffer)";
+			LLSD buffer_result;
+			mParser->reset();
+			S32 buffer_count = mParser->parse((const U8*)in.data(), (S32)in.size(), buffer_result);
+			ensure_equals(buffer_msg.c_str(), buffer_result, expected_value);
+			buffer_msg += " (count)";
+			ensure_equals(buffer_msg, buffer_count, expected_count);
 		}
 
 		LLPointer<parser_t> mParser;
@@ -1494,5 +1512,443 @@ namespace tut
 		ensureBinaryAndNotation("map", test);
 		ensureBinaryAndXML("map", test);
 	}
-}
 
+	/**
+	 * @class TestLLSDParseBenchmark
+	 * @brief Times parsing of an inventory descendents response in each
+	 * format and counts the LLSD values allocated while doing so.
+	 */
+	class TestLLSDParseBenchmark
+	{
+	public:
+		TestLLSDParseBenchmark() : mValueCount(0), mSharedCount(0)
+		{
+			mDocument = LLSD::emptyMap();
+			LLUUID agent_id;
+			agent_id.generate();
+			for (S32 f = 0; f < 20; ++f)
+			{
+				LLSD folder;
+				folder["folder_id"] = makeUUID();
+				folder["owner_id"] = count(agent_id);
+				folder["version"] = count(f + 40);
+				folder["descendents"] = count(50);
+				for (S32 i = 0; i < 50; ++i)
+				{
+					LLSD item;
+					item["item_id"] = makeUUID();
+					item["parent_id"] = count(folder["folder_id"]);
+					item["asset_id"] = makeUUID();
+					item["type"] = count(6);
+					item["inv_type"] = count(6);
+					item["flags"] = count(0);
+					item["name"] = count(llformat("Object %d", i));
+					item["desc"] = count("(No Description)");
+					item["created_at"] = count(1300000000 + i);
+					LLSD& perm = item["permissions"];
+					perm["creator_id"] = count(agent_id);
+					perm["owner_id"] = count(agent_id);
+					perm["last_owner_id"] = count(agent_id);
+					perm["group_id"] = count(LLUUID::null);
+					perm["is_owner_group"] = count(false);
+					perm["base_mask"] = count((S32)0x7fffffff);
+					perm["owner_mask"] = count((S32)0x7fffffff);
+					perm["group_mask"] = count(0);
+					perm["everyone_mask"] = count(0);
+					perm["next_owner_mask"] = count((S32)0x00082000);
+					LLSD& sale = item["sale_info"];
+					sale["sale_type"] = count(0);
+					sale["sale_price"] = count(10);
+					mValueCount += 3; // item, permissions, sale_info
+					folder["items"].append(item);
+				}
+				mValueCount += 2; // folder, items
+				mDocument["folders"].append(folder);
+			}
+			mValueCount += 2; // document, folders
+		}
+
+		LLSD count(const LLSD& value)
+		{
+			++mValueCount;
+			U32 allocations_at_start = LLSD::allocationCount();
+			LLSD copy;
+			switch (value.type())
+			{
+			case LLSD::TypeBoolean:	copy = value.asBoolean();	break;
+			case LLSD::TypeInteger:	copy = value.asInteger();	break;
+			case LLSD::TypeUUID:	copy = value.asUUID();		break;
+			default:				copy = value.asString();	break;
+			}
+			if (LLSD::allocationCount() == allocations_at_start)
+			{
+				++mSharedCount;
+			}
+			return value;
+		}
+
+		LLSD makeUUID()
+		{
+			LLUUID id;
+			id.generate();
+			return count(id);
+		}
+
+		void timeParse(const std::string& format, LLPointer<LLSDParser> parser, const std::string& serialized)
+		{
+			const S32 PASSES = 10;
+			U32 allocations = 0;
+			LLTimer timer;
+			for (S32 i = 0; i < PASSES; ++i)
+			{
+				std::istringstream istr(serialized);
+				U32 allocations_at_start = LLSD::allocationCount();
+				LLSD parsed;
+				ensure(format + " parsed", parser->parse(istr, parsed, serialized.size()) > 0);
+				allocations = LLSD::allocationCount() - allocations_at_start;
+				ensure_equals(format + " round trip", parsed, mDocument);
+				parser->reset();
+			}
+			F64 elapsed = timer.getElapsedTimeF64() / PASSES;
+
+			llinfos << format << ": " << serialized.size() << " bytes, "
+					<< mValueCount << " values parsed in "
+					<< llformat("%.2f", elapsed * 1000.0) << " ms with "
+					<< allocations << " allocations" << llendl;
+
+			// Every value which has a shared representation must use it
+			ensure("shared values not allocated",
+				   allocations <= mValueCount - mSharedCount);
+		}
+
+		// Times the stream and the in memory parse of the same document.
+		void timeBufferParse(const std::string& format, LLPointer<LLSDParser> parser,
+							 const std::string& serialized, const LLSD& expected)
+		{
+			const S32 PASSES = 10;
+			LLSD parsed;
+			LLTimer timer;
+			for (S32 i = 0; i < PASSES; ++i)
+			{
+				std::istringstream istr(serialized);
+				parsed.clear();
+				ensure(format + " stream parsed", parser->parse(istr, parsed, serialized.size()) > 0);
+				parser->reset();
+			}
+			F64 stream_elapsed = timer.getElapsedTimeF64() / PASSES;
+			ensure_equals(format + " stream round trip", parsed, expected);
+
+			timer.reset();
+			for (S32 i = 0; i < PASSES; ++i)
+			{
+				parsed.clear();
+				ensure(format + " buffer parsed",
+					   parser->parse((const U8*)serialized.data(), (S32)serialized.size(), parsed) > 0);
+				parser->reset();
+			}
+			F64 buffer_elapsed = timer.getElapsedTimeF64() / PASSES;
+			ensure_equals(format + " buffer round trip", parsed, expected);
+
+			llinfos << format << ": " << serialized.size() << " bytes, stream "
+					<< llformat("%.2f", stream_elapsed * 1000.0) << " ms, buffer "
+					<< llformat("%.2f", buffer_elapsed * 1000.0) << " ms" << llendl;
+		}
+
+		// Something like what the event queue hands back: chat session
+		// updates and parcel properties, with escaped strings, reals and
+		// binary blobs mixed in.
+		static LLSD makeEvents()
+		{
+			LLSD events = LLSD::emptyArray();
+			for (S32 i = 0; i < 200; ++i)
+			{
+				LLUUID agent_id, session_id;
+				agent_id.generate();
+				session_id.generate();
+				LLSD event;
+				if (i % 2)
+				{
+					event["message"] = "ChatterBoxSessionAgentListUpdates";
+					LLSD& agent = event["body"]["agent_updates"][agent_id.asString()];
+					agent["info"]["can_voice_chat"] = true;
+					agent["info"]["is_moderator"] = false;
+					agent["transition"] = "ENTER";
+					event["body"]["session_id"] = session_id;
+					event["body"]["updates"] = LLSD::emptyMap();
+				}
+				else
+				{
+					event["message"] = "ParcelProperties";
+					LLSD parcel;
+					parcel["Name"] = llformat("Parcel \"%d\"\n\tby the sea", i);
+					parcel["Desc"] = "A quiet spot.\nNo building, please.";
+					parcel["OwnerID"] = agent_id;
+					parcel["Area"] = 512 * (i + 1);
+					parcel["AABBMin"].append(128.5 + i);
+					parcel["AABBMin"].append(64.25);
+					parcel["AABBMin"].append(0.0);
+					parcel["AABBMax"].append(192.5 + i);
+					parcel["AABBMax"].append(128.75);
+					parcel["AABBMax"].append(4096.0);
+					parcel["MusicURL"] = LLURI("http://example.com/stream");
+					parcel["ClaimDate"] = LLDate(1300000000.0 + i);
+					parcel["Bitmap"] = LLSD::Binary(512, (U8)i);
+					event["body"]["ParcelData"].append(parcel);
+				}
+				events.append(event);
+			}
+			LLSD document;
+			document["events"] = events;
+			document["id"] = 42;
+			return document;
+		}
+
+		LLSD mDocument;
+		U32 mValueCount;
+		U32 mSharedCount;
+	};
+
+	typedef tut::test_group<TestLLSDParseBenchmark> TestLLSDParseBenchmarkGroup;
+	typedef TestLLSDParseBenchmarkGroup::object TestLLSDParseBenchmarkObject;
+	TestLLSDParseBenchmarkGroup gTestLLSDParseBenchmarkGroup("llsd parse benchmark");
+
+	template<> template<>
+	void TestLLSDParseBenchmarkObject::test<1>()
+	{
+		std::ostringstream ostr;
+		LLSDSerialize::toXML(mDocument, ostr);
+		timeParse("xml", new LLSDXMLParser, ostr.str());
+	}
+
+	template<> template<>
+	void TestLLSDParseBenchmarkObject::test<2>()
+	{
+		std::ostringstream ostr;
+		LLSDSerialize::toNotation(mDocument, ostr);
+		timeParse("notation", new LLSDNotationParser, ostr.str());
+	}
+
+	template<> template<>
+	void TestLLSDParseBenchmarkObject::test<3>()
+	{
+		std::ostringstream ostr;
+		LLSDSerialize::toBinary(mDocument, ostr);
+		timeParse("binary", new LLSDBinaryParser, ostr.str());
+	}
+
+	template<> template<>
+	void TestLLSDParseBenchmarkObject::test<4>()
+	{
+		std::ostringstream ostr;
+		LLSDSerialize::toNotation(mDocument, ostr);
+		timeBufferParse("notation inventory", new LLSDNotationParser, ostr.str(), mDocument);
+	}
+
+	template<> template<>
+	void TestLLSDParseBenchmarkObject::test<5>()
+	{
+		std::ostringstream ostr;
+		LLSDSerialize::toBinary(mDocument, ostr);
+		timeBufferParse("binary inventory", new LLSDBinaryParser, ostr.str(), mDocument);
+	}
+
+	template<> template<>
+	void TestLLSDParseBenchmarkObject::test<6>()
+	{
+		LLSD events = makeEvents();
+		std::ostringstream ostr;
+		LLSDSerialize::toNotation(events, ostr);
+		timeBufferParse("notation events", new LLSDNotationParser, ostr.str(), events);
+	}
+
+	template<> template<>
+	void TestLLSDParseBenchmarkObject::test<7>()
+	{
+		LLSD events = makeEvents();
+		std::ostringstream ostr;
+		LLSDSerialize::toBinary(events, ostr);
+		timeBufferParse("binary events", new LLSDBinaryParser, ostr.str(), events);
+	}
+
+	/** 
+	 * @class LLSDStreamTreeBuilder
+	 * @brief Rebuilds the document an LLSDXMLStreamParser reports.
+	 */
+	class LLSDStreamTreeBuilder : public LLSDXMLStreamParser::Listener
+	{
+	public:
+		LLSDStreamTreeBuilder(S32 collect_depth) :
+			mCollectDepth(collect_depth),
+			mCollectedCount(0)
+		{
+		}
+
+		virtual bool collect(S32 depth)
+		{
+			return (mCollectDepth >= 0) && (depth >= mCollectDepth);
+		}
+		virtual void startMap() { push(LLSD::emptyMap()); }
+		virtual void endMap() { mStack.pop_back(); }
+		virtual void startArray() { push(LLSD::emptyArray()); }
+		virtual void endArray() { mStack.pop_back(); }
+		virtual void key(const std::string& key) { mKey = key; }
+		virtual void value(const LLSD& value)
+		{
+			if (value.isMap() || value.isArray())
+			{
+				++mCollectedCount;
+			}
+			place(value);
+		}
+
+		void push(const LLSD& value)
+		{
+			mStack.push_back(place(value));
+		}
+
+		LLSD* place(const LLSD& value)
+		{
+			if (mStack.empty())
+			{
+				mResult = value;
+				return &mResult;
+			}
+			LLSD& parent = *mStack.back();
+			if (parent.isMap())
+			{
+				parent[mKey] = value;
+				return &parent[mKey];
+			}
+			parent.append(value);
+			return &parent[parent.size() - 1];
+		}
+
+		S32 mCollectDepth;
+		S32 mCollectedCount;
+		std::string mKey;
+		std::vector<LLSD*> mStack;
+		LLSD mResult;
+	};
+
+	class TestLLSDXMLStreamParsing
+	{
+	public:
+		TestLLSDXMLStreamParsing() {}
+
+		// Feeds xml in chunk_size pieces and returns the result of finish()
+		S32 feed(LLSDXMLStreamParser& parser, const std::string& xml, S32 chunk_size)
+		{
+			for (size_t offset = 0; offset < xml.size(); offset += chunk_size)
+			{
+				S32 length = llmin(chunk_size, (S32)(xml.size() - offset));
+				if (!parser.feed(xml.data() + offset, length))
+				{
+					break;
+				}
+			}
+			return parser.finish();
+		}
+
+		void ensureStreamed(const std::string& msg, const LLSD& document, S32 collect_depth)
+		{
+			std::ostringstream ostr;
+			LLSDSerialize::toXML(document, ostr);
+			std::string xml = ostr.str();
+
+			std::istringstream istr(xml);
+			LLSD expected;
+			S32 expected_count = LLSDSerialize::fromXML(expected, istr);
+
+			const S32 chunk_sizes[] = { 1, 7, 4096 };
+			for (S32 i = 0; i < 3; ++i)
+			{
+				LLSDStreamTreeBuilder builder(collect_depth);
+				LLSDXMLStreamParser parser(builder);
+				std::string name = llformat("%s in %d byte pieces", msg.c_str(), chunk_sizes[i]);
+				ensure_equals(name + " count", feed(parser, xml, chunk_sizes[i]), expected_count);
+				ensure_equals(name, builder.mResult, expected);
+			}
+		}
+	};
+
+	typedef tut::test_group<TestLLSDXMLStreamParsing> TestLLSDXMLStreamParsingGroup;
+	typedef TestLLSDXMLStreamParsingGroup::object TestLLSDXMLStreamParsingObject;
+	TestLLSDXMLStreamParsingGroup gTestLLSDXMLStreamParsingGroup("llsd XML stream parsing");
+
+	template<> template<>
+	void TestLLSDXMLStreamParsingObject::test<1>()
+	{
+		// scalars
+		ensureStreamed("undef", LLSD(), -1);
+		ensureStreamed("boolean", LLSD(true), -1);
+		ensureStreamed("integer", LLSD(-42), -1);
+		ensureStreamed("real", LLSD(3.25), -1);
+		ensureStreamed("string", LLSD("<escaped & \"quoted\">"), -1);
+		LLUUID id;
+		id.generate();
+		ensureStreamed("uuid", LLSD(id), -1);
+		ensureStreamed("date", LLSD(LLDate(1300000000.0)), -1);
+		ensureStreamed("uri", LLSD(LLURI("http://example.com/")), -1);
+		ensureStreamed("binary", LLSD(LLSD::Binary(100, 0x5a)), -1);
+		ensureStreamed("empty map", LLSD::emptyMap(), -1);
+		ensureStreamed("empty array", LLSD::emptyArray(), -1);
+	}
+
+	template<> template<>
+	void TestLLSDXMLStreamParsingObject::test<2>()
+	{
+		LLSD document;
+		document["empty map"] = LLSD::emptyMap();
+		document["empty array"] = LLSD::emptyArray();
+		document["undef"] = LLSD();
+		document["nested"][0]["a"] = 1;
+		document["nested"][0]["b"][0] = "two";
+		document["nested"][1] = LLSD::emptyArray();
+		document["nested"][2][0][0] = 3.5;
+		ensureStreamed("nested", document, -1);
+		ensureStreamed("events", TestLLSDParseBenchmark::makeEvents(), -1);
+	}
+
+	template<> template<>
+	void TestLLSDXMLStreamParsingObject::test<3>()
+	{
+		LLSD events = TestLLSDParseBenchmark::makeEvents();
+		for (S32 depth = 0; depth < 4; ++depth)
+		{
+			ensureStreamed(llformat("events collected at depth %d", depth), events, depth);
+		}
+
+		// only the events themselves are handed over whole
+		std::ostringstream ostr;
+		LLSDSerialize::toXML(events, ostr);
+		LLSDStreamTreeBuilder builder(2);
+		LLSDXMLStreamParser parser(builder);
+		ensure("parsed", feed(parser, ostr.str(), 1024) > 0);
+		ensure_equals("collected", builder.mCollectedCount, (S32)events["events"].size());
+	}
+
+	template<> template<>
+	void TestLLSDXMLStreamParsingObject::test<4>()
+	{
+		LLSDStreamTreeBuilder mismatched(-1);
+		LLSDXMLStreamParser parser(mismatched);
+		ensure_equals("mismatched tags",
+					  feed(parser, "<llsd><map><key>a</key><integer>1</string></map></llsd>", 5),
+					  (S32)LLSDParser::PARSE_FAILURE);
+
+		LLSDStreamTreeBuilder truncated(-1);
+		LLSDXMLStreamParser truncated_parser(truncated);
+		ensure_equals("truncated",
+					  feed(truncated_parser, "<llsd><array><integer>1</integer>", 5),
+					  (S32)LLSDParser::PARSE_FAILURE);
+
+		// a parser which failed can be reused
+		parser.reset();
+		mismatched.mStack.clear();
+		mismatched.mResult.clear();
+		ensure_equals("trailing data ignored",
+					  feed(parser, "<llsd><array><integer>1</integer></array></llsd>\n<garbage", 5),
+					  2);
+		ensure_equals("trailing data result", mismatched.mResult[0].asInteger(), 1);
+	}
+}
@@ -0,0 +1,305 @@
+/**
+ * @file   llthreadscheduler_test.cpp
+ * @brief  Test for llthreadscheduler.cpp, with a throughput comparison
+ *         against LLQueuedThreads owning their own thread.
+ *
+ * $LicenseInfo:firstyear=2011&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2011, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+// Precompiled header
+#include "linden_common.h"
+// associated header
+#include "llthreadscheduler.h"
+// STL headers
+#include <vector>
+// other Linden headers
+#include "llqueuedthread.h"
+#include "lltimer.h"
+#include "../test/lltut.h"
+
+namespace
+{
+	// Queue whose requests burn a fixed amount of CPU and count completions
+	class CountingThread : public LLQueuedThread
+	{
+	public:
+		class CountRequest : public LLQueuedThread::QueuedRequest
+		{
+		public:
+			CountRequest(handle_t handle, LLAtomicS32* done, S32 spin)
+				: LLQueuedThread::QueuedRequest(handle, PRIORITY_NORMAL, FLAG_AUTO_COMPLETE),
+				  mDone(done),
+				  mSpin(spin)
+			{
+			}
+
+			/*virtual*/ bool processRequest()
+			{
+				volatile U32 sum = 0;
+				for (S32 i = 0; i < mSpin; ++i)
+				{
+					sum += i * i;
+				}
+				return true;
+			}
+
+			/*virtual*/ void finishRequest(bool completed)
+			{
+				if (completed)
+				{
+					(*mDone)++;
+				}
+			}
+
+		private:
+			LLAtomicS32* mDone;
+			S32 mSpin;
+		};
+
+		// Adds up the weights of a run of items, without completing itself
+		class RunRequest : public LLQueuedThread::QueuedRequest
+		{
+		public:
+			RunRequest(handle_t handle, std::vector<U32>::const_iterator begin,
+					   std::vector<U32>::const_iterator end)
+				: LLQueuedThread::QueuedRequest(handle, PRIORITY_NORMAL),
+				  mItems(begin, end),
+				  mSum(0)
+			{
+			}
+
+			/*virtual*/ bool processRequest()
+			{
+				for (std::vector<U32>::iterator iter = mItems.begin(); iter != mItems.end(); ++iter)
+				{
+					mSum += *iter;
+				}
+				return true;
+			}
+
+			std::vector<U32> mItems;
+			U32 mSum;
+		};
+
+		struct item_weight
+		{
+			U32 operator()(U32 item) const { return item; }
+		};
+
+		CountingThread(const std::string& name, U32 concurrency)
+			: LLQueuedThread(name, true, concurrency)
+		{
+		}
+
+		void add(LLAtomicS32* done, S32 spin)
+		{
+			addRequest(new CountRequest(generateHandle(), done, spin));
+		}
+
+		void addRuns(const std::vector<U32>& items, U32 run_weight, std::vector<handle_t>& handles)
+		{
+			addRequests<RunRequest>(items, run_weight, item_weight(), handles);
+		}
+	};
+
+	typedef std::vector<CountingThread*> thread_list_t;
+
+	// Queues count requests on every thread and pumps them from this (main)
+	// thread until they are all done. Returns the elapsed seconds, or a
+	// negative value on timeout.
+	F64 run_batch(thread_list_t& threads, S32 count, S32 spin, LLAtomicS32& done)
+	{
+		done = 0;
+		LLTimer timer;
+		for (S32 i = 0; i < count; ++i)
+		{
+			threads[i % threads.size()]->add(&done, spin);
+		}
+		const S32 total = count;
+		while (done < total)
+		{
+			for (thread_list_t::iterator iter = threads.begin(); iter != threads.end(); ++iter)
+			{
+				(*iter)->update(0);
+			}
+			if (timer.getElapsedTimeF64() > 30.0)
+			{
+				return -1.0;
+			}
+			LLThread::yield();
+		}
+		return timer.getElapsedTimeF64();
+	}
+
+	void delete_threads(thread_list_t& threads)
+	{
+		for (thread_list_t::iterator iter = threads.begin(); iter != threads.end(); ++iter)
+		{
+			(*iter)->shutdown();
+			delete *iter;
+		}
+		threads.clear();
+	}
+}
+
+/*****************************************************************************
+*   TUT
+*****************************************************************************/
+namespace tut
+{
+	struct scheduler_data
+	{
+		~scheduler_data()
+		{
+			// in case a test failed half way
+			delete_threads(mThreads);
+			LLThreadScheduler::cleanupClass();
+		}
+
+		thread_list_t mThreads;
+		LLAtomicS32 mDone;
+	};
+	typedef test_group<scheduler_data> scheduler_group;
+	typedef scheduler_group::object scheduler_object;
+	scheduler_group scheduler("LLThreadScheduler");
+
+	template<> template<>
+	void scheduler_object::test<1>()
+	{
+		set_test_name("queues run on the scheduler instead of their own thread");
+		LLThreadScheduler::initClass(4);
+		ensure_equals("worker count", LLThreadScheduler::getInstance()->getNumWorkers(), 4U);
+		ensure_equals("main thread is not a worker", LLThreadScheduler::getInstance()->getCurrentWorkerIndex(), -1);
+
+		mThreads.push_back(new CountingThread("serial", 1));
+		mThreads.push_back(new CountingThread("parallel", 4));
+		mThreads.push_back(new CountingThread("unscheduled", 0));
+		ensure("concurrency 1 is scheduled", mThreads[0]->isScheduled());
+		ensure("concurrency 4 is scheduled", mThreads[1]->isScheduled());
+		ensure("concurrency 0 owns a thread", !mThreads[2]->isScheduled());
+
+		F64 elapsed = run_batch(mThreads, 3000, 100, mDone);
+		ensure("all requests completed before timeout", elapsed >= 0.0);
+		ensure_equals("every request completed exactly once", (S32)mDone, 3000);
+		for (thread_list_t::iterator iter = mThreads.begin(); iter != mThreads.end(); ++iter)
+		{
+			ensure_equals("queue drained", (*iter)->getPending(), 0);
+		}
+		delete_threads(mThreads);
+	}
+
+	template<> template<>
+	void scheduler_object::test<2>()
+	{
+		set_test_name("shutdown with queued requests aborts them");
+		LLThreadScheduler::initClass(2);
+		mThreads.push_back(new CountingThread("aborted", 2));
+		mDone = 0;
+		mThreads[0]->pause();
+		for (S32 i = 0; i < 100; ++i)
+		{
+			mThreads[0]->add(&mDone, 0);
+		}
+		// Never unpaused, so nothing ran; shutdown must not hang or leak
+		delete_threads(mThreads);
+		ensure_equals("no request completed while paused", (S32)mDone, 0);
+	}
+
+	template<> template<>
+	void scheduler_object::test<3>()
+	{
+		set_test_name("throughput against dedicated LLQueuedThreads");
+		const S32 NUM_QUEUES = 4;
+		const S32 NUM_REQUESTS = 20000;
+		// Tiny requests measure queue contention, larger ones throughput
+		const S32 SPINS[] = { 0, 20000 };
+
+		for (U32 s = 0; s < LL_ARRAY_SIZE(SPINS); ++s)
+		{
+			for (S32 q = 0; q < NUM_QUEUES; ++q)
+			{
+				mThreads.push_back(new CountingThread(llformat("dedicated%d", q), 0));
+			}
+			F64 dedicated = run_batch(mThreads, NUM_REQUESTS, SPINS[s], mDone);
+			delete_threads(mThreads);
+			ensure("dedicated batch completed", dedicated >= 0.0);
+
+			LLThreadScheduler::initClass(NUM_QUEUES);
+			for (S32 q = 0; q < NUM_QUEUES; ++q)
+			{
+				mThreads.push_back(new CountingThread(llformat("scheduled%d", q), NUM_QUEUES));
+			}
+			F64 scheduled = run_batch(mThreads, NUM_REQUESTS, SPINS[s], mDone);
+			delete_threads(mThreads);
+			LLThreadScheduler::cleanupClass();
+			ensure("scheduled batch completed", scheduled >= 0.0);
+
+			llinfos << llformat("%d requests, %d spins: dedicated %.3fs (%.0f/s), scheduled %.3fs (%.0f/s)",
+								NUM_REQUESTS, SPINS[s],
+								dedicated, NUM_REQUESTS / llmax(dedicated, 0.000001),
+								scheduled, NUM_REQUESTS / llmax(scheduled, 0.000001)) << llendl;
+		}
+	}
+
+	template<> template<>
+	void scheduler_object::test<4>()
+	{
+		set_test_name("batches split into runs and waited for with help");
+		LLThreadScheduler::initClass(2);
+		mThreads.push_back(new CountingThread("runs", 2));
+		// paused workers leave every run to waitForRequest()
+		mThreads[0]->pause();
+
+		std::vector<U32> items;
+		U32 total = 0;
+		for (U32 i = 0; i < 1000; ++i)
+		{
+			items.push_back(i % 7);
+			total += i % 7;
+		}
+		std::vector<LLQueuedThread::handle_t> handles;
+		mThreads[0]->addRuns(items, 100, handles);
+		ensure("split into runs", handles.size() > 1);
+		ensure("runs of about the run weight", handles.size() <= total / 100 + 1);
+
+		U32 sum = 0;
+		size_t count = 0;
+		for (size_t i = 0; i < handles.size(); ++i)
+		{
+			ensure_equals("run done", mThreads[0]->waitForRequest(handles[i]), LLQueuedThread::STATUS_COMPLETE);
+			CountingThread::RunRequest* req = (CountingThread::RunRequest*)mThreads[0]->getRequest(handles[i]);
+			sum += req->mSum;
+			count += req->mItems.size();
+		}
+		ensure_equals("every item in one run", count, items.size());
+		ensure_equals("every item added up", sum, total);
+
+		std::vector<LLQueuedThread::handle_t> waited(handles);
+		mThreads[0]->waitForRequests(handles);
+		ensure("handles cleared", handles.empty());
+		for (size_t i = 0; i < waited.size(); ++i)
+		{
+			ensure("request completed", mThreads[0]->getRequest(waited[i]) == NULL);
+		}
+		delete_threads(mThreads);
+	}
+}
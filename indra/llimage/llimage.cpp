@@ -31,6 +31,7 @@
 #include "llmath.h"
 #include "v4coloru.h"
 #include "llmemtype.h"
+#include "llprocessor.h"
 
 #include "llimagebmp.h"
 #include "llimagetga.h"
@@ -47,12 +48,16 @@
 //static
 std::string LLImage::sLastErrorMessage;
 LLMutex* LLImage::sMutex = NULL;
+bool LLImage::sUseSSE2 = false;
 
 //static
 void LLImage::initClass()
 {
 	sMutex = new LLMutex(NULL);
 	LLImageJ2C::openDSO();
+
+	setUseSSE2(LLProcessorInfo().hasSSE2());
+	llinfos << "SSE2 image kernels: " << (sUseSSE2 ? "ENABLED" : "DISABLED") << llendl;
 }
 
 //static
@@ -77,6 +82,12 @@ void LLImage::setLastError(const std::string& message)
 	sLastErrorMessage = message;
 }
 
+//static
+void LLImage::setUseSSE2(bool use)
+{
+	sUseSSE2 = use && hasSSE2Kernels();
+}
+
 //---------------------------------------------------------------------------
 // LLImageBase
 //---------------------------------------------------------------------------
@@ -573,10 +584,7 @@ void LLImageRaw::compositeScaled4onto3(LLImageRaw* src)
 	std::vector<U8> temp_buffer(temp_data_size);
 
 	// Vertical: scale but no composite
-	for( S32 col = 0; col < src->getWidth(); col++ )
-	{
-		copyLineScaled( src->getData() + (src->getComponents() * col), &temp_buffer[0] + (src->getComponents() * col), src->getHeight(), dst->getHeight(), src->getWidth(), src->getWidth() );
-	}
+	copyRowsScaled( src->getData(), &temp_buffer[0], src->getComponents() * src->getWidth(), src->getHeight(), dst->getHeight() );
 
 	// Horizontal: scale and composite
 	for( S32 row = 0; row < dst->getHeight(); row++ )
@@ -613,6 +621,12 @@ void LLImageRaw::compositeUnscaled4onto3( LLImageRaw* src )
 	U8* src_data = src->getData();
 	U8* dst_data = dst->getData();
 	S32 pixels = getWidth() * getHeight();
+	if (LLImage::getUseSSE2())
+	{
+		compositeRow4onto3SSE2( src_data, dst_data, pixels );
+		return;
+	}
+
 	while( pixels-- )
 	{
 		U8 alpha = src_data[3];
@@ -820,10 +834,7 @@ void LLImageRaw::copyScaled( LLImageRaw* src )
 	std::vector<U8> temp_buffer(temp_data_size);
 
 	// Vertical
-	for( S32 col = 0; col < src->getWidth(); col++ )
-	{
-		copyLineScaled( src->getData() + (getComponents() * col), &temp_buffer[0] + (getComponents() * col), src->getHeight(), dst->getHeight(), src->getWidth(), src->getWidth() );
-	}
+	copyRowsScaled( src->getData(), &temp_buffer[0], getComponents() * src->getWidth(), src->getHeight(), dst->getHeight() );
 
 	// Horizontal
 	for( S32 row = 0; row < dst->getHeight(); row++ )
@@ -900,10 +911,7 @@ BOOL LLImageRaw::scale( S32 new_width, S32 new_height, BOOL scale_image_data )
 		std::vector<U8> temp_buffer(temp_data_size);
 
 		// Vertical
-		for( S32 col = 0; col < old_width; col++ )
-		{
-			copyLineScaled( getData() + (getComponents() * col), &temp_buffer[0] + (getComponents() * col), old_height, new_height, old_width, old_width );
-		}
+		copyRowsScaled( getData(), &temp_buffer[0], getComponents() * old_width, old_height, new_height );
 
 		deleteData();
 
@@ -947,11 +955,84 @@ BOOL LLImageRaw::scale( S32 new_width, S32 new_height, BOOL scale_image_data )
 	return TRUE ;
 }
 
+//static
+void LLImageRaw::copyRowsScaled( const U8* in, U8* out, S32 row_bytes, S32 in_rows, S32 out_rows )
+{
+	if (LLImage::getUseSSE2())
+	{
+		copyRowsScaledSSE2( in, out, row_bytes, in_rows, out_rows );
+		return;
+	}
+
+	const F32 ratio = F32(in_rows) / out_rows; // ratio of old to new
+	const F32 norm_factor = 1.f / ratio;
+
+	// Same filter as copyLineScaled() applied to every byte of a row at
+	// once, which walks the image a row at a time instead of a column.
+	std::vector<F32> sums(row_bytes);
+	for( S32 y = 0; y < out_rows; y++ )
+	{
+		const F32 sample0 = y * ratio;
+		const F32 sample1 = (y+1) * ratio;
+		const S32 index0 = llfloor(sample0);			// top integer (floor)
+		const S32 index1 = llfloor(sample1);			// bottom integer (floor)
+		const F32 fract0 = 1.f - (sample0 - F32(index0));	// spill over on top
+		const F32 fract1 = sample1 - F32(index1);			// spill-over on bottom
+
+		U8* outp = out + y * row_bytes;
+		if( index0 == index1 )
+		{
+			// Interval is embedded in one input row
+			memcpy( outp, in + index0 * row_bytes, row_bytes );	/* Flawfinder: ignore */
+			continue;
+		}
+
+		// Top straddle
+		const U8* inp = in + index0 * row_bytes;
+		for( S32 i = 0; i < row_bytes; i++ )
+		{
+			sums[i] = inp[i] * fract0;
+		}
+
+		// Central interval
+		for( S32 v = index0 + 1; v < index1; v++ )
+		{
+			inp = in + v * row_bytes;
+			for( S32 i = 0; i < row_bytes; i++ )
+			{
+				sums[i] += inp[i];
+			}
+		}
+
+		// Bottom straddle
+		// Watch out for reading off of end of input array.
+		if( fract1 && index1 < in_rows )
+		{
+			inp = in + index1 * row_bytes;
+			for( S32 i = 0; i < row_bytes; i++ )
+			{
+				sums[i] += inp[i] * fract1;
+			}
+		}
+
+		for( S32 i = 0; i < row_bytes; i++ )
+		{
+			outp[i] = U8(llround(sums[i] * norm_factor));
+		}
+	}
+}
+
 void LLImageRaw::copyLineScaled( U8* in, U8* out, S32 in_pixel_len, S32 out_pixel_len, S32 in_pixel_step, S32 out_pixel_step )
 {
 	const S32 components = getComponents();
 	llassert( components >= 1 && components <= 4 );
 
+	if (LLImage::getUseSSE2())
+	{
+		copyLineScaledSSE2( in, out, in_pixel_len, out_pixel_len, in_pixel_step, out_pixel_step );
+		return;
+	}
+
 	const F32 ratio = F32(in_pixel_len) / out_pixel_len; // ratio of old to new
 	const F32 norm_factor = 1.f / ratio;
 
@@ -1066,6 +1147,12 @@ void LLImageRaw::compositeRowScaled4onto3( U8* in, U8* out, S32 in_pixel_len, S3
 {
 	llassert( getComponents() == 3 );
 
+	if (LLImage::getUseSSE2())
+	{
+		compositeRowScaled4onto3SSE2( in, out, in_pixel_len, out_pixel_len );
+		return;
+	}
+
 	const S32 IN_COMPONENTS = 4;
 	const S32 OUT_COMPONENTS = 3;
 
@@ -1093,9 +1180,9 @@ void LLImageRaw::compositeRowScaled4onto3( U8* in, U8* out, S32 in_pixel_len, S3
 			// Interval is embedded in one input pixel
 			S32 t1 = index0 * IN_COMPONENTS;
 			in_scaled_r = in[t1 + 0];
-			in_scaled_g = in[t1 + 0];
-			in_scaled_b = in[t1 + 0];
-			in_scaled_a = in[t1 + 0];
+			in_scaled_g = in[t1 + 1];
+			in_scaled_b = in[t1 + 2];
+			in_scaled_a = in[t1 + 3];
 		}
 		else
 		{
@@ -1647,6 +1734,12 @@ static void avg4_colors2(const U8* a, const U8* b, const U8* c, const U8* d, U8*
 void LLImageBase::generateMip(const U8* indata, U8* mipdata, S32 width, S32 height, S32 nchannels)
 {
 	llassert(width > 0 && height > 0);
+	if (LLImage::getUseSSE2())
+	{
+		generateMipSSE2(indata, mipdata, width, height, nchannels);
+		return;
+	}
+
 	U8* data = mipdata;
 	S32 in_width = width*2;
 	for (S32 h=0; h<height; h++)
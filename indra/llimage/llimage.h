@@ -81,10 +81,18 @@ public:
 
 	static const std::string& getLastError();
 	static void setLastError(const std::string& message);
+
+	// Mip generation, scaling and compositing use the kernels in
+	// llimage_sse2.cpp when this is on.  initClass() turns it on if the CPU
+	// has SSE2; it stays off if this build has no SSE2 kernels.
+	static void setUseSSE2(bool use);
+	static bool getUseSSE2()					{ return sUseSSE2; }
+	static bool hasSSE2Kernels();
 	
 protected:
 	static LLMutex* sMutex;
 	static std::string sLastErrorMessage;
+	static bool sUseSSE2;
 };
 
 //============================================================================
@@ -131,6 +139,7 @@ protected:
 	
 public:
 	static void generateMip(const U8 *indata, U8* mipdata, int width, int height, S32 nchannels);
+	static void generateMipSSE2(const U8 *indata, U8* mipdata, S32 width, S32 height, S32 nchannels);
 	
 	// Function for calculating the download priority for textures
 	// <= 0 priority means that there's no need for more data.
@@ -228,9 +237,17 @@ protected:
 	// Create an image from a local file (generally used in tools)
 	bool createFromFile(const std::string& filename, bool j2c_lowest_mip_only = false);
 
+	// Vertical pass of the scaled copies: resamples in_rows rows of row_bytes bytes into out_rows rows.
+	static void copyRowsScaled( const U8* in, U8* out, S32 row_bytes, S32 in_rows, S32 out_rows );
 	void copyLineScaled( U8* in, U8* out, S32 in_pixel_len, S32 out_pixel_len, S32 in_pixel_step, S32 out_pixel_step );
 	void compositeRowScaled4onto3( U8* in, U8* out, S32 in_pixel_len, S32 out_pixel_len );
 
+	// SSE2 versions of the above, in llimage_sse2.cpp
+	static void copyRowsScaledSSE2( const U8* in, U8* out, S32 row_bytes, S32 in_rows, S32 out_rows );
+	void copyLineScaledSSE2( U8* in, U8* out, S32 in_pixel_len, S32 out_pixel_len, S32 in_pixel_step, S32 out_pixel_step );
+	void compositeRowScaled4onto3SSE2( U8* in, U8* out, S32 in_pixel_len, S32 out_pixel_len );
+	static void compositeRow4onto3SSE2( const U8* in, U8* out, S32 pixels );
+
 	U8	fastFractionalMult(U8 a,U8 b);
 
 	void setDataAndSize(U8 *data, S32 width, S32 height, S8 components) ;
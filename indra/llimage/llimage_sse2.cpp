@@ -0,0 +1,491 @@
+/**
+ * @file llimage_sse2.cpp
+ * @brief SSE2 mip generation, scaling and compositing kernels for LLImageBase/LLImageRaw
+ *
+ * $LicenseInfo:firstyear=2011&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2011, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+// Visual Studio required settings for this file:
+// Code Generation: SSE2
+
+#include "linden_common.h"
+
+#include "llimage.h"
+
+#include "llmath.h"
+
+// These kernels do the same arithmetic in the same order as the scalar
+// versions in llimage.cpp, so with SSE floating point math they give the
+// same bytes.  Only called when LLImage::getUseSSE2() is on.
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+
+#include <emmintrin.h>
+
+//static
+bool LLImage::hasSSE2Kernels()
+{
+	return true;
+}
+
+namespace
+{
+	// (a + b + c + d) >> 2 for the 16 bit sums of a 2x2 block of pixels
+	// whose rows are already added together.
+	inline __m128i avg_pairs_4(__m128i lo, __m128i hi)
+	{
+		// lo/hi hold two pixels of four 16 bit channels each
+		__m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(lo, hi), _mm_unpackhi_epi64(lo, hi));
+		return _mm_srli_epi16(sum, 2);
+	}
+
+	inline __m128i avg_pairs_2(__m128i lo, __m128i hi)
+	{
+		// lo/hi hold four pixels of two 16 bit channels each
+		__m128 even = _mm_shuffle_ps(_mm_castsi128_ps(lo), _mm_castsi128_ps(hi), _MM_SHUFFLE(2, 0, 2, 0));
+		__m128 odd = _mm_shuffle_ps(_mm_castsi128_ps(lo), _mm_castsi128_ps(hi), _MM_SHUFFLE(3, 1, 3, 1));
+		return _mm_srli_epi16(_mm_add_epi16(_mm_castps_si128(even), _mm_castps_si128(odd)), 2);
+	}
+
+	// Loads up to four bytes of a pixel into the low four floats.
+	inline __m128 load_pixel(const U8* in, S32 components)
+	{
+		U32 bits = 0;
+		memcpy(&bits, in, components);	/* Flawfinder: ignore */
+		__m128i v = _mm_unpacklo_epi8(_mm_cvtsi32_si128(bits), _mm_setzero_si128());
+		return _mm_cvtepi32_ps(_mm_unpacklo_epi16(v, _mm_setzero_si128()));
+	}
+
+	// llround() of four non negative floats, packed into the low four bytes.
+	inline U32 round_pixel(__m128 v)
+	{
+		__m128i i = _mm_cvttps_epi32(_mm_add_ps(v, _mm_set1_ps(0.5f)));
+		i = _mm_packs_epi32(i, i);
+		return (U32)_mm_cvtsi128_si32(_mm_packus_epi16(i, i));
+	}
+
+	// Box filter a run of input pixels [sample0, sample1) the way
+	// copyLineScaled() does, one pixel per register.
+	inline __m128 sample_pixels(const U8* in, S32 components, S32 step, S32 in_pixel_len,
+								F32 ratio, F32 norm_factor, S32 x, bool* embedded)
+	{
+		const F32 sample0 = x * ratio;
+		const F32 sample1 = (x+1) * ratio;
+		const S32 index0 = llfloor(sample0);
+		const S32 index1 = llfloor(sample1);
+		const F32 fract0 = 1.f - (sample0 - F32(index0));
+		const F32 fract1 = sample1 - F32(index1);
+
+		if (index0 == index1)
+		{
+			*embedded = true;
+			return load_pixel(in + index0 * step, components);
+		}
+		*embedded = false;
+
+		__m128 sum = _mm_mul_ps(load_pixel(in + index0 * step, components), _mm_set1_ps(fract0));
+		for (S32 u = index0 + 1; u < index1; u++)
+		{
+			sum = _mm_add_ps(sum, load_pixel(in + u * step, components));
+		}
+		if (fract1 && index1 < in_pixel_len)
+		{
+			sum = _mm_add_ps(sum, _mm_mul_ps(load_pixel(in + index1 * step, components), _mm_set1_ps(fract1)));
+		}
+		return _mm_mul_ps(sum, _mm_set1_ps(norm_factor));
+	}
+
+	// fastFractionalMult() on eight 16 bit lanes
+	inline __m128i fractional_mult(__m128i a, __m128i b)
+	{
+		__m128i i = _mm_add_epi16(_mm_mullo_epi16(a, b), _mm_set1_epi16(128));
+		return _mm_srli_epi16(_mm_add_epi16(i, _mm_srli_epi16(i, 8)), 8);
+	}
+
+	// dst * (255 - alpha) + src * alpha for two pixels of four 16 bit
+	// channels.  With fastFractionalMult() this leaves dst alone for alpha 0
+	// and gives src for alpha 255, so no branches are needed.
+	inline __m128i blend_pixels(__m128i src, __m128i dst)
+	{
+		__m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(src, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+		__m128i transparency = _mm_sub_epi16(_mm_set1_epi16(255), alpha);
+		return _mm_add_epi16(fractional_mult(dst, transparency), fractional_mult(src, alpha));
+	}
+}
+
+//static
+void LLImageBase::generateMipSSE2(const U8* indata, U8* mipdata, S32 width, S32 height, S32 nchannels)
+{
+	llassert(width > 0 && height > 0);
+	const __m128i zero = _mm_setzero_si128();
+	const S32 in_row = width * 2 * nchannels;
+
+	std::vector<U16> row_sums;
+	if (nchannels == 3)
+	{
+		row_sums.resize(in_row);
+	}
+
+	for (S32 h = 0; h < height; h++)
+	{
+		const U8* row0 = indata + h * 2 * in_row;
+		const U8* row1 = row0 + in_row;
+		U8* data = mipdata + h * width * nchannels;
+		S32 w = 0;
+
+		switch (nchannels)
+		{
+		  case 4:
+			// 8 input pixels, 4 output pixels per pass
+			for (; w + 4 <= width; w += 4)
+			{
+				__m128i a0 = _mm_loadu_si128((const __m128i*)(row0 + w * 8));
+				__m128i a1 = _mm_loadu_si128((const __m128i*)(row0 + w * 8 + 16));
+				__m128i b0 = _mm_loadu_si128((const __m128i*)(row1 + w * 8));
+				__m128i b1 = _mm_loadu_si128((const __m128i*)(row1 + w * 8 + 16));
+				__m128i s0 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero), _mm_unpacklo_epi8(b0, zero));
+				__m128i s1 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero), _mm_unpackhi_epi8(b0, zero));
+				__m128i s2 = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero), _mm_unpacklo_epi8(b1, zero));
+				__m128i s3 = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero), _mm_unpackhi_epi8(b1, zero));
+				_mm_storeu_si128((__m128i*)(data + w * 4), _mm_packus_epi16(avg_pairs_4(s0, s1), avg_pairs_4(s2, s3)));
+			}
+			break;
+		  case 2:
+			// 16 input pixels, 8 output pixels per pass
+			for (; w + 8 <= width; w += 8)
+			{
+				__m128i a0 = _mm_loadu_si128((const __m128i*)(row0 + w * 4));
+				__m128i a1 = _mm_loadu_si128((const __m128i*)(row0 + w * 4 + 16));
+				__m128i b0 = _mm_loadu_si128((const __m128i*)(row1 + w * 4));
+				__m128i b1 = _mm_loadu_si128((const __m128i*)(row1 + w * 4 + 16));
+				__m128i s0 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero), _mm_unpacklo_epi8(b0, zero));
+				__m128i s1 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero), _mm_unpackhi_epi8(b0, zero));
+				__m128i s2 = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero), _mm_unpacklo_epi8(b1, zero));
+				__m128i s3 = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero), _mm_unpackhi_epi8(b1, zero));
+				_mm_storeu_si128((__m128i*)(data + w * 2), _mm_packus_epi16(avg_pairs_2(s0, s1), avg_pairs_2(s2, s3)));
+			}
+			break;
+		  case 1:
+			// 32 input pixels, 16 output pixels per pass.  Adjacent bytes
+			// are added as the even and odd halves of 16 bit lanes.
+			{
+				const __m128i low_bytes = _mm_set1_epi16(0x00ff);
+				for (; w + 16 <= width; w += 16)
+				{
+					__m128i a0 = _mm_loadu_si128((const __m128i*)(row0 + w * 2));
+					__m128i a1 = _mm_loadu_si128((const __m128i*)(row0 + w * 2 + 16));
+					__m128i b0 = _mm_loadu_si128((const __m128i*)(row1 + w * 2));
+					__m128i b1 = _mm_loadu_si128((const __m128i*)(row1 + w * 2 + 16));
+					__m128i s0 = _mm_add_epi16(_mm_add_epi16(_mm_and_si128(a0, low_bytes), _mm_srli_epi16(a0, 8)),
+											   _mm_add_epi16(_mm_and_si128(b0, low_bytes), _mm_srli_epi16(b0, 8)));
+					__m128i s1 = _mm_add_epi16(_mm_add_epi16(_mm_and_si128(a1, low_bytes), _mm_srli_epi16(a1, 8)),
+											   _mm_add_epi16(_mm_and_si128(b1, low_bytes), _mm_srli_epi16(b1, 8)));
+					_mm_storeu_si128((__m128i*)(data + w), _mm_packus_epi16(_mm_srli_epi16(s0, 2), _mm_srli_epi16(s1, 2)));
+				}
+			}
+			break;
+		  case 3:
+			// Three byte pixels don't line up with the lanes, so only the
+			// rows are added in SIMD and the pairs are added below.
+			{
+				S32 i = 0;
+				for (; i + 16 <= in_row; i += 16)
+				{
+					__m128i a = _mm_loadu_si128((const __m128i*)(row0 + i));
+					__m128i b = _mm_loadu_si128((const __m128i*)(row1 + i));
+					_mm_storeu_si128((__m128i*)(&row_sums[i]), _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero)));
+					_mm_storeu_si128((__m128i*)(&row_sums[i + 8]), _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero)));
+				}
+				for (; i < in_row; i++)
+				{
+					row_sums[i] = (U16)row0[i] + row1[i];
+				}
+				const U16* sums = &row_sums[0];
+				for (; w < width; w++)
+				{
+					data[w * 3 + 0] = (U8)((sums[0] + sums[3]) >> 2);
+					data[w * 3 + 1] = (U8)((sums[1] + sums[4]) >> 2);
+					data[w * 3 + 2] = (U8)((sums[2] + sums[5]) >> 2);
+					sums += 6;
+				}
+			}
+			break;
+		  default:
+			llerrs << "generateMmip called with bad num channels" << llendl;
+		}
+
+		// Leftover pixels at the end of the row
+		for (; w < width; w++)
+		{
+			const U8* a = row0 + w * 2 * nchannels;
+			const U8* b = row1 + w * 2 * nchannels;
+			for (S32 c = 0; c < nchannels; c++)
+			{
+				data[w * nchannels + c] = (U8)(((U32)(a[c]) + a[c + nchannels] + b[c] + b[c + nchannels]) >> 2);
+			}
+		}
+	}
+}
+
+//static
+void LLImageRaw::copyRowsScaledSSE2( const U8* in, U8* out, S32 row_bytes, S32 in_rows, S32 out_rows )
+{
+	const F32 ratio = F32(in_rows) / out_rows; // ratio of old to new
+	const F32 norm_factor = 1.f / ratio;
+	const __m128 norm = _mm_set1_ps(norm_factor);
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128i zero = _mm_setzero_si128();
+
+	for( S32 y = 0; y < out_rows; y++ )
+	{
+		const F32 sample0 = y * ratio;
+		const F32 sample1 = (y+1) * ratio;
+		const S32 index0 = llfloor(sample0);			// top integer (floor)
+		const S32 index1 = llfloor(sample1);			// bottom integer (floor)
+		const F32 fract0 = 1.f - (sample0 - F32(index0));	// spill over on top
+		const F32 fract1 = sample1 - F32(index1);			// spill-over on bottom
+		const bool bottom = fract1 && index1 < in_rows;
+		const __m128 f0 = _mm_set1_ps(fract0);
+		const __m128 f1 = _mm_set1_ps(fract1);
+
+		U8* outp = out + y * row_bytes;
+		if( index0 == index1 )
+		{
+			// Interval is embedded in one input row
+			memcpy( outp, in + index0 * row_bytes, row_bytes );	/* Flawfinder: ignore */
+			continue;
+		}
+
+		// 16 bytes of the row at a time, summed down the rows in registers
+		S32 i = 0;
+		for( ; i + 16 <= row_bytes; i += 16 )
+		{
+			__m128 sum[4];
+			__m128 v[4];
+
+			__m128i bytes = _mm_loadu_si128((const __m128i*)(in + index0 * row_bytes + i));
+			__m128i lo = _mm_unpacklo_epi8(bytes, zero);
+			__m128i hi = _mm_unpackhi_epi8(bytes, zero);
+			sum[0] = _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)), f0);
+			sum[1] = _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)), f0);
+			sum[2] = _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)), f0);
+			sum[3] = _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)), f0);
+
+			for( S32 r = index0 + 1; r < index1; r++ )
+			{
+				bytes = _mm_loadu_si128((const __m128i*)(in + r * row_bytes + i));
+				lo = _mm_unpacklo_epi8(bytes, zero);
+				hi = _mm_unpackhi_epi8(bytes, zero);
+				sum[0] = _mm_add_ps(sum[0], _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)));
+				sum[1] = _mm_add_ps(sum[1], _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)));
+				sum[2] = _mm_add_ps(sum[2], _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)));
+				sum[3] = _mm_add_ps(sum[3], _mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)));
+			}
+
+			if( bottom )
+			{
+				bytes = _mm_loadu_si128((const __m128i*)(in + index1 * row_bytes + i));
+				lo = _mm_unpacklo_epi8(bytes, zero);
+				hi = _mm_unpackhi_epi8(bytes, zero);
+				v[0] = _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero));
+				v[1] = _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero));
+				v[2] = _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero));
+				v[3] = _mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero));
+				for( S32 k = 0; k < 4; k++ )
+				{
+					sum[k] = _mm_add_ps(sum[k], _mm_mul_ps(v[k], f1));
+				}
+			}
+
+			__m128i r0 = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(sum[0], norm), half));
+			__m128i r1 = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(sum[1], norm), half));
+			__m128i r2 = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(sum[2], norm), half));
+			__m128i r3 = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(sum[3], norm), half));
+			_mm_storeu_si128((__m128i*)(outp + i), _mm_packus_epi16(_mm_packs_epi32(r0, r1), _mm_packs_epi32(r2, r3)));
+		}
+
+		// Leftover bytes at the end of the row
+		for( ; i < row_bytes; i++ )
+		{
+			F32 sum = in[index0 * row_bytes + i] * fract0;
+			for( S32 r = index0 + 1; r < index1; r++ )
+			{
+				sum += in[r * row_bytes + i];
+			}
+			if( bottom )
+			{
+				sum += in[index1 * row_bytes + i] * fract1;
+			}
+			outp[i] = U8(llround(sum * norm_factor));
+		}
+	}
+}
+
+void LLImageRaw::copyLineScaledSSE2( U8* in, U8* out, S32 in_pixel_len, S32 out_pixel_len, S32 in_pixel_step, S32 out_pixel_step )
+{
+	const S32 components = getComponents();
+	llassert( components >= 1 && components <= 4 );
+
+	const F32 ratio = F32(in_pixel_len) / out_pixel_len; // ratio of old to new
+	const F32 norm_factor = 1.f / ratio;
+	const S32 in_step = in_pixel_step * components;
+
+	// One pixel per register, all of its channels at once
+	for( S32 x = 0; x < out_pixel_len; x++ )
+	{
+		bool embedded;
+		__m128 pixel = sample_pixels(in, components, in_step, in_pixel_len, ratio, norm_factor, x, &embedded);
+		U8* outp = out + x * out_pixel_step * components;
+		if( embedded )
+		{
+			memcpy( outp, in + llfloor(x * ratio) * in_step, components );	/* Flawfinder: ignore */
+		}
+		else
+		{
+			U32 bits = round_pixel(pixel);
+			memcpy( outp, &bits, components );	/* Flawfinder: ignore */
+		}
+	}
+}
+
+void LLImageRaw::compositeRowScaled4onto3SSE2( U8* in, U8* out, S32 in_pixel_len, S32 out_pixel_len )
+{
+	llassert( getComponents() == 3 );
+
+	const F32 ratio = F32(in_pixel_len) / out_pixel_len; // ratio of old to new
+	const F32 norm_factor = 1.f / ratio;
+	const __m128i zero = _mm_setzero_si128();
+
+	for( S32 x = 0; x < out_pixel_len; x++ )
+	{
+		bool embedded;
+		__m128 pixel = sample_pixels(in, 4, 4, in_pixel_len, ratio, norm_factor, x, &embedded);
+		U32 src_bits;
+		if( embedded )
+		{
+			memcpy( &src_bits, in + llfloor(x * ratio) * 4, 4 );	/* Flawfinder: ignore */
+		}
+		else
+		{
+			src_bits = round_pixel(pixel);
+		}
+
+		U32 dst_bits = 0;
+		memcpy( &dst_bits, out, 3 );	/* Flawfinder: ignore */
+		__m128i src = _mm_unpacklo_epi8(_mm_cvtsi32_si128(src_bits), zero);
+		__m128i dst = _mm_unpacklo_epi8(_mm_cvtsi32_si128(dst_bits), zero);
+		U32 blended = (U32)_mm_cvtsi128_si32(_mm_packus_epi16(blend_pixels(src, dst), zero));
+		memcpy( out, &blended, 3 );	/* Flawfinder: ignore */
+		out += 3;
+	}
+}
+
+//static
+void LLImageRaw::compositeRow4onto3SSE2( const U8* in, U8* out, S32 pixels )
+{
+	const __m128i zero = _mm_setzero_si128();
+
+	// Four pixels per pass
+	S32 p = 0;
+	for( ; p + 4 <= pixels; p += 4 )
+	{
+		__m128i src = _mm_loadu_si128((const __m128i*)in);
+		S32 alpha_mask = _mm_movemask_epi8(_mm_cmpeq_epi8(src, zero)) & 0x8888;
+		if( alpha_mask != 0x8888 )
+		{
+			// Spread the destination to four bytes per pixel to line up with the source
+			U32 dst_bits[4];
+			for( S32 i = 0; i < 4; i++ )
+			{
+				dst_bits[i] = out[i * 3] | (out[i * 3 + 1] << 8) | (out[i * 3 + 2] << 16);
+			}
+			__m128i dst = _mm_loadu_si128((const __m128i*)dst_bits);
+			__m128i lo = blend_pixels(_mm_unpacklo_epi8(src, zero), _mm_unpacklo_epi8(dst, zero));
+			__m128i hi = blend_pixels(_mm_unpackhi_epi8(src, zero), _mm_unpackhi_epi8(dst, zero));
+			_mm_storeu_si128((__m128i*)dst_bits, _mm_packus_epi16(lo, hi));
+			for( S32 i = 0; i < 4; i++ )
+			{
+				out[i * 3 + 0] = (U8)(dst_bits[i]);
+				out[i * 3 + 1] = (U8)(dst_bits[i] >> 8);
+				out[i * 3 + 2] = (U8)(dst_bits[i] >> 16);
+			}
+		}
+		in += 16;
+		out += 12;
+	}
+
+	// Leftover pixels
+	for( ; p < pixels; p++ )
+	{
+		U32 src_bits;
+		U32 dst_bits = 0;
+		memcpy( &src_bits, in, 4 );	/* Flawfinder: ignore */
+		memcpy( &dst_bits, out, 3 );	/* Flawfinder: ignore */
+		__m128i blended = blend_pixels(_mm_unpacklo_epi8(_mm_cvtsi32_si128(src_bits), zero),
+									   _mm_unpacklo_epi8(_mm_cvtsi32_si128(dst_bits), zero));
+		dst_bits = (U32)_mm_cvtsi128_si32(_mm_packus_epi16(blended, zero));
+		memcpy( out, &dst_bits, 3 );	/* Flawfinder: ignore */
+		in += 4;
+		out += 3;
+	}
+}
+
+#else
+
+// No SSE2 in this build, LLImage::setUseSSE2() keeps these from being called.
+
+//static
+bool LLImage::hasSSE2Kernels()
+{
+	return false;
+}
+
+//static
+void LLImageBase::generateMipSSE2(const U8* indata, U8* mipdata, S32 width, S32 height, S32 nchannels)
+{
+	generateMip(indata, mipdata, width, height, nchannels);
+}
+
+//static
+void LLImageRaw::copyRowsScaledSSE2( const U8* in, U8* out, S32 row_bytes, S32 in_rows, S32 out_rows )
+{
+	copyRowsScaled(in, out, row_bytes, in_rows, out_rows);
+}
+
+void LLImageRaw::copyLineScaledSSE2( U8* in, U8* out, S32 in_pixel_len, S32 out_pixel_len, S32 in_pixel_step, S32 out_pixel_step )
+{
+	copyLineScaled(in, out, in_pixel_len, out_pixel_len, in_pixel_step, out_pixel_step);
+}
+
+void LLImageRaw::compositeRowScaled4onto3SSE2( U8* in, U8* out, S32 in_pixel_len, S32 out_pixel_len )
+{
+	compositeRowScaled4onto3(in, out, in_pixel_len, out_pixel_len);
+}
+
+//static
+void LLImageRaw::compositeRow4onto3SSE2( const U8* in, U8* out, S32 pixels )
+{
+	// only reached through compositeUnscaled4onto3(), which checks getUseSSE2() first
+	llerrs << "compositeRow4onto3SSE2 called without SSE2 kernels" << llendl;
+}
+
+#endif
@@ -29,13 +29,100 @@
 #include "llimageworker.h"
 #include "llimagedxt.h"
 
+#include "llprocessor.h"
+#include "llthreadscheduler.h"
+#include "lltimer.h"
+
 //----------------------------------------------------------------------------
 
+// static
+U32 LLImageDecodeThread::resolvePoolSize(bool threaded, U32 pool_size)
+{
+	if (!threaded)
+	{
+		return 1;
+	}
+	if (pool_size == 0)
+	{
+		// One decoder per logical CPU, leaving one for the main thread
+		S32 cpus = LLProcessorInfo().getNumLogicalCPUs();
+		pool_size = cpus > 1 ? (U32)(cpus - 1) : 1;
+	}
+	return pool_size;
+}
+
 // MAIN THREAD
-LLImageDecodeThread::LLImageDecodeThread(bool threaded)
-	: LLQueuedThread("imagedecode", threaded)
+LLImageDecodeThread::LLImageDecodeThread(bool threaded, U32 pool_size)
+	: LLQueuedThread("imagedecode", threaded, resolvePoolSize(threaded, pool_size))
 {
 	mCreationMutex = new LLMutex(getAPRPool());
+
+	if (isScheduled())
+	{
+		// Decodes run on the shared scheduler, one stats slot per scheduler worker
+		mWorkerStats.resize(LLThreadScheduler::getInstance()->getNumWorkers());
+		llinfos << "Image decode running on the thread scheduler, up to "
+				<< mMaxConcurrency << " concurrent decodes" << llendl;
+		return;
+	}
+
+	// Slot 0 is this thread, the rest are pool workers.
+	// mWorkerStats is never resized after this point.
+	pool_size = resolvePoolSize(threaded, pool_size);
+	mWorkerStats.resize(pool_size);
+	for (U32 i = 1; i < pool_size; ++i)
+	{
+		PoolWorker* worker = new PoolWorker(this, i);
+		mPoolWorkers.push_back(worker);
+		worker->start();
+	}
+	llinfos << "Image decode pool started with " << pool_size << " thread(s)" << llendl;
+}
+
+// MAIN THREAD
+LLImageDecodeThread::~LLImageDecodeThread()
+{
+	shutdownPool();
+	// ~LLQueuedThread() will be called here
+}
+
+// MAIN THREAD
+// virtual
+void LLImageDecodeThread::shutdown()
+{
+	// The pool workers must be gone before LLQueuedThread::shutdown()
+	// deletes the requests they may be processing.
+	shutdownPool();
+	LLQueuedThread::shutdown();
+}
+
+void LLImageDecodeThread::shutdownPool()
+{
+	if (mPoolWorkers.empty())
+	{
+		return;
+	}
+	for (pool_worker_list_t::iterator iter = mPoolWorkers.begin();
+		 iter != mPoolWorkers.end(); ++iter)
+	{
+		(*iter)->quit();
+	}
+	for (pool_worker_list_t::iterator iter = mPoolWorkers.begin();
+		 iter != mPoolWorkers.end(); ++iter)
+	{
+		(*iter)->shutdown(); // waits for the thread to stop
+		delete *iter;
+	}
+	mPoolWorkers.clear();
+}
+
+void LLImageDecodeThread::wakePool()
+{
+	for (pool_worker_list_t::iterator iter = mPoolWorkers.begin();
+		 iter != mPoolWorkers.end(); ++iter)
+	{
+		(*iter)->wake();
+	}
 }
 
 // MAIN THREAD
@@ -51,6 +138,7 @@ S32 LLImageDecodeThread::update(U32 max_time_ms)
 						     info.priority, info.discard, info.needs_aux,
 						     info.responder);
 
+		req->setOwner(this);
 		bool res = addRequest(req);
 		if (!res)
 		{
@@ -59,6 +147,10 @@ S32 LLImageDecodeThread::update(U32 max_time_ms)
 	}
 	mCreationList.clear();
 	S32 res = LLQueuedThread::update(max_time_ms);
+	if (res > 0)
+	{
+		wakePool(); // LLQueuedThread::update() only unpauses this thread
+	}
 	return res;
 }
 
@@ -80,6 +172,130 @@ S32 LLImageDecodeThread::tut_size()
 	return res;
 }
 
+//----------------------------------------------------------------------------
+
+// virtual
+// Called from the thread itself (or from update() when not threaded)
+void LLImageDecodeThread::startThread()
+{
+	if (!isScheduled())
+	{
+		registerWorker(0);
+	}
+}
+
+// Called once by each decode thread before it processes any request
+void LLImageDecodeThread::registerWorker(U32 index)
+{
+	llassert_always(index < mWorkerStats.size());
+	mWorkerStats[index].mThreadID = LLThread::currentID();
+}
+
+// Called from any decode thread
+void LLImageDecodeThread::recordSlice(F64 elapsed, bool done)
+{
+	S32 index = -1;
+	if (isScheduled())
+	{
+		index = LLThreadScheduler::getInstance()->getCurrentWorkerIndex();
+	}
+	else
+	{
+		U32 thread_id = LLThread::currentID();
+		for (U32 i = 0; i < mWorkerStats.size(); ++i)
+		{
+			if (mWorkerStats[i].mThreadID == thread_id)
+			{
+				index = (S32)i;
+				break;
+			}
+		}
+	}
+	if (index >= 0 && index < (S32)mWorkerStats.size())
+	{
+		WorkerStats& stats = mWorkerStats[index];
+		stats.mSlices++;
+		stats.mBusyTime += elapsed;
+		if (done)
+		{
+			stats.mCompleted++;
+		}
+	}
+}
+
+// MAIN THREAD
+void LLImageDecodeThread::getWorkerStats(worker_stats_list_t& stats)
+{
+	stats = mWorkerStats;
+}
+
+// MAIN THREAD
+void LLImageDecodeThread::resetWorkerStats()
+{
+	for (worker_stats_list_t::iterator iter = mWorkerStats.begin();
+		 iter != mWorkerStats.end(); ++iter)
+	{
+		iter->mSlices = 0;
+		iter->mCompleted = 0;
+		iter->mBusyTime = 0.0;
+	}
+}
+
+// MAIN THREAD
+void LLImageDecodeThread::dumpWorkerStats()
+{
+	for (U32 i = 0; i < mWorkerStats.size(); ++i)
+	{
+		const WorkerStats& stats = mWorkerStats[i];
+		F64 avg_ms = stats.mCompleted ? stats.mBusyTime * 1000.0 / (F64)stats.mCompleted : 0.0;
+		llinfos << llformat("Decode worker %d: %d images, %d slices, busy %.3fs, %.2fms/image",
+							i, stats.mCompleted, stats.mSlices, stats.mBusyTime, avg_ms) << llendl;
+	}
+}
+
+//----------------------------------------------------------------------------
+
+LLImageDecodeThread::PoolWorker::PoolWorker(LLImageDecodeThread* owner, U32 index)
+	: LLThread(llformat("imagedecode%d", index)),
+	  mOwner(owner),
+	  mIndex(index)
+{
+}
+
+// virtual
+bool LLImageDecodeThread::PoolWorker::runCondition()
+{
+	// mRunCondition must be locked here
+	return !mOwner->isPaused() && mOwner->getPending() > 0;
+}
+
+// virtual
+void LLImageDecodeThread::PoolWorker::run()
+{
+	// Wait for the owner to be fully constructed and to have work for us
+	checkPause();
+	mOwner->registerWorker(mIndex);
+
+	while (1)
+	{
+		// Blocks until the owner has queued requests and is not paused
+		checkPause();
+
+		if (isQuitting())
+		{
+			break;
+		}
+
+		if (mOwner->processNextRequest() == 0)
+		{
+			ms_sleep(1);
+		}
+	}
+	llinfos << "LLImageDecodeThread " << mName << " EXITING." << llendl;
+}
+
+//----------------------------------------------------------------------------
+
 LLImageDecodeThread::Responder::~Responder()
 {
 }
@@ -95,7 +311,8 @@ LLImageDecodeThread::ImageRequest::ImageRequest(handle_t handle, LLImageFormatte
 	  mNeedsAux(needs_aux),
 	  mDecodedRaw(FALSE),
 	  mDecodedAux(FALSE),
-	  mResponder(responder)
+	  mResponder(responder),
+	  mOwner(NULL)
 {
 }
 
@@ -109,8 +326,20 @@ LLImageDecodeThread::ImageRequest::~ImageRequest()
 //----------------------------------------------------------------------------
 
 
-// Returns true when done, whether or not decode was successful.
+// Called from whichever decode thread picked up the request
 bool LLImageDecodeThread::ImageRequest::processRequest()
+{
+	LLTimer slice_timer;
+	bool done = decodeSlice();
+	if (mOwner)
+	{
+		mOwner->recordSlice(slice_timer.getElapsedTimeF64(), done);
+	}
+	return done;
+}
+
+// Returns true when done, whether or not decode was successful.
+bool LLImageDecodeThread::ImageRequest::decodeSlice()
 {
 	const F32 decode_time_slice = .1f;
 	bool done = true;
@@ -27,6 +27,8 @@
 #ifndef LL_LLIMAGEWORKER_H
 #define LL_LLIMAGEWORKER_H
 
+#include <vector>
+
 #include "llimage.h"
 #include "llpointer.h"
 #include "llworkerthread.h"
@@ -55,10 +57,15 @@ public:
 		/*virtual*/ bool processRequest();
 		/*virtual*/ void finishRequest(bool completed);
 
+		// Set by the owning thread so decode slices can be credited to a worker
+		void setOwner(LLImageDecodeThread* owner) { mOwner = owner; }
+
 		// Used by unit tests to check the consitency of the request instance
 		bool tut_isOK();
 		
 	private:
+		bool decodeSlice();
+
 		// input
 		LLPointer<LLImageFormatted> mFormattedImage;
 		S32 mDiscardLevel;
@@ -69,19 +76,74 @@ public:
 		BOOL mDecodedRaw;
 		BOOL mDecodedAux;
 		LLPointer<LLImageDecodeThread::Responder> mResponder;
+		LLImageDecodeThread* mOwner;
 	};
 	
+	// Per decode thread counters. Each entry is only written by the thread it
+	// describes, so reading them from the main thread is approximate but safe.
+	struct WorkerStats
+	{
+		WorkerStats() : mThreadID(0), mSlices(0), mCompleted(0), mBusyTime(0.0) {}
+		U32 mThreadID;
+		U32 mSlices;		// calls to processRequest()
+		U32 mCompleted;		// requests finished (successfully or not)
+		F64 mBusyTime;		// seconds spent decoding
+	};
+	typedef std::vector<WorkerStats> worker_stats_list_t;
+
 public:
-	LLImageDecodeThread(bool threaded = true);
+	// pool_size is the total number of decode threads sharing the request queue,
+	// including this one. 0 sizes the pool to the logical CPU count minus one.
+	// When an LLThreadScheduler exists the decodes run there instead, on up to
+	// pool_size scheduler workers at once.
+	LLImageDecodeThread(bool threaded = true, U32 pool_size = 1);
+	virtual ~LLImageDecodeThread();
+	/*virtual*/ void shutdown();
+
 	handle_t decodeImage(LLImageFormatted* image,
 						 U32 priority, S32 discard, BOOL needs_aux,
 						 Responder* responder);
 	S32 update(U32 max_time_ms);
 
+	U32 getPoolSize() const { return mWorkerStats.size(); }
+	void getWorkerStats(worker_stats_list_t& stats);
+	void resetWorkerStats();
+	void dumpWorkerStats();
+
 	// Used by unit tests to check the consistency of the thread instance
 	S32 tut_size();
 	
 private:
+	// Additional decode thread pulling requests from the owner's queue
+	class PoolWorker : public LLThread
+	{
+	public:
+		PoolWorker(LLImageDecodeThread* owner, U32 index);
+
+		void quit() { setQuitting(); }
+
+		/*virtual*/ bool runCondition();
+		/*virtual*/ void run();
+
+	private:
+		LLImageDecodeThread* mOwner;
+		U32 mIndex;
+	};
+	friend class PoolWorker;
+	friend class ImageRequest;
+	typedef std::vector<PoolWorker*> pool_worker_list_t;
+
+	static U32 resolvePoolSize(bool threaded, U32 pool_size);
+
+	/*virtual*/ void startThread();
+	void registerWorker(U32 index);
+	void recordSlice(F64 elapsed, bool done);
+	void shutdownPool();
+	void wakePool();
+
+	pool_worker_list_t mPoolWorkers;
+	worker_stats_list_t mWorkerStats;
+
 	struct creation_info
 	{
 		handle_t handle;
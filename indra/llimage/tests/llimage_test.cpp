@@ -0,0 +1,235 @@
+/**
+ * @file llimage_test.cpp
+ * @brief Test for the SSE2 image kernels in llimage_sse2.cpp.
+ *
+ * $LicenseInfo:firstyear=2011&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2011, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llimage.h"
+
+#include "llpointer.h"
+#include "llstring.h"
+#include "lltimer.h"
+
+#include "../test/lltut.h"
+
+#include <vector>
+
+namespace tut
+{
+	struct image_data
+	{
+		image_data() : mSeed(12345), mUseSSE2(LLImage::getUseSSE2())
+		{
+		}
+
+		~image_data()
+		{
+			LLImage::setUseSSE2(mUseSSE2);
+		}
+
+		U8 random()
+		{
+			mSeed = mSeed * 1664525 + 1013904223;
+			return (U8)(mSeed >> 24);
+		}
+
+		S32 random(S32 min, S32 max)
+		{
+			return min + random() % (max - min + 1);
+		}
+
+		LLPointer<LLImageRaw> makeImage(S32 width, S32 height, S32 components)
+		{
+			LLPointer<LLImageRaw> image = new LLImageRaw(width, height, components);
+			U8* data = image->getData();
+			for (S32 i = 0; i < image->getDataSize(); i++)
+			{
+				data[i] = random();
+				// plenty of fully transparent and fully opaque pixels
+				if (components == 4 && i % 4 == 3)
+				{
+					S32 kind = random() % 4;
+					data[i] = kind == 0 ? 0 : kind == 1 ? 255 : data[i];
+				}
+			}
+			return image;
+		}
+
+		LLPointer<LLImageRaw> copyImage(LLImageRaw* src)
+		{
+			return new LLImageRaw(src->getData(), src->getWidth(), src->getHeight(), src->getComponents());
+		}
+
+		// The scaling filters are float math, an x87 build of the scalar
+		// code can round the odd byte differently.
+		void ensureClose(const char* msg, LLImageRaw* a, LLImageRaw* b, S32 tolerance)
+		{
+			ensure_equals(msg, a->getDataSize(), b->getDataSize());
+			for (S32 i = 0; i < a->getDataSize(); i++)
+			{
+				S32 diff = llabs((S32)a->getData()[i] - (S32)b->getData()[i]);
+				if (diff > tolerance)
+				{
+					ensure_equals(llformat("%s byte %d", msg, i), (S32)b->getData()[i], (S32)a->getData()[i]);
+				}
+			}
+		}
+
+		U32 mSeed;
+		bool mUseSSE2;
+	};
+	typedef test_group<image_data> image_t;
+	typedef image_t::object image_object;
+	tut::image_t tut_image("LLImage");
+
+	template<> template<>
+	void image_object::test<1>()
+	{
+		set_test_name("SSE2 mips match scalar mips");
+		if (!LLImage::hasSSE2Kernels())
+		{
+			skip("no SSE2 kernels in this build");
+		}
+		for (S32 pass = 0; pass < 40; pass++)
+		{
+			S32 components = 1 + pass % 4;
+			S32 width = random(1, 70);
+			S32 height = random(1, 40);
+			LLPointer<LLImageRaw> src = makeImage(width * 2, height * 2, components);
+			std::vector<U8> scalar(width * height * components);
+			std::vector<U8> sse2(width * height * components);
+
+			LLImage::setUseSSE2(false);
+			LLImageBase::generateMip(src->getData(), &scalar[0], width, height, components);
+			LLImage::setUseSSE2(true);
+			LLImageBase::generateMip(src->getData(), &sse2[0], width, height, components);
+			ensure(llformat("%dx%dx%d mip", width, height, components), scalar == sse2);
+		}
+	}
+
+	template<> template<>
+	void image_object::test<2>()
+	{
+		set_test_name("SSE2 scaling matches scalar scaling");
+		if (!LLImage::hasSSE2Kernels())
+		{
+			skip("no SSE2 kernels in this build");
+		}
+		for (S32 pass = 0; pass < 40; pass++)
+		{
+			S32 components = 1 + pass % 4;
+			LLPointer<LLImageRaw> scalar = makeImage(random(1, 90), random(1, 90), components);
+			LLPointer<LLImageRaw> sse2 = copyImage(scalar);
+			S32 width = random(1, 90);
+			S32 height = random(1, 90);
+
+			LLImage::setUseSSE2(false);
+			scalar->scale(width, height);
+			LLImage::setUseSSE2(true);
+			sse2->scale(width, height);
+			ensureClose(llformat("%dx%dx%d scale", width, height, components).c_str(), scalar, sse2, 1);
+		}
+	}
+
+	template<> template<>
+	void image_object::test<3>()
+	{
+		set_test_name("SSE2 compositing matches scalar compositing");
+		if (!LLImage::hasSSE2Kernels())
+		{
+			skip("no SSE2 kernels in this build");
+		}
+		for (S32 pass = 0; pass < 40; pass++)
+		{
+			// every other pass is the same size, which doesn't scale
+			LLPointer<LLImageRaw> dst = makeImage(random(1, 90), random(1, 90), 3);
+			LLPointer<LLImageRaw> src = (pass & 1) ? makeImage(dst->getWidth(), dst->getHeight(), 4)
+												   : makeImage(random(1, 90), random(1, 90), 4);
+			LLPointer<LLImageRaw> scalar = copyImage(dst);
+			LLPointer<LLImageRaw> sse2 = copyImage(dst);
+
+			LLImage::setUseSSE2(false);
+			if (pass & 1)
+			{
+				scalar->compositeUnscaled4onto3(src);
+			}
+			else
+			{
+				scalar->compositeScaled4onto3(src);
+			}
+			LLImage::setUseSSE2(true);
+			if (pass & 1)
+			{
+				sse2->compositeUnscaled4onto3(src);
+			}
+			else
+			{
+				sse2->compositeScaled4onto3(src);
+			}
+			ensureClose(llformat("%dx%d onto %dx%d", src->getWidth(), src->getHeight(), dst->getWidth(), dst->getHeight()).c_str(),
+						scalar, sse2, (pass & 1) ? 0 : 1);
+		}
+	}
+
+	template<> template<>
+	void image_object::test<4>()
+	{
+		set_test_name("SSE2 kernel speed");
+		if (!LLImage::hasSSE2Kernels())
+		{
+			skip("no SSE2 kernels in this build");
+		}
+		const S32 SIZE = 512;
+		const S32 PASSES = 10;
+		for (S32 components = 1; components <= 4; components++)
+		{
+			LLPointer<LLImageRaw> src = makeImage(SIZE * 2, SIZE * 2, components);
+			std::vector<U8> mip(SIZE * SIZE * components);
+			F64 mip_time[2];
+			F64 scale_time[2];
+			for (S32 sse2 = 0; sse2 < 2; sse2++)
+			{
+				LLImage::setUseSSE2(sse2 != 0);
+				LLTimer timer;
+				for (S32 pass = 0; pass < PASSES; pass++)
+				{
+					LLImageBase::generateMip(src->getData(), &mip[0], SIZE, SIZE, components);
+				}
+				mip_time[sse2] = timer.getElapsedTimeF64();
+
+				timer.reset();
+				for (S32 pass = 0; pass < PASSES; pass++)
+				{
+					LLPointer<LLImageRaw> scaled = copyImage(src);
+					scaled->scale(SIZE * 2 - 300, SIZE - 37);
+				}
+				scale_time[sse2] = timer.getElapsedTimeF64();
+			}
+			llinfos << components << " components, " << PASSES << " passes: generateMip() "
+					<< mip_time[0] * 1000.0 << "ms scalar, " << mip_time[1] * 1000.0 << "ms SSE2; scale() "
+					<< scale_time[0] * 1000.0 << "ms scalar, " << scale_time[1] * 1000.0 << "ms SSE2" << llendl;
+		}
+	}
+}
@@ -232,6 +232,44 @@ namespace tut
 		ensure("LLImageDecodeThread: threaded work unit not processed", done == true);
 	}
 
+	template<> template<>
+	void imagedecodethread_object_t::test<3>()
+	{
+		// Test a *pooled* instance of the class: several threads sharing one queue
+		mThread = new LLImageDecodeThread(true, 4);
+		ensure("LLImageDecodeThread: pooled constructor failed", mThread != NULL);
+		ensure_equals("LLImageDecodeThread: pool size incorrect", mThread->getPoolSize(), 4U);
+		// Queue more work orders than there are threads
+		const S32 NUM_REQUESTS = 16;
+		bool done[NUM_REQUESTS];
+		for (S32 i = 0; i < NUM_REQUESTS; ++i)
+		{
+			done[i] = false;
+			mThread->decodeImage(NULL, LLQueuedThread::PRIORITY_NORMAL, 0, FALSE, new responder_test(&done[i]));
+		}
+		mThread->update(1);
+		const U32 INCREMENT_TIME = 500;				// 500 milliseconds
+		const U32 MAX_TIME = 20 * INCREMENT_TIME;	// Do the loop 20 times max, i.e. wait 10 seconds but no more
+		U32 total_time = 0;
+		S32 completed = 0;
+		while ((completed < NUM_REQUESTS) && (total_time < MAX_TIME))
+		{
+			ms_sleep(INCREMENT_TIME);
+			total_time += INCREMENT_TIME;
+			mThread->update(1);
+			completed = 0;
+			for (S32 i = 0; i < NUM_REQUESTS; ++i)
+			{
+				completed += done[i] ? 1 : 0;
+			}
+		}
+		// Verifies that every responder has been called exactly once across the pool
+		ensure_equals("LLImageDecodeThread: pooled work units not processed", completed, NUM_REQUESTS);
+		LLImageDecodeThread::worker_stats_list_t stats;
+		mThread->getWorkerStats(stats);
+		ensure_equals("LLImageDecodeThread: worker stats size incorrect", (S32)stats.size(), 4);
+	}
+
 	// ---------------------------------------------------------------------------------------
 	// Test the LLImageDecodeThread::ImageRequest interface
 	// ---------------------------------------------------------------------------------------
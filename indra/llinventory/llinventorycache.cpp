@@ -0,0 +1,408 @@
+/**
+ * @file llinventorycache.cpp
+ * @brief Implementation of the binary inventory cache file.
+ *
+ * $LicenseInfo:firstyear=2011&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2011, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "llinventorycache.h"
+
+#include "llfile.h"
+#include "llinventory.h"
+#include "llxorcipher.h"
+
+///----------------------------------------------------------------------------
+/// Local function declarations, constants, enums, and typedefs
+///----------------------------------------------------------------------------
+
+// "INVC" when read back on a little endian machine. A file from a machine
+// of the other endianness is rejected and rebuilt.
+static const U32 CACHE_MAGIC = 0x43564e49;
+static const U32 CACHE_FORMAT_VERSION = 1;
+
+// Same key the text inventory cache uses for shadow_id
+static const LLUUID SHADOW_KEY("3c115e51-04f4-523c-9fa6-98aff1034730");
+
+// All record sizes are multiples of 4, so records in a mapped file are
+// aligned well enough to be read in place.
+struct LLInventoryCacheFile::Header
+{
+	U32 mMagic;
+	U32 mFormatVersion;
+	S32 mCacheVersion;
+	U32 mCategoryCount;
+	U32 mItemCount;
+	U32 mStringsSize;
+};
+
+struct LLInventoryCacheFile::CategoryRecord
+{
+	U8 mID[UUID_BYTES];
+	U8 mParentID[UUID_BYTES];
+	U8 mOwnerID[UUID_BYTES];
+	S32 mVersion;
+	S8 mType;
+	S8 mPreferredType;
+	U8 mPad[2];
+	U32 mNameOffset;
+	U32 mNameLength;
+};
+
+struct LLInventoryCacheFile::ItemRecord
+{
+	U8 mID[UUID_BYTES];
+	U8 mParentID[UUID_BYTES];
+	U8 mAssetID[UUID_BYTES];	// shadowed unless the item is unrestricted
+	U8 mCreatorID[UUID_BYTES];
+	U8 mOwnerID[UUID_BYTES];
+	U8 mLastOwnerID[UUID_BYTES];
+	U8 mGroupID[UUID_BYTES];
+	U32 mMaskBase;
+	U32 mMaskOwner;
+	U32 mMaskGroup;
+	U32 mMaskEveryone;
+	U32 mMaskNextOwner;
+	U32 mFlags;
+	S32 mCreationDate;
+	S32 mSalePrice;
+	S8 mType;
+	S8 mInventoryType;
+	U8 mSaleType;
+	U8 mAssetShadowed;
+	U32 mNameOffset;
+	U32 mNameLength;
+	U32 mDescOffset;
+	U32 mDescLength;
+};
+
+static LLUUID to_uuid(const U8* data)
+{
+	LLUUID id;
+	memcpy(id.mData, data, UUID_BYTES);		/* Flawfinder: ignore */
+	return id;
+}
+
+///----------------------------------------------------------------------------
+/// Class LLInventoryCacheFile
+///----------------------------------------------------------------------------
+
+LLInventoryCacheFile::LLInventoryCacheFile()
+	: mPool(NULL),
+	  mMap(NULL),
+	  mData(NULL),
+	  mCategoryCount(0),
+	  mItemCount(0),
+	  mCategoryData(NULL),
+	  mItemData(NULL),
+	  mStringData(NULL),
+	  mStringDataSize(0)
+{
+}
+
+LLInventoryCacheFile::~LLInventoryCacheFile()
+{
+	close();
+}
+
+U32 LLInventoryCacheFile::addString(const std::string& str, U32& length)
+{
+	U32 offset = mStrings.size();
+	length = str.size();
+	mStrings.append(str);
+	return offset;
+}
+
+std::string LLInventoryCacheFile::getString(U32 offset, U32 length) const
+{
+	if (offset > mStringDataSize || length > mStringDataSize - offset)
+	{
+		llwarns << "Bad string in inventory cache" << llendl;
+		return std::string();
+	}
+	return std::string(mStringData + offset, length);
+}
+
+void LLInventoryCacheFile::addCategory(const LLInventoryCategory* cat, const LLUUID& owner_id, S32 version)
+{
+	CategoryRecord record;
+	memset(&record, 0, sizeof(record));
+	memcpy(record.mID, cat->LLInventoryObject::getUUID().mData, UUID_BYTES);		/* Flawfinder: ignore */
+	memcpy(record.mParentID, cat->getParentUUID().mData, UUID_BYTES);	/* Flawfinder: ignore */
+	memcpy(record.mOwnerID, owner_id.mData, UUID_BYTES);		/* Flawfinder: ignore */
+	record.mVersion = version;
+	record.mType = (S8)cat->getActualType();
+	record.mPreferredType = (S8)cat->getPreferredType();
+	record.mNameOffset = addString(cat->LLInventoryObject::getName(), record.mNameLength);
+
+	const U8* bytes = (const U8*)&record;
+	mCategoryRecords.insert(mCategoryRecords.end(), bytes, bytes + sizeof(record));
+}
+
+// The accessors are called non-virtually below, the viewer overrides them to
+// report the linked object's values for links and we want the link itself.
+void LLInventoryCacheFile::addItem(const LLInventoryItem* item)
+{
+	const LLPermissions& perm = item->LLInventoryItem::getPermissions();
+
+	ItemRecord record;
+	memset(&record, 0, sizeof(record));
+	memcpy(record.mID, item->LLInventoryObject::getUUID().mData, UUID_BYTES);		/* Flawfinder: ignore */
+	memcpy(record.mParentID, item->getParentUUID().mData, UUID_BYTES);	/* Flawfinder: ignore */
+	memcpy(record.mCreatorID, perm.getCreator().mData, UUID_BYTES);	/* Flawfinder: ignore */
+	memcpy(record.mOwnerID, perm.getOwner().mData, UUID_BYTES);	/* Flawfinder: ignore */
+	memcpy(record.mLastOwnerID, perm.getLastOwner().mData, UUID_BYTES);	/* Flawfinder: ignore */
+	memcpy(record.mGroupID, perm.getGroup().mData, UUID_BYTES);	/* Flawfinder: ignore */
+
+	// Like LLInventoryItem::exportFile(), only write the real asset id of
+	// items the owner could see it for anyway.
+	LLUUID asset_id(item->LLInventoryItem::getAssetUUID());
+	if (((perm.getMaskBase() & PERM_ITEM_UNRESTRICTED) != PERM_ITEM_UNRESTRICTED)
+		&& asset_id.notNull())
+	{
+		LLXORCipher cipher(SHADOW_KEY.mData, UUID_BYTES);
+		cipher.encrypt(asset_id.mData, UUID_BYTES);
+		record.mAssetShadowed = 1;
+	}
+	memcpy(record.mAssetID, asset_id.mData, UUID_BYTES);		/* Flawfinder: ignore */
+
+	record.mMaskBase = perm.getMaskBase();
+	record.mMaskOwner = perm.getMaskOwner();
+	record.mMaskGroup = perm.getMaskGroup();
+	record.mMaskEveryone = perm.getMaskEveryone();
+	record.mMaskNextOwner = perm.getMaskNextOwner();
+	record.mFlags = item->LLInventoryItem::getFlags();
+	record.mCreationDate = (S32)item->LLInventoryItem::getCreationDate();
+	record.mSalePrice = item->LLInventoryItem::getSaleInfo().getSalePrice();
+	record.mType = (S8)item->getActualType();
+	record.mInventoryType = (S8)item->LLInventoryItem::getInventoryType();
+	record.mSaleType = (U8)item->LLInventoryItem::getSaleInfo().getSaleType();
+	record.mNameOffset = addString(item->LLInventoryObject::getName(), record.mNameLength);
+	record.mDescOffset = addString(item->LLInventoryItem::getDescription(), record.mDescLength);
+
+	const U8* bytes = (const U8*)&record;
+	mItemRecords.insert(mItemRecords.end(), bytes, bytes + sizeof(record));
+}
+
+bool LLInventoryCacheFile::write(const std::string& filename, S32 cache_version) const
+{
+	Header header;
+	header.mMagic = CACHE_MAGIC;
+	header.mFormatVersion = CACHE_FORMAT_VERSION;
+	header.mCacheVersion = cache_version;
+	header.mCategoryCount = mCategoryRecords.size() / sizeof(CategoryRecord);
+	header.mItemCount = mItemRecords.size() / sizeof(ItemRecord);
+	header.mStringsSize = mStrings.size();
+
+	LLFILE* fp = LLFile::fopen(filename, "wb");		/*Flawfinder: ignore*/
+	if (!fp)
+	{
+		llwarns << "unable to save inventory cache to: " << filename << llendl;
+		return false;
+	}
+	bool success = (fwrite(&header, sizeof(header), 1, fp) == 1);
+	if (success && !mCategoryRecords.empty())
+	{
+		success = (fwrite(&mCategoryRecords[0], mCategoryRecords.size(), 1, fp) == 1);
+	}
+	if (success && !mItemRecords.empty())
+	{
+		success = (fwrite(&mItemRecords[0], mItemRecords.size(), 1, fp) == 1);
+	}
+	if (success && !mStrings.empty())
+	{
+		success = (fwrite(mStrings.data(), mStrings.size(), 1, fp) == 1);
+	}
+	success = (fclose(fp) == 0) && success;
+	if (!success)
+	{
+		llwarns << "error writing inventory cache " << filename << llendl;
+		LLFile::remove(filename);
+	}
+	return success;
+}
+
+bool LLInventoryCacheFile::open(const std::string& filename, S32 cache_version, bool& is_cache_obsolete)
+{
+	close();
+	is_cache_obsolete = false;
+
+	S32 file_size = 0;
+	if (mFile.open(filename, LL_APR_RB, NULL, &file_size) != APR_SUCCESS || !mFile.getFileHandle())
+	{
+		return false;
+	}
+	if (file_size < (S32)sizeof(Header))
+	{
+		llwarns << "Inventory cache " << filename << " is truncated" << llendl;
+		close();
+		return false;
+	}
+
+	mPool = new LLAPRPool();
+	if (apr_mmap_create(&mMap, mFile.getFileHandle(), 0, file_size, APR_MMAP_READ, mPool->getAPRPool()) == APR_SUCCESS)
+	{
+		mData = (const U8*)mMap->mm;
+	}
+	else
+	{
+		// No mapping on this file system, read it all instead
+		mMap = NULL;
+		mBuffer.resize(file_size);
+		if (mFile.read(&mBuffer[0], file_size) != file_size)
+		{
+			llwarns << "Unable to read inventory cache " << filename << llendl;
+			close();
+			return false;
+		}
+		mData = &mBuffer[0];
+	}
+
+	const Header* header = (const Header*)mData;
+	if (header->mMagic != CACHE_MAGIC || header->mFormatVersion != CACHE_FORMAT_VERSION)
+	{
+		llinfos << "Inventory cache " << filename << " has an unknown format" << llendl;
+		close();
+		return false;
+	}
+	if (header->mCacheVersion != cache_version)
+	{
+		is_cache_obsolete = true;
+		close();
+		return false;
+	}
+
+	// 64 bit arithmetic, the counts come straight from the file
+	U64 size = sizeof(Header)
+		+ (U64)header->mCategoryCount * sizeof(CategoryRecord)
+		+ (U64)header->mItemCount * sizeof(ItemRecord)
+		+ header->mStringsSize;
+	if (size != (U64)file_size)
+	{
+		llwarns << "Inventory cache " << filename << " is damaged" << llendl;
+		close();
+		return false;
+	}
+
+	mCategoryCount = header->mCategoryCount;
+	mItemCount = header->mItemCount;
+	mCategoryData = mData + sizeof(Header);
+	mItemData = mCategoryData + mCategoryCount * sizeof(CategoryRecord);
+	mStringData = (const char*)(mItemData + mItemCount * sizeof(ItemRecord));
+	mStringDataSize = header->mStringsSize;
+	return true;
+}
+
+void LLInventoryCacheFile::close()
+{
+	if (mMap)
+	{
+		apr_mmap_delete(mMap);
+		mMap = NULL;
+	}
+	if (mFile.getFileHandle())
+	{
+		mFile.close();
+	}
+	delete mPool;
+	mPool = NULL;
+	mBuffer.clear();
+	mData = NULL;
+	mCategoryCount = 0;
+	mItemCount = 0;
+	mCategoryData = NULL;
+	mItemData = NULL;
+	mStringData = NULL;
+	mStringDataSize = 0;
+}
+
+const LLInventoryCacheFile::CategoryRecord& LLInventoryCacheFile::getCategoryRecord(S32 index) const
+{
+	llassert(index >= 0 && index < mCategoryCount);
+	return ((const CategoryRecord*)mCategoryData)[index];
+}
+
+const LLInventoryCacheFile::ItemRecord& LLInventoryCacheFile::getItemRecord(S32 index) const
+{
+	llassert(index >= 0 && index < mItemCount);
+	return ((const ItemRecord*)mItemData)[index];
+}
+
+LLUUID LLInventoryCacheFile::getCategoryOwnerID(S32 index) const
+{
+	return to_uuid(getCategoryRecord(index).mOwnerID);
+}
+
+S32 LLInventoryCacheFile::readCategory(S32 index, LLInventoryCategory* cat) const
+{
+	const CategoryRecord& record = getCategoryRecord(index);
+	cat->setUUID(to_uuid(record.mID));
+	cat->setParent(to_uuid(record.mParentID));
+	cat->setType((LLAssetType::EType)record.mType);
+	cat->setPreferredType((LLFolderType::EType)record.mPreferredType);
+	cat->rename(getString(record.mNameOffset, record.mNameLength));
+	return record.mVersion;
+}
+
+LLUUID LLInventoryCacheFile::getItemID(S32 index) const
+{
+	return to_uuid(getItemRecord(index).mID);
+}
+
+LLUUID LLInventoryCacheFile::getItemParentID(S32 index) const
+{
+	return to_uuid(getItemRecord(index).mParentID);
+}
+
+void LLInventoryCacheFile::readItem(S32 index, LLInventoryItem* item) const
+{
+	const ItemRecord& record = getItemRecord(index);
+	item->setUUID(to_uuid(record.mID));
+	item->setParent(to_uuid(record.mParentID));
+	item->setType((LLAssetType::EType)record.mType);
+	item->setInventoryType((LLInventoryType::EType)record.mInventoryType);
+
+	LLUUID asset_id(to_uuid(record.mAssetID));
+	if (record.mAssetShadowed)
+	{
+		LLXORCipher cipher(SHADOW_KEY.mData, UUID_BYTES);
+		cipher.decrypt(asset_id.mData, UUID_BYTES);
+	}
+	item->setAssetUUID(asset_id);
+
+	// The masks were consistent when written, store them as they are
+	LLPermissions perm;
+	perm.init(to_uuid(record.mCreatorID), to_uuid(record.mOwnerID),
+			  to_uuid(record.mLastOwnerID), to_uuid(record.mGroupID));
+	perm.setMaskBase(record.mMaskBase);
+	perm.setMaskOwner(record.mMaskOwner);
+	perm.setMaskGroup(record.mMaskGroup);
+	perm.setMaskEveryone(record.mMaskEveryone);
+	perm.setMaskNext(record.mMaskNextOwner);
+	item->setPermissions(perm);
+
+	item->setSaleInfo(LLSaleInfo((LLSaleInfo::EForSale)record.mSaleType, record.mSalePrice));
+	item->setFlags(record.mFlags);
+	item->setCreationDate(record.mCreationDate);
+	item->rename(getString(record.mNameOffset, record.mNameLength));
+	item->setDescription(getString(record.mDescOffset, record.mDescLength));
+}
@@ -0,0 +1,119 @@
+/**
+ * @file llinventorycache.h
+ * @brief LLInventoryCacheFile class declaration
+ *
+ * $LicenseInfo:firstyear=2011&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2011, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLINVENTORYCACHE_H
+#define LL_LLINVENTORYCACHE_H
+
+#include <string>
+#include <vector>
+
+#include "apr_mmap.h"
+#include "llapr.h"
+#include "lluuid.h"
+
+class LLInventoryCategory;
+class LLInventoryItem;
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Class LLInventoryCacheFile
+//
+//   Versioned binary inventory cache. The file is a header, an array of
+//   fixed size category records, an array of fixed size item records and a
+//   pool of the names and descriptions they point into.
+//
+//   For reading, the file is memory mapped and nothing is decoded up front.
+//   Records are turned into inventory objects one at a time on request, and
+//   the parent of an item can be looked at without decoding the item, so
+//   items in folders that turn out to be stale never cost anything.
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+class LLInventoryCacheFile
+{
+public:
+	LLInventoryCacheFile();
+	~LLInventoryCacheFile();
+
+	//--------------------------------------------------------------------
+	// Writing
+	//--------------------------------------------------------------------
+public:
+	void addCategory(const LLInventoryCategory* cat, const LLUUID& owner_id, S32 version);
+	void addItem(const LLInventoryItem* item);
+	// Writes everything added so far. cache_version is the caller's own
+	// format version, handed back by open().
+	bool write(const std::string& filename, S32 cache_version) const;
+
+	//--------------------------------------------------------------------
+	// Reading
+	//--------------------------------------------------------------------
+public:
+	// Returns false if the file is missing, damaged, of another format or
+	// was written with another cache_version. is_cache_obsolete is set in
+	// the last case only.
+	bool open(const std::string& filename, S32 cache_version, bool& is_cache_obsolete);
+	void close();
+	bool isOpen() const { return mData != NULL; }
+
+	S32 getCategoryCount() const { return mCategoryCount; }
+	S32 getItemCount() const { return mItemCount; }
+
+	LLUUID getCategoryOwnerID(S32 index) const;
+	// Fills in cat and returns the category version
+	S32 readCategory(S32 index, LLInventoryCategory* cat) const;
+
+	LLUUID getItemID(S32 index) const;
+	LLUUID getItemParentID(S32 index) const;
+	void readItem(S32 index, LLInventoryItem* item) const;
+
+private:
+	struct Header;
+	struct CategoryRecord;
+	struct ItemRecord;
+
+	U32 addString(const std::string& str, U32& length);
+	std::string getString(U32 offset, U32 length) const;
+	const CategoryRecord& getCategoryRecord(S32 index) const;
+	const ItemRecord& getItemRecord(S32 index) const;
+
+	// records being written
+	std::vector<U8> mCategoryRecords;
+	std::vector<U8> mItemRecords;
+	std::string mStrings;
+
+	// file being read
+	LLAPRPool* mPool;
+	LLAPRFile mFile;
+	apr_mmap_t* mMap;
+	std::vector<U8> mBuffer;	// file contents when it could not be mapped
+	const U8* mData;
+	S32 mCategoryCount;
+	S32 mItemCount;
+	const U8* mCategoryData;
+	const U8* mItemData;
+	const char* mStringData;
+	U32 mStringDataSize;
+};
+
+#endif // LL_LLINVENTORYCACHE_H
@@ -0,0 +1,190 @@
+/**
+ * @file llinventorycache_test.cpp
+ * @brief Test for llinventorycache.cpp.
+ *
+ * $LicenseInfo:firstyear=2011&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2011, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llinventorycache.h"
+#include "../llinventory.h"
+
+#include "llfile.h"
+
+#include "../test/lltut.h"
+
+namespace tut
+{
+	struct inventory_cache_data
+	{
+		inventory_cache_data()
+		{
+			ll_init_apr();
+			LLUUID random;
+			random.generate();
+#if LL_WINDOWS
+			mFilename = "C:\\inventory-cache-test-" + random.asString();
+#else
+			mFilename = "/tmp/inventory-cache-test-" + random.asString();
+#endif
+		}
+
+		~inventory_cache_data()
+		{
+			LLFile::remove(mFilename);
+		}
+
+		LLPointer<LLInventoryItem> makeItem(const LLUUID& parent_id, U32 base_mask)
+		{
+			LLUUID item_id, creator_id, owner_id, last_owner_id, group_id, asset_id;
+			item_id.generate();
+			creator_id.generate();
+			owner_id.generate();
+			last_owner_id.generate();
+			group_id.generate();
+			asset_id.generate();
+			LLPermissions perm;
+			perm.init(creator_id, owner_id, last_owner_id, group_id);
+			perm.initMasks(base_mask, base_mask, PERM_NONE, PERM_COPY, base_mask);
+			return new LLInventoryItem(item_id, parent_id, perm, asset_id,
+									   LLAssetType::AT_OBJECT, LLInventoryType::IT_OBJECT,
+									   std::string("Sample Object"), std::string("Used for Testing"),
+									   LLSaleInfo(LLSaleInfo::FS_COPY, 42), 0x1234, 1300000000);
+		}
+
+		void writeRaw(const std::string& contents)
+		{
+			LLFILE* fp = LLFile::fopen(mFilename, "wb");
+			ensure("opened raw file", fp != NULL);
+			fwrite(contents.data(), contents.size(), 1, fp);
+			fclose(fp);
+		}
+
+		std::string mFilename;
+	};
+	typedef test_group<inventory_cache_data> inventory_cache_test;
+	typedef inventory_cache_test::object inventory_cache_object;
+	tut::inventory_cache_test inventory_cache("LLInventoryCacheFile");
+
+	template<> template<>
+	void inventory_cache_object::test<1>()
+	{
+		set_test_name("categories and items round trip");
+		LLUUID root_id, folder_id, owner_id;
+		root_id.generate();
+		folder_id.generate();
+		owner_id.generate();
+		LLPointer<LLInventoryCategory> folder = new LLInventoryCategory(folder_id, root_id,
+																	   LLFolderType::FT_NOTECARD, "Notes");
+		LLPointer<LLInventoryItem> full = makeItem(folder_id, PERM_ALL);
+		LLPointer<LLInventoryItem> restricted = makeItem(folder_id, PERM_MOVE | PERM_TRANSFER);
+
+		LLInventoryCacheFile writer;
+		writer.addCategory(folder, owner_id, 7);
+		writer.addItem(full);
+		writer.addItem(restricted);
+		ensure("written", writer.write(mFilename, 3));
+
+		LLInventoryCacheFile reader;
+		bool obsolete = true;
+		ensure("opened", reader.open(mFilename, 3, obsolete));
+		ensure("not obsolete", !obsolete);
+		ensure_equals("category count", reader.getCategoryCount(), 1);
+		ensure_equals("item count", reader.getItemCount(), 2);
+
+		LLPointer<LLInventoryCategory> cat = new LLInventoryCategory;
+		ensure_equals("category version", reader.readCategory(0, cat), 7);
+		ensure_equals("category owner", reader.getCategoryOwnerID(0), owner_id);
+		ensure_equals("category id", cat->getUUID(), folder_id);
+		ensure_equals("category parent", cat->getParentUUID(), root_id);
+		ensure_equals("category name", cat->getName(), std::string("Notes"));
+		ensure_equals("category preferred type", (S32)cat->getPreferredType(), (S32)LLFolderType::FT_NOTECARD);
+
+		LLInventoryItem* expected[] = { full, restricted };
+		for (S32 i = 0; i < 2; ++i)
+		{
+			ensure_equals("parent without decoding", reader.getItemParentID(i), folder_id);
+			ensure_equals("id without decoding", reader.getItemID(i), expected[i]->getUUID());
+
+			LLPointer<LLInventoryItem> item = new LLInventoryItem;
+			reader.readItem(i, item);
+			ensure_equals("item id", item->getUUID(), expected[i]->getUUID());
+			ensure_equals("asset id", item->getAssetUUID(), expected[i]->getAssetUUID());
+			ensure_equals("name", item->getName(), expected[i]->getName());
+			ensure_equals("description", item->getDescription(), expected[i]->getDescription());
+			ensure_equals("flags", item->getFlags(), expected[i]->getFlags());
+			ensure_equals("creation date", (S32)item->getCreationDate(), (S32)expected[i]->getCreationDate());
+			ensure("permissions", item->getPermissions() == expected[i]->getPermissions());
+			ensure("sale info", item->getSaleInfo() == expected[i]->getSaleInfo());
+			ensure_equals("crc", item->getCRC32(), expected[i]->getCRC32());
+		}
+	}
+
+	template<> template<>
+	void inventory_cache_object::test<2>()
+	{
+		set_test_name("another cache version is obsolete");
+		LLInventoryCacheFile writer;
+		ensure("written", writer.write(mFilename, 2));
+
+		LLInventoryCacheFile reader;
+		bool obsolete = false;
+		ensure("not opened", !reader.open(mFilename, 3, obsolete));
+		ensure("obsolete", obsolete);
+		ensure("closed", !reader.isOpen());
+
+		ensure("empty cache opened", reader.open(mFilename, 2, obsolete));
+		ensure_equals("no items", reader.getItemCount(), 0);
+	}
+
+	template<> template<>
+	void inventory_cache_object::test<3>()
+	{
+		set_test_name("missing, foreign and truncated files are rejected");
+		LLInventoryCacheFile reader;
+		bool obsolete = true;
+		ensure("missing file", !reader.open(mFilename, 1, obsolete));
+		ensure("missing is not obsolete", !obsolete);
+
+		// an old text cache
+		writeRaw("\tinv_cache_version\t2\n\tinv_category\t0\n\t{\n");
+		ensure("text file", !reader.open(mFilename, 2, obsolete));
+		ensure("text is not obsolete", !obsolete);
+
+		LLUUID folder_id;
+		folder_id.generate();
+		LLInventoryCacheFile writer;
+		for (S32 i = 0; i < 10; ++i)
+		{
+			writer.addItem(makeItem(folder_id, PERM_ALL));
+		}
+		ensure("written", writer.write(mFilename, 2));
+
+		LLFILE* fp = LLFile::fopen(mFilename, "rb");
+		std::string contents(4096, '\0');
+		contents.resize(fread(&contents[0], 1, contents.size(), fp));
+		fclose(fp);
+		writeRaw(contents.substr(0, contents.size() - 5));
+		ensure("truncated file", !reader.open(mFilename, 2, obsolete));
+	}
+}
@@ -28,6 +28,7 @@
 
 #include "llmath.h"
 #include "llcamera.h"
+#include "llv4math.h"	// for LL_VECTORIZE
 
 // ---------------- Constructors and destructors ----------------
 
@@ -320,6 +321,139 @@ S32 LLCamera::AABBInFrustumNoFarClip(const LLVector3 &center, const LLVector3& r
 	return result;
 }
 
+S32 LLCamera::AABBsInFrustum(LLCameraBoxBatch& boxes, S8* results, bool far_clip)
+{
+	// the planes AABBInFrustum() would test
+	U32 planes[7];
+	U32 plane_count = 0;
+	for (U32 i = 0; i < mPlaneCount; i++)
+	{
+		if (mAgentPlanes[i].mask != 0xff && (far_clip || i != AGENT_PLANE_FAR))
+		{
+			planes[plane_count++] = i;
+		}
+	}
+
+	const F32* cx = boxes.mComponents[0].getData();
+	const F32* cy = boxes.mComponents[1].getData();
+	const F32* cz = boxes.mComponents[2].getData();
+	const F32* rx = boxes.mComponents[3].getData();
+	const F32* ry = boxes.mComponents[4].getData();
+	const F32* rz = boxes.mComponents[5].getData();
+
+	S32 visible = 0;
+	for (U32 first = 0; first < boxes.mCount; first += 4)
+	{
+		U32 lanes = llmin(boxes.mCount - first, 4U);
+		U8& hint = boxes.mPlaneHints[first >> 2];
+
+		// Start with the plane that culled these boxes last time, if it is
+		// still one we test. Which plane culls a box doesn't change the
+		// result, only how soon we can stop.
+		U32 order[8];
+		U32 order_count = 0;
+		for (U32 p = 0; p < plane_count; p++)
+		{
+			if (planes[p] == hint)
+			{
+				order[order_count++] = hint;
+				break;
+			}
+		}
+		bool hinted = order_count > 0;
+		for (U32 p = 0; p < plane_count; p++)
+		{
+			if (!hinted || planes[p] != hint)
+			{
+				order[order_count++] = planes[p];
+			}
+		}
+
+		U32 outside_bits = 0xf & ~((1 << lanes) - 1); // lanes past the end are out
+		U32 partial_bits = 0;
+
+#if LL_VECTORIZE
+		__m128 c[3] = { _mm_load_ps(cx + first), _mm_load_ps(cy + first), _mm_load_ps(cz + first) };
+		__m128 r[3] = { _mm_load_ps(rx + first), _mm_load_ps(ry + first), _mm_load_ps(rz + first) };
+		__m128 outside = _mm_cmpge_ps(_mm_set_ps(3.f, 2.f, 1.f, 0.f), _mm_set1_ps((F32)lanes));
+		__m128 partial = _mm_setzero_ps();
+		for (U32 p = 0; p < order_count; p++)
+		{
+			const frustum_plane& plane = mAgentPlanes[order[p]];
+			__m128 n[3];
+			__m128 minp[3];
+			__m128 maxp[3];
+			for (U32 k = 0; k < 3; k++)
+			{
+				// the same operations as AABBInFrustum(), so the results match
+				__m128 rscale = _mm_mul_ps(r[k], _mm_set1_ps((plane.mask & (1 << k)) ? 1.f : -1.f));
+				n[k] = _mm_set1_ps(plane.p.mV[k]);
+				minp[k] = _mm_sub_ps(c[k], rscale);
+				maxp[k] = _mm_add_ps(c[k], rscale);
+			}
+			__m128 neg_d = _mm_set1_ps(-plane.p.mV[3]);
+			__m128 dist_min = _mm_add_ps(_mm_add_ps(_mm_mul_ps(n[0], minp[0]), _mm_mul_ps(n[1], minp[1])),
+										 _mm_mul_ps(n[2], minp[2]));
+			outside = _mm_or_ps(outside, _mm_cmpgt_ps(dist_min, neg_d));
+			if (_mm_movemask_ps(outside) == 0xf)
+			{
+				hint = order[p];
+				break;
+			}
+			__m128 dist_max = _mm_add_ps(_mm_add_ps(_mm_mul_ps(n[0], maxp[0]), _mm_mul_ps(n[1], maxp[1])),
+										 _mm_mul_ps(n[2], maxp[2]));
+			partial = _mm_or_ps(partial, _mm_cmpgt_ps(dist_max, neg_d));
+		}
+		outside_bits = _mm_movemask_ps(outside);
+		partial_bits = _mm_movemask_ps(partial);
+#else
+		for (U32 p = 0; p < order_count; p++)
+		{
+			const frustum_plane& plane = mAgentPlanes[order[p]];
+			LLVector3 n = LLVector3(plane.p);
+			F32 d = plane.p.mV[3];
+			LLVector3 scaler((plane.mask & 1) ? 1.f : -1.f, (plane.mask & 2) ? 1.f : -1.f, (plane.mask & 4) ? 1.f : -1.f);
+			for (U32 lane = 0; lane < lanes; lane++)
+			{
+				U32 i = first + lane;
+				LLVector3 center(cx[i], cy[i], cz[i]);
+				LLVector3 rscale = LLVector3(rx[i], ry[i], rz[i]).scaledVec(scaler);
+				if (n * (center - rscale) > -d)
+				{
+					outside_bits |= 1 << lane;
+				}
+				if (n * (center + rscale) > -d)
+				{
+					partial_bits |= 1 << lane;
+				}
+			}
+			if (outside_bits == 0xf)
+			{
+				hint = order[p];
+				break;
+			}
+		}
+#endif
+
+		for (U32 lane = 0; lane < lanes; lane++)
+		{
+			S8 res = 2;
+			if (outside_bits & (1 << lane))
+			{
+				res = 0;
+			}
+			else if (partial_bits & (1 << lane))
+			{
+				res = 1;
+			}
+			visible += res ? 1 : 0;
+			results[first + lane] = res;
+		}
+	}
+
+	return visible;
+}
+
 int LLCamera::sphereInFrustumQuick(const LLVector3 &sphere_center, const F32 radius) 
 {
 	LLVector3 dist = sphere_center-mFrustCenter;
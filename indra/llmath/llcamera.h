@@ -28,10 +28,13 @@
 #define LL_CAMERA_H
 
 
+#include "llalignedarray.h"
 #include "llmath.h"
 #include "llcoordframe.h"
 #include "llplane.h"
 
+#include <vector>
+
 const F32 DEFAULT_FIELD_OF_VIEW 	= 60.f * DEG_TO_RAD;
 const F32 DEFAULT_ASPECT_RATIO 		= 640.f / 480.f;
 const F32 DEFAULT_NEAR_PLANE 		= 0.25f;
@@ -59,6 +62,46 @@ static const LLVector3 NEG_Y_AXIS(0.f,-1.f,0.f);
 static const LLVector3 NEG_Z_AXIS(0.f,0.f,-1.f);
 
 
+// Boxes for LLCamera::AABBsInFrustum(), kept a component at a time so four
+// of them can be tested against a plane at once. clear() keeps the storage
+// and the plane hints, so a batch refilled every frame with the boxes in
+// the same order costs no allocations and starts with the plane that culled
+// them last frame.
+class LLCameraBoxBatch
+{
+public:
+	LLCameraBoxBatch() : mCount(0) { }
+
+	void clear()								{ mCount = 0; }
+	U32 size() const							{ return mCount; }
+
+	void push_back(const LLVector3& center, const LLVector3& radius)
+	{
+		if ((mCount & 3) == 0 && mComponents[0].size() <= mCount)
+		{
+			for (U32 i = 0; i < 6; i++)
+			{
+				mComponents[i].resize(mCount + 4);
+			}
+			mPlaneHints.push_back(0);
+		}
+		mComponents[0][mCount] = center.mV[VX];
+		mComponents[1][mCount] = center.mV[VY];
+		mComponents[2][mCount] = center.mV[VZ];
+		mComponents[3][mCount] = radius.mV[VX];
+		mComponents[4][mCount] = radius.mV[VY];
+		mComponents[5][mCount] = radius.mV[VZ];
+		mCount++;
+	}
+
+private:
+	friend class LLCamera;
+
+	LLAlignedArray<F32> mComponents[6];	// center x, y, z, then radius x, y, z
+	std::vector<U8> mPlaneHints;		// for every four boxes, the plane that culled them all last time
+	U32 mCount;
+};
+
 // An LLCamera is an LLCoorFrame with a view frustum.
 // This means that it has several methods for moving it around 
 // that are inherited from the LLCoordFrame() class :
@@ -196,6 +239,12 @@ public:
 	S32 AABBInFrustum(const LLVector3 &center, const LLVector3& radius);
 	S32 AABBInFrustumNoFarClip(const LLVector3 &center, const LLVector3& radius);
 
+	// AABBInFrustum(), or AABBInFrustumNoFarClip() without far_clip, for
+	// every box in boxes, four at a time where we vectorize. results needs
+	// room for boxes.size() entries. Returns how many boxes are at least
+	// partly in.
+	S32 AABBsInFrustum(LLCameraBoxBatch& boxes, S8* results, bool far_clip = true);
+
 	//does a quick 'n dirty sphere-sphere check
 	S32 sphereInFrustumQuick(const LLVector3 &sphere_center, const F32 radius); 
 
@@ -42,6 +42,9 @@
 #define LL_OCTREE_MAX_CAPACITY 128
 #endif
 
+// Nodes are handed out from blocks of this many
+#define LL_OCTREE_POOL_BLOCK_SIZE 64
+
 template <class T> class LLOctreeNode;
 
 template <class T>
@@ -63,17 +66,26 @@ public:
 	virtual void visit(const LLOctreeNode<T>* branch) = 0;
 };
 
+// Elements are kept in a flat list, and each one remembers where it is in
+// it through T::getBinIndex() and T::setBinIndex(), so removal doesn't have
+// to search.  Children live in a fixed array of 8, with a map from octant to
+// slot.
+//
+// A node left empty by remove() isn't deleted straight away.  It is marked,
+// and prune() on the root deletes it if it is still empty by then.  Moving an
+// element is a remove() and an insert() followed by prune(), so the insert
+// can reuse the nodes the element just left.  balance() prunes too, and
+// whoever owns the tree must call one or the other now and then.
 template <class T>
 class LLOctreeNode : public LLTreeNode<T>
 {
 public:
 	typedef LLOctreeTraveler<T>									oct_traveler;
 	typedef LLTreeTraveler<T>									tree_traveler;
-	typedef typename std::set<LLPointer<T> >					element_list;
-	typedef typename std::set<LLPointer<T> >::iterator			element_iter;
-	typedef typename std::set<LLPointer<T> >::const_iterator	const_element_iter;
+	typedef typename std::vector<LLPointer<T> >					element_list;
+	typedef typename std::vector<LLPointer<T> >::iterator		element_iter;
+	typedef typename std::vector<LLPointer<T> >::const_iterator	const_element_iter;
 	typedef typename std::vector<LLTreeListener<T>*>::iterator	tree_listener_iter;
-	typedef typename std::vector<LLOctreeNode<T>* >				child_list;
 	typedef LLTreeNode<T>		BaseType;
 	typedef LLOctreeNode<T>		oct_node;
 	typedef LLOctreeListener<T>	oct_listener;
@@ -110,6 +122,43 @@ public:
 		} 
 	}
 
+	static void* operator new(size_t size)
+	{
+		if (size != sizeof(LLOctreeNode<T>))
+		{
+			return ::operator new(size);
+		}
+
+		if (!sFreeNodes)
+		{
+			char* block = (char*) ::operator new(size * LL_OCTREE_POOL_BLOCK_SIZE);
+			for (U32 i = 0; i < LL_OCTREE_POOL_BLOCK_SIZE; i++)
+			{
+				void* node = block + i * size;
+				*(void**) node = sFreeNodes;
+				sFreeNodes = node;
+			}
+		}
+
+		void* node = sFreeNodes;
+		sFreeNodes = *(void**) node;
+		return node;
+	}
+
+	// Blocks are never given back, the tree will want the nodes again.
+	// Nodes are only made and deleted on the main thread, so no lock.
+	static void operator delete(void* ptr, size_t size)
+	{
+		if (size != sizeof(LLOctreeNode<T>))
+		{
+			::operator delete(ptr);
+			return;
+		}
+
+		*(void**) ptr = sFreeNodes;
+		sFreeNodes = ptr;
+	}
+
 	inline const BaseType* getParent()	const			{ return mParent; }
 	inline void setParent(BaseType* parent)			{ mParent = (oct_node*) parent; }
 	inline const LLVector3d& getCenter() const			{ return mCenter; }
@@ -218,17 +267,15 @@ public:
 	}
 
 	void accept(oct_traveler* visitor)				{ visitor->visit(this); }
-	virtual bool isLeaf() const						{ return mChild.empty(); }
+	virtual bool isLeaf() const						{ return mChildCount == 0; }
 	
 	U32 getElementCount() const						{ return mData.size(); }
 	element_list& getData()							{ return mData; }
 	const element_list& getData() const				{ return mData; }
 	
-	U32 getChildCount()	const						{ return mChild.size(); }
+	U32 getChildCount()	const						{ return mChildCount; }
 	oct_node* getChild(U32 index)					{ return mChild[index]; }
 	const oct_node* getChild(U32 index) const		{ return mChild[index]; }
-	child_list& getChildren()						{ return mChild; }
-	const child_list& getChildren() const			{ return mChild; }
 	
 	void accept(tree_traveler* visitor) const		{ visitor->visit(this); }
 	void accept(oct_traveler* visitor) const		{ visitor->visit(this); }
@@ -250,14 +297,12 @@ public:
 			while (keep_going && node->getSize().mdV[0] >= rad)
 			{	
 				keep_going = FALSE;
-				for (U32 i = 0; i < node->getChildCount() && !keep_going; i++)
+				U8 index = node->mChildMap[octant];
+				if (index != NO_CHILD_NODES)
 				{
-					if (node->getChild(i)->getOctant() == octant)
-					{
-						node = node->getChild(i);
-						octant = node->getOctant(pos.mdV);
-						keep_going = TRUE;
-					}
+					node = node->getChild(index);
+					octant = node->getOctant(pos.mdV);
+					keep_going = TRUE;
 				}
 			}
 		}
@@ -288,14 +333,14 @@ public:
 			{ //it belongs here
 #if LL_OCTREE_PARANOIA_CHECK
 				//if this is a redundant insertion, error out (should never happen)
-				if (mData.find(data) != mData.end())
+				if (data->getBinIndex() != -1)
 				{
 					llwarns << "Redundant octree insertion detected. " << data << llendl;
 					return false;
 				}
 #endif
 
-				mData.insert(data);
+				addElement(data);
 				BaseType::insert(data);
 				return true;
 			}
@@ -325,7 +370,7 @@ public:
 					llabs(center.mdV[1] - getCenter().mdV[1]) < F_APPROXIMATELY_ZERO &&
 					llabs(center.mdV[2] - getCenter().mdV[2]) < F_APPROXIMATELY_ZERO)
 				{
-					mData.insert(data);
+					addElement(data);
 					BaseType::insert(data);
 					return true;
 				}
@@ -377,9 +422,10 @@ public:
 
 	bool remove(T* data)
 	{
-		if (mData.find(data) != mData.end())
+		S32 i = data->getBinIndex();
+		if (i >= 0 && i < (S32) mData.size() && mData[i] == data)
 		{	//we have data
-			mData.erase(data);
+			removeElement(i);
 			notifyRemoval(data);
 			checkAlive();
 			return true;
@@ -414,13 +460,16 @@ public:
 
 	void removeByAddress(T* data)
 	{
-        if (mData.find(data) != mData.end())
+		for (U32 i = 0; i < mData.size(); i++)
 		{
-			mData.erase(data);
-			notifyRemoval(data);
-			llwarns << "FOUND!" << llendl;
-			checkAlive();
-			return;
+			if (mData[i] == data)
+			{
+				removeElement(i);
+				notifyRemoval(data);
+				llwarns << "FOUND!" << llendl;
+				checkAlive();
+				return;
+			}
 		}
 		
 		for (U32 i = 0; i < getChildCount(); i++)
@@ -432,7 +481,12 @@ public:
 
 	void clearChildren()
 	{
-		mChild.clear();
+		mChildCount = 0;
+		mPruneMask = 0;
+		for (U32 i = 0; i < 8; i++)
+		{
+			mChildMap[i] = NO_CHILD_NODES;
+		}
 	}
 
 	void validate()
@@ -451,9 +505,33 @@ public:
 
 	virtual bool balance()
 	{	
+		prune();
 		return false;
 	}
 
+	//delete the nodes checkAlive() marked that are still empty
+	void prune()
+	{
+		//only the marked children are looked at, the rest aren't even loaded
+		for (S32 i = getChildCount() - 1; i >= 0 && mPruneMask; i--)
+		{
+			if (mPruneMask & (1 << i))
+			{
+				oct_node* child = mChild[i];
+				child->prune();
+				if (child->isEmpty())
+				{
+					removeChild(i, TRUE);
+				}
+			}
+		}
+
+		//cleared last so removeChild() doesn't mark us again
+		mPruneMask = 0;
+	}
+
+	bool isEmpty() const							{ return mChildCount == 0 && mData.empty(); }
+
 	void destroy()
 	{
 		for (U32 i = 0; i < getChildCount(); i++) 
@@ -461,6 +539,7 @@ public:
 			mChild[i]->destroy();
 			delete mChild[i];
 		}
+		clearChildren();
 	}
 
 	void addChild(oct_node* child, BOOL silent = FALSE) 
@@ -478,15 +557,26 @@ public:
 			}
 		}
 
-		if (mChild.size() >= 8)
+		if (mChildMap[child->getOctant()] != NO_CHILD_NODES)
 		{
-			OCT_ERRS <<"Octree node has too many children... why?" << llendl;
+			OCT_ERRS <<"Octree node already has a child in this octant." << llendl;
 		}
 #endif
 
-		mChild.push_back(child);
+		if (mChildCount >= 8)
+		{
+			llerrs << "Octree node has too many children... why?" << llendl;
+		}
+
+		mChildMap[child->getOctant()] = mChildCount;
+		mChild[mChildCount++] = child;
 		child->setParent(this);
 
+		if (child->mPruneMask)
+		{ //still has empty nodes below from its old parent
+			child->markPrune();
+		}
+
 		if (!silent)
 		{
 			for (U32 i = 0; i < this->getListenerCount(); i++)
@@ -505,25 +595,62 @@ public:
 			listener->handleChildRemoval(this, getChild(index));
 		}
 
+		oct_node* child = mChild[index];
+		mChildMap[child->getOctant()] = NO_CHILD_NODES;
+
+		//fill the hole with the last child
+		mChildCount--;
+		mPruneMask &= ~(1 << index);
+		if (index != mChildCount)
+		{
+			mChild[index] = mChild[mChildCount];
+			mChildMap[mChild[index]->getOctant()] = index;
+			if (mPruneMask & (1 << mChildCount))
+			{
+				mPruneMask &= ~(1 << mChildCount);
+				mPruneMask |= 1 << index;
+			}
+		}
+
 		if (destroy)
 		{
-			mChild[index]->destroy();
-			delete mChild[index];
+			child->destroy();
+			delete child;
 		}
-		mChild.erase(mChild.begin() + index);
 
 		checkAlive();
 	}
 
+	//an empty node is only marked here, balance() deletes it
 	void checkAlive()
 	{
-		if (getChildCount() == 0 && getElementCount() == 0)
+		if (isEmpty())
 		{
-			oct_node* parent = getOctParent();
-			if (parent)
-			{
-				parent->deleteChild(this);
+			markPrune();
+		}
+	}
+
+	//mark the way down to this node for prune()
+	void markPrune()
+	{
+		oct_node* node = this;
+		oct_node* parent = getOctParent();
+		while (parent)
+		{
+			U8 index = parent->mChildMap[node->getOctant()];
+			if (index == NO_CHILD_NODES || parent->mChild[index] != node)
+			{ //not added to the parent yet, addChild() will mark it
+				return;
+			}
+
+			bool marked = parent->mPruneMask != 0;
+			parent->mPruneMask |= 1 << index;
+			if (marked)
+			{ //so is the rest of the way
+				return;
 			}
+			node = parent;
+			parent = node->getOctParent();
 		}
 	}
 
@@ -542,7 +669,30 @@ public:
 	}
 
 protected:	
-	child_list mChild;
+	void addElement(T* data)
+	{
+		data->setBinIndex(mData.size());
+		mData.push_back(data);
+	}
+
+	//swaps the last element into the hole
+	void removeElement(U32 index)
+	{
+		mData[index]->setBinIndex(-1);
+		U32 last = mData.size() - 1;
+		if (index != last)
+		{
+			mData[index] = mData[last];
+			mData[index]->setBinIndex(index);
+		}
+		mData.pop_back();
+	}
+
+	static const U8 NO_CHILD_NODES = 255;
+
+	oct_node* mChild[8];
+	U8 mChildMap[8];
+	U32 mChildCount;
 	element_list mData;
 	oct_node* mParent;
 	LLVector3d mCenter;
@@ -550,8 +700,14 @@ protected:
 	LLVector3d mMax;
 	LLVector3d mMin;
 	U8 mOctant;
+	U8 mPruneMask; //children that are empty or have empty nodes below, see prune()
+
+	static void* sFreeNodes;
 };
 
+template <class T>
+void* LLOctreeNode<T>::sFreeNodes = NULL;
+
 //just like a regular node, except it might expand on insert and compress on balance
 template <class T>
 class LLOctreeRoot : public LLOctreeNode<T>
@@ -569,6 +725,8 @@ public:
 	
 	bool balance()
 	{	
+		this->prune();
+
 		if (this->getChildCount() == 1 && 
 			!(this->mChild[0]->isLeaf()) &&
 			this->mChild[0]->getElementCount() == 0) 
@@ -674,6 +832,7 @@ public:
 				{
 					LLOctreeNode<T>* child = this->getChild(i);
 					newnode->addChild(child);
+					child->checkAlive();
 				}
 
 				//clear our children and add the root copy
@@ -36,6 +36,7 @@
 #include "m4math.h"
 #include "m3math.h"
 #include "llquantize.h"
+#include "llv4math.h"	// for LL_VECTORIZE
 
 // WARNING: Don't use this for global const definitions!  using this
 // at the top of a *.cpp file might not give you what you think.
@@ -701,6 +702,76 @@ LLQuaternion nlerp(F32 t, const LLQuaternion &a, const LLQuaternion &b)
 	}
 }
 
+void nlerp_batch(U32 count, const F32* u, const LLQuaternion* a, const LLQuaternion* b, LLQuaternion* out)
+{
+	U32 i = 0;
+#if LL_VECTORIZE && defined(_MM_TRANSPOSE4_PS)
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.f);
+	for (; i + 4 <= count; i += 4)
+	{
+		// load four quaternions of each side and turn them into x, y, z, w lanes
+		__m128 ax = _mm_loadu_ps(a[i].mQ);
+		__m128 ay = _mm_loadu_ps(a[i + 1].mQ);
+		__m128 az = _mm_loadu_ps(a[i + 2].mQ);
+		__m128 aw = _mm_loadu_ps(a[i + 3].mQ);
+		_MM_TRANSPOSE4_PS(ax, ay, az, aw);
+		__m128 bx = _mm_loadu_ps(b[i].mQ);
+		__m128 by = _mm_loadu_ps(b[i + 1].mQ);
+		__m128 bz = _mm_loadu_ps(b[i + 2].mQ);
+		__m128 bw = _mm_loadu_ps(b[i + 3].mQ);
+		_MM_TRANSPOSE4_PS(bx, by, bz, bw);
+		__m128 t = _mm_loadu_ps(u + i);
+
+		__m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)),
+							  _mm_add_ps(_mm_mul_ps(az, bz), _mm_mul_ps(aw, bw)));
+
+		// lerp, then normalize
+		__m128 rx = _mm_add_ps(ax, _mm_mul_ps(t, _mm_sub_ps(bx, ax)));
+		__m128 ry = _mm_add_ps(ay, _mm_mul_ps(t, _mm_sub_ps(by, ay)));
+		__m128 rz = _mm_add_ps(az, _mm_mul_ps(t, _mm_sub_ps(bz, az)));
+		__m128 rw = _mm_add_ps(aw, _mm_mul_ps(t, _mm_sub_ps(bw, aw)));
+		__m128 mag = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(rx, rx), _mm_mul_ps(ry, ry)),
+											_mm_add_ps(_mm_mul_ps(rz, rz), _mm_mul_ps(rw, rw))));
+		__m128 oomag = _mm_div_ps(one, mag);
+		rx = _mm_mul_ps(rx, oomag);
+		ry = _mm_mul_ps(ry, oomag);
+		rz = _mm_mul_ps(rz, oomag);
+		rw = _mm_mul_ps(rw, oomag);
+
+		// like nlerp(), quaternions in opposite hemispheres take the slerp
+		// path, done before storing in case out is a or b
+		const int flip = _mm_movemask_ps(_mm_cmplt_ps(d, zero));
+		LLQuaternion slerped[4];
+		for (U32 j = 0; j < 4; ++j)
+		{
+			if (flip & (1 << j))
+			{
+				slerped[j] = slerp(u[i + j], a[i + j], b[i + j]);
+			}
+		}
+
+		_MM_TRANSPOSE4_PS(rx, ry, rz, rw);
+		_mm_storeu_ps(out[i].mQ, rx);
+		_mm_storeu_ps(out[i + 1].mQ, ry);
+		_mm_storeu_ps(out[i + 2].mQ, rz);
+		_mm_storeu_ps(out[i + 3].mQ, rw);
+
+		for (U32 j = 0; flip && j < 4; ++j)
+		{
+			if (flip & (1 << j))
+			{
+				out[i + j] = slerped[j];
+			}
+		}
+	}
+#endif
+	for (; i < count; ++i)
+	{
+		out[i] = nlerp(u[i], a[i], b[i]);
+	}
+}
+
 LLQuaternion nlerp(F32 t, const LLQuaternion &q)
 {
 	if (q.mQ[VW] < 0.f)
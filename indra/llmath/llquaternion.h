@@ -159,6 +159,10 @@ public:
 	//static U32 mMultCount;
 };
 
+// out[i] = nlerp(u[i], a[i], b[i]) for count quaternions, four at a time
+// when LL_VECTORIZE is available. out may be a or b.
+void nlerp_batch(U32 count, const F32* u, const LLQuaternion* a, const LLQuaternion* b, LLQuaternion* out);
+
 // checker
 inline BOOL	LLQuaternion::isFinite() const
 {
@@ -51,6 +51,7 @@ public:
 	void				multiply(const LLVector3 &a, LLVector3& out) const;
 	void				multiply(const LLVector4 &a, LLV4Vector3& out) const;
 	void				multiply(const LLVector3 &a, LLV4Vector3& out) const;
+	void				multiply(const LLV4Vector3 &a, LLV4Vector3& out) const;
 
 	const LLV4Matrix3&	transpose();
 	const LLV4Matrix3&	operator=(const LLMatrix3& a);
@@ -103,6 +104,14 @@ inline void LLV4Matrix3::multiply(const LLVector3 &a, LLV4Vector3& o) const
 	o.v = _mm_add_ps(o.v  , _mm_mul_ps(_mm_set1_ps(a.mV[VZ]), mV[VZ]));
 }
 
+inline void LLV4Matrix3::multiply(const LLV4Vector3 &a, LLV4Vector3& o) const
+{
+	__m128 v = a.v;
+	o.v =					_mm_mul_ps(_mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 0, 0, 0)), mV[VX]); // ( ax * vx ) + ...
+	o.v = _mm_add_ps(o.v  , _mm_mul_ps(_mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1)), mV[VY]));
+	o.v = _mm_add_ps(o.v  , _mm_mul_ps(_mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2)), mV[VZ]));
+}
+
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
 // LLV4Matrix3
@@ -171,6 +180,11 @@ inline void LLV4Matrix3::multiply(const LLVector3 &a, LLV4Vector3& o) const
 					a.mV[VZ] * mMatrix[VZ][VZ]);
 }
 
+inline void LLV4Matrix3::multiply(const LLV4Vector3 &a, LLV4Vector3& o) const
+{
+	multiply(LLVector3(a.mV), o);
+}
+
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
 // LLV4Matrix3
@@ -50,6 +50,7 @@ public:
 	void				lerp(const LLV4Matrix4 &a, const LLV4Matrix4 &b, const F32 &w);
 	void				multiply(const LLVector3 &a, LLVector3& o) const;
 	void				multiply(const LLVector3 &a, LLV4Vector3& o) const;
+	void				multiply(const LLV4Vector3 &a, LLV4Vector3& o) const;
 
 	const LLV4Matrix4&	transpose();
 	const LLV4Matrix4&  translate(const LLVector3 &vec);
@@ -97,6 +98,14 @@ inline void LLV4Matrix4::multiply(const LLVector3 &a, LLV4Vector3& o) const
 	o.v = _mm_add_ps(o.v   , _mm_mul_ps(_mm_set1_ps(a.mV[VZ]), mV[VZ]));
 }
 
+inline void LLV4Matrix4::multiply(const LLV4Vector3 &a, LLV4Vector3& o) const
+{
+	__m128 v = a.v;
+	o.v = _mm_add_ps(mV[VW], _mm_mul_ps(_mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 0, 0, 0)), mV[VX])); // ( ax * vx ) + vw
+	o.v = _mm_add_ps(o.v   , _mm_mul_ps(_mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1)), mV[VY]));
+	o.v = _mm_add_ps(o.v   , _mm_mul_ps(_mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2)), mV[VZ]));
+}
+
 inline const LLV4Matrix4& LLV4Matrix4::translate(const LLV4Vector3 &vec)
 {
 	mV[VW] = _mm_add_ps(mV[VW], vec.v);
@@ -166,6 +175,11 @@ inline void LLV4Matrix4::multiply(const LLVector3 &a, LLV4Vector3& o) const
 					mMatrix[VW][VZ]);
 }
 
+inline void LLV4Matrix4::multiply(const LLV4Vector3 &a, LLV4Vector3& o) const
+{
+	multiply(LLVector3(a.mV), o);
+}
+
 inline const LLV4Matrix4& LLV4Matrix4::translate(const LLV4Vector3 &vec)
 {
 	mMatrix[3][0] += vec.mV[0];
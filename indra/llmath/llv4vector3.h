@@ -28,6 +28,8 @@
 #define LL_LLV4VECTOR3_H
 
 #include "llv4math.h"
+#include "llmath.h"			// for FP_MAG_THRESHOLD
+#include "v3math.h"
 
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
@@ -51,6 +53,8 @@ public:
 
 	void				setVec(F32 x, F32 y, F32 z);
 	void				setVec(F32 a);
+	void				setVec(const LLVector3& a);
+	void				normVec();
 }
 
 LL_LLV4MATH_ALIGN_POSTFIX;
@@ -77,4 +81,37 @@ inline void	LLV4Vector3::setVec(F32 a)
 #endif
 }
 
+inline void	LLV4Vector3::setVec(const LLVector3& a)
+{
+	setVec(a.mV[VX], a.mV[VY], a.mV[VZ]);
+}
+
+// Same results as LLVector3::normVec(), w is left undefined
+inline void	LLV4Vector3::normVec()
+{
+#if LL_VECTORIZE
+	__m128 sq = _mm_mul_ps(v, v);
+	__m128 mag = _mm_add_ss(_mm_add_ss(sq, _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(1, 1, 1, 1))),
+							_mm_shuffle_ps(sq, sq, _MM_SHUFFLE(2, 2, 2, 2)));		// x*x + y*y + z*z
+	mag = _mm_sqrt_ss(mag);
+	__m128 oomag = _mm_div_ss(_mm_set_ss(1.f), mag);
+	__m128 valid = _mm_cmpgt_ss(mag, _mm_set_ss(FP_MAG_THRESHOLD));
+	oomag = _mm_and_ps(oomag, valid);													// 0 for too short vectors
+	v = _mm_mul_ps(v, _mm_shuffle_ps(oomag, oomag, _MM_SHUFFLE(0, 0, 0, 0)));
+#else
+	F32 mag = fsqrtf(mV[VX]*mV[VX] + mV[VY]*mV[VY] + mV[VZ]*mV[VZ]);
+	if (mag > FP_MAG_THRESHOLD)
+	{
+		F32 oomag = 1.f/mag;
+		mV[VX] *= oomag;
+		mV[VY] *= oomag;
+		mV[VZ] *= oomag;
+	}
+	else
+	{
+		setVec(0.f, 0.f, 0.f);
+	}
+#endif
+}
+
 #endif
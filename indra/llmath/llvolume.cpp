@@ -37,6 +37,8 @@
 #include "v4math.h"
 #include "m4math.h"
 #include "m3math.h"
+#include "llv4matrix3.h"
+#include "llv4matrix4.h"
 #include "lldarray.h"
 #include "llvolume.h"
 #include "llstl.h"
@@ -1658,7 +1660,7 @@ LLProfile::~LLProfile()
 }
 
 
-S32 LLVolume::sNumMeshPoints = 0;
+LLAtomicS32 LLVolume::sNumMeshPoints(0);
 
 LLVolume::LLVolume(const LLVolumeParams &params, const F32 detail, const BOOL generate_single_face, const BOOL is_unique)
 	: mParams(params)
@@ -1666,6 +1668,7 @@ LLVolume::LLVolume(const LLVolumeParams &params, const F32 detail, const BOOL ge
 	LLMemType m1(LLMemType::MTYPE_VOLUME);
 	
 	mUnique = is_unique;
+	mPlaceholder = FALSE;
 	mFaceMask = 0x0;
 	mDetail = detail;
 	mSculptLevel = -2;
@@ -1690,6 +1693,15 @@ LLVolume::LLVolume(const LLVolumeParams &params, const F32 detail, const BOOL ge
 	}
 }
 
+// static
+LLVolume* LLVolume::createPlaceholder(const LLVolumeParams &params, const F32 detail)
+{
+	// a single face volume skips createVolumeFaces(), which is most of the work
+	LLVolume* volumep = new LLVolume(params, detail, TRUE);
+	volumep->mPlaceholder = TRUE;
+	return volumep;
+}
+
 void LLVolume::resizePath(S32 length)
 {
 	mPathp->resizePath(length);
@@ -3420,9 +3432,9 @@ void LLVolume::generateSilhouetteVertices(std::vector<LLVector3> &vertices,
 				S32 v3 = face.mIndices[j*3+2];
 
 				//get current face center
-				LLVector3 cCenter = (face.mVertices[v1].mPosition + 
-									face.mVertices[v2].mPosition + 
-									face.mVertices[v3].mPosition) / 3.0f;
+				LLVector3 cCenter = (face.getPosition(v1) + 
+									face.getPosition(v2) + 
+									face.getPosition(v3)) / 3.0f;
 
 				//for each edge
 				for (S32 k = 0; k < 3; k++) {
@@ -3440,9 +3452,9 @@ void LLVolume::generateSilhouetteVertices(std::vector<LLVector3> &vertices,
 					v3 = face.mIndices[nIndex*3+2];
 
 					//get neighbor face center
-					LLVector3 nCenter = (face.mVertices[v1].mPosition + 
-									face.mVertices[v2].mPosition + 
-									face.mVertices[v3].mPosition) / 3.0f;
+					LLVector3 nCenter = (face.getPosition(v1) + 
+									face.getPosition(v2) + 
+									face.getPosition(v3)) / 3.0f;
 
 					//draw line
 					vertices.push_back(cCenter);
@@ -3465,15 +3477,15 @@ void LLVolume::generateSilhouetteVertices(std::vector<LLVector3> &vertices,
 #elif DEBUG_SILHOUETTE_NORMALS
 
 			//for each vertex
-			for (U32 j = 0; j < face.mVertices.size(); j++) {
-				vertices.push_back(face.mVertices[j].mPosition);
-				vertices.push_back(face.mVertices[j].mPosition + face.mVertices[j].mNormal*0.1f);
+			for (S32 j = 0; j < face.getNumVertices(); j++) {
+				vertices.push_back(face.getPosition(j));
+				vertices.push_back(face.getPosition(j) + face.getNormal(j)*0.1f);
 				normals.push_back(LLVector3(0,0,1));
 				normals.push_back(LLVector3(0,0,1));
 				segments.push_back(vertices.size());
 #if DEBUG_SILHOUETTE_BINORMALS
-				vertices.push_back(face.mVertices[j].mPosition);
-				vertices.push_back(face.mVertices[j].mPosition + face.mVertices[j].mBinormal*0.1f);
+				vertices.push_back(face.getPosition(j));
+				vertices.push_back(face.getPosition(j) + face.getBinormal(j)*0.1f);
 				normals.push_back(LLVector3(0,0,1));
 				normals.push_back(LLVector3(0,0,1));
 				segments.push_back(vertices.size());
@@ -3499,8 +3511,8 @@ void LLVolume::generateSilhouetteVertices(std::vector<LLVector3> &vertices,
 				S32 v2 = face.mIndices[j*3+1];
 				S32 v3 = face.mIndices[j*3+2];
 
-				LLVector3 norm = (face.mVertices[v1].mPosition - face.mVertices[v2].mPosition) % 
-					(face.mVertices[v2].mPosition - face.mVertices[v3].mPosition);
+				LLVector3 norm = (face.getPosition(v1) - face.getPosition(v2)) % 
+					(face.getPosition(v2) - face.getPosition(v3));
 				
 				if (norm.magVecSquared() < 0.00000001f) 
 				{
@@ -3509,7 +3521,7 @@ void LLVolume::generateSilhouetteVertices(std::vector<LLVector3> &vertices,
 				else 
 				{
 					//get view vector
-					LLVector3 view = (obj_cam_vec-face.mVertices[v1].mPosition);
+					LLVector3 view = (obj_cam_vec-face.getPosition(v1));
 					bool away = view * norm > 0.0f; 
 					if (away) 
 					{
@@ -3556,13 +3568,13 @@ void LLVolume::generateSilhouetteVertices(std::vector<LLVector3> &vertices,
 						S32 v1 = face.mIndices[j*3+k];
 						S32 v2 = face.mIndices[j*3+((k+1)%3)];
 						
-						vertices.push_back(face.mVertices[v1].mPosition*mat);
-						LLVector3 norm1 = face.mVertices[v1].mNormal * norm_mat;
+						vertices.push_back(face.getPosition(v1)*mat);
+						LLVector3 norm1 = face.getNormal(v1) * norm_mat;
 						norm1.normVec();
 						normals.push_back(norm1);
 
-						vertices.push_back(face.mVertices[v2].mPosition*mat);
-						LLVector3 norm2 = face.mVertices[v2].mNormal * norm_mat;
+						vertices.push_back(face.getPosition(v2)*mat);
+						LLVector3 norm2 = face.getNormal(v2) * norm_mat;
 						norm2.normVec();
 						normals.push_back(norm2);
 
@@ -3621,9 +3633,9 @@ S32 LLVolume::lineSegmentIntersect(const LLVector3& start, const LLVector3& end,
 
 				F32 a, b, t;
 			
-				if (LLTriangleRayIntersect(face.mVertices[index1].mPosition,
-										   face.mVertices[index2].mPosition,
-										   face.mVertices[index3].mPosition,
+				if (LLTriangleRayIntersect(face.getPosition(index1),
+										   face.getPosition(index2),
+										   face.getPosition(index3),
 										   start, dir, &a, &b, &t, FALSE))
 				{
 					if ((t >= 0.f) &&      // if hit is after start
@@ -3640,24 +3652,24 @@ S32 LLVolume::lineSegmentIntersect(const LLVector3& start, const LLVector3& end,
 			
 						if (tex_coord != NULL)
 			{
-							*tex_coord = ((1.f - a - b)  * face.mVertices[index1].mTexCoord +
-										  a              * face.mVertices[index2].mTexCoord +
-										  b              * face.mVertices[index3].mTexCoord);
+							*tex_coord = ((1.f - a - b)  * face.mTexCoords[index1] +
+										  a              * face.mTexCoords[index2] +
+										  b              * face.mTexCoords[index3]);
 
 						}
 
 						if (normal != NULL)
 				{
-							*normal    = ((1.f - a - b)  * face.mVertices[index1].mNormal + 
-										  a              * face.mVertices[index2].mNormal +
-										  b              * face.mVertices[index3].mNormal);
+							*normal    = ((1.f - a - b)  * face.getNormal(index1) + 
+										  a              * face.getNormal(index2) +
+										  b              * face.getNormal(index3));
 						}
 
 						if (bi_normal != NULL)
 					{
-							*bi_normal = ((1.f - a - b)  * face.mVertices[index1].mBinormal + 
-										  a              * face.mVertices[index2].mBinormal +
-										  b              * face.mVertices[index3].mBinormal);
+							*bi_normal = ((1.f - a - b)  * face.getBinormal(index1) + 
+										  a              * face.getBinormal(index2) +
+										  b              * face.getBinormal(index3));
 						}
 
 					}
@@ -4495,10 +4507,10 @@ BOOL LLVolumeFace::createUnCutCubeCap(LLVolume* volume, BOOL partial_build)
 
 	if (partial_build)
 	{
-		mVertices.clear();
+		clearVertices();
 	}
 
-	S32	vtop = mVertices.size();
+	S32	vtop = getNumVertices();
 	for(int gx = 0;gx<grid_size+1;gx++){
 		for(int gy = 0;gy<grid_size+1;gy++){
 			VertexData newVert;
@@ -4509,7 +4521,7 @@ BOOL LLVolumeFace::createUnCutCubeCap(LLVolume* volume, BOOL partial_build)
 				newVert,
 				(F32)gx/(F32)grid_size,
 				(F32)gy/(F32)grid_size);
-			mVertices.push_back(newVert);
+			pushVertex(newVert);
 
 			if (gx == 0 && gy == 0)
 			{
@@ -4623,7 +4635,7 @@ BOOL LLVolumeFace::createCap(LLVolume* volume, BOOL partial_build)
 	num_vertices = profile.size();
 	num_indices = (profile.size() - 2)*3;
 
-	mVertices.resize(num_vertices);
+	resizeVertices(num_vertices);
 
 	if (!partial_build)
 	{
@@ -4657,47 +4669,47 @@ BOOL LLVolumeFace::createCap(LLVolume* volume, BOOL partial_build)
 	// Copy the vertices into the array
 	for (S32 i = 0; i < num_vertices; i++)
 	{
+		LLVector2& tc = mTexCoords[i];
 		if (mTypeMask & TOP_MASK)
 		{
-			mVertices[i].mTexCoord.mV[0] = profile[i].mV[0]+0.5f;
-			mVertices[i].mTexCoord.mV[1] = profile[i].mV[1]+0.5f;
+			tc.mV[0] = profile[i].mV[0]+0.5f;
+			tc.mV[1] = profile[i].mV[1]+0.5f;
 		}
 		else
 		{
 			// Mirror for underside.
-			mVertices[i].mTexCoord.mV[0] = profile[i].mV[0]+0.5f;
-			mVertices[i].mTexCoord.mV[1] = 0.5f - profile[i].mV[1];
+			tc.mV[0] = profile[i].mV[0]+0.5f;
+			tc.mV[1] = 0.5f - profile[i].mV[1];
 		}
 
-		mVertices[i].mPosition = mesh[i + offset].mPos;
+		setPosition(i, mesh[i + offset].mPos);
 		
 		if (i == 0)
 		{
-			min = max = mVertices[i].mPosition;
-			min_uv = max_uv = mVertices[i].mTexCoord;
+			min_uv = max_uv = tc;
 		}
 		else
 		{
-			update_min_max(min,max, mVertices[i].mPosition);
-			update_min_max(min_uv, max_uv, mVertices[i].mTexCoord);
+			update_min_max(min_uv, max_uv, tc);
 		}
 	}
 
+	updateExtents();
 	mCenter = (min+max)*0.5f;
 	cuv = (min_uv + max_uv)*0.5f;
 
 	LLVector3 binormal = calc_binormal_from_triangle( 
 		mCenter, cuv,
-		mVertices[0].mPosition, mVertices[0].mTexCoord,
-		mVertices[1].mPosition, mVertices[1].mTexCoord);
+		getPosition(0), mTexCoords[0],
+		getPosition(1), mTexCoords[1]);
 	binormal.normVec();
 
 	LLVector3 d0;
 	LLVector3 d1;
 	LLVector3 normal;
 
-	d0 = mCenter-mVertices[0].mPosition;
-	d1 = mCenter-mVertices[1].mPosition;
+	d0 = mCenter-getPosition(0);
+	d1 = mCenter-getPosition(1);
 
 	normal = (mTypeMask & TOP_MASK) ? (d0%d1) : (d1%d0);
 	normal.normVec();
@@ -4710,7 +4722,7 @@ BOOL LLVolumeFace::createCap(LLVolume* volume, BOOL partial_build)
 	
 	if (!(mTypeMask & HOLLOW_MASK) && !(mTypeMask & OPEN_MASK))
 	{
-		mVertices.push_back(vd);
+		pushVertex(vd);
 		num_vertices++;
 		if (!partial_build)
 		{
@@ -4721,8 +4733,8 @@ BOOL LLVolumeFace::createCap(LLVolume* volume, BOOL partial_build)
 	
 	for (S32 i = 0; i < num_vertices; i++)
 	{
-		mVertices[i].mBinormal = binormal;
-		mVertices[i].mNormal = normal;
+		setBinormal(i, binormal);
+		setNormal(i, normal);
 	}
 
 	mHasBinormals = TRUE;
@@ -5046,6 +5058,111 @@ void LLVolumeFace::makeTriStrip()
 #endif
 }
 
+inline void add_vec(LLV4Vector3& a, const LLVector3& b)
+{
+	a.mV[VX] += b.mV[VX];
+	a.mV[VY] += b.mV[VY];
+	a.mV[VZ] += b.mV[VZ];
+}
+
+void LLVolumeFace::resizeVertices(S32 num_vertices)
+{
+	mPositions.resize(num_vertices);
+	mNormals.resize(num_vertices);
+	mBinormals.resize(num_vertices);
+	mTexCoords.resize(num_vertices);
+}
+
+void LLVolumeFace::pushVertex(const VertexData& vertex)
+{
+	S32 i = getNumVertices();
+	resizeVertices(i + 1);
+	setPosition(i, vertex.mPosition);
+	setNormal(i, vertex.mNormal);
+	setBinormal(i, vertex.mBinormal);
+	mTexCoords[i] = vertex.mTexCoord;
+}
+
+void LLVolumeFace::clearVertices()
+{
+	mPositions.clear();
+	mNormals.clear();
+	mBinormals.clear();
+	mTexCoords.clear();
+}
+
+void LLVolumeFace::updateExtents()
+{
+	S32 num_vertices = getNumVertices();
+	if (num_vertices == 0)
+	{
+		mExtents[0].clearVec();
+		mExtents[1].clearVec();
+		return;
+	}
+
+	const LLV4Vector3* positions = mPositions.getData();
+#if LL_VECTORIZE
+	__m128 min = positions[0].v;
+	__m128 max = min;
+	for (S32 i = 1; i < num_vertices; ++i)
+	{
+		min = _mm_min_ps(min, positions[i].v);
+		max = _mm_max_ps(max, positions[i].v);
+	}
+	LLV4Vector3 bound;
+	bound.v = min;
+	mExtents[0].setVec(bound.mV);
+	bound.v = max;
+	mExtents[1].setVec(bound.mV);
+#else
+	mExtents[0] = mExtents[1] = getPosition(0);
+	for (S32 i = 1; i < num_vertices; ++i)
+	{
+		update_min_max(mExtents[0], mExtents[1], LLVector3(positions[i].mV));
+	}
+#endif
+}
+
+void LLVolumeFace::transformPositions(const LLMatrix4& mat, LLStrider<LLVector3>& dst) const
+{
+	LLV4Matrix4 v4mat;
+	v4mat = mat;
+
+	const LLV4Vector3* positions = mPositions.getData();
+	LLV4Vector3 result;
+	for (S32 i = 0, end = getNumVertices(); i < end; ++i)
+	{
+		v4mat.multiply(positions[i], result);
+		(dst++)->setVec(result.mV);
+	}
+}
+
+static void transform_normals(const LLAlignedArray<LLV4Vector3>& src, const LLMatrix3& mat, LLStrider<LLVector3>& dst)
+{
+	LLV4Matrix3 v4mat;
+	v4mat = mat;
+
+	const LLV4Vector3* normals = src.getData();
+	LLV4Vector3 result;
+	for (S32 i = 0, end = (S32)src.size(); i < end; ++i)
+	{
+		v4mat.multiply(normals[i], result);
+		result.normVec();
+		(dst++)->setVec(result.mV);
+	}
+}
+
+void LLVolumeFace::transformNormals(const LLMatrix3& mat, LLStrider<LLVector3>& dst) const
+{
+	transform_normals(mNormals, mat, dst);
+}
+
+void LLVolumeFace::transformBinormals(const LLMatrix3& mat, LLStrider<LLVector3>& dst) const
+{
+	transform_normals(mBinormals, mat, dst);
+}
+
 void LLVolumeFace::createBinormals()
 {
 	LLMemType m1(LLMemType::MTYPE_VOLUME);
@@ -5055,36 +5172,35 @@ void LLVolumeFace::createBinormals()
 		//generate binormals
 		for (U32 i = 0; i < mIndices.size()/3; i++) 
 		{	//for each triangle
-			const VertexData& v0 = mVertices[mIndices[i*3+0]];
-			const VertexData& v1 = mVertices[mIndices[i*3+1]];
-			const VertexData& v2 = mVertices[mIndices[i*3+2]];
+			const U16* idx = &(mIndices[i*3]);
 						
 			//calculate binormal
-			LLVector3 binorm = calc_binormal_from_triangle(v0.mPosition, v0.mTexCoord,
-															v1.mPosition, v1.mTexCoord,
-															v2.mPosition, v2.mTexCoord);
+			LLVector3 binorm = calc_binormal_from_triangle(getPosition(idx[0]), mTexCoords[idx[0]],
+															getPosition(idx[1]), mTexCoords[idx[1]],
+															getPosition(idx[2]), mTexCoords[idx[2]]);
 
 			for (U32 j = 0; j < 3; j++) 
 			{ //add triangle normal to vertices
-				mVertices[mIndices[i*3+j]].mBinormal += binorm; // * (weight_sum - d[j])/weight_sum;
+				add_vec(mBinormals[idx[j]], binorm); // * (weight_sum - d[j])/weight_sum;
 			}
 
 			//even out quad contributions
 			if (i % 2 == 0) 
 			{
-				mVertices[mIndices[i*3+2]].mBinormal += binorm;
+				add_vec(mBinormals[idx[2]], binorm);
 			}
 			else 
 			{
-				mVertices[mIndices[i*3+1]].mBinormal += binorm;
+				add_vec(mBinormals[idx[1]], binorm);
 			}
 		}
 
 		//normalize binormals
-		for (U32 i = 0; i < mVertices.size(); i++) 
+		S32 num_vertices = getNumVertices();
+		LLV4Vector3* binormals = mBinormals.getData();
+		for (S32 i = 0; i < num_vertices; i++) 
 		{
-			mVertices[i].mBinormal.normVec();
-			mVertices[i].mNormal.normVec();
+			binormals[i].normVec();
 		}
 
 		mHasBinormals = TRUE;
@@ -5117,7 +5233,7 @@ BOOL LLVolumeFace::createSide(LLVolume* volume, BOOL partial_build)
 	num_vertices = mNumS*mNumT;
 	num_indices = (mNumS-1)*(mNumT-1)*6;
 
-	mVertices.resize(num_vertices);
+	resizeVertices(num_vertices);
 
 	if (!partial_build)
 	{
@@ -5179,21 +5295,21 @@ BOOL LLVolumeFace::createSide(LLVolume* volume, BOOL partial_build)
 				i = mBeginS + s + max_s*t;
 			}
 
-			mVertices[cur_vertex].mPosition = mesh[i].mPos;
-			mVertices[cur_vertex].mTexCoord = LLVector2(ss,tt);
+			setPosition(cur_vertex, mesh[i].mPos);
+			mTexCoords[cur_vertex] = LLVector2(ss,tt);
 		
-			mVertices[cur_vertex].mNormal = LLVector3(0,0,0);
-			mVertices[cur_vertex].mBinormal = LLVector3(0,0,0);
+			mNormals[cur_vertex].setVec(0.f);
+			mBinormals[cur_vertex].setVec(0.f);
 
 			cur_vertex++;
 
 			if ((mTypeMask & INNER_MASK) && (mTypeMask & FLAT_MASK) && mNumS > 2 && s > 0)
 			{
-				mVertices[cur_vertex].mPosition = mesh[i].mPos;
-				mVertices[cur_vertex].mTexCoord = LLVector2(ss,tt);
+				setPosition(cur_vertex, mesh[i].mPos);
+				mTexCoords[cur_vertex] = LLVector2(ss,tt);
 			
-				mVertices[cur_vertex].mNormal = LLVector3(0,0,0);
-				mVertices[cur_vertex].mBinormal = LLVector3(0,0,0);
+				mNormals[cur_vertex].setVec(0.f);
+				mBinormals[cur_vertex].setVec(0.f);
 				cur_vertex++;
 			}
 		}
@@ -5211,11 +5327,11 @@ BOOL LLVolumeFace::createSide(LLVolume* volume, BOOL partial_build)
 
 			i = mBeginS + s + max_s*t;
 			ss = profile[mBeginS + s].mV[2] - begin_stex;
-			mVertices[cur_vertex].mPosition = mesh[i].mPos;
-			mVertices[cur_vertex].mTexCoord = LLVector2(ss,tt);
+			setPosition(cur_vertex, mesh[i].mPos);
+			mTexCoords[cur_vertex] = LLVector2(ss,tt);
 		
-			mVertices[cur_vertex].mNormal = LLVector3(0,0,0);
-			mVertices[cur_vertex].mBinormal = LLVector3(0,0,0);
+			mNormals[cur_vertex].setVec(0.f);
+			mBinormals[cur_vertex].setVec(0.f);
 
 			cur_vertex++;
 		}
@@ -5227,12 +5343,7 @@ BOOL LLVolumeFace::createSide(LLVolume* volume, BOOL partial_build)
 	LLVector3& face_max = mExtents[1];
 	mCenter.clearVec();
 
-	face_min = face_max = mVertices[0].mPosition;
-	for (U32 i = 1; i < mVertices.size(); ++i)
-	{
-		update_min_max(face_min, face_max, mVertices[i].mPosition);
-	}
-
+	updateExtents();
 	mCenter = (face_min + face_max) * 0.5f;
 
 	S32 cur_index = 0;
@@ -5331,33 +5442,32 @@ BOOL LLVolumeFace::createSide(LLVolume* volume, BOOL partial_build)
 	{
 		const U16* idx = &(mIndices[i*3]);
 			
-		VertexData* v[] = 
-		{	&mVertices[idx[0]], &mVertices[idx[1]], &mVertices[idx[2]] };
+		LLVector3 v0 = getPosition(idx[0]);
 					
 		//calculate triangle normal
-		LLVector3 norm = (v[0]->mPosition-v[1]->mPosition) % (v[0]->mPosition-v[2]->mPosition);
+		LLVector3 norm = (v0-getPosition(idx[1])) % (v0-getPosition(idx[2]));
 
-		v[0]->mNormal += norm;
-		v[1]->mNormal += norm;
-		v[2]->mNormal += norm;
+		add_vec(mNormals[idx[0]], norm);
+		add_vec(mNormals[idx[1]], norm);
+		add_vec(mNormals[idx[2]], norm);
 
 		//even out quad contributions
-		v[i%2+1]->mNormal += norm;
+		add_vec(mNormals[idx[i%2+1]], norm);
 	}
 	
 	// adjust normals based on wrapping and stitching
 	
-	BOOL s_bottom_converges = ((mVertices[0].mPosition - mVertices[mNumS*(mNumT-2)].mPosition).magVecSquared() < 0.000001f);
-	BOOL s_top_converges = ((mVertices[mNumS-1].mPosition - mVertices[mNumS*(mNumT-2)+mNumS-1].mPosition).magVecSquared() < 0.000001f);
+	BOOL s_bottom_converges = ((getPosition(0) - getPosition(mNumS*(mNumT-2))).magVecSquared() < 0.000001f);
+	BOOL s_top_converges = ((getPosition(mNumS-1) - getPosition(mNumS*(mNumT-2)+mNumS-1)).magVecSquared() < 0.000001f);
 	if (sculpt_stitching == LL_SCULPT_TYPE_NONE)  // logic for non-sculpt volumes
 	{
 		if (volume->getPath().isOpen() == FALSE)
 		{ //wrap normals on T
 			for (S32 i = 0; i < mNumS; i++)
 			{
-				LLVector3 norm = mVertices[i].mNormal + mVertices[mNumS*(mNumT-1)+i].mNormal;
-				mVertices[i].mNormal = norm;
-				mVertices[mNumS*(mNumT-1)+i].mNormal = norm;
+				LLVector3 norm = getNormal(i) + getNormal(mNumS*(mNumT-1)+i);
+				setNormal(i, norm);
+				setNormal(mNumS*(mNumT-1)+i, norm);
 			}
 		}
 
@@ -5365,9 +5475,9 @@ BOOL LLVolumeFace::createSide(LLVolume* volume, BOOL partial_build)
 		{ //wrap normals on S
 			for (S32 i = 0; i < mNumT; i++)
 			{
-				LLVector3 norm = mVertices[mNumS*i].mNormal + mVertices[mNumS*i+mNumS-1].mNormal;
-				mVertices[mNumS * i].mNormal = norm;
-				mVertices[mNumS * i+mNumS-1].mNormal = norm;
+				LLVector3 norm = getNormal(mNumS*i) + getNormal(mNumS*i+mNumS-1);
+				setNormal(mNumS * i, norm);
+				setNormal(mNumS * i+mNumS-1, norm);
 			}
 		}
 	
@@ -5378,7 +5488,7 @@ BOOL LLVolumeFace::createSide(LLVolume* volume, BOOL partial_build)
 			{ //all lower S have same normal
 				for (S32 i = 0; i < mNumT; i++)
 				{
-					mVertices[mNumS*i].mNormal = LLVector3(1,0,0);
+					setNormal(mNumS*i, LLVector3(1,0,0));
 				}
 			}
 
@@ -5386,7 +5496,7 @@ BOOL LLVolumeFace::createSide(LLVolume* volume, BOOL partial_build)
 			{ //all upper S have same normal
 				for (S32 i = 0; i < mNumT; i++)
 				{
-					mVertices[mNumS*i+mNumS-1].mNormal = LLVector3(-1,0,0);
+					setNormal(mNumS*i+mNumS-1, LLVector3(-1,0,0));
 				}
 			}
 		}
@@ -5417,13 +5527,13 @@ BOOL LLVolumeFace::createSide(LLVolume* volume, BOOL partial_build)
 			LLVector3 average(0.0, 0.0, 0.0);
 			for (S32 i = 0; i < mNumS; i++)
 			{
-				average += mVertices[i].mNormal;
+				average += getNormal(i);
 			}
 
 			// set average
 			for (S32 i = 0; i < mNumS; i++)
 			{
-				mVertices[i].mNormal = average;
+				setNormal(i, average);
 			}
 
 			// average normals for south pole
@@ -5431,13 +5541,13 @@ BOOL LLVolumeFace::createSide(LLVolume* volume, BOOL partial_build)
 			average = LLVector3(0.0, 0.0, 0.0);
 			for (S32 i = 0; i < mNumS; i++)
 			{
-				average += mVertices[i + mNumS * (mNumT - 1)].mNormal;
+				average += getNormal(i + mNumS * (mNumT - 1));
 			}
 
 			// set average
 			for (S32 i = 0; i < mNumS; i++)
 			{
-				mVertices[i + mNumS * (mNumT - 1)].mNormal = average;
+				setNormal(i + mNumS * (mNumT - 1), average);
 			}
 
 		}
@@ -5447,9 +5557,9 @@ BOOL LLVolumeFace::createSide(LLVolume* volume, BOOL partial_build)
 		{
 			for (S32 i = 0; i < mNumT; i++)
 			{
-				LLVector3 norm = mVertices[mNumS*i].mNormal + mVertices[mNumS*i+mNumS-1].mNormal;
-				mVertices[mNumS * i].mNormal = norm;
-				mVertices[mNumS * i+mNumS-1].mNormal = norm;
+				LLVector3 norm = getNormal(mNumS*i) + getNormal(mNumS*i+mNumS-1);
+				setNormal(mNumS * i, norm);
+				setNormal(mNumS * i+mNumS-1, norm);
 			}
 		}
 
@@ -5459,15 +5569,23 @@ BOOL LLVolumeFace::createSide(LLVolume* volume, BOOL partial_build)
 		{
 			for (S32 i = 0; i < mNumS; i++)
 			{
-				LLVector3 norm = mVertices[i].mNormal + mVertices[mNumS*(mNumT-1)+i].mNormal;
-				mVertices[i].mNormal = norm;
-				mVertices[mNumS*(mNumT-1)+i].mNormal = norm;
+				LLVector3 norm = getNormal(i) + getNormal(mNumS*(mNumT-1)+i);
+				setNormal(i, norm);
+				setNormal(mNumS*(mNumT-1)+i, norm);
 			}
 			
 		}
 
 	}
 
+	// Normalized here rather than in createBinormals(), which may run on
+	// the main thread while a geometry fill thread reads these normals.
+	LLV4Vector3* normals = mNormals.getData();
+	for (S32 i = 0; i < num_vertices; i++)
+	{
+		normals[i].normVec();
+	}
+
 	return TRUE;
 }
 
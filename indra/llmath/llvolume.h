@@ -36,7 +36,11 @@ class LLProfile;
 class LLPath;
 class LLVolumeFace;
 class LLVolume;
+class LLMatrix3;
+class LLMatrix4;
 
+#include "llalignedarray.h"
+#include "llapr.h"
 #include "lldarray.h"
 #include "lluuid.h"
 #include "v4color.h"
@@ -45,6 +49,7 @@ class LLVolume;
 #include "v3math.h"
 #include "llquaternion.h"
 #include "llstrider.h"
+#include "llv4vector3.h"
 #include "v4coloru.h"
 #include "llrefcount.h"
 #include "llfile.h"
@@ -803,6 +808,27 @@ public:
 		LLVector2 mTexCoord;
 	};
 
+	S32 getNumVertices() const									{ return (S32)mPositions.size(); }
+	void resizeVertices(S32 num_vertices);	// new vertices are all zero
+	void pushVertex(const VertexData& vertex);
+	void clearVertices();
+
+	LLVector3 getPosition(S32 i) const							{ return LLVector3(mPositions[i].mV); }
+	LLVector3 getNormal(S32 i) const							{ return LLVector3(mNormals[i].mV); }
+	LLVector3 getBinormal(S32 i) const							{ return LLVector3(mBinormals[i].mV); }
+	void setPosition(S32 i, const LLVector3& position)			{ mPositions[i].setVec(position); }
+	void setNormal(S32 i, const LLVector3& normal)				{ mNormals[i].setVec(normal); }
+	void setBinormal(S32 i, const LLVector3& binormal)			{ mBinormals[i].setVec(binormal); }
+
+	// Sets mExtents to the bounds of every position
+	void updateExtents();
+
+	// Fill vertex buffers a stream at a time, each call advances dst past
+	// the face's vertices. Normals and binormals come out normalized.
+	void transformPositions(const LLMatrix4& mat, LLStrider<LLVector3>& dst) const;
+	void transformNormals(const LLMatrix3& mat, LLStrider<LLVector3>& dst) const;
+	void transformBinormals(const LLMatrix3& mat, LLStrider<LLVector3>& dst) const;
+
 	enum
 	{
 		SINGLE_MASK =	0x0001,
@@ -832,7 +858,13 @@ public:
 
 	LLVector3 mExtents[2]; //minimum and maximum point of face
 
-	std::vector<VertexData> mVertices;
+	// One entry per vertex in each stream. Positions, normals and binormals
+	// are padded to four floats and 16 byte aligned for the SIMD code paths,
+	// w is undefined.
+	LLAlignedArray<LLV4Vector3> mPositions;
+	LLAlignedArray<LLV4Vector3> mNormals;
+	LLAlignedArray<LLV4Vector3> mBinormals;
+	std::vector<LLVector2> mTexCoords;
 	std::vector<U16>	mIndices;
 	std::vector<U16>	mTriStrip;
 	std::vector<S32>	mEdge;
@@ -867,6 +899,11 @@ public:
 	};
 
 	LLVolume(const LLVolumeParams &params, const F32 detail, const BOOL generate_single_face = FALSE, const BOOL is_unique = FALSE);
+
+	// A stand-in for a volume which is still being built elsewhere. It has
+	// the profile, path and mesh of params but no volume faces, so it draws
+	// nothing, see LLVolumeMgr::refVolumeOrPlaceholder().
+	static LLVolume* createPlaceholder(const LLVolumeParams &params, const F32 detail);
 	
 	U8 getProfileType()	const								{ return mParams.getProfileParams().getCurveType(); }
 	U8 getPathType() const									{ return mParams.getPathParams().getCurveType(); }
@@ -890,6 +927,7 @@ public:
 	BOOL isCap(S32 face);
 	BOOL isFlat(S32 face);
 	BOOL isUnique() const									{ return mUnique; }
+	BOOL isPlaceholder() const								{ return mPlaceholder; }
 
 	S32 getSculptLevel() const                              { return mSculptLevel; }
 	
@@ -931,7 +969,7 @@ public:
 	LLFaceID generateFaceMask();
 
 	BOOL isFaceMaskValid(LLFaceID face_mask);
-	static S32 sNumMeshPoints;
+	static LLAtomicS32 sNumMeshPoints; // volumes are built on LLVolumeBuildThread too
 
 	friend std::ostream& operator<<(std::ostream &s, const LLVolume &volume);
 	friend std::ostream& operator<<(std::ostream &s, const LLVolume *volumep);		// HACK to bypass Windoze confusion over 
@@ -955,6 +993,7 @@ protected:
 
  protected:
 	BOOL mUnique;
+	BOOL mPlaceholder;
 	F32 mDetail;
 	S32 mSculptLevel;
 	
@@ -45,7 +45,8 @@ F32 LLVolumeLODGroup::mDetailScales[NUM_LODS] = {1.f, 1.5f, 2.5f, 4.f};
 //============================================================================
 
 LLVolumeMgr::LLVolumeMgr()
-:	mDataMutex(NULL)
+:	mDataMutex(NULL),
+	mBuildThread(NULL)
 {
 	// the LLMutex magic interferes with easy unit testing,
 	// so you now must manually call useMutex() to use it
@@ -62,6 +63,8 @@ LLVolumeMgr::~LLVolumeMgr()
 
 BOOL LLVolumeMgr::cleanup()
 {
+	shutdownBuildThread();
+
 	BOOL no_refs = TRUE;
 	if (mDataMutex)
 	{
@@ -113,6 +116,47 @@ LLVolume* LLVolumeMgr::refVolume(const LLVolumeParams &volume_params, const S32
 	return volgroupp->refLOD(detail);
 }
 
+// MAIN THREAD
+LLVolume* LLVolumeMgr::refVolumeOrPlaceholder(const LLVolumeParams& volume_params, const S32 detail)
+{
+	if (!mBuildThread
+		|| volume_params.getSculptID().notNull()
+		|| volume_params.getSculptType() != LL_SCULPT_TYPE_NONE)
+	{
+		return refVolume(volume_params, detail);
+	}
+
+	LLVolume* volumep;
+	if (mDataMutex)
+	{
+		mDataMutex->lock();
+	}
+	LLVolumeLODGroup* volgroupp;
+	volume_lod_group_map_t::iterator iter = mVolumeLODGroups.find(&volume_params);
+	if (iter == mVolumeLODGroups.end())
+	{
+		volgroupp = createNewGroup(volume_params);
+	}
+	else
+	{
+		volgroupp = iter->second;
+	}
+	if (volgroupp->hasLOD(detail))
+	{
+		volumep = volgroupp->refLOD(detail);
+	}
+	else
+	{
+		queueBuild(volgroupp, detail);
+		volumep = volgroupp->refPlaceholder(detail);
+	}
+	if (mDataMutex)
+	{
+		mDataMutex->unlock();
+	}
+	return volumep;
+}
+
 // virtual
 LLVolumeLODGroup* LLVolumeMgr::getGroup( const LLVolumeParams& volume_params ) const
 {
@@ -179,6 +223,18 @@ void LLVolumeMgr::insertGroup(LLVolumeLODGroup* volgroup)
 	mVolumeLODGroups[volgroup->getVolumeParams()] = volgroup;
 }
 
+// protected
+void LLVolumeMgr::queueBuild(LLVolumeLODGroup* volgroupp, const S32 detail)
+{
+	if (volgroupp->getBuildHandle(detail) == LLQueuedThread::nullHandle())
+	{
+		LLQueuedThread::handle_t handle = mBuildThread->buildVolume(*volgroupp->getVolumeParams(), detail,
+																	 LLQueuedThread::PRIORITY_NORMAL);
+		volgroupp->setBuildHandle(detail, handle);
+		mPendingBuilds.push_back(handle);
+	}
+}
+
 // protected
 LLVolumeLODGroup* LLVolumeMgr::createNewGroup(const LLVolumeParams& volume_params)
 {
@@ -220,6 +276,129 @@ void LLVolumeMgr::useMutex()
 	}
 }
 
+void LLVolumeMgr::startBuildThread(bool threaded, U32 concurrency)
+{
+	if (!mBuildThread)
+	{
+		// Only the main thread touches the LOD groups, but keep refVolume()
+		// and friends honest for anyone else using the manager.
+		useMutex();
+		mBuildThread = new LLVolumeBuildThread(threaded, llmax(concurrency, 1U));
+	}
+}
+
+void LLVolumeMgr::shutdownBuildThread()
+{
+	if (!mBuildThread)
+	{
+		return;
+	}
+	mBuildThread->shutdown();
+	delete mBuildThread;
+	mBuildThread = NULL;
+	mPendingBuilds.clear();
+
+	if (mDataMutex)
+	{
+		mDataMutex->lock();
+	}
+	for (volume_lod_group_map_t::iterator iter = mVolumeLODGroups.begin();
+		 iter != mVolumeLODGroups.end(); ++iter)
+	{
+		for (S32 i = 0; i < LLVolumeLODGroup::NUM_LODS; i++)
+		{
+			iter->second->setBuildHandle(i, LLQueuedThread::nullHandle());
+		}
+	}
+	if (mDataMutex)
+	{
+		mDataMutex->unlock();
+	}
+}
+
+// MAIN THREAD
+BOOL LLVolumeMgr::prepareVolume(const LLVolumeParams& volume_params, const S32 detail)
+{
+	if (!mBuildThread
+		|| volume_params.getSculptID().notNull()
+		|| volume_params.getSculptType() != LL_SCULPT_TYPE_NONE)
+	{
+		return TRUE;
+	}
+
+	BOOL ready = TRUE;
+	if (mDataMutex)
+	{
+		mDataMutex->lock();
+	}
+	volume_lod_group_map_t::iterator iter = mVolumeLODGroups.find(&volume_params);
+	// Nobody is drawing these parameters yet so there is nothing to show in
+	// the meantime, refVolume() has to build it.
+	if (iter != mVolumeLODGroups.end() && !iter->second->hasLOD(detail))
+	{
+		queueBuild(iter->second, detail);
+		ready = FALSE;
+	}
+	if (mDataMutex)
+	{
+		mDataMutex->unlock();
+	}
+	return ready;
+}
+
+// MAIN THREAD
+S32 LLVolumeMgr::update(U32 max_time_ms)
+{
+	if (!mBuildThread)
+	{
+		return 0;
+	}
+	mBuildThread->update(max_time_ms);
+
+	if (mDataMutex)
+	{
+		mDataMutex->lock();
+	}
+	for (handle_list_t::iterator iter = mPendingBuilds.begin(); iter != mPendingBuilds.end(); )
+	{
+		LLQueuedThread::handle_t handle = *iter;
+		LLQueuedThread::status_t status = mBuildThread->getRequestStatus(handle);
+		if (status == LLQueuedThread::STATUS_QUEUED || status == LLQueuedThread::STATUS_INPROGRESS)
+		{
+			++iter;
+			continue;
+		}
+
+		LLVolumeBuildThread::VolumeRequest* req = (LLVolumeBuildThread::VolumeRequest*)mBuildThread->getRequest(handle);
+		if (req)
+		{
+			// The group that asked may be gone, or have been replaced by
+			// another one for the same parameters that did not ask.
+			S32 detail = req->getDetail();
+			volume_lod_group_map_t::iterator group_iter = mVolumeLODGroups.find(&req->getVolumeParams());
+			if (group_iter != mVolumeLODGroups.end()
+				&& group_iter->second->getBuildHandle(detail) == handle)
+			{
+				LLVolumeLODGroup* volgroupp = group_iter->second;
+				volgroupp->setBuildHandle(detail, LLQueuedThread::nullHandle());
+				// refVolume() may have had to build it in the meantime
+				if (status == LLQueuedThread::STATUS_COMPLETE && !volgroupp->hasLOD(detail))
+				{
+					volgroupp->setPrebuiltLOD(detail, req->getVolume());
+				}
+			}
+			mBuildThread->completeRequest(handle);
+		}
+		iter = mPendingBuilds.erase(iter);
+	}
+	S32 pending = (S32)mPendingBuilds.size();
+	if (mDataMutex)
+	{
+		mDataMutex->unlock();
+	}
+	return pending;
+}
+
 std::ostream& operator<<(std::ostream& s, const LLVolumeMgr& volume_mgr)
 {
 	s << "{ numLODgroups=" << volume_mgr.mVolumeLODGroups.size() << ", ";
@@ -255,6 +434,8 @@ LLVolumeLODGroup::LLVolumeLODGroup(const LLVolumeParams &params)
 	{
 		mLODRefs[i] = 0;
 		mAccessCount[i] = 0;
+		mBuildHandles[i] = LLQueuedThread::nullHandle();
+		mPlaceholderRefs[i] = 0;
 	}
 }
 
@@ -263,6 +444,7 @@ LLVolumeLODGroup::~LLVolumeLODGroup()
 	for (S32 i = 0; i < NUM_LODS; i++)
 	{
 		llassert_always(mLODRefs[i] == 0);
+		llassert_always(mPlaceholderRefs[i] == 0);
 	}
 }
 
@@ -282,6 +464,12 @@ bool LLVolumeLODGroup::cleanupRefs()
 				mLODRefs[i] = 0;
 				mVolumeLODs[i] = NULL;
 			}
+			if (mPlaceholderRefs[i] > 0)
+			{
+				llwarns << " LOD " << i << " placeholder refs = " << mPlaceholderRefs[i] << llendl;
+				mPlaceholderRefs[i] = 0;
+				mPlaceholders[i] = NULL;
+			}
 		}
 		llwarns << *getVolumeParams() << llendl;
 		res = false;
@@ -304,6 +492,28 @@ LLVolume* LLVolumeLODGroup::refLOD(const S32 detail)
 	return mVolumeLODs[detail];
 }
 
+LLVolume* LLVolumeLODGroup::refPlaceholder(const S32 detail)
+{
+	llassert(detail >=0 && detail < NUM_LODS);
+	mRefs++;
+	if (mPlaceholders[detail].isNull())
+	{
+		LLMemType m1(LLMemType::MTYPE_VOLUME);
+		mPlaceholders[detail] = LLVolume::createPlaceholder(mVolumeParams, mDetailScales[detail]);
+	}
+	mPlaceholderRefs[detail]++;
+	return mPlaceholders[detail];
+}
+
+// Takes a volume the build thread made for a LOD nobody is using yet. It is
+// kept until the first refLOD() and derefLOD() pair, or until the group goes.
+void LLVolumeLODGroup::setPrebuiltLOD(const S32 detail, LLVolume* volumep)
+{
+	llassert(detail >= 0 && detail < NUM_LODS);
+	llassert(mVolumeLODs[detail].isNull());
+	mVolumeLODs[detail] = volumep;
+}
+
 BOOL LLVolumeLODGroup::derefLOD(LLVolume *volumep)
 {
 	llassert_always(mRefs > 0);
@@ -322,6 +532,16 @@ BOOL LLVolumeLODGroup::derefLOD(LLVolume *volumep)
 #endif
 			return TRUE;
 		}
+		if (mPlaceholders[i] == volumep)
+		{
+			llassert_always(mPlaceholderRefs[i] > 0);
+			mPlaceholderRefs[i]--;
+			if (!mPlaceholderRefs[i])
+			{
+				mPlaceholders[i] = NULL;
+			}
+			return TRUE;
+		}
 	}
 	llerrs << "Deref of non-matching LOD in volume LOD group" << llendl;
 	return FALSE;
@@ -396,3 +616,45 @@ std::ostream& operator<<(std::ostream& s, const LLVolumeLODGroup& volgroup)
 	return s;
 }
 
+//============================================================================
+
+LLVolumeBuildThread::VolumeRequest::VolumeRequest(handle_t handle, U32 priority,
+												  const LLVolumeParams& volume_params, const S32 detail)
+:	LLQueuedThread::QueuedRequest(handle, priority),
+	mVolumeParams(volume_params),
+	mDetail(detail)
+{
+}
+
+LLVolumeBuildThread::VolumeRequest::~VolumeRequest()
+{
+}
+
+// BUILD THREAD
+// Everything a new LLVolume touches belongs to it, so any number of these can
+// run at once.
+bool LLVolumeBuildThread::VolumeRequest::processRequest()
+{
+	mVolume = new LLVolume(mVolumeParams, LLVolumeLODGroup::getVolumeScaleFromDetail(mDetail));
+	return true;
+}
+
+LLVolumeBuildThread::LLVolumeBuildThread(bool threaded, U32 concurrency)
+:	LLQueuedThread("volumebuild", threaded, concurrency)
+{
+}
+
+// MAIN THREAD
+LLQueuedThread::handle_t LLVolumeBuildThread::buildVolume(const LLVolumeParams& volume_params, const S32 detail, U32 priority)
+{
+	handle_t handle = generateHandle();
+	VolumeRequest* req = new VolumeRequest(handle, priority, volume_params, detail);
+
+	bool res = addRequest(req);
+	if (!res)
+	{
+		llerrs << "LLVolumeBuildThread::buildVolume called after shutdown()" << llendl;
+	}
+
+	return handle;
+}
@@ -28,9 +28,11 @@
 #define LL_LLVOLUMEMGR_H
 
 #include <map>
+#include <vector>
 
 #include "llvolume.h"
 #include "llpointer.h"
+#include "llqueuedthread.h"
 #include "llthread.h"
 
 class LLVolumeParams;
@@ -55,11 +57,20 @@ public:
 	static F32 getVolumeScaleFromDetail(const S32 detail);
 
 	LLVolume* refLOD(const S32 detail);
+	// A placeholder for the LOD while the build thread makes it, shared by
+	// everyone waiting for it and given back with derefLOD()
+	LLVolume* refPlaceholder(const S32 detail);
 	BOOL derefLOD(LLVolume *volumep);
 	S32 getNumRefs() const { return mRefs; }
 	
 	const LLVolumeParams* getVolumeParams() const { return &mVolumeParams; };
 
+	// Used by LLVolumeMgr for volumes built off the main thread
+	bool hasLOD(const S32 detail) const { return mVolumeLODs[detail].notNull(); }
+	void setPrebuiltLOD(const S32 detail, LLVolume* volumep);
+	LLQueuedThread::handle_t getBuildHandle(const S32 detail) const { return mBuildHandles[detail]; }
+	void setBuildHandle(const S32 detail, LLQueuedThread::handle_t handle) { mBuildHandles[detail] = handle; }
+
 	F32	dump();
 	friend std::ostream& operator<<(std::ostream& s, const LLVolumeLODGroup& volgroup);
 
@@ -72,6 +83,40 @@ protected:
 	static F32 mDetailThresholds[NUM_LODS];
 	static F32 mDetailScales[NUM_LODS];
 	S32		mAccessCount[NUM_LODS];
+	LLQueuedThread::handle_t mBuildHandles[NUM_LODS];
+	S32 mPlaceholderRefs[NUM_LODS];
+	LLPointer<LLVolume> mPlaceholders[NUM_LODS];
+};
+
+// Builds the volumes LLVolumeMgr::prepareVolume() asks for off the main thread
+class LLVolumeBuildThread : public LLQueuedThread
+{
+public:
+	class VolumeRequest : public LLQueuedThread::QueuedRequest
+	{
+	protected:
+		virtual ~VolumeRequest(); // use deleteRequest()
+
+	public:
+		VolumeRequest(handle_t handle, U32 priority, const LLVolumeParams& volume_params, const S32 detail);
+
+		/*virtual*/ bool processRequest();
+
+		const LLVolumeParams& getVolumeParams() const { return mVolumeParams; }
+		S32 getDetail() const { return mDetail; }
+		LLVolume* getVolume() const { return mVolume; }
+
+	private:
+		LLVolumeParams mVolumeParams;
+		S32 mDetail;
+		LLPointer<LLVolume> mVolume;
+	};
+
+	// concurrency > 1 builds that many volumes at once on the LLThreadScheduler,
+	// when there is one.
+	LLVolumeBuildThread(bool threaded = true, U32 concurrency = 1);
+
+	handle_t buildVolume(const LLVolumeParams& volume_params, const S32 detail, U32 priority);
 };
 
 class LLVolumeMgr
@@ -89,15 +134,43 @@ public:
 	virtual LLVolume *refVolume(const LLVolumeParams &volume_params, const S32 detail);
 	virtual void unrefVolume(LLVolume *volumep);
 
+	// Like refVolume(), but a volume which has not been built yet is queued
+	// on the build thread, when there is one, and a placeholder without faces
+	// is returned in its place. The caller swaps it for the real volume once
+	// prepareVolume() says it is ready. Either is given back with
+	// unrefVolume(). Sculpts are always built right away.
+	LLVolume* refVolumeOrPlaceholder(const LLVolumeParams& volume_params, const S32 detail);
+
 	void dump();
 
 	// manually call this for mutex magic
 	void useMutex();
 
+	// Lets prepareVolume() build volumes off the main thread, on up to
+	// concurrency LLThreadScheduler workers at once when the scheduler exists.
+	// Without a build thread refVolume() builds every volume itself.
+	void startBuildThread(bool threaded, U32 concurrency);
+	void shutdownBuildThread();
+	bool hasBuildThread() const { return mBuildThread != NULL; }
+
+	// Returns TRUE when refVolume() can hand out this volume without building
+	// it: it is built already, it is a sculpt, there is no build thread or
+	// nothing references these parameters yet. Otherwise the volume is queued
+	// on the build thread and FALSE is returned until update() has picked it
+	// up, so the caller can keep drawing the volume or placeholder it has in
+	// the meantime.
+	BOOL prepareVolume(const LLVolumeParams& volume_params, const S32 detail);
+
+	// Call once a frame from the main thread. Hands the volumes the build
+	// thread has finished to their LOD groups and returns how many are left.
+	S32 update(U32 max_time_ms);
+
 	friend std::ostream& operator<<(std::ostream& s, const LLVolumeMgr& volume_mgr);
 
 protected:
 	void insertGroup(LLVolumeLODGroup* volgroup);
+	// Queues detail for volgroupp unless it is queued already, with mDataMutex held
+	void queueBuild(LLVolumeLODGroup* volgroupp, const S32 detail);
 	// Overridden in llphysics/abstract/utils/llphysicsvolumemanager.h
 	virtual LLVolumeLODGroup* createNewGroup(const LLVolumeParams& volume_params);
 
@@ -106,6 +179,10 @@ protected:
 	volume_lod_group_map_t mVolumeLODGroups;
 
 	LLMutex* mDataMutex;
+
+	LLVolumeBuildThread* mBuildThread;
+	typedef std::vector<LLQueuedThread::handle_t> handle_list_t;
+	handle_list_t mPendingBuilds;
 };
 
 #endif // LL_LLVOLUMEMGR_H
@@ -0,0 +1,201 @@
+/**
+ * @file llcamera_test.cpp
+ * @brief Test for the batched frustum tests in llcamera.cpp.
+ *
+ * $LicenseInfo:firstyear=2011&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2011, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llcamera.h"
+
+#include "lltimer.h"
+
+#include "../test/lltut.h"
+
+#include <vector>
+
+namespace tut
+{
+	struct camera_data
+	{
+		camera_data() : mSeed(12345)
+		{
+			LLVector3 origin(128.f, 128.f, 30.f);
+			mCamera.setOriginAndLookAt(origin, LLVector3::z_axis, origin + LLVector3(0.8f, 0.5f, -0.2f));
+			mCamera.setView(1.f);
+			mCamera.setAspect(1.5f);
+			mCamera.setNear(0.5f);
+			mCamera.setFar(128.f);
+
+			// the corners LLViewerCamera gets from gluUnProject()
+			F32 tan_y = tanf(mCamera.getView() * 0.5f);
+			F32 tan_x = tan_y * mCamera.getAspect();
+			const F32 xs[] = { -1.f, 1.f, 1.f, -1.f };
+			const F32 ys[] = { -1.f, -1.f, 1.f, 1.f };
+			LLVector3 frust[8];
+			for (S32 i = 0; i < 8; i++)
+			{
+				F32 dist = i < 4 ? mCamera.getNear() : mCamera.getFar();
+				frust[i] = origin + mCamera.getAtAxis() * dist
+								  - mCamera.getLeftAxis() * (xs[i % 4] * tan_x * dist)
+								  + mCamera.getUpAxis() * (ys[i % 4] * tan_y * dist);
+			}
+			mCamera.calcAgentFrustumPlanes(frust);
+		}
+
+		F32 random(F32 min, F32 max)
+		{
+			mSeed = mSeed * 1664525 + 1013904223;
+			return min + (max - min) * (F32)(mSeed >> 8) / (F32)(1 << 24);
+		}
+
+		// boxes around the camera, near and past the far plane
+		void makeBoxes(U32 count)
+		{
+			mCenters.clear();
+			mRadii.clear();
+			for (U32 i = 0; i < count; i++)
+			{
+				mCenters.push_back(LLVector3(random(-64.f, 320.f), random(-64.f, 320.f), random(-20.f, 80.f)));
+				F32 size = random(0.f, 1.f) < 0.05f ? random(16.f, 64.f) : random(0.1f, 8.f);
+				mRadii.push_back(LLVector3(size * random(0.5f, 1.f), size * random(0.5f, 1.f), size * random(0.5f, 1.f)));
+			}
+		}
+
+		void fillBatch(LLCameraBoxBatch& boxes)
+		{
+			boxes.clear();
+			for (U32 i = 0; i < mCenters.size(); i++)
+			{
+				boxes.push_back(mCenters[i], mRadii[i]);
+			}
+		}
+
+		void ensureMatches(const char* msg, bool far_clip)
+		{
+			LLCameraBoxBatch boxes;
+			fillBatch(boxes);
+			std::vector<S8> results(mCenters.size());
+			S32 visible = mCamera.AABBsInFrustum(boxes, &results[0], far_clip);
+
+			S32 expected_visible = 0;
+			for (U32 i = 0; i < mCenters.size(); i++)
+			{
+				S32 expected = far_clip ? mCamera.AABBInFrustum(mCenters[i], mRadii[i]) :
+										  mCamera.AABBInFrustumNoFarClip(mCenters[i], mRadii[i]);
+				ensure_equals(msg, (S32)results[i], expected);
+				expected_visible += expected ? 1 : 0;
+			}
+			ensure_equals(msg, visible, expected_visible);
+		}
+
+		LLCamera mCamera;
+		std::vector<LLVector3> mCenters;
+		std::vector<LLVector3> mRadii;
+		U32 mSeed;
+	};
+	typedef test_group<camera_data> camera_test;
+	typedef camera_test::object camera_object;
+	tut::camera_test camera("LLCamera");
+
+	template<> template<>
+	void camera_object::test<1>()
+	{
+		set_test_name("AABBsInFrustum() matches AABBInFrustum()");
+		makeBoxes(1001);
+		ensureMatches("far clip", true);
+		ensureMatches("no far clip", false);
+	}
+
+	template<> template<>
+	void camera_object::test<2>()
+	{
+		set_test_name("AABBsInFrustum() with a user clip plane");
+		makeBoxes(998);
+		mCamera.setUserClipPlane(LLPlane(LLVector3(0.f, 0.f, 20.f), LLVector3(0.f, 0.f, 1.f)));
+		ensureMatches("far clip", true);
+		ensureMatches("no far clip", false);
+	}
+
+	template<> template<>
+	void camera_object::test<3>()
+	{
+		set_test_name("a reused batch gives the same results");
+		makeBoxes(503);
+		LLCameraBoxBatch boxes;
+		fillBatch(boxes);
+		std::vector<S8> first(mCenters.size()), second(mCenters.size());
+		S32 first_visible = mCamera.AABBsInFrustum(boxes, &first[0]);
+		fillBatch(boxes);
+		S32 second_visible = mCamera.AABBsInFrustum(boxes, &second[0]);
+		ensure_equals("visible", second_visible, first_visible);
+		ensure("results", first == second);
+
+		// fewer boxes than last time, so the last four are partly stale
+		mCenters.resize(201);
+		mRadii.resize(201);
+		fillBatch(boxes);
+		ensure_equals("size", boxes.size(), (U32)201);
+		std::vector<S8> fewer(mCenters.size());
+		mCamera.AABBsInFrustum(boxes, &fewer[0]);
+		for (U32 i = 0; i < fewer.size(); i++)
+		{
+			ensure_equals("fewer", fewer[i], first[i]);
+		}
+	}
+
+	template<> template<>
+	void camera_object::test<4>()
+	{
+		set_test_name("batched frustum test speed");
+		const U32 NUM_BOXES = 100000;
+		const S32 PASSES = 20;
+		makeBoxes(NUM_BOXES);
+		LLCameraBoxBatch boxes;
+		fillBatch(boxes);
+		std::vector<S8> results(NUM_BOXES);
+
+		LLTimer timer;
+		S32 one_at_a_time = 0;
+		for (S32 pass = 0; pass < PASSES; pass++)
+		{
+			for (U32 i = 0; i < NUM_BOXES; i++)
+			{
+				one_at_a_time += mCamera.AABBInFrustum(mCenters[i], mRadii[i]) ? 1 : 0;
+			}
+		}
+		F64 single = timer.getElapsedTimeF64();
+
+		timer.reset();
+		S32 batched = 0;
+		for (S32 pass = 0; pass < PASSES; pass++)
+		{
+			batched += mCamera.AABBsInFrustum(boxes, &results[0]);
+		}
+		F64 batch = timer.getElapsedTimeF64();
+
+		ensure_equals("visible", batched, one_at_a_time);
+		llinfos << NUM_BOXES * PASSES << " boxes: AABBInFrustum() " << single * 1000.0 << "ms, AABBsInFrustum() "
+				<< batch * 1000.0 << "ms" << llendl;
+	}
+}
@@ -657,4 +657,43 @@ namespace tut
 			is_approx_equal(1.000f, llquat.mQ[3]));
 	}
 
+	template<> template<>
+	void llquat_test_object_t::test<23>()
+	{
+		//test case for void nlerp_batch(U32 count, const F32* u, const LLQuaternion* a, const LLQuaternion* b, LLQuaternion* out) fn
+		// 11 covers the vectorized groups of four and the scalar tail
+		const U32 COUNT = 11;
+		LLQuaternion a[COUNT], b[COUNT], out[COUNT];
+		F32 u[COUNT];
+		for (U32 i = 0; i < COUNT; ++i)
+		{
+			a[i].setQuat(0.3f * i, LLVector3(1.f, 0.5f * i, -0.25f));
+			b[i].setQuat(0.2f * i + 0.7f, LLVector3(-0.5f, 1.f, 0.1f * i));
+			u[i] = (F32)i / (F32)COUNT;
+		}
+		// opposite hemispheres take the slerp path
+		b[1] = -b[1];
+		b[6] = -b[6];
+		b[10] = -b[10];
+
+		nlerp_batch(COUNT, u, a, b, out);
+		for (U32 i = 0; i < COUNT; ++i)
+		{
+			LLQuaternion expected = nlerp(u[i], a[i], b[i]);
+			ensure(llformat("nlerp_batch() matches nlerp() at %d", i),
+				   is_approx_equal_fraction(expected.mQ[VX], out[i].mQ[VX], 16) &&
+				   is_approx_equal_fraction(expected.mQ[VY], out[i].mQ[VY], 16) &&
+				   is_approx_equal_fraction(expected.mQ[VZ], out[i].mQ[VZ], 16) &&
+				   is_approx_equal_fraction(expected.mQ[VW], out[i].mQ[VW], 16));
+		}
+
+		// in place
+		nlerp_batch(COUNT, u, a, b, a);
+		for (U32 i = 0; i < COUNT; ++i)
+		{
+			ensure(llformat("in place nlerp_batch() at %d", i),
+				   is_approx_equal_fraction(a[i].mQ[VX], out[i].mQ[VX], 16) &&
+				   is_approx_equal_fraction(a[i].mQ[VW], out[i].mQ[VW], 16));
+		}
+	}
 }
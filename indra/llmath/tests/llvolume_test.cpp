@@ -0,0 +1,198 @@
+/**
+ * @file llvolume_test.cpp
+ * @brief Test for the LLVolumeFace vertex streams in llvolume.cpp.
+ *
+ * $LicenseInfo:firstyear=2011&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2011, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llvolume.h"
+#include "../m3math.h"
+#include "../m4math.h"
+
+#include "llpointer.h"
+
+#include "../test/lltut.h"
+
+#include <sstream>
+#include <vector>
+
+namespace tut
+{
+	struct volume_data
+	{
+		volume_data()
+		{
+			ll_init_apr();
+			// a twisted, tapered torus so no face lines up with an axis
+			LLVolumeParams params;
+			params.setType(LL_PCODE_PROFILE_SQUARE | LL_PCODE_HOLE_CIRCLE, LL_PCODE_PATH_CIRCLE);
+			params.setRatio(1.f, 0.25f);
+			params.setHollow(0.4f);
+			params.setTwistBegin(-0.3f);
+			params.setTwistEnd(0.6f);
+			params.setTaper(0.2f, -0.1f);
+			mVolume = new LLVolume(params, 1.f);
+
+			mMatrix.initAll(LLVector3(2.f, 0.5f, 1.5f), LLQuaternion(0.7f, LLVector3(0.3f, 0.8f, -0.5f)),
+							LLVector3(10.f, -20.f, 30.f));
+			mNormalMatrix = mMatrix.getMat3();
+		}
+
+		// the SSE path sums in a different order, so allow for rounding
+		void ensureClose(const char* msg, const LLVector3& actual, const LLVector3& expected)
+		{
+			F32 tolerance = 0.0001f * llmax(1.f, expected.length());
+			if (dist_vec(actual, expected) > tolerance)
+			{
+				std::ostringstream str;
+				str << msg << ": " << actual << " vs " << expected;
+				fail(str.str());
+			}
+		}
+
+		LLPointer<LLVolume> mVolume;
+		LLMatrix4 mMatrix;
+		LLMatrix3 mNormalMatrix;
+	};
+	typedef test_group<volume_data> volume_test;
+	typedef volume_test::object volume_object;
+	tut::volume_test volume("LLVolume");
+
+	template<> template<>
+	void volume_object::test<1>()
+	{
+		set_test_name("vertex streams are aligned and the same length");
+		ensure("has faces", mVolume->getNumVolumeFaces() > 0);
+		for (S32 i = 0; i < mVolume->getNumVolumeFaces(); ++i)
+		{
+			const LLVolumeFace& face = mVolume->getVolumeFace(i);
+			ensure("has vertices", face.getNumVertices() > 0);
+			ensure_equals("normals", (S32)face.mNormals.size(), face.getNumVertices());
+			ensure_equals("binormals", (S32)face.mBinormals.size(), face.getNumVertices());
+			ensure_equals("tex coords", (S32)face.mTexCoords.size(), face.getNumVertices());
+			ensure_equals("positions aligned", (U32)((uintptr_t)face.mPositions.getData() & 15), (U32)0);
+			ensure_equals("normals aligned", (U32)((uintptr_t)face.mNormals.getData() & 15), (U32)0);
+			ensure_equals("binormals aligned", (U32)((uintptr_t)face.mBinormals.getData() & 15), (U32)0);
+		}
+	}
+
+	template<> template<>
+	void volume_object::test<2>()
+	{
+		set_test_name("extents bound every position");
+		for (S32 i = 0; i < mVolume->getNumVolumeFaces(); ++i)
+		{
+			const LLVolumeFace& face = mVolume->getVolumeFace(i);
+			LLVector3 min = face.getPosition(0);
+			LLVector3 max = min;
+			for (S32 v = 1; v < face.getNumVertices(); ++v)
+			{
+				update_min_max(min, max, face.getPosition(v));
+			}
+			ensure_equals("min", face.mExtents[0], min);
+			ensure_equals("max", face.mExtents[1], max);
+		}
+	}
+
+	template<> template<>
+	void volume_object::test<3>()
+	{
+		set_test_name("stream transforms match per vertex math");
+		for (S32 i = 0; i < mVolume->getNumVolumeFaces(); ++i)
+		{
+			mVolume->genBinormals(i);
+			const LLVolumeFace& face = mVolume->getVolumeFace(i);
+			S32 num_vertices = face.getNumVertices();
+
+			std::vector<LLVector3> positions(num_vertices), normals(num_vertices), binormals(num_vertices);
+			LLStrider<LLVector3> strider;
+			strider = &positions[0];
+			face.transformPositions(mMatrix, strider);
+			ensure("positions strider advanced", strider.get() == &positions[0] + num_vertices);
+			strider = &normals[0];
+			face.transformNormals(mNormalMatrix, strider);
+			strider = &binormals[0];
+			face.transformBinormals(mNormalMatrix, strider);
+
+			for (S32 v = 0; v < num_vertices; ++v)
+			{
+				ensureClose("position", positions[v], face.getPosition(v) * mMatrix);
+
+				LLVector3 normal = face.getNormal(v) * mNormalMatrix;
+				normal.normVec();
+				ensureClose("normal", normals[v], normal);
+
+				LLVector3 binormal = face.getBinormal(v) * mNormalMatrix;
+				binormal.normVec();
+				ensureClose("binormal", binormals[v], binormal);
+			}
+		}
+	}
+
+	template<> template<>
+	void volume_object::test<4>()
+	{
+		set_test_name("vertices pushed one at a time");
+		LLVolumeFace face;
+		LLVolumeFace::VertexData vertex;
+		vertex.mNormal.setVec(0.f, 0.f, 1.f);
+		vertex.mBinormal.setVec(1.f, 0.f, 0.f);
+		for (S32 i = 0; i < 100; ++i)
+		{
+			vertex.mPosition.setVec((F32)i, (F32)-i, 0.5f * i);
+			vertex.mTexCoord.setVec(0.01f * i, 1.f);
+			face.pushVertex(vertex);
+		}
+		ensure_equals("count", face.getNumVertices(), 100);
+		ensure_equals("position", face.getPosition(42), LLVector3(42.f, -42.f, 21.f));
+		ensure_equals("normal", face.getNormal(99), vertex.mNormal);
+		ensure_equals("tex coord", face.mTexCoords[7], LLVector2(0.01f * 7, 1.f));
+		face.updateExtents();
+		ensure_equals("min", face.mExtents[0], LLVector3(0.f, -99.f, 0.f));
+		ensure_equals("max", face.mExtents[1], LLVector3(99.f, 0.f, 49.5f));
+
+		LLVolumeFace copy = face;
+		ensure_equals("copy", copy.getPosition(99), face.getPosition(99));
+		face.clearVertices();
+		ensure_equals("cleared", face.getNumVertices(), 0);
+		ensure_equals("copy kept", copy.getNumVertices(), 100);
+	}
+
+	template<> template<>
+	void volume_object::test<5>()
+	{
+		set_test_name("LLV4Vector3::normVec() matches LLVector3::normVec()");
+		const LLVector3 vecs[] = { LLVector3(3.f, 4.f, 12.f), LLVector3(-0.001f, 0.002f, 0.f),
+								   LLVector3(1e-9f, 0.f, 0.f), LLVector3(0.f, 0.f, 0.f) };
+		for (U32 i = 0; i < sizeof(vecs) / sizeof(vecs[0]); ++i)
+		{
+			LLV4Vector3 v4;
+			v4.setVec(vecs[i]);
+			v4.normVec();
+			LLVector3 expected = vecs[i];
+			expected.normVec();
+			ensure_equals("normalized", LLVector3(v4.mV), expected);
+		}
+	}
+}
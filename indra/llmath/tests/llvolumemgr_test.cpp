@@ -0,0 +1,202 @@
+/**
+ * @file llvolumemgr_test.cpp
+ * @brief Test for llvolumemgr.cpp.
+ *
+ * $LicenseInfo:firstyear=2011&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2011, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llvolumemgr.h"
+
+#include "lltimer.h"
+
+#include "../test/lltut.h"
+
+namespace tut
+{
+	struct volume_mgr_data
+	{
+		volume_mgr_data()
+		{
+			ll_init_apr();
+			mParams.setType(LL_PCODE_PROFILE_CIRCLE, LL_PCODE_PATH_CIRCLE);
+			mParams.setRatio(1.f, 0.25f);
+		}
+
+		// Pumps update() until the volume is ready, or gives up after a while
+		bool waitForVolume(LLVolumeMgr& mgr, S32 detail)
+		{
+			LLTimer timer;
+			while (!mgr.prepareVolume(mParams, detail))
+			{
+				mgr.update(0);
+				if (timer.getElapsedTimeF64() > 30.0)
+				{
+					return false;
+				}
+				ms_sleep(1);
+			}
+			return true;
+		}
+
+		void ensureSameFaces(LLVolume* built, LLVolume* expected)
+		{
+			ensure_equals("face count", built->getNumVolumeFaces(), expected->getNumVolumeFaces());
+			for (S32 i = 0; i < expected->getNumVolumeFaces(); ++i)
+			{
+				ensure_equals("vertex count", built->getVolumeFace(i).getNumVertices(),
+							  expected->getVolumeFace(i).getNumVertices());
+				ensure_equals("index count", built->getVolumeFace(i).mIndices.size(),
+							  expected->getVolumeFace(i).mIndices.size());
+			}
+		}
+
+		LLVolumeParams mParams;
+	};
+	typedef test_group<volume_mgr_data> volume_mgr_test;
+	typedef volume_mgr_test::object volume_mgr_object;
+	tut::volume_mgr_test volume_mgr("LLVolumeMgr");
+
+	template<> template<>
+	void volume_mgr_object::test<1>()
+	{
+		set_test_name("without a build thread every volume is ready");
+		LLVolumeMgr mgr;
+		ensure("no build thread", !mgr.hasBuildThread());
+		ensure("unreferenced params", mgr.prepareVolume(mParams, 3));
+
+		LLPointer<LLVolume> volume = mgr.refVolume(mParams, 0);
+		ensure("other lod", mgr.prepareVolume(mParams, 3));
+		ensure_equals("nothing pending", mgr.update(0), 0);
+		mgr.unrefVolume(volume);
+		volume = NULL;
+		ensure("no dangling references", mgr.cleanup());
+	}
+
+	template<> template<>
+	void volume_mgr_object::test<2>()
+	{
+		set_test_name("lod built on the main thread by update()");
+		LLVolumeMgr mgr;
+		mgr.startBuildThread(false, 1);
+
+		ensure("unreferenced params are built by refVolume", mgr.prepareVolume(mParams, 3));
+		LLPointer<LLVolume> low = mgr.refVolume(mParams, 0);
+		ensure("referenced lod", mgr.prepareVolume(mParams, 0));
+		ensure("new lod is queued", !mgr.prepareVolume(mParams, 3));
+		ensure("still queued", !mgr.prepareVolume(mParams, 3));
+
+		ensure_equals("handed over", mgr.update(0), 0);
+		ensure("ready", mgr.prepareVolume(mParams, 3));
+
+		LLPointer<LLVolume> high = mgr.refVolume(mParams, 3);
+		LLPointer<LLVolume> expected = new LLVolume(mParams, LLVolumeLODGroup::getVolumeScaleFromDetail(3));
+		ensure_equals("detail", high->getDetail(), expected->getDetail());
+		ensureSameFaces(high, expected);
+		ensure("same volume for the next reference", mgr.refVolume(mParams, 3) == high.get());
+
+		mgr.unrefVolume(high);
+		mgr.unrefVolume(high);
+		mgr.unrefVolume(low);
+		high = low = NULL;
+		ensure("no dangling references", mgr.cleanup());
+		ensure("cleanup stops the build thread", !mgr.hasBuildThread());
+	}
+
+	template<> template<>
+	void volume_mgr_object::test<3>()
+	{
+		set_test_name("volumes nobody waits for any more are dropped");
+		LLVolumeMgr mgr;
+		mgr.startBuildThread(false, 1);
+
+		LLPointer<LLVolume> low = mgr.refVolume(mParams, 0);
+		ensure("queued", !mgr.prepareVolume(mParams, 2));
+		mgr.unrefVolume(low);
+		low = NULL;
+		ensure_equals("dropped", mgr.update(0), 0);
+
+		low = mgr.refVolume(mParams, 0);
+		ensure("group for the same params did not ask", !mgr.prepareVolume(mParams, 2));
+		mgr.unrefVolume(low);
+		low = NULL;
+		ensure("no dangling references", mgr.cleanup());
+	}
+
+	template<> template<>
+	void volume_mgr_object::test<4>()
+	{
+		set_test_name("lods built on a thread of their own");
+		LLVolumeMgr mgr;
+		mgr.startBuildThread(true, 1);
+
+		LLPointer<LLVolume> low = mgr.refVolume(mParams, 0);
+		ensure("queued", !mgr.prepareVolume(mParams, 1));
+		ensure("queued", !mgr.prepareVolume(mParams, 2));
+		ensure("lod 1 built", waitForVolume(mgr, 1));
+		ensure("lod 2 built", waitForVolume(mgr, 2));
+
+		for (S32 detail = 1; detail <= 2; ++detail)
+		{
+			LLPointer<LLVolume> volume = mgr.refVolume(mParams, detail);
+			LLPointer<LLVolume> expected = new LLVolume(mParams, LLVolumeLODGroup::getVolumeScaleFromDetail(detail));
+			ensureSameFaces(volume, expected);
+			mgr.unrefVolume(volume);
+		}
+
+		mgr.unrefVolume(low);
+		low = NULL;
+		ensure("no dangling references", mgr.cleanup());
+	}
+
+	template<> template<>
+	void volume_mgr_object::test<5>()
+	{
+		set_test_name("first builds wait behind a placeholder");
+		LLVolumeMgr mgr;
+		LLPointer<LLVolume> volume = mgr.refVolumeOrPlaceholder(mParams, 2);
+		ensure("built right away without a build thread", !volume->isPlaceholder());
+		mgr.unrefVolume(volume);
+
+		mgr.startBuildThread(false, 1);
+		LLPointer<LLVolume> placeholder = mgr.refVolumeOrPlaceholder(mParams, 2);
+		ensure("placeholder", placeholder->isPlaceholder());
+		ensure_equals("no volume faces", placeholder->getNumVolumeFaces(), 0);
+		ensure("has the profile faces", placeholder->getNumFaces() > 0);
+		ensure("shared while building", mgr.refVolumeOrPlaceholder(mParams, 2) == placeholder.get());
+		mgr.unrefVolume(placeholder);
+		ensure("queued", !mgr.prepareVolume(mParams, 2));
+
+		ensure_equals("handed over", mgr.update(0), 0);
+		ensure("ready", mgr.prepareVolume(mParams, 2));
+		volume = mgr.refVolumeOrPlaceholder(mParams, 2);
+		ensure("built volume", !volume->isPlaceholder());
+		LLPointer<LLVolume> expected = new LLVolume(mParams, LLVolumeLODGroup::getVolumeScaleFromDetail(2));
+		ensureSameFaces(volume, expected);
+
+		mgr.unrefVolume(placeholder);
+		mgr.unrefVolume(volume);
+		placeholder = volume = NULL;
+		ensure("no dangling references", mgr.cleanup());
+	}
+}
@@ -563,6 +563,36 @@ U8* LLBufferArray::readAfter(
 	return rv;
 }
 
+const U8* LLBufferArray::getChannelData(
+	S32 channel,
+	std::vector<U8>& scratch,
+	S32& len) const
+{
+	LLMemType m1(LLMemType::MTYPE_IO_BUFFER);
+	const U8* rv = NULL;
+	S32 segment_count = 0;
+	len = 0;
+	const_segment_iterator_t it = mSegments.begin();
+	const_segment_iterator_t end = mSegments.end();
+	for( ; it != end; ++it)
+	{
+		if((*it).isOnChannel(channel) && (*it).size())
+		{
+			rv = (*it).data();
+			len += (*it).size();
+			++segment_count;
+		}
+	}
+	if(segment_count > 1)
+	{
+		// spread over several segments, so it has to be copied
+		scratch.resize(len);
+		readAfter(channel, NULL, &scratch[0], len);
+		rv = &scratch[0];
+	}
+	return rv;
+}
+
 U8* LLBufferArray::seek(
 	S32 channel,
 	U8* start,
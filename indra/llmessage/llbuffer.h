@@ -436,6 +436,23 @@ public:
 	 * @return Returns the address of the last read byte.
 	 */
 	U8* readAfter(S32 channel, U8* start, U8* dest, S32& len) const;
+
+	/** 
+	 * @brief Get all bytes on a channel as one block of memory.
+	 *
+	 * When the channel lives in a single segment, as a complete
+	 * request or response usually does, this returns that segment and
+	 * nothing is copied. Otherwise the channel is read into scratch.
+	 * Either way the memory is only good until this buffer array or
+	 * scratch changes. Use this to hand a whole channel to a parser
+	 * which works on a contiguous buffer.
+	 * @param channel The channel to read.
+	 * @param scratch Storage for the channel if it has to be copied.
+	 * @param len[out] The number of bytes on the channel.
+	 * @return Returns the start of the channel data, or NULL if the
+	 * channel is empty.
+	 */
+	const U8* getChannelData(S32 channel, std::vector<U8>& scratch, S32& len) const;
  
 	/** 
 	 * @brief Find an address in a buffer array
@@ -61,8 +61,6 @@ const S32 PING_START_BLOCK = 3;		// How many pings behind we have to be to consi
 const S32 PING_RELEASE_BLOCK = 2;	// How many pings behind we have to be to consider ourself unblocked.
 
 const F32 TARGET_PERIOD_LENGTH = 5.f;	// seconds
-const F32 LL_DUPLICATE_SUPPRESSION_TIMEOUT = 60.f; //seconds - this can be long, as time-based cleanup is
-													// only done when wrapping packetids, now...
 
 LLCircuitData::LLCircuitData(const LLHost &host, TPACKETID in_id, 
 							 const F32 circuit_heartbeat_interval, const F32 circuit_timeout)
@@ -85,6 +83,9 @@ LLCircuitData::LLCircuitData(const LLHost &host, TPACKETID in_id,
 	mLastPingID(0),
 	mPingDelay(INITIAL_PING_VALUE_MSEC), 
 	mPingDelayAveraged((F32)INITIAL_PING_VALUE_MSEC), 
+	mPotentialLostPackets(LL_MAX_PACKET_ID_WINDOW),
+	mRecentlyReceivedReliablePackets(LL_MAX_PACKET_ID_WINDOW),
+	mUnackedPackets(LL_MAX_PACKET_ID_WINDOW),
 	mUnackedPacketCount(0),
 	mUnackedPacketBytes(0),
 	mLocalEndPointID(),
@@ -124,55 +125,31 @@ LLCircuitData::LLCircuitData(const LLHost &host, TPACKETID in_id,
 
 LLCircuitData::~LLCircuitData()
 {
-	LLReliablePacket *packetp = NULL;
-
 	// Clean up all pending transfers.
 	gTransferManager.cleanupConnection(mHost);
 
-	// remove all pending reliable messages on this circuit
-	std::vector<TPACKETID> doomed;
-	reliable_iter iter;
-	reliable_iter end = mUnackedPackets.end();
-	for(iter = mUnackedPackets.begin(); iter != end; ++iter)
-	{
-		packetp = iter->second;
-		gMessageSystem->mFailedResendPackets++;
-		if(gMessageSystem->mVerboseLog)
-		{
-			doomed.push_back(packetp->mPacketID);
-		}
-		if (packetp->mCallback)
-		{
-			packetp->mCallback(packetp->mCallbackData,LL_ERR_CIRCUIT_GONE);
-		}
+	// remove all pending reliable messages on this circuit, including
+	// those on their final retry
+	removeAllReliablePackets(LL_ERR_CIRCUIT_GONE);
 
-		// Update stats
-		mUnackedPacketCount--;
-		mUnackedPacketBytes -= packetp->mBufferLength;
+	for_each(mReliablePacketPool.begin(), mReliablePacketPool.end(), DeletePointer());
+	mReliablePacketPool.clear();
+}
 
-		delete packetp;
-	}
 
-	// remove all pending final retry reliable messages on this circuit
-	end = mFinalRetryPackets.end();
-	for(iter = mFinalRetryPackets.begin(); iter != end; ++iter)
+void LLCircuitData::removeAllReliablePackets(S32 error)
+{
+	LLReliablePacket *packetp = NULL;
+	std::vector<TPACKETID> doomed;
+	while (!mUnackedPackets.empty())
 	{
-		packetp = iter->second;
+		packetp = mUnackedPackets.get(mUnackedPackets.getOldestID());
 		gMessageSystem->mFailedResendPackets++;
 		if(gMessageSystem->mVerboseLog)
 		{
 			doomed.push_back(packetp->mPacketID);
 		}
-		if (packetp->mCallback)
-		{
-			packetp->mCallback(packetp->mCallbackData,LL_ERR_CIRCUIT_GONE);
-		}
-
-		// Update stats
-		mUnackedPacketCount--;
-		mUnackedPacketBytes -= packetp->mBufferLength;
-
-		delete packetp;
+		removeReliablePacket(packetp, error);
 	}
 
 	// log aborted reliable packets for this circuit.
@@ -187,82 +164,51 @@ LLCircuitData::~LLCircuitData()
 }
 
 
-void LLCircuitData::ackReliablePacket(TPACKETID packet_num)
+void LLCircuitData::removeReliablePacket(LLReliablePacket *packetp, S32 error)
 {
-	reliable_iter iter;
-	LLReliablePacket *packetp;
-
-	iter = mUnackedPackets.find(packet_num);
-	if (iter != mUnackedPackets.end())
+	if (packetp->mCallback)
 	{
-		packetp = iter->second;
-
-		if(gMessageSystem->mVerboseLog)
-		{
-			std::ostringstream str;
-			str << "MSG: <- " << packetp->mHost << "\tRELIABLE ACKED:\t"
-				<< packetp->mPacketID;
-			llinfos << str.str() << llendl;
-		}
-		if (packetp->mCallback)
-		{
-			if (packetp->mTimeout < 0.f)   // negative timeout will always return timeout even for successful ack, for debugging
-			{
-				packetp->mCallback(packetp->mCallbackData,LL_ERR_TCP_TIMEOUT);					
-			}
-			else
-			{
-				packetp->mCallback(packetp->mCallbackData,LL_ERR_NOERR);
-			}
-		}
+		packetp->mCallback(packetp->mCallbackData, error);
+	}
 
-		// Update stats
-		mUnackedPacketCount--;
-		mUnackedPacketBytes -= packetp->mBufferLength;
+	// Update stats
+	mUnackedPacketCount--;
+	mUnackedPacketBytes -= packetp->mBufferLength;
 
-		// Cleanup
-		delete packetp;
-		mUnackedPackets.erase(iter);
-		return;
+	// Cleanup
+	mUnackedPackets.erase(packetp->mPacketID);
+	if (mReliablePacketPool.size() < LL_RELIABLE_PACKET_POOL_SIZE)
+	{
+		packetp->mCallback = NULL;
+		mReliablePacketPool.push_back(packetp);
 	}
-
-	iter = mFinalRetryPackets.find(packet_num);
-	if (iter != mFinalRetryPackets.end())
+	else
 	{
-		packetp = iter->second;
-		// llinfos << "Packet " << packet_num << " removed from the pending list" << llendl;
-		if(gMessageSystem->mVerboseLog)
-		{
-			std::ostringstream str;
-			str << "MSG: <- " << packetp->mHost << "\tRELIABLE ACKED:\t"
-				<< packetp->mPacketID;
-			llinfos << str.str() << llendl;
-		}
-		if (packetp->mCallback)
-		{
-			if (packetp->mTimeout < 0.f)   // negative timeout will always return timeout even for successful ack, for debugging
-			{
-				packetp->mCallback(packetp->mCallbackData,LL_ERR_TCP_TIMEOUT);					
-			}
-			else
-			{
-				packetp->mCallback(packetp->mCallbackData,LL_ERR_NOERR);
-			}
-		}
-
-		// Update stats
-		mUnackedPacketCount--;
-		mUnackedPacketBytes -= packetp->mBufferLength;
-
-		// Cleanup
 		delete packetp;
-		mFinalRetryPackets.erase(iter);
 	}
-	else
+}
+
+
+void LLCircuitData::ackReliablePacket(TPACKETID packet_num)
+{
+	LLReliablePacket *packetp = mUnackedPackets.get(packet_num);
+	if (!packetp)
 	{
-		// Couldn't find this packet on either of the unacked lists.
+		// Couldn't find this packet on the unacked list.
 		// maybe it's a duplicate ack?
+		return;
+	}
+
+	if(gMessageSystem->mVerboseLog)
+	{
+		std::ostringstream str;
+		str << "MSG: <- " << packetp->mHost << "\tRELIABLE ACKED:\t"
+			<< packetp->mPacketID;
+		llinfos << str.str() << llendl;
 	}
+
+	// negative timeout will always return timeout even for successful ack, for debugging
+	removeReliablePacket(packetp, (packetp->mTimeout < 0.f) ? LL_ERR_TCP_TIMEOUT : LL_ERR_NOERR);
 }
 
 
@@ -273,18 +219,19 @@ S32 LLCircuitData::resendUnackedPackets(const F64 now)
 	LLReliablePacket *packetp;
 
 
-	//
-	// Theoretically we should search through the list for the packet with the oldest
-	// packet ID, as otherwise when we WRAP we will resend reliable packets out of order.
-	// Since resends are ALREADY out of order, and wrapping is highly rare (16+million packets),
-	// I'm not going to worry about this for now - djs
-	//
-
-	reliable_iter iter;
+	// Walk the window oldest first, by id, as callbacks may send more
+	// reliable packets on this circuit as we go. Packets on their final
+	// retry are left for the second pass.
+	TPACKETID oldest_id = mUnackedPackets.getOldestID();
+	U32 span = mUnackedPackets.getSpan();
 	BOOL have_resend_overflow = FALSE;
-	for (iter = mUnackedPackets.begin(); iter != mUnackedPackets.end();)
+	for (U32 i = 0; i < span; ++i)
 	{
-		packetp = iter->second;
+		packetp = mUnackedPackets.get((oldest_id + i) % LL_MAX_OUT_PACKET_ID);
+		if (!packetp || !packetp->mRetries)
+		{
+			continue;
+		}
 
 		// Only check overflow if we haven't had one yet.
 		if (!have_resend_overflow)
@@ -303,14 +250,8 @@ S32 LLCircuitData::resendUnackedPackets(const F64 now)
 				if (now > packetp->mExpirationTime)
 				{
 					// This circuit has overflowed.  Do not retry.  Do not pass go.
+					// With no retries left it is on its final retry.
 					packetp->mRetries = 0;
-					// Remove it from this list and add it to the final list.
-					mUnackedPackets.erase(iter++);
-					mFinalRetryPackets[packetp->mPacketID] = packetp;
-				}
-				else
-				{
-					++iter;
 				}
 				// Move on to the next unacked packet.
 				continue;
@@ -362,30 +303,22 @@ S32 LLCircuitData::resendUnackedPackets(const F64 now)
 				packetp->mExpirationTime = now + packetp->mTimeout;
 			}
 
-			if (!packetp->mRetries)
-			{
-				// Last resend, remove it from this list and add it to the final list.
-				mUnackedPackets.erase(iter++);
-				mFinalRetryPackets[packetp->mPacketID] = packetp;
-			}
-			else
-			{
-				// Don't remove it yet, it still gets to try to resend at least once.
-				++iter;
-			}
+			// On the last resend the packet is on its final retry,
+			// otherwise it still gets to try to resend at least once more.
 			resent_packets++;
 		}
-		else
-		{
-			// Don't need to do anything with this packet, keep iterating.
-			++iter;
-		}
 	}
 
 
-	for (iter = mFinalRetryPackets.begin(); iter != mFinalRetryPackets.end();)
+	oldest_id = mUnackedPackets.getOldestID();
+	span = mUnackedPackets.getSpan();
+	for (U32 i = 0; i < span; ++i)
 	{
-		packetp = iter->second;
+		packetp = mUnackedPackets.get((oldest_id + i) % LL_MAX_OUT_PACKET_ID);
+		if (!packetp || packetp->mRetries)
+		{
+			continue;
+		}
 		if (now > packetp->mExpirationTime)
 		{
 			// fail (too many retries)
@@ -404,21 +337,7 @@ S32 LLCircuitData::resendUnackedPackets(const F64 now)
 				llinfos << str.str() << llendl;
 			}
 
-			if (packetp->mCallback)
-			{
-				packetp->mCallback(packetp->mCallbackData,LL_ERR_TCP_TIMEOUT);
-			}
-
-			// Update stats
-			mUnackedPacketCount--;
-			mUnackedPacketBytes -= packetp->mBufferLength;
-
-			mFinalRetryPackets.erase(iter++);
-			delete packetp;
-		}
-		else
-		{
-			++iter;
+			removeReliablePacket(packetp, LL_ERR_TCP_TIMEOUT);
 		}
 	}
 
@@ -491,8 +410,12 @@ void LLCircuitData::setAlive(BOOL b_alive)
 {
 	if (mbAlive != b_alive)
 	{
+		// Packet ids start again from 0, so nothing sent or received
+		// under the old ones can be told apart from the new ones.
 		mPacketsOutID = 0;
 		mPacketsInID = 0;
+		removeAllReliablePackets(LL_ERR_CIRCUIT_GONE);
+		mRecentlyReceivedReliablePackets.clear();
 		mbAlive = b_alive;
 	}
 	if (b_alive)
@@ -565,19 +488,47 @@ void LLCircuitData::addReliablePacket(S32 mSocket, U8 *buf_ptr, S32 buf_len, LLR
 {
 	LLReliablePacket *packet_info;
 
-	packet_info = new LLReliablePacket(mSocket, buf_ptr, buf_len, params);
-
-	mUnackedPacketCount++;
-	mUnackedPacketBytes += packet_info->mBufferLength;
-
-	if (params && params->mRetries)
+	if (!mReliablePacketPool.empty())
 	{
-		mUnackedPackets[packet_info->mPacketID] = packet_info;
+		packet_info = mReliablePacketPool.back();
+		mReliablePacketPool.pop_back();
+		packet_info->init(mSocket, buf_ptr, buf_len, params);
 	}
 	else
 	{
-		mFinalRetryPackets[packet_info->mPacketID] = packet_info;
+		packet_info = new LLReliablePacket(mSocket, buf_ptr, buf_len, params);
+	}
+
+	// Without retries it goes straight onto its final retry. Anything still
+	// waiting under the same id or too far behind to keep track of alongside
+	// it has had it.
+	TPACKETID packet_id = packet_info->mPacketID;
+	LLReliablePacket *stale = mUnackedPackets.get(packet_id);
+	if (stale)
+	{
+		gMessageSystem->mFailedResendPackets++;
+		removeReliablePacket(stale, LL_ERR_TCP_TIMEOUT);
+	}
+	if (!mUnackedPackets.empty() && LLPacketIDWindow<LLReliablePacket*>::isOlder(packet_id, mUnackedPackets.getOldestID()))
+	{
+		// The ids went backwards, so the ones in flight belong to the
+		// numbering before it restarted.
+		llwarns << mHost << " packet id " << packet_id << " is behind the oldest unacked packet "
+				<< mUnackedPackets.getOldestID() << ", giving up on those in flight" << llendl;
+		removeAllReliablePackets(LL_ERR_TCP_TIMEOUT);
+	}
+	while (!mUnackedPackets.empty() && !mUnackedPackets.fits(packet_id))
+	{
+		stale = mUnackedPackets.get(mUnackedPackets.getOldestID());
+		llwarns << mHost << " has too many reliable packets in flight, giving up on "
+				<< stale->mPacketID << llendl;
+		gMessageSystem->mFailedResendPackets++;
+		removeReliablePacket(stale, LL_ERR_TCP_TIMEOUT);
 	}
+
+	mUnackedPacketCount++;
+	mUnackedPacketBytes += packet_info->mBufferLength;
+	mUnackedPackets.set(packet_id, packet_info);
 }
 
 
@@ -600,7 +551,28 @@ void LLCircuit::resendUnackedPackets(S32& unacked_list_length, S32& unacked_list
 
 BOOL LLCircuitData::isDuplicateResend(TPACKETID packetnum)
 {
-	return (mRecentlyReceivedReliablePackets.find(packetnum) != mRecentlyReceivedReliablePackets.end());
+	return mRecentlyReceivedReliablePackets.get(packetnum);
+}
+
+
+void LLCircuitData::addRecentlyReceivedReliablePacket(TPACKETID packetnum)
+{
+	if (!mRecentlyReceivedReliablePackets.fits(packetnum))
+	{
+		if (LLPacketIDWindow<bool>::isOlder(packetnum, mRecentlyReceivedReliablePackets.getOldestID()))
+		{
+			// Far older than anything we still remember, the other end
+			// has long since had it acked
+			return;
+		}
+		// The other end hasn't told us its oldest unacked packet for a
+		// long time, forget the oldest
+		while (!mRecentlyReceivedReliablePackets.fits(packetnum))
+		{
+			mRecentlyReceivedReliablePackets.erase(mRecentlyReceivedReliablePackets.getOldestID());
+		}
+	}
+	mRecentlyReceivedReliablePackets.set(packetnum, true);
 }
 
 
@@ -711,7 +683,7 @@ void LLCircuitData::checkPacketInID(TPACKETID id, BOOL receive_resent)
 		const U8 width = 24;
 		gap = LLModularMath::subtract<width>(mPacketsInID, id);
 
-		if (mPotentialLostPackets.find(id) != mPotentialLostPackets.end())
+		if (mPotentialLostPackets.get(id))
 		{
 			if(gMessageSystem->mVerboseLog)
 			{
@@ -740,7 +712,12 @@ void LLCircuitData::checkPacketInID(TPACKETID id, BOOL receive_resent)
 					}
 
 //						llinfos << "adding potential lost: " << index << llendl;
-					mPotentialLostPackets[index] = time;
+					while (!mPotentialLostPackets.fits(index))
+					{
+						// missing for so many packets it's surely lost
+						countLostPacket(mPotentialLostPackets.getOldestID());
+					}
+					mPotentialLostPackets.set(index, time);
 					index++;
 					index = index % LL_MAX_OUT_PACKET_ID;
 					gap_count++;
@@ -861,92 +838,21 @@ BOOL LLCircuitData::updateWatchDogTimers(LLMessageSystem *msgsys)
 	// for the packet that it was out of order with was received BEFORE
 	// the ping was sent.
 
-	// Find the current oldest reliable packetID
-	// This is to handle the case if we actually manage to wrap our
-	// packet IDs - the oldest will actually have a higher packet ID
-	// than the current.
-	BOOL wrapped = FALSE;
-	reliable_iter iter;
-	iter = mUnackedPackets.upper_bound(getPacketOutID());
-	if (iter == mUnackedPackets.end())
-	{
-		// Nothing AFTER this one, so we want the lowest packet ID
-		// then.
-		iter = mUnackedPackets.begin();
-		wrapped = TRUE;
-	}
-
-	TPACKETID packet_id = 0;
-
-	// Check against the "final" packets
-	BOOL wrapped_final = FALSE;
-	reliable_iter iter_final;
-	iter_final = mFinalRetryPackets.upper_bound(getPacketOutID());
-	if (iter_final == mFinalRetryPackets.end())
+	// Find the current oldest reliable packetID. The window keeps its
+	// packets in the order they were sent, so this holds even if we have
+	// wrapped our packet IDs.
+	TPACKETID packet_id;
+	if (mUnackedPackets.empty())
 	{
-		iter_final = mFinalRetryPackets.begin();
-		wrapped_final = TRUE;
-	}
-
-	//llinfos << mHost << " - unacked count " << mUnackedPackets.size() << llendl;
-	//llinfos << mHost << " - final count " << mFinalRetryPackets.size() << llendl;
-	if (wrapped != wrapped_final)
-	{
-		// One of the "unacked" or "final" lists hasn't wrapped.  Whichever one
-		// hasn't has the oldest packet.
-		if (!wrapped)
-		{
-			// Hasn't wrapped, so the one on the
-			// unacked packet list is older
-			packet_id = iter->first;
-			//llinfos << mHost << ": nowrapped unacked" << llendl;
-		}
-		else
-		{
-			packet_id = iter_final->first;
-			//llinfos << mHost << ": nowrapped final" << llendl;
-		}
+		// Wow!  No unacked packets at all!
+		// Send the ID of the last packet we sent out.
+		// This will flush all of the destination's
+		// unacked packets, theoretically.
+		packet_id = getPacketOutID();
 	}
 	else
 	{
-		// They both wrapped, we can just use the minimum of the two.
-		if ((iter == mUnackedPackets.end()) && (iter_final == mFinalRetryPackets.end()))
-		{
-			// Wow!  No unacked packets at all!
-			// Send the ID of the last packet we sent out.
-			// This will flush all of the destination's
-			// unacked packets, theoretically.
-			//llinfos << mHost << ": No unacked!" << llendl;
-			packet_id = getPacketOutID();
-		}
-		else
-		{
-			BOOL had_unacked = FALSE;
-			if (iter != mUnackedPackets.end())
-			{
-				// Unacked list has the lowest so far
-				packet_id = iter->first;
-				had_unacked = TRUE;
-				//llinfos << mHost << ": Unacked" << llendl;
-			}
-
-			if (iter_final != mFinalRetryPackets.end())
-			{
-				// Use the lowest of the unacked list and the final list
-				if (had_unacked)
-				{
-					// Both had a packet, use the lowest.
-					packet_id = llmin(packet_id, iter_final->first);
-					//llinfos << mHost << ": Min of unacked/final" << llendl;
-				}
-				else
-				{
-					// Only the final had a packet, use it.
-					packet_id = iter_final->first;
-					//llinfos << mHost << ": Final!" << llendl;
-				}
-			}
-		}
+		packet_id = mUnackedPackets.getOldestID();
 	}
 
 	// Send off the another ping.
@@ -961,30 +867,19 @@ BOOL LLCircuitData::updateWatchDogTimers(LLMessageSystem *msgsys)
 	// Check to see if anything on our lost list is old enough to
 	// be considered lost
 
-	LLCircuitData::packet_time_map::iterator it;
 	U64 timeout = (U64)(1000000.0*llmin(LL_MAX_LOST_TIMEOUT, getPingDelayAveraged() * LL_LOST_TIMEOUT_FACTOR));
 
 	U64 mt_usec = LLMessageSystem::getMessageTimeUsecs();
-	for (it = mPotentialLostPackets.begin(); it != mPotentialLostPackets.end(); )
+	TPACKETID oldest_id = mPotentialLostPackets.getOldestID();
+	U32 span = mPotentialLostPackets.getSpan();
+	for (U32 i = 0; i < span; ++i)
 	{
-		U64 delta_t_usec = mt_usec - (*it).second;
-		if (delta_t_usec > timeout)
+		TPACKETID lost_id = (oldest_id + i) % LL_MAX_OUT_PACKET_ID;
+		U64 time = mPotentialLostPackets.get(lost_id);
+		if (time && mt_usec - time > timeout)
 		{
 			// let's call this one a loss!
-			mPacketsLost++;
-			gMessageSystem->mDroppedPackets++;
-			if(gMessageSystem->mVerboseLog)
-			{
-				std::ostringstream str;
-				str << "MSG: <- " << mHost << "\tLOST PACKET:\t"
-					<< (*it).first;
-				llinfos << str.str() << llendl;
-			}
-			mPotentialLostPackets.erase(it++);
-		}
-		else
-		{
-			++it;
+			countLostPacket(lost_id);
 		}
 	}
 
@@ -992,52 +887,29 @@ BOOL LLCircuitData::updateWatchDogTimers(LLMessageSystem *msgsys)
 }
 
 
-void LLCircuitData::clearDuplicateList(TPACKETID oldest_id)
+void LLCircuitData::countLostPacket(TPACKETID packet_id)
 {
-	// purge old data from the duplicate suppression queue
-
-	// we want to KEEP all x where oldest_id <= x <= last incoming packet, and delete everything else.
-
-	//llinfos << mHost << ": clearing before oldest " << oldest_id << llendl;
-	//llinfos << "Recent list before: " << mRecentlyReceivedReliablePackets.size() << llendl;
-	if (oldest_id < mHighestPacketID)
+	mPacketsLost++;
+	gMessageSystem->mDroppedPackets++;
+	if(gMessageSystem->mVerboseLog)
 	{
-		// Clean up everything with a packet ID less than oldest_id.
-		packet_time_map::iterator pit_start;
-		packet_time_map::iterator pit_end;
-		pit_start = mRecentlyReceivedReliablePackets.begin();
-		pit_end = mRecentlyReceivedReliablePackets.lower_bound(oldest_id);
-		mRecentlyReceivedReliablePackets.erase(pit_start, pit_end);
+		std::ostringstream str;
+		str << "MSG: <- " << mHost << "\tLOST PACKET:\t"
+			<< packet_id;
+		llinfos << str.str() << llendl;
 	}
+	mPotentialLostPackets.erase(packet_id);
+}
 
-	// Do timeout checks on everything with an ID > mHighestPacketID.
-	// This should be empty except for wrapping IDs.  Thus, this should be
-	// highly rare.
-	U64 mt_usec = LLMessageSystem::getMessageTimeUsecs();
 
-	packet_time_map::iterator pit;
-	for(pit = mRecentlyReceivedReliablePackets.upper_bound(mHighestPacketID);
-		pit != mRecentlyReceivedReliablePackets.end(); )
-	{
-		// Validate that the packet ID seems far enough away
-		if ((pit->first - mHighestPacketID) < 100)
-		{
-			llwarns << "Probably incorrectly timing out non-wrapped packets!" << llendl;
-		}
-		U64 delta_t_usec = mt_usec - (*pit).second;
-		F64 delta_t_sec = delta_t_usec * SEC_PER_USEC;
-		if (delta_t_sec > LL_DUPLICATE_SUPPRESSION_TIMEOUT)
-		{
-			// enough time has elapsed we're not likely to get a duplicate on this one
-			llinfos << "Clearing " << pit->first << " from recent list" << llendl;
-			mRecentlyReceivedReliablePackets.erase(pit++);
-		}
-		else
-		{
-			++pit;
-		}
-	}
-	//llinfos << "Recent list after: " << mRecentlyReceivedReliablePackets.size() << llendl;
+void LLCircuitData::clearDuplicateList(TPACKETID oldest_id)
+{
+	// purge old data from the duplicate suppression queue
+
+	// we want to KEEP all x where oldest_id <= x <= last incoming packet, and delete everything else.
+	// The window compares ids allowing for wrapping, so there is nothing
+	// left over past a wrap to time out.
+	mRecentlyReceivedReliablePackets.eraseBefore(oldest_id);
 }
 
 BOOL LLCircuitData::checkCircuitTimeout()
@@ -38,6 +38,7 @@
 #include "net.h"
 #include "llhost.h"
 #include "llpacketack.h"
+#include "llpacketidwindow.h"
 #include "lluuid.h"
 #include "llthrottle.h"
 #include "llstat.h"
@@ -51,8 +52,6 @@ const F32 LL_AVERAGED_PING_MIN =  100;    // msec  // IW: increased to avoid ret
 
 const U32 INITIAL_PING_VALUE_MSEC = 1000; // initial value for the ping delay, or for ping delay for an unknown circuit
 
-const TPACKETID LL_MAX_OUT_PACKET_ID = 0x01000000;
-
 // 0 - flags
 // [1,4] - packetid
 // 5 - data offset (after message name)
@@ -61,6 +60,13 @@ const U8 LL_PACKET_ID_SIZE = 6;
 const S32 LL_MAX_RESENT_PACKETS_PER_FRAME = 100;
 const S32 LL_MAX_ACKED_PACKETS_PER_FRAME = 200;
 
+// Most packet ids from the oldest to the newest in flight that a circuit
+// keeps track of, each way. Far more than the 512k bytes of unacked packets
+// that make resendUnackedPackets() start giving up on them.
+const U32 LL_MAX_PACKET_ID_WINDOW = 65536;
+// Acked reliable packets kept for reuse
+const U32 LL_RELIABLE_PACKET_POOL_SIZE = 64;
+
 //
 // Prototypes and Predefines
 //
@@ -177,6 +183,8 @@ protected:
 
 	void			addReliablePacket(S32 mSocket, U8 *buf_ptr, S32 buf_len, LLReliablePacketParams *params);
 	BOOL			isDuplicateResend(TPACKETID packetnum);
+	// Remembers a reliable packet for isDuplicateResend()
+	void			addRecentlyReceivedReliablePacket(TPACKETID packetnum);
 	// Call this method when a reliable message comes in - this will
 	// correctly place the packet in the correct list to be acked
 	// later. RAack = requested ack
@@ -190,6 +198,13 @@ protected:
 	void			setAlive(BOOL b_alive);
 	void			setAllowTimeout(BOOL allow);
 
+	// Removes an unacked packet, runs its callback with error and puts it
+	// back in the pool
+	void			removeReliablePacket(LLReliablePacket *packetp, S32 error);
+	// removeReliablePacket() for every unacked packet
+	void			removeAllReliablePackets(S32 error);
+	void			countLostPacket(TPACKETID packet_id);
+
 protected:
 	// Identification for this circuit.
 	LLHost mHost;
@@ -233,17 +248,18 @@ protected:
 	U32		mPingDelay;             // raw ping delay
 	F32		mPingDelayAveraged;     // averaged ping delay (fast attack/slow decay)
 
-	typedef std::map<TPACKETID, U64> packet_time_map;
-
-	packet_time_map							mPotentialLostPackets;
-	packet_time_map							mRecentlyReceivedReliablePackets;
+	// Times the ids skipped by out of order packets were first missed
+	LLPacketIDWindow<U64>					mPotentialLostPackets;
+	// Reliable packets received since the oldest one the other end has
+	// not had acked, for duplicate suppression
+	LLPacketIDWindow<bool>					mRecentlyReceivedReliablePackets;
 	std::vector<TPACKETID> mAcks;
 
-	typedef std::map<TPACKETID, LLReliablePacket *> reliable_map;
-	typedef reliable_map::iterator					reliable_iter;
-
-	reliable_map							mUnackedPackets;
-	reliable_map							mFinalRetryPackets;
+	// Reliable packets waiting for an ack. Those with retries left are
+	// resent until acked, the rest are on their final retry and just wait
+	// for an ack or their timeout.
+	LLPacketIDWindow<LLReliablePacket*>		mUnackedPackets;
+	std::vector<LLReliablePacket*>			mReliablePacketPool;
 
 	S32										mUnackedPacketCount;
 	S32										mUnackedPacketBytes;
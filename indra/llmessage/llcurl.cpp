@@ -44,11 +44,18 @@
 #if SAFE_SSL
 #include <openssl/crypto.h>
 #endif
+#if LL_LINUX
+#include <sys/epoll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
 
 #include "llbufferstream.h"
 #include "llstl.h"
 #include "llsdserialize.h"
 #include "llthread.h"
+#include "lltimer.h"
 
 //////////////////////////////////////////////////////////////////////////////
 /*
@@ -72,6 +79,12 @@ static const U32 EASY_HANDLE_POOL_SIZE		= 5;
 static const S32 MULTI_PERFORM_CALL_REPEAT	= 5;
 static const S32 CURL_REQUEST_TIMEOUT = 30; // seconds
 static const S32 MAX_ACTIVE_REQUEST_COUNT = 100;
+// a PumpThread's queue size less one, the size is a power of two and
+// the most requests it has out at once
+static const U32 PUMP_QUEUE_MASK = 255;
+static const S32 PUMP_MAX_EVENTS = 64;
+// longest the pump thread waits on its sockets without looking at curl's timers
+static const S32 PUMP_IDLE_WAIT_MS = 100;
 
 // DEBUG //
 S32 gCurlEasyCount = 0;
@@ -138,6 +151,17 @@ void LLCurl::Responder::setURL(const std::string& url)
 	mURL = url;
 }
 
+// virtual
+bool LLCurl::Responder::receivedData(U32 status, const U8* data, S32 length)
+{
+	return false;
+}
+
+// virtual
+void LLCurl::Responder::receivedTransferInfo(const TransferInfo& info)
+{
+}
+
 // virtual
 void LLCurl::Responder::completedRaw(
 	U32 status,
@@ -340,6 +364,7 @@ void LLCurl::Easy::getTransferInfo(LLCurl::TransferInfo* info)
 {
 	curl_easy_getinfo(mCurlEasyHandle, CURLINFO_SIZE_DOWNLOAD, &info->mSizeDownload);
 	curl_easy_getinfo(mCurlEasyHandle, CURLINFO_TOTAL_TIME, &info->mTotalTime);
+	curl_easy_getinfo(mCurlEasyHandle, CURLINFO_STARTTRANSFER_TIME, &info->mStartTransferTime);
 	curl_easy_getinfo(mCurlEasyHandle, CURLINFO_SPEED_DOWNLOAD, &info->mSpeedDownload);
 }
 
@@ -361,6 +386,9 @@ U32 LLCurl::Easy::report(CURLcode code)
 
 	if (mResponder)
 	{	
+		LLCurl::TransferInfo info;
+		getTransferInfo(&info);
+		mResponder->receivedTransferInfo(info);
 		mResponder->completedRaw(responseCode, responseReason, mChannels, mOutput);
 		mResponder = NULL;
 	}
@@ -506,6 +534,9 @@ public:
 	
 	CURLMsg* info_read(S32* msgs_in_queue);
 
+	void setMaxConnections(S32 max_connections);
+	void setPipelining(bool pipelining);
+
 	S32 mQueued;
 	S32 mErrorCount;
 	
@@ -564,6 +595,16 @@ CURLMsg* LLCurl::Multi::info_read(S32* msgs_in_queue)
 }
 
 
+void LLCurl::Multi::setMaxConnections(S32 max_connections)
+{
+	curl_multi_setopt(mCurlMultiHandle, CURLMOPT_MAXCONNECTS, (long)max_connections);
+}
+
+void LLCurl::Multi::setPipelining(bool pipelining)
+{
+	curl_multi_setopt(mCurlMultiHandle, CURLMOPT_PIPELINING, pipelining ? 1L : 0L);
+}
+
 S32 LLCurl::Multi::perform()
 {
 	S32 q = 0;
@@ -671,6 +712,510 @@ void LLCurl::Multi::removeEasy(Easy* easy)
 	easyFree(easy);
 }
 
+////////////////////////////////////////////////////////////////////////////
+// Runs a multi handle on a thread of its own. The thread waits on the
+// transfers' sockets with epoll and drives them with
+// curl_multi_socket_action(), so the owning thread never spends time in
+// libcurl: it hands prepared Easy handles over, takes back the finished
+// ones and reports them to their responders itself.
+//
+// Each queue has exactly one producer and one consumer and neither side
+// locks, as with LLPacketIOThread's rings. The owner never has more
+// requests out than a queue holds, so neither can overflow.
+
+class LLCurl::PumpThread : public LLThread
+{
+	LOG_CLASS(PumpThread);
+public:
+	PumpThread(S32 max_connections, bool pipelining);
+	~PumpThread();
+
+	// FALSE where there is no epoll, the multi is then driven from
+	// LLCurlRequest::process() as before
+	static BOOL isAvailable();
+	// FALSE if the epoll or the wakeup pipe could not be created, the
+	// thread must not be started then
+	BOOL isValid() const;
+
+	// Owning thread
+	Easy* allocEasy();
+	bool addEasy(Easy* easy);
+	// Reports finished requests until max_time_ms has passed, 0 for no limit
+	S32 process(U32 max_time_ms);
+	S32 getQueued() const { return mOutstanding; }
+
+	/*virtual*/ void shutdown();
+
+protected:
+	/*virtual*/ void run();
+
+private:
+	template<class T>
+	class Queue
+	{
+	public:
+		Queue() : mHead(0), mTail(0) {}
+
+		// producer side
+		bool push(const T& item)
+		{
+			if (getCount() > PUMP_QUEUE_MASK)
+			{
+				return false;
+			}
+			mItems[mHead & PUMP_QUEUE_MASK] = item;
+			// apr_atomic_inc32() is a full barrier, the item is written
+			// before the consumer sees it
+			mHead++;
+			return true;
+		}
+
+		// consumer side
+		bool pop(T& item)
+		{
+			if (!getCount())
+			{
+				return false;
+			}
+			item = mItems[mTail & PUMP_QUEUE_MASK];
+			mTail++;
+			return true;
+		}
+
+		U32 getCount() { return mHead - mTail; }
+
+	private:
+		T mItems[PUMP_QUEUE_MASK + 1];
+		LLAtomicU32 mHead;	// producer
+		LLAtomicU32 mTail;	// consumer
+	};
+
+	struct Completion
+	{
+		Easy*		mEasy;
+		CURLcode	mResult;
+	};
+
+	void easyFree(Easy* easy);
+	void wakePumpThread();
+
+	// Pump thread
+	void addQueued();
+	void checkDone();
+	void socketAction(curl_socket_t socket, int ev_bitmask);
+	static int socketCallback(CURL* easy, curl_socket_t socket, int what, void* userp, void* socketp);
+	static int timerCallback(CURLM* multi, long timeout_ms, void* userp);
+
+	CURLM* mCurlMultiHandle;
+	Queue<Easy*> mRequests;
+	Queue<Completion> mCompleted;
+
+	// owning thread only
+	S32 mOutstanding;
+	typedef std::vector<Easy*> easy_free_list_t;
+	easy_free_list_t mEasyFreeList;
+
+	// pump thread only, until it stops
+	typedef std::set<Easy*> easy_active_list_t;
+	easy_active_list_t mEasyActiveList;
+	int mEpoll;
+	int mWakePipe[2];
+	U64 mTimerExpiry;	// usec, 0 for none
+};
+
+LLCurl::PumpThread::PumpThread(S32 max_connections, bool pipelining)
+	: LLThread("Curl Pump"),
+	  mOutstanding(0),
+	  mEpoll(-1),
+	  mTimerExpiry(0)
+{
+	mCurlMultiHandle = curl_multi_init();
+	llassert_always(mCurlMultiHandle);
+	++gCurlMultiCount;
+	if (max_connections > 0)
+	{
+		curl_multi_setopt(mCurlMultiHandle, CURLMOPT_MAXCONNECTS, (long)max_connections);
+	}
+	curl_multi_setopt(mCurlMultiHandle, CURLMOPT_PIPELINING, pipelining ? 1L : 0L);
+	curl_multi_setopt(mCurlMultiHandle, CURLMOPT_SOCKETFUNCTION, &PumpThread::socketCallback);
+	curl_multi_setopt(mCurlMultiHandle, CURLMOPT_SOCKETDATA, (void*)this);
+	curl_multi_setopt(mCurlMultiHandle, CURLMOPT_TIMERFUNCTION, &PumpThread::timerCallback);
+	curl_multi_setopt(mCurlMultiHandle, CURLMOPT_TIMERDATA, (void*)this);
+
+	mWakePipe[0] = mWakePipe[1] = -1;
+#if LL_LINUX
+	mEpoll = epoll_create(16);
+	if (mEpoll < 0)
+	{
+		llwarns << "Unable to create curl pump epoll: " << ::strerror(errno) << llendl;
+	}
+	else if (pipe(mWakePipe) == 0)
+	{
+		fcntl(mWakePipe[0], F_SETFL, O_NONBLOCK);
+		fcntl(mWakePipe[1], F_SETFL, O_NONBLOCK);
+		struct epoll_event event;
+		memset(&event, 0, sizeof(event));
+		event.events = EPOLLIN;
+		event.data.fd = mWakePipe[0];
+		epoll_ctl(mEpoll, EPOLL_CTL_ADD, mWakePipe[0], &event);
+	}
+	else
+	{
+		llwarns << "Unable to create curl pump wakeup pipe: " << ::strerror(errno) << llendl;
+		mWakePipe[0] = mWakePipe[1] = -1;
+	}
+#endif
+}
+
+LLCurl::PumpThread::~PumpThread()
+{
+	shutdown();
+
+	// Requests in flight are dropped without completing, as when a
+	// LLCurl::Multi is deleted.
+	for (easy_active_list_t::iterator iter = mEasyActiveList.begin();
+		 iter != mEasyActiveList.end(); ++iter)
+	{
+		Easy* easy = *iter;
+		curl_multi_remove_handle(mCurlMultiHandle, easy->getCurlHandle());
+		delete easy;
+	}
+	mEasyActiveList.clear();
+	Easy* easy;
+	while (mRequests.pop(easy))
+	{
+		delete easy;
+	}
+	Completion completion;
+	while (mCompleted.pop(completion))
+	{
+		delete completion.mEasy;
+	}
+	for_each(mEasyFreeList.begin(), mEasyFreeList.end(), DeletePointer());
+	mEasyFreeList.clear();
+
+	curl_multi_cleanup(mCurlMultiHandle);
+	--gCurlMultiCount;
+
+#if LL_LINUX
+	if (mWakePipe[0] >= 0)
+	{
+		close(mWakePipe[0]);
+		close(mWakePipe[1]);
+	}
+	if (mEpoll >= 0)
+	{
+		close(mEpoll);
+	}
+#endif
+}
+
+// static
+BOOL LLCurl::PumpThread::isAvailable()
+{
+#if LL_LINUX
+	return TRUE;
+#else
+	return FALSE;
+#endif
+}
+
+BOOL LLCurl::PumpThread::isValid() const
+{
+	return mEpoll >= 0 && mWakePipe[0] >= 0;
+}
+
+void LLCurl::PumpThread::shutdown()
+{
+	if (!isStopped())
+	{
+		setQuitting();
+		wakePumpThread();
+	}
+	LLThread::shutdown();
+}
+
+//============================================================================
+// Owning thread
+
+LLCurl::Easy* LLCurl::PumpThread::allocEasy()
+{
+	if (mOutstanding > (S32)PUMP_QUEUE_MASK)
+	{
+		// both queues are full up with our requests
+		return NULL;
+	}
+	if (mEasyFreeList.empty())
+	{
+		return Easy::getEasy();
+	}
+	Easy* easy = mEasyFreeList.back();
+	mEasyFreeList.pop_back();
+	return easy;
+}
+
+bool LLCurl::PumpThread::addEasy(Easy* easy)
+{
+	// the pump thread finds its Easy from the handle curl gives back
+	easy->setopt(CURLOPT_PRIVATE, (void*)easy);
+	if (!mRequests.push(easy))
+	{
+		// allocEasy() keeps us from getting here
+		easyFree(easy);
+		return false;
+	}
+	mOutstanding++;
+
+	// The pump thread only goes back to sleep after it has seen the queue
+	// empty, so it needs waking when this is the only request in it.
+	if (mRequests.getCount() == 1)
+	{
+		wakePumpThread();
+	}
+	return true;
+}
+
+S32 LLCurl::PumpThread::process(U32 max_time_ms)
+{
+	LLTimer timer;
+	S32 processed = 0;
+	Completion completion;
+	while (mCompleted.pop(completion))
+	{
+		mOutstanding--;
+		++processed;
+		completion.mEasy->report(completion.mResult);
+		easyFree(completion.mEasy);
+		if (max_time_ms && timer.getElapsedTimeF32() * 1000.f >= (F32)max_time_ms)
+		{
+			// the rest wait for the next call
+			break;
+		}
+	}
+	return processed;
+}
+
+void LLCurl::PumpThread::easyFree(Easy* easy)
+{
+	if (mEasyFreeList.size() < EASY_HANDLE_POOL_SIZE)
+	{
+		easy->resetState();
+		mEasyFreeList.push_back(easy);
+	}
+	else
+	{
+		delete easy;
+	}
+}
+
+//============================================================================
+// Pump thread
+
+#if LL_LINUX
+
+void LLCurl::PumpThread::wakePumpThread()
+{
+	if (mWakePipe[1] >= 0)
+	{
+		char byte = 0;
+		if (write(mWakePipe[1], &byte, 1) < 0)
+		{
+			// pipe full: a wakeup is already pending
+		}
+	}
+}
+
+void LLCurl::PumpThread::run()
+{
+	struct epoll_event events[PUMP_MAX_EVENTS];
+	while (!isQuitting())
+	{
+		addQueued();
+
+		S32 timeout = PUMP_IDLE_WAIT_MS;
+		if (mTimerExpiry)
+		{
+			U64 now = totalTime();
+			timeout = mTimerExpiry > now ? (S32)llmin((mTimerExpiry - now + 999) / 1000, (U64)PUMP_IDLE_WAIT_MS) : 0;
+		}
+		S32 ready = epoll_wait(mEpoll, events, PUMP_MAX_EVENTS, timeout);
+		if (ready < 0 && errno != EINTR)
+		{
+			llwarns << "epoll_wait() failed: " << ::strerror(errno) << llendl;
+			ms_sleep(PUMP_IDLE_WAIT_MS);
+			continue;
+		}
+
+		for (S32 i = 0; i < ready; ++i)
+		{
+			if (events[i].data.fd == mWakePipe[0])
+			{
+				char drain[64];	/* Flawfinder: ignore */
+				while (read(mWakePipe[0], drain, sizeof(drain)) > 0)
+				{
+				}
+				continue;
+			}
+			int ev_bitmask = 0;
+			if (events[i].events & EPOLLIN)
+			{
+				ev_bitmask |= CURL_CSELECT_IN;
+			}
+			if (events[i].events & EPOLLOUT)
+			{
+				ev_bitmask |= CURL_CSELECT_OUT;
+			}
+			if (events[i].events & (EPOLLERR | EPOLLHUP))
+			{
+				ev_bitmask |= CURL_CSELECT_ERR;
+			}
+			socketAction(events[i].data.fd, ev_bitmask);
+		}
+
+		// Run the timers on an idle wait too, in case curl wanted a call
+		// and did not say so.
+		if (!ready || (mTimerExpiry && mTimerExpiry <= totalTime()))
+		{
+			mTimerExpiry = 0;
+			socketAction(CURL_SOCKET_TIMEOUT, 0);
+		}
+		checkDone();
+	}
+}
+
+void LLCurl::PumpThread::addQueued()
+{
+	Easy* easy;
+	while (mRequests.pop(easy))
+	{
+		CURLMcode mcode = curl_multi_add_handle(mCurlMultiHandle, easy->getCurlHandle());
+		if (mcode != CURLM_OK)
+		{
+			llwarns << "Curl Error: " << curl_multi_strerror(mcode) << llendl;
+			// reported as a failed transfer
+			Completion completion = { easy, CURLE_FAILED_INIT };
+			mCompleted.push(completion);
+			continue;
+		}
+		// adding the handle set a timer to start it
+		mEasyActiveList.insert(easy);
+	}
+}
+
+void LLCurl::PumpThread::socketAction(curl_socket_t socket, int ev_bitmask)
+{
+	int running = 0;
+	CURLMcode code;
+	do
+	{
+		code = curl_multi_socket_action(mCurlMultiHandle, socket, ev_bitmask, &running);
+	} while (code == CURLM_CALL_MULTI_PERFORM);
+}
+
+void LLCurl::PumpThread::checkDone()
+{
+	CURLMsg* msg;
+	int msgs_in_queue;
+	while ((msg = curl_multi_info_read(mCurlMultiHandle, &msgs_in_queue)))
+	{
+		if (msg->msg != CURLMSG_DONE)
+		{
+			continue;
+		}
+		// msg is freed by curl_multi_remove_handle()
+		CURL* handle = msg->easy_handle;
+		CURLcode result = msg->data.result;
+		Easy* easy = NULL;
+		curl_easy_getinfo(handle, CURLINFO_PRIVATE, (char**)&easy);
+		curl_multi_remove_handle(mCurlMultiHandle, handle);
+		if (!easy || !mEasyActiveList.erase(easy))
+		{
+			llwarns << "cleaned up curl request completed!" << llendl;
+			continue;
+		}
+		// The queue has room, the owner never has more out than it holds.
+		// Once it is in, the owner has the handle to itself.
+		Completion completion = { easy, result };
+		mCompleted.push(completion);
+	}
+}
+
+//static
+int LLCurl::PumpThread::socketCallback(CURL* easy, curl_socket_t socket, int what, void* userp, void* socketp)
+{
+	PumpThread* self = (PumpThread*)userp;
+	struct epoll_event event;
+	memset(&event, 0, sizeof(event));
+	event.data.fd = socket;
+	if (what == CURL_POLL_REMOVE)
+	{
+		// curl may have closed it already, which took it out of the set
+		epoll_ctl(self->mEpoll, EPOLL_CTL_DEL, socket, &event);
+		return 0;
+	}
+	if (what & CURL_POLL_IN)
+	{
+		event.events |= EPOLLIN;
+	}
+	if (what & CURL_POLL_OUT)
+	{
+		event.events |= EPOLLOUT;
+	}
+	if (epoll_ctl(self->mEpoll, EPOLL_CTL_MOD, socket, &event) < 0 && errno == ENOENT)
+	{
+		epoll_ctl(self->mEpoll, EPOLL_CTL_ADD, socket, &event);
+	}
+	return 0;
+}
+
+//static
+int LLCurl::PumpThread::timerCallback(CURLM* multi, long timeout_ms, void* userp)
+{
+	PumpThread* self = (PumpThread*)userp;
+	// -1 deletes the timer, 0 means as soon as we can
+	self->mTimerExpiry = timeout_ms < 0 ? 0 : llmax(totalTime() + (U64)timeout_ms * 1000, (U64)1);
+	return 0;
+}
+
+#else // LL_LINUX
+
+// There is no epoll here and isAvailable() says so, so the thread is never
+// started.
+
+void LLCurl::PumpThread::wakePumpThread()
+{
+}
+
+void LLCurl::PumpThread::run()
+{
+}
+
+void LLCurl::PumpThread::addQueued()
+{
+}
+
+void LLCurl::PumpThread::socketAction(curl_socket_t socket, int ev_bitmask)
+{
+}
+
+void LLCurl::PumpThread::checkDone()
+{
+}
+
+//static
+int LLCurl::PumpThread::socketCallback(CURL* easy, curl_socket_t socket, int what, void* userp, void* socketp)
+{
+	return 0;
+}
+
+//static
+int LLCurl::PumpThread::timerCallback(CURLM* multi, long timeout_ms, void* userp)
+{
+	return 0;
+}
+
+#endif // LL_LINUX
+
 //static
 std::string LLCurl::strerror(CURLcode errorcode)
 {
@@ -691,7 +1236,11 @@ std::string LLCurl::strerror(CURLcode errorcode)
 
 LLCurlRequest::LLCurlRequest() :
 	mActiveMulti(NULL),
-	mActiveRequestCount(0)
+	mPumpThread(NULL),
+	mActiveRequestCount(0),
+	mPersistent(false),
+	mMaxConnections(0),
+	mPipelining(false)
 {
 	mThreadID = LLThread::currentID();
 }
@@ -700,12 +1249,48 @@ LLCurlRequest::~LLCurlRequest()
 {
 	llassert_always(mThreadID == LLThread::currentID());
 	for_each(mMultiSet.begin(), mMultiSet.end(), DeletePointer());
+	delete mPumpThread;
+}
+
+void LLCurlRequest::setPersistent(S32 max_connections, bool pipelining)
+{
+	llassert_always(!mActiveMulti && !mPumpThread);
+	mPersistent = true;
+	mMaxConnections = max_connections;
+	mPipelining = pipelining;
+}
+
+bool LLCurlRequest::setThreaded()
+{
+	llassert_always(!mActiveMulti && !mPumpThread);
+	if (!LLCurl::PumpThread::isAvailable())
+	{
+		return false;
+	}
+	mPumpThread = new LLCurl::PumpThread(mMaxConnections, mPipelining);
+	if (!mPumpThread->isValid())
+	{
+		delete mPumpThread;
+		mPumpThread = NULL;
+		return false;
+	}
+	mPersistent = true;
+	mPumpThread->start();
+	return true;
 }
 
 void LLCurlRequest::addMulti()
 {
 	llassert_always(mThreadID == LLThread::currentID());
 	LLCurl::Multi* multi = new LLCurl::Multi();
+	if (mPersistent)
+	{
+		if (mMaxConnections > 0)
+		{
+			multi->setMaxConnections(mMaxConnections);
+		}
+		multi->setPipelining(mPipelining);
+	}
 	mMultiSet.insert(multi);
 	mActiveMulti = multi;
 	mActiveRequestCount = 0;
@@ -713,9 +1298,17 @@ void LLCurlRequest::addMulti()
 
 LLCurl::Easy* LLCurlRequest::allocEasy()
 {
+	if (mPumpThread)
+	{
+		return mPumpThread->allocEasy();
+	}
+
+	// A fresh multi starts with no open connections, a persistent one is
+	// kept through errors, libcurl closes connections that went bad itself.
 	if (!mActiveMulti ||
-		mActiveRequestCount	>= MAX_ACTIVE_REQUEST_COUNT ||
-		mActiveMulti->mErrorCount > 0)
+		(!mPersistent &&
+		 (mActiveRequestCount >= MAX_ACTIVE_REQUEST_COUNT ||
+		  mActiveMulti->mErrorCount > 0)))
 	{
 		addMulti();
 	}
@@ -727,6 +1320,10 @@ LLCurl::Easy* LLCurlRequest::allocEasy()
 
 bool LLCurlRequest::addEasy(LLCurl::Easy* easy)
 {
+	if (mPumpThread)
+	{
+		return mPumpThread->addEasy(easy);
+	}
 	llassert_always(mActiveMulti);
 	bool res = mActiveMulti->addEasy(easy);
 	return res;
@@ -787,9 +1384,13 @@ bool LLCurlRequest::post(const std::string& url,
 }
 	
 // Note: call once per frame
-S32 LLCurlRequest::process()
+S32 LLCurlRequest::process(U32 max_time_ms)
 {
 	llassert_always(mThreadID == LLThread::currentID());
+	if (mPumpThread)
+	{
+		return mPumpThread->process(max_time_ms);
+	}
 	S32 res = 0;
 	for (curlmulti_set_t::iterator iter = mMultiSet.begin();
 		 iter != mMultiSet.end(); )
@@ -810,6 +1411,10 @@ S32 LLCurlRequest::process()
 S32 LLCurlRequest::getQueued()
 {
 	llassert_always(mThreadID == LLThread::currentID());
+	if (mPumpThread)
+	{
+		return mPumpThread->getQueued();
+	}
 	S32 queued = 0;
 	for (curlmulti_set_t::iterator iter = mMultiSet.begin();
 		 iter != mMultiSet.end(); )
@@ -54,12 +54,14 @@ class LLCurl
 public:
 	class Easy;
 	class Multi;
+	class PumpThread;
 
 	struct TransferInfo
 	{
-		TransferInfo() : mSizeDownload(0.0), mTotalTime(0.0), mSpeedDownload(0.0) {}
+		TransferInfo() : mSizeDownload(0.0), mTotalTime(0.0), mStartTransferTime(0.0), mSpeedDownload(0.0) {}
 		F64 mSizeDownload;
 		F64 mTotalTime;
+		F64 mStartTransferTime;	// seconds to the first byte of the response
 		F64 mSpeedDownload;
 	};
 	
@@ -91,6 +93,15 @@ public:
 		virtual void result(const LLSD& content);
 			//< called by completed for good status codes.
 
+		virtual bool receivedData(U32 status, const U8* data, S32 length);
+			/**< Called with each piece of the body as it arrives, for
+			   requests made through LLHTTPClient. Return true if the data
+			   has been used up, in which case completedRaw() won't see it.
+			*/
+
+		virtual void receivedTransferInfo(const TransferInfo& info);
+			//< Called just before completedRaw() with the timings of the transfer
+
 		virtual void completedRaw(
 			U32 status,
 			const std::string& reason,
@@ -199,10 +210,26 @@ public:
 	LLCurlRequest();
 	~LLCurlRequest();
 
+	// Keeps every request on one multi handle, so connections stay open
+	// between requests to the same host, up to max_connections of them (0
+	// for libcurl's default), and lets HTTP/1.1 requests be pipelined on
+	// them. Call before the first request.
+	void setPersistent(S32 max_connections, bool pipelining);
+
+	// Runs the transfers on a thread of their own, which owns the multi
+	// handle and waits on its sockets, so process() only hands finished
+	// responses to their responders. Persistent, call setPersistent() first
+	// to set its options. Returns false where there is no such thread, the
+	// transfers then run in process() as before. Call before the first
+	// request.
+	bool setThreaded();
+
 	void get(const std::string& url, LLCurl::ResponderPtr responder);
 	bool getByteRange(const std::string& url, const headers_t& headers, S32 offset, S32 length, LLCurl::ResponderPtr responder);
 	bool post(const std::string& url, const headers_t& headers, const LLSD& data, LLCurl::ResponderPtr responder);
-	S32  process();
+	// Completes finished requests, stopping after max_time_ms if there
+	// are still more when running threaded, 0 for no limit
+	S32  process(U32 max_time_ms = 0);
 	S32  getQueued();
 
 private:
@@ -214,7 +241,11 @@ private:
 	typedef std::set<LLCurl::Multi*> curlmulti_set_t;
 	curlmulti_set_t mMultiSet;
 	LLCurl::Multi* mActiveMulti;
+	LLCurl::PumpThread* mPumpThread;
 	S32 mActiveRequestCount;
+	bool mPersistent;
+	S32 mMaxConnections;
+	bool mPipelining;
 	U32 mThreadID; // debug
 };
 
@@ -71,6 +71,11 @@ namespace
 			mReason = reason;
 		}
 
+		virtual bool receivedData(const U8* data, S32 length)
+		{
+			return mResponder.get() && mResponder->receivedData(mStatus, data, length);
+		}
+
 		virtual void complete(const LLChannelDescriptors& channels,
 							  const buffer_ptr_t& buffer)
 		{
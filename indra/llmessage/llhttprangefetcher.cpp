@@ -0,0 +1,298 @@
+/**
+ * @file llhttprangefetcher.cpp
+ * @brief Fetches byte ranges over persistent connections with an adaptive
+ * number of requests in flight
+ *
+ * $LicenseInfo:firstyear=2011&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2011, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llhttprangefetcher.h"
+
+#include "llbufferstream.h"
+#include "llhttpstatuscodes.h"
+
+// Smoothing of the latency, per request
+static const F64 LATENCY_GAIN = 0.125;
+// Congested once the latency is this many times the base, plus the slack
+// for a link too quick to measure
+static const F64 CONGESTED_LATENCY_FACTOR = 2.0;
+static const F64 CONGESTED_LATENCY_SLACK = 0.05;	// seconds
+// How far the base moves toward the latency each congested epoch
+static const F64 BASE_LATENCY_DRIFT = 0.125;
+// Decreases for queueing and for a busy server
+static const F64 CONGESTED_DECREASE = 0.75;
+static const F64 BUSY_DECREASE = 0.5;
+// Grow anyway after this many epochs without more throughput, in case
+// the last one was just noisy
+static const U32 PROBE_EPOCHS = 4;
+
+//////////////////////////////////////////////////////////////////////////////
+
+LLHTTPConcurrencyWindow::LLHTTPConcurrencyWindow(U32 min_window, U32 max_window, U32 initial_window)
+:	mMinWindow(llmax(min_window, 1U)),
+	mMaxWindow(llmax(max_window, llmax(min_window, 1U))),
+	mWindow(llclamp(initial_window, mMinWindow, mMaxWindow)),
+	mBaseLatency(0.0),
+	mLatency(0.0),
+	mThroughput(0.0),
+	mEpochStart(-1.0),
+	mEpochCompleted(0),
+	mEpochBytes(0.0),
+	mDecreasedInEpoch(false),
+	mHoldEpochs(0)
+{
+}
+
+void LLHTTPConcurrencyWindow::requestDone(F64 now, F64 latency, U32 bytes, bool success, bool busy)
+{
+	if (mEpochStart < 0.0)
+	{
+		// the first requests went out when this one did, not whenever we
+		// were made
+		startEpoch(now - latency);
+	}
+
+	if (!success)
+	{
+		// Requests sent before a decrease fail together, only the first
+		// of them counts.
+		if (busy && !mDecreasedInEpoch)
+		{
+			decrease(BUSY_DECREASE, now);
+		}
+		return;
+	}
+
+	if (mBaseLatency <= 0.0 || latency < mBaseLatency)
+	{
+		mBaseLatency = latency;
+	}
+	mLatency = mLatency > 0.0 ? mLatency + (latency - mLatency) * LATENCY_GAIN : latency;
+
+	mEpochCompleted++;
+	mEpochBytes += bytes;
+	if (mEpochCompleted >= mWindow)
+	{
+		endEpoch(now);
+	}
+}
+
+void LLHTTPConcurrencyWindow::endEpoch(F64 now)
+{
+	F64 elapsed = now - mEpochStart;
+	F64 throughput = elapsed > 0.0 ? mEpochBytes / elapsed : mThroughput;
+
+	if (mLatency > mBaseLatency * CONGESTED_LATENCY_FACTOR + CONGESTED_LATENCY_SLACK)
+	{
+		// A route that got slower for good stops looking congested as the
+		// base catches up.
+		mBaseLatency += (mLatency - mBaseLatency) * BASE_LATENCY_DRIFT;
+		mThroughput = throughput;
+		if (!mDecreasedInEpoch)
+		{
+			decrease(CONGESTED_DECREASE, now);
+			return;
+		}
+	}
+	else if (mWindow < mMaxWindow
+			 && (throughput > mThroughput * (1.0 + 0.5 / mWindow)
+				 || ++mHoldEpochs >= PROBE_EPOCHS))
+	{
+		// The last step up still bought throughput, or it has been a
+		// while since we tried. A step buys at most 1/window more.
+		mWindow++;
+		mHoldEpochs = 0;
+	}
+	mThroughput = throughput;
+	startEpoch(now);
+}
+
+void LLHTTPConcurrencyWindow::decrease(F64 factor, F64 now)
+{
+	mWindow = llmax(mMinWindow, (U32)(mWindow * factor));
+	mHoldEpochs = 0;
+	startEpoch(now);
+	mDecreasedInEpoch = true;
+}
+
+void LLHTTPConcurrencyWindow::startEpoch(F64 now)
+{
+	mEpochStart = now;
+	mEpochCompleted = 0;
+	mEpochBytes = 0.0;
+	mDecreasedInEpoch = false;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Times the request for the window, then hands the response to the
+// caller's responder.
+class LLHTTPRangeFetcher::RangeResponder : public LLCurl::Responder
+{
+public:
+	RangeResponder(LLHTTPRangeFetcher* fetcher, LLCurl::ResponderPtr responder)
+	:	mFetcher(fetcher),
+		mResponder(responder),
+		mLatency(0.0),
+		mBytes(0)
+	{
+	}
+
+	/*virtual*/ void receivedTransferInfo(const LLCurl::TransferInfo& info)
+	{
+		mLatency = info.mStartTransferTime;
+		mBytes = (U32)info.mSizeDownload;
+		mResponder->receivedTransferInfo(info);
+	}
+
+	/*virtual*/ void completedRaw(U32 status, const std::string& reason,
+								  const LLChannelDescriptors& channels,
+								  const LLIOPipe::buffer_ptr_t& buffer)
+	{
+		mFetcher->requestDone(mLatency, mBytes, status);
+		mResponder->completedRaw(status, reason, channels, buffer);
+	}
+
+	/*virtual*/ bool followRedir()
+	{
+		return mResponder->followRedir();
+	}
+
+private:
+	LLHTTPRangeFetcher* mFetcher;
+	LLCurl::ResponderPtr mResponder;
+	F64 mLatency;
+	U32 mBytes;
+};
+
+//////////////////////////////////////////////////////////////////////////////
+
+LLHTTPRangeFetcher::LLHTTPRangeFetcher(U32 min_window, U32 max_window, bool pipelining, bool threaded)
+:	mCurlRequest(new LLCurlRequest),
+	mWindow(min_window, max_window, llmax(min_window, max_window / 4)),
+	mInFlight(0),
+	mCoalesced(0),
+	mCompleted(0)
+{
+	// a connection per request in flight, and a few spare
+	mCurlRequest->setPersistent(max_window + 2, pipelining);
+	if (threaded && !mCurlRequest->setThreaded())
+	{
+		llinfos << "No curl thread here, fetching in process()" << llendl;
+	}
+}
+
+LLHTTPRangeFetcher::~LLHTTPRangeFetcher()
+{
+	// Requests in flight are dropped without completing, as with
+	// LLCurlRequest.
+	delete mCurlRequest;
+}
+
+void LLHTTPRangeFetcher::getByteRange(const std::string& url, const headers_t& headers,
+									  S32 offset, S32 length, LLCurl::ResponderPtr responder)
+{
+	Request request;
+	request.mURL = url;
+	request.mHeaders = headers;
+	request.mOffset = offset;
+	request.mLength = length;
+	request.mResponder = responder;
+	request_list_t::iterator iter = mQueue.insert(mQueue.end(), request);
+	mQueuedURLs.insert(std::make_pair(url, iter));
+}
+
+bool LLHTTPRangeFetcher::extendByteRange(const std::string& url, S32 offset, S32 new_length)
+{
+	std::pair<url_map_t::iterator, url_map_t::iterator> range = mQueuedURLs.equal_range(url);
+	for (url_map_t::iterator iter = range.first; iter != range.second; ++iter)
+	{
+		Request& request = *iter->second;
+		if (request.mOffset == offset)
+		{
+			if (request.mLength > 0 && (new_length <= 0 || new_length > request.mLength))
+			{
+				request.mLength = new_length;
+				mCoalesced++;
+			}
+			return true;
+		}
+	}
+	return false;
+}
+
+S32 LLHTTPRangeFetcher::process(U32 max_time_ms)
+{
+	mCompleted = 0;
+	sendQueued();
+	mCurlRequest->process(max_time_ms);
+	// fill the slots that just freed up now rather than next time round
+	sendQueued();
+	return mCompleted;
+}
+
+void LLHTTPRangeFetcher::sendQueued()
+{
+	while (!mQueue.empty() && mInFlight < mWindow.getWindow())
+	{
+		request_list_t::iterator front = mQueue.begin();
+		std::pair<url_map_t::iterator, url_map_t::iterator> range = mQueuedURLs.equal_range(front->mURL);
+		for (url_map_t::iterator iter = range.first; iter != range.second; ++iter)
+		{
+			if (iter->second == front)
+			{
+				mQueuedURLs.erase(iter);
+				break;
+			}
+		}
+
+		if (mCurlRequest->getByteRange(front->mURL, front->mHeaders, front->mOffset, front->mLength,
+									   new RangeResponder(this, front->mResponder)))
+		{
+			mInFlight++;
+		}
+		else
+		{
+			// out of curl handles, fail it the way a dropped connection would
+			llwarns << "Unable to start request for " << front->mURL << llendl;
+			LLChannelDescriptors channels;
+			LLIOPipe::buffer_ptr_t buffer(new LLBufferArray);
+			front->mResponder->completedRaw(499, "Unable to start request", channels, buffer);
+		}
+		mQueue.erase(front);
+	}
+}
+
+void LLHTTPRangeFetcher::requestDone(F64 latency, U32 bytes, U32 status)
+{
+	llassert(mInFlight > 0);
+	mInFlight--;
+	mCompleted++;
+
+	// 499 is LLCurl's status for a transfer that failed on our side of the
+	// server, a timeout or a dropped connection.
+	bool busy = status == HTTP_SERVICE_UNAVAILABLE || status == 499;
+	mWindow.requestDone(mClock.getElapsedTimeF64(), latency, bytes,
+						LLCurl::Responder::isGoodStatus(status), busy);
+}
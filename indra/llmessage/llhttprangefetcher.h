@@ -0,0 +1,148 @@
+/**
+ * @file llhttprangefetcher.h
+ * @brief Declaration of LLHTTPRangeFetcher, which fetches byte ranges over
+ * persistent connections with an adaptive number of requests in flight
+ *
+ * $LicenseInfo:firstyear=2011&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2011, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLHTTPRANGEFETCHER_H
+#define LL_LLHTTPRANGEFETCHER_H
+
+#include <list>
+#include <map>
+
+#include "llcurl.h"
+#include "lltimer.h"
+
+//============================================================================
+// How many requests to keep in flight, additive increase and multiplicative
+// decrease like TCP's congestion window. Time is split into epochs of a
+// window's worth of completed requests, about a round trip each. After an
+// epoch the window grows by one if the throughput still went up with the
+// last increase, and shrinks by a quarter if the latency to the first byte
+// has grown well past the quickest seen, meaning requests are queueing at
+// the server or on the link. A busy server (503) or a timeout halves it,
+// once per epoch.
+
+class LLHTTPConcurrencyWindow
+{
+public:
+	LLHTTPConcurrencyWindow(U32 min_window, U32 max_window, U32 initial_window);
+
+	U32 getWindow() const						{ return mWindow; }
+
+	// A request finished at now (seconds), latency seconds after it was
+	// sent, with bytes of body. busy is set for a failure that says the
+	// server or the link is overloaded, other failures are ignored.
+	void requestDone(F64 now, F64 latency, U32 bytes, bool success, bool busy);
+
+	F64 getBaseLatency() const					{ return mBaseLatency; }
+	F64 getLatency() const						{ return mLatency; }
+	F64 getThroughput() const					{ return mThroughput; }	// bytes/s
+
+private:
+	void endEpoch(F64 now);
+	void decrease(F64 factor, F64 now);
+	void startEpoch(F64 now);
+
+	U32		mMinWindow;
+	U32		mMaxWindow;
+	U32		mWindow;
+	F64		mBaseLatency;		// quickest recent latency, the uncongested round trip
+	F64		mLatency;			// smoothed
+	F64		mThroughput;		// over the last epoch
+	F64		mEpochStart;		// < 0 until the first request completes
+	U32		mEpochCompleted;
+	F64		mEpochBytes;
+	bool	mDecreasedInEpoch;
+	U32		mHoldEpochs;		// epochs in a row without growing
+};
+
+//============================================================================
+// Fetches byte ranges of HTTP resources, such as textures, over one
+// persistent LLCurlRequest, so requests to the same host reuse its open
+// connections. Requests wait in a queue until the concurrency window has
+// room. A request still waiting can be extended to cover the bytes after
+// it, so a caller that wants more of the same resource gets it in one
+// transfer instead of two. Threaded, the transfers run on the request's
+// own curl thread and process() only hands out the finished responses.
+//
+// Not thread safe, use it from one thread only.
+
+class LLHTTPRangeFetcher
+{
+public:
+	typedef LLCurlRequest::headers_t headers_t;
+
+	LLHTTPRangeFetcher(U32 min_window, U32 max_window, bool pipelining, bool threaded);
+	~LLHTTPRangeFetcher();
+
+	// Queues a GET of length bytes of url from offset, or of all of it
+	// for a length <= 0. The responder sees the response as if it had
+	// been sent with LLCurlRequest::getByteRange().
+	void getByteRange(const std::string& url, const headers_t& headers,
+					  S32 offset, S32 length, LLCurl::ResponderPtr responder);
+
+	// Grows the queued request for url at offset to new_length bytes.
+	// Returns false if there is none, it has been sent already.
+	bool extendByteRange(const std::string& url, S32 offset, S32 new_length);
+
+	// Sends what the window has room for and completes finished requests,
+	// for up to max_time_ms when threaded, 0 for no limit. Call regularly.
+	// Returns the number of requests completed.
+	S32 process(U32 max_time_ms = 0);
+
+	U32 getQueued() const						{ return mQueue.size(); }
+	U32 getInFlight() const						{ return mInFlight; }
+	U32 getCoalesced() const					{ return mCoalesced; }
+	const LLHTTPConcurrencyWindow& getWindow() const	{ return mWindow; }
+
+private:
+	class RangeResponder;
+	friend class RangeResponder;
+
+	struct Request
+	{
+		std::string				mURL;
+		headers_t				mHeaders;
+		S32						mOffset;
+		S32						mLength;
+		LLCurl::ResponderPtr	mResponder;
+	};
+	typedef std::list<Request> request_list_t;
+	typedef std::multimap<std::string, request_list_t::iterator> url_map_t;
+
+	void sendQueued();
+	void requestDone(F64 latency, U32 bytes, U32 status);
+
+	LLCurlRequest*			mCurlRequest;
+	LLHTTPConcurrencyWindow	mWindow;
+	request_list_t			mQueue;
+	url_map_t				mQueuedURLs;	// the queued requests by url
+	U32						mInFlight;
+	U32						mCoalesced;
+	LLTimer					mClock;
+	S32						mCompleted;		// since the last process()
+};
+
+#endif // LL_LLHTTPRANGEFETCHER_H
@@ -67,6 +67,62 @@ void LLMsgData::addDataFast(char *blockname, char *varname, const void *data, S3
 	}
 }
 
+void LLMsgNameIndex::add(const char* name, S32 index)
+{
+	// keep the load factor at or under one half
+	if ((mCount + 1) * 2 > mSlots.size())
+	{
+		std::vector<Slot> old_slots;
+		old_slots.swap(mSlots);
+		mSlots.resize(llmax((U32)8, (U32)old_slots.size() * 2));
+		mShift = 32;
+		for (U32 size = mSlots.size(); size > 1; size >>= 1)
+		{
+			mShift--;
+		}
+		mCount = 0;
+		for (std::vector<Slot>::iterator iter = old_slots.begin(); iter != old_slots.end(); ++iter)
+		{
+			if (iter->mName)
+			{
+				insert(iter->mName, iter->mIndex);
+			}
+		}
+	}
+	insert(name, index);
+}
+
+void LLMsgNameIndex::insert(const char* name, S32 index)
+{
+	const U32 mask = mSlots.size() - 1;
+	U32 i = hash(name) >> mShift;
+	while (mSlots[i].mName && mSlots[i].mName != name)
+	{
+		i = (i + 1) & mask;
+	}
+	if (!mSlots[i].mName)
+	{
+		mCount++;
+	}
+	mSlots[i].mName = name;
+	mSlots[i].mIndex = index;
+}
+
+U32 LLMsgNameIndex::getMaxProbeLength() const
+{
+	const U32 mask = mSlots.size() - 1;
+	U32 longest = 0;
+	for (U32 i = 0; i < mSlots.size(); ++i)
+	{
+		if (mSlots[i].mName)
+		{
+			U32 home = hash(mSlots[i].mName) >> mShift;
+			longest = llmax(longest, ((i - home) & mask) + 1);
+		}
+	}
+	return longest;
+}
+
 // LLMessageVariable functions and friends
 
 std::ostream& operator<<(std::ostream& s, LLMessageVariable &msg)
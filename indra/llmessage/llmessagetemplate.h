@@ -135,6 +135,63 @@ public:
 	S32									mTotalSize;
 };
 
+// Maps canonical (LLMessageStringTable) name pointers to their index in a
+// template block or variable list. Open addressing on the pointer value, so
+// a lookup is a hash and usually a single compare instead of a map walk.
+class LLMsgNameIndex
+{
+public:
+	LLMsgNameIndex() : mCount(0), mShift(32) {}
+
+	void add(const char* name, S32 index);
+
+	S32 find(const char* name) const
+	{
+		if (mSlots.empty())
+		{
+			return -1;
+		}
+		const U32 mask = mSlots.size() - 1;
+		for (U32 i = hash(name) >> mShift; ; i = (i + 1) & mask)
+		{
+			const Slot& slot = mSlots[i];
+			if (slot.mName == name)
+			{
+				return slot.mIndex;
+			}
+			if (!slot.mName)
+			{
+				return -1;
+			}
+		}
+	}
+
+	// Longest run of slots a lookup of a name in the index walks, for tests
+	U32 getMaxProbeLength() const;
+
+private:
+	struct Slot
+	{
+		Slot() : mName(NULL), mIndex(-1) {}
+		const char* mName;
+		S32 mIndex;
+	};
+
+	static U32 hash(const char* name)
+	{
+		// String table entries are 64 bytes apart, so the low bits of the
+		// pointer never vary. The slot is the top bits of the product,
+		// which every bit of the pointer feeds into.
+		return (U32)(((size_t)name) >> 6) * 2654435761U;
+	}
+
+	void insert(const char* name, S32 index);
+
+	std::vector<Slot> mSlots;
+	U32 mCount;
+	U32 mShift;		// 32 less log2 of the number of slots
+};
+
 // LLMessage* classes store the template of messages
 class LLMessageVariable
 {
@@ -197,6 +254,7 @@ public:
 			llerrs << name << " has already been used as a variable name!" << llendl;
 		}
 		*varp = new LLMessageVariable(name, type, size);
+		mVariableIndex.add((*varp)->getName(), mMemberVariables.size() - 1);
 		if (((*varp)->getType() != MVT_VARIABLE)
 			&&(mTotalSize != -1))
 		{
@@ -224,6 +282,12 @@ public:
 		return iter != mMemberVariables.end()? *iter : NULL;
 	}
 
+	// Position of the variable in mMemberVariables, or -1
+	S32 getVariableIndex(const char* name) const
+	{
+		return mVariableIndex.find(name);
+	}
+
 	friend std::ostream&	 operator<<(std::ostream& s, LLMessageBlock &msg);
 
 	typedef LLDynamicArrayIndexed<LLMessageVariable*, const char *, 8> message_variable_map_t;
@@ -232,6 +296,9 @@ public:
 	EMsgBlockType							mType;
 	S32										mNumber;
 	S32										mTotalSize;
+
+private:
+	LLMsgNameIndex							mVariableIndex;
 };
 
 
@@ -305,6 +372,7 @@ public:
 				<< "has already been used as a block name!" << llendl;
 		}
 		*member_blockp = blockp;
+		mBlockIndex.add(blockp->mName, mMemberBlocks.size() - 1);
 		if (  (mTotalSize != -1)
 			&&(blockp->mTotalSize != -1)
 			&&(  (blockp->mType == MBT_SINGLE)
@@ -391,6 +459,12 @@ public:
 		return iter != mMemberBlocks.end()? *iter : NULL;
 	}
 
+	// Position of the block in mMemberBlocks, or -1
+	S32 getBlockIndex(const char* name) const
+	{
+		return mBlockIndex.find(name);
+	}
+
 public:
 	typedef LLDynamicArrayIndexed<LLMessageBlock*, char*, 8> message_block_map_t;
 	message_block_map_t						mMemberBlocks;
@@ -416,6 +490,8 @@ private:
 	// message handler function (this is set by each application)
 	void									(*mHandlerFunc)(LLMessageSystem *msgsystem, void **user_data);
 	void									**mUserData;
+
+	LLMsgNameIndex							mBlockIndex;
 };
 
 #endif // LL_LLMESSAGETEMPLATE_H
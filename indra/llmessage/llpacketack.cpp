@@ -43,8 +43,19 @@ LLReliablePacket::LLReliablePacket(
 	S32 buf_len,
 	LLReliablePacketParams* params) :
 	mBuffer(NULL),
-	mBufferLength(0)
+	mBufferLength(0),
+	mBufferSize(0)
 {
+	init(socket, buf_ptr, buf_len, params);
+}
+
+void LLReliablePacket::init(
+	S32 socket,
+	U8* buf_ptr,
+	S32 buf_len,
+	LLReliablePacketParams* params)
+{
+	mBufferLength = 0;
 	if (params)
 	{
 		mHost = params->mHost;
@@ -57,6 +68,7 @@ LLReliablePacket::LLReliablePacket(
 	}
 	else
 	{
+		mHost.invalidate();
 		mRetries = 0;
 		mPingBasedRetry = TRUE;
 		mTimeout = 0.f;
@@ -71,7 +83,12 @@ LLReliablePacket::LLReliablePacket(
 	mSocket = socket;
 	if (mRetries)
 	{
-		mBuffer = new U8[buf_len];
+		if (buf_len > mBufferSize)
+		{
+			delete [] mBuffer;
+			mBuffer = new U8[buf_len];
+			mBufferSize = buf_len;
+		}
 		if (mBuffer != NULL)
 		{
 			memcpy(mBuffer,buf_ptr,buf_len);	/*Flawfinder: ignore*/
@@ -92,6 +92,14 @@ public:
 		mBuffer = NULL;
 	};
 
+	// Sets up a packet from LLCircuitData's pool for another send, keeping
+	// its buffer when the new packet fits
+	void init(
+		S32 socket,
+		U8* buf_ptr,
+		S32 buf_len,
+		LLReliablePacketParams* params);
+
 	friend class LLCircuitData;
 protected:
 	S32 mSocket;
@@ -105,6 +113,7 @@ protected:
 
 	U8* mBuffer;
 	S32 mBufferLength;
+	S32 mBufferSize;	// allocated
 
 	TPACKETID mPacketID;
 
@@ -34,7 +34,10 @@
 
 ///////////////////////////////////////////////////////////
 
-LLPacketBuffer::LLPacketBuffer(const LLHost &host, const char *datap, const S32 size) : mHost(host)
+LLPacketBuffer::LLPacketBuffer(const LLHost &host, const char *datap, const S32 size,
+							   const LLHost &receiving_if)
+:	mHost(host),
+	mReceivingIF(receiving_if)
 {
 	mSize = 0;
 	mData[0] = '!';
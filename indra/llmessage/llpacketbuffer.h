@@ -34,7 +34,8 @@
 class LLPacketBuffer
 {
 public:
-	LLPacketBuffer(const LLHost &host, const char *datap, const S32 size);
+	LLPacketBuffer(const LLHost &host, const char *datap, const S32 size,
+				   const LLHost &receiving_if = LLHost());
 	LLPacketBuffer(S32 hSocket);           // receive a packet
 	~LLPacketBuffer();
 
@@ -0,0 +1,219 @@
+/**
+ * @file llpacketcapture.cpp
+ * @brief Records received datagrams to a file and plays them back
+ *
+ * $LicenseInfo:firstyear=2011&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2011, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llpacketcapture.h"
+
+#include <algorithm>
+
+#include "llerror.h"
+#include "lltimer.h"
+#include "net.h"
+
+const char LLPacketCaptureReader::MAGIC[6] = { 'L', 'L', 'P', 'C', 'A', 'P' };
+
+static void put_u16(U8* out, U32 value)
+{
+	out[0] = (U8)value;
+	out[1] = (U8)(value >> 8);
+}
+
+static void put_u32(U8* out, U32 value)
+{
+	put_u16(out, value);
+	put_u16(out + 2, value >> 16);
+}
+
+static U32 get_u16(const U8* in)
+{
+	return in[0] | (in[1] << 8);
+}
+
+static U32 get_u32(const U8* in)
+{
+	return get_u16(in) | (get_u16(in + 2) << 16);
+}
+
+///////////////////////////////////////////////////////////
+LLPacketCapture::LLPacketCapture()
+:	mFile(NULL),
+	mLastTime(0),
+	mPacketCount(0)
+{
+}
+
+LLPacketCapture::~LLPacketCapture()
+{
+	close();
+}
+
+BOOL LLPacketCapture::open(const std::string& filename)
+{
+	close();
+	mFile = LLFile::fopen(filename, "wb");	/* Flawfinder: ignore */
+	if (!mFile)
+	{
+		llwarns << "Unable to open packet capture " << filename << llendl;
+		return FALSE;
+	}
+
+	U8 header[LLPacketCaptureReader::HEADER_SIZE];
+	memcpy(header, LLPacketCaptureReader::MAGIC, sizeof(LLPacketCaptureReader::MAGIC));	/* Flawfinder: ignore */
+	put_u16(header + sizeof(LLPacketCaptureReader::MAGIC), LLPacketCaptureReader::VERSION);
+	fwrite(header, 1, sizeof(header), mFile);
+
+	mLastTime = 0;
+	mPacketCount = 0;
+	llinfos << "Capturing received packets to " << filename << llendl;
+	return TRUE;
+}
+
+void LLPacketCapture::close()
+{
+	if (mFile)
+	{
+		fclose(mFile);
+		mFile = NULL;
+		llinfos << "Captured " << mPacketCount << " packets" << llendl;
+	}
+}
+
+void LLPacketCapture::writePacket(const char* datap, S32 size, const LLHost& sender)
+{
+	if (!mFile || size <= 0)
+	{
+		return;
+	}
+
+	U64 now = totalTime();
+	U64 delta = mPacketCount ? now - mLastTime : 0;
+	mLastTime = now;
+
+	U8 record[LLPacketCaptureReader::RECORD_HEADER_SIZE];
+	put_u32(record, (U32)llmin(delta, (U64)U32_MAX));
+	put_u32(record + 4, sender.getAddress());
+	put_u16(record + 8, sender.getPort());
+	put_u16(record + 10, size);
+	// stdio buffers these, the file is only written every few KB
+	if (fwrite(record, 1, sizeof(record), mFile) != sizeof(record)
+		|| fwrite(datap, 1, size, mFile) != (size_t)size)
+	{
+		llwarns << "Packet capture write failed, stopping capture" << llendl;
+		close();
+		return;
+	}
+	mPacketCount++;
+}
+
+///////////////////////////////////////////////////////////
+LLPacketCaptureReader::LLPacketCaptureReader()
+:	mOffset(0),
+	mTime(0),
+	mPacketCount(0)
+{
+}
+
+BOOL LLPacketCaptureReader::open(const std::string& filename)
+{
+	mData.clear();
+	mSenders.clear();
+	mPacketCount = 0;
+
+	LLFILE* fp = LLFile::fopen(filename, "rb");	/* Flawfinder: ignore */
+	if (!fp)
+	{
+		llwarns << "Unable to open packet capture " << filename << llendl;
+		return FALSE;
+	}
+	U8 buffer[4096];	/* Flawfinder: ignore */
+	size_t count;
+	while ((count = fread(buffer, 1, sizeof(buffer), fp)) > 0)
+	{
+		mData.insert(mData.end(), buffer, buffer + count);
+	}
+	fclose(fp);
+
+	if (mData.size() < HEADER_SIZE
+		|| memcmp(&mData[0], MAGIC, sizeof(MAGIC))
+		|| get_u16(&mData[sizeof(MAGIC)]) != VERSION)
+	{
+		llwarns << filename << " is not a packet capture" << llendl;
+		mData.clear();
+		return FALSE;
+	}
+
+	// Check every record and collect the senders once, up front, rather
+	// than while playing back.
+	U32 offset = HEADER_SIZE;
+	while (offset + RECORD_HEADER_SIZE <= mData.size())
+	{
+		S32 size = get_u16(&mData[offset + 10]);
+		if (!size || size > NET_BUFFER_SIZE
+			|| offset + RECORD_HEADER_SIZE + size > mData.size())
+		{
+			break;
+		}
+		LLHost sender(get_u32(&mData[offset + 4]), get_u16(&mData[offset + 8]));
+		if (std::find(mSenders.begin(), mSenders.end(), sender) == mSenders.end())
+		{
+			mSenders.push_back(sender);
+		}
+		offset += RECORD_HEADER_SIZE + size;
+		mPacketCount++;
+	}
+	if (offset != mData.size())
+	{
+		llwarns << filename << " is truncated, keeping the first "
+				<< mPacketCount << " packets" << llendl;
+		mData.resize(offset);
+	}
+
+	rewind();
+	return TRUE;
+}
+
+S32 LLPacketCaptureReader::readPacket(char* datap, LLHost& sender, U64& time)
+{
+	if (atEnd())
+	{
+		return 0;
+	}
+	const U8* record = &mData[mOffset];
+	mTime += get_u32(record);
+	sender.set(get_u32(record + 4), get_u16(record + 8));
+	S32 size = get_u16(record + 10);
+	memcpy(datap, record + RECORD_HEADER_SIZE, size);	/* Flawfinder: ignore */
+	mOffset += RECORD_HEADER_SIZE + size;
+	time = mTime;
+	return size;
+}
+
+void LLPacketCaptureReader::rewind()
+{
+	mOffset = HEADER_SIZE;
+	mTime = 0;
+}
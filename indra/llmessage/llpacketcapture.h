@@ -0,0 +1,96 @@
+/**
+ * @file llpacketcapture.h
+ * @brief Declaration of LLPacketCapture and LLPacketCaptureReader, which
+ * record received datagrams to a file and play them back
+ *
+ * $LicenseInfo:firstyear=2011&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2011, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLPACKETCAPTURE_H
+#define LL_LLPACKETCAPTURE_H
+
+#include <vector>
+
+#include "llfile.h"
+#include "llhost.h"
+
+// A capture file starts with an 8 byte header, "LLPCAP" and a U16 version,
+// followed by a record per datagram, all little endian:
+//   U32	microseconds since the previous datagram (the first is 0)
+//   U32	sender IP address, as LLHost::getAddress() returns it
+//   U16	sender port
+//   U16	datagram size
+//   ...	the datagram, as it came off the wire (still zero coded)
+
+class LLPacketCapture
+{
+public:
+	LLPacketCapture();
+	~LLPacketCapture();
+
+	BOOL open(const std::string& filename);
+	void close();
+	BOOL isOpen() const						{ return mFile != NULL; }
+
+	void writePacket(const char* datap, S32 size, const LLHost& sender);
+	U32 getPacketCount() const				{ return mPacketCount; }
+
+private:
+	LLFILE*	mFile;
+	U64		mLastTime;		// usec
+	U32		mPacketCount;
+};
+
+// Reads a whole capture into memory, so playing it back never touches
+// the disk.
+class LLPacketCaptureReader
+{
+public:
+	LLPacketCaptureReader();
+
+	BOOL open(const std::string& filename);
+
+	// Copies the next datagram into datap, which must hold NET_BUFFER_SIZE
+	// bytes. Returns its size, or 0 at the end of the capture. time is
+	// microseconds since the first datagram.
+	S32 readPacket(char* datap, LLHost& sender, U64& time);
+	BOOL atEnd() const						{ return mOffset >= mData.size(); }
+	void rewind();
+
+	U32 getPacketCount() const				{ return mPacketCount; }
+	// Every host that sent a datagram in the capture
+	const std::vector<LLHost>& getSenders() const	{ return mSenders; }
+
+	static const char	MAGIC[6];
+	static const U16	VERSION = 1;
+	static const U32	HEADER_SIZE = 8;
+	static const U32	RECORD_HEADER_SIZE = 12;
+
+private:
+	std::vector<U8>		mData;
+	U32					mOffset;
+	U64					mTime;
+	U32					mPacketCount;
+	std::vector<LLHost>	mSenders;
+};
+
+#endif // LL_LLPACKETCAPTURE_H
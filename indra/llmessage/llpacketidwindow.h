@@ -0,0 +1,226 @@
+/**
+ * @file llpacketidwindow.h
+ * @brief Declaration of LLPacketIDWindow, a circular window of values
+ * indexed by packet id
+ *
+ * $LicenseInfo:firstyear=2011&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2011, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLPACKETIDWINDOW_H
+#define LL_LLPACKETIDWINDOW_H
+
+#include <algorithm>
+#include <vector>
+
+#include "llerror.h"
+
+const TPACKETID LL_MAX_OUT_PACKET_ID = 0x01000000;
+
+// Holds a value per packet id for the ids from the oldest one set to the
+// newest, in an array indexed by the low bits of the id, so finding,
+// adding and removing a packet never allocates once the window has grown to
+// the usual number of packets in flight. T() marks an id with no value, so
+// T is a pointer, a time or a bool; std::vector<bool> makes a window of
+// bools a bitset.
+//
+// Packet ids wrap at LL_MAX_OUT_PACKET_ID. An id up to half of that after
+// the oldest one is newer, anything else is older.
+template <class T>
+class LLPacketIDWindow
+{
+public:
+	LLPacketIDWindow(U32 max_span)
+	:	mBase(0),
+		mSpan(0),
+		mCount(0),
+		mMaxSpan(max_span)
+	{
+	}
+
+	bool empty() const							{ return !mCount; }
+	U32 size() const							{ return mCount; }
+	// Number of ids from the oldest to the newest, set or not
+	U32 getSpan() const							{ return mSpan; }
+	// Only meaningful when not empty
+	TPACKETID getOldestID() const				{ return mBase; }
+	TPACKETID getNewestID() const				{ return wrap(mBase + mSpan - 1); }
+
+	// TRUE if id comes before than, allowing for wrapping
+	static bool isOlder(TPACKETID id, TPACKETID than)
+	{
+		U32 offset = wrap(than - id);
+		return offset && isAhead(offset);
+	}
+
+	// FALSE if setting id would make the window span more than max_span
+	// ids, erase the oldest first
+	BOOL fits(TPACKETID id) const
+	{
+		if (!mCount)
+		{
+			return TRUE;
+		}
+		U32 offset = wrap(id - mBase);
+		if (isAhead(offset))
+		{
+			return offset < mMaxSpan;
+		}
+		return wrap(mBase - id) + mSpan <= mMaxSpan;
+	}
+
+	void set(TPACKETID id, const T& value)
+	{
+		llassert(value != T());
+		llassert(fits(id));
+		TPACKETID base = id;
+		U32 span = 1;
+		if (mCount)
+		{
+			U32 offset = wrap(id - mBase);
+			if (isAhead(offset))
+			{
+				base = mBase;
+				span = llmax(mSpan, offset + 1);
+			}
+			else
+			{
+				span = mSpan + wrap(mBase - id);
+			}
+		}
+		if (span > mSlots.size())
+		{
+			grow(span);
+		}
+		mBase = base;
+		mSpan = span;
+
+		U32 slot = id & (mSlots.size() - 1);
+		if (mSlots[slot] == T())
+		{
+			mCount++;
+		}
+		mSlots[slot] = value;
+	}
+
+	T get(TPACKETID id) const
+	{
+		if (!contains(id))
+		{
+			return T();
+		}
+		return mSlots[id & (mSlots.size() - 1)];
+	}
+
+	void erase(TPACKETID id)
+	{
+		if (!contains(id))
+		{
+			return;
+		}
+		U32 slot = id & (mSlots.size() - 1);
+		if (mSlots[slot] == T())
+		{
+			return;
+		}
+		mSlots[slot] = T();
+		if (!--mCount)
+		{
+			mSpan = 0;
+			return;
+		}
+
+		// keep the oldest and newest ids set, each id is only stepped over
+		// once as the window moves along
+		U32 mask = mSlots.size() - 1;
+		if (id == mBase)
+		{
+			while (mSlots[mBase & mask] == T())
+			{
+				mBase = wrap(mBase + 1);
+				mSpan--;
+			}
+		}
+		else if (id == getNewestID())
+		{
+			while (mSlots[getNewestID() & mask] == T())
+			{
+				mSpan--;
+			}
+		}
+	}
+
+	// Erases every id older than id
+	void eraseBefore(TPACKETID id)
+	{
+		while (mCount && isOlder(mBase, id))
+		{
+			erase(mBase);
+		}
+	}
+
+	// Keeps the slots for reuse
+	void clear()
+	{
+		std::fill(mSlots.begin(), mSlots.end(), T());
+		mBase = 0;
+		mSpan = 0;
+		mCount = 0;
+	}
+
+private:
+	static TPACKETID wrap(TPACKETID id)			{ return id & (LL_MAX_OUT_PACKET_ID - 1); }
+	static bool isAhead(U32 offset)				{ return offset < LL_MAX_OUT_PACKET_ID / 2; }
+
+	bool contains(TPACKETID id) const
+	{
+		return mCount && wrap(id - mBase) < mSpan;
+	}
+
+	void grow(U32 span)
+	{
+		U32 size = llmax((U32)mSlots.size(), (U32)MIN_SIZE);
+		while (size < span)
+		{
+			size <<= 1;
+		}
+
+		// the old slots are keyed on fewer bits of the id
+		std::vector<T> slots(size, T());
+		U32 old_mask = mSlots.size() - 1;
+		for (U32 i = 0; i < mSpan; ++i)
+		{
+			TPACKETID id = wrap(mBase + i);
+			slots[id & (size - 1)] = mSlots[id & old_mask];
+		}
+		mSlots.swap(slots);
+	}
+
+	enum { MIN_SIZE = 64 };
+
+	std::vector<T>	mSlots;
+	TPACKETID		mBase;		// oldest id set
+	U32				mSpan;		// ids from mBase to the newest set
+	U32				mCount;		// ids set
+	const U32		mMaxSpan;
+};
+
+#endif // LL_LLPACKETIDWINDOW_H
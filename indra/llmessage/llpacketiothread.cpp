@@ -0,0 +1,441 @@
+/**
+ * @file llpacketiothread.cpp
+ * @brief Reads and writes a UDP socket in batches on its own thread
+ *
+ * $LicenseInfo:firstyear=2011&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2011, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llpacketiothread.h"
+
+// system library includes
+#if LL_LINUX
+	#include <sys/types.h>
+	#include <sys/socket.h>
+	#include <netinet/in.h>
+	#include <arpa/inet.h>
+	#include <poll.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <errno.h>
+#endif
+
+// linden library includes
+#include "llerror.h"
+#include "lltimer.h"
+
+// most datagrams handed to the kernel in one call
+const U32 BATCH_SIZE = 64;
+// how long to wait before looking at the socket again while the main thread
+// has the whole receive ring to catch up on
+const S32 RECEIVE_RING_FULL_WAIT_MS = 1;
+// how long to wait when there is no wakeup pipe, so nothing can interrupt
+// poll() for a newly queued packet or shutdown()
+const S32 NO_WAKE_PIPE_WAIT_MS = 1;
+// sendto() gets three tries in send_packet()
+const S32 MAX_SEND_ATTEMPTS = 3;
+
+static U32 round_up_pow2(U32 count)
+{
+	U32 size = 1;
+	while (size < count)
+	{
+		size <<= 1;
+	}
+	return size;
+}
+
+//============================================================================
+
+LLPacketIOThread::Ring::Ring(U32 num_slots)
+:	mMask(round_up_pow2(llmax(num_slots, BATCH_SIZE)) - 1),
+	mHead(0),
+	mTail(0)
+{
+	mSlots = new Slot[mMask + 1];
+}
+
+LLPacketIOThread::Ring::~Ring()
+{
+	delete[] mSlots;
+}
+
+U32 LLPacketIOThread::Ring::getContiguousFree()
+{
+	U32 head = mHead & mMask;
+	return llmin(getFree(), mMask + 1 - head);
+}
+
+U32 LLPacketIOThread::Ring::getContiguousCount()
+{
+	U32 tail = mTail & mMask;
+	return llmin(getCount(), mMask + 1 - tail);
+}
+
+//============================================================================
+
+LLPacketIOThread::LLPacketIOThread(S32 socket, U32 receive_slots, U32 send_slots)
+:	LLThread("Packet IO"),
+	mSocket(socket),
+	mReceiveRing(receive_slots),
+	mSendRing(send_slots),
+	mPacketsReceived(0),
+	mReceiveCalls(0),
+	mPacketsSent(0),
+	mSendCalls(0),
+	mSendErrors(0)
+{
+	mWakePipe[0] = mWakePipe[1] = -1;
+#if LL_LINUX
+	if (pipe(mWakePipe) == 0)
+	{
+		fcntl(mWakePipe[0], F_SETFL, O_NONBLOCK);
+		fcntl(mWakePipe[1], F_SETFL, O_NONBLOCK);
+	}
+	else
+	{
+		llwarns << "Unable to create packet IO wakeup pipe, polling every "
+				<< NO_WAKE_PIPE_WAIT_MS << "ms instead: " << strerror(errno) << llendl;
+		mWakePipe[0] = mWakePipe[1] = -1;
+	}
+#endif
+}
+
+LLPacketIOThread::~LLPacketIOThread()
+{
+	shutdown();
+#if LL_LINUX
+	if (mWakePipe[0] >= 0)
+	{
+		close(mWakePipe[0]);
+		close(mWakePipe[1]);
+	}
+#endif
+}
+
+// static
+BOOL LLPacketIOThread::isAvailable()
+{
+#if LL_LINUX
+	return TRUE;
+#else
+	return FALSE;
+#endif
+}
+
+void LLPacketIOThread::shutdown()
+{
+	if (!isStopped())
+	{
+		setQuitting();
+		wakeNetThread();
+	}
+	LLThread::shutdown();
+}
+
+//============================================================================
+// Owning thread
+
+S32 LLPacketIOThread::receivePacket(char* datap, LLHost& sender, LLHost& receiving_if)
+{
+	while (mReceiveRing.getCount())
+	{
+		Slot& slot = mReceiveRing.getTailSlot(0);
+		S32 size = slot.mSize;
+		if (size > 0)
+		{
+			memcpy(datap, slot.mData, size);	/* Flawfinder: ignore */
+			sender.set(slot.mAddress, slot.mPort);
+			receiving_if.set(slot.mReceivingIF, INVALID_PORT);
+		}
+		mReceiveRing.pop(1);
+		if (size > 0)
+		{
+			return size;
+		}
+	}
+	return 0;
+}
+
+BOOL LLPacketIOThread::queuePacket(const char* datap, S32 size, const LLHost& host)
+{
+	if (size > NET_BUFFER_SIZE)
+	{
+		llerrs << "Sending packet > " << NET_BUFFER_SIZE << " of size " << size << llendl;
+	}
+	if (!mSendRing.getFree())
+	{
+		return FALSE;
+	}
+
+	Slot& slot = mSendRing.getHeadSlot(0);
+	memcpy(slot.mData, datap, size);	/* Flawfinder: ignore */
+	slot.mSize = size;
+	slot.mAddress = host.getAddress();
+	slot.mPort = host.getPort();
+	slot.mReceivingIF = INVALID_HOST_IP_ADDRESS;
+	mSendRing.push(1);
+
+	// The network thread only goes back to sleep after it has seen the ring
+	// empty, so it needs waking when this is the only packet in it.
+	if (mSendRing.getCount() == 1)
+	{
+		wakeNetThread();
+	}
+	return TRUE;
+}
+
+//============================================================================
+// Network thread
+
+#if LL_LINUX
+
+void LLPacketIOThread::wakeNetThread()
+{
+	if (mWakePipe[1] >= 0)
+	{
+		char byte = 0;
+		if (write(mWakePipe[1], &byte, 1) < 0)
+		{
+			// pipe full: a wakeup is already pending
+		}
+	}
+}
+
+void LLPacketIOThread::run()
+{
+	while (!isQuitting())
+	{
+		BOOL receive_ring_full = !mReceiveRing.getFree();
+
+		struct pollfd fds[2];
+		fds[0].fd = mSocket;
+		fds[0].events = 0;
+		fds[0].revents = 0;
+		if (!receive_ring_full)
+		{
+			fds[0].events |= POLLIN;
+		}
+		if (mSendRing.getCount())
+		{
+			fds[0].events |= POLLOUT;
+		}
+		if (!fds[0].events)
+		{
+			// a negative fd is skipped, or a pending socket error would
+			// wake us over and over while the receive ring is full
+			fds[0].fd = -1;
+		}
+		fds[1].fd = mWakePipe[0];
+		fds[1].events = POLLIN;
+		fds[1].revents = 0;
+
+		S32 timeout = -1;
+		if (receive_ring_full)
+		{
+			timeout = RECEIVE_RING_FULL_WAIT_MS;
+		}
+		else if (mWakePipe[0] < 0)
+		{
+			timeout = NO_WAKE_PIPE_WAIT_MS;
+		}
+		S32 ready = poll(fds, (mWakePipe[0] >= 0) ? 2 : 1, timeout);
+		if (ready < 0 && errno != EINTR)
+		{
+			llwarns << "poll() failed on the message socket: " << strerror(errno) << llendl;
+			ms_sleep(RECEIVE_RING_FULL_WAIT_MS);
+			continue;
+		}
+
+		if (fds[1].revents & POLLIN)
+		{
+			char drain[64];	/* Flawfinder: ignore */
+			while (read(mWakePipe[0], drain, sizeof(drain)) > 0)
+			{
+			}
+		}
+
+		if (fds[0].revents & (POLLIN | POLLERR))
+		{
+			receiveBatch();
+		}
+		sendBatch();
+	}
+}
+
+void LLPacketIOThread::receiveBatch()
+{
+	struct mmsghdr msgs[BATCH_SIZE];
+	struct iovec iovs[BATCH_SIZE];
+	struct sockaddr_in addrs[BATCH_SIZE];
+	char cmsgs[BATCH_SIZE][CMSG_SPACE(sizeof(struct in_pktinfo))];	/* Flawfinder: ignore */
+
+	while (TRUE)
+	{
+		U32 count = llmin(mReceiveRing.getContiguousFree(), BATCH_SIZE);
+		if (!count)
+		{
+			// wait for the main thread to catch up, the socket buffer
+			// holds the rest
+			return;
+		}
+
+		memset(msgs, 0, sizeof(msgs[0]) * count);
+		for (U32 i = 0; i < count; ++i)
+		{
+			Slot& slot = mReceiveRing.getHeadSlot(i);
+			iovs[i].iov_base = slot.mData;
+			iovs[i].iov_len = NET_BUFFER_SIZE;
+			msgs[i].msg_hdr.msg_name = &addrs[i];
+			msgs[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+			msgs[i].msg_hdr.msg_iov = &iovs[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
+			msgs[i].msg_hdr.msg_control = cmsgs[i];
+			msgs[i].msg_hdr.msg_controllen = sizeof(cmsgs[i]);
+		}
+
+		S32 received = recvmmsg(mSocket, msgs, count, MSG_DONTWAIT, NULL);
+		mReceiveCalls++;
+		if (received <= 0)
+		{
+			// EAGAIN, or an ICMP error for an earlier send that recvfrom()
+			// would also have swallowed
+			return;
+		}
+
+		for (S32 i = 0; i < received; ++i)
+		{
+			Slot& slot = mReceiveRing.getHeadSlot(i);
+			slot.mSize = msgs[i].msg_len;
+			slot.mAddress = addrs[i].sin_addr.s_addr;
+			slot.mPort = ntohs(addrs[i].sin_port);
+			slot.mReceivingIF = INVALID_HOST_IP_ADDRESS;
+
+			// see recvfrom_destip() in net.cpp
+			struct msghdr* hdr = &msgs[i].msg_hdr;
+			for (struct cmsghdr* cmsgptr = CMSG_FIRSTHDR(hdr); cmsgptr != NULL; cmsgptr = CMSG_NXTHDR(hdr, cmsgptr))
+			{
+				if (cmsgptr->cmsg_level == SOL_IP && cmsgptr->cmsg_type == IP_PKTINFO)
+				{
+					in_pktinfo* pktinfo = (in_pktinfo*)CMSG_DATA(cmsgptr);
+					slot.mReceivingIF = pktinfo->ipi_spec_dst.s_addr;
+				}
+			}
+		}
+		mReceiveRing.push(received);
+		mPacketsReceived += received;
+
+		if ((U32)received < count)
+		{
+			// the socket is drained
+			return;
+		}
+	}
+}
+
+void LLPacketIOThread::sendBatch()
+{
+	struct mmsghdr msgs[BATCH_SIZE];
+	struct iovec iovs[BATCH_SIZE];
+	struct sockaddr_in addrs[BATCH_SIZE];
+	S32 refused_attempts = 0;
+
+	while (TRUE)
+	{
+		U32 count = llmin(mSendRing.getContiguousCount(), BATCH_SIZE);
+		if (!count)
+		{
+			return;
+		}
+
+		memset(msgs, 0, sizeof(msgs[0]) * count);
+		for (U32 i = 0; i < count; ++i)
+		{
+			Slot& slot = mSendRing.getTailSlot(i);
+			memset(&addrs[i], 0, sizeof(addrs[i]));
+			addrs[i].sin_family = AF_INET;
+			addrs[i].sin_addr.s_addr = slot.mAddress;
+			addrs[i].sin_port = htons(slot.mPort);
+			iovs[i].iov_base = slot.mData;
+			iovs[i].iov_len = slot.mSize;
+			msgs[i].msg_hdr.msg_name = &addrs[i];
+			msgs[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+			msgs[i].msg_hdr.msg_iov = &iovs[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
+		}
+
+		S32 sent = sendmmsg(mSocket, msgs, count, MSG_DONTWAIT);
+		mSendCalls++;
+		if (sent > 0)
+		{
+			mSendRing.pop(sent);
+			mPacketsSent += sent;
+			refused_attempts = 0;
+			continue;
+		}
+
+		if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+		{
+			// socket buffer full, poll() wakes us for POLLOUT
+			return;
+		}
+
+		Slot& slot = mSendRing.getTailSlot(0);
+		if (errno == ECONNREFUSED && ++refused_attempts < MAX_SEND_ATTEMPTS)
+		{
+			// response to ICMP connection refused message on earlier send
+			continue;
+		}
+
+		struct in_addr addr;
+		addr.s_addr = slot.mAddress;
+		llinfos << "sendmmsg() failed: " << errno << ", " << strerror(errno) << llendl;
+		llinfos << inet_ntoa(addr) << ":" << slot.mPort << llendl;
+		mSendRing.pop(1);
+		mSendErrors++;
+		refused_attempts = 0;
+	}
+}
+
+#else // LL_LINUX
+
+// There is no recvmmsg()/sendmmsg() here and isAvailable() says so, so
+// the thread is never started.
+
+void LLPacketIOThread::wakeNetThread()
+{
+}
+
+void LLPacketIOThread::run()
+{
+}
+
+void LLPacketIOThread::receiveBatch()
+{
+}
+
+void LLPacketIOThread::sendBatch()
+{
+}
+
+#endif // LL_LINUX
@@ -0,0 +1,131 @@
+/**
+ * @file llpacketiothread.h
+ * @brief Declaration of LLPacketIOThread, which reads and writes a UDP
+ * socket in batches on its own thread
+ *
+ * $LicenseInfo:firstyear=2011&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2011, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLPACKETIOTHREAD_H
+#define LL_LLPACKETIOTHREAD_H
+
+#include "llapr.h"
+#include "llhost.h"
+#include "llthread.h"
+#include "net.h"
+
+//============================================================================
+// Drains a UDP socket on its own thread, many datagrams per recvmmsg() call,
+// into a ring of preallocated packet buffers, and writes packets queued by
+// the owning thread with sendmmsg(). Received packets are not lost while the
+// owning thread is busy with a long frame, as long as the ring has room.
+//
+// Each ring has exactly one producer and one consumer: the network thread
+// and the thread that owns the socket (the one running the message system),
+// so neither side ever takes a lock. A ring index is only advanced after the
+// slots it covers are written, and each side only reads the other's index.
+
+class LLPacketIOThread : public LLThread
+{
+public:
+	LLPacketIOThread(S32 socket, U32 receive_slots = 512, U32 send_slots = 256);
+	~LLPacketIOThread();
+
+	// FALSE where there are no batched socket calls, the socket is then
+	// read and written directly as before
+	static BOOL isAvailable();
+
+	// Called from the owning thread.
+	// Copies the oldest received packet into datap, which must hold
+	// NET_BUFFER_SIZE bytes. Returns its size, or 0 if none are waiting.
+	S32 receivePacket(char* datap, LLHost& sender, LLHost& receiving_if);
+	// Returns FALSE if the send ring is full, the packet is not queued
+	BOOL queuePacket(const char* datap, S32 size, const LLHost& host);
+	BOOL hasReceivedPackets() { return mReceiveRing.getCount() != 0; }
+
+	/*virtual*/ void shutdown();
+
+	// Totals, read from any thread
+	U32 getPacketsReceived() { return mPacketsReceived; }
+	U32 getReceiveCalls() { return mReceiveCalls; }
+	U32 getPacketsSent() { return mPacketsSent; }
+	U32 getSendCalls() { return mSendCalls; }
+	U32 getSendErrors() { return mSendErrors; }
+
+protected:
+	/*virtual*/ void run();
+
+private:
+	struct Slot
+	{
+		S32		mSize;
+		U32		mAddress;		// sender or recipient
+		U32		mPort;
+		U32		mReceivingIF;
+		char	mData[NET_BUFFER_SIZE];	/* Flawfinder: ignore */
+	};
+
+	class Ring
+	{
+	public:
+		Ring(U32 num_slots);
+		~Ring();
+
+		// producer side
+		U32 getFree() { return mMask + 1 - (mHead - mTail); }
+		Slot& getHeadSlot(U32 offset) { return mSlots[(mHead + offset) & mMask]; }
+		// free slots before the end of the array
+		U32 getContiguousFree();
+		void push(U32 count) { mHead += count; }
+
+		// consumer side
+		U32 getCount() { return mHead - mTail; }
+		Slot& getTailSlot(U32 offset) { return mSlots[(mTail + offset) & mMask]; }
+		U32 getContiguousCount();
+		void pop(U32 count) { mTail += count; }
+
+	private:
+		Slot* mSlots;
+		U32 mMask;
+		// Written by one side only. apr_atomic_add32() is a full barrier,
+		// so the slots are written before the other side sees them.
+		LLAtomicU32 mHead;	// producer
+		LLAtomicU32 mTail;	// consumer
+	};
+
+	void receiveBatch();
+	void sendBatch();
+	void wakeNetThread();
+
+	S32 mSocket;
+	int mWakePipe[2];
+	Ring mReceiveRing;
+	Ring mSendRing;
+
+	LLAtomicU32 mPacketsReceived;
+	LLAtomicU32 mReceiveCalls;
+	LLAtomicU32 mPacketsSent;
+	LLAtomicU32 mSendCalls;
+	LLAtomicU32 mSendErrors;
+};
+
+#endif // LL_LLPACKETIOTHREAD_H
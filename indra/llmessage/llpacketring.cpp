@@ -30,6 +30,8 @@
 
 // linden library includes
 #include "llerror.h"
+#include "llpacketcapture.h"
+#include "llpacketiothread.h"
 #include "lltimer.h"
 #include "timing.h"
 #include "llrand.h"
@@ -37,6 +39,10 @@
 
 ///////////////////////////////////////////////////////////
 LLPacketRing::LLPacketRing () :
+	mIOThread(NULL),
+	mCapture(NULL),
+	mReplay(NULL),
+	mReplayPacketsDropped(0),
 	mUseInThrottle(FALSE),
 	mUseOutThrottle(FALSE),
 	mInThrottle(256000.f),
@@ -62,6 +68,10 @@ void LLPacketRing::cleanup ()
 {
 	LLPacketBuffer *packetp;
 
+	stopIOThread();
+	stopCapture();
+	stopReplay();
+
 	while (!mReceiveQueue.empty())
 	{
 		packetp = mReceiveQueue.front();
@@ -77,6 +87,116 @@ void LLPacketRing::cleanup ()
 	}
 }
 
+///////////////////////////////////////////////////////////
+void LLPacketRing::startIOThread(S32 socket)
+{
+	if (mIOThread || !LLPacketIOThread::isAvailable())
+	{
+		return;
+	}
+	llinfos << "Reading and writing the message socket on a network thread" << llendl;
+	mIOThread = new LLPacketIOThread(socket);
+	mIOThread->start();
+}
+
+void LLPacketRing::stopIOThread()
+{
+	if (mIOThread)
+	{
+		llinfos << "Network thread received " << mIOThread->getPacketsReceived()
+				<< " packets in " << mIOThread->getReceiveCalls() << " reads, sent "
+				<< mIOThread->getPacketsSent() << " in " << mIOThread->getSendCalls()
+				<< " writes" << llendl;
+		delete mIOThread;
+		mIOThread = NULL;
+	}
+}
+
+BOOL LLPacketRing::hasQueuedPackets()
+{
+	if (mReplay)
+	{
+		return !mReplay->atEnd();
+	}
+	return mIOThread && mIOThread->hasReceivedPackets();
+}
+
+S32 LLPacketRing::receiveFromNet(S32 socket, char *datap, LLHost& sender, LLHost& receiving_if)
+{
+	S32 packet_size;
+	if (mReplay)
+	{
+		U64 time;
+		receiving_if = LLHost();
+		return mReplay->readPacket(datap, sender, time);
+	}
+	else if (mIOThread)
+	{
+		packet_size = mIOThread->receivePacket(datap, sender, receiving_if);
+	}
+	else
+	{
+		packet_size = receive_packet(socket, datap);
+		sender = ::get_sender();
+		receiving_if = ::get_receiving_interface();
+	}
+
+	if (mCapture && packet_size > 0)
+	{
+		mCapture->writePacket(datap, packet_size, sender);
+	}
+	return packet_size;
+}
+
+BOOL LLPacketRing::sendToNet(int h_socket, const char *datap, S32 size, const LLHost& host)
+{
+	if (mReplay)
+	{
+		// nobody is listening for replies to a capture
+		mReplayPacketsDropped++;
+		return TRUE;
+	}
+	if (mIOThread && mIOThread->queuePacket(datap, size, host))
+	{
+		return TRUE;
+	}
+	// No network thread, or it is that far behind: send it ourselves.
+	return send_packet(h_socket, datap, size, host.getAddress(), host.getPort());
+}
+
+BOOL LLPacketRing::startCapture(const std::string& filename)
+{
+	if (!mCapture)
+	{
+		mCapture = new LLPacketCapture;
+	}
+	if (!mCapture->open(filename))
+	{
+		stopCapture();
+		return FALSE;
+	}
+	return TRUE;
+}
+
+void LLPacketRing::stopCapture()
+{
+	delete mCapture;
+	mCapture = NULL;
+}
+
+void LLPacketRing::startReplay(LLPacketCaptureReader* reader)
+{
+	stopReplay();
+	mReplay = reader;
+	mReplayPacketsDropped = 0;
+}
+
+void LLPacketRing::stopReplay()
+{
+	delete mReplay;
+	mReplay = NULL;
+}
+
 ///////////////////////////////////////////////////////////
 void LLPacketRing::dropPackets (U32 num_to_drop)
 {
@@ -158,8 +278,13 @@ S32 LLPacketRing::receivePacket (S32 socket, char *datap)
 		// push any current net packet (if any) onto delay ring
 		while (!done)
 		{
+			char buffer[NET_BUFFER_SIZE];	/* Flawfinder: ignore */
+			LLHost sender;
+			LLHost receiving_if;
+			S32 size = receiveFromNet(socket, buffer, sender, receiving_if);
+
 			LLPacketBuffer *packetp;
-			packetp = new LLPacketBuffer(socket);
+			packetp = new LLPacketBuffer(sender, buffer, size, receiving_if);
 
 			if (packetp->getSize())
 			{
@@ -216,9 +341,7 @@ S32 LLPacketRing::receivePacket (S32 socket, char *datap)
 	else
 	{
 		// no delay, pull straight from net
-		packet_size = receive_packet(socket, datap);		
-		mLastSender = ::get_sender();
-		mLastReceivingIF = ::get_receiving_interface();
+		packet_size = receiveFromNet(socket, datap, mLastSender, mLastReceivingIF);
 
 		if (packet_size)  // did we actually get a packet?
 		{
@@ -243,7 +366,7 @@ BOOL LLPacketRing::sendPacket(int h_socket, char * send_buffer, S32 buf_size, LL
 	BOOL status = TRUE;
 	if (!mUseOutThrottle)
 	{
-		return send_packet(h_socket, send_buffer, buf_size, host.getAddress(), host.getPort() );
+		return sendToNet(h_socket, send_buffer, buf_size, host);
 	}
 	else
 	{
@@ -264,7 +387,7 @@ BOOL LLPacketRing::sendPacket(int h_socket, char * send_buffer, S32 buf_size, LL
 				mOutBufferLength -= packetp->getSize();
 				packet_size = packetp->getSize();
 
-				status = send_packet(h_socket, packetp->getData(), packet_size, packetp->getHost().getAddress(), packetp->getHost().getPort());
+				status = sendToNet(h_socket, packetp->getData(), packet_size, packetp->getHost());
 				
 				delete packetp;
 				// Update the throttle
@@ -273,7 +396,7 @@ BOOL LLPacketRing::sendPacket(int h_socket, char * send_buffer, S32 buf_size, LL
 			else
 			{
 				// If the queue's empty, we can just send this packet right away.
-				status = send_packet(h_socket, send_buffer, buf_size, host.getAddress(), host.getPort() );
+				status = sendToNet(h_socket, send_buffer, buf_size, host);
 				packet_size = buf_size;
 
 				// Update the throttle
@@ -35,6 +35,9 @@
 #include "net.h"
 #include "llthrottle.h"
 
+class LLPacketCapture;
+class LLPacketCaptureReader;
+class LLPacketIOThread;
 
 class LLPacketRing
 {
@@ -55,12 +58,40 @@ public:
 
 	BOOL sendPacket(int h_socket, char * send_buffer, S32 buf_size, LLHost host);
 
+	// Hands the socket to a network thread that reads and writes it in
+	// batches, where LLPacketIOThread::isAvailable(). Call from the thread
+	// that receives and sends, before the first packet.
+	void startIOThread(S32 socket);
+	void stopIOThread();
+	LLPacketIOThread* getIOThread()				{ return mIOThread; }
+	// TRUE if the network thread, or a replay, has packets waiting
+	BOOL hasQueuedPackets();
+
+	// Records every packet received from now on, see llpacketcapture.h
+	BOOL startCapture(const std::string& filename);
+	void stopCapture();
+	// Takes received packets from a capture instead of the socket, and
+	// drops everything sent, until stopReplay(). The ring owns reader.
+	void startReplay(LLPacketCaptureReader* reader);
+	void stopReplay();
+	LLPacketCaptureReader* getReplay()			{ return mReplay; }
+	U32 getReplayPacketsDropped() const			{ return mReplayPacketsDropped; }
+
 	inline LLHost getLastSender();
 	inline LLHost getLastReceivingInterface();
 
 	S32 getAndResetActualInBits()				{ S32 bits = mActualBitsIn; mActualBitsIn = 0; return bits;}
 	S32 getAndResetActualOutBits()				{ S32 bits = mActualBitsOut; mActualBitsOut = 0; return bits;}
 protected:
+	// reads and writes the socket, or the network thread's rings
+	S32  receiveFromNet(S32 socket, char *datap, LLHost& sender, LLHost& receiving_if);
+	BOOL sendToNet(int h_socket, const char *datap, S32 size, const LLHost& host);
+
+	LLPacketIOThread* mIOThread;
+	LLPacketCapture* mCapture;
+	LLPacketCaptureReader* mReplay;
+	U32 mReplayPacketsDropped;
+
 	BOOL mUseInThrottle;
 	BOOL mUseOutThrottle;
 	
@@ -29,7 +29,7 @@
 #include "linden_common.h"
 #include "llsdrpcclient.h"
 
-#include "llbufferstream.h"
+#include "llbuffer.h"
 #include "llfiltersd2xmlrpc.h"
 #include "llmemtype.h"
 #include "llpumpio.h"
@@ -214,9 +214,11 @@ LLIOPipe::EStatus LLSDRPCClient::process_impl(
 		// The input channel has the sd response in it.
 		//lldebugs << "LLSDRPCClient::process_impl STATE_WAITING_FOR_RESPONSE"
 		//		 << llendl;
-		LLBufferStream resp(channels, buffer.get());
+		std::vector<U8> scratch;
+		S32 len = 0;
+		const U8* resp = buffer->getChannelData(channels.in(), scratch, len);
 		LLSD sd;
-		LLSDSerialize::fromNotation(sd, resp, buffer->count(channels.in()));
+		LLSDSerialize::fromNotation(sd, resp, len);
 		LLSDRPCResponse* response = (LLSDRPCResponse*)mResponse.get();
 		if (!response)
 		{
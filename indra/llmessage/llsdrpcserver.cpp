@@ -175,12 +175,11 @@ LLIOPipe::EStatus LLSDRPCServer::process_impl(
 		// First time we got here - process the SD request, and call
 		// the method.
 		PUMP_DEBUG;
-		LLBufferStream istr(channels, buffer.get());
+		std::vector<U8> scratch;
+		S32 len = 0;
+		const U8* request = buffer->getChannelData(channels.in(), scratch, len);
 		mRequest.clear();
-		LLSDSerialize::fromNotation(
-			mRequest,
-			istr,
-			buffer->count(channels.in()));
+		LLSDSerialize::fromNotation(mRequest, request, len);
 
 		// { 'method':'...', 'parameter': ... }
 		method_name = mRequest[LLSDRPC_METHOD_SD_NAME].asString();
@@ -0,0 +1,84 @@
+/** 
+ * @file llsdstreamresponder.cpp
+ * @brief Implementation of LLSDStreamResponder.
+ *
+ * $LicenseInfo:firstyear=2011&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2011, Linden Research, Inc.
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "llsdstreamresponder.h"
+
+#include "llbuffer.h"
+
+LLSDStreamResponder::LLSDStreamResponder() :
+	mParser(*this)
+{
+}
+
+// virtual
+LLSDStreamResponder::~LLSDStreamResponder()
+{
+}
+
+// virtual
+bool LLSDStreamResponder::receivedData(U32 status, const U8* data, S32 length)
+{
+	if (!isGoodStatus(status))
+	{
+		// keep it for errorWithContent()
+		return false;
+	}
+	mParser.feed((const char*)data, length);
+	return true;
+}
+
+// virtual
+void LLSDStreamResponder::completedRaw(
+	U32 status,
+	const std::string& reason,
+	const LLChannelDescriptors& channels,
+	const LLIOPipe::buffer_ptr_t& buffer)
+{
+	if (!isGoodStatus(status))
+	{
+		LLHTTPClient::Responder::completedRaw(status, reason, channels, buffer);
+		return;
+	}
+
+	// Anything which arrived before the status line said it was good
+	// is still in the buffer.
+	std::vector<U8> scratch;
+	S32 length = 0;
+	const U8* data = buffer->getChannelData(channels.in(), scratch, length);
+	if (data)
+	{
+		mParser.feed((const char*)data, length);
+	}
+
+	bool success = (mParser.finish() != LLSDParser::PARSE_FAILURE);
+	if (!success)
+	{
+		llinfos << "Failed to deserialize LLSD [" << status << "]: " << reason << llendl;
+	}
+	mParser.reset();
+	streamCompleted(success);
+}
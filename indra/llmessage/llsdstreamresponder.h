@@ -0,0 +1,80 @@
+/** 
+ * @file llsdstreamresponder.h
+ * @brief Declaration of LLSDStreamResponder, which parses an LLSD XML
+ * response as it downloads.
+ *
+ * $LicenseInfo:firstyear=2011&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2011, Linden Research, Inc.
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLSDSTREAMRESPONDER_H
+#define LL_LLSDSTREAMRESPONDER_H
+
+#include "llhttpclient.h"
+#include "llsdserialize_xml.h"
+
+/** 
+ * @class LLSDStreamResponder
+ * @brief Responder which hands an LLSD XML body to its listener methods
+ * while it is still downloading.
+ *
+ * The body is never held whole, neither as text nor as one LLSD tree,
+ * which is what makes large capability responses expensive. Override
+ * the LLSDXMLStreamParser::Listener methods to take the document as it
+ * arrives, and streamCompleted() for whatever has to happen once it has
+ * all been seen.
+ *
+ * Responses with a bad status are not streamed, and go through
+ * completed() and errorWithContent() as usual. Requests must be made
+ * through LLHTTPClient for the body to arrive piece by piece.
+ */
+class LLSDStreamResponder :
+	public LLHTTPClient::Responder,
+	public LLSDXMLStreamParser::Listener
+{
+public:
+	LLSDStreamResponder();
+	virtual ~LLSDStreamResponder();
+
+	/* @name LLCurl::Responder virtual implementations
+	 */
+	//@{
+	virtual bool receivedData(U32 status, const U8* data, S32 length);
+	virtual void completedRaw(
+		U32 status,
+		const std::string& reason,
+		const LLChannelDescriptors& channels,
+		const LLIOPipe::buffer_ptr_t& buffer);
+	//@}
+
+	/** 
+	 * @brief Called once a response with a good status has been parsed.
+	 *
+	 * @param success false if the body was not well formed LLSD XML,
+	 * in which case the listener may have been given part of it.
+	 */
+	virtual void streamCompleted(bool success) {}
+
+private:
+	LLSDXMLStreamParser mParser;
+};
+
+#endif // LL_LLSDSTREAMRESPONDER_H
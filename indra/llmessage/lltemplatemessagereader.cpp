@@ -42,8 +42,12 @@ LLTemplateMessageReader::LLTemplateMessageReader(message_template_number_map_t&
 	mReceiveSize(0),
 	mCurrentRMessageTemplate(NULL),
 	mCurrentRMessageData(NULL),
-	mMessageNumbers(number_template_map)
+	mMessageNumbers(number_template_map),
+	mFlatDecode(true),
+	mFlatDataValid(false)
 {
+	// big enough for any packet, so the arena never grows in practice
+	mFlatArena.resize(MAX_BUFFER_SIZE);
 }
 
 //virtual 
@@ -60,6 +64,7 @@ void LLTemplateMessageReader::clearMessage()
 	mCurrentRMessageTemplate = NULL;
 	delete mCurrentRMessageData;
 	mCurrentRMessageData = NULL;
+	mFlatDataValid = false;
 }
 
 void LLTemplateMessageReader::getData(const char *blockname, const char *varname, void *datap, S32 size, S32 blocknum, S32 max_size)
@@ -71,6 +76,12 @@ void LLTemplateMessageReader::getData(const char *blockname, const char *varname
 		return;
 	}
 
+	if (mFlatDataValid)
+	{
+		getFlatData(blockname, varname, datap, size, blocknum, max_size);
+		return;
+	}
+
 	if (!mCurrentRMessageData)
 	{
 		llerrs << "Invalid mCurrentMessageData in getData!" << llendl;
@@ -154,6 +165,12 @@ S32 LLTemplateMessageReader::getNumberOfBlocks(const char *blockname)
 		return -1;
 	}
 
+	if (mFlatDataValid)
+	{
+		S32 block_index = mCurrentRMessageTemplate->getBlockIndex(blockname);
+		return block_index < 0 ? 0 : mFlatBlocks[block_index].mCount;
+	}
+
 	if (!mCurrentRMessageData)
 	{
 		llerrs << "Invalid mCurrentRMessageData in getData!" << llendl;
@@ -181,6 +198,31 @@ S32 LLTemplateMessageReader::getSize(const char *blockname, const char *varname)
 		return LL_MESSAGE_ERROR;
 	}
 
+	if (mFlatDataValid)
+	{
+		S32 block_index, var_index;
+		const FlatVar* var = findFlatVar(blockname, varname, 0, block_index, var_index);
+		if (block_index < 0)
+		{	// don't crash
+			llinfos << "Block " << blockname << " not in message "
+				<< mCurrentRMessageTemplate->mName << llendl;
+			return LL_BLOCK_NOT_IN_MESSAGE;
+		}
+		if (!var)
+		{	// don't crash
+			llinfos << "Variable " << varname << " not in message "
+				<< mCurrentRMessageTemplate->mName << " block " << blockname << llendl;
+			return LL_VARIABLE_NOT_IN_BLOCK;
+		}
+		if ((*(mCurrentRMessageTemplate->mMemberBlocks.begin() + block_index))->mType != MBT_SINGLE)
+		{	// This is a serious error - crash
+			llerrs << "Block " << blockname << " isn't type MBT_SINGLE,"
+				" use getSize with blocknum argument!" << llendl;
+			return LL_MESSAGE_ERROR;
+		}
+		return var->mSize;
+	}
+
 	if (!mCurrentRMessageData)
 	{	// This is a serious error - crash
 		llerrs << "Invalid mCurrentRMessageData in getData!" << llendl;
@@ -229,6 +271,25 @@ S32 LLTemplateMessageReader::getSize(const char *blockname, S32 blocknum, const
 		return LL_MESSAGE_ERROR;
 	}
 
+	if (mFlatDataValid)
+	{
+		S32 block_index, var_index;
+		const FlatVar* var = findFlatVar(blockname, varname, blocknum, block_index, var_index);
+		if (block_index < 0)
+		{	// don't crash
+			llinfos << "Block " << blockname << " #" << blocknum << " not in message "
+				<< mCurrentRMessageTemplate->mName << llendl;
+			return LL_BLOCK_NOT_IN_MESSAGE;
+		}
+		if (!var)
+		{	// don't crash
+			llinfos << "Variable " << varname << " not in message "
+				<< mCurrentRMessageTemplate->mName << " block " << blockname << llendl;
+			return LL_VARIABLE_NOT_IN_BLOCK;
+		}
+		return var->mSize;
+	}
+
 	if (!mCurrentRMessageData)
 	{	// This is a serious error - crash
 		llerrs << "Invalid mCurrentRMessageData in getData!" << llendl;
@@ -260,6 +321,94 @@ S32 LLTemplateMessageReader::getSize(const char *blockname, S32 blocknum, const
 	return vardata.getSize();
 }
 
+const LLTemplateMessageReader::FlatVar* LLTemplateMessageReader::findFlatVar(
+	const char* blockname, const char* varname, S32 blocknum,
+	S32& block_index, S32& var_index) const
+{
+	var_index = -1;
+	block_index = mCurrentRMessageTemplate->getBlockIndex(blockname);
+	if (block_index < 0
+		|| blocknum < 0
+		|| blocknum >= mFlatBlocks[block_index].mCount)
+	{
+		block_index = -1;
+		return NULL;
+	}
+
+	const LLMessageBlock* block = *(mCurrentRMessageTemplate->mMemberBlocks.begin() + block_index);
+	var_index = block->getVariableIndex(varname);
+	if (var_index < 0)
+	{
+		return NULL;
+	}
+
+	const FlatBlock& flat_block = mFlatBlocks[block_index];
+	return &mFlatVars[flat_block.mFirstVar + blocknum * flat_block.mNumVars + var_index];
+}
+
+void LLTemplateMessageReader::getFlatData(const char *blockname, const char *varname, void *datap, S32 size, S32 blocknum, S32 max_size)
+{
+	S32 block_index, var_index;
+	const FlatVar* var = findFlatVar(blockname, varname, blocknum, block_index, var_index);
+	if (block_index < 0)
+	{
+		llerrs << "Block " << blockname << " #" << blocknum
+			<< " not in message " << mCurrentRMessageTemplate->mName << llendl;
+		return;
+	}
+	if (!var)
+	{
+		llerrs << "Variable "<< varname << " not in message "
+			<< mCurrentRMessageTemplate->mName << " block " << blockname << llendl;
+		return;
+	}
+
+	const S32 vardata_size = var->mSize;
+	if (size && size != vardata_size)
+	{
+		llerrs << "Msg " << mCurrentRMessageTemplate->mName 
+			<< " variable " << varname
+			<< " is size " << vardata_size
+			<< " but copying into buffer of size " << size
+			<< llendl;
+		return;
+	}
+
+	const LLMessageBlock* block = *(mCurrentRMessageTemplate->mMemberBlocks.begin() + block_index);
+	const LLMessageVariable* template_var = *(block->mMemberVariables.begin() + var_index);
+	// The arena holds the packet as it came off the wire
+	const U8* src = var->mOffset < 0 ? NULL : &mFlatArena[0] + var->mOffset;
+
+	if (max_size >= vardata_size)
+	{
+		if (src)
+		{
+			htonmemcpy(datap, src, template_var->getType(), vardata_size);
+		}
+		else
+		{
+			memset(datap, 0, vardata_size);
+		}
+	}
+	else
+	{
+		llwarns << "Msg " << mCurrentRMessageTemplate->mName 
+			<< " variable " << varname
+			<< " is size " << vardata_size
+			<< " but truncated to max size of " << max_size
+			<< llendl;
+
+		if (src)
+		{
+			memcpy(datap, src, max_size);
+		}
+		else
+		{
+			memset(datap, 0, max_size);
+		}
+	}
+}
+
 void LLTemplateMessageReader::getBinaryData(const char *blockname, 
 											const char *varname, void *datap, 
 											S32 size, S32 blocknum, 
@@ -533,6 +682,7 @@ BOOL LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender
 	llassert( mCurrentRMessageTemplate);
 	llassert( !mCurrentRMessageData );
 	delete mCurrentRMessageData; // just to make sure
+	mFlatDataValid = false;
 
 	// The offset tells us how may bytes to skip after the end of the
 	// message name.
@@ -695,6 +845,196 @@ BOOL LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender
 		return FALSE;
 	}
 
+	return callHandler(sender);
+}
+
+// decode a given message into the flat arena, same wire format rules as decodeData()
+BOOL LLTemplateMessageReader::decodeFlatData(const U8* buffer, const LLHost& sender)
+{
+	llassert( mReceiveSize >= 0 );
+	llassert( mCurrentRMessageTemplate);
+	llassert( !mCurrentRMessageData );
+
+	if ((S32)mFlatArena.size() < mReceiveSize)
+	{
+		mFlatArena.resize(mReceiveSize);
+	}
+	memcpy(&mFlatArena[0], buffer, mReceiveSize);	/* Flawfinder: ignore */
+	mFlatBlocks.clear();
+	mFlatVars.clear();
+	mFlatDataValid = true;
+
+	U8 offset = buffer[PHL_OFFSET];
+	S32 decode_pos = LL_PACKET_ID_SIZE + (S32)(mCurrentRMessageTemplate->mFrequency) + offset;
+	S32 total_blocks = 0;
+
+	LLMessageTemplate::message_block_map_t::const_iterator iter;
+	for(iter = mCurrentRMessageTemplate->mMemberBlocks.begin();
+		iter != mCurrentRMessageTemplate->mMemberBlocks.end();
+		++iter)
+	{
+		const LLMessageBlock* mbci = *iter;
+		S32 repeat_number;
+
+		if (mbci->mType == MBT_SINGLE)
+		{
+			repeat_number = 1;
+		}
+		else if (mbci->mType == MBT_MULTIPLE)
+		{
+			repeat_number = mbci->mNumber;
+		}
+		else if (mbci->mType == MBT_VARIABLE)
+		{
+			if (decode_pos >= mReceiveSize)
+			{
+				// missing variable blocks at the end of a message are legal
+				repeat_number = 0;
+			}
+			else
+			{
+				repeat_number = buffer[decode_pos];
+				decode_pos++;
+			}
+		}
+		else
+		{
+			llerrs << "Unknown block type" << llendl;
+			return FALSE;
+		}
+
+		FlatBlock flat_block;
+		flat_block.mCount = repeat_number;
+		flat_block.mFirstVar = mFlatVars.size();
+		flat_block.mNumVars = mbci->mMemberVariables.size();
+		mFlatBlocks.push_back(flat_block);
+		total_blocks += repeat_number;
+
+		for (S32 i = 0; i < repeat_number; i++)
+		{
+			for (LLMessageBlock::message_variable_map_t::const_iterator var_iter = 
+					 mbci->mMemberVariables.begin();
+				 var_iter != mbci->mMemberVariables.end(); ++var_iter)
+			{
+				const LLMessageVariable& mvci = **var_iter;
+				FlatVar flat_var;
+
+				if (mvci.getType() == MVT_VARIABLE)
+				{
+					S32 data_size = mvci.getSize();
+					U8 tsizeb = 0;
+					U16 tsizeh = 0;
+					U32 tsize = 0;
+
+					if ((decode_pos + data_size) > mReceiveSize)
+					{
+						logRanOffEndOfPacket(sender, decode_pos, data_size);
+					}
+					else
+					{
+						switch(data_size)
+						{
+						case 1:
+							htonmemcpy(&tsizeb, &buffer[decode_pos], MVT_U8, 1);
+							tsize = tsizeb;
+							break;
+						case 2:
+							htonmemcpy(&tsizeh, &buffer[decode_pos], MVT_U16, 2);
+							tsize = tsizeh;
+							break;
+						case 4:
+							htonmemcpy(&tsize, &buffer[decode_pos], MVT_U32, 4);
+							break;
+						default:
+							llerrs << "Attempting to read variable field with unknown size of " << data_size << llendl;
+							break;
+						}
+					}
+					decode_pos += data_size;
+
+					flat_var.mOffset = decode_pos;
+					flat_var.mSize = (S32)tsize;
+					if (tsize && (decode_pos + (S32)tsize) > mReceiveSize)
+					{
+						// only the packet is in the arena, don't hand out what lies past it
+						logRanOffEndOfPacket(sender, decode_pos, tsize);
+						flat_var.mSize = 0;
+					}
+					decode_pos += tsize;
+				}
+				else
+				{
+					flat_var.mSize = mvci.getSize();
+					if ((decode_pos + mvci.getSize()) > mReceiveSize)
+					{
+						logRanOffEndOfPacket(sender, decode_pos, mvci.getSize());
+						// reads as zeros
+						flat_var.mOffset = -1;
+					}
+					else
+					{
+						flat_var.mOffset = decode_pos;
+					}
+					decode_pos += mvci.getSize();
+				}
+				mFlatVars.push_back(flat_var);
+			}
+		}
+	}
+
+	if (!total_blocks
+		&& !mCurrentRMessageTemplate->mMemberBlocks.empty())
+	{
+		lldebugs << "Empty message '" << mCurrentRMessageTemplate->mName << "' (no blocks)" << llendl;
+		return FALSE;
+	}
+
+	return callHandler(sender);
+}
+
+// Builds the equivalent of what decodeData() would have produced for the
+// current flat decoded message. Caller owns the result.
+LLMsgData* LLTemplateMessageReader::buildMessageData() const
+{
+	LLMsgData* data = new LLMsgData(mCurrentRMessageTemplate->mName);
+	std::vector<U8> zeros;
+	S32 block_index = 0;
+	LLMessageTemplate::message_block_map_t::const_iterator iter;
+	for(iter = mCurrentRMessageTemplate->mMemberBlocks.begin();
+		iter != mCurrentRMessageTemplate->mMemberBlocks.end();
+		++iter, ++block_index)
+	{
+		const LLMessageBlock* mbci = *iter;
+		const FlatBlock& flat_block = mFlatBlocks[block_index];
+		for (S32 i = 0; i < flat_block.mCount; i++)
+		{
+			LLMsgBlkData* cur_data_block = new LLMsgBlkData(mbci->mName, flat_block.mCount);
+			cur_data_block->mName = mbci->mName + i;
+			data->addBlock(cur_data_block);
+
+			const FlatVar* flat_var = &mFlatVars[flat_block.mFirstVar + i * flat_block.mNumVars];
+			for (LLMessageBlock::message_variable_map_t::const_iterator var_iter = 
+					 mbci->mMemberVariables.begin();
+				 var_iter != mbci->mMemberVariables.end(); ++var_iter, ++flat_var)
+			{
+				const LLMessageVariable& mvci = **var_iter;
+				cur_data_block->addVariable(mvci.getName(), mvci.getType());
+				const U8* src = &mFlatArena[0] + flat_var->mOffset;
+				if (flat_var->mOffset < 0)
+				{
+					zeros.assign(flat_var->mSize, 0);
+					src = &zeros[0];
+				}
+				cur_data_block->addData(mvci.getName(), src, flat_var->mSize, mvci.getType());
+			}
+		}
+	}
+	return data;
+}
+
+// Calls the handler for the decoded message and updates the decode timing stats
+BOOL LLTemplateMessageReader::callHandler(const LLHost& sender)
+{
 	{
 		static LLTimer decode_timer;
 
@@ -786,6 +1126,10 @@ BOOL LLTemplateMessageReader::validateMessage(const U8* buffer,
 BOOL LLTemplateMessageReader::readMessage(const U8* buffer, 
 										  const LLHost& sender)
 {
+	if (mFlatDecode)
+	{
+		return decodeFlatData(buffer, sender);
+	}
 	return decodeData(buffer, sender);
 }
 
@@ -823,5 +1167,13 @@ void LLTemplateMessageReader::copyToBuilder(LLMessageBuilder& builder) const
     {
         return;
     }
+	if (mFlatDataValid)
+	{
+		// rare (message forwarding), so it is fine to allocate here
+		LLMsgData* data = buildMessageData();
+		builder.copyFromMessageData(*data);
+		delete data;
+		return;
+	}
 	builder.copyFromMessageData(*mCurrentRMessageData);
 }
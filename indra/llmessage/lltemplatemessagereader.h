@@ -30,6 +30,7 @@
 #include "llmessagereader.h"
 
 #include <map>
+#include <vector>
 
 class LLMessageTemplate;
 class LLMsgData;
@@ -105,8 +106,36 @@ public:
 	bool isTrusted() const;
 	bool isBanned(bool trusted_source) const;
 	bool isUdpBanned() const;
+
+	// When set (the default) messages are decoded into a flat arena owned by
+	// the reader instead of a tree of LLMsgData/LLMsgBlkData, so decoding
+	// does no allocation once the arena has grown and the getters index
+	// straight into it. The old path is kept for comparison.
+	void setFlatDecode(bool flat) { mFlatDecode = flat; }
+	bool getFlatDecode() const { return mFlatDecode; }
 	
 private:
+	// One entry per template block, in template order
+	struct FlatBlock
+	{
+		S32 mCount;			// number of repeats present in this message
+		S32 mFirstVar;		// index of the first repeat's first variable in mFlatVars
+		S32 mNumVars;		// variables per repeat
+	};
+
+	// One entry per (block, repeat, variable)
+	struct FlatVar
+	{
+		S32 mOffset;		// into mFlatArena, or -1 if it ran off the end of the packet (reads as zeros)
+		S32 mSize;
+	};
+
+	BOOL decodeFlatData(const U8* buffer, const LLHost& sender);
+	const FlatVar* findFlatVar(const char* blockname, const char* varname,
+							   S32 blocknum, S32& block_index, S32& var_index) const;
+	void getFlatData(const char *blockname, const char *varname, void *datap,
+					 S32 size, S32 blocknum, S32 max_size);
+	LLMsgData* buildMessageData() const;
 
 	void getData(const char *blockname, const char *varname, void *datap, 
 				 S32 size = 0, S32 blocknum = 0, S32 max_size = S32_MAX);
@@ -117,11 +146,18 @@ private:
 	void logRanOffEndOfPacket( const LLHost& host, const S32 where, const S32 wanted );
 
 	BOOL decodeData(const U8* buffer, const LLHost& sender );
+	BOOL callHandler(const LLHost& sender);
 
 	S32	mReceiveSize;
 	LLMessageTemplate* mCurrentRMessageTemplate;
 	LLMsgData* mCurrentRMessageData;
 	message_template_number_map_t& mMessageNumbers;
+
+	bool mFlatDecode;
+	bool mFlatDataValid;	// mFlat* describe the current message
+	std::vector<U8> mFlatArena;	// copy of the current packet, only ever grows
+	std::vector<FlatBlock> mFlatBlocks;
+	std::vector<FlatVar> mFlatVars;
 };
 
 #endif // LL_LLTEMPLATEMESSAGEREADER_H
@@ -527,10 +527,15 @@ size_t LLURLRequest::downCallback(
 		}
 	}
 
-	req->mDetail->mResponseBuffer->append(
-		req->mDetail->mChannels.out(),
-		(U8*)data,
-		bytes);
+	LLURLRequestComplete* complete =
+		(LLURLRequestComplete*)req->mCompletionCallback.get();
+	if(!complete || !complete->receivedData((U8*)data, bytes))
+	{
+		req->mDetail->mResponseBuffer->append(
+			req->mDetail->mChannels.out(),
+			(U8*)data,
+			bytes);
+	}
 	req->mResponseTransferedBytes += bytes;
 	req->mDetail->mByteAccumulator += bytes;
 	return bytes;
@@ -325,6 +325,14 @@ public:
 	//     a 3xx for a redirect followed by a "real" status, or more redirects.
 	virtual void httpStatus(U32 status, const std::string& reason) { }
 
+	/** 
+	 * @brief Called with each piece of the body as it arrives.
+	 *
+	 * @return Return true if the data has been used up, in which case
+	 * it is not added to the buffer passed to complete().
+	 */
+	virtual bool receivedData(const U8* data, S32 length) { return false; }
+
 	virtual void complete(
 		const LLChannelDescriptors& channels,
 		const buffer_ptr_t& buffer);
@@ -365,6 +365,9 @@ LLMessageSystem::~LLMessageSystem()
 	for_each(mMessageNumbers.begin(), mMessageNumbers.end(), DeletePairedPointer());
 	mMessageNumbers.clear();
 	
+	// stop reading the socket before it closes
+	mPacketRing.stopIOThread();
+
 	if (!mbError)
 	{
 		end_net(mSocket);
@@ -405,6 +408,21 @@ void LLMessageSystem::clearReceiveState()
 
 BOOL LLMessageSystem::poll(F32 seconds)
 {
+	if (mPacketRing.getIOThread())
+	{
+		// The network thread drains the socket, wait on its ring instead.
+		LLTimer poll_timer;
+		while (!mPacketRing.hasQueuedPackets())
+		{
+			if (poll_timer.getElapsedTimeF32() >= seconds)
+			{
+				return FALSE;
+			}
+			ms_sleep(1);
+		}
+		return TRUE;
+	}
+
 	S32 num_socks;
 	apr_status_t status;
 	status = apr_poll(&(mPollInfop->mPollFD), 1, &num_socks,(U64)(seconds*1000000.f));
@@ -740,7 +758,7 @@ BOOL LLMessageSystem::checkMessages( S64 frame_count )
 				if (cdp && recv_reliable)
 				{
 					// Add to the recently received list for duplicate suppression
-					cdp->mRecentlyReceivedReliablePackets[mCurrentRecvPacketID] = getMessageTimeUsecs();
+					cdp->addRecentlyReceivedReliablePacket(mCurrentRecvPacketID);
 
 					// Put it onto the list of packets to be acked
 					cdp->collectRAck(mCurrentRecvPacketID);
@@ -4016,6 +4034,11 @@ void LLMessageSystem::setTimeDecodesSpamThreshold( F32 seconds )
 	LLMessageReader::setTimeDecodesSpamThreshold(seconds);
 }
 
+void LLMessageSystem::setFlatTemplateDecode(BOOL b)
+{
+	mTemplateMessageReader->setFlatDecode(b);
+}
+
 // HACK! babbage: return true if message rxed via either UDP or HTTP
 // TODO: babbage: move gServicePump in to LLMessageSystem?
 bool LLMessageSystem::checkAllMessages(S64 frame_count, LLPumpIO* http_pump)
@@ -690,6 +690,10 @@ public:
 	static void setTimeDecodes(BOOL b);
 	static void setTimeDecodesSpamThreshold(F32 seconds); 
 
+	// Decode template messages into the reader's flat arena (default) or
+	// the older per message LLMsgData tree
+	void setFlatTemplateDecode(BOOL b);
+
 	// message handlers internal to the message systesm
 	//static void processAssignCircuitCode(LLMessageSystem* msg, void**);
 	static void processAddCircuitCode(LLMessageSystem* msg, void**);
@@ -51,6 +51,15 @@ void LLCurl::Responder::completedHeader(unsigned,
 {
 }
 
+bool LLCurl::Responder::receivedData(U32, const U8*, S32)
+{
+	return false;
+}
+
+void LLCurl::Responder::receivedTransferInfo(const TransferInfo&)
+{
+}
+
 void LLCurl::Responder::completedRaw(unsigned,
 									 std::basic_string<char, std::char_traits<char>, std::allocator<char> > const&,
 									 LLChannelDescriptors const&,
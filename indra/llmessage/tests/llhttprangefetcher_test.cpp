@@ -0,0 +1,330 @@
+/**
+ * @file llhttprangefetcher_test.cpp
+ * @brief LLHTTPConcurrencyWindow tests, and LLHTTPRangeFetcher tests
+ * against the J2C server in test_llhttprangefetcher_peer.py
+ *
+ * $LicenseInfo:firstyear=2011&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2011, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+
+#include "linden_common.h"
+
+#include "../llhttprangefetcher.h"
+
+#include "llapr.h"
+#include "llhttpstatuscodes.h"
+#include "stringize.h"
+
+#include "../test/lltut.h"
+
+namespace tut
+{
+	// must match test_llhttprangefetcher_peer.py
+	const U32 PORT = 8001;
+
+	struct RangeResult
+	{
+		RangeResult() : mStatus(0), mDone(false) {}
+		U32 mStatus;
+		std::string mBody;
+		bool mDone;
+	};
+
+	class RangeResultResponder : public LLCurl::Responder
+	{
+	public:
+		RangeResultResponder(RangeResult* result) : mResult(result) {}
+
+		/*virtual*/ void completedRaw(U32 status, const std::string& reason,
+									  const LLChannelDescriptors& channels,
+									  const LLIOPipe::buffer_ptr_t& buffer)
+		{
+			mResult->mStatus = status;
+			S32 size = buffer->countAfter(channels.in(), NULL);
+			mResult->mBody.resize(size);
+			if (size > 0)
+			{
+				buffer->readAfter(channels.in(), NULL, (U8*)&mResult->mBody[0], size);
+			}
+			mResult->mDone = true;
+		}
+
+	private:
+		RangeResult* mResult;
+	};
+
+	struct httprangefetcher_data
+	{
+		httprangefetcher_data()
+		{
+			static bool initialized = false;
+			if (!initialized)
+			{
+				ll_init_apr();
+				LLCurl::initClass();
+				initialized = true;
+			}
+		}
+
+		static std::string textureURL(U32 number)
+		{
+			return STRINGIZE("http://127.0.0.1:" << PORT << "/texture/" << number << ".j2c");
+		}
+
+		// what the server makes up for texture number
+		static std::string texture(U32 number)
+		{
+			U32 size = 2000 + (number * 997) % 6000;
+			std::string data(size, '\0');
+			for (U32 i = 0; i < size; ++i)
+			{
+				data[i] = (char)((number * 31 + i * 7) & 0xff);
+			}
+			data.replace(0, 4, "\xff\x4f\xff\x51");
+			return data;
+		}
+
+		void fetch(LLHTTPRangeFetcher& fetcher, const std::string& url, S32 offset, S32 length,
+				   RangeResult* result)
+		{
+			fetcher.getByteRange(url, LLHTTPRangeFetcher::headers_t(), offset, length,
+								 new RangeResultResponder(result));
+		}
+
+		// Processes the fetcher until the results are all done
+		bool pump(LLHTTPRangeFetcher& fetcher, std::vector<RangeResult>& results)
+		{
+			LLTimer timer;
+			while (timer.getElapsedTimeF32() < 10.f)
+			{
+				fetcher.process();
+				bool done = true;
+				for (U32 i = 0; i < results.size() && done; ++i)
+				{
+					done = results[i].mDone;
+				}
+				if (done)
+				{
+					return true;
+				}
+				ms_sleep(1);
+			}
+			return false;
+		}
+
+		// connections and requests the server has seen
+		void getServerStats(LLHTTPRangeFetcher& fetcher, U32& connections, U32& requests)
+		{
+			std::vector<RangeResult> results(1);
+			fetch(fetcher, STRINGIZE("http://127.0.0.1:" << PORT << "/stats"), 0, -1, &results[0]);
+			ensure("stats", pump(fetcher, results));
+			ensure("stats parsed", sscanf(results[0].mBody.c_str(), "connections %u requests %u",
+										  &connections, &requests) == 2);
+		}
+	};
+	typedef test_group<httprangefetcher_data> httprangefetcher_test;
+	typedef httprangefetcher_test::object httprangefetcher_object;
+	tut::httprangefetcher_test httprangefetcher_testcase("LLHTTPRangeFetcher");
+
+	template<> template<>
+	void httprangefetcher_object::test<1>()
+	{
+		// grows one per epoch while throughput keeps up, up to the max
+		LLHTTPConcurrencyWindow window(2, 6, 2);
+		F64 now = 1.0;
+		for (U32 i = 0; i < 200; ++i)
+		{
+			now += 0.01;
+			window.requestDone(now, 0.05, 10000, true, false);
+			ensure("never past the max", window.getWindow() <= 6);
+		}
+		ensure_equals("grew to the max", window.getWindow(), 6U);
+		ensure("base latency", window.getBaseLatency() > 0.0499 && window.getBaseLatency() < 0.0501);
+		ensure("throughput", window.getThroughput() > 0.0);
+
+		// a busy server halves it, once for the requests sent together
+		window.requestDone(now, 0.05, 0, false, true);
+		ensure_equals("halved", window.getWindow(), 3U);
+		window.requestDone(now, 0.05, 0, false, true);
+		ensure_equals("once per epoch", window.getWindow(), 3U);
+		// failures that are not the server's load say nothing
+		window.requestDone(now, 0.05, 0, false, false);
+		ensure_equals("not busy", window.getWindow(), 3U);
+
+		// after a window of requests it can be halved again, not past the min
+		for (U32 i = 0; i < 3; ++i)
+		{
+			now += 0.01;
+			window.requestDone(now, 0.05, 10000, true, false);
+		}
+		window.requestDone(now, 0.05, 0, false, true);
+		window.requestDone(now, 0.05, 0, false, true);
+		ensure_equals("min", window.getWindow(), 2U);
+	}
+
+	template<> template<>
+	void httprangefetcher_object::test<2>()
+	{
+		// requests queueing up behind each other shrink it
+		LLHTTPConcurrencyWindow window(2, 32, 16);
+		F64 now = 1.0;
+		for (U32 i = 0; i < 16; ++i)
+		{
+			now += 0.01;
+			window.requestDone(now, 0.05, 10000, true, false);
+		}
+		ensure_equals("first epoch grows", window.getWindow(), 17U);
+		for (U32 i = 0; i < 17; ++i)
+		{
+			now += 0.01;
+			window.requestDone(now, 0.5, 10000, true, false);
+		}
+		ensure_equals("latency grew tenfold", window.getWindow(), 12U);
+
+		// and a route that got slower for good stops looking congested
+		for (U32 i = 0; i < 2000; ++i)
+		{
+			now += 0.01;
+			window.requestDone(now, 0.5, 10000, true, false);
+		}
+		ensure("base caught up", window.getBaseLatency() > 0.2);
+		ensure("growing again", window.getWindow() > 2);
+	}
+
+	template<> template<>
+	void httprangefetcher_object::test<3>()
+	{
+		// Whole textures and their first discard levels, over a handful of
+		// connections kept open, with and without pipelining.
+		const U32 TEXTURES = 40;
+		for (S32 pass = 0; pass < 2; ++pass)
+		{
+			LLHTTPRangeFetcher fetcher(2, 8, pass == 1, false);
+			U32 start_connections, start_requests;
+			getServerStats(fetcher, start_connections, start_requests);
+
+			std::vector<RangeResult> results(TEXTURES * 2);
+			for (U32 i = 0; i < TEXTURES; ++i)
+			{
+				fetch(fetcher, textureURL(i), 0, -1, &results[i * 2]);
+				fetch(fetcher, textureURL(i), 0, 600, &results[i * 2 + 1]);
+			}
+			ensure_equals("queued", fetcher.getQueued(), TEXTURES * 2);
+			ensure("all fetched", pump(fetcher, results));
+			ensure_equals("none left", fetcher.getInFlight(), 0U);
+
+			for (U32 i = 0; i < TEXTURES; ++i)
+			{
+				std::string data = texture(i);
+				ensure_equals("whole status", results[i * 2].mStatus, (U32)HTTP_OK);
+				ensure("whole texture", results[i * 2].mBody == data);
+				ensure_equals("range status", results[i * 2 + 1].mStatus, (U32)HTTP_PARTIAL_CONTENT);
+				ensure("range", results[i * 2 + 1].mBody == data.substr(0, 600));
+			}
+
+			U32 connections, requests;
+			getServerStats(fetcher, connections, requests);
+			ensure_equals("requests", requests - start_requests, TEXTURES * 2 + 1);
+			ensure("connections reused", connections - start_connections <= 10);
+		}
+	}
+
+	template<> template<>
+	void httprangefetcher_object::test<4>()
+	{
+		// one at a time, so the second request waits
+		LLHTTPRangeFetcher fetcher(1, 1, false, false);
+		std::vector<RangeResult> results(2);
+		fetch(fetcher, textureURL(1), 0, 1000, &results[0]);
+		fetch(fetcher, textureURL(2), 0, 1000, &results[1]);
+		fetcher.process();
+		ensure_equals("one in flight", fetcher.getInFlight(), 1U);
+
+		ensure("sent already", !fetcher.extendByteRange(textureURL(1), 0, 3000));
+		ensure("no such range", !fetcher.extendByteRange(textureURL(2), 500, 3000));
+		ensure("extended", fetcher.extendByteRange(textureURL(2), 0, 3000));
+		ensure("not shrunk", fetcher.extendByteRange(textureURL(2), 0, 2000));
+		ensure_equals("coalesced", fetcher.getCoalesced(), 1U);
+
+		ensure("fetched", pump(fetcher, results));
+		ensure("first as asked", results[0].mBody == texture(1).substr(0, 1000));
+		ensure("second in one transfer", results[1].mBody == texture(2).substr(0, 3000));
+	}
+
+	template<> template<>
+	void httprangefetcher_object::test<5>()
+	{
+		LLHTTPRangeFetcher fetcher(1, 8, false, false);
+		U32 start_window = fetcher.getWindow().getWindow();
+		ensure("starts above the min", start_window > 1);
+
+		std::vector<RangeResult> results(10);
+		for (U32 i = 0; i < results.size(); ++i)
+		{
+			fetch(fetcher, STRINGIZE("http://127.0.0.1:" << PORT << "/busy/" << i), 0, -1, &results[i]);
+		}
+		ensure("all answered", pump(fetcher, results));
+		for (U32 i = 0; i < results.size(); ++i)
+		{
+			ensure_equals("busy", results[i].mStatus, (U32)HTTP_SERVICE_UNAVAILABLE);
+		}
+		ensure("backed off", fetcher.getWindow().getWindow() < start_window);
+	}
+
+	template<> template<>
+	void httprangefetcher_object::test<6>()
+	{
+		// The same over the curl thread, handing out a few responses per
+		// call, the rest wait for the next one.
+		const U32 TEXTURES = 40;
+		LLHTTPRangeFetcher fetcher(2, 8, false, true);
+		U32 start_connections, start_requests;
+		getServerStats(fetcher, start_connections, start_requests);
+
+		std::vector<RangeResult> results(TEXTURES);
+		for (U32 i = 0; i < TEXTURES; ++i)
+		{
+			fetch(fetcher, textureURL(i), 0, i % 2 ? 600 : -1, &results[i]);
+		}
+		LLTimer timer;
+		U32 completed = 0;
+		while (completed < TEXTURES && timer.getElapsedTimeF32() < 10.f)
+		{
+			completed += fetcher.process(1);
+			ms_sleep(1);
+		}
+		ensure_equals("all fetched", completed, TEXTURES);
+		ensure_equals("none left", fetcher.getInFlight(), 0U);
+
+		for (U32 i = 0; i < TEXTURES; ++i)
+		{
+			std::string data = texture(i);
+			ensure("done", results[i].mDone);
+			ensure("body", results[i].mBody == (i % 2 ? data.substr(0, 600) : data));
+		}
+
+		U32 connections, requests;
+		getServerStats(fetcher, connections, requests);
+		ensure_equals("requests", requests - start_requests, TEXTURES + 1);
+		ensure("connections reused", connections - start_connections <= 10);
+	}
+}
@@ -0,0 +1,148 @@
+/**
+ * @file llpacketcapture_test.cpp
+ * @brief LLPacketCapture and LLPacketCaptureReader tests
+ *
+ * $LicenseInfo:firstyear=2011&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2011, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+
+#include "linden_common.h"
+
+#include "../llpacketcapture.h"
+
+#include "../net.h"
+
+#include "../test/lltut.h"
+
+namespace tut
+{
+	struct packetcapture_data
+	{
+		packetcapture_data()
+		:	mFilename(std::string(LLFile::tmpdir()) + "llpacketcapture_test.llpcap")
+		{
+		}
+
+		~packetcapture_data()
+		{
+			LLFile::remove(mFilename);
+		}
+
+		// fills a datagram of size bytes that says which it is
+		static std::vector<char> makePacket(S32 size, U8 seed)
+		{
+			std::vector<char> packet(size);
+			for (S32 i = 0; i < size; ++i)
+			{
+				packet[i] = (char)(seed + i);
+			}
+			return packet;
+		}
+
+		std::string mFilename;
+	};
+	typedef test_group<packetcapture_data> packetcapture_test;
+	typedef packetcapture_test::object packetcapture_object;
+	tut::packetcapture_test packetcapture_testcase("LLPacketCapture");
+
+	template<> template<>
+	void packetcapture_object::test<1>()
+	{
+		const LLHost sim("10.0.0.1", 13005);
+		const LLHost neighbour("10.0.0.2", 13006);
+		const S32 sizes[] = { 1, 24, 1200, NET_BUFFER_SIZE };
+
+		LLPacketCapture capture;
+		ensure("opened", capture.open(mFilename));
+		for (U32 i = 0; i < LL_ARRAY_SIZE(sizes); ++i)
+		{
+			std::vector<char> packet = makePacket(sizes[i], i);
+			capture.writePacket(&packet[0], sizes[i], (i & 1) ? neighbour : sim);
+		}
+		// nothing to record
+		capture.writePacket(NULL, 0, sim);
+		ensure_equals("written", capture.getPacketCount(), 4U);
+		capture.close();
+
+		LLPacketCaptureReader reader;
+		ensure("read", reader.open(mFilename));
+		ensure_equals("packets", reader.getPacketCount(), 4U);
+		ensure_equals("senders", reader.getSenders().size(), (size_t)2);
+		ensure("first sender", reader.getSenders()[0] == sim);
+
+		// twice, to check rewind()
+		for (S32 pass = 0; pass < 2; ++pass)
+		{
+			std::vector<char> buffer(NET_BUFFER_SIZE);
+			LLHost sender;
+			U64 time;
+			U64 last_time = 0;
+			for (U32 i = 0; i < LL_ARRAY_SIZE(sizes); ++i)
+			{
+				S32 size = reader.readPacket(&buffer[0], sender, time);
+				ensure_equals("size", size, sizes[i]);
+				ensure("sender", sender == ((i & 1) ? neighbour : sim));
+				ensure("data", !memcmp(&buffer[0], &makePacket(size, i)[0], size));
+				ensure("time runs forward", time >= last_time);
+				last_time = time;
+			}
+			ensure("at the end", reader.atEnd());
+			ensure_equals("nothing after the end", reader.readPacket(&buffer[0], sender, time), 0);
+			reader.rewind();
+		}
+	}
+
+	template<> template<>
+	void packetcapture_object::test<2>()
+	{
+		LLPacketCapture capture;
+		ensure("opened", capture.open(mFilename));
+		std::vector<char> packet = makePacket(100, 0);
+		capture.writePacket(&packet[0], 100, LLHost("10.0.0.1", 13005));
+		capture.writePacket(&packet[0], 100, LLHost("10.0.0.1", 13005));
+		capture.close();
+
+		// cut the last datagram short, as a crash while capturing would
+		llstat stat_data;
+		LLFile::stat(mFilename, &stat_data);
+		std::vector<char> contents(stat_data.st_size - 10);
+		LLFILE* fp = LLFile::fopen(mFilename, "rb");	/* Flawfinder: ignore */
+		ensure("reopened", fp != NULL);
+		ensure("read back", fread(&contents[0], 1, contents.size(), fp) == contents.size());
+		fclose(fp);
+		fp = LLFile::fopen(mFilename, "wb");	/* Flawfinder: ignore */
+		fwrite(&contents[0], 1, contents.size(), fp);
+		fclose(fp);
+
+		LLPacketCaptureReader reader;
+		ensure("truncated captures still open", reader.open(mFilename));
+		ensure_equals("complete packets kept", reader.getPacketCount(), 1U);
+
+		// not a capture at all
+		fp = LLFile::fopen(mFilename, "wb");	/* Flawfinder: ignore */
+		fwrite("\x04\x00junk", 1, 6, fp);
+		fclose(fp);
+		ensure("not a capture", !reader.open(mFilename));
+		ensure_equals("no packets", reader.getPacketCount(), 0U);
+		ensure("nothing to read", reader.atEnd());
+	}
+}
@@ -0,0 +1,302 @@
+/**
+ * @file llpacketidwindow_test.cpp
+ * @brief LLPacketIDWindow tests, including a lossy, reordering circuit
+ *
+ * $LicenseInfo:firstyear=2011&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2011, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llpacketidwindow.h"
+
+#include <deque>
+#include <set>
+
+#include "../test/lltut.h"
+
+namespace tut
+{
+	struct packetidwindow_data
+	{
+		packetidwindow_data() : mSeed(1) {}
+
+		// a cheap LCG so every run drops and reorders the same packets
+		U32 rand(U32 max)
+		{
+			mSeed = mSeed * 1664525 + 1013904223;
+			return (mSeed >> 8) % max;
+		}
+
+		static TPACKETID wrap(TPACKETID id) { return id % LL_MAX_OUT_PACKET_ID; }
+
+		U32 mSeed;
+	};
+	typedef test_group<packetidwindow_data> packetidwindow_test;
+	typedef packetidwindow_test::object packetidwindow_object;
+	tut::packetidwindow_test packetidwindow_testcase("LLPacketIDWindow");
+
+	template<> template<>
+	void packetidwindow_object::test<1>()
+	{
+		LLPacketIDWindow<U64> window(1024);
+		ensure("new window is empty", window.empty());
+		ensure_equals("nothing set", window.get(7), (U64)0);
+		ensure("anything fits an empty window", window.fits(12345));
+		window.erase(7);
+		ensure("erasing from an empty window", window.empty());
+	}
+
+	template<> template<>
+	void packetidwindow_object::test<2>()
+	{
+		LLPacketIDWindow<U64> window(1024);
+		for (TPACKETID id = 10; id < 20; id += 2)
+		{
+			window.set(id, id * 100);
+		}
+		ensure_equals("count", window.size(), 5U);
+		ensure_equals("oldest", window.getOldestID(), 10U);
+		ensure_equals("newest", window.getNewestID(), 18U);
+		ensure_equals("span", window.getSpan(), 9U);
+		ensure_equals("value", window.get(14), (U64)1400);
+		ensure_equals("hole", window.get(15), (U64)0);
+		ensure_equals("past the newest", window.get(19), (U64)0);
+
+		window.erase(10);
+		ensure_equals("oldest moves over the hole", window.getOldestID(), 12U);
+		window.erase(18);
+		ensure_equals("newest moves back over the hole", window.getNewestID(), 16U);
+		window.erase(14);
+		ensure_equals("erasing the middle leaves the ends", window.getSpan(), 5U);
+		window.erase(12);
+		window.erase(16);
+		ensure("all erased", window.empty());
+		ensure_equals("no span left", window.getSpan(), 0U);
+	}
+
+	template<> template<>
+	void packetidwindow_object::test<3>()
+	{
+		// Growing while setting an id older than the oldest must not mix
+		// up ids that shared a slot in the smaller array.
+		LLPacketIDWindow<U64> window(4096);
+		for (TPACKETID id = 100; id < 160; ++id)
+		{
+			window.set(id, id);
+		}
+		window.set(90, 90);
+		ensure_equals("oldest", window.getOldestID(), 90U);
+		ensure_equals("span", window.getSpan(), 70U);
+		for (TPACKETID id = 100; id < 160; ++id)
+		{
+			ensure_equals("kept across growing", window.get(id), (U64)id);
+		}
+		ensure_equals("older id", window.get(90), (U64)90);
+		for (TPACKETID id = 91; id < 100; ++id)
+		{
+			ensure_equals("hole before the old oldest", window.get(id), (U64)0);
+		}
+	}
+
+	template<> template<>
+	void packetidwindow_object::test<4>()
+	{
+		// packet ids wrap at LL_MAX_OUT_PACKET_ID
+		LLPacketIDWindow<bool> window(1024);
+		TPACKETID first = LL_MAX_OUT_PACKET_ID - 5;
+		for (U32 i = 0; i < 10; ++i)
+		{
+			window.set(wrap(first + i), true);
+		}
+		ensure_equals("oldest before the wrap", window.getOldestID(), first);
+		ensure_equals("newest after the wrap", window.getNewestID(), 4U);
+		ensure("id after the wrap", window.get(2));
+		ensure("id before the wrap", window.get(LL_MAX_OUT_PACKET_ID - 1));
+		ensure("far id", !window.get(LL_MAX_OUT_PACKET_ID / 2));
+		ensure("older across the wrap", LLPacketIDWindow<bool>::isOlder(first, 2));
+		ensure("newer across the wrap", !LLPacketIDWindow<bool>::isOlder(2, first));
+		ensure("not older than itself", !LLPacketIDWindow<bool>::isOlder(2, 2));
+
+		window.eraseBefore(1);
+		ensure_equals("erased up to the wrap", window.getOldestID(), 1U);
+		ensure_equals("left after the wrap", window.size(), 4U);
+		window.eraseBefore(first);
+		ensure_equals("erasing before an older id", window.size(), 4U);
+	}
+
+	template<> template<>
+	void packetidwindow_object::test<5>()
+	{
+		LLPacketIDWindow<bool> window(100);
+		window.set(1000, true);
+		ensure("newest that fits", window.fits(1099));
+		ensure("too new", !window.fits(1100));
+		ensure("oldest that fits", window.fits(901));
+		ensure("too old", !window.fits(900));
+
+		window.set(1099, true);
+		ensure("a full window takes nothing older", !window.fits(999));
+		window.erase(1000);
+		ensure("room once the oldest goes", window.fits(1100));
+
+		window.clear();
+		ensure("cleared", window.empty());
+		ensure("cleared ids", !window.get(1099));
+	}
+
+	template<> template<>
+	void packetidwindow_object::test<6>()
+	{
+		// Runs reliable packets over a circuit that loses and reorders
+		// packets and acks, the way LLCircuitData uses its windows: the
+		// sender keeps unacked packets until they are acked and resends
+		// them, the receiver suppresses duplicates and forgets those older
+		// than the sender's oldest unacked packet, which each ping carries.
+		const U32 PACKETS = 20000;
+		const U32 LOSS_PERCENT = 20;
+		const U32 REORDER_DEPTH = 8;
+		const TPACKETID FIRST_ID = LL_MAX_OUT_PACKET_ID - PACKETS / 2;
+
+		// the pointers are only ever compared to NULL
+		LLPacketIDWindow<TPACKETID*> unacked(LL_MAX_OUT_PACKET_ID / 4);
+		std::vector<TPACKETID> sent_ids(PACKETS);
+		LLPacketIDWindow<bool> received(LL_MAX_OUT_PACKET_ID / 4);
+		std::set<TPACKETID> delivered;
+		U32 duplicates = 0;
+		U32 max_received_span = 0;
+
+		std::deque<TPACKETID> to_receiver;
+		std::deque<TPACKETID> to_sender;
+		U32 next = 0;
+		U32 frames = 0;
+		while (next < PACKETS || !unacked.empty())
+		{
+			ensure("circuit never settles", ++frames < 100000);
+
+			// send a few new packets
+			for (U32 i = 0; i < 4 && next < PACKETS; ++i, ++next)
+			{
+				TPACKETID id = wrap(FIRST_ID + next);
+				sent_ids[next] = id;
+				ensure("unacked window full", unacked.fits(id));
+				unacked.set(id, &sent_ids[next]);
+				to_receiver.push_back(id);
+			}
+			// resend everything unacked every few frames
+			if (!(frames % 5))
+			{
+				TPACKETID oldest = unacked.getOldestID();
+				U32 span = unacked.getSpan();
+				for (U32 i = 0; i < span; ++i)
+				{
+					TPACKETID id = wrap(oldest + i);
+					if (unacked.get(id))
+					{
+						to_receiver.push_back(id);
+					}
+				}
+			}
+			// ping with the oldest unacked
+			if (!(frames % 10) && !unacked.empty())
+			{
+				received.eraseBefore(unacked.getOldestID());
+			}
+
+			// the network drops some and swaps neighbours around
+			while (!to_receiver.empty())
+			{
+				U32 pick = rand(llmin((U32)to_receiver.size(), REORDER_DEPTH));
+				TPACKETID id = to_receiver[pick];
+				to_receiver.erase(to_receiver.begin() + pick);
+				if (rand(100) < LOSS_PERCENT)
+				{
+					continue;
+				}
+
+				if (received.get(id))
+				{
+					duplicates++;
+				}
+				else
+				{
+					ensure("received window full", received.fits(id));
+					received.set(id, true);
+					ensure("delivered twice", delivered.insert(id).second);
+				}
+				max_received_span = llmax(max_received_span, received.getSpan());
+				// ack duplicates too, the first ack may have been lost
+				to_sender.push_back(id);
+			}
+			while (!to_sender.empty())
+			{
+				U32 pick = rand(llmin((U32)to_sender.size(), REORDER_DEPTH));
+				TPACKETID id = to_sender[pick];
+				to_sender.erase(to_sender.begin() + pick);
+				if (rand(100) < LOSS_PERCENT)
+				{
+					continue;
+				}
+				unacked.erase(id);
+			}
+		}
+
+		ensure_equals("every packet delivered", (U32)delivered.size(), PACKETS);
+		ensure("some resends were duplicates", duplicates > 0);
+		ensure("pings keep the duplicate window small", max_received_span < 1000);
+		ensure("all acked", unacked.empty());
+		ensure_equals("no span left", unacked.getSpan(), 0U);
+	}
+
+	template<> template<>
+	void packetidwindow_object::test<7>()
+	{
+		// potential lost packets, as LLCircuitData::checkPacketInID()
+		// keeps them: gaps are marked with the time they were missed, and
+		// cleared when the packet turns up late
+		LLPacketIDWindow<U64> lost(LL_MAX_OUT_PACKET_ID / 4);
+		TPACKETID expected = wrap(LL_MAX_OUT_PACKET_ID - 3);
+		const TPACKETID arrivals[] = { 0, 1, LL_MAX_OUT_PACKET_ID - 1, 5, 3, 2 };
+		U64 time = 1;
+		for (U32 i = 0; i < LL_ARRAY_SIZE(arrivals); ++i, ++time)
+		{
+			TPACKETID id = arrivals[i];
+			if (lost.get(id))
+			{
+				lost.erase(id);
+			}
+			else
+			{
+				for (; expected != id; expected = wrap(expected + 1))
+				{
+					lost.set(expected, time);
+				}
+				expected = wrap(id + 1);
+			}
+		}
+		ensure_equals("still missing", lost.size(), 3U);
+		ensure_equals("first missed", lost.get(LL_MAX_OUT_PACKET_ID - 3), (U64)1);
+		ensure_equals("second missed", lost.get(LL_MAX_OUT_PACKET_ID - 2), (U64)1);
+		ensure_equals("missed after the wrap", lost.get(4), (U64)4);
+		ensure_equals("oldest missing", lost.getOldestID(), LL_MAX_OUT_PACKET_ID - 3);
+		ensure("recovered", !lost.get(LL_MAX_OUT_PACKET_ID - 1) && !lost.get(3) && !lost.get(2));
+	}
+}
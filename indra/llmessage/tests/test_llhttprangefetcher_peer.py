@@ -0,0 +1,128 @@
+#!/usr/bin/python
+"""\
+@file   test_llhttprangefetcher_peer.py
+@brief  This script asynchronously runs the executable (with args) specified on
+        the command line, returning its result code. While that executable is
+        running, we serve made up J2C textures over HTTP/1.1 for the
+        LLHTTPRangeFetcher tests.
+
+$LicenseInfo:firstyear=2011&license=viewerlgpl$
+Second Life Viewer Source Code
+Copyright (C) 2011, Linden Research, Inc.
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation;
+version 2.1 of the License only.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+$/LicenseInfo$
+"""
+
+import os
+import re
+import sys
+from threading import Thread, Lock
+from BaseHTTPServer import HTTPServer, BaseHTTPRequestHandler
+from SocketServer import ThreadingMixIn
+
+mydir = os.path.dirname(__file__)       # expected to be .../indra/llmessage/tests/
+sys.path.insert(0, os.path.join(mydir, os.pardir, os.pardir, "lib", "python"))
+from testrunner import run, debug
+
+# must match llhttprangefetcher_test.cpp
+PORT = 8001
+
+stats_lock = Lock()
+stats = dict(connections=0, requests=0)
+
+def texture(number):
+    """A made up J2C file: the codestream markers a decoder looks for
+    first, then bytes the test can check."""
+    size = 2000 + (number * 997) % 6000
+    data = [chr((number * 31 + i * 7) & 0xff) for i in xrange(size)]
+    data[0:4] = ['\xff', '\x4f', '\xff', '\x51']
+    return ''.join(data)
+
+class TextureRequestHandler(BaseHTTPRequestHandler):
+    """Serves /texture/N.j2c, honouring Range, /busy/... as a 503, and
+    /stats with the connections and requests seen so far. Connections are
+    kept open between requests."""
+    protocol_version = "HTTP/1.1"
+
+    def setup(self):
+        BaseHTTPRequestHandler.setup(self)
+        with stats_lock:
+            stats["connections"] += 1
+
+    def do_GET(self):
+        with stats_lock:
+            stats["requests"] += 1
+            body = "connections %(connections)d requests %(requests)d" % stats
+        if self.path.startswith("/stats"):
+            self.answer(200, body, "text/plain")
+            return
+        if self.path.startswith("/busy"):
+            self.answer(503, "busy", "text/plain")
+            return
+        match = re.match(r"/texture/(\d+)\.j2c$", self.path)
+        if not match:
+            self.answer(404, "no such texture", "text/plain")
+            return
+
+        data = texture(int(match.group(1)))
+        byte_range = re.match(r"bytes=(\d+)-(\d*)$", self.headers.get("Range", ""))
+        if not byte_range:
+            self.answer(200, data, "image/x-j2c")
+            return
+        first = int(byte_range.group(1))
+        last = min(int(byte_range.group(2) or len(data) - 1), len(data) - 1)
+        if first >= len(data):
+            self.answer(416, "", "text/plain")
+            return
+        self.answer(206, data[first:last + 1], "image/x-j2c",
+                    "bytes %d-%d/%d" % (first, last, len(data)))
+
+    def answer(self, status, body, content_type, content_range=None):
+        self.send_response(status)
+        self.send_header("Content-Type", content_type)
+        self.send_header("Content-Length", str(len(body)))
+        if content_range:
+            self.send_header("Content-Range", content_range)
+        self.end_headers()
+        self.wfile.write(body)
+
+    def log_request(self, code, size=None):
+        # For present purposes, we don't want the request splattered onto
+        # stderr, as it would upset devs watching the test run
+        pass
+
+    def log_error(self, format, *args):
+        # Suppress error output as well
+        pass
+
+class ThreadingHTTPServer(ThreadingMixIn, HTTPServer):
+    # a thread per connection, since the client keeps several open
+    daemon_threads = True
+
+class TestHTTPServer(Thread):
+    def __init__(self, *args, **kwds):
+        Thread.__init__(self, *args, **kwds)
+        # listen before the test starts rather than racing it
+        self.httpd = ThreadingHTTPServer(('127.0.0.1', PORT), TextureRequestHandler)
+
+    def run(self):
+        debug("Starting HTTP server...\n")
+        self.httpd.serve_forever()
+
+if __name__ == "__main__":
+    sys.exit(run(server=TestHTTPServer(name="httpd"), *sys.argv[1:]))
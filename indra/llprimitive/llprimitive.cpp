@@ -702,6 +702,11 @@ S32	face_index_from_id(LLFaceID face_ID, const std::vector<LLProfile::Face>& fac
 }
 
 BOOL LLPrimitive::setVolume(const LLVolumeParams &volume_params, const S32 detail, bool unique_volume)
+{
+	return setVolume(volume_params, detail, unique_volume, false);
+}
+
+BOOL LLPrimitive::setVolume(const LLVolumeParams &volume_params, const S32 detail, bool unique_volume, bool allow_placeholder)
 {
 	LLMemType m1(LLMemType::MTYPE_VOLUME);
 	LLVolume *volumep;
@@ -716,7 +721,8 @@ BOOL LLPrimitive::setVolume(const LLVolumeParams &volume_params, const S32 detai
 	}
 	else
 	{
-		if (mVolumep.notNull())
+		// a placeholder is swapped for the real volume as soon as there is one
+		if (mVolumep.notNull() && !mVolumep->isPlaceholder())
 		{
 			F32 volume_detail = LLVolumeLODGroup::getVolumeScaleFromDetail(detail);
 			if (volume_params == mVolumep->getParams() && (volume_detail == mVolumep->getDetail()))
@@ -725,11 +731,19 @@ BOOL LLPrimitive::setVolume(const LLVolumeParams &volume_params, const S32 detai
 			}
 		}
 
-		volumep = sVolumeManager->refVolume(volume_params, detail);
+		if (allow_placeholder)
+		{
+			volumep = sVolumeManager->refVolumeOrPlaceholder(volume_params, detail);
+		}
+		else
+		{
+			volumep = sVolumeManager->refVolume(volume_params, detail);
+		}
 		if (volumep == mVolumep)
 		{
 			sVolumeManager->unrefVolume( volumep );  // LLVolumeMgr::refVolume() creates a reference, but we don't need a second one.
-			return TRUE;
+			// still waiting for the build thread
+			return volumep->isPlaceholder() ? FALSE : TRUE;
 		}
 	}
 
@@ -328,6 +328,11 @@ public:
 	const LLVolume *getVolumeConst() const { return mVolumep; }		// HACK for Windoze confusion about ostream operator in LLVolume
 	LLVolume *getVolume() const { return mVolumep; }
 	virtual BOOL setVolume(const LLVolumeParams &volume_params, const S32 detail, bool unique_volume = false);
+	// With allow_placeholder a shared volume which is not built yet may be a
+	// placeholder until the volume manager's build thread is done with it,
+	// see LLVolumeMgr::refVolumeOrPlaceholder(). A placeholder is swapped for
+	// the real volume by the first call after it has been built.
+	BOOL setVolume(const LLVolumeParams &volume_params, const S32 detail, bool unique_volume, bool allow_placeholder);
 
 	// Modify texture entry properties
 	inline BOOL validTE(const U8 te_num) const;
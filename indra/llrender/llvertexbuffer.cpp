@@ -41,6 +41,7 @@ LLVBOPool LLVertexBuffer::sStreamVBOPool;
 LLVBOPool LLVertexBuffer::sDynamicVBOPool;
 LLVBOPool LLVertexBuffer::sStreamIBOPool;
 LLVBOPool LLVertexBuffer::sDynamicIBOPool;
+LLVertexBufferArena LLVertexBuffer::sClientArena;
 
 U32 LLVertexBuffer::sBindCount = 0;
 U32 LLVertexBuffer::sSetCount = 0;
@@ -340,6 +341,7 @@ void LLVertexBuffer::cleanupClass()
 	LLMemType mt2(LLMemType::MTYPE_VERTEX_CLEANUP_CLASS);
 	unbind();
 	clientCopy(); // deletes GL buffers
+	sClientArena.flush();
 }
 
 void LLVertexBuffer::clientCopy(F64 max_time)
@@ -523,7 +525,7 @@ void LLVertexBuffer::createGLBuffer()
 	{
 		static int gl_buffer_idx = 0;
 		mGLBuffer = ++gl_buffer_idx;
-		mMappedData = new U8[size];
+		mMappedData = sClientArena.allocate(size);
 		memset(mMappedData, 0, size);
 	}
 }
@@ -553,7 +555,7 @@ void LLVertexBuffer::createGLIndices()
 	}
 	else
 	{
-		mMappedIndexData = new U8[size];
+		mMappedIndexData = sClientArena.allocate(size);
 		memset(mMappedIndexData, 0, size);
 		static int gl_buffer_idx = 0;
 		mGLIndices = ++gl_buffer_idx;
@@ -575,7 +577,7 @@ void LLVertexBuffer::destroyGLBuffer()
 		}
 		else
 		{
-			delete [] mMappedData;
+			sClientArena.free(mMappedData);
 			mMappedData = NULL;
 			mEmpty = TRUE;
 		}
@@ -602,7 +604,7 @@ void LLVertexBuffer::destroyGLIndices()
 		}
 		else
 		{
-			delete [] mMappedIndexData;
+			sClientArena.free(mMappedIndexData);
 			mMappedIndexData = NULL;
 			mEmpty = TRUE;
 		}
@@ -730,23 +732,20 @@ void LLVertexBuffer::resizeBuffer(S32 newnverts, S32 newnindices)
 			}
 			else
 			{
-				//delete old buffer, keep GL buffer for now
+				//resize client buffer, keep GL buffer for now
 				if (!useVBOs())
 				{
-					U8* old = mMappedData;
-					mMappedData = new U8[newsize];
-					if (old)
+					if (mMappedData)
 					{	
-						memcpy(mMappedData, old, llmin(newsize, oldsize));
+						mMappedData = sClientArena.reallocate(mMappedData, newsize);
 						if (newsize > oldsize)
 						{
 							memset(mMappedData+oldsize, 0, newsize-oldsize);
 						}
-
-						delete [] old;
 					}
 					else
 					{
+						mMappedData = sClientArena.allocate(newsize);
 						memset(mMappedData, 0, newsize);
 						mEmpty = TRUE;
 					}
@@ -769,21 +768,18 @@ void LLVertexBuffer::resizeBuffer(S32 newnverts, S32 newnindices)
 			{
 				if (!useVBOs())
 				{
-					//delete old buffer, keep GL buffer for now
-					U8* old = mMappedIndexData;
-					mMappedIndexData = new U8[new_index_size];
-					
-					if (old)
+					//resize client buffer, keep GL buffer for now
+					if (mMappedIndexData)
 					{	
-						memcpy(mMappedIndexData, old, llmin(new_index_size, old_index_size));
+						mMappedIndexData = sClientArena.reallocate(mMappedIndexData, new_index_size);
 						if (new_index_size > old_index_size)
 						{
 							memset(mMappedIndexData+old_index_size, 0, new_index_size - old_index_size);
 						}
-						delete [] old;
 					}
 					else
 					{
+						mMappedIndexData = sClientArena.allocate(new_index_size);
 						memset(mMappedIndexData, 0, new_index_size);
 						mEmpty = TRUE;
 					}
@@ -34,6 +34,7 @@
 #include "v4coloru.h"
 #include "llstrider.h"
 #include "llrender.h"
+#include "llvertexbufferarena.h"
 #include <set>
 #include <vector>
 #include <list>
@@ -78,6 +79,9 @@ public:
 	static LLVBOPool sStreamIBOPool;
 	static LLVBOPool sDynamicIBOPool;
 
+	// client side vertex and index data when not using VBOs
+	static LLVertexBufferArena sClientArena;
+
 	static BOOL	sUseStreamDraw;
 
 	static void initClass(bool use_vbo);
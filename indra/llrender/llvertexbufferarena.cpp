@@ -0,0 +1,267 @@
+/**
+ * @file llvertexbufferarena.cpp
+ * @brief Size class arena for LLVertexBuffer client side memory
+ *
+ * $LicenseInfo:firstyear=2011&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2011, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llvertexbufferarena.h"
+
+#include "llmemory.h"
+
+F32 LLVertexBufferArena::Stats::getFragmentation() const
+{
+	U32 held = mReservedBytes + mCachedBytes;
+	if (!held)
+	{
+		return 0.f;
+	}
+	return 1.f - (F32) mInUseBytes / (F32) held;
+}
+
+LLVertexBufferArena::LLVertexBufferArena()
+:	mFrame(0),
+	mMaxCachedBytes(DEFAULT_MAX_CACHED_BYTES),
+	mCaching(true)
+{
+	memset(&mStats, 0, sizeof(mStats));
+}
+
+LLVertexBufferArena::~LLVertexBufferArena()
+{
+	flush();
+}
+
+//static
+U32 LLVertexBufferArena::getSizeClass(U32 size)
+{
+	if (size <= (1U << MIN_SHIFT))
+	{
+		return 0;
+	}
+	if (size > (1U << MAX_SHIFT))
+	{
+		return LARGE_BLOCK;
+	}
+
+	// size is in (2^shift, 2^(shift+1)], split into four classes
+	U32 shift = MIN_SHIFT;
+	while ((size - 1) >> (shift + 1))
+	{
+		++shift;
+	}
+	U32 quarter = ((size - 1 - (1U << shift)) >> (shift - 2));
+	return 1 + (shift - MIN_SHIFT) * 4 + quarter;
+}
+
+//static
+U32 LLVertexBufferArena::getClassSize(U32 size_class)
+{
+	if (size_class == 0)
+	{
+		return 1U << MIN_SHIFT;
+	}
+	U32 shift = MIN_SHIFT + (size_class - 1) / 4;
+	U32 quarters = (size_class - 1) % 4 + 1;
+	return (1U << shift) + quarters * (1U << (shift - 2));
+}
+
+//static
+U32 LLVertexBufferArena::getBlockSize(U32 size)
+{
+	U32 size_class = getSizeClass(size);
+	return size_class == LARGE_BLOCK ? size : getClassSize(size_class);
+}
+
+LLVertexBufferArena::Header* LLVertexBufferArena::newBlock(U32 size_class, U32 size)
+{
+	U32 block_size = size_class == LARGE_BLOCK ? size : getClassSize(size_class);
+	mStats.mAllocations++;
+
+	Header* header = NULL;
+	if (size_class != LARGE_BLOCK && !mFreeLists[size_class].empty())
+	{ //most recently freed first, it is likeliest to still be in cache
+		header = mFreeLists[size_class].back().mHeader;
+		mFreeLists[size_class].pop_back();
+		mStats.mCachedBytes -= block_size;
+		mStats.mCachedBlocks--;
+		mStats.mReuses++;
+	}
+	else
+	{
+		header = (Header*) ll_aligned_malloc_16(sizeof(Header) + block_size);
+		if (!header)
+		{
+			llerrs << "Out of memory allocating " << block_size << " bytes of vertex data" << llendl;
+		}
+		header->mSizeClass = size_class;
+	}
+
+	header->mSize = size;
+	mStats.mInUseBytes += size;
+	mStats.mReservedBytes += block_size;
+	mStats.mLiveBlocks++;
+	return header;
+}
+
+U8* LLVertexBufferArena::allocate(U32 size)
+{
+	if (!size)
+	{
+		return NULL;
+	}
+	return (U8*) (newBlock(getSizeClass(size), size) + 1);
+}
+
+U8* LLVertexBufferArena::reallocate(U8* block, U32 size)
+{
+	if (!block)
+	{
+		return allocate(size);
+	}
+	if (!size)
+	{
+		free(block);
+		return NULL;
+	}
+
+	Header* header = ((Header*) block) - 1;
+	U32 size_class = getSizeClass(size);
+	if (size_class == header->mSizeClass && size_class != LARGE_BLOCK)
+	{ //still fits, nothing to copy
+		mStats.mInUseBytes += size;
+		mStats.mInUseBytes -= header->mSize;
+		header->mSize = size;
+		return block;
+	}
+
+	U8* new_block = (U8*) (newBlock(size_class, size) + 1);
+	memcpy(new_block, block, llmin(size, header->mSize));
+	free(block);
+	return new_block;
+}
+
+void LLVertexBufferArena::free(U8* block)
+{
+	if (!block)
+	{
+		return;
+	}
+
+	Header* header = ((Header*) block) - 1;
+	U32 block_size = header->mSizeClass == LARGE_BLOCK ? header->mSize : getClassSize(header->mSizeClass);
+	mStats.mInUseBytes -= header->mSize;
+	mStats.mReservedBytes -= block_size;
+	mStats.mLiveBlocks--;
+
+	if (!mCaching || header->mSizeClass == LARGE_BLOCK)
+	{
+		ll_aligned_free_16(header);
+		return;
+	}
+
+	CachedBlock cached;
+	cached.mHeader = header;
+	cached.mFrame = mFrame;
+	mFreeLists[header->mSizeClass].push_back(cached);
+	mStats.mCachedBytes += block_size;
+	mStats.mCachedBlocks++;
+}
+
+void LLVertexBufferArena::releaseBlock(Header* header)
+{
+	mStats.mCachedBytes -= getClassSize(header->mSizeClass);
+	mStats.mCachedBlocks--;
+	mStats.mReleases++;
+	ll_aligned_free_16(header);
+}
+
+// Free lists are in the order blocks were freed, so the oldest are in front
+void LLVertexBufferArena::releaseOldest(free_list_t& list, U32 count)
+{
+	for (U32 i = 0; i < count; ++i)
+	{
+		releaseBlock(list[i].mHeader);
+	}
+	list.erase(list.begin(), list.begin() + count);
+}
+
+void LLVertexBufferArena::endFrame()
+{
+	++mFrame;
+
+	for (U32 i = 0; i < NUM_SIZE_CLASSES; ++i)
+	{
+		free_list_t& list = mFreeLists[i];
+		U32 idle = 0;
+		while (idle < list.size() && mFrame - list[idle].mFrame > MAX_IDLE_FRAMES)
+		{
+			++idle;
+		}
+		if (idle)
+		{
+			releaseOldest(list, idle);
+		}
+	}
+
+	// still too much, drop the biggest blocks first, they are the rarest
+	for (S32 i = NUM_SIZE_CLASSES - 1; i >= 0 && mStats.mCachedBytes > mMaxCachedBytes; --i)
+	{
+		free_list_t& list = mFreeLists[i];
+		U32 count = 0;
+		U32 block_size = getClassSize(i);
+		while (count < list.size() && mStats.mCachedBytes - count * block_size > mMaxCachedBytes)
+		{
+			++count;
+		}
+		if (count)
+		{
+			releaseOldest(list, count);
+		}
+	}
+}
+
+void LLVertexBufferArena::flush()
+{
+	for (U32 i = 0; i < NUM_SIZE_CLASSES; ++i)
+	{
+		releaseOldest(mFreeLists[i], mFreeLists[i].size());
+	}
+}
+
+void LLVertexBufferArena::setCaching(bool cache)
+{
+	mCaching = cache;
+	if (!mCaching)
+	{
+		flush();
+	}
+}
+
+void LLVertexBufferArena::resetCounters()
+{
+	mStats.mAllocations = 0;
+	mStats.mReuses = 0;
+	mStats.mReleases = 0;
+}
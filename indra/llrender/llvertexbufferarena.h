@@ -0,0 +1,138 @@
+/**
+ * @file llvertexbufferarena.h
+ * @brief Size class arena for LLVertexBuffer client side memory
+ *
+ * $LicenseInfo:firstyear=2011&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2011, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLVERTEXBUFFERARENA_H
+#define LL_LLVERTEXBUFFERARENA_H
+
+#include <vector>
+
+//============================================================================
+// Client side vertex and index memory for LLVertexBuffer.
+//
+// Blocks are rounded up to one of four size classes per power of two (so at
+// most a fifth of a block is slack) and freed blocks are kept on a list per
+// class for the next buffer of about that size, instead of going back to the
+// heap.  Rebuilding geometry frees and allocates buffers of much the same
+// sizes over and over, so most allocations are a pop off a free list.
+//
+// Reclamation is frame scoped: endFrame() hands back blocks that have sat on
+// a free list for more than a few frames, and the oldest ones past a cap on
+// cached bytes, so a burst of rebuilds doesn't pin its memory forever.
+//
+// Blocks are 16 byte aligned.  Not thread safe; LLVertexBuffer allocates on
+// the main thread only.
+
+class LLVertexBufferArena
+{
+public:
+	struct Stats
+	{
+		U32 mInUseBytes;	// bytes asked for by live blocks
+		U32 mReservedBytes;	// bytes of the size classes of live blocks
+		U32 mCachedBytes;	// bytes of blocks waiting on the free lists
+		U32 mLiveBlocks;
+		U32 mCachedBlocks;
+		U32 mAllocations;	// calls to allocate() and reallocate() that needed a block
+		U32 mReuses;		// ... of which were served from a free list
+		U32 mReleases;		// blocks handed back to the heap by endFrame()
+
+		// Share of the memory the arena holds that isn't holding vertex data:
+		// slack in live blocks plus everything on the free lists.
+		F32 getFragmentation() const;
+	};
+
+	LLVertexBufferArena();
+	~LLVertexBufferArena();
+
+	// Returns an uninitialized block of at least size bytes, NULL for 0.
+	U8* allocate(U32 size);
+
+	// Resizes block, keeping the first min(old size, size) bytes.  Returns
+	// block itself when it is already in the right size class.
+	U8* reallocate(U8* block, U32 size);
+
+	void free(U8* block);
+
+	// Call once a frame.  Releases blocks idle for more than
+	// MAX_IDLE_FRAMES frames, then the oldest ones while more than the cache
+	// cap is on the free lists.
+	void endFrame();
+
+	// Hands every cached block back to the heap.
+	void flush();
+
+	// With caching off, freed blocks go straight back to the heap.
+	void setCaching(bool cache);
+	void setMaxCachedBytes(U32 bytes)		{ mMaxCachedBytes = bytes; }
+
+	const Stats& getStats() const			{ return mStats; }
+	void resetCounters();
+
+	// block size for a request of size bytes
+	static U32 getBlockSize(U32 size);
+
+	enum
+	{
+		MIN_SHIFT = 6,				// smallest block is 64 bytes
+		MAX_SHIFT = 23,				// blocks over 8MB come straight off the heap
+		NUM_SIZE_CLASSES = 1 + (MAX_SHIFT - MIN_SHIFT) * 4,
+		LARGE_BLOCK = NUM_SIZE_CLASSES,
+		MAX_IDLE_FRAMES = 30,
+		DEFAULT_MAX_CACHED_BYTES = 32 * 1024 * 1024
+	};
+
+private:
+	// Sits in front of every block, which keeps blocks 16 byte aligned
+	struct Header
+	{
+		U32 mSizeClass;
+		U32 mSize;			// bytes asked for
+		U32 mPad[2];
+	};
+
+	struct CachedBlock
+	{
+		Header* mHeader;
+		U32 mFrame;			// frame it was freed in
+	};
+
+	typedef std::vector<CachedBlock> free_list_t;
+
+	static U32 getSizeClass(U32 size);
+	static U32 getClassSize(U32 size_class);
+
+	Header* newBlock(U32 size_class, U32 size);
+	void releaseBlock(Header* header);
+	void releaseOldest(free_list_t& list, U32 count);
+
+	free_list_t mFreeLists[NUM_SIZE_CLASSES];
+	Stats mStats;
+	U32 mFrame;
+	U32 mMaxCachedBytes;
+	bool mCaching;
+};
+
+#endif // LL_LLVERTEXBUFFERARENA_H
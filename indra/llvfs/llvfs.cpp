@@ -29,14 +29,20 @@
 #include <sys/stat.h>
 #include <set>
 #include <map>
+#include <algorithm>
 #if LL_WINDOWS
 #include <share.h>
+#include <io.h>
+#include <windows.h>
 #elif LL_SOLARIS
 #include <sys/types.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <errno.h>
 #else
 #include <sys/file.h>
+#include <unistd.h>
+#include <errno.h>
 #endif
     
 #include "llvfs.h"
@@ -170,7 +176,8 @@ public:
 		buffer += 4;
 		swizzleCopy(buffer, &mLength, 4);
 		buffer +=4;
-		swizzleCopy(buffer, &mAccessTime, 4);
+		U32 access_time = mAccessTime;
+		swizzleCopy(buffer, &access_time, 4);
 		buffer +=4;
 		memcpy(buffer, &mFileID.mData, 16); /* Flawfinder: ignore */	
 		buffer += 16;
@@ -188,7 +195,9 @@ public:
 		buffer += 4;
 		swizzleCopy(&mLength, buffer, 4);
 		buffer += 4;
-		swizzleCopy(&mAccessTime, buffer, 4);
+		U32 access_time;
+		swizzleCopy(&access_time, buffer, 4);
+		mAccessTime = access_time;
 		buffer += 4;
 		memcpy(&mFileID.mData, buffer, 16);
 		buffer += 16;
@@ -202,15 +211,17 @@ public:
 	static BOOL insertLRU(LLVFSFileBlock* const& first,
 						  LLVFSFileBlock* const& second)
 	{
-		return (first->mAccessTime == second->mAccessTime)
+		U32 first_time = first->mAccessTime;
+		U32 second_time = second->mAccessTime;
+		return (first_time == second_time)
 			? *first < *second
-			: first->mAccessTime < second->mAccessTime;
+			: first_time < second_time;
 	}
     
 public:
 	S32  mSize;
 	S32  mIndexLocation; // location of index entry
-	U32  mAccessTime;
+	LLAtomicU32 mAccessTime; // set by readers holding only the read lock
 	BOOL mLocks[VFSLOCK_COUNT]; // number of outstanding locks of each type
     
 	static const S32 SERIAL_SIZE;
@@ -232,9 +243,10 @@ const S32 LLVFSFileBlock::SERIAL_SIZE = 34;
 LLVFS::LLVFS(const std::string& index_filename, const std::string& data_filename, const BOOL read_only, const U32 presize, const BOOL remove_after_crash)
 :	mRemoveAfterCrash(remove_after_crash),
 	mDataFP(NULL),
-	mIndexFP(NULL)
+	mIndexFP(NULL),
+	mNeedsCompaction(TRUE)
 {
-	mDataMutex = new LLMutex(0);
+	mDataLock = new LLReadWriteLock(0);
 
 	S32 i;
 	for (i = 0; i < VFSLOCK_COUNT; i++)
@@ -558,12 +570,36 @@ LLVFS::LLVFS(const std::string& index_filename, const std::string& data_filename
 	mValid = VFSVALID_OK;
 }
     
+LLVFS::LLVFS(const std::vector<LLVFS*>& shards)
+:	mRemoveAfterCrash(FALSE),
+	mDataFP(NULL),
+	mIndexFP(NULL),
+	mNeedsCompaction(FALSE),
+	mShards(shards)
+{
+	mDataLock = new LLReadWriteLock(0);
+
+	for (S32 i = 0; i < VFSLOCK_COUNT; i++)
+	{
+		mLockCounts[i] = 0;
+	}
+	mReadOnly = mShards[0]->mReadOnly;
+	mIndexFilename = mShards[0]->mIndexFilename;
+	mDataFilename = mShards[0]->mDataFilename;
+	mValid = VFSVALID_OK;
+
+	LL_INFOS("VFS") << "Using " << mShards.size() << " VFS shards" << LL_ENDL;
+}
+
 LLVFS::~LLVFS()
 {
-	if (mDataMutex->isLocked())
+	if (mDataLock->isLocked())
 	{
 		LL_ERRS("VFS") << "LLVFS destroyed with mutex locked" << LL_ENDL;
 	}
+
+	for_each(mShards.begin(), mShards.end(), DeletePointer());
+	mShards.clear();
 	
 	unlockAndClose(mIndexFP);
 	mIndexFP = NULL;
@@ -589,7 +625,7 @@ LLVFS::~LLVFS()
 		LLFile::remove(marker);
 	}
 
-	delete mDataMutex;
+	delete mDataLock;
 }
 
 
@@ -600,8 +636,29 @@ LLVFS * LLVFS::createLLVFS(const std::string& index_filename,
 		const std::string& data_filename, 
 		const BOOL read_only, 
 		const U32 presize, 
-		const BOOL remove_after_crash)
+		const BOOL remove_after_crash,
+		const S32 shard_count)
 {
+	if (shard_count > 1)
+	{
+		std::vector<LLVFS*> shards;
+		for (S32 i = 0; i < shard_count; i++)
+		{
+			LLVFS* shard = createLLVFS(getShardFilename(index_filename, i),
+									   getShardFilename(data_filename, i),
+									   read_only,
+									   presize / shard_count,
+									   remove_after_crash);
+			if (!shard)
+			{
+				for_each(shards.begin(), shards.end(), DeletePointer());
+				return NULL;
+			}
+			shards.push_back(shard);
+		}
+		return new LLVFS(shards);
+	}
+
 	LLVFS * new_vfs = new LLVFS(index_filename, data_filename, read_only, presize, remove_after_crash);
 
 	if( !new_vfs->isValid() )
@@ -631,6 +688,13 @@ LLVFS * LLVFS::createLLVFS(const std::string& index_filename,
 	return new_vfs;
 }
 
+// static
+std::string LLVFS::getShardFilename(const std::string& filename, S32 shard)
+{
+	// Not a '.' suffix, the viewer looks for the salt after the last one
+	return shard ? filename + llformat("_%d", shard) : filename;
+}
+
 
 
 void LLVFS::presizeDataFile(const U32 size)
@@ -662,6 +726,11 @@ void LLVFS::presizeDataFile(const U32 size)
 
 BOOL LLVFS::getExists(const LLUUID &file_id, const LLAssetType::EType file_type)
 {
+	if (!mShards.empty())
+	{
+		return getShard(file_id)->getExists(file_id, file_type);
+	}
+
 	LLVFSFileBlock *block = NULL;
 		
 	if (!isValid())
@@ -669,7 +738,9 @@ BOOL LLVFS::getExists(const LLUUID &file_id, const LLAssetType::EType file_type)
 		llerrs << "Attempting to use invalid VFS!" << llendl;
 	}
 
-	lockData();
+	// Readers set mAccessTime holding only the read lock, which is why it
+	// is atomic. It only orders files for LRU removal.
+	readLockData();
 	
 	LLVFSFileSpecifier spec(file_id, file_type);
 	fileblock_map::iterator it = mFileBlocks.find(spec);
@@ -688,6 +759,11 @@ BOOL LLVFS::getExists(const LLUUID &file_id, const LLAssetType::EType file_type)
     
 S32	 LLVFS::getSize(const LLUUID &file_id, const LLAssetType::EType file_type)
 {
+	if (!mShards.empty())
+	{
+		return getShard(file_id)->getSize(file_id, file_type);
+	}
+
 	S32 size = 0;
 	
 	if (!isValid())
@@ -696,7 +772,7 @@ S32	 LLVFS::getSize(const LLUUID &file_id, const LLAssetType::EType file_type)
 
 	}
 
-	lockData();
+	readLockData();
 	
 	LLVFSFileSpecifier spec(file_id, file_type);
 	fileblock_map::iterator it = mFileBlocks.find(spec);
@@ -715,6 +791,11 @@ S32	 LLVFS::getSize(const LLUUID &file_id, const LLAssetType::EType file_type)
     
 S32  LLVFS::getMaxSize(const LLUUID &file_id, const LLAssetType::EType file_type)
 {
+	if (!mShards.empty())
+	{
+		return getShard(file_id)->getMaxSize(file_id, file_type);
+	}
+
 	S32 size = 0;
 	
 	if (!isValid())
@@ -722,7 +803,7 @@ S32  LLVFS::getMaxSize(const LLUUID &file_id, const LLAssetType::EType file_type
 		llerrs << "Attempting to use invalid VFS!" << llendl;
 	}
 
-	lockData();
+	readLockData();
 	
 	LLVFSFileSpecifier spec(file_id, file_type);
 	fileblock_map::iterator it = mFileBlocks.find(spec);
@@ -741,7 +822,20 @@ S32  LLVFS::getMaxSize(const LLUUID &file_id, const LLAssetType::EType file_type
 
 BOOL LLVFS::checkAvailable(S32 max_size)
 {
-	lockData();
+	if (!mShards.empty())
+	{
+		// The file could land in any of them
+		for (std::vector<LLVFS*>::iterator iter = mShards.begin(); iter != mShards.end(); ++iter)
+		{
+			if (!(*iter)->checkAvailable(max_size))
+			{
+				return FALSE;
+			}
+		}
+		return TRUE;
+	}
+
+	readLockData();
 	
 	blocks_length_map_t::iterator iter = mFreeBlocksByLength.lower_bound(max_size); // first entry >= size
 	const BOOL res(iter == mFreeBlocksByLength.end() ? FALSE : TRUE);
@@ -753,6 +847,11 @@ BOOL LLVFS::checkAvailable(S32 max_size)
 
 BOOL LLVFS::setMaxSize(const LLUUID &file_id, const LLAssetType::EType file_type, S32 max_size)
 {
+	if (!mShards.empty())
+	{
+		return getShard(file_id)->setMaxSize(file_id, file_type, max_size);
+	}
+
 	if (!isValid())
 	{
 		llerrs << "Attempting to use invalid VFS!" << llendl;
@@ -880,6 +979,7 @@ BOOL LLVFS::setMaxSize(const LLUUID &file_id, const LLAssetType::EType file_type
 							{
 								llwarns << "Short write" << llendl;
 							}
+							fflush(mDataFP);
 						} else {
 							llwarns << "Short read" << llendl;
 						}
@@ -960,6 +1060,21 @@ void LLVFS::renameFile(const LLUUID &file_id, const LLAssetType::EType file_type
 		llerrs << "Attempt to write to read-only VFS" << llendl;
 	}
 
+	if (!mShards.empty())
+	{
+		LLVFS* src = getShard(file_id);
+		LLVFS* dest = getShard(new_id);
+		if (src == dest)
+		{
+			src->renameFile(file_id, file_type, new_id, new_type);
+		}
+		else
+		{
+			renameAcrossShards(src, file_id, file_type, dest, new_id, new_type);
+		}
+		return;
+	}
+
 	lockData();
 	
 	LLVFSFileSpecifier new_spec(new_id, new_type);
@@ -1014,7 +1129,7 @@ void LLVFS::renameFile(const LLUUID &file_id, const LLAssetType::EType file_type
 	unlockData();
 }
 
-// mDataMutex must be LOCKED before calling this
+// mDataLock must be write LOCKED before calling this
 void LLVFS::removeFileBlock(LLVFSFileBlock *fileblock)
 {
 	// convert this into an unsaved, dummy fileblock to preserve locks
@@ -1039,6 +1154,12 @@ void LLVFS::removeFileBlock(LLVFSFileBlock *fileblock)
 
 void LLVFS::removeFile(const LLUUID &file_id, const LLAssetType::EType file_type)
 {
+	if (!mShards.empty())
+	{
+		getShard(file_id)->removeFile(file_id, file_type);
+		return;
+	}
+
 	if (!isValid())
 	{
 		llerrs << "Attempting to use invalid VFS!" << llendl;
@@ -1068,6 +1189,11 @@ void LLVFS::removeFile(const LLUUID &file_id, const LLAssetType::EType file_type
     
 S32 LLVFS::getData(const LLUUID &file_id, const LLAssetType::EType file_type, U8 *buffer, S32 location, S32 length)
 {
+	if (!mShards.empty())
+	{
+		return getShard(file_id)->getData(file_id, file_type, buffer, location, length);
+	}
+
 	S32 bytesread = 0;
 	
 	if (!isValid())
@@ -1079,7 +1205,7 @@ S32 LLVFS::getData(const LLUUID &file_id, const LLAssetType::EType file_type, U8
 
 	BOOL do_read = FALSE;
 	
-    lockData();
+	readLockData();
 	
 	LLVFSFileSpecifier spec(file_id, file_type);
 	fileblock_map::iterator it = mFileBlocks.find(spec);
@@ -1106,8 +1232,7 @@ S32 LLVFS::getData(const LLUUID &file_id, const LLAssetType::EType file_type, U8
 
 	if (do_read)
 	{
-		fseek(mDataFP, location, SEEK_SET);
-		bytesread = (S32)fread(buffer, 1, length, mDataFP);
+		bytesread = readDataAt(buffer, location, length);
 	}
 	
 	unlockData();
@@ -1117,6 +1242,11 @@ S32 LLVFS::getData(const LLUUID &file_id, const LLAssetType::EType file_type, U8
     
 S32 LLVFS::storeData(const LLUUID &file_id, const LLAssetType::EType file_type, const U8 *buffer, S32 location, S32 length)
 {
+	if (!mShards.empty())
+	{
+		return getShard(file_id)->storeData(file_id, file_type, buffer, location, length);
+	}
+
 	if (!isValid())
 	{
 		llerrs << "Attempting to use invalid VFS!" << llendl;
@@ -1182,7 +1312,8 @@ S32 LLVFS::storeData(const LLUUID &file_id, const LLAssetType::EType file_type,
 			{
 				llwarns << llformat("VFS Write Error: %d != %d",write_len,length) << llendl;
 			}
-			// fflush(mDataFP);
+			// readDataAt() goes around the stdio buffer
+			fflush(mDataFP);
 			
 			if (location + length > block->mSize)
 			{
@@ -1203,6 +1334,12 @@ S32 LLVFS::storeData(const LLUUID &file_id, const LLAssetType::EType file_type,
  
 void LLVFS::incLock(const LLUUID &file_id, const LLAssetType::EType file_type, EVFSLock lock)
 {
+	if (!mShards.empty())
+	{
+		getShard(file_id)->incLock(file_id, file_type, lock);
+		return;
+	}
+
 	lockData();
 
 	LLVFSFileSpecifier spec(file_id, file_type);
@@ -1229,6 +1366,12 @@ void LLVFS::incLock(const LLUUID &file_id, const LLAssetType::EType file_type, E
 
 void LLVFS::decLock(const LLUUID &file_id, const LLAssetType::EType file_type, EVFSLock lock)
 {
+	if (!mShards.empty())
+	{
+		getShard(file_id)->decLock(file_id, file_type, lock);
+		return;
+	}
+
 	lockData();
 
 	LLVFSFileSpecifier spec(file_id, file_type);
@@ -1253,7 +1396,12 @@ void LLVFS::decLock(const LLUUID &file_id, const LLAssetType::EType file_type, E
 
 BOOL LLVFS::isLocked(const LLUUID &file_id, const LLAssetType::EType file_type, EVFSLock lock)
 {
-	lockData();
+	if (!mShards.empty())
+	{
+		return getShard(file_id)->isLocked(file_id, file_type, lock);
+	}
+
+	readLockData();
 	
 	BOOL res = FALSE;
 	
@@ -1270,10 +1418,223 @@ BOOL LLVFS::isLocked(const LLUUID &file_id, const LLAssetType::EType file_type,
 	return res;
 }
 
+S32 LLVFS::compact(S32 max_bytes)
+{
+	if (!mShards.empty())
+	{
+		S32 moved = 0;
+		for (std::vector<LLVFS*>::iterator iter = mShards.begin();
+			 iter != mShards.end() && moved < max_bytes; ++iter)
+		{
+			moved += (*iter)->compact(max_bytes - moved);
+		}
+		return moved;
+	}
+
+	if (!isValid() || mReadOnly || (!mNeedsCompaction && mCompactQueue.empty()))
+	{
+		return 0;
+	}
+
+	lockData();
+
+	// Last file first. A file which moves only ever moves down, past the
+	// files still to be looked at, so none is looked at twice in a pass.
+	// A pass lasts over as many calls as it needs; the files are only
+	// listed again once it is over and something has been freed since it
+	// began, and at most once a call.
+	S32 moved = 0;
+	bool listed = false;
+	std::vector<U8> buffer;
+	while (moved < max_bytes)
+	{
+		if (mFreeBlocksByLocation.empty())
+		{
+			// nothing will move until space is freed
+			mCompactQueue.clear();
+			mNeedsCompaction = FALSE;
+			break;
+		}
+		if (mCompactQueue.empty())
+		{
+			if (listed || !mNeedsCompaction)
+			{
+				break;
+			}
+			for (fileblock_map::iterator it = mFileBlocks.begin(); it != mFileBlocks.end(); ++it)
+			{
+				LLVFSFileBlock *block = (*it).second;
+				if (block->mLength > 0)
+				{
+					mCompactQueue.push_back(compact_queue_t::value_type(block->mLocation, (*it).first));
+				}
+			}
+			std::sort(mCompactQueue.begin(), mCompactQueue.end());
+			mNeedsCompaction = FALSE;
+			listed = true;
+			continue;
+		}
+
+		compact_queue_t::value_type entry = mCompactQueue.back();
+		mCompactQueue.pop_back();
+		if (entry.first < mFreeBlocksByLocation.begin()->first)
+		{
+			// everything from here down is packed already
+			mCompactQueue.clear();
+			continue;
+		}
+
+		// skip files removed, resized or moved since they were listed
+		fileblock_map::iterator file_it = mFileBlocks.find(entry.second);
+		if (file_it == mFileBlocks.end())
+		{
+			continue;
+		}
+		LLVFSFileBlock *block = (*file_it).second;
+		if (block->mLocation != entry.first || block->mLength <= 0)
+		{
+			continue;
+		}
+
+		// smallest free block before the file which will hold it
+		LLVFSBlock *free_block = NULL;
+		for (blocks_length_map_t::iterator free_it = mFreeBlocksByLength.lower_bound(block->mLength);
+			 free_it != mFreeBlocksByLength.end(); ++free_it)
+		{
+			if (free_it->second->mLocation < block->mLocation)
+			{
+				free_block = free_it->second;
+				break;
+			}
+		}
+		if (!free_block)
+		{
+			continue;
+		}
+
+		// The data is copied before the index points at it, and the
+		// free block never overlaps the file, so a crash at any point
+		// leaves the file whole in one place or the other.
+		U32 new_location = free_block->mLocation;
+		if (block->mSize > 0)
+		{
+			buffer.resize(block->mSize);
+			fseek(mDataFP, block->mLocation, SEEK_SET);
+			if (fread(&buffer[0], block->mSize, 1, mDataFP) != 1)
+			{
+				llwarns << "Short read" << llendl;
+				continue;
+			}
+			fseek(mDataFP, new_location, SEEK_SET);
+			if (fwrite(&buffer[0], block->mSize, 1, mDataFP) != 1)
+			{
+				llwarns << "Short write" << llendl;
+				continue;
+			}
+			fflush(mDataFP);
+		}
+
+		// Must call useFreeSpace before addFreeBlock, which may merge
+		// the old location with free_block.
+		useFreeSpace(free_block, block->mLength);
+		addFreeBlock(new LLVFSBlock(block->mLocation, block->mLength));
+		block->mLocation = new_location;
+		sync(block);
+
+		moved += block->mLength;
+	}
+
+	unlockData();
+
+	return moved;
+}
+
 //============================================================================
 // protected
 //============================================================================
 
+S32 LLVFS::readDataAt(U8 *buffer, U32 location, S32 length)
+{
+#if LL_WINDOWS
+	// ReadFile() moves the file position as well, but every other data
+	// file access seeks first and holds the write lock
+	HANDLE handle = (HANDLE)_get_osfhandle(_fileno(mDataFP));
+	OVERLAPPED overlapped;
+	memset(&overlapped, 0, sizeof(overlapped));
+	overlapped.Offset = location;
+	DWORD bytes_read = 0;
+	if (!ReadFile(handle, buffer, length, &bytes_read, &overlapped))
+	{
+		return 0;
+	}
+	return (S32)bytes_read;
+#else
+	S32 bytes_read = 0;
+	while (bytes_read < length)
+	{
+		ssize_t result = pread(fileno(mDataFP), buffer + bytes_read, length - bytes_read, location + bytes_read);
+		if (result > 0)
+		{
+			bytes_read += (S32)result;
+		}
+		else if (result < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		else
+		{
+			break;
+		}
+	}
+	return bytes_read;
+#endif
+}
+
+// The new id belongs to another shard, so the file is copied over. Its
+// locks go with it, as they do when renaming within one data file.
+void LLVFS::renameAcrossShards(LLVFS* src, const LLUUID &file_id, const LLAssetType::EType file_type,
+							   LLVFS* dest, const LLUUID &new_id, const LLAssetType::EType new_type)
+{
+	S32 max_size = src->getMaxSize(file_id, file_type);
+	if (max_size <= 0)
+	{
+		llwarns << "VFS: Attempt to rename nonexistent vfile " << file_id << ":" << file_type << llendl;
+		return;
+	}
+
+	S32 size = src->getSize(file_id, file_type);
+	std::vector<U8> buffer(size);
+	if (size > 0)
+	{
+		size = src->getData(file_id, file_type, &buffer[0], 0, size);
+	}
+
+	if (dest->getExists(new_id, new_type))
+	{
+		dest->removeFile(new_id, new_type);
+	}
+	if (!dest->setMaxSize(new_id, new_type, max_size))
+	{
+		llwarns << "VFS: No space to rename vfile " << file_id << " to " << new_id << llendl;
+	}
+	else if (size > 0)
+	{
+		dest->storeData(new_id, new_type, &buffer[0], 0, size);
+	}
+
+	for (S32 i = 0; i < (S32)VFSLOCK_COUNT; i++)
+	{
+		EVFSLock lock = (EVFSLock)i;
+		while (src->isLocked(file_id, file_type, lock))
+		{
+			src->decLock(file_id, file_type, lock);
+			dest->incLock(new_id, new_type, lock);
+		}
+	}
+
+	src->removeFile(file_id, file_type);
+}
+
 void LLVFS::eraseBlockLength(LLVFSBlock *block)
 {
 	// find the corresponding map entry in the length map and erase it
@@ -1314,6 +1675,8 @@ void LLVFS::eraseBlock(LLVFSBlock *block)
 // Also incrementally defragment by merging with previous and next free blocks.
 void LLVFS::addFreeBlock(LLVFSBlock *block)
 {
+	mNeedsCompaction = TRUE;
+
 #if LL_DEBUG
 	size_t dbgcount = mFreeBlocksByLocation.count(block->mLocation);
 	if(dbgcount > 0)
@@ -1451,7 +1814,7 @@ void LLVFS::useFreeSpace(LLVFSBlock *free_block, S32 length)
 	}
 }
 
-// NOTE! mDataMutex must be LOCKED before calling this
+// NOTE! mDataLock must be write LOCKED before calling this
 // sync this index entry out to the index file
 // we need to do this constantly to avoid corruption on viewer crash
 void LLVFS::sync(LLVFSFileBlock *block, BOOL remove)
@@ -1533,7 +1896,7 @@ void LLVFS::sync(LLVFSFileBlock *block, BOOL remove)
 	return;
 }
 
-// mDataMutex must be LOCKED before calling this
+// mDataLock must be write LOCKED before calling this
 // Can initiate LRU-based file removal to make space.
 // The immune file block will not be removed.
 LLVFSBlock *LLVFS::findFreeBlock(S32 size, LLVFSFileBlock *immune)
@@ -1645,6 +2008,15 @@ LLVFSBlock *LLVFS::findFreeBlock(S32 size, LLVFSFileBlock *immune)
 
 void LLVFS::pokeFiles()
 {
+	if (!mShards.empty())
+	{
+		for (std::vector<LLVFS*>::iterator iter = mShards.begin(); iter != mShards.end(); ++iter)
+		{
+			(*iter)->pokeFiles();
+		}
+		return;
+	}
+
 	if (!isValid())
 	{
 		llerrs << "Attempting to use invalid VFS!" << llendl;
@@ -1679,6 +2051,15 @@ void LLVFS::pokeFiles()
     
 void LLVFS::dumpMap()
 {
+	if (!mShards.empty())
+	{
+		for (std::vector<LLVFS*>::iterator iter = mShards.begin(); iter != mShards.end(); ++iter)
+		{
+			(*iter)->dumpMap();
+		}
+		return;
+	}
+
 	llinfos << "Files:" << llendl;
 	for (fileblock_map::iterator it = mFileBlocks.begin(); it != mFileBlocks.end(); ++it)
 	{
@@ -1700,8 +2081,17 @@ void LLVFS::dumpMap()
 // Very slow, do not call routinely. JC
 void LLVFS::audit()
 {
-	// Lock the mutex through this whole function.
-	LLMutexLock lock_data(mDataMutex);
+	if (!mShards.empty())
+	{
+		for (std::vector<LLVFS*>::iterator iter = mShards.begin(); iter != mShards.end(); ++iter)
+		{
+			(*iter)->audit();
+		}
+		return;
+	}
+
+	// Lock the data through this whole function.
+	lockData();
 	
 	fflush(mIndexFP);
 
@@ -1830,10 +2220,11 @@ void LLVFS::audit()
 		}
     
 		llinfos << "VFS: audit OK" << llendl;
-		// mutex released by LLMutexLock() destructor.
 	}
 
 	for_each(audit_blocks.begin(), audit_blocks.end(), DeletePointer());
+
+	unlockData();
 }
     
     
@@ -1841,6 +2232,15 @@ void LLVFS::audit()
 // Slow, do not call in release.
 void LLVFS::checkMem()
 {
+	if (!mShards.empty())
+	{
+		for (std::vector<LLVFS*>::iterator iter = mShards.begin(); iter != mShards.end(); ++iter)
+		{
+			(*iter)->checkMem();
+		}
+		return;
+	}
+
 	lockData();
 	
 	for (fileblock_map::iterator it = mFileBlocks.begin(); it != mFileBlocks.end(); ++it)
@@ -1868,6 +2268,15 @@ void LLVFS::checkMem()
 
 void LLVFS::dumpLockCounts()
 {
+	if (!mShards.empty())
+	{
+		for (std::vector<LLVFS*>::iterator iter = mShards.begin(); iter != mShards.end(); ++iter)
+		{
+			(*iter)->dumpLockCounts();
+		}
+		return;
+	}
+
 	S32 i;
 	for (i = 0; i < VFSLOCK_COUNT; i++)
 	{
@@ -1877,6 +2286,15 @@ void LLVFS::dumpLockCounts()
 
 void LLVFS::dumpStatistics()
 {
+	if (!mShards.empty())
+	{
+		for (std::vector<LLVFS*>::iterator iter = mShards.begin(); iter != mShards.end(); ++iter)
+		{
+			(*iter)->dumpStatistics();
+		}
+		return;
+	}
+
 	lockData();
 	
 	// Investigate file blocks.
@@ -2046,6 +2464,15 @@ std::string get_extension(LLAssetType::EType type)
 
 void LLVFS::listFiles()
 {
+	if (!mShards.empty())
+	{
+		for (std::vector<LLVFS*>::iterator iter = mShards.begin(); iter != mShards.end(); ++iter)
+		{
+			(*iter)->listFiles();
+		}
+		return;
+	}
+
 	lockData();
 	
 	for (fileblock_map::iterator it = mFileBlocks.begin(); it != mFileBlocks.end(); ++it)
@@ -2071,6 +2498,15 @@ void LLVFS::listFiles()
 #include "llapr.h"
 void LLVFS::dumpFiles()
 {
+	if (!mShards.empty())
+	{
+		for (std::vector<LLVFS*>::iterator iter = mShards.begin(); iter != mShards.end(); ++iter)
+		{
+			(*iter)->dumpFiles();
+		}
+		return;
+	}
+
 	lockData();
 	
 	S32 files_extracted = 0;
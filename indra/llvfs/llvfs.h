@@ -28,6 +28,7 @@
 #define LL_LLVFS_H
 
 #include <deque>
+#include <vector>
 #include "lluuid.h"
 #include "linked_lists.h"
 #include "llassettype.h"
@@ -69,6 +70,11 @@ public:
 	LLAssetType::EType mFileType;
 };
 
+// A sharded VFS spreads its files over several index and data file pairs
+// by a hash of the file id. Each shard is an LLVFS of its own with its own
+// lock, so work on files in different shards never waits on each other,
+// and LLVFS is then only a front end which hands every call to the right
+// shard. Within one file, any number of reads can go on at once.
 class LLVFS
 {
 private:
@@ -79,21 +85,29 @@ private:
 			const BOOL read_only, 
 			const U32 presize, 
 			const BOOL remove_after_crash);
+	// Front end for a sharded VFS, takes ownership of the shards
+	LLVFS(const std::vector<LLVFS*>& shards);
 public:
 	~LLVFS();
 
 	// Use this function normally to create LLVFS files
-	// Pass 0 to not presize
+	// Pass 0 to not presize, the presize is split between the shards
 	static LLVFS * createLLVFS(const std::string& index_filename, 
 			const std::string& data_filename, 
 			const BOOL read_only, 
 			const U32 presize, 
-			const BOOL remove_after_crash);
+			const BOOL remove_after_crash,
+			const S32 shard_count = 1);
+
+	// Name of the index or data file of one shard. Shard 0 uses the name
+	// itself, so a VFS with one shard is the same as an unsharded one.
+	static std::string getShardFilename(const std::string& filename, S32 shard);
 
 	BOOL isValid() const			{ return (VFSVALID_OK == mValid); }
 	EVFSValid getValidState() const	{ return mValid; }
+	S32 getShardCount() const		{ return mShards.empty() ? 1 : (S32)mShards.size(); }
 
-	// ---------- The following fucntions lock/unlock mDataMutex ----------
+	// ---------- The following fucntions lock/unlock mDataLock ----------
 	BOOL getExists(const LLUUID &file_id, const LLAssetType::EType file_type);
 	S32	 getSize(const LLUUID &file_id, const LLAssetType::EType file_type);
 
@@ -112,6 +126,12 @@ public:
 	void incLock(const LLUUID &file_id, const LLAssetType::EType file_type, EVFSLock lock);
 	void decLock(const LLUUID &file_id, const LLAssetType::EType file_type, EVFSLock lock);
 	BOOL isLocked(const LLUUID &file_id, const LLAssetType::EType file_type, EVFSLock lock);
+
+	// Moves files from the end of the data file into free space nearer the
+	// start, so that free space gathers in one piece at the end instead of
+	// in small holes between files. Stops after moving about max_bytes and
+	// returns the number of bytes moved, 0 once there is nothing to do.
+	S32 compact(S32 max_bytes);
 	// ----------------------------------------------------------------
 
 	// Used to trigger evil WinXP behavior of "preloading" entire file into memory.
@@ -142,17 +162,28 @@ protected:
 
 	static LLFILE *openAndLock(const std::string& filename, const char* mode, BOOL read_lock);
 	static void unlockAndClose(FILE *fp);
+
+	// Reads from the data file without going through its file position,
+	// so it is safe with only the read lock held
+	S32 readDataAt(U8 *buffer, U32 location, S32 length);
+
+	LLVFS* getShard(const LLUUID &file_id) const { return mShards[file_id.getCRC32() % mShards.size()]; }
+	void renameAcrossShards(LLVFS* src, const LLUUID &file_id, const LLAssetType::EType file_type,
+							LLVFS* dest, const LLUUID &new_id, const LLAssetType::EType new_type);
 	
 	// Can initiate LRU-based file removal to make space.
 	// The immune file block will not be removed.
 	LLVFSBlock *findFreeBlock(S32 size, LLVFSFileBlock *immune = NULL);
 
-	// lock/unlock data mutex (mDataMutex)
-	void lockData() { mDataMutex->lock(); }
-	void unlockData() { mDataMutex->unlock(); }	
+	// lock/unlock data lock (mDataLock). Anything which only looks
+	// may take the read lock, anything which changes the files or the
+	// block maps needs the write lock.
+	void lockData() { mDataLock->writeLock(); }
+	void readLockData() { mDataLock->readLock(); }
+	void unlockData() { mDataLock->unlock(); }	
 	
 protected:
-	LLMutex* mDataMutex;
+	LLReadWriteLock* mDataLock;
 	
 	typedef std::map<LLVFSFileSpecifier, LLVFSFileBlock*> fileblock_map;
 	fileblock_map mFileBlocks;
@@ -175,6 +206,15 @@ protected:
 
 	S32 mLockCounts[VFSLOCK_COUNT];
 	BOOL mRemoveAfterCrash;
+
+	// Set when space is freed, cleared when compact() lists the files
+	BOOL mNeedsCompaction;
+	// Files compact() has yet to look at in its current pass, by location
+	typedef std::vector<std::pair<U32, LLVFSFileSpecifier> > compact_queue_t;
+	compact_queue_t mCompactQueue;
+
+	// Only set on the front end of a sharded VFS
+	std::vector<LLVFS*> mShards;
 };
 
 extern LLVFS *gVFS;
@@ -0,0 +1,244 @@
+/**
+ * @file llvfs_test.cpp
+ * @brief Test for llvfs.cpp.
+ *
+ * $LicenseInfo:firstyear=2011&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2011, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llvfs.h"
+
+#include "llfile.h"
+
+#include "../test/lltut.h"
+
+namespace tut
+{
+	const S32 VFS_SIZE = 1024 * 1024;
+	const S32 SHARDS = 4;
+
+	struct vfs_data
+	{
+		vfs_data()
+		{
+			ll_init_apr();
+			LLUUID random;
+			random.generate();
+#if LL_WINDOWS
+			mFilename = "C:\\vfs-test-" + random.asString();
+#else
+			mFilename = "/tmp/vfs-test-" + random.asString();
+#endif
+		}
+
+		~vfs_data()
+		{
+			for (S32 i = 0; i < SHARDS; ++i)
+			{
+				LLFile::remove(LLVFS::getShardFilename(mFilename + ".index", i));
+				LLFile::remove(LLVFS::getShardFilename(mFilename + ".data", i));
+			}
+		}
+
+		LLVFS* open(S32 shard_count)
+		{
+			LLVFS* vfs = LLVFS::createLLVFS(mFilename + ".index", mFilename + ".data",
+											FALSE, VFS_SIZE, FALSE, shard_count);
+			ensure("opened", vfs && vfs->isValid());
+			return vfs;
+		}
+
+		// Writes a file whose bytes all depend on its id and size
+		void writeFile(LLVFS* vfs, const LLUUID& id, S32 size)
+		{
+			std::vector<U8> data(size);
+			for (S32 i = 0; i < size; ++i)
+			{
+				data[i] = (U8)(id.mData[i % UUID_BYTES] + i);
+			}
+			ensure("size set", vfs->setMaxSize(id, LLAssetType::AT_OBJECT, size));
+			ensure_equals("stored", vfs->storeData(id, LLAssetType::AT_OBJECT, &data[0], 0, size), size);
+		}
+
+		void checkFile(LLVFS* vfs, const LLUUID& file_id, const LLUUID& data_id, S32 size)
+		{
+			ensure_equals("size", vfs->getSize(file_id, LLAssetType::AT_OBJECT), size);
+			std::vector<U8> data(size);
+			ensure_equals("read", vfs->getData(file_id, LLAssetType::AT_OBJECT, &data[0], 0, size), size);
+			for (S32 i = 0; i < size; ++i)
+			{
+				if (data[i] != (U8)(data_id.mData[i % UUID_BYTES] + i))
+				{
+					fail(llformat("byte %d of %s", i, file_id.asString().c_str()));
+				}
+			}
+		}
+
+		std::string mFilename;
+	};
+	typedef test_group<vfs_data> vfs_test;
+	typedef vfs_test::object vfs_object;
+	tut::vfs_test vfs("LLVFS");
+
+	template<> template<>
+	void vfs_object::test<1>()
+	{
+		set_test_name("sharded files round trip and survive reopening");
+		std::vector<LLUUID> ids(40);
+		LLVFS* vfs = open(SHARDS);
+		ensure_equals("shard count", vfs->getShardCount(), SHARDS);
+		for (size_t i = 0; i < ids.size(); ++i)
+		{
+			ids[i].generate();
+			writeFile(vfs, ids[i], 1000 + 97 * i);
+		}
+		for (size_t i = 0; i < ids.size(); ++i)
+		{
+			checkFile(vfs, ids[i], ids[i], 1000 + 97 * i);
+		}
+		delete vfs;
+
+		vfs = open(SHARDS);
+		for (size_t i = 0; i < ids.size(); ++i)
+		{
+			checkFile(vfs, ids[i], ids[i], 1000 + 97 * i);
+		}
+		LLUUID missing;
+		missing.generate();
+		ensure("missing file", !vfs->getExists(missing, LLAssetType::AT_OBJECT));
+		delete vfs;
+	}
+
+	template<> template<>
+	void vfs_object::test<2>()
+	{
+		set_test_name("renames move files and locks between shards");
+		LLVFS* vfs = open(SHARDS);
+		for (S32 i = 0; i < 20; ++i)
+		{
+			LLUUID old_id, new_id;
+			old_id.generate();
+			new_id.generate();
+			writeFile(vfs, old_id, 3000);
+			vfs->incLock(old_id, LLAssetType::AT_OBJECT, VFSLOCK_READ);
+
+			vfs->renameFile(old_id, LLAssetType::AT_OBJECT, new_id, LLAssetType::AT_OBJECT);
+			ensure("old name gone", !vfs->getExists(old_id, LLAssetType::AT_OBJECT));
+			checkFile(vfs, new_id, old_id, 3000);
+			ensure("lock moved", vfs->isLocked(new_id, LLAssetType::AT_OBJECT, VFSLOCK_READ));
+			ensure("old lock cleared", !vfs->isLocked(old_id, LLAssetType::AT_OBJECT, VFSLOCK_READ));
+			vfs->decLock(new_id, LLAssetType::AT_OBJECT, VFSLOCK_READ);
+		}
+		delete vfs;
+	}
+
+	template<> template<>
+	void vfs_object::test<3>()
+	{
+		set_test_name("compaction gathers free space without losing data");
+		LLVFS* vfs = open(1);
+		const S32 FILE_SIZE = 16 * 1024;
+		const S32 FILE_COUNT = VFS_SIZE / FILE_SIZE;
+		std::vector<LLUUID> ids(FILE_COUNT);
+		for (S32 i = 0; i < FILE_COUNT; ++i)
+		{
+			ids[i].generate();
+			writeFile(vfs, ids[i], FILE_SIZE);
+		}
+		// every other file leaves only 16K holes
+		for (S32 i = 0; i < FILE_COUNT; i += 2)
+		{
+			vfs->removeFile(ids[i], LLAssetType::AT_OBJECT);
+		}
+		ensure("fragmented", !vfs->checkAvailable(2 * FILE_SIZE));
+
+		ensure("some moved", vfs->compact(4 * FILE_SIZE) > 0);
+		S32 moved = 0;
+		do
+		{
+			moved = vfs->compact(VFS_SIZE);
+		}
+		while (moved > 0);
+		ensure_equals("nothing left to do", vfs->compact(VFS_SIZE), 0);
+
+		ensure("one free block", vfs->checkAvailable(VFS_SIZE / 2));
+		for (S32 i = 1; i < FILE_COUNT; i += 2)
+		{
+			checkFile(vfs, ids[i], ids[i], FILE_SIZE);
+		}
+		delete vfs;
+
+		vfs = open(1);
+		ensure("packed after reopening", vfs->checkAvailable(VFS_SIZE / 2));
+		for (S32 i = 1; i < FILE_COUNT; i += 2)
+		{
+			checkFile(vfs, ids[i], ids[i], FILE_SIZE);
+		}
+		delete vfs;
+	}
+
+	template<> template<>
+	void vfs_object::test<4>()
+	{
+		set_test_name("compaction carries on past files changed between calls");
+		LLVFS* vfs = open(1);
+		const S32 FILE_SIZE = 16 * 1024;
+		const S32 FILE_COUNT = VFS_SIZE / FILE_SIZE;
+		std::vector<LLUUID> ids(FILE_COUNT);
+		for (S32 i = 0; i < FILE_COUNT; ++i)
+		{
+			ids[i].generate();
+			writeFile(vfs, ids[i], FILE_SIZE);
+		}
+		for (S32 i = 0; i < FILE_COUNT; i += 2)
+		{
+			vfs->removeFile(ids[i], LLAssetType::AT_OBJECT);
+		}
+
+		// a pass is under way; change files it has yet to reach
+		ensure("some moved", vfs->compact(2 * FILE_SIZE) > 0);
+		vfs->removeFile(ids[1], LLAssetType::AT_OBJECT);
+		vfs->removeFile(ids[FILE_COUNT / 2 + 1], LLAssetType::AT_OBJECT);
+		ids[0].generate();
+		writeFile(vfs, ids[0], FILE_SIZE);
+
+		S32 moved = 0;
+		do
+		{
+			moved = vfs->compact(VFS_SIZE);
+		}
+		while (moved > 0);
+		ensure_equals("nothing left to do", vfs->compact(VFS_SIZE), 0);
+
+		ensure("one free block", vfs->checkAvailable(VFS_SIZE / 2));
+		checkFile(vfs, ids[0], ids[0], FILE_SIZE);
+		for (S32 i = 3; i < FILE_COUNT; i += 2)
+		{
+			if (i != FILE_COUNT / 2 + 1)
+			{
+				checkFile(vfs, ids[i], ids[i], FILE_SIZE);
+			}
+		}
+		delete vfs;
+	}
+}
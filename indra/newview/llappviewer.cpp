@@ -116,6 +116,7 @@
 #include "llviewerkeyboard.h"
 #include "lllfsthread.h"
 #include "llworkerthread.h"
+#include "llthreadscheduler.h"
 #include "lltexturecache.h"
 #include "lltexturefetch.h"
 #include "llimageworker.h"
@@ -332,6 +333,8 @@ void init_default_trans_args()
 // File scope definitons
 const char *VFS_DATA_FILE_BASE = "data.db2.x.";
 const char *VFS_INDEX_FILE_BASE = "index.db2.x.";
+// How much of the VFS may be moved around to pack it in one idle frame
+const S32 VFS_COMPACT_BYTES_PER_FRAME = 256 * 1024;
 
 static std::string gWindowTitle;
 
@@ -963,6 +966,7 @@ static LLFastTimer::DeclareTimer FTM_TEXTURE_CACHE("Texture Cache");
 static LLFastTimer::DeclareTimer FTM_DECODE("Image Decode");
 static LLFastTimer::DeclareTimer FTM_VFS("VFS Thread");
 static LLFastTimer::DeclareTimer FTM_LFS("LFS Thread");
+static LLFastTimer::DeclareTimer FTM_VOLUME_BUILD("Volume Build");
 static LLFastTimer::DeclareTimer FTM_PAUSE_THREADS("Pause Threads");
 static LLFastTimer::DeclareTimer FTM_IDLE("Idle");
 static LLFastTimer::DeclareTimer FTM_PUMP("Pump");
@@ -1190,6 +1194,11 @@ bool LLAppViewer::mainLoop()
 				bool is_slow = (frameTimer.getElapsedTimeF64() > FRAME_SLOW_THRESHOLD) ;
 				S32 total_work_pending = 0;
 				S32 total_io_pending = 0;				
+				{
+					// Hand finished volumes over between frames, even slow ones
+					LLFastTimer ftm(FTM_VOLUME_BUILD);
+					LLPrimitive::getVolumeManager()->update(1);
+				}
 				while(!is_slow)//do not unpause threads if the frame rates are very low.
 				{
 					S32 work_pending = 0;
@@ -1240,6 +1249,14 @@ bool LLAppViewer::mainLoop()
 				{
 					LLVFSThread::sLocal->pause(); 
 					LLLFSThread::sLocal->pause(); 
+
+					// and use the time to pack the free space in the vfs,
+					// unless the frame has no time to spare
+					if (!is_slow)
+					{
+						LLFastTimer ftm(FTM_VFS);
+						gVFS->compact(VFS_COMPACT_BYTES_PER_FRAME);
+					}
 				}									
 
 				if ((LLStartUp::getStartupState() >= STATE_CLEANUP) &&
@@ -1636,6 +1653,8 @@ bool LLAppViewer::cleanup()
 		}
 	}
 
+	sImageDecodeThread->dumpWorkerStats();
+
 	// Delete workers first
 	// shotdown all worker threads before deleting them in case of co-dependencies
 	sTextureCache->shutdown();
@@ -1651,6 +1670,7 @@ bool LLAppViewer::cleanup()
     sTextureFetch = NULL;
 	delete sImageDecodeThread;
     sImageDecodeThread = NULL;
+	LLThreadScheduler::cleanupClass();
 	delete mFastTimerLogThread;
 	mFastTimerLogThread = NULL;
 	
@@ -1770,12 +1790,26 @@ bool LLAppViewer::initThreads()
 	LLVFSThread::initClass(enable_threads && false);
 	LLLFSThread::initClass(enable_threads && false);
 
+	if (enable_threads && gSavedSettings.getBOOL("UseThreadScheduler"))
+	{
+		// Texture cache, fetch and decode share one pool of worker threads
+		LLThreadScheduler::initClass(gSavedSettings.getU32("ThreadSchedulerWorkers"));
+	}
+
 	// Image decoding
-	LLAppViewer::sImageDecodeThread = new LLImageDecodeThread(enable_threads && true);
+	LLAppViewer::sImageDecodeThread = new LLImageDecodeThread(enable_threads && true,
+															  gSavedSettings.getU32("ImageDecodeThreads"));
 	LLAppViewer::sTextureCache = new LLTextureCache(enable_threads && true);
 	LLAppViewer::sTextureFetch = new LLTextureFetch(LLAppViewer::getTextureCache(), sImageDecodeThread, enable_threads && true);
 	LLImage::initClass();
 
+	// Volumes for level of detail changes
+	U32 volume_build_threads = gSavedSettings.getU32("VolumeBuildThreads");
+	if (volume_build_threads > 0)
+	{
+		LLPrimitive::getVolumeManager()->startBuildThread(enable_threads && true, volume_build_threads);
+	}
+
 	if (LLFastTimer::sLog || LLFastTimer::sMetricLog)
 	{
 		LLFastTimer::sLogLock = new LLMutex(NULL);
@@ -3291,12 +3325,17 @@ bool LLAppViewer::initCache()
 	vfs_size = (vfs_size / MB) * MB; // make sure it is MB aligned
 	U32 vfs_size_u32 = (U32)vfs_size;
 	U32 old_vfs_size = gSavedSettings.getU32("VFSOldSize") * MB;
-	bool resize_vfs = (vfs_size_u32 != old_vfs_size);
+	// Files are spread over the shards by id, so the cache has to start
+	// over when the number of shards changes, same as for a new size.
+	S32 vfs_shard_count = llclamp((S32)gSavedSettings.getU32("VFSShardCount"), 1, 64);
+	S32 old_vfs_shard_count = llmax((S32)gSavedSettings.getU32("VFSOldShardCount"), 1);
+	bool resize_vfs = (vfs_size_u32 != old_vfs_size) || (vfs_shard_count != old_vfs_shard_count);
 	if (resize_vfs)
 	{
 		gSavedSettings.setU32("VFSOldSize", vfs_size_u32/MB);
+		gSavedSettings.setU32("VFSOldShardCount", (U32)vfs_shard_count);
 	}
-	LL_INFOS("AppCache") << "VFS CACHE SIZE: " << vfs_size/(1024*1024) << " MB" << LL_ENDL;
+	LL_INFOS("AppCache") << "VFS CACHE SIZE: " << vfs_size/(1024*1024) << " MB in " << vfs_shard_count << " shards" << LL_ENDL;
 	
 	// This has to happen BEFORE starting the vfs
 	//time_t	ltime;
@@ -3392,23 +3431,29 @@ bool LLAppViewer::initCache()
 	{
 		LL_DEBUGS("AppCache") << "Removing old vfs and re-sizing" << LL_ENDL;
 		
-		LLFile::remove(old_vfs_data_file);
-		LLFile::remove(old_vfs_index_file);
+		for (S32 shard = 0; shard < old_vfs_shard_count; shard++)
+		{
+			LLFile::remove(LLVFS::getShardFilename(old_vfs_data_file, shard));
+			LLFile::remove(LLVFS::getShardFilename(old_vfs_index_file, shard));
+		}
 	}
 	else if (old_salt != new_salt)
 	{
 		// move the vfs files to a new name before opening
 		LL_DEBUGS("AppCache") << "Renaming " << old_vfs_data_file << " to " << new_vfs_data_file << LL_ENDL;
 		LL_DEBUGS("AppCache") << "Renaming " << old_vfs_index_file << " to " << new_vfs_index_file << LL_ENDL;
-		LLFile::rename(old_vfs_data_file, new_vfs_data_file);
-		LLFile::rename(old_vfs_index_file, new_vfs_index_file);
+		for (S32 shard = 0; shard < vfs_shard_count; shard++)
+		{
+			LLFile::rename(LLVFS::getShardFilename(old_vfs_data_file, shard), LLVFS::getShardFilename(new_vfs_data_file, shard));
+			LLFile::rename(LLVFS::getShardFilename(old_vfs_index_file, shard), LLVFS::getShardFilename(new_vfs_index_file, shard));
+		}
 	}
 
 	// Startup the VFS...
 	gSavedSettings.setU32("VFSSalt", new_salt);
 
 	// Don't remove VFS after viewer crashes.  If user has corrupt data, they can reinstall. JC
-	gVFS = LLVFS::createLLVFS(new_vfs_index_file, new_vfs_data_file, false, vfs_size_u32, false);
+	gVFS = LLVFS::createLLVFS(new_vfs_index_file, new_vfs_data_file, false, vfs_size_u32, false, vfs_shard_count);
 	if( !gVFS )
 	{
 		return false;
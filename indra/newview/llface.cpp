@@ -755,8 +755,8 @@ void LLFace::getPlanarProjectedParams(LLQuaternion* face_rot, LLVector3* face_po
 {
 	const LLMatrix4& vol_mat = getWorldMatrix();
 	const LLVolumeFace& vf = getViewerObject()->getVolume()->getVolumeFace(mTEOffset);
-	LLVector3 normal = vf.mVertices[0].mNormal;
-	LLVector3 binormal = vf.mVertices[0].mBinormal;
+	LLVector3 normal = vf.getNormal(0);
+	LLVector3 binormal = vf.getBinormal(0);
 	LLVector2 projected_binormal;
 	planarProjection(projected_binormal, normal, vf.mCenter, binormal);
 	projected_binormal -= LLVector2(0.5f, 0.5f); // this normally happens in xform()
@@ -873,8 +873,19 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 								const U16 &index_offset)
 {
 	LLFastTimer t(FTM_FACE_GET_GEOM);
+	if (!prepareGeometryVolume(volume, f))
+	{
+		return FALSE;
+	}
+
+	fillGeometryVolume(volume, f, mat_vert, mat_normal, index_offset);
+	return TRUE;
+}
+
+BOOL LLFace::prepareGeometryVolume(const LLVolume& volume, const S32 &f)
+{
 	const LLVolumeFace &vf = volume.getVolumeFace(f);
-	S32 num_vertices = (S32)vf.mVertices.size();
+	S32 num_vertices = vf.getNumVertices();
 	S32 num_indices = LLPipeline::sUseTriStrips ? (S32)vf.mTriStrip.size() : (S32) vf.mIndices.size();
 	
 	if (mVertexBuffer.notNull())
@@ -900,6 +911,63 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 		}
 	}
 
+	BOOL full_rebuild = mDrawablep->isState(LLDrawable::REBUILD_VOLUME);
+	BOOL rebuild_pos = full_rebuild || mDrawablep->isState(LLDrawable::REBUILD_POSITION);
+	BOOL rebuild_color = full_rebuild || mDrawablep->isState(LLDrawable::REBUILD_COLOR);
+	BOOL rebuild_tcoord = full_rebuild || mDrawablep->isState(LLDrawable::REBUILD_TCOORD);
+
+	const LLTextureEntry *tep = mVObjp->getTE(f);
+	U8  bump_code = tep ? tep->getBumpmap() : 0;
+
+	// the volume may be shared with other objects, so its binormals are
+	// generated here, on the main thread, rather than by whoever fills the
+	// buffer: fillGeometryVolume() may run on LLVolumeGeometryThread while
+	// another object's face reads the same binormals
+	BOOL rebuild_binormal = rebuild_pos && mVertexBuffer.notNull() && mVertexBuffer->hasDataType(LLVertexBuffer::TYPE_BINORMAL);
+	if (bump_code || rebuild_binormal ||
+		(rebuild_tcoord && getTextureEntry()->getTexGen() != LLTextureEntry::TEX_GEN_DEFAULT))
+	{ //bump maps, planar texgen and binormal buffers need binormals
+		mVObjp->getVolume()->genBinormals(f);
+	}
+
+	if (rebuild_pos || rebuild_color || rebuild_tcoord)
+	{
+		mVertexBuffer->mapBuffer();
+	}
+
+	if (mDrawablep->isStatic())
+	{
+		setState(GLOBAL);
+	}
+	else
+	{
+		clearState(GLOBAL);
+	}
+
+	if (isState(TEXTURE_ANIM) && !((LLVOVolume*) (LLViewerObject*) mVObjp)->mTexAnimMode)
+	{
+		clearState(TEXTURE_ANIM);
+	}
+
+	mLastVertexBuffer = mVertexBuffer;
+	mLastGeomCount = mGeomCount;
+	mLastGeomIndex = mGeomIndex;
+	mLastIndicesCount = mIndicesCount;
+	mLastIndicesIndex = mIndicesIndex;
+
+	return TRUE;
+}
+
+// Writes only to this face's range of mVertexBuffer and to mTexExtents
+void LLFace::fillGeometryVolume(const LLVolume& volume,
+							   const S32 &f,
+								const LLMatrix4& mat_vert, const LLMatrix3& mat_normal,
+								const U16 &index_offset)
+{
+	const LLVolumeFace &vf = volume.getVolumeFace(f);
+	S32 num_vertices = vf.getNumVertices();
+	S32 num_indices = LLPipeline::sUseTriStrips ? (S32)vf.mTriStrip.size() : (S32) vf.mIndices.size();
+
 	LLStrider<LLVector3> vertices;
 	LLStrider<LLVector2> tex_coords;
 	LLStrider<LLVector2> tex_coords2;
@@ -975,20 +1043,8 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 	}
 
 	F32 r = 0, os = 0, ot = 0, ms = 0, mt = 0, cos_ang = 0, sin_ang = 0;
-	
-	BOOL is_static = mDrawablep->isStatic();
-	BOOL is_global = is_static;
 
 	LLVector3 center_sum(0.f, 0.f, 0.f);
-	
-	if (is_global)
-	{
-		setState(GLOBAL);
-	}
-	else
-	{
-		clearState(GLOBAL);
-	}
 
 	LLVector2 tmin, tmax;
 	
@@ -1024,11 +1080,7 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 		LLVOVolume* vobj = (LLVOVolume*) (LLViewerObject*) mVObjp;	
 		tex_mode = vobj->mTexAnimMode;
 
-		if (!tex_mode)
-		{
-			clearState(TEXTURE_ANIM);
-		}
-		else
+		if (tex_mode)
 		{
 			os = ot = 0.f;
 			r = 0.f;
@@ -1098,7 +1150,6 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 	
 	if (bump_code)
 	{
-		mVObjp->getVolume()->genBinormals(f);
 		F32 offset_multiple; 
 		switch( bump_code )
 		{
@@ -1145,33 +1196,29 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 	}
 		
 	U8 texgen = getTextureEntry()->getTexGen();
-	if (rebuild_tcoord && texgen != LLTextureEntry::TEX_GEN_DEFAULT)
-	{ //planar texgen needs binormals
-		mVObjp->getVolume()->genBinormals(f);
-	}
 
-	for (S32 i = 0; i < num_vertices; i++)
+	if (rebuild_tcoord)
 	{
-		if (rebuild_tcoord)
+		for (S32 i = 0; i < num_vertices; i++)
 		{
-			LLVector2 tc = vf.mVertices[i].mTexCoord;
+			LLVector2 tc = vf.mTexCoords[i];
 		
 			if (texgen != LLTextureEntry::TEX_GEN_DEFAULT)
 			{
-				LLVector3 vec = vf.mVertices[i].mPosition; 
+				LLVector3 vec = vf.getPosition(i); 
 			
 				vec.scaleVec(scale);
 
 				switch (texgen)
 				{
 					case LLTextureEntry::TEX_GEN_PLANAR:
-						planarProjection(tc, vf.mVertices[i].mNormal, vf.mCenter, vec);
+						planarProjection(tc, vf.getNormal(i), vf.mCenter, vec);
 						break;
 					case LLTextureEntry::TEX_GEN_SPHERICAL:
-						sphericalProjection(tc, vf.mVertices[i].mNormal, vf.mCenter, vec);
+						sphericalProjection(tc, vf.getNormal(i), vf.mCenter, vec);
 						break;
 					case LLTextureEntry::TEX_GEN_CYLINDRICAL:
-						cylindricalProjection(tc, vf.mVertices[i].mNormal, vf.mCenter, vec);
+						cylindricalProjection(tc, vf.getNormal(i), vf.mCenter, vec);
 						break;
 					default:
 						break;
@@ -1281,10 +1328,12 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 		
 			if (bump_code && mVertexBuffer->hasDataType(LLVertexBuffer::TYPE_TEXCOORD1))
 			{
-				LLVector3 tangent = vf.mVertices[i].mBinormal % vf.mVertices[i].mNormal;
+				LLVector3 vf_binormal = vf.getBinormal(i);
+				LLVector3 vf_normal = vf.getNormal(i);
+				LLVector3 tangent = vf_binormal % vf_normal;
 
 				LLMatrix3 tangent_to_object;
-				tangent_to_object.setRows(tangent, vf.mVertices[i].mBinormal, vf.mVertices[i].mNormal);
+				tangent_to_object.setRows(tangent, vf_binormal, vf_normal);
 				LLVector3 binormal = binormal_dir * tangent_to_object;
 				binormal = binormal * mat_normal;
 				
@@ -1299,28 +1348,27 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 				*tex_coords2++ = tc;
 			}	
 		}
-			
-		if (rebuild_pos)
-		{
-			*vertices++ = vf.mVertices[i].mPosition * mat_vert;
-		}
+	}
+
+	// the rest are whole stream transforms on the volume face's aligned arrays
+	if (rebuild_pos)
+	{
+		vf.transformPositions(mat_vert, vertices);
+	}
 		
-		if (rebuild_normal)
-		{
-			LLVector3 normal = vf.mVertices[i].mNormal * mat_normal;
-			normal.normVec();
-			
-			*normals++ = normal;
-		}
+	if (rebuild_normal)
+	{
+		vf.transformNormals(mat_normal, normals);
+	}
 		
-		if (rebuild_binormal)
-		{
-			LLVector3 binormal = vf.mVertices[i].mBinormal * mat_normal;
-			binormal.normVec();
-			*binormals++ = binormal;
-		}
+	if (rebuild_binormal)
+	{
+		vf.transformBinormals(mat_normal, binormals);
+	}
 		
-		if (rebuild_color)
+	if (rebuild_color)
+	{
+		for (S32 i = 0; i < num_vertices; i++)
 		{
 			*colors++ = color;		
 		}
@@ -1333,14 +1381,6 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 		xform(mTexExtents[0], cos_ang, sin_ang, os, ot, ms, mt);
 		xform(mTexExtents[1], cos_ang, sin_ang, os, ot, ms, mt);		
 	}
-
-	mLastVertexBuffer = mVertexBuffer;
-	mLastGeomCount = mGeomCount;
-	mLastGeomIndex = mGeomIndex;
-	mLastIndicesCount = mIndicesCount;
-	mLastIndicesIndex = mIndicesIndex;
-
-	return TRUE;
 }
 
 //check if the face has a media
@@ -143,6 +143,15 @@ public:
 						const S32 &f,
 						const LLMatrix4& mat_vert, const LLMatrix3& mat_normal,
 						const U16 &index_offset);
+	// getGeometryVolume() in two halves.  prepareGeometryVolume() must run on
+	// the main thread: it checks the face fits its vertex buffer, generates
+	// any binormals the face needs and maps the buffer.  After it returns TRUE,
+	// fillGeometryVolume() may run on any thread until the buffer is unmapped.
+	BOOL prepareGeometryVolume(const LLVolume& volume, const S32 &f);
+	void fillGeometryVolume(const LLVolume& volume,
+						const S32 &f,
+						const LLMatrix4& mat_vert, const LLMatrix3& mat_normal,
+						const U16 &index_offset);
 
 	// For avatar
 	U16			 getGeometryAvatar(
@@ -32,6 +32,7 @@
 #include "llappearancemgr.h"
 #include "llinventorypanel.h"
 #include "llinventorybridge.h"
+#include "llinventorycache.h"
 #include "llinventoryfunctions.h"
 #include "llinventoryobserver.h"
 #include "llinventorypanel.h"
@@ -63,6 +64,9 @@ BOOL LLInventoryModel::sFirstTimeInViewer2 = TRUE;
 
 //BOOL decompress_file(const char* src_filename, const char* dst_filename);
 const char CACHE_FORMAT_STRING[] = "%s.inv"; 
+// binary cache, see LLInventoryCacheFile. The gzipped text cache above is
+// only read, to migrate caches written by older viewers.
+const char BINARY_CACHE_FORMAT_STRING[] = "%s.inv.bin";
 
 struct InventoryIDPtrLess
 {
@@ -1248,21 +1252,15 @@ void LLInventoryModel::cache(
 		INCLUDE_TRASH,
 		can_cache);
 	std::string agent_id_str;
-	std::string inventory_filename;
 	agent_id.toString(agent_id_str);
 	std::string path(gDirUtilp->getExpandedFilename(LL_PATH_CACHE, agent_id_str));
-	inventory_filename = llformat(CACHE_FORMAT_STRING, path.c_str());
-	saveToFile(inventory_filename, categories, items);
-	std::string gzip_filename(inventory_filename);
-	gzip_filename.append(".gz");
-	if(gzip_file(inventory_filename, gzip_filename))
+	std::string inventory_filename = llformat(BINARY_CACHE_FORMAT_STRING, path.c_str());
+	if(saveToFile(inventory_filename, categories, items))
 	{
-		lldebugs << "Successfully compressed " << inventory_filename << llendl;
-		LLFile::remove(inventory_filename);
-	}
-	else
-	{
-		llwarns << "Unable to compress " << inventory_filename << llendl;
+		// the text cache is stale now, don't let it be migrated later
+		std::string gzip_filename(llformat(CACHE_FORMAT_STRING, path.c_str()));
+		gzip_filename.append(".gz");
+		LLFile::remove(gzip_filename);
 	}
 }
 
@@ -1555,26 +1553,50 @@ bool LLInventoryModel::loadSkeleton(
 		const S32 NO_VERSION = LLViewerInventoryCategory::VERSION_UNKNOWN;
 		std::string gzip_filename(inventory_filename);
 		gzip_filename.append(".gz");
-		LLFILE* fp = LLFile::fopen(gzip_filename, "rb");
+		std::string binary_filename(llformat(BINARY_CACHE_FORMAT_STRING, path.c_str()));
 		bool remove_inventory_file = false;
-		if(fp)
+		bool is_cache_obsolete = false;
+		bool is_binary_cache_obsolete = false;
+		bool loaded = false;
+
+		// The binary cache stays mapped while we go through it. Folders
+		// are few and decoded straight away, items are only decoded once
+		// we know their folder is current.
+		LLInventoryCacheFile cache_file;
+		if(cache_file.open(binary_filename, sCurrentInvCacheVersion, is_binary_cache_obsolete))
 		{
-			fclose(fp);
-			fp = NULL;
-			if(gunzip_file(gzip_filename, inventory_filename))
+			S32 count = cache_file.getCategoryCount();
+			for(S32 i = 0; i < count; ++i)
 			{
-				// we only want to remove the inventory file if it was
-				// gzipped before we loaded, and we successfully
-				// gunziped it.
-				remove_inventory_file = true;
+				LLPointer<LLViewerInventoryCategory> cat = new LLViewerInventoryCategory(cache_file.getCategoryOwnerID(i));
+				cat->setVersion(cache_file.readCategory(i, cat));
+				categories.put(cat);
 			}
-			else
+			loaded = true;
+		}
+		else
+		{
+			// Fall back on the text cache of older viewers
+			LLFILE* fp = LLFile::fopen(gzip_filename, "rb");
+			if(fp)
 			{
-				llinfos << "Unable to gunzip " << gzip_filename << llendl;
+				fclose(fp);
+				fp = NULL;
+				if(gunzip_file(gzip_filename, inventory_filename))
+				{
+					// we only want to remove the inventory file if it was
+					// gzipped before we loaded, and we successfully
+					// gunziped it.
+					remove_inventory_file = true;
+				}
+				else
+				{
+					llinfos << "Unable to gunzip " << gzip_filename << llendl;
+				}
 			}
+			loaded = loadFromFile(inventory_filename, categories, items, is_cache_obsolete);
 		}
-		bool is_cache_obsolete = false;
-		if(loadFromFile(inventory_filename, categories, items, is_cache_obsolete))
+		if(loaded)
 		{
 			// We were able to find a cache of files. So, use what we
 			// found to generate a set of categories we should add. We
@@ -1633,18 +1655,36 @@ bool LLInventoryModel::loadSkeleton(
 			// category with a correctly cached parent
 			S32 bad_link_count = 0;
 			cat_map_t::iterator unparented = mCategoryMap.end();
-			for(item_array_t::const_iterator item_iter = items.begin();
-				item_iter != items.end();
-				++item_iter)
+			const bool from_binary = cache_file.isOpen();
+			const S32 item_count = from_binary ? cache_file.getItemCount() : items.count();
+			for(S32 i = 0; i < item_count; ++i)
 			{
-				LLViewerInventoryItem *item = (*item_iter).get();
-				const cat_map_t::iterator cit = mCategoryMap.find(item->getParentUUID());
+				const LLUUID parent_id = from_binary ? cache_file.getItemParentID(i) : items[i]->getParentUUID();
+				const cat_map_t::iterator cit = mCategoryMap.find(parent_id);
 				
 				if(cit != unparented)
 				{
 					const LLViewerInventoryCategory* cat = cit->second.get();
 					if(cat->getVersion() != NO_VERSION)
 					{
+						LLPointer<LLViewerInventoryItem> item;
+						if(from_binary)
+						{
+							if(cache_file.getItemID(i).isNull())
+							{
+								llwarns << "Ignoring cached inventory item with null item id" << llendl;
+								continue;
+							}
+							item = new LLViewerInventoryItem;
+							cache_file.readItem(i, item);
+							// like importFileLocal(), cached items still need fetching
+							item->setComplete(FALSE);
+						}
+						else
+						{
+							item = items[i];
+						}
+
 						// This can happen if the linked object's baseobj is removed from the cache but the linked object is still in the cache.
 						if (item->getIsBrokenLink())
 						{
@@ -1725,6 +1765,12 @@ bool LLInventoryModel::loadSkeleton(
 			llwarns << "Inv cache out of date, removing" << llendl;
 			LLFile::remove(gzip_filename);
 		}
+		cache_file.close();
+		if(is_binary_cache_obsolete)
+		{
+			llwarns << "Binary inv cache out of date, removing" << llendl;
+			LLFile::remove(binary_filename);
+		}
 		categories.clear(); // will unref and delete entries
 	}
 
@@ -2112,14 +2158,8 @@ bool LLInventoryModel::saveToFile(const std::string& filename,
 		return false;
 	}
 	llinfos << "LLInventoryModel::saveToFile(" << filename << ")" << llendl;
-	LLFILE* file = LLFile::fopen(filename, "wb");		/*Flawfinder: ignore*/
-	if(!file)
-	{
-		llwarns << "unable to save inventory to: " << filename << llendl;
-		return false;
-	}
 
-	fprintf(file, "\tinv_cache_version\t%d\n",sCurrentInvCacheVersion);
+	LLInventoryCacheFile cache_file;
 	S32 count = categories.count();
 	S32 i;
 	for(i = 0; i < count; ++i)
@@ -2127,18 +2167,17 @@ bool LLInventoryModel::saveToFile(const std::string& filename,
 		LLViewerInventoryCategory* cat = categories[i];
 		if(cat->getVersion() != LLViewerInventoryCategory::VERSION_UNKNOWN)
 		{
-			cat->exportFileLocal(file);
+			cache_file.addCategory(cat, cat->getOwnerID(), cat->getVersion());
 		}
 	}
 
 	count = items.count();
 	for(i = 0; i < count; ++i)
 	{
-		items[i]->exportFile(file);
+		cache_file.addItem(items[i]);
 	}
 
-	fclose(file);
-	return true;
+	return cache_file.write(filename, sCurrentInvCacheVersion);
 }
 
 // message handling functionality
@@ -480,10 +480,12 @@ public:
 	// File I/O
 	//--------------------------------------------------------------------
 protected:
+	// Reads the text cache written by older viewers
 	static bool loadFromFile(const std::string& filename,
 							 cat_array_t& categories,
 							 item_array_t& items,
 							 bool& is_cache_obsolete); 
+	// Writes a binary LLInventoryCacheFile
 	static bool saveToFile(const std::string& filename,
 						   const cat_array_t& categories,
 						   const item_array_t& items); 
@@ -31,6 +31,7 @@
 #include "llappviewer.h"
 #include "llcallbacklist.h"
 #include "llinventorypanel.h"
+#include "llsdstreamresponder.h"
 #include "llviewercontrol.h"
 #include "llviewermessage.h"
 #include "llviewerregion.h"
@@ -321,131 +322,120 @@ void LLInventoryModelBackgroundFetch::incrBulkFetch(S16 fetching)
 }
 
 
-class LLInventoryModelFetchDescendentsResponder: public LLHTTPClient::Responder
+// The response lists each folder with its categories and items, which for
+// a large inventory adds up to many megabytes of XML. It is parsed as it
+// downloads and each category and item is handled on its own, so neither
+// the text nor the whole LLSD tree is ever held.
+class LLInventoryModelFetchDescendentsResponder: public LLSDStreamResponder
 {
 public:
 	LLInventoryModelFetchDescendentsResponder(const LLSD& request_sd, uuid_vec_t recursive_cats) : 
 		mRequestSD(request_sd),
-		mRecursiveCatUUIDs(recursive_cats)
+		mRecursiveCatUUIDs(recursive_cats),
+		mDepth(0)
 	{};
 	//LLInventoryModelFetchDescendentsResponder() {};
-	void result(const LLSD& content);
 	void error(U32 status, const std::string& reason);
+
+	/* @name LLSDXMLStreamParser::Listener virtual implementations
+	 */
+	//@{
+	virtual bool collect(S32 depth);
+	virtual void startMap() { startContainer(); }
+	virtual void endMap() { endContainer(); }
+	virtual void startArray() { startContainer(); }
+	virtual void endArray() { endContainer(); }
+	virtual void key(const std::string& key);
+	virtual void value(const LLSD& value);
+	//@}
+
+	virtual void streamCompleted(bool success);
 protected:
 	BOOL getIsRecursive(const LLUUID& cat_id) const;
 private:
+	// Depth of the containers in the response, which are not collected
+	enum
+	{
+		DEPTH_RESPONSE = 1,		// the response map
+		DEPTH_FOLDERS = 2,		// the "folders" array
+		DEPTH_FOLDER = 3,		// one folder
+		DEPTH_CONTENTS = 4		// its "categories" or "items"
+	};
+
+	void startContainer();
+	void endContainer();
+	void itemFetched(const LLSD& item);
+	void folderFetched();
+
 	LLSD mRequestSD;
 	uuid_vec_t mRecursiveCatUUIDs; // hack for storing away which cat fetches are recursive
+
+	S32 mDepth;
+	std::string mResponseKey;	// key of the response map member being read
+	std::string mFolderKey;		// key of the folder member being read
+	LLSD mFolder;				// everything but the contents of the folder being read
+	LLSD mCategories;			// categories are handled once the whole folder has been read
+	LLSD mItems;				// items which came before the folder_id
 };
 
-// If we get back a normal response, handle it here.
-void LLInventoryModelFetchDescendentsResponder::result(const LLSD& content)
+bool LLInventoryModelFetchDescendentsResponder::collect(S32 depth)
 {
-	LLInventoryModelBackgroundFetch *fetcher = LLInventoryModelBackgroundFetch::getInstance();
-	if (content.has("folders"))	
+	switch (depth)
 	{
+	case 0:
+		// the response map
+		return false;
+	case DEPTH_RESPONSE:
+		return mResponseKey != "folders";
+	case DEPTH_FOLDERS:
+		// a folder
+		return false;
+	case DEPTH_FOLDER:
+		return mFolderKey != "categories" && mFolderKey != "items";
+	default:
+		// a category or an item
+		return true;
+	}
+}
 
-		for(LLSD::array_const_iterator folder_it = content["folders"].beginArray();
-			folder_it != content["folders"].endArray();
-			++folder_it)
-		{	
-			LLSD folder_sd = *folder_it;
-			
-
-			//LLUUID agent_id = folder_sd["agent_id"];
-
-			//if(agent_id != gAgent.getID())	//This should never happen.
-			//{
-			//	llwarns << "Got a UpdateInventoryItem for the wrong agent."
-			//			<< llendl;
-			//	break;
-			//}
-
-			LLUUID parent_id = folder_sd["folder_id"];
-			LLUUID owner_id = folder_sd["owner_id"];
-			S32    version  = (S32)folder_sd["version"].asInteger();
-			S32    descendents = (S32)folder_sd["descendents"].asInteger();
-			LLPointer<LLViewerInventoryCategory> tcategory = new LLViewerInventoryCategory(owner_id);
-
-            if (parent_id.isNull())
-            {
-			    LLPointer<LLViewerInventoryItem> titem = new LLViewerInventoryItem;
-			    for(LLSD::array_const_iterator item_it = folder_sd["items"].beginArray();
-				    item_it != folder_sd["items"].endArray();
-				    ++item_it)
-			    {	
-                    const LLUUID lost_uuid = gInventory.findCategoryUUIDForType(LLFolderType::FT_LOST_AND_FOUND);
-                    if (lost_uuid.notNull())
-                    {
-				        LLSD item = *item_it;
-				        titem->unpackMessage(item);
-				
-                        LLInventoryModel::update_list_t update;
-                        LLInventoryModel::LLCategoryUpdate new_folder(lost_uuid, 1);
-                        update.push_back(new_folder);
-                        gInventory.accountForUpdate(update);
-
-                        titem->setParent(lost_uuid);
-                        titem->updateParentOnServer(FALSE);
-                        gInventory.updateItem(titem);
-                        gInventory.notifyObservers("fetchDescendents");
-                        
-                    }
-                }
-            }
-
-	        LLViewerInventoryCategory* pcat = gInventory.getCategory(parent_id);
-			if (!pcat)
-			{
-				continue;
-			}
-
-			for(LLSD::array_const_iterator category_it = folder_sd["categories"].beginArray();
-				category_it != folder_sd["categories"].endArray();
-				++category_it)
-			{	
-				LLSD category = *category_it;
-				tcategory->fromLLSD(category); 
-				
-				const BOOL recursive = getIsRecursive(tcategory->getUUID());
-				
-				if (recursive)
-				{
-					fetcher->mFetchQueue.push_back(LLInventoryModelBackgroundFetch::FetchQueueInfo(tcategory->getUUID(), recursive));
-				}
-				else if ( !gInventory.isCategoryComplete(tcategory->getUUID()) )
-				{
-					gInventory.updateCategory(tcategory);
-				}
-
-			}
-			LLPointer<LLViewerInventoryItem> titem = new LLViewerInventoryItem;
-			for(LLSD::array_const_iterator item_it = folder_sd["items"].beginArray();
-				item_it != folder_sd["items"].endArray();
-				++item_it)
-			{	
-				LLSD item = *item_it;
-				titem->unpackMessage(item);
-				
-				gInventory.updateItem(titem);
-			}
+void LLInventoryModelFetchDescendentsResponder::startContainer()
+{
+	++mDepth;
+	if (mDepth == DEPTH_FOLDER)
+	{
+		mFolder = LLSD::emptyMap();
+		mCategories = LLSD::emptyArray();
+		mItems = LLSD::emptyArray();
+	}
+}
 
-			// Set version and descendentcount according to message.
-			LLViewerInventoryCategory* cat = gInventory.getCategory(parent_id);
-			if(cat)
-			{
-				cat->setVersion(version);
-				cat->setDescendentCount(descendents);
-				cat->determineFolderType();
-			}
+void LLInventoryModelFetchDescendentsResponder::endContainer()
+{
+	if (mDepth == DEPTH_FOLDER)
+	{
+		folderFetched();
+	}
+	--mDepth;
+}
 
-		}
+void LLInventoryModelFetchDescendentsResponder::key(const std::string& key)
+{
+	if (mDepth == DEPTH_RESPONSE)
+	{
+		mResponseKey = key;
 	}
-		
-	if (content.has("bad_folders"))
+	else if (mDepth == DEPTH_FOLDER)
 	{
-		for(LLSD::array_const_iterator folder_it = content["bad_folders"].beginArray();
-			folder_it != content["bad_folders"].endArray();
+		mFolderKey = key;
+	}
+}
+
+void LLInventoryModelFetchDescendentsResponder::value(const LLSD& value)
+{
+	if (mDepth == DEPTH_RESPONSE && mResponseKey == "bad_folders")
+	{
+		for(LLSD::array_const_iterator folder_it = value.beginArray();
+			folder_it != value.endArray();
 			++folder_it)
 		{	
 			LLSD folder_sd = *folder_it;
@@ -455,7 +445,117 @@ void LLInventoryModelFetchDescendentsResponder::result(const LLSD& content)
 					<< "Error: " << folder_sd["error"].asString() << llendl;
 		}
 	}
+	else if (mDepth == DEPTH_FOLDER)
+	{
+		mFolder[mFolderKey] = value;
+	}
+	else if (mDepth == DEPTH_CONTENTS && mFolderKey == "categories")
+	{
+		mCategories.append(value);
+	}
+	else if (mDepth == DEPTH_CONTENTS && mFolderKey == "items")
+	{
+		// Map keys are sent sorted, so the folder_id is normally known by now
+		if (mFolder.has("folder_id"))
+		{
+			itemFetched(value);
+		}
+		else
+		{
+			mItems.append(value);
+		}
+	}
+}
+
+void LLInventoryModelFetchDescendentsResponder::itemFetched(const LLSD& item)
+{
+	LLUUID parent_id = mFolder["folder_id"];
+	LLPointer<LLViewerInventoryItem> titem = new LLViewerInventoryItem;
+	if (parent_id.isNull())
+	{
+		const LLUUID lost_uuid = gInventory.findCategoryUUIDForType(LLFolderType::FT_LOST_AND_FOUND);
+		if (lost_uuid.notNull())
+		{
+			titem->unpackMessage(item);
+
+			LLInventoryModel::update_list_t update;
+			LLInventoryModel::LLCategoryUpdate new_folder(lost_uuid, 1);
+			update.push_back(new_folder);
+			gInventory.accountForUpdate(update);
+
+			titem->setParent(lost_uuid);
+			titem->updateParentOnServer(FALSE);
+			gInventory.updateItem(titem);
+			gInventory.notifyObservers("fetchDescendents");
+		}
+	}
+	else if (gInventory.getCategory(parent_id))
+	{
+		titem->unpackMessage(item);
+
+		gInventory.updateItem(titem);
+	}
+}
+
+void LLInventoryModelFetchDescendentsResponder::folderFetched()
+{
+	LLInventoryModelBackgroundFetch *fetcher = LLInventoryModelBackgroundFetch::getInstance();
+
+	for(LLSD::array_const_iterator item_it = mItems.beginArray();
+		item_it != mItems.endArray();
+		++item_it)
+	{
+		itemFetched(*item_it);
+	}
+
+	LLUUID parent_id = mFolder["folder_id"];
+	LLUUID owner_id = mFolder["owner_id"];
+	S32    version  = (S32)mFolder["version"].asInteger();
+	S32    descendents = (S32)mFolder["descendents"].asInteger();
+
+	LLViewerInventoryCategory* pcat = gInventory.getCategory(parent_id);
+	if (!pcat)
+	{
+		return;
+	}
+
+	LLPointer<LLViewerInventoryCategory> tcategory = new LLViewerInventoryCategory(owner_id);
+	for(LLSD::array_const_iterator category_it = mCategories.beginArray();
+		category_it != mCategories.endArray();
+		++category_it)
+	{	
+		LLSD category = *category_it;
+		tcategory->fromLLSD(category); 
+		
+		const BOOL recursive = getIsRecursive(tcategory->getUUID());
+		
+		if (recursive)
+		{
+			fetcher->mFetchQueue.push_back(LLInventoryModelBackgroundFetch::FetchQueueInfo(tcategory->getUUID(), recursive));
+		}
+		else if ( !gInventory.isCategoryComplete(tcategory->getUUID()) )
+		{
+			gInventory.updateCategory(tcategory);
+		}
+	}
+
+	// Set version and descendentcount according to message.
+	LLViewerInventoryCategory* cat = gInventory.getCategory(parent_id);
+	if(cat)
+	{
+		cat->setVersion(version);
+		cat->setDescendentCount(descendents);
+		cat->determineFolderType();
+	}
+}
+
+// If we get back a normal response, everything in it has been handled
+// by now.
+void LLInventoryModelFetchDescendentsResponder::streamCompleted(bool success)
+{
+	LLInventoryModelBackgroundFetch *fetcher = LLInventoryModelBackgroundFetch::getInstance();
 
+	mDepth = 0;
 	fetcher->incrBulkFetch(-1);
 	
 	if (fetcher->isBulkFetchProcessingComplete())
@@ -34,11 +34,11 @@
 #include "v3math.h"
 #include "v2math.h"
 #include "llquaternion.h"
+#include "llavatarskin.h"
 #include "llpolymorph.h"
 #include "lljoint.h"
 //#include "lldarray.h"
 
-class LLSkinJoint;
 class LLVOAvatar;
 class LLWearable;
 
@@ -143,17 +143,6 @@ public:
 };
 
 
-class LLJointRenderData
-{
-public:
-	LLJointRenderData(const LLMatrix4* world_matrix, LLSkinJoint* skin_joint) : mWorldMatrix(world_matrix), mSkinJoint(skin_joint) {}
-	~LLJointRenderData(){}
-
-	const LLMatrix4*		mWorldMatrix;
-	LLSkinJoint*			mSkinJoint;
-};
-
-
 class LLPolyMesh
 {
 public:
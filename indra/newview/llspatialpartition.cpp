@@ -1711,9 +1711,11 @@ void LLSpatialPartition::move(LLDrawable *drawablep, LLSpatialGroup *curp, BOOL
 	{
 		//keep drawable from being garbage collected
 		LLPointer<LLDrawable> ptr = drawablep;
-		if (curp->mSpatialPartition->remove(drawablep, curp))
+		LLSpatialPartition* old_part = curp->mSpatialPartition;
+		if (old_part->remove(drawablep, curp))
 		{
 			put(drawablep, was_visible);
+			old_part->mOctree->prune();
 			return;
 		}
 		else
@@ -1737,6 +1739,10 @@ void LLSpatialPartition::move(LLDrawable *drawablep, LLSpatialGroup *curp, BOOL
 	}
 
 	put(drawablep, was_visible);
+
+	//nodes the drawable left are only deleted now, after put() had the
+	//chance to reuse them, while they're still in cache
+	mOctree->prune();
 }
 
 class LLSpatialShift : public LLSpatialGroup::OctreeTraveler
@@ -1826,6 +1832,29 @@ public:
 		return res;
 	}
 
+	// frustumCheck() for count groups at once
+	virtual void frustumCheckGroups(LLSpatialGroup* const* groups, U32 count, S8* results)
+	{
+		fillBoxes(groups, count);
+		mCamera->AABBsInFrustum(mBoxes, results, false);
+		for (U32 i = 0; i < count; i++)
+		{
+			if (results[i] != 0)
+			{
+				results[i] = llmin((S32)results[i], AABBSphereIntersect(groups[i]->mExtents[0], groups[i]->mExtents[1], mCamera->getOrigin(), mCamera->mFrustumCornerDist));
+			}
+		}
+	}
+
+	void fillBoxes(LLSpatialGroup* const* groups, U32 count)
+	{
+		mBoxes.clear();
+		for (U32 i = 0; i < count; i++)
+		{
+			mBoxes.push_back(groups[i]->mBounds[0], groups[i]->mBounds[1]);
+		}
+	}
+
 	virtual bool checkObjects(const LLSpatialGroup::OctreeNode* branch, const LLSpatialGroup* group)
 	{
 		if (branch->getElementCount() == 0) //no elements
@@ -1871,8 +1900,100 @@ public:
 		}
 	}
 
+	// The frustum half of traverse(). Leaves out earlyFail() and visit(),
+	// which touch GL and the pipeline, so it is safe off the main thread.
+	// Every group traverse() could reach is recorded for replay().
+	void record(const LLSpatialGroup::OctreeNode* n, LLSpatialPartition::cull_record_list_t& records)
+	{
+		LLSpatialGroup* group = (LLSpatialGroup*) n->getListener(0);
+		record(n, frustumCheck(group), records);
+	}
+
+	// Records n, which is visited with frustum result res unless that is 0.
+	// The children traverse() would frustum check are checked together,
+	// against their parent's result. traverse() clears mRes after each child
+	// it checks, but only an only child can skip its check, so the same
+	// children get checked either way.
+	void record(const LLSpatialGroup::OctreeNode* n, S32 res, LLSpatialPartition::cull_record_list_t& records)
+	{
+		LLSpatialGroup* group = (LLSpatialGroup*) n->getListener(0);
+		U32 index = records.size();
+		records.push_back(LLSpatialCullRecord(group));
+
+		if (res)
+		{
+			mRes = res;
+			records[index].mVisited = true;
+			records[index].mRes = res;
+			records[index].mCheckObjects = checkObjects(n, group);
+
+			const U32 MAX_BATCH = 8; // one child per octant
+			LLSpatialGroup* groups[MAX_BATCH];
+			S8 results[MAX_BATCH];
+			U32 count = 0;
+			for (U32 i = 0; i < n->getChildCount() && count < MAX_BATCH; i++)
+			{
+				LLSpatialGroup* child = (LLSpatialGroup*) n->getChild(i)->getListener(0);
+				if (!skipFrustumCheck(res, child))
+				{
+					groups[count++] = child;
+				}
+			}
+			if (count)
+			{
+				frustumCheckGroups(groups, count, results);
+			}
+
+			U32 checked = 0;
+			for (U32 i = 0; i < n->getChildCount(); i++)
+			{
+				LLSpatialGroup* child = (LLSpatialGroup*) n->getChild(i)->getListener(0);
+				S32 child_res = res;
+				if (!skipFrustumCheck(res, child))
+				{
+					child_res = checked < count ? results[checked++] : frustumCheck(child);
+				}
+				record(n->getChild(i), child_res, records);
+			}
+		}
+
+		records[index].mSkipTo = records.size();
+	}
+
+	static bool skipFrustumCheck(S32 res, const LLSpatialGroup* group)
+	{
+		return res == 2 || (res && group->isState(LLSpatialGroup::SKIP_FRUSTUM_CHECK));
+	}
+
+	// Does what traverse() leaves to earlyFail() and visit() for the groups
+	// record() found, in the same order. A branch that fails earlyFail() is
+	// skipped whole, as traverse() would.
+	void replay(const LLSpatialPartition::cull_record_list_t& records)
+	{
+		U32 i = 0;
+		while (i < records.size())
+		{
+			const LLSpatialCullRecord& rec = records[i];
+			if (earlyFail(rec.mGroup) || !rec.mVisited)
+			{
+				i = rec.mSkipTo;
+				continue;
+			}
+
+			mRes = rec.mRes;
+			preprocess(rec.mGroup);
+			if (rec.mCheckObjects)
+			{
+				processGroup(rec.mGroup);
+			}
+			++i;
+		}
+		mRes = 0;
+	}
+
 	LLCamera *mCamera;
 	S32 mRes;
+	LLCameraBoxBatch mBoxes;
 };
 
 class LLOctreeCullNoFarClip : public LLOctreeCull
@@ -1886,6 +2007,12 @@ public:
 		return mCamera->AABBInFrustumNoFarClip(group->mBounds[0], group->mBounds[1]);
 	}
 
+	virtual void frustumCheckGroups(LLSpatialGroup* const* groups, U32 count, S8* results)
+	{
+		fillBoxes(groups, count);
+		mCamera->AABBsInFrustum(mBoxes, results, false);
+	}
+
 	virtual S32 frustumCheckObjects(const LLSpatialGroup* group)
 	{
 		S32 res = mCamera->AABBInFrustumNoFarClip(group->mObjectBounds[0], group->mObjectBounds[1]);
@@ -1908,6 +2035,12 @@ public:
 	{
 		return mCamera->AABBInFrustum(group->mObjectBounds[0], group->mObjectBounds[1]);
 	}
+
+	virtual void frustumCheckGroups(LLSpatialGroup* const* groups, U32 count, S8* results)
+	{
+		fillBoxes(groups, count);
+		mCamera->AABBsInFrustum(mBoxes, results, true);
+	}
 };
 
 class LLOctreeCullVisExtents: public LLOctreeCullShadow
@@ -2214,13 +2347,13 @@ S32 LLSpatialPartition::cull(LLCamera &camera, std::vector<LLDrawable *>* result
 		LLOctreeSelect selecter(&camera, results);
 		selecter.traverse(mOctree);
 	}
-	else if (LLPipeline::sShadowRender)
+	else if (getCullMode() == CULL_SHADOW)
 	{
 		LLFastTimer ftm(FTM_FRUSTUM_CULL);
 		LLOctreeCullShadow culler(&camera);
 		culler.traverse(mOctree);
 	}
-	else if (mInfiniteFarClip || !LLPipeline::sUseFarClip)
+	else if (getCullMode() == CULL_NO_FAR_CLIP)
 	{
 		LLFastTimer ftm(FTM_FRUSTUM_CULL);		
 		LLOctreeCullNoFarClip culler(&camera);
@@ -2236,6 +2369,111 @@ S32 LLSpatialPartition::cull(LLCamera &camera, std::vector<LLDrawable *>* result
 	return 0;
 }
 
+LLSpatialPartition::ECullMode LLSpatialPartition::getCullMode() const
+{
+	if (LLPipeline::sShadowRender)
+	{
+		return CULL_SHADOW;
+	}
+	else if (mInfiniteFarClip || !LLPipeline::sUseFarClip)
+	{
+		return CULL_NO_FAR_CLIP;
+	}
+	return CULL_FAR_CLIP;
+}
+
+void LLSpatialPartition::rebound()
+{
+	LLMemType mt(LLMemType::MTYPE_SPACE_PARTITION);
+	LLFastTimer ftm(FTM_CULL_REBOUND);
+	LLSpatialGroup* group = (LLSpatialGroup*) mOctree->getListener(0);
+	group->rebound();
+}
+
+// May run on any thread, see LLSpatialCullThread
+void LLSpatialPartition::recordCull(LLCamera& camera, ECullMode mode)
+{
+	mCullRecords.clear();
+
+	if (mode == CULL_SHADOW)
+	{
+		LLOctreeCullShadow culler(&camera);
+		culler.record(mOctree, mCullRecords);
+	}
+	else if (mode == CULL_NO_FAR_CLIP)
+	{
+		LLOctreeCullNoFarClip culler(&camera);
+		culler.record(mOctree, mCullRecords);
+	}
+	else
+	{
+		LLOctreeCull culler(&camera);
+		culler.record(mOctree, mCullRecords);
+	}
+}
+
+void LLSpatialPartition::replayCull(LLCamera& camera)
+{
+	LLMemType mt(LLMemType::MTYPE_SPACE_PARTITION);
+	LLFastTimer ftm(FTM_FRUSTUM_CULL);
+	// the frustum checks are in the records, so any culler will do
+	LLOctreeCull culler(&camera);
+	culler.replay(mCullRecords);
+}
+
+//-----------------------------------------------------------------------------
+// LLSpatialCullThread
+//-----------------------------------------------------------------------------
+
+LLSpatialCullThread::CullRequest::CullRequest(handle_t handle, LLSpatialPartition* part, const LLCamera& camera,
+											  LLSpatialPartition::ECullMode mode)
+:	LLQueuedThread::QueuedRequest(handle, LLQueuedThread::PRIORITY_NORMAL),
+	mPartition(part),
+	mCamera(camera),
+	mMode(mode)
+{
+}
+
+LLSpatialCullThread::CullRequest::~CullRequest()
+{
+}
+
+// Called from LLSpatialCullThread workers or from finishCull()
+bool LLSpatialCullThread::CullRequest::processRequest()
+{
+	mPartition->recordCull(mCamera, mMode);
+	return true;
+}
+
+LLSpatialCullThread::LLSpatialCullThread(bool threaded, U32 concurrency)
+:	LLQueuedThread("spatialcull", threaded, concurrency)
+{
+}
+
+LLQueuedThread::handle_t LLSpatialCullThread::cullPartition(LLSpatialPartition* part, const LLCamera& camera)
+{
+	part->rebound();
+
+	handle_t handle = generateHandle();
+	CullRequest* req = new CullRequest(handle, part, camera, part->getCullMode());
+	if (!addRequest(req))
+	{
+		llerrs << "LLSpatialCullThread::cullPartition called after shutdown()" << llendl;
+	}
+	return handle;
+}
+
+void LLSpatialCullThread::finishCull(handle_t handle, LLSpatialPartition* part, LLCamera& camera)
+{
+	// runs queued passes here rather than wait for the workers to get to them
+	status_t status = waitForRequest(handle);
+	if (status == STATUS_COMPLETE)
+	{
+		part->replayCull(camera);
+	}
+	completeRequest(handle);
+}
+
 BOOL earlyFail(LLCamera* camera, LLSpatialGroup* group)
 {
 	if (camera->getOrigin().isExactlyZero())
@@ -32,6 +32,7 @@
 #include "lldrawable.h"
 #include "lloctree.h"
 #include "llpointer.h"
+#include "llqueuedthread.h"
 #include "llrefcount.h"
 #include "llvertexbuffer.h"
 #include "llgltypes.h"
@@ -364,6 +365,21 @@ public:
 	F32 mRadius;
 };
 
+// What the frustum pass of a cull found for one group, kept in the order the
+// octree is traversed so the rest of the cull can be replayed from it.
+class LLSpatialCullRecord
+{
+public:
+	LLSpatialCullRecord(LLSpatialGroup* group)
+	:	mGroup(group), mSkipTo(0), mRes(0), mVisited(false), mCheckObjects(false) { }
+
+	LLSpatialGroup* mGroup;
+	U32 mSkipTo;		// index of the first record past this group's branch
+	S32 mRes;			// frustum result the group was visited with
+	bool mVisited;		// at least partly in the frustum
+	bool mCheckObjects;	// objects in the group may be in the frustum
+};
+
 class LLGeometryManager
 {
 public:
@@ -408,6 +424,22 @@ public:
 
 	BOOL visibleObjectsInFrustum(LLCamera& camera);
 	S32 cull(LLCamera &camera, std::vector<LLDrawable *>* results = NULL, BOOL for_select = FALSE); // Cull on arbitrary frustum
+
+	// cull() in three steps so LLSpatialCullThread can do the frustum checks
+	// of several partitions at once. recordCull() only reads the octree and
+	// the camera, so it may run on a worker once rebound() has been called.
+	// replayCull() does the occlusion checks and fills the cull result from
+	// the records on the main thread.
+	enum ECullMode
+	{
+		CULL_FAR_CLIP,
+		CULL_NO_FAR_CLIP,
+		CULL_SHADOW
+	};
+	ECullMode getCullMode() const;
+	void rebound();
+	void recordCull(LLCamera& camera, ECullMode mode);
+	void replayCull(LLCamera& camera);
 	
 	BOOL isVisible(const LLVector3& v);
 	
@@ -434,6 +466,9 @@ public:
 	BOOL mDepthMask; //if TRUE, objects in this partition will be written to depth during alpha rendering
 	U32 mDrawableType;
 	U32 mPartitionType;
+
+	typedef std::vector<LLSpatialCullRecord> cull_record_list_t;
+	cull_record_list_t mCullRecords; // filled by recordCull(), kept to reuse the storage
 };
 
 // class for creating bridges between spatial partitions
@@ -466,6 +501,41 @@ public:
 	LLDrawable* mDrawable;
 };
 
+// Runs the frustum pass of LLSpatialPartition::cull() for several partitions
+// at once, on LLThreadScheduler workers when there is a scheduler.
+class LLSpatialCullThread : public LLQueuedThread
+{
+public:
+	class CullRequest : public LLQueuedThread::QueuedRequest
+	{
+	protected:
+		virtual ~CullRequest(); // use deleteRequest()
+
+	public:
+		CullRequest(handle_t handle, LLSpatialPartition* part, const LLCamera& camera,
+					LLSpatialPartition::ECullMode mode);
+
+		/*virtual*/ bool processRequest();
+
+	private:
+		LLSpatialPartition* mPartition;
+		LLCamera mCamera;
+		LLSpatialPartition::ECullMode mMode;
+	};
+
+	LLSpatialCullThread(bool threaded = true, U32 concurrency = 1);
+
+	// Rebounds part and queues its frustum pass against a copy of camera.
+	// Nothing may move in part until finishCull() has been called on the
+	// handle.
+	handle_t cullPartition(LLSpatialPartition* part, const LLCamera& camera);
+
+	// Waits for the frustum pass, working on queued ones meanwhile, then
+	// replays it against camera. Call in the order the partitions were
+	// queued to get the same cull result as LLSpatialPartition::cull().
+	void finishCull(handle_t handle, LLSpatialPartition* part, LLCamera& camera);
+};
+
 class LLCullResult 
 {
 public:
@@ -609,6 +679,8 @@ public:
 	LLCloudPartition();
 };
 
+class LLVolumeGeometryThread;
+
 //class for wrangling geometry out of volumes (implemented in LLVOVolume.cpp)
 class LLVolumeGeometryManager: public LLGeometryManager
 {
@@ -619,6 +691,69 @@ class LLVolumeGeometryManager: public LLGeometryManager
 	virtual void getGeometry(LLSpatialGroup* group);
 	void genDrawInfo(LLSpatialGroup* group, U32 mask, std::vector<LLFace*>& faces, BOOL distance_sort = FALSE);
 	void registerFace(LLSpatialGroup* group, LLFace* facep, U32 type);
+
+	// When set and batching, rebuildGeom() leaves filling the vertex buffers
+	// it lays out to this thread.  Owned by LLPipeline.
+	static LLVolumeGeometryThread* sFillThread;
+
+private:
+	// faces laid out by genDrawInfo() for sFillThread, and their buffers
+	std::vector<LLFace*> mFillFaces;
+	std::vector<LLPointer<LLVertexBuffer> > mFillBuffers;
+};
+
+// Fills the vertex buffers LLVolumeGeometryManager::rebuildGeom() lays out
+// for a batch of spatial groups, on LLThreadScheduler workers when there is
+// a scheduler.  Sorting faces into buffers, draw info generation and mapping
+// and unmapping the buffers stay on the main thread; the requests only copy
+// geometry out of the volumes into the mapped buffers.
+class LLVolumeGeometryThread : public LLQueuedThread
+{
+public:
+	class FillRequest : public LLQueuedThread::QueuedRequest
+	{
+	protected:
+		virtual ~FillRequest(); // use deleteRequest()
+
+	public:
+		FillRequest(handle_t handle, std::vector<LLFace*>::const_iterator begin,
+					std::vector<LLFace*>::const_iterator end);
+
+		/*virtual*/ bool processRequest();
+
+	private:
+		std::vector<LLFace*> mFaces;
+	};
+
+	LLVolumeGeometryThread(bool threaded = true, U32 concurrency = 1);
+
+	// Groups rebuilt between beginBatch() and finishBatch() have their faces
+	// filled by this thread.  Nothing may touch those groups, their drawables
+	// or their buffers until finishBatch() returns.
+	void beginBatch();
+	bool isBatching() const { return mBatching; }
+
+	// Queues filling faces, which LLFace::prepareGeometryVolume() has been
+	// called on, and takes over unmapping buffers once they are filled.
+	// Leaves both vectors empty.
+	void queueFill(LLSpatialGroup* group, std::vector<LLFace*>& faces,
+				   std::vector<LLPointer<LLVertexBuffer> >& buffers);
+
+	// Waits for every fill queued since beginBatch(), working on queued ones
+	// meanwhile.  Then unmaps the buffers and clears the rebuild state of the
+	// groups' drawables, as rebuildGeom() does when it fills them itself.
+	void finishBatch();
+
+private:
+	struct PendingFill
+	{
+		LLPointer<LLSpatialGroup> mGroup;
+		std::vector<handle_t> mHandles;
+		std::vector<LLPointer<LLVertexBuffer> > mBuffers;
+	};
+
+	std::vector<PendingFill> mPending;
+	bool mBatching;
 };
 
 //spatial partition that uses volume geometry manager (implemented in LLVOVolume.cpp)
@@ -733,21 +733,27 @@ void LLTextureCacheWorker::endWork(S32 param, bool aborted)
 //////////////////////////////////////////////////////////////////////////////
 
 LLTextureCache::LLTextureCache(bool threaded)
-	: LLWorkerThread("TextureCache", threaded),
+	: LLWorkerThread("TextureCache", threaded, 1), // uses our local APR pool, so never concurrently
 	  mWorkersMutex(NULL),
 	  mHeaderMutex(NULL),
 	  mListMutex(NULL),
-	  mHeaderAPRFile(NULL),
+	  mHeaderEntriesPool(NULL),
+	  mHeaderEntriesMap(NULL),
+	  mHeaderEntriesData(NULL),
+	  mHeaderEntriesCapacity(0),
 	  mReadOnly(TRUE), //do not allow to change the texture cache until setReadOnly() is called.
+	  mHeaderIndexMask(0),
 	  mTexturesSizeTotal(0),
 	  mDoPurge(FALSE)
 {
+	mHeaderIndexSerial = 0;
 }
 
 LLTextureCache::~LLTextureCache()
 {
 	clearDeleteList() ;
 	writeUpdatedEntries() ;
+	unmapHeaderEntriesFile() ;
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -824,10 +830,7 @@ std::string LLTextureCache::getTextureFileName(const LLUUID& id)
 //debug
 BOOL LLTextureCache::isInCache(const LLUUID& id) 
 {
-	LLMutexLock lock(&mHeaderMutex);
-	id_map_t::const_iterator iter = mHeaderIDMap.find(id);
-	
-	return (iter != mHeaderIDMap.end()) ;
+	return (lookupHeaderIndex(id) >= 0) ;
 }
 
 //debug
@@ -897,8 +900,10 @@ void LLTextureCache::purgeCache(ELLPath location)
 
 	if (!mReadOnly)
 	{
+		// workers read texture.entries without mHeaderMutex
+		llassert(!hasWorkers());
+		unmapHeaderEntriesFile();
 		setDirNames(location);
-		llassert_always(mHeaderAPRFile == NULL);
 
 		//remove the legacy cache if exists
 		std::string texture_dir = mTexturesDirName ;
@@ -981,37 +986,133 @@ S64 LLTextureCache::initCache(ELLPath location, S64 max_size, BOOL texture_cache
 //----------------------------------------------------------------------------
 // mHeaderMutex must be locked for the following functions!
 
-LLAPRFile* LLTextureCache::openHeaderEntriesFile(bool readonly, S32 offset)
+// Maps texture.entries, growing it first to hold sCacheMaxEntries entries.
+// In read only mode, or when the file can not be mapped, it is read into
+// mHeaderEntriesBuffer instead. Only done while no workers exist, since
+// lookupHeaderIndex() reads the entries without mHeaderMutex. Once set up,
+// the data is neither moved nor grown until the cache is purged or closed.
+bool LLTextureCache::mapHeaderEntriesFile()
 {
-	llassert_always(mHeaderAPRFile == NULL);
-	apr_int32_t flags = readonly ? APR_READ|APR_BINARY : APR_READ|APR_WRITE|APR_BINARY;
-	mHeaderAPRFile = new LLAPRFile(mHeaderEntriesFileName, flags, getLocalAPRFilePool());
-	if(offset > 0)
+	if (mHeaderEntriesData)
+	{
+		return true;
+	}
+	if (hasWorkers())
+	{
+		// could not be set up when the cache was opened, do without
+		// rather than put it under lookups already running
+		return false;
+	}
+
+	mHeaderEntriesPool = new LLVolatileAPRPool();
+	apr_int32_t flags = mReadOnly ? LL_APR_RB : (APR_CREATE|LL_APR_RPB);
+	S32 file_size = 0;
+	if (mHeaderEntriesFile.open(mHeaderEntriesFileName, flags, mHeaderEntriesPool, &file_size) != APR_SUCCESS
+		|| !mHeaderEntriesFile.getFileHandle())
+	{
+		unmapHeaderEntriesFile();
+		return false;
+	}
+
+	bool new_file = file_size < (S32)sizeof(EntriesInfo);
+	U32 capacity = new_file ? 0 : (U32)(file_size - sizeof(EntriesInfo)) / sizeof(Entry);
+	if (!mReadOnly)
+	{
+		capacity = llmax(capacity, sCacheMaxEntries);
+	}
+	S32 data_size = (S32)(sizeof(EntriesInfo) + capacity * sizeof(Entry));
+	if (data_size > file_size && !mReadOnly)
+	{
+		// a mapping can not grow the file
+		U8 zero = 0;
+		if (mHeaderEntriesFile.seek(APR_SET, data_size - 1) != data_size - 1
+			|| mHeaderEntriesFile.write(&zero, 1) != 1)
+		{
+			llwarns << "Unable to grow " << mHeaderEntriesFileName << " to " << data_size << " bytes" << llendl;
+			unmapHeaderEntriesFile();
+			return false;
+		}
+	}
+
+	if (!mReadOnly
+		&& apr_mmap_create(&mHeaderEntriesMap, mHeaderEntriesFile.getFileHandle(), 0, data_size,
+						   APR_MMAP_READ|APR_MMAP_WRITE, mHeaderEntriesPool->getVolatileAPRPool()) == APR_SUCCESS)
 	{
-		mHeaderAPRFile->seek(APR_SET, offset);
+		mHeaderEntriesData = (U8*)mHeaderEntriesMap->mm;
 	}
-	return mHeaderAPRFile;
+	else
+	{
+		if (!mReadOnly)
+		{
+			mHeaderEntriesPool->clearVolatileAPRPool();
+		}
+		mHeaderEntriesMap = NULL;
+		mHeaderEntriesBuffer.resize(data_size);
+		S32 read_size = llmin(file_size, data_size);
+		if (read_size > 0
+			&& (mHeaderEntriesFile.seek(APR_SET, 0) != 0
+				|| mHeaderEntriesFile.read(&mHeaderEntriesBuffer[0], read_size) != read_size))
+		{
+			llwarns << "Unable to read " << mHeaderEntriesFileName << llendl;
+			unmapHeaderEntriesFile();
+			return false;
+		}
+		mHeaderEntriesData = &mHeaderEntriesBuffer[0];
+	}
+	mHeaderEntriesCapacity = capacity;
+	initHeaderIndex(capacity);
+
+	if (new_file)
+	{
+		EntriesInfo info;
+		info.mVersion = sHeaderCacheVersion;
+		info.mEntries = 0;
+		memcpy(mHeaderEntriesData, &info, sizeof(EntriesInfo));
+		writeHeaderEntriesData(0, sizeof(EntriesInfo));
+	}
+	return true;
 }
 
-void LLTextureCache::closeHeaderEntriesFile()
+void LLTextureCache::unmapHeaderEntriesFile()
 {
-	if(!mHeaderAPRFile)
+	// before the data goes away, so lookupHeaderIndex() stops using it
+	clearHeaderIndex();
+
+	if (mHeaderEntriesMap)
 	{
-		return ;
+		apr_mmap_delete(mHeaderEntriesMap);
+		mHeaderEntriesMap = NULL;
+		mHeaderEntriesPool->clearVolatileAPRPool();
+	}
+	if (mHeaderEntriesFile.getFileHandle())
+	{
+		mHeaderEntriesFile.close();
 	}
+	delete mHeaderEntriesPool;
+	mHeaderEntriesPool = NULL;
+	mHeaderEntriesBuffer.clear();
+	mHeaderEntriesData = NULL;
+	mHeaderEntriesCapacity = 0;
+}
 
-	delete mHeaderAPRFile;
-	mHeaderAPRFile = NULL;
+// Changes to the mapping go to the file by themselves, this only writes
+// when mHeaderEntriesData is a copy.
+bool LLTextureCache::writeHeaderEntriesData(S32 offset, S32 size)
+{
+	if (mHeaderEntriesMap || mReadOnly)
+	{
+		return true;
+	}
+	return mHeaderEntriesFile.seek(APR_SET, offset) == offset
+		&& mHeaderEntriesFile.write(mHeaderEntriesData + offset, size) == size;
 }
 
 void LLTextureCache::readEntriesHeader()
 {
 	// mHeaderEntriesInfo initializes to default values so safe not to read it
-	llassert_always(mHeaderAPRFile == NULL);
-	if (LLAPRFile::isExist(mHeaderEntriesFileName, getLocalAPRFilePool()))
+	if (mapHeaderEntriesFile())
 	{
-		LLAPRFile::readEx(mHeaderEntriesFileName, (U8*)&mHeaderEntriesInfo, 0, sizeof(EntriesInfo),
-						  getLocalAPRFilePool());
+		memcpy(&mHeaderEntriesInfo, mHeaderEntriesData, sizeof(EntriesInfo));
 	}
 	else //create an empty entries header.
 	{
@@ -1023,24 +1124,25 @@ void LLTextureCache::readEntriesHeader()
 
 void LLTextureCache::writeEntriesHeader()
 {
-	llassert_always(mHeaderAPRFile == NULL);
 	if (!mReadOnly)
 	{
-		LLAPRFile::writeEx(mHeaderEntriesFileName, (U8*)&mHeaderEntriesInfo, 0, sizeof(EntriesInfo),
-						   getLocalAPRFilePool());
+		if (mHeaderEntriesData)
+		{
+			memcpy(mHeaderEntriesData, &mHeaderEntriesInfo, sizeof(EntriesInfo));
+			writeHeaderEntriesData(0, sizeof(EntriesInfo));
+		}
+		else
+		{
+			LLAPRFile::writeEx(mHeaderEntriesFileName, (U8*)&mHeaderEntriesInfo, 0, sizeof(EntriesInfo),
+							   getLocalAPRFilePool());
+		}
 	}
 }
 
 //mHeaderMutex is locked before calling this.
 S32 LLTextureCache::openAndReadEntry(const LLUUID& id, Entry& entry, bool create)
 {
-	S32 idx = -1;
-	
-	id_map_t::iterator iter1 = mHeaderIDMap.find(id);
-	if (iter1 != mHeaderIDMap.end())
-	{
-		idx = iter1->second;
-	}
+	S32 idx = findHeaderIndex(id);
 
 	if (idx < 0)
 	{
@@ -1067,10 +1169,10 @@ S32 LLTextureCache::openAndReadEntry(const LLUUID& id, Entry& entry, bool create
 					// Erase entry from LRU regardless
 					mLRU.erase(curiter2);
 					// Look up entry and use it if it is valid
-					id_map_t::iterator iter3 = mHeaderIDMap.find(oldid);
-					if (iter3 != mHeaderIDMap.end() && iter3->second >= 0)
+					S32 old_idx = findHeaderIndex(oldid);
+					if (old_idx >= 0)
 					{
-						idx = iter3->second;
+						idx = old_idx;
 						removeCachedTexture(oldid) ;//remove the existing cached texture to release the entry index.
 						break;
 					}
@@ -1092,14 +1194,11 @@ S32 LLTextureCache::openAndReadEntry(const LLUUID& id, Entry& entry, bool create
 		// Remove this entry from the LRU if it exists
 		mLRU.erase(id);
 		// Read the entry
-		idx_entry_map_t::iterator iter = mUpdatedEntryMap.find(idx) ;
-		if(iter != mUpdatedEntryMap.end())
+		readEntryFromHeaderImmediately(idx, entry) ;
+		idx_time_map_t::iterator iter = mUpdatedTimeMap.find(idx) ;
+		if(iter != mUpdatedTimeMap.end())
 		{
-			entry = iter->second ;
-		}
-		else
-		{
-			readEntryFromHeaderImmediately(idx, entry) ;
+			entry.mTime = iter->second ;
 		}
 		if(entry.mImageSize <= entry.mBodySize)//it happens on 64-bit systems, do not know why
 		{
@@ -1108,7 +1207,6 @@ S32 LLTextureCache::openAndReadEntry(const LLUUID& id, Entry& entry, bool create
 			//erase this entry and the cached texture from the cache.
 			std::string tex_filename = getTextureFileName(id);
 			removeEntry(idx, entry, tex_filename) ;
-			mUpdatedEntryMap.erase(idx) ;
 			idx = -1 ;
 		}
 	}
@@ -1118,28 +1216,26 @@ S32 LLTextureCache::openAndReadEntry(const LLUUID& id, Entry& entry, bool create
 //mHeaderMutex is locked before calling this.
 void LLTextureCache::writeEntryToHeaderImmediately(S32& idx, Entry& entry, bool write_header)
 {	
-	LLAPRFile* aprfile ;
-	S32 bytes_written ;
-	S32 offset = sizeof(EntriesInfo) + idx * sizeof(Entry);
+	if (idx < 0 || (U32)idx >= mHeaderEntriesCapacity)
+	{
+		clearCorruptedCache() ; //clear the cache.
+		idx = -1 ;//mark the idx invalid.
+		return ;
+	}
+
 	if(write_header)
 	{
-		aprfile = openHeaderEntriesFile(false, 0);		
-		bytes_written = aprfile->write((U8*)&mHeaderEntriesInfo, sizeof(EntriesInfo)) ;
-		if(bytes_written != sizeof(EntriesInfo))
+		memcpy(mHeaderEntriesData, &mHeaderEntriesInfo, sizeof(EntriesInfo));
+		if(!writeHeaderEntriesData(0, sizeof(EntriesInfo)))
 		{
 			clearCorruptedCache() ; //clear the cache.
 			idx = -1 ;//mark the idx invalid.
 			return ;
 		}
-
-		mHeaderAPRFile->seek(APR_SET, offset);
 	}
-	else
-	{
-		aprfile = openHeaderEntriesFile(false, offset);
-	}
-	bytes_written = aprfile->write((void*)&entry, (S32)sizeof(Entry));
-	if(bytes_written != sizeof(Entry))
+
+	memcpy(getHeaderEntry(idx), &entry, sizeof(Entry));
+	if(!writeHeaderEntriesData(sizeof(EntriesInfo) + idx * sizeof(Entry), sizeof(Entry)))
 	{
 		clearCorruptedCache() ; //clear the cache.
 		idx = -1 ;//mark the idx invalid.
@@ -1147,23 +1243,19 @@ void LLTextureCache::writeEntryToHeaderImmediately(S32& idx, Entry& entry, bool
 		return ;
 	}
 
-	closeHeaderEntriesFile();
-	mUpdatedEntryMap.erase(idx) ;
+	mUpdatedTimeMap.erase(idx) ;
 }
 
 //mHeaderMutex is locked before calling this.
 void LLTextureCache::readEntryFromHeaderImmediately(S32& idx, Entry& entry)
 {
-	S32 offset = sizeof(EntriesInfo) + idx * sizeof(Entry);
-	LLAPRFile* aprfile = openHeaderEntriesFile(true, offset);
-	S32 bytes_read = aprfile->read((void*)&entry, (S32)sizeof(Entry));
-	closeHeaderEntriesFile();
-
-	if(bytes_read != sizeof(Entry))
+	if((U32)idx >= mHeaderEntriesCapacity)
 	{
 		clearCorruptedCache() ; //clear the cache.
 		idx = -1 ;//mark the idx invalid.
+		return ;
 	}
+	entry = *getHeaderEntry(idx);
 }
 
 //mHeaderMutex is locked before calling this.
@@ -1182,7 +1274,7 @@ void LLTextureCache::updateEntryTimeStamp(S32 idx, Entry& entry)
 		if (!mReadOnly)
 		{
 			entry.mTime = time(NULL);			
-			mUpdatedEntryMap[idx] = entry ;
+			mUpdatedTimeMap[idx] = entry.mTime ;
 		}
 	}
 }
@@ -1205,8 +1297,6 @@ bool LLTextureCache::updateEntry(S32& idx, Entry& entry, S32 new_image_size, S32
 		bool update_header = false ;
 		if(entry.mImageSize < 0) //is a brand-new entry
 		{
-			mHeaderIDMap[entry.mID] = idx;
-			mTexturesSizeMap[entry.mID] = new_body_size ;
 			mTexturesSizeTotal += new_body_size ;
 			
 			// Update Header
@@ -1214,8 +1304,7 @@ bool LLTextureCache::updateEntry(S32& idx, Entry& entry, S32 new_image_size, S32
 		}				
 		else if (entry.mBodySize != new_body_size)
 		{
-			//already in mHeaderIDMap.
-			mTexturesSizeMap[entry.mID] = new_body_size ;
+			//already in the header index.
 			mTexturesSizeTotal -= entry.mBodySize ;
 			mTexturesSizeTotal += new_body_size ;
 		}
@@ -1224,6 +1313,11 @@ bool LLTextureCache::updateEntry(S32& idx, Entry& entry, S32 new_image_size, S32
 		entry.mBodySize = new_body_size ;
 		
 		writeEntryToHeaderImmediately(idx, entry, update_header) ;
+		if (update_header && idx >= 0)
+		{
+			// after the entry is written, for lookups without the lock
+			setHeaderIndex(entry.mID, idx);
+		}
 	
 		if (mTexturesSizeTotal > sCacheMaxTexturesSize)
 		{
@@ -1241,47 +1335,43 @@ bool LLTextureCache::updateEntry(S32& idx, Entry& entry, S32 new_image_size, S32
 	return false ;
 }
 
-U32 LLTextureCache::openAndReadEntries(std::vector<Entry>& entries)
+//mHeaderMutex is locked before calling this.
+U32 LLTextureCache::openAndReadEntries()
 {
 	U32 num_entries = mHeaderEntriesInfo.mEntries;
 
-	mHeaderIDMap.clear();
-	mTexturesSizeMap.clear();
 	mFreeList.clear();
 	mTexturesSizeTotal = 0;
 
-	LLAPRFile* aprfile = NULL; 
-	if(mUpdatedEntryMap.empty())
+	//write the delayed time stamps first.
+	updatedHeaderEntriesFile() ;
+
+	if (num_entries > mHeaderEntriesCapacity)
 	{
-		aprfile = openHeaderEntriesFile(true, (S32)sizeof(EntriesInfo));
+		llwarns << "Corrupted header entries, " << num_entries << " entries in a file for " << mHeaderEntriesCapacity << llendl;
+		purgeAllTextures(false);
+		return 0;
 	}
-	else //update the header file first.
+
+	// Rebuild the index in one go, lookupHeaderIndex() waits for the lock
+	// meanwhile instead of missing entries
+	mHeaderIndexSerial++;
+	for (U32 i = 0; i < mHeaderIndex.size(); ++i)
 	{
-		aprfile = openHeaderEntriesFile(false, 0);
-		updatedHeaderEntriesFile() ;
-		if(!aprfile)
-		{
-			return 0;
-		}
-		aprfile->seek(APR_SET, (S32)sizeof(EntriesInfo));
+		mHeaderIndex[i].mIndex = -1;
 	}
 	for (U32 idx=0; idx<num_entries; idx++)
 	{
-		Entry entry;
-		S32 bytes_read = aprfile->read((void*)(&entry), (S32)sizeof(Entry));
-		if (bytes_read < sizeof(Entry))
-		{
-			llwarns << "Corrupted header entries, failed at " << idx << " / " << num_entries << llendl;
-			closeHeaderEntriesFile();
-			purgeAllTextures(false);
-			return 0;
-		}
-		entries.push_back(entry);
+		const Entry& entry = *getHeaderEntry(idx);
 // 		llinfos << "ENTRY: " << entry.mTime << " TEX: " << entry.mID << " IDX: " << idx << " Size: " << entry.mImageSize << llendl;
 		if(entry.mImageSize > entry.mBodySize)
 		{
-			mHeaderIDMap[entry.mID] = idx;
-			mTexturesSizeMap[entry.mID] = entry.mBodySize;
+			S32 old_idx = insertHeaderIndex(entry.mID, idx);
+			if (old_idx >= 0)
+			{
+				// the same texture twice, the last one wins
+				mTexturesSizeTotal -= getHeaderEntry(old_idx)->mBodySize;
+			}
 			mTexturesSizeTotal += entry.mBodySize;
 		}
 		else
@@ -1289,7 +1379,7 @@ U32 LLTextureCache::openAndReadEntries(std::vector<Entry>& entries)
 			mFreeList.insert(idx);
 		}
 	}
-	closeHeaderEntriesFile();
+	mHeaderIndexSerial++;
 	return num_entries;
 }
 
@@ -1298,70 +1388,228 @@ void LLTextureCache::writeEntriesAndClose(const std::vector<Entry>& entries)
 	S32 num_entries = entries.size();
 	llassert_always(num_entries == mHeaderEntriesInfo.mEntries);
 	
-	if (!mReadOnly)
+	if (!mReadOnly && num_entries > 0)
 	{
-		LLAPRFile* aprfile = openHeaderEntriesFile(false, (S32)sizeof(EntriesInfo));
-		for (S32 idx=0; idx<num_entries; idx++)
+		if ((U32)num_entries > mHeaderEntriesCapacity)
 		{
-			S32 bytes_written = aprfile->write((void*)(&entries[idx]), (S32)sizeof(Entry));
-			if(bytes_written != sizeof(Entry))
-			{
-				clearCorruptedCache() ; //clear the cache.
-				return ;
-			}
+			clearCorruptedCache() ; //clear the cache.
+			return ;
+		}
+		memcpy(getHeaderEntry(0), &entries[0], num_entries * sizeof(Entry));
+		if(!writeHeaderEntriesData(sizeof(EntriesInfo), num_entries * sizeof(Entry)))
+		{
+			clearCorruptedCache() ; //clear the cache.
+			return ;
 		}
-		closeHeaderEntriesFile();
 	}
 }
 
 void LLTextureCache::writeUpdatedEntries()
 {
 	lockHeaders() ;
-	if (!mReadOnly && !mUpdatedEntryMap.empty())
-	{
-		openHeaderEntriesFile(false, 0);
-		updatedHeaderEntriesFile() ;
-		closeHeaderEntriesFile();
-	}
+	updatedHeaderEntriesFile() ;
 	unlockHeaders() ;
 }
 
-//mHeaderMutex is locked and mHeaderAPRFile is created before calling this.
+//mHeaderMutex is locked before calling this.
+//writes the time stamps delayed by updateEntryTimeStamp().
 void LLTextureCache::updatedHeaderEntriesFile()
 {
-	if (!mReadOnly && !mUpdatedEntryMap.empty() && mHeaderAPRFile)
+	if (!mReadOnly && !mUpdatedTimeMap.empty() && mHeaderEntriesData)
 	{
 		//entriesInfo
-		mHeaderAPRFile->seek(APR_SET, 0);
-		S32 bytes_written = mHeaderAPRFile->write((U8*)&mHeaderEntriesInfo, sizeof(EntriesInfo)) ;
-		if(bytes_written != sizeof(EntriesInfo))
+		memcpy(mHeaderEntriesData, &mHeaderEntriesInfo, sizeof(EntriesInfo));
+		if(!writeHeaderEntriesData(0, sizeof(EntriesInfo)))
 		{
 			clearCorruptedCache() ; //clear the cache.
 			return ;
 		}
 		
-		//write each updated entry
-		S32 entry_size = (S32)sizeof(Entry) ;
-		S32 prev_idx = -1 ;
-		S32 delta_idx ;
-		for (idx_entry_map_t::iterator iter = mUpdatedEntryMap.begin(); iter != mUpdatedEntryMap.end(); ++iter)
-		{
-			delta_idx = iter->first - prev_idx - 1;
-			prev_idx = iter->first ;
-			if(delta_idx)
+		//stamp each updated entry
+		for (idx_time_map_t::iterator iter = mUpdatedTimeMap.begin(); iter != mUpdatedTimeMap.end(); ++iter)
+		{
+			S32 idx = iter->first;
+			if ((U32)idx >= mHeaderEntriesCapacity)
 			{
-				mHeaderAPRFile->seek(APR_CUR, delta_idx * entry_size);
+				continue;
 			}
-			
-			bytes_written = mHeaderAPRFile->write((void*)(&iter->second), entry_size);
-			if(bytes_written != entry_size)
+			getHeaderEntry(idx)->mTime = iter->second;
+			if(!writeHeaderEntriesData(sizeof(EntriesInfo) + idx * sizeof(Entry), sizeof(Entry)))
 			{
 				clearCorruptedCache() ; //clear the cache.
 				return ;
 			}
 		}
-		mUpdatedEntryMap.clear() ;
+		mUpdatedTimeMap.clear() ;
+	}
+}
+
+//----------------------------------------------------------------------------
+// The header index. Lookups compare the id with the entry itself, so only
+// an index and a hash are kept per slot.
+
+void LLTextureCache::initHeaderIndex(U32 max_entries)
+{
+	// at most half full, which keeps probe sequences short
+	U32 size = 1024;
+	while (size < max_entries * 2)
+	{
+		size <<= 1;
+	}
+	if (size > mHeaderIndex.size())
+	{
+		// only when the cache is opened, there are no workers looking
+		// things up yet
+		llassert(!hasWorkers());
+		mHeaderIndexSerial++;
+		mHeaderIndex.resize(size);
+		mHeaderIndexMask = size - 1;
+		mHeaderIndexSerial++;
+	}
+	clearHeaderIndex();
+}
+
+void LLTextureCache::clearHeaderIndex()
+{
+	mHeaderIndexSerial++;
+	for (U32 i = 0; i < mHeaderIndex.size(); ++i)
+	{
+		mHeaderIndex[i].mIndex = -1;
+	}
+	mHeaderIndexSerial++;
+}
+
+// Needs mHeaderMutex locked, or a check of mHeaderIndexSerial afterwards.
+// Reading the entry a slot points at is safe either way: mHeaderEntriesData
+// stays where it is, at mHeaderEntriesCapacity entries, while workers exist.
+S32 LLTextureCache::findHeaderIndex(const LLUUID& id)
+{
+	if (mHeaderIndex.empty() || !mHeaderEntriesData)
+	{
+		return -1;
+	}
+	U32 hash = id.getCRC32();
+	U32 slot = hash & mHeaderIndexMask;
+	for (U32 probes = 0; probes <= mHeaderIndexMask; ++probes)
+	{
+		S32 idx = mHeaderIndex[slot].mIndex;
+		if (idx < 0)
+		{
+			break;
+		}
+		if (mHeaderIndex[slot].mHash == hash
+			&& (U32)idx < mHeaderEntriesCapacity
+			&& getHeaderEntry(idx)->mID == id)
+		{
+			return idx;
+		}
+		slot = (slot + 1) & mHeaderIndexMask;
+	}
+	return -1;
+}
+
+// findHeaderIndex() without mHeaderMutex. The index is only changed with
+// mHeaderIndexSerial odd, so a probe is good if the serial was even and
+// did not change while it ran. Falls back to locking when it keeps changing.
+// This relies on texture.entries never being remapped, grown or unmapped
+// while workers exist: mapHeaderEntriesFile() will not map it then, and
+// initHeaderIndex() and the purges assert it.
+S32 LLTextureCache::lookupHeaderIndex(const LLUUID& id)
+{
+	const S32 MAX_LOOKUP_TRIES = 4;
+	for (S32 tries = 0; tries < MAX_LOOKUP_TRIES; ++tries)
+	{
+		U32 serial = mHeaderIndexSerial;
+		if (serial & 1)
+		{
+			break;
+		}
+		S32 idx = findHeaderIndex(id);
+		if (mHeaderIndexSerial == serial)
+		{
+			return idx;
+		}
+	}
+
+	LLMutexLock lock(&mHeaderMutex);
+	return findHeaderIndex(id);
+}
+
+// Returns the index id had before, -1 if it was not in the index.
+// mHeaderIndexSerial must be odd.
+S32 LLTextureCache::insertHeaderIndex(const LLUUID& id, S32 idx)
+{
+	if (mHeaderIndex.empty())
+	{
+		return -1;
+	}
+	U32 hash = id.getCRC32();
+	U32 slot = hash & mHeaderIndexMask;
+	for (U32 probes = 0; probes <= mHeaderIndexMask; ++probes)
+	{
+		IndexSlot& index_slot = mHeaderIndex[slot];
+		if (index_slot.mIndex < 0)
+		{
+			index_slot.mHash = hash;
+			index_slot.mIndex = idx;
+			return -1;
+		}
+		if (index_slot.mHash == hash && getHeaderEntry(index_slot.mIndex)->mID == id)
+		{
+			S32 old_idx = index_slot.mIndex;
+			index_slot.mIndex = idx;
+			return old_idx;
+		}
+		slot = (slot + 1) & mHeaderIndexMask;
+	}
+	llwarns << "Texture cache header index is full" << llendl;
+	return -1;
+}
+
+void LLTextureCache::setHeaderIndex(const LLUUID& id, S32 idx)
+{
+	mHeaderIndexSerial++;
+	insertHeaderIndex(id, idx);
+	mHeaderIndexSerial++;
+}
+
+void LLTextureCache::eraseHeaderIndex(const LLUUID& id)
+{
+	if (mHeaderIndex.empty())
+	{
+		return;
+	}
+	U32 hash = id.getCRC32();
+	U32 hole = hash & mHeaderIndexMask;
+	for (U32 probes = 0; ; ++probes)
+	{
+		S32 idx = mHeaderIndex[hole].mIndex;
+		if (idx < 0 || probes > mHeaderIndexMask)
+		{
+			return; // not in the index
+		}
+		if (mHeaderIndex[hole].mHash == hash && getHeaderEntry(idx)->mID == id)
+		{
+			break;
+		}
+		hole = (hole + 1) & mHeaderIndexMask;
+	}
+
+	mHeaderIndexSerial++;
+	// Move later slots of the cluster back into the hole when that keeps
+	// them reachable from their hash, so a probe can still stop at the
+	// first empty slot. No tombstones to pile up this way.
+	for (U32 slot = (hole + 1) & mHeaderIndexMask; mHeaderIndex[slot].mIndex >= 0; slot = (slot + 1) & mHeaderIndexMask)
+	{
+		U32 home = mHeaderIndex[slot].mHash & mHeaderIndexMask;
+		if (((slot - home) & mHeaderIndexMask) >= ((slot - hole) & mHeaderIndexMask))
+		{
+			mHeaderIndex[hole] = mHeaderIndex[slot];
+			hole = slot;
+		}
 	}
+	mHeaderIndex[hole].mIndex = -1;
+	mHeaderIndexSerial++;
 }
 //----------------------------------------------------------------------------
 
@@ -1383,10 +1631,10 @@ void LLTextureCache::readHeaderCache()
 	}
 	else
 	{
-		std::vector<Entry> entries;
-		U32 num_entries = openAndReadEntries(entries);
+		U32 num_entries = openAndReadEntries();
 		if (num_entries)
 		{
+			Entry* entries = getHeaderEntry(0);
 			U32 empty_entries = 0;
 			typedef std::pair<U32, S32> lru_data_t;
 			std::set<lru_data_t> lru;
@@ -1484,7 +1732,6 @@ void LLTextureCache::clearCorruptedCache()
 {
 	llwarns << "the texture cache is corrupted, need to be cleared." << llendl ;
 
-	closeHeaderEntriesFile();//close possible file handler
 	purgeAllTextures(false) ; //clear the cache.
 	
 	if (!mReadOnly) //regenerate the directory tree if not exists.
@@ -1504,6 +1751,12 @@ void LLTextureCache::clearCorruptedCache()
 
 void LLTextureCache::purgeAllTextures(bool purge_directories)
 {
+	if (purge_directories)
+	{
+		// texture.entries is about to go with the directory
+		llassert(!hasWorkers());
+		unmapHeaderEntriesFile();
+	}
 	if (!mReadOnly)
 	{
 		const char* subdirs = "0123456789abcdef";
@@ -1525,12 +1778,10 @@ void LLTextureCache::purgeAllTextures(bool purge_directories)
 			LLFile::rmdir(mTexturesDirName);
 		}		
 	}
-	mHeaderIDMap.clear();
-	mTexturesSizeMap.clear();
+	clearHeaderIndex();
 	mTexturesSizeTotal = 0;
 	mFreeList.clear();
-	mTexturesSizeTotal = 0;
-	mUpdatedEntryMap.clear();
+	mUpdatedTimeMap.clear();
 
 	// Info with 0 entries
 	mHeaderEntriesInfo.mVersion = sHeaderCacheVersion;
@@ -1558,32 +1809,23 @@ void LLTextureCache::purgeTextures(bool validate)
 	llinfos << "TEXTURE CACHE: Purging." << llendl;
 
 	// Read the entries list
-	std::vector<Entry> entries;
-	U32 num_entries = openAndReadEntries(entries);
+	U32 num_entries = openAndReadEntries();
 	if (!num_entries)
 	{
 		return; // nothing to purge
 	}
+	Entry* entries = getHeaderEntry(0);
 	
-	// Use mTexturesSizeMap to collect UUIDs of textures with bodies
+	// Collect the indexed entries of textures with bodies
 	typedef std::set<std::pair<U32,S32> > time_idx_set_t;
 	std::set<std::pair<U32,S32> > time_idx_set;
-	for (size_map_t::iterator iter1 = mTexturesSizeMap.begin();
-		 iter1 != mTexturesSizeMap.end(); ++iter1)
+	for (S32 idx = 0; idx < (S32)num_entries; ++idx)
 	{
-		if (iter1->second > 0)
+		if (entries[idx].mImageSize > entries[idx].mBodySize && entries[idx].mBodySize > 0
+			&& findHeaderIndex(entries[idx].mID) == idx)
 		{
-			id_map_t::iterator iter2 = mHeaderIDMap.find(iter1->first);
-			if (iter2 != mHeaderIDMap.end())
-			{
-				S32 idx = iter2->second;
-				time_idx_set.insert(std::make_pair(entries[idx].mTime, idx));
-// 				llinfos << "TIME: " << entries[idx].mTime << " TEX: " << entries[idx].mID << " IDX: " << idx << " Size: " << entries[idx].mImageSize << llendl;
-			}
-			else
-			{
-				llerrs << "mTexturesSizeMap / mHeaderIDMap corrupted." << llendl ;
-			}
+			time_idx_set.insert(std::make_pair(entries[idx].mTime, idx));
+// 			llinfos << "TIME: " << entries[idx].mTime << " TEX: " << entries[idx].mID << " IDX: " << idx << " Size: " << entries[idx].mImageSize << llendl;
 		}
 	}
 	
@@ -1642,7 +1884,11 @@ void LLTextureCache::purgeTextures(bool validate)
 
 	LL_DEBUGS("TextureCache") << "TEXTURE CACHE: Writing Entries: " << num_entries << LL_ENDL;
 
-	writeEntriesAndClose(entries);
+	// the purged entries were changed in place
+	if (!writeHeaderEntriesData(sizeof(EntriesInfo), num_entries * sizeof(Entry)))
+	{
+		clearCorruptedCache();
+	}
 	
 	// *FIX:Mani - watchdog back on.
 	LLAppViewer::instance()->resumeMainloopTimeout();
@@ -1656,6 +1902,12 @@ void LLTextureCache::purgeTextures(bool validate)
 
 //////////////////////////////////////////////////////////////////////////////
 
+bool LLTextureCache::hasWorkers()
+{
+	LLMutexLock lock(&mWorkersMutex);
+	return !mReaders.empty() || !mWriters.empty();
+}
+
 // call lockWorkers() first!
 LLTextureCacheWorker* LLTextureCache::getReader(handle_t handle)
 {
@@ -1685,6 +1937,10 @@ LLTextureCacheWorker* LLTextureCache::getWriter(handle_t handle)
 // Reads imagesize from the header, updates timestamp
 S32 LLTextureCache::getHeaderCacheEntry(const LLUUID& id, Entry& entry)
 {
+	if (lookupHeaderIndex(id) < 0)
+	{
+		return -1; // a miss needs no waiting for the lock
+	}
 	LLMutexLock lock(&mHeaderMutex);	
 	S32 idx = openAndReadEntry(id, entry, false);
 	if (idx >= 0)
@@ -1846,12 +2102,12 @@ void LLTextureCache::addCompleted(Responder* responder, bool success)
 //called after mHeaderMutex is locked.
 void LLTextureCache::removeCachedTexture(const LLUUID& id)
 {
-	if(mTexturesSizeMap.find(id) != mTexturesSizeMap.end())
+	S32 idx = findHeaderIndex(id);
+	if(idx >= 0)
 	{
-		mTexturesSizeTotal -= mTexturesSizeMap[id] ;
-		mTexturesSizeMap.erase(id);
+		mTexturesSizeTotal -= getHeaderEntry(idx)->mBodySize ;
+		eraseHeaderIndex(id);
 	}
-	mHeaderIDMap.erase(id);
 	LLAPRFile::remove(getTextureFileName(id), getLocalAPRFilePool());		
 }
 
@@ -1862,8 +2118,8 @@ void LLTextureCache::removeEntry(S32 idx, Entry& entry, std::string& filename)
 	{
 		entry.mImageSize = -1;
 		entry.mBodySize = 0;
-		mHeaderIDMap.erase(entry.mID);
-		mTexturesSizeMap.erase(entry.mID);
+		eraseHeaderIndex(entry.mID);
+		mUpdatedTimeMap.erase(idx);
 
 		mTexturesSizeTotal -= entry.mBodySize;
 		mFreeList.insert(idx);	
@@ -27,6 +27,8 @@
 #ifndef LL_LLTEXTURECACHE_
 #define LL_LLTEXTURECACHE_H
 
+#include "apr_mmap.h"
+#include "llapr.h"
 #include "lldir.h"
 #include "llstl.h"
 #include "llstring.h"
@@ -151,14 +153,18 @@ private:
 	void clearCorruptedCache();
 	void purgeAllTextures(bool purge_directories);
 	void purgeTextures(bool validate);
-	LLAPRFile* openHeaderEntriesFile(bool readonly, S32 offset);
-	void closeHeaderEntriesFile();
+	// True while any read or write worker may be looking entries up
+	bool hasWorkers();
+	bool mapHeaderEntriesFile();
+	void unmapHeaderEntriesFile();
+	Entry* getHeaderEntry(S32 idx) { return (Entry*)(mHeaderEntriesData + sizeof(EntriesInfo)) + idx; }
+	bool writeHeaderEntriesData(S32 offset, S32 size);
 	void readEntriesHeader();
 	void writeEntriesHeader();
 	S32 openAndReadEntry(const LLUUID& id, Entry& entry, bool create);
 	bool updateEntry(S32& idx, Entry& entry, S32 new_image_size, S32 new_body_size);
 	void updateEntryTimeStamp(S32 idx, Entry& entry) ;
-	U32 openAndReadEntries(std::vector<Entry>& entries);
+	U32 openAndReadEntries();
 	void writeEntriesAndClose(const std::vector<Entry>& entries);
 	void readEntryFromHeaderImmediately(S32& idx, Entry& entry) ;
 	void writeEntryToHeaderImmediately(S32& idx, Entry& entry, bool write_header = false) ;
@@ -170,13 +176,33 @@ private:
 	void updatedHeaderEntriesFile() ;
 	void lockHeaders() { mHeaderMutex.lock(); }
 	void unlockHeaders() { mHeaderMutex.unlock(); }
+
+	// Index of the header entries by texture id
+	void initHeaderIndex(U32 max_entries);
+	void clearHeaderIndex();
+	S32 findHeaderIndex(const LLUUID& id);
+	S32 lookupHeaderIndex(const LLUUID& id);
+	S32 insertHeaderIndex(const LLUUID& id, S32 idx);
+	void setHeaderIndex(const LLUUID& id, S32 idx);
+	void eraseHeaderIndex(const LLUUID& id);
 	
 private:
 	// Internal
 	LLMutex mWorkersMutex;
 	LLMutex mHeaderMutex;
 	LLMutex mListMutex;
-	LLAPRFile* mHeaderAPRFile;
+
+	// texture.entries, memory mapped. When it can not be mapped, and in
+	// read only mode, mHeaderEntriesData is a copy of the file instead.
+	// Either way it is set up at its full capacity when the cache is
+	// opened and never moved or released while workers exist, see
+	// lookupHeaderIndex().
+	LLVolatileAPRPool* mHeaderEntriesPool;
+	LLAPRFile mHeaderEntriesFile;
+	apr_mmap_t* mHeaderEntriesMap;
+	std::vector<U8> mHeaderEntriesBuffer;
+	U8* mHeaderEntriesData;
+	U32 mHeaderEntriesCapacity; // entries there is room for in mHeaderEntriesData
 	
 	typedef std::map<handle_t, LLTextureCacheWorker*> handle_map_t;
 	handle_map_t mReaders;
@@ -196,18 +222,28 @@ private:
 	EntriesInfo mHeaderEntriesInfo;
 	std::set<S32> mFreeList; // deleted entries
 	std::set<LLUUID> mLRU;
-	typedef std::map<LLUUID,S32> id_map_t;
-	id_map_t mHeaderIDMap;
+
+	// Open addressed hash table with linear probing, from the texture id to
+	// the index of its entry. Only changed with mHeaderMutex locked, and
+	// mHeaderIndexSerial is odd while it is, so that lookupHeaderIndex()
+	// can probe it without taking the lock.
+	struct IndexSlot
+	{
+		U32 mHash;	// LLUUID::getCRC32() of the id
+		S32 mIndex;	// entry index, -1 if the slot is empty
+	};
+	std::vector<IndexSlot> mHeaderIndex;
+	U32 mHeaderIndexMask;
+	LLAtomicU32 mHeaderIndexSerial;
 
 	// BODIES (TEXTURES minus headers)
 	std::string mTexturesDirName;
-	typedef std::map<LLUUID,S32> size_map_t;
-	size_map_t mTexturesSizeMap;
 	S64 mTexturesSizeTotal;
 	LLAtomic32<BOOL> mDoPurge;
 
-	typedef std::map<S32, Entry> idx_entry_map_t;
-	idx_entry_map_t mUpdatedEntryMap;
+	// time stamps not written to the header entries yet, by entry index
+	typedef std::map<S32, U32> idx_time_map_t;
+	idx_time_map_t mUpdatedTimeMap;
 
 	// Statics
 	static F32 sHeaderCacheVersion;
@@ -35,6 +35,7 @@
 #include "llcurl.h"
 #include "lldir.h"
 #include "llhttpclient.h"
+#include "llhttprangefetcher.h"
 #include "llhttpstatuscodes.h"
 #include "llimage.h"
 #include "llimagej2c.h"
@@ -861,9 +862,10 @@ bool LLTextureFetchWorker::doWork(S32 param)
 			//control the number of the http requests issued for:
 			//1, not openning too many file descriptors at the same time;
 			//2, control the traffic of http so udp gets bandwidth.
+			//mHTTPFetcher only keeps its window in flight, this keeps a few
+			//more queued behind it so a freed slot is filled at once.
 			//
-			static const S32 MAX_NUM_OF_HTTP_REQUESTS_IN_QUEUE = 32 ;
-			if(mFetcher->getNumHTTPRequests() > MAX_NUM_OF_HTTP_REQUESTS_IN_QUEUE)
+			if(mFetcher->getNumHTTPRequests() > mFetcher->getMaxHTTPRequests())
 			{
 				return false ; //wait.
 			}
@@ -895,7 +897,6 @@ bool LLTextureFetchWorker::doWork(S32 param)
 			S32 offset = cur_size;
 			mBufferSize = cur_size; // This will get modified by callbackHttpGet()
 			
-			bool res = false;
 			if (!mUrl.empty())
 			{
 				mLoaded = FALSE;
@@ -912,12 +913,12 @@ bool LLTextureFetchWorker::doWork(S32 param)
 				// Will call callbackHttpGet when curl request completes
 				std::vector<std::string> headers;
 				headers.push_back("Accept: image/x-j2c");
-				res = mFetcher->mCurlGetRequest->getByteRange(mUrl, headers, offset, mRequestedSize,
-															  new HTTPGetResponder(mFetcher, mID, LLTimer::getTotalTime(), mRequestedSize, offset, true));
+				mFetcher->mHTTPFetcher->getByteRange(mUrl, headers, offset, mRequestedSize,
+													 new HTTPGetResponder(mFetcher, mID, LLTimer::getTotalTime(), mRequestedSize, offset, true));
 			}
-			if (!res)
+			else
 			{
-				LL_DEBUGS("TextureFetchWorker") << "HTTP GET request failed for " << mID << llendl;
+				LL_DEBUGS("TextureFetchWorker") << "HTTP GET request failed, no url for " << mID << llendl;
 				resetFormattedData();
 				++mHTTPFailCount;
 				return true; // failed
@@ -1048,6 +1049,20 @@ bool LLTextureFetchWorker::doWork(S32 param)
 		}
 		else
 		{
+			if (mDesiredDiscard < mRequestedDiscard && mRequestedSize > 0
+				&& mDesiredSize > mBufferSize + mRequestedSize)
+			{
+				// We want more of the image than we asked for. While the
+				// request is still queued, ask for the rest in the same
+				// transfer rather than fetching it after this one decodes.
+				if (mFetcher->mHTTPFetcher->extendByteRange(mUrl, mBufferSize, mDesiredSize - mBufferSize))
+				{
+					LL_DEBUGS("TextureFetchWorker") << "HTTP GET extended: " << mID << " Offset: " << mBufferSize
+													<< " Bytes: " << mRequestedSize << " -> " << mDesiredSize - mBufferSize << LL_ENDL;
+					mRequestedSize = mDesiredSize - mBufferSize;
+					mRequestedDiscard = mDesiredDiscard;
+				}
+			}
 			setPriority(LLWorkerThread::PRIORITY_LOW | mWorkPriority);
 			return false;
 		}
@@ -1523,8 +1538,14 @@ bool LLTextureFetchWorker::writeToCacheComplete()
 //////////////////////////////////////////////////////////////////////////////
 // public
 
+// The fewest HTTP requests the adaptive window keeps in flight
+static const U32 HTTP_MIN_WINDOW = 2;
+// Most time a frame spends handing finished HTTP responses to their workers
+// when the fetcher runs on the main thread and its transfers on their own
+static const U32 HTTP_PROCESS_TIME_MS = 2;
+
 LLTextureFetch::LLTextureFetch(LLTextureCache* cache, LLImageDecodeThread* imagedecodethread, bool threaded)
-	: LLWorkerThread("TextureFetch", threaded),
+	: LLWorkerThread("TextureFetch", threaded, 1), // mHTTPFetcher is not thread safe
 	  mDebugCount(0),
 	  mDebugPause(FALSE),
 	  mPacketCount(0),
@@ -1535,9 +1556,12 @@ LLTextureFetch::LLTextureFetch(LLTextureCache* cache, LLImageDecodeThread* image
 	  mImageDecodeThread(imagedecodethread),
 	  mTextureBandwidth(0),
 	  mHTTPTextureBits(0),
-	  mCurlGetRequest(NULL)
+	  mHTTPFetcher(NULL)
 {
 	mMaxBandwidth = gSavedSettings.getF32("ThrottleBandwidthKBPS");
+	mMaxHTTPWindow = llmax(gSavedSettings.getU32("TextureFetchHTTPMaxRequests"), 1U);
+	mHTTPPipelining = gSavedSettings.getBOOL("TextureFetchHTTPPipelining");
+	mHTTPThreaded = gSavedSettings.getBOOL("TextureFetchHTTPThread");
 	mTextureInfo.setUpLogging(gSavedSettings.getBOOL("LogTextureDownloadsToViewerLog"), gSavedSettings.getBOOL("LogTextureDownloadsToSimulator"), gSavedSettings.getU32("TextureLoggingThreshold"));
 }
 
@@ -1740,6 +1764,13 @@ S32 LLTextureFetch::getNumHTTPRequests()
 	return size ;
 }
 
+// WORKER THREAD
+S32 LLTextureFetch::getMaxHTTPRequests()
+{
+	// the window in flight and as many again queued behind it
+	return (S32)mHTTPFetcher->getWindow().getWindow() * 2;
+}
+
 // call lockQueue() first!
 LLTextureFetchWorker* LLTextureFetch::getWorkerAfterLock(const LLUUID& id)
 {
@@ -1853,8 +1884,8 @@ S32 LLTextureFetch::update(U32 max_time_ms)
 
 	if (!mThreaded)
 	{
-		// Update Curl on same thread as mCurlGetRequest was constructed
-		S32 processed = mCurlGetRequest->process();
+		// Update Curl on same thread as mHTTPFetcher was constructed
+		S32 processed = mHTTPFetcher->process(HTTP_PROCESS_TIME_MS);
 		if (processed > 0)
 		{
 			LL_DEBUGS("TextureFetch") << "processed: " << processed << " messages." << llendl;
@@ -1887,22 +1918,22 @@ void LLTextureFetch::shutDownImageDecodeThread()
 // WORKER THREAD
 void LLTextureFetch::startThread()
 {
-	// Construct mCurlGetRequest from Worker Thread
-	mCurlGetRequest = new LLCurlRequest();
+	// Construct mHTTPFetcher from Worker Thread
+	mHTTPFetcher = new LLHTTPRangeFetcher(HTTP_MIN_WINDOW, mMaxHTTPWindow, mHTTPPipelining, mHTTPThreaded);
 }
 
 // WORKER THREAD
 void LLTextureFetch::endThread()
 {
-	// Destroy mCurlGetRequest from Worker Thread
-	delete mCurlGetRequest;
-	mCurlGetRequest = NULL;
+	// Destroy mHTTPFetcher from Worker Thread
+	delete mHTTPFetcher;
+	mHTTPFetcher = NULL;
 }
 
 // WORKER THREAD
 void LLTextureFetch::threadedUpdate()
 {
-	llassert_always(mCurlGetRequest);
+	llassert_always(mHTTPFetcher);
 	
 	// Limit update frequency
 	const F32 PROCESS_TIME = 0.05f; 
@@ -1913,8 +1944,8 @@ void LLTextureFetch::threadedUpdate()
 	}
 	process_timer.reset();
 	
-	// Update Curl on same thread as mCurlGetRequest was constructed
-	S32 processed = mCurlGetRequest->process();
+	// Update Curl on same thread as mHTTPFetcher was constructed
+	S32 processed = mHTTPFetcher->process();
 	if (processed > 0)
 	{
 		LL_DEBUGS("TextureFetch") << "processed: " << processed << " messages." << llendl;
@@ -1925,7 +1956,7 @@ void LLTextureFetch::threadedUpdate()
 	static LLFrameTimer info_timer;
 	if (info_timer.getElapsedTimeF32() >= INFO_TIME)
 	{
-		S32 q = mCurlGetRequest->getQueued();
+		S32 q = mHTTPFetcher->getQueued();
 		if (q > 0)
 		{
 			LL_DEBUGS("TextureFetchWorker") << "Queued gets: " << q << llendl;
@@ -2366,5 +2397,17 @@ void LLTextureFetch::dump()
 				<< " STATE: " << worker->sStateDescs[worker->mState]
 				<< llendl;
 	}
+
+	if (mHTTPFetcher)
+	{
+		const LLHTTPConcurrencyWindow& window = mHTTPFetcher->getWindow();
+		llinfos << "LLTextureFetch HTTP: window " << window.getWindow()
+				<< " in flight " << mHTTPFetcher->getInFlight()
+				<< " queued " << mHTTPFetcher->getQueued()
+				<< " extended " << mHTTPFetcher->getCoalesced()
+				<< llformat(" latency %.3fs base %.3fs", window.getLatency(), window.getBaseLatency())
+				<< llformat(" throughput %.1fKB/s", window.getThroughput() / 1024.0)
+				<< llendl;
+	}
 }
 
@@ -40,6 +40,7 @@ class HTTPGetResponder;
 class LLTextureCache;
 class LLImageDecodeThread;
 class LLHost;
+class LLHTTPRangeFetcher;
 
 // Interface class
 class LLTextureFetch : public LLWorkerThread
@@ -75,6 +76,7 @@ public:
 	void dump();
 	S32 getNumRequests() ;
 	S32 getNumHTTPRequests() ;
+	S32 getMaxHTTPRequests() ;
 	
 	// Public for access by callbacks
 	void lockQueue() { mQueueMutex.lock(); }
@@ -112,7 +114,10 @@ private:
 
 	LLTextureCache* mTextureCache;
 	LLImageDecodeThread* mImageDecodeThread;
-	LLCurlRequest* mCurlGetRequest;
+	LLHTTPRangeFetcher* mHTTPFetcher;
+	U32 mMaxHTTPWindow;
+	bool mHTTPPipelining;
+	bool mHTTPThreaded;
 	
 	// Map of all requests by UUID
 	typedef std::map<LLUUID,LLTextureFetchWorker*> map_t;
@@ -658,6 +658,7 @@ void display(BOOL rebuild, F32 zoom_factor, int subfield, BOOL for_snapshot)
 			{
  				LLFastTimer ftm(FTM_CLIENT_COPY);
 				LLVertexBuffer::clientCopy(0.016);
+				LLVertexBuffer::sClientArena.endFrame();
 			}
 
 			if (gResizeScreenTexture)
@@ -454,6 +454,16 @@ void LLViewerJoint::updateJointGeometry()
 	}
 }
 
+void LLViewerJoint::collectSkinnedMeshes(std::vector<LLViewerJointMesh*>& meshes)
+{
+	for (child_list_t::iterator iter = mChildren.begin();
+		 iter != mChildren.end(); ++iter)
+	{
+		LLViewerJoint* joint = (LLViewerJoint*)(*iter);
+		joint->collectSkinnedMeshes(meshes);
+	}
+}
+
 
 BOOL LLViewerJoint::updateLOD(F32 pixel_area, BOOL activate)
 {
@@ -68,59 +68,6 @@ static const U32 sRenderMask = LLVertexBuffer::MAP_VERTEX |
 							   LLVertexBuffer::MAP_TEXCOORD0;
 
 
-//-----------------------------------------------------------------------------
-//-----------------------------------------------------------------------------
-// LLViewerJointMesh::LLSkinJoint
-//-----------------------------------------------------------------------------
-//-----------------------------------------------------------------------------
-
-//-----------------------------------------------------------------------------
-// LLSkinJoint
-//-----------------------------------------------------------------------------
-LLSkinJoint::LLSkinJoint()
-{
-	mJoint       = NULL;
-}
-
-//-----------------------------------------------------------------------------
-// ~LLSkinJoint
-//-----------------------------------------------------------------------------
-LLSkinJoint::~LLSkinJoint()
-{
-	mJoint = NULL;
-}
-
-
-//-----------------------------------------------------------------------------
-// LLSkinJoint::setupSkinJoint()
-//-----------------------------------------------------------------------------
-BOOL LLSkinJoint::setupSkinJoint( LLViewerJoint *joint)
-{
-	// find the named joint
-	mJoint = joint;
-	if ( !mJoint )
-	{
-		llinfos << "Can't find joint" << llendl;
-	}
-
-	// compute the inverse root skin matrix
-	mRootToJointSkinOffset.clearVec();
-
-	LLVector3 rootSkinOffset;
-	while (joint)
-	{
-		rootSkinOffset += joint->getSkinOffset();
-		joint = (LLViewerJoint*)joint->getParent();
-	}
-
-	mRootToJointSkinOffset = -rootSkinOffset;
-	mRootToParentJointSkinOffset = mRootToJointSkinOffset;
-	mRootToParentJointSkinOffset += mJoint->getSkinOffset();
-
-	return TRUE;
-}
-
-
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
 // LLViewerJointMesh
@@ -340,7 +287,7 @@ void LLViewerJointMesh::setupJoint(LLViewerJoint* current_joint)
 		if(mMesh->mJointRenderData.count() && mMesh->mJointRenderData[mMesh->mJointRenderData.count() - 1]->mWorldMatrix == &current_joint->getParent()->getWorldMatrix())
 		{
 			// ...then just add ourselves
-			LLViewerJoint* jointp = js.mJoint;
+			LLViewerJoint* jointp = (LLViewerJoint*)js.mJoint;
 			mMesh->mJointRenderData.put(new LLJointRenderData(&jointp->getWorldMatrix(), &js));
 //			llinfos << "joint " << joint_count << js.mJoint->getName() << llendl;
 //			joint_count++;
@@ -376,7 +323,6 @@ const S32 NUM_AXES = 3;
 
 static LLMatrix4	gJointMatUnaligned[32];
 static LLMatrix3	gJointRotUnaligned[32];
-static LLVector4	gJointPivot[32];
 
 //-----------------------------------------------------------------------------
 // uploadJointMatrices()
@@ -388,56 +334,8 @@ void LLViewerJointMesh::uploadJointMatrices()
 	LLDrawPool *poolp = mFace ? mFace->getPool() : NULL;
 	BOOL hardware_skinning = (poolp && poolp->getVertexShaderLevel() > 0) ? TRUE : FALSE;
 
-	//calculate joint matrices
-	for (joint_num = 0; joint_num < reference_mesh->mJointRenderData.count(); joint_num++)
-	{
-		LLMatrix4 joint_mat = *reference_mesh->mJointRenderData[joint_num]->mWorldMatrix;
-
-		if (hardware_skinning)
-		{
-			joint_mat *= LLDrawPoolAvatar::getModelView();
-		}
-		gJointMatUnaligned[joint_num] = joint_mat;
-		gJointRotUnaligned[joint_num] = joint_mat.getMat3();
-	}
-
-	BOOL last_pivot_uploaded = FALSE;
-	S32 j = 0;
-
-	//upload joint pivots
-	for (joint_num = 0; joint_num < reference_mesh->mJointRenderData.count(); joint_num++)
-	{
-		LLSkinJoint *sj = reference_mesh->mJointRenderData[joint_num]->mSkinJoint;
-		if (sj)
-		{
-			if (!last_pivot_uploaded)
-			{
-				LLVector4 parent_pivot(sj->mRootToParentJointSkinOffset);
-				parent_pivot.mV[VW] = 0.f;
-				gJointPivot[j++] = parent_pivot;
-			}
-
-			LLVector4 child_pivot(sj->mRootToJointSkinOffset);
-			child_pivot.mV[VW] = 0.f;
-
-			gJointPivot[j++] = child_pivot;
-
-			last_pivot_uploaded = TRUE;
-		}
-		else
-		{
-			last_pivot_uploaded = FALSE;
-		}
-	}
-
-	//add pivot point into transform
-	for (S32 i = 0; i < j; i++)
-	{
-		LLVector3 pivot;
-		pivot = LLVector3(gJointPivot[i]);
-		pivot = pivot * gJointRotUnaligned[i];
-		gJointMatUnaligned[i].translate(pivot);
-	}
+	get_skin_joint_matrices(reference_mesh->mJointRenderData, hardware_skinning ? &LLDrawPoolAvatar::getModelView() : NULL,
+							gJointMatUnaligned, gJointRotUnaligned);
 
 	// upload matrices
 	if (hardware_skinning)
@@ -785,6 +683,10 @@ BOOL LLViewerJointMesh::updateLOD(F32 pixel_area, BOOL activate)
 // static
 void LLViewerJointMesh::updateGeometryOriginal(LLFace *mFace, LLPolyMesh *mMesh)
 {
+	LLMatrix4 joint_mat[32];
+	LLMatrix3 joint_rot[32];
+	get_skin_joint_matrices(mMesh->getReferenceMesh()->mJointRenderData, NULL, joint_mat, joint_rot);
+
 	LLStrider<LLVector3> o_vertices;
 	LLStrider<LLVector3> o_normals;
 
@@ -825,9 +727,9 @@ void LLViewerJointMesh::updateGeometryOriginal(LLFace *mFace, LLPolyMesh *mMesh)
 		// No lerp required in this case.
 		if (w == 1.0f)
 		{
-			gBlendMat = gJointMatUnaligned[joint+1];
+			gBlendMat = joint_mat[joint+1];
 			o_vertices[bidx] = coords[index] * gBlendMat;
-			gBlendRotMat = gJointRotUnaligned[joint+1];
+			gBlendRotMat = joint_rot[joint+1];
 			o_normals[bidx] = normals[index] * gBlendRotMat;
 			continue;
 		}
@@ -835,8 +737,8 @@ void LLViewerJointMesh::updateGeometryOriginal(LLFace *mFace, LLPolyMesh *mMesh)
 		// Try to keep all the accesses to the matrix data as close
 		// together as possible.  This function is a hot spot on the
 		// Mac. JC
-		LLMatrix4 &m0 = gJointMatUnaligned[joint+1];
-		LLMatrix4 &m1 = gJointMatUnaligned[joint+0];
+		LLMatrix4 &m0 = joint_mat[joint+1];
+		LLMatrix4 &m1 = joint_mat[joint+0];
 		
 		gBlendMat.mMatrix[VX][VX] = lerp(m1.mMatrix[VX][VX], m0.mMatrix[VX][VX], w);
 		gBlendMat.mMatrix[VX][VY] = lerp(m1.mMatrix[VX][VY], m0.mMatrix[VX][VY], w);
@@ -856,8 +758,8 @@ void LLViewerJointMesh::updateGeometryOriginal(LLFace *mFace, LLPolyMesh *mMesh)
 
 		o_vertices[bidx] = coords[index] * gBlendMat;
 		
-		LLMatrix3 &n0 = gJointRotUnaligned[joint+1];
-		LLMatrix3 &n1 = gJointRotUnaligned[joint+0];
+		LLMatrix3 &n0 = joint_rot[joint+1];
+		LLMatrix3 &n1 = joint_rot[joint+0];
 		
 		gBlendRotMat.mMatrix[VX][VX] = lerp(n1.mMatrix[VX][VX], n0.mMatrix[VX][VX], w);
 		gBlendRotMat.mMatrix[VX][VY] = lerp(n1.mMatrix[VX][VY], n0.mMatrix[VX][VY], w);
@@ -874,7 +776,7 @@ void LLViewerJointMesh::updateGeometryOriginal(LLFace *mFace, LLPolyMesh *mMesh)
 		o_normals[bidx] = normals[index] * gBlendRotMat;
 	}
 
-	buffer->setBuffer(0);
+	//setBuffer(0) called in LLVOAvatar::renderSkinned
 }
 
 const U32 UPDATE_GEOMETRY_CALL_MASK			= 0x1FFF; // 8K samples before overflow
@@ -934,14 +836,43 @@ void LLViewerJointMesh::updateVectorize()
 	}
 }
 
+//static
+bool LLViewerJointMesh::isTimingSkinning()
+{
+	return sVectorizePerfTest;
+}
+
+BOOL LLViewerJointMesh::isSoftwareSkinned() const
+{
+	return mValid
+		&& mMesh
+		&& mFace
+		&& mMesh->hasWeights()
+		&& mFace->mVertexBuffer.notNull()
+		&& LLViewerShaderMgr::instance()->getVertexShaderLevel(LLViewerShaderMgr::SHADER_AVATAR) == 0;
+}
+
+void LLViewerJointMesh::collectSkinnedMeshes(std::vector<LLViewerJointMesh*>& meshes)
+{
+	if (isSoftwareSkinned())
+	{
+		meshes.push_back(this);
+	}
+}
+
+U32 LLViewerJointMesh::getNumSkinnedVertices() const
+{
+	return mMesh->getNumVertices();
+}
+
+void LLViewerJointMesh::skinJointGeometry()
+{
+	sUpdateGeometryFunc(mFace, mMesh);
+}
+
 void LLViewerJointMesh::updateJointGeometry()
 {
-	if (!(mValid
-		  && mMesh
-		  && mFace
-		  && mMesh->hasWeights()
-		  && mFace->mVertexBuffer.notNull()
-		  && LLViewerShaderMgr::instance()->getVertexShaderLevel(LLViewerShaderMgr::SHADER_AVATAR) == 0))
+	if (!isSoftwareSkinned())
 	{
 		return;
 	}
@@ -950,9 +881,7 @@ void LLViewerJointMesh::updateJointGeometry()
 	{
 		// Once we've measured performance, just run the specified
 		// code version.
-		if(sUpdateGeometryFunc == updateGeometryOriginal)
-			uploadJointMatrices();
-		sUpdateGeometryFunc(mFace, mMesh);
+		skinJointGeometry();
 	}
 	else
 	{
@@ -962,14 +891,11 @@ void LLViewerJointMesh::updateJointGeometry()
 		
 		if (sUpdateGeometryCallPointer)
 		{
-			if(sUpdateGeometryFunc == updateGeometryOriginal)
-				uploadJointMatrices();
 			// call accelerated version for this processor
 			sUpdateGeometryFunc(mFace, mMesh);
 		}
 		else
 		{
-			uploadJointMatrices();
 			updateGeometryOriginal(mFace, mMesh);
 		}
 	
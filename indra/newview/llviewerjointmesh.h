@@ -27,6 +27,7 @@
 #ifndef LL_LLVIEWERJOINTMESH_H
 #define LL_LLVIEWERJOINTMESH_H
 
+#include "llavatarskin.h"
 #include "llviewerjoint.h"
 #include "llviewertexture.h"
 #include "llpolymesh.h"
@@ -44,22 +45,10 @@ typedef enum e_avatar_render_pass
 	AVATAR_RENDER_PASS_CLOTHING_OUTER
 } EAvatarRenderPass;
 
-class LLSkinJoint
-{
-public:
-	LLSkinJoint();
-	~LLSkinJoint();
-	BOOL setupSkinJoint( LLViewerJoint *joint);
-
-	LLViewerJoint	*mJoint;
-	LLVector3		mRootToJointSkinOffset;
-	LLVector3		mRootToParentJointSkinOffset;
-};
-
 //-----------------------------------------------------------------------------
 // class LLViewerJointMesh
 //-----------------------------------------------------------------------------
-class LLViewerJointMesh : public LLViewerJoint
+class LLViewerJointMesh : public LLViewerJoint, public LLSkinnedMesh
 {
 protected:
 	LLColor4					mColor;			// color value
@@ -137,13 +126,27 @@ public:
 	/*virtual*/ void updateFaceData(LLFace *face, F32 pixel_area, BOOL damp_wind = FALSE, bool terse_update = false);
 	/*virtual*/ BOOL updateLOD(F32 pixel_area, BOOL activate);
 	/*virtual*/ void updateJointGeometry();
+	/*virtual*/ void collectSkinnedMeshes(std::vector<LLViewerJointMesh*>& meshes);
 	/*virtual*/ void dump();
 
+	// True when updateJointGeometry() skins this mesh on the CPU
+	BOOL isSoftwareSkinned() const;
+
+	// Skins the mesh into its face's vertex buffer, which the caller has
+	// already mapped and unmaps afterwards.  Only reads the joints' world
+	// matrices, so meshes can be skinned on several threads at once.
+	/*virtual*/ U32 getNumSkinnedVertices() const;
+	/*virtual*/ void skinJointGeometry();
+
 	void setIsTransparent(BOOL is_transparent) { mIsTransparent = is_transparent; }
 
 	/*virtual*/ BOOL isAnimatable() const { return FALSE; }
 	
 	static void updateVectorize(); // Update globals when settings variables change
+
+	// While VectorizePerfTest times the skinning functions against each
+	// other, skinning has to go through updateJointGeometry().
+	static bool isTimingSkinning();
 	
 private:
 	// Avatar vertex skinning is a significant performance issue on computers
@@ -63,15 +63,15 @@ inline void matrix_translate(LLV4Matrix4& m, const LLMatrix4* w, const LLVector3
 // static
 void LLViewerJointMesh::updateGeometrySSE(LLFace *face, LLPolyMesh *mesh)
 {
-	// This cannot be a file-level static because it will be initialized
-	// before main() using SSE code, which will crash on non-SSE processors.
-	static LLV4Matrix4	sJointMat[32];
+	// Not a static: meshes are skinned on several threads at once (see
+	// LLAvatarSkinThread).
+	LLV4Matrix4			joint_mat[32];
 	LLDynamicArray<LLJointRenderData*>& joint_data = mesh->getReferenceMesh()->mJointRenderData;
 
 	//upload joint pivots/matrices
 	for(S32 j = 0, jend = joint_data.count(); j < jend ; ++j )
 	{
-		matrix_translate(sJointMat[j], joint_data[j]->mWorldMatrix,
+		matrix_translate(joint_mat[j], joint_data[j]->mWorldMatrix,
 			joint_data[j]->mSkinJoint ?
 				joint_data[j]->mSkinJoint->mRootToJointSkinOffset
 				: joint_data[j+1]->mSkinJoint->mRootToParentJointSkinOffset);
@@ -95,13 +95,13 @@ void LLViewerJointMesh::updateGeometrySSE(LLFace *face, LLPolyMesh *mesh)
 		if( weight != weights[index])
 		{
 			S32 joint = llfloor(weight = weights[index]);
-			blend_mat.lerp(sJointMat[joint], sJointMat[joint+1], weight - joint);
+			blend_mat.lerp(joint_mat[joint], joint_mat[joint+1], weight - joint);
 		}
 		blend_mat.multiply(coords[index], o_vertices[index]);
 		((LLV4Matrix3)blend_mat).multiply(normals[index], o_normals[index]);
 	}
 
-	buffer->setBuffer(0);
+	//setBuffer(0) called in LLVOAvatar::renderSkinned
 }
 
 #else
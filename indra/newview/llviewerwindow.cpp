@@ -446,6 +446,11 @@ public:
 			addText(xpos, ypos, llformat("%d MB Vertex Data", LLVertexBuffer::sAllocatedBytes/(1024*1024)));
 			ypos += y_inc;
 
+			const LLVertexBufferArena::Stats& arena = LLVertexBuffer::sClientArena.getStats();
+			addText(xpos, ypos, llformat("%d KB Client Vertex Data, %d KB Cached, %.0f%% Fragmented",
+				arena.mInUseBytes/1024, arena.mCachedBytes/1024, arena.getFragmentation()*100.f));
+			ypos += y_inc;
+
 			addText(xpos, ypos, llformat("%d Vertex Buffers", LLVertexBuffer::sGLCount));
 			ypos += y_inc;
 
@@ -622,6 +622,7 @@ BOOL LLVOAvatar::sVisibleInFirstPerson = FALSE;
 F32 LLVOAvatar::sLODFactor = 1.f;
 BOOL LLVOAvatar::sUseImpostors = FALSE;
 BOOL LLVOAvatar::sJointDebug = FALSE;
+LLAvatarSkinThread* LLVOAvatar::sSkinThread = NULL;
 
 F32 LLVOAvatar::sUnbakedTime = 0.f;
 F32 LLVOAvatar::sUnbakedUpdateTime = 0.f;
@@ -3934,6 +3935,92 @@ bool LLVOAvatar::shouldAlphaMask()
 
 }
 
+//-----------------------------------------------------------------------------
+// getSkinnedMeshes()
+//-----------------------------------------------------------------------------
+void LLVOAvatar::getSkinnedMeshes(std::vector<LLViewerJointMesh*>& meshes)
+{
+	mMeshLOD[MESH_ID_LOWER_BODY]->collectSkinnedMeshes(meshes);
+	mMeshLOD[MESH_ID_UPPER_BODY]->collectSkinnedMeshes(meshes);
+
+	if( isWearingWearableType( LLWearableType::WT_SKIRT ) )
+	{
+		mMeshLOD[MESH_ID_SKIRT]->collectSkinnedMeshes(meshes);
+	}
+
+	if (!isSelf() || gAgent.needsRenderHead() || LLPipeline::sShadowRender)
+	{
+		mMeshLOD[MESH_ID_EYELASH]->collectSkinnedMeshes(meshes);
+		mMeshLOD[MESH_ID_HEAD]->collectSkinnedMeshes(meshes);
+		mMeshLOD[MESH_ID_HAIR]->collectSkinnedMeshes(meshes);
+	}
+}
+
+static LLFastTimer::DeclareTimer FTM_SKIN_AVATARS("Skin Avatars");
+
+//static
+void LLVOAvatar::skinVisibleAvatars()
+{
+	if (!sSkinThread
+		|| LLViewerShaderMgr::instance()->getVertexShaderLevel(LLViewerShaderMgr::SHADER_AVATAR) > 0
+		|| LLViewerJointMesh::isTimingSkinning())
+	{
+		return;
+	}
+
+	LLFastTimer t(FTM_SKIN_AVATARS);
+
+	// The joints' world matrices were brought up to date by updateCharacter()
+	// during idle, so every mesh can be skinned at once.
+	std::vector<LLVOAvatar*> skinned;
+	std::vector<LLViewerJointMesh*> meshes;
+	std::vector<LLSkinnedMesh*> skin_meshes;
+	for (std::vector<LLCharacter*>::iterator iter = LLCharacter::sInstances.begin();
+		 iter != LLCharacter::sInstances.end(); ++iter)
+	{
+		LLVOAvatar* avatar = (LLVOAvatar*) *iter;
+		if (avatar->isDead()
+			|| !avatar->mIsBuilt
+			|| !avatar->mNeedsSkin
+			|| avatar->mDrawable.isNull()
+			|| !avatar->mDrawable->isVisible()
+			|| avatar->isImpostor()
+			|| !avatar->isFullyLoaded())
+		{
+			continue;
+		}
+
+		LLFace* face = avatar->mDrawable->getFace(0);
+		if (!face
+			|| face->mVertexBuffer.isNull()
+			|| avatar->mDirtyMesh
+			|| avatar->mDrawable->isState(LLDrawable::REBUILD_GEOMETRY))
+		{
+			continue;
+		}
+
+		avatar->getSkinnedMeshes(meshes);
+		if (!meshes.empty())
+		{
+			// map on the main thread, the workers only write through it
+			face->mVertexBuffer->mapBuffer();
+			skin_meshes.assign(meshes.begin(), meshes.end());
+			meshes.clear();
+			sSkinThread->queueSkin(skin_meshes);
+			skinned.push_back(avatar);
+		}
+	}
+
+	sSkinThread->finishBatch();
+
+	for (std::vector<LLVOAvatar*>::iterator iter = skinned.begin(); iter != skinned.end(); ++iter)
+	{
+		LLVOAvatar* avatar = *iter;
+		avatar->mNeedsSkin = FALSE;
+		avatar->mDrawable->getFace(0)->mVertexBuffer->setBuffer(0);
+	}
+}
+
 //-----------------------------------------------------------------------------
 // renderSkinned()
 //-----------------------------------------------------------------------------
@@ -3966,19 +4053,11 @@ U32 LLVOAvatar::renderSkinned(EAvatarRenderPass pass)
 		if (mNeedsSkin)
 		{
 			//generate animated mesh
-			mMeshLOD[MESH_ID_LOWER_BODY]->updateJointGeometry();
-			mMeshLOD[MESH_ID_UPPER_BODY]->updateJointGeometry();
-
-			if( isWearingWearableType( LLWearableType::WT_SKIRT ) )
-			{
-				mMeshLOD[MESH_ID_SKIRT]->updateJointGeometry();
-			}
-
-			if (!isSelf() || gAgent.needsRenderHead() || LLPipeline::sShadowRender)
+			std::vector<LLViewerJointMesh*> meshes;
+			getSkinnedMeshes(meshes);
+			for (std::vector<LLViewerJointMesh*>::iterator iter = meshes.begin(); iter != meshes.end(); ++iter)
 			{
-				mMeshLOD[MESH_ID_EYELASH]->updateJointGeometry();
-				mMeshLOD[MESH_ID_HEAD]->updateJointGeometry();
-				mMeshLOD[MESH_ID_HAIR]->updateJointGeometry();
+				(*iter)->updateJointGeometry();
 			}
 			mNeedsSkin = FALSE;
 			
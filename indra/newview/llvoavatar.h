@@ -353,6 +353,11 @@ public:
 	U32 		renderRigid();
 	U32 		renderSkinned(EAvatarRenderPass pass);
 	U32 		renderTransparent(BOOL first_pass);
+	// Skins every visible avatar that renderSkinned() would skin on the CPU
+	// this frame, on sSkinThread.  Avatars that need their mesh data
+	// rebuilt first are left to renderSkinned().
+	static void	skinVisibleAvatars();
+	static LLAvatarSkinThread* sSkinThread; // owned by LLPipeline, NULL to skin in renderSkinned()
 	void 		renderCollisionVolumes();
 	static void	deleteCachedImages(bool clearAll=true);
 	static void	destroyGL();
@@ -361,6 +366,7 @@ public:
 	S32			mSpecialRenderMode; // special lighting
 private:
 	bool		shouldAlphaMask();
+	void		getSkinnedMeshes(std::vector<LLViewerJointMesh*>& meshes);
 
 	BOOL 		mNeedsSkin; // avatar has been animated and verts have not been updated
 	S32	 		mUpdatePeriod;
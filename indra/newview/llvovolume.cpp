@@ -945,7 +945,11 @@ BOOL LLVOVolume::setVolume(const LLVolumeParams &volume_params, const S32 detail
 		}
 	}
 	
-	if ((LLPrimitive::setVolume(volume_params, mLOD, (mVolumeImpl && mVolumeImpl->isVolumeUnique()))) || mSculptChanged)
+	// A new shared volume is built on the volume manager's build thread, the
+	// object draws nothing until updateGeometry() swaps it in.
+	bool unique = (mVolumeImpl && mVolumeImpl->isVolumeUnique());
+	bool allow_placeholder = !unique && (getVolume() == NULL || getVolume()->isPlaceholder());
+	if ((LLPrimitive::setVolume(volume_params, mLOD, unique, allow_placeholder)) || mSculptChanged)
 	{
 		mFaceMappingChanged = TRUE;
 		
@@ -1460,13 +1464,22 @@ BOOL LLVOVolume::updateGeometry(LLDrawable *drawable)
 			genBBoxes(FALSE);
 		}
 	}
-	else if ((mLODChanged) || (mSculptChanged))
+	else if ((mLODChanged) || (mSculptChanged) || getVolume()->isPlaceholder())
 	{
+		if (!mSculptChanged && !getVolumeManager()->prepareVolume(getVolume()->getParams(), mLOD))
+		{
+			// The new LOD is being built off the main thread, keep drawing
+			// this one and try again on the next rebuild.
+			return FALSE;
+		}
+
 		LLVolume *old_volumep, *new_volumep;
 		F32 old_lod, new_lod;
 		S32 old_num_faces, new_num_faces ;
+		BOOL was_placeholder;
 
 		old_volumep = getVolume();
+		was_placeholder = old_volumep->isPlaceholder();
 		old_lod = old_volumep->getDetail();
 		old_num_faces = old_volumep->getNumFaces() ;
 		old_volumep = NULL ;
@@ -1482,7 +1495,7 @@ BOOL LLVOVolume::updateGeometry(LLDrawable *drawable)
 		new_num_faces = new_volumep->getNumFaces() ;
 		new_volumep = NULL ;
 
-		if ((new_lod != old_lod) || mSculptChanged)
+		if ((new_lod != old_lod) || mSculptChanged || was_placeholder)
 		{
 			compiled = TRUE;
 			sNumLODChanges += new_num_faces ;
@@ -1491,7 +1504,7 @@ BOOL LLVOVolume::updateGeometry(LLDrawable *drawable)
 
 			{
 				LLFastTimer t(FTM_GEN_TRIANGLES);
-				if (new_num_faces != old_num_faces)
+				if (new_num_faces != old_num_faces || was_placeholder)
 				{
 					regenFaces();
 				}
@@ -1521,6 +1534,12 @@ BOOL LLVOVolume::updateGeometry(LLDrawable *drawable)
 	mSculptChanged = FALSE;
 	mFaceMappingChanged = FALSE;
 
+	if (getVolume()->isPlaceholder())
+	{
+		// stay in the rebuild queue until the build thread is done with it
+		return FALSE;
+	}
+
 	return LLViewerObject::updateGeometry(drawable);
 }
 
@@ -1536,11 +1555,11 @@ void LLVOVolume::updateFaceSize(S32 idx)
 		const LLVolumeFace& vol_face = getVolume()->getVolumeFace(idx);
 		if (LLPipeline::sUseTriStrips)
 		{
-			facep->setSize(vol_face.mVertices.size(), vol_face.mTriStrip.size());
+			facep->setSize(vol_face.getNumVertices(), vol_face.mTriStrip.size());
 		}
 		else
 		{
-			facep->setSize(vol_face.mVertices.size(), vol_face.mIndices.size());
+			facep->setSize(vol_face.getNumVertices(), vol_face.mIndices.size());
 		}
 	}
 }
@@ -1801,9 +1820,9 @@ LLVector3 LLVOVolume::getApproximateFaceNormal(U8 face_id)
 	if (volume && face_id < volume->getNumVolumeFaces())
 	{
 		const LLVolumeFace& face = volume->getVolumeFace(face_id);
-		for (S32 i = 0; i < (S32)face.mVertices.size(); ++i)
+		for (S32 i = 0; i < face.getNumVertices(); ++i)
 		{
-			result += face.mVertices[i].mNormal;
+			result += face.getNormal(i);
 		}
 
 		result = volumeDirectionToAgent(result);
@@ -3218,6 +3237,8 @@ LLVolumeBridge::LLVolumeBridge(LLDrawable* drawablep)
 	mSlopRatio = 0.25f;
 }
 
+LLVolumeGeometryThread* LLVolumeGeometryManager::sFillThread = NULL;
+
 void LLVolumeGeometryManager::registerFace(LLSpatialGroup* group, LLFace* facep, U32 type)
 {
 	LLMemType mt(LLMemType::MTYPE_SPACE_PARTITION);
@@ -3535,7 +3556,11 @@ void LLVolumeGeometryManager::rebuildGeom(LLSpatialGroup* group)
 	genDrawInfo(group, fullbright_mask, fullbright_faces);
 	genDrawInfo(group, alpha_mask, alpha_faces, TRUE);
 
-	if (!LLPipeline::sDelayVBUpdate)
+	if (!mFillBuffers.empty())
+	{ //sFillThread clears the rebuild status once the buffers are filled
+		sFillThread->queueFill(group, mFillFaces, mFillBuffers);
+	}
+	else if (!LLPipeline::sDelayVBUpdate)
 	{
 		//drawables have been rebuilt, clear rebuild status
 		for (LLSpatialGroup::element_iter drawable_iter = group->getData().begin(); drawable_iter != group->getData().end(); ++drawable_iter)
@@ -3676,6 +3701,9 @@ void LLVolumeGeometryManager::genDrawInfo(LLSpatialGroup* group, U32 mask, std::
 	LLViewerTexture* last_tex = NULL;
 	S32 buffer_index = 0;
 
+	// leave the copying to the fill thread when rebuilding a batch of groups
+	bool queue_fills = sFillThread && sFillThread->isBatching() && !LLPipeline::sDelayVBUpdate;
+
 	if (distance_sort)
 	{
 		buffer_index = -1;
@@ -3779,7 +3807,16 @@ void LLVolumeGeometryManager::genDrawInfo(LLSpatialGroup* group, U32 mask, std::
 
 					U32 te_idx = facep->getTEOffset();
 
-					if (facep->getGeometryVolume(*volume, te_idx, 
+					if (queue_fills)
+					{
+						if (facep->prepareGeometryVolume(*volume, te_idx))
+						{
+							mFillFaces.push_back(facep);
+							buffer->markDirty(facep->getGeomIndex(), facep->getGeomCount(), 
+								facep->getIndicesStart(), facep->getIndicesCount());
+						}
+					}
+					else if (facep->getGeometryVolume(*volume, te_idx, 
 						vobj->getRelativeXform(), vobj->getRelativeXformInvTrans(), index_offset))
 					{
 						buffer->markDirty(facep->getGeomIndex(), facep->getGeomCount(), 
@@ -3919,7 +3956,14 @@ void LLVolumeGeometryManager::genDrawInfo(LLSpatialGroup* group, U32 mask, std::
 			++face_iter;
 		}
 
-		buffer->setBuffer(0);
+		if (queue_fills)
+		{ //unmapped by sFillThread once filled
+			mFillBuffers.push_back(buffer);
+		}
+		else
+		{
+			buffer->setBuffer(0);
+		}
 	}
 
 	group->mBufferMap[mask].clear();
@@ -3929,6 +3973,95 @@ void LLVolumeGeometryManager::genDrawInfo(LLSpatialGroup* group, U32 mask, std::
 	}
 }
 
+//-----------------------------------------------------------------------------
+// LLVolumeGeometryThread
+//-----------------------------------------------------------------------------
+
+// Faces are handed out in runs of about this many vertices, so a group with
+// a lot of geometry is spread over several workers.
+const U32 FILL_REQUEST_VERTICES = 8192;
+
+struct face_vertices
+{
+	U32 operator()(const LLFace* facep) const { return facep->getGeomCount(); }
+};
+
+LLVolumeGeometryThread::FillRequest::FillRequest(handle_t handle, std::vector<LLFace*>::const_iterator begin,
+												 std::vector<LLFace*>::const_iterator end)
+:	LLQueuedThread::QueuedRequest(handle, LLQueuedThread::PRIORITY_NORMAL),
+	mFaces(begin, end)
+{
+}
+
+LLVolumeGeometryThread::FillRequest::~FillRequest()
+{
+}
+
+// Called from LLVolumeGeometryThread workers or from finishBatch()
+bool LLVolumeGeometryThread::FillRequest::processRequest()
+{
+	for (std::vector<LLFace*>::iterator iter = mFaces.begin(); iter != mFaces.end(); ++iter)
+	{
+		LLFace* facep = *iter;
+		LLVOVolume* vobj = facep->getDrawable()->getVOVolume();
+		facep->fillGeometryVolume(*vobj->getVolume(), facep->getTEOffset(), 
+			vobj->getRelativeXform(), vobj->getRelativeXformInvTrans(), facep->getGeomIndex());
+	}
+	return true;
+}
+
+LLVolumeGeometryThread::LLVolumeGeometryThread(bool threaded, U32 concurrency)
+:	LLQueuedThread("volumegeometry", threaded, concurrency),
+	mBatching(false)
+{
+}
+
+void LLVolumeGeometryThread::beginBatch()
+{
+	if (mBatching)
+	{
+		llerrs << "LLVolumeGeometryThread::beginBatch called twice" << llendl;
+	}
+	mBatching = true;
+}
+
+void LLVolumeGeometryThread::queueFill(LLSpatialGroup* group, std::vector<LLFace*>& faces,
+									   std::vector<LLPointer<LLVertexBuffer> >& buffers)
+{
+	mPending.push_back(PendingFill());
+	PendingFill& pending = mPending.back();
+	pending.mGroup = group;
+	pending.mBuffers.swap(buffers);
+	addRequests<FillRequest>(faces, FILL_REQUEST_VERTICES, face_vertices(), pending.mHandles);
+	faces.clear();
+}
+
+void LLVolumeGeometryThread::finishBatch()
+{
+	for (std::vector<PendingFill>::iterator iter = mPending.begin(); iter != mPending.end(); ++iter)
+	{
+		PendingFill& pending = *iter;
+		// fills queued faces here rather than wait for the workers to get to them
+		waitForRequests(pending.mHandles);
+
+		for (std::vector<LLPointer<LLVertexBuffer> >::iterator buffer = pending.mBuffers.begin(); buffer != pending.mBuffers.end(); ++buffer)
+		{
+			(*buffer)->setBuffer(0);
+		}
+
+		//drawables have been rebuilt, clear rebuild status
+		LLSpatialGroup* group = pending.mGroup;
+		for (LLSpatialGroup::element_iter drawable_iter = group->getData().begin(); drawable_iter != group->getData().end(); ++drawable_iter)
+		{
+			LLDrawable* drawablep = *drawable_iter;
+			drawablep->clearState(LLDrawable::REBUILD_ALL);
+		}
+	}
+
+	mPending.clear();
+	mBatching = false;
+}
+
 void LLGeometryManager::addGeometryCount(LLSpatialGroup* group, U32 &vertex_count, U32 &index_count)
 {	
 	//initialize to default usage for this partition
@@ -349,6 +349,7 @@ LLPipeline::LLPipeline() :
 	mNoiseMap = 0;
 	mTrueNoiseMap = 0;
 	mLightFunc = 0;
+	mCullThread = NULL;
 }
 
 void LLPipeline::init()
@@ -362,6 +363,24 @@ void LLPipeline::init()
 	sRenderAttachedLights = gSavedSettings.getBOOL("RenderAttachedLights");
 	sRenderAttachedParticles = gSavedSettings.getBOOL("RenderAttachedParticles");
 
+	U32 cull_threads = gSavedSettings.getU32("RenderCullThreads");
+	if (cull_threads > 0 && !mCullThread)
+	{
+		mCullThread = new LLSpatialCullThread(true, cull_threads);
+	}
+
+	U32 geometry_threads = gSavedSettings.getU32("RenderGeometryThreads");
+	if (geometry_threads > 0 && !LLVolumeGeometryManager::sFillThread)
+	{
+		LLVolumeGeometryManager::sFillThread = new LLVolumeGeometryThread(true, geometry_threads);
+	}
+
+	U32 skin_threads = gSavedSettings.getU32("RenderAvatarSkinThreads");
+	if (skin_threads > 0 && !LLVOAvatar::sSkinThread)
+	{
+		LLVOAvatar::sSkinThread = new LLAvatarSkinThread(true, skin_threads);
+	}
+
 	mInitialized = TRUE;
 	
 	stop_glerror();
@@ -489,6 +508,27 @@ void LLPipeline::cleanup()
 
 	mMovedBridge.clear();
 
+	if (mCullThread)
+	{
+		mCullThread->shutdown();
+		delete mCullThread;
+		mCullThread = NULL;
+	}
+
+	if (LLVolumeGeometryManager::sFillThread)
+	{
+		LLVolumeGeometryManager::sFillThread->shutdown();
+		delete LLVolumeGeometryManager::sFillThread;
+		LLVolumeGeometryManager::sFillThread = NULL;
+	}
+
+	if (LLVOAvatar::sSkinThread)
+	{
+		LLVOAvatar::sSkinThread->shutdown();
+		delete LLVOAvatar::sSkinThread;
+		LLVOAvatar::sSkinThread = NULL;
+	}
+
 	mInitialized = FALSE;
 }
 
@@ -1573,6 +1613,57 @@ BOOL LLPipeline::getVisibleExtents(LLCamera& camera, LLVector3& min, LLVector3&
 
 static LLFastTimer::DeclareTimer FTM_CULL("Object Culling");
 
+void LLPipeline::setRegionClipPlane(LLCamera& camera, LLViewerRegion* region, S32 water_clip)
+{
+	if (water_clip != 0)
+	{
+		LLPlane plane(LLVector3(0,0, (F32) -water_clip), (F32) water_clip*region->getWaterHeight());
+		camera.setUserClipPlane(plane);
+	}
+	else
+	{
+		camera.disableUserClipPlane();
+	}
+}
+
+// Same as the serial loop in updateCull(), but every partition's frustum
+// checks are queued on mCullThread before the first one is replayed. The
+// replays still fill sCull one partition at a time in region order, so the
+// cull result comes out in the same order either way.
+void LLPipeline::updateCullThreaded(LLCamera& camera, S32 water_clip)
+{
+	std::vector<LLViewerRegion*> regions;
+	std::vector<LLSpatialPartition*> parts;
+	std::vector<LLQueuedThread::handle_t> handles;
+
+	for (LLWorld::region_list_t::const_iterator iter = LLWorld::getInstance()->getRegionList().begin(); 
+			iter != LLWorld::getInstance()->getRegionList().end(); ++iter)
+	{
+		LLViewerRegion* region = *iter;
+		setRegionClipPlane(camera, region, water_clip);
+
+		for (U32 i = 0; i < LLViewerRegion::NUM_PARTITIONS; i++)
+		{
+			LLSpatialPartition* part = region->getSpatialPartition(i);
+			if (part && hasRenderType(part->mDrawableType))
+			{
+				regions.push_back(region);
+				parts.push_back(part);
+				handles.push_back(mCullThread->cullPartition(part, camera));
+			}
+		}
+	}
+
+	for (U32 i = 0; i < parts.size(); i++)
+	{
+		if (i == 0 || regions[i] != regions[i - 1])
+		{
+			setRegionClipPlane(camera, regions[i], water_clip);
+		}
+		mCullThread->finishCull(handles[i], parts[i], camera);
+	}
+}
+
 void LLPipeline::updateCull(LLCamera& camera, LLCullResult& result, S32 water_clip)
 {
 	LLFastTimer t(FTM_CULL);
@@ -1614,28 +1705,27 @@ void LLPipeline::updateCull(LLCamera& camera, LLCullResult& result, S32 water_cl
 
 	LLGLDepthTest depth(GL_TRUE, GL_FALSE);
 
-	for (LLWorld::region_list_t::const_iterator iter = LLWorld::getInstance()->getRegionList().begin(); 
-			iter != LLWorld::getInstance()->getRegionList().end(); ++iter)
+	if (mCullThread)
 	{
-		LLViewerRegion* region = *iter;
-		if (water_clip != 0)
-		{
-			LLPlane plane(LLVector3(0,0, (F32) -water_clip), (F32) water_clip*region->getWaterHeight());
-			camera.setUserClipPlane(plane);
-		}
-		else
+		updateCullThreaded(camera, water_clip);
+	}
+	else
+	{
+		for (LLWorld::region_list_t::const_iterator iter = LLWorld::getInstance()->getRegionList().begin(); 
+				iter != LLWorld::getInstance()->getRegionList().end(); ++iter)
 		{
-			camera.disableUserClipPlane();
-		}
+			LLViewerRegion* region = *iter;
+			setRegionClipPlane(camera, region, water_clip);
 
-		for (U32 i = 0; i < LLViewerRegion::NUM_PARTITIONS; i++)
-		{
-			LLSpatialPartition* part = region->getSpatialPartition(i);
-			if (part)
+			for (U32 i = 0; i < LLViewerRegion::NUM_PARTITIONS; i++)
 			{
-				if (hasRenderType(part->mDrawableType))
+				LLSpatialPartition* part = region->getSpatialPartition(i);
+				if (part)
 				{
-					part->cull(camera);
+					if (hasRenderType(part->mDrawableType))
+					{
+						part->cull(camera);
+					}
 				}
 			}
 		}
@@ -1810,6 +1900,12 @@ void LLPipeline::rebuildPriorityGroups()
 	
 	assertInitialized();
 
+	LLVolumeGeometryThread* fill_thread = LLVolumeGeometryManager::sFillThread;
+	if (fill_thread)
+	{
+		fill_thread->beginBatch();
+	}
+
 	// Iterate through all drawables on the priority build queue,
 	for (LLSpatialGroup::sg_vector_t::iterator iter = mGroupQ1.begin();
 		 iter != mGroupQ1.end(); ++iter)
@@ -1819,6 +1915,11 @@ void LLPipeline::rebuildPriorityGroups()
 		group->clearState(LLSpatialGroup::IN_BUILD_Q1);
 	}
 
+	if (fill_thread)
+	{
+		fill_thread->finishBatch();
+	}
+
 	mGroupQ1.clear();
 }
 		
@@ -1832,6 +1933,13 @@ void LLPipeline::rebuildGroups()
 	
 	std::sort(mGroupQ2.begin(), mGroupQ2.end(), LLSpatialGroup::CompareUpdateUrgency());
 
+	// the volume groups' buffers are filled while the next groups are laid out
+	LLVolumeGeometryThread* fill_thread = LLVolumeGeometryManager::sFillThread;
+	if (fill_thread)
+	{
+		fill_thread->beginBatch();
+	}
+
 	LLSpatialGroup::sg_vector_t::iterator iter;
 	for (iter = mGroupQ2.begin();
 		 iter != mGroupQ2.end(); ++iter)
@@ -1859,6 +1967,11 @@ void LLPipeline::rebuildGroups()
 		}
 	}	
 
+	if (fill_thread)
+	{
+		fill_thread->finishBatch();
+	}
+
 	mGroupQ2.erase(mGroupQ2.begin(), iter);
 
 	updateMovedList(mMovedBridge);
@@ -3071,6 +3184,11 @@ void LLPipeline::renderGeom(LLCamera& camera, BOOL forceVBOUpdate)
 	
 	LLAppViewer::instance()->pingMainloopTimeout("Pipeline:RenderDrawPools");
 
+	if (hasRenderType(LLPipeline::RENDER_TYPE_AVATAR))
+	{ //skin all the avatars at once rather than one at a time as their pools render
+		LLVOAvatar::skinVisibleAvatars();
+	}
+
 	for (pool_set_t::iterator iter = mPools.begin(); iter != mPools.end(); ++iter)
 	{
 		LLDrawPool *poolp = *iter;
@@ -6516,6 +6634,9 @@ void LLPipeline::renderDeferredLighting()
 			{
 				bindDeferredShader(gDeferredLightProgram);
 				LLGLDepthTest depth(GL_TRUE, GL_FALSE);
+
+				mDeferredLights.clear();
+				mDeferredLightBoxes.clear();
 				for (LLDrawable::drawable_set_t::iterator iter = mLights.begin(); iter != mLights.end(); ++iter)
 				{
 					LLDrawable* drawablep = *iter;
@@ -6534,9 +6655,6 @@ void LLPipeline::renderDeferredLighting()
 						}
 					}
 
-
-					LLVector3 center = drawablep->getPositionAgent();
-					F32* c = center.mV;
 					F32 s = volume->getLightRadius()*1.5f;
 
 					LLColor3 col = volume->getLightColor();
@@ -6552,11 +6670,33 @@ void LLPipeline::renderDeferredLighting()
 						continue;
 					}
 
-					if (camera->AABBInFrustumNoFarClip(center, LLVector3(s,s,s)) == 0)
+					mDeferredLights.push_back(drawablep);
+					mDeferredLightBoxes.push_back(drawablep->getPositionAgent(), LLVector3(s,s,s));
+				}
+
+				mDeferredLightVisible.resize(mDeferredLights.size());
+				if (!mDeferredLights.empty())
+				{
+					camera->AABBsInFrustum(mDeferredLightBoxes, &mDeferredLightVisible[0], false);
+				}
+
+				for (U32 i = 0; i < mDeferredLights.size(); ++i)
+				{
+					if (mDeferredLightVisible[i] == 0)
 					{
 						continue;
 					}
 
+					LLDrawable* drawablep = mDeferredLights[i];
+					LLVOVolume* volume = drawablep->getVOVolume();
+
+					LLVector3 center = drawablep->getPositionAgent();
+					F32* c = center.mV;
+					F32 s = volume->getLightRadius()*1.5f;
+
+					LLColor3 col = volume->getLightColor();
+					col *= volume->getLightIntensity();
+
 					sVisibleLightCount++;
 
 					glh::vec3f tc(c);
@@ -54,6 +54,7 @@ class LLCubeMap;
 class LLCullResult;
 class LLVOAvatar;
 class LLGLSLShader;
+class LLViewerRegion;
 
 typedef enum e_avatar_skinning_method
 {
@@ -201,6 +202,8 @@ public:
 	BOOL getVisibleExtents(LLCamera& camera, LLVector3 &min, LLVector3& max);
 	BOOL getVisiblePointCloud(LLCamera& camera, LLVector3 &min, LLVector3& max, std::vector<LLVector3>& fp, LLVector3 light_dir = LLVector3(0,0,0));
 	void updateCull(LLCamera& camera, LLCullResult& result, S32 water_clip = 0);  //if water_clip is 0, ignore water plane, 1, cull to above plane, -1, cull to below plane
+	void updateCullThreaded(LLCamera& camera, S32 water_clip);
+	void setRegionClipPlane(LLCamera& camera, LLViewerRegion* region, S32 water_clip);
 	void createObjects(F32 max_dtime);
 	void createObject(LLViewerObject* vobj);
 	void updateGeom(F32 max_dtime);
@@ -594,6 +597,11 @@ protected:
 	LLDrawable::drawable_set_t		mLights;
 	light_set_t						mNearbyLights; // lights near camera
 	LLColor4						mHWLightColors[8];
+
+	// mLights bright enough to draw, frustum culled together by renderDeferredLighting()
+	std::vector<LLDrawable*>		mDeferredLights;
+	LLCameraBoxBatch				mDeferredLightBoxes;
+	std::vector<S8>					mDeferredLightVisible;
 	
 	/////////////////////////////////////////////
 	//
@@ -604,6 +612,8 @@ protected:
 	LLSpatialGroup::sg_vector_t		mGroupQ1; //priority
 	LLSpatialGroup::sg_vector_t		mGroupQ2; // non-priority
 
+	LLSpatialCullThread*			mCullThread; // frustum checks for updateCull(), NULL to cull one partition at a time
+
 	LLViewerObject::vobj_list_t		mCreateQ;
 		
 	LLDrawable::drawable_set_t		mRetexturedList;
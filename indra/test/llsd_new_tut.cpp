@@ -753,6 +753,42 @@ namespace tut
 		ensure("type is a string", v.isString());
 	}
 
+	template<> template<>
+	void SDTestObject::test<15>()
+		// common scalar values are shared, not allocated
+	{
+		SDCleanupCheck check;
+
+		{
+			SDAllocationCheck check("shared values", 0);
+			LLSD t = true;
+			LLSD f = false;
+			LLSD i = 0;
+			LLSD j = -1;
+			LLSD r = 1.0;
+			LLSD u = LLUUID::null;
+			u = i;
+			i = 31;
+		}
+
+		{
+			SDAllocationCheck check("assign over shared value", 1);
+			LLSD v = 1;
+			LLSD w = 1;
+			v = 1000;
+			ensureTypeAndValue("shared value unaltered", w, 1);
+			ensureTypeAndValue("assigned value", v, 1000);
+			w = false;
+			ensureTypeAndValue("shared boolean", w, false);
+		}
+
+		{
+			SDAllocationCheck check("negative zero keeps its sign", 1);
+			LLSD v = -0.0;
+			ensure("negative zero", 1.0 / v.asReal() < 0.0);
+		}
+	}
+
 	/* TO DO:
 		conversion of undefined to UUID, Date, URI and Binary
 		conversion of undefined to map and array
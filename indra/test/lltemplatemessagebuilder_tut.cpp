@@ -966,5 +966,130 @@ namespace tut
 		ensure_equals("Ensure unchanged buffer ", strlen(outBuffer), 0);
 		delete reader;
 	}
-}
 
+	template<> template<>
+	void LLTemplateMessageBuilderTestObject::test<46>()
+		// flat and legacy decode agree on repeated blocks
+	{
+		LLMessageTemplate messageTemplate = defaultTemplate();
+		messageTemplate.addBlock(defaultBlock(MVT_U32, 4, MBT_SINGLE));
+		LLMessageBlock* block = createBlock(_PREHASH_Test1, MVT_VARIABLE, 1);
+		block->addVariable(_PREHASH_Test2, MVT_U16, 2);
+		messageTemplate.addBlock(block);
+
+		LLTemplateMessageBuilder* builder = defaultBuilder(messageTemplate);
+		builder->addU32(_PREHASH_Test0, 0xdeadbeef);
+		const char* strings[] = { "one", "", "three" };
+		for (U16 i = 0; i < 3; ++i)
+		{
+			builder->nextBlock(_PREHASH_Test1);
+			builder->addString(_PREHASH_Test0, strings[i]);
+			builder->addU16(_PREHASH_Test2, i + 100);
+		}
+		const U32 bufferSize = 1024;
+		U8 buffer[bufferSize];
+		memset(buffer, 0, LL_PACKET_ID_SIZE);
+		U32 builtSize = builder->buildMessage(buffer, bufferSize, 0);
+		delete builder;
+
+		numberMap[1] = &messageTemplate;
+		LLTemplateMessageReader legacy(numberMap);
+		legacy.setFlatDecode(false);
+		legacy.validateMessage(buffer, builtSize, LLHost());
+		legacy.readMessage(buffer, LLHost());
+		LLTemplateMessageReader flat(numberMap);
+		ensure("flat decode is the default", flat.getFlatDecode());
+		flat.validateMessage(buffer, builtSize, LLHost());
+		flat.readMessage(buffer, LLHost());
+
+		ensure_equals("Ensure block count", flat.getNumberOfBlocks(_PREHASH_Test1),
+					  legacy.getNumberOfBlocks(_PREHASH_Test1));
+		ensure_equals("Ensure 3 repeats", flat.getNumberOfBlocks(_PREHASH_Test1), 3);
+		ensure_equals("Ensure unknown block", flat.getNumberOfBlocks(_PREHASH_TestMessage), 0);
+		U32 flatU32, legacyU32;
+		flat.getU32(_PREHASH_Test0, _PREHASH_Test0, flatU32);
+		legacy.getU32(_PREHASH_Test0, _PREHASH_Test0, legacyU32);
+		ensure_equals("Ensure single block value", flatU32, legacyU32);
+		for (S32 i = 0; i < 3; ++i)
+		{
+			std::string flatString, legacyString;
+			U16 flatU16, legacyU16;
+			flat.getString(_PREHASH_Test1, _PREHASH_Test0, flatString, i);
+			legacy.getString(_PREHASH_Test1, _PREHASH_Test0, legacyString, i);
+			flat.getU16(_PREHASH_Test1, _PREHASH_Test2, flatU16, i);
+			legacy.getU16(_PREHASH_Test1, _PREHASH_Test2, legacyU16, i);
+			ensure_equals("Ensure string", flatString, legacyString);
+			ensure_equals("Ensure string value", flatString, std::string(strings[i]));
+			ensure_equals("Ensure U16", flatU16, legacyU16);
+			ensure_equals("Ensure size", flat.getSize(_PREHASH_Test1, i, _PREHASH_Test0),
+						  legacy.getSize(_PREHASH_Test1, i, _PREHASH_Test0));
+		}
+		ensure_equals("Ensure missing variable", flat.getSize(_PREHASH_Test1, 0, _PREHASH_TestMessage),
+					  LL_VARIABLE_NOT_IN_BLOCK);
+		ensure_equals("Ensure missing repeat", flat.getSize(_PREHASH_Test1, 3, _PREHASH_Test0),
+					  LL_BLOCK_NOT_IN_MESSAGE);
+	}
+
+	template<> template<>
+	void LLTemplateMessageBuilderTestObject::test<47>()
+		// forwarding a flat decoded message
+	{
+		LLMessageTemplate messageTemplate = defaultTemplate();
+		messageTemplate.addBlock(createBlock(_PREHASH_Test0, MVT_U32, 4));
+
+		LLTemplateMessageBuilder* builder = defaultBuilder(messageTemplate);
+		builder->addU32(_PREHASH_Test0, 42);
+		builder->nextBlock(_PREHASH_Test0);
+		builder->addU32(_PREHASH_Test0, 43);
+		LLTemplateMessageReader* reader = setReader(messageTemplate, builder);
+		ensure("flat decoded", reader->getFlatDecode());
+
+		builder = defaultBuilder(messageTemplate);
+		builder->newMessage(_PREHASH_TestMessage);
+		reader->copyToBuilder(*builder);
+		delete reader;
+
+		reader = setReader(messageTemplate, builder);
+		U32 value0, value1;
+		reader->getU32(_PREHASH_Test0, _PREHASH_Test0, value0, 0);
+		reader->getU32(_PREHASH_Test0, _PREHASH_Test0, value1, 1);
+		ensure_equals("Ensure forwarded block count", reader->getNumberOfBlocks(_PREHASH_Test0), 2);
+		ensure_equals("Ensure first value", value0, 42U);
+		ensure_equals("Ensure second value", value1, 43U);
+		delete reader;
+	}
+
+	template<> template<>
+	void LLTemplateMessageBuilderTestObject::test<48>()
+		// name index probe length over real variable names
+	{
+		static const char* names[] =
+		{
+			"ID", "State", "FullID", "CRC", "PCode", "Material", "ClickAction",
+			"Scale", "ObjectData", "ParentID", "UpdateFlags", "PathCurve",
+			"ProfileCurve", "PathBegin", "PathEnd", "PathScaleX", "PathScaleY",
+			"PathShearX", "PathShearY", "PathTwist", "PathTwistBegin",
+			"PathRadiusOffset", "PathTaperX", "PathTaperY", "PathRevolutions",
+			"PathSkew", "ProfileBegin", "ProfileEnd", "ProfileHollow",
+			"TextureEntry", "TextureAnim", "NameValue", "Data", "Text",
+			"TextColor", "MediaURL", "PSBlock", "ExtraParams", "Sound",
+			"OwnerID", "Gain", "Flags", "Radius", "JointType", "JointPivot",
+			"JointAxisOrAnchor"
+		};
+		const S32 count = sizeof(names) / sizeof(names[0]);
+
+		LLMsgNameIndex index;
+		for (S32 i = 0; i < count; ++i)
+		{
+			index.add(LLMessageStringTable::getInstance()->getString(names[i]), i);
+		}
+		for (S32 i = 0; i < count; ++i)
+		{
+			ensure_equals(names[i], index.find(LLMessageStringTable::getInstance()->getString(names[i])), i);
+		}
+		ensure_equals("Ensure unknown name", index.find(_PREHASH_TestMessage), -1);
+		// Interned names are a string table entry apart; a hash that ignores
+		// that stride piles them into a fraction of the slots.
+		ensure("Ensure short probes", index.getMaxProbeLength() <= 8);
+	}
+}